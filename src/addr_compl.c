@@ -44,6 +44,7 @@
 #include "hooks.h"
 #include "gtkutils.h"
 #include "stock_pixmap.h"
+#include "timing.h"
 #include <pthread.h>
 
 #ifndef USE_ALT_ADDRBOOK
@@ -70,17 +71,30 @@ enum {
  * containing all address book entries. Next we make the completion
  * list, which contains all the completable strings, and store a
  * reference to the address entry it belongs to.
- * After calling the g_completion_complete(), we get a reference
- * to a valid email address.  
  *
- * Completion is very simplified. We never complete on another prefix,
- * i.e. we neglect the next smallest possible prefix for the current
- * completion cache. This is simply done so we might break up the
- * addresses a little more (e.g. break up alfons@proteus.demon.nl into
- * something like alfons, proteus, demon, nl; and then completing on
- * any of those words).
+ * The completable strings are case folded and indexed by each of their
+ * word starts (e.g. alfons@proteus.demon.nl is found by alfons, proteus,
+ * demon and nl). The index is a sorted array of those keys, so looking
+ * up a prefix is a binary search followed by a walk over the matching
+ * range. When the address book changes, the list is read again and
+ * only the entries that actually changed are removed from or added to
+ * the index.
+ *
+ * Matches inside words are looked up in a second index, of the byte
+ * n-grams of up to INDEX_GRAM_LEN bytes of each string: the entries
+ * listed under the least common n-gram of the search string are the
+ * only ones that can contain it.
+ *
+ * Matches are ranked once per address and only the best
+ * ADDR_COMPL_MAX_RESULTS of them are kept for display.
  */
 
+/* number of completed addresses offered at most */
+#define ADDR_COMPL_MAX_RESULTS	100
+
+/* length of the longest n-grams indexed for matches inside words */
+#define INDEX_GRAM_LEN		3
+
 /**
  * completion_entry - structure used to complete addresses, with a reference
  * the the real address information.
@@ -91,12 +105,28 @@ typedef struct
 	address_entry	*ref;	 /* address the string belongs to  */
 } completion_entry;
 
+/**
+ * index_key - a word start in a completion string.
+ */
+typedef struct
+{
+	const gchar		*key;	/* points into ce->string */
+	completion_entry	*ce;	/* entry the key belongs to */
+} index_key;
+
 /*******************************************************************************/
 
 static gint	    g_ref_count;	/* list ref count */
-static GList 	   *g_completion_list = NULL;	/* list of strings to be checked */
+static gboolean	    g_index_dirty = FALSE;	/* address book changed since indexing */
+static GList 	   *g_completion_list = NULL;	/* strings added since last indexing */
 static GList 	   *g_address_list = NULL;	/* address storage */
-static GCompletion *g_completion;	/* completion object */
+
+static GArray	   *g_index_keys = NULL;	/* sorted index_key array */
+static GHashTable  *g_index_grams = NULL;	/* n-gram -> GPtrArray of completion_entry */
+static GHashTable  *g_index_entries = NULL;	/* address_entry -> its completion_entry list */
+static GHashTable  *g_index_addresses = NULL;	/* case folded address -> number of entries */
+static guint	    g_index_count = 0;		/* nr of indexed completion strings */
+static gboolean	    g_match_any_part = FALSE;	/* match word starts, not only string start */
 
 static GHashTable *_groupAddresses_ = NULL;
 static gboolean _allowCommas_ = TRUE;
@@ -106,14 +136,18 @@ static gboolean _allowCommas_ = TRUE;
 
 static gint	    g_completion_count;		/* nr of addresses incl. the prefix */
 static gint	    g_completion_next;		/* next prev address */
-static GSList	   *g_completion_addresses;	/* unique addresses found in the
+static GPtrArray   *g_completion_addresses;	/* unique addresses found in the
 						   completion cache. */
 static gchar	   *g_completion_prefix;	/* last prefix. (this is cached here
-						 * because the prefix passed to g_completion
+						 * because the prefix looked up in the index
 						 * is g_utf8_strdown()'ed */
 
 static gchar *completion_folder_path = NULL;
 
+/* the index is used by the spam filter threads too: everything above is
+ * only touched with this lock held */
+G_LOCK_DEFINE_STATIC(completion_index);
+
 /*******************************************************************************/
 
 /*
@@ -154,32 +188,11 @@ static gboolean addr_compl_selected		(GtkTreeSelection *selector,
 static gboolean addr_compl_defer_select_destruct(CompletionWindow *window);
 
 /**
- * Function used by GTK to find the string data to be used for completion.
- * \param data Pointer to data being processed.
- */
-static gchar *completion_func(gpointer data)
-{
-	cm_return_val_if_fail(data != NULL, NULL);
-
-	return ((completion_entry *)data)->string;
-} 
-
-static gint addr_completion_func(const gchar *needle, const gchar *haystack,
-		gsize n)
-{
-	if (needle == NULL || haystack == NULL)
-		return 1;
-
-	return (strcasestr(haystack, needle) != NULL ? 0 : 1);
-}
-
-/**
- * Function used by GTK to compare elements for sorting
+ * Weight of a match, used to rank the completed addresses:
  * name match beginning > name match after space > email address
  *   match beginning and full match before @ > email adress
  *   match beginning. Otherwise match position in string.
- * \param a first element in comparsion
- * \param b second element in comparison
+ * \param addr matched address entry
  */
 static gint weight_addr_match(const address_entry* addr)
 {
@@ -219,22 +232,381 @@ static gint weight_addr_match(const address_entry* addr)
 	return MIN(a_weight, n_weight);
 }
 
-static gint addr_comparison_func(gconstpointer a, gconstpointer b)
+typedef struct
+{
+	address_entry	*ref;
+	gint		 weight;
+} ranked_address;
+
+static gint addr_comparison_func(const ranked_address *a,
+				 const ranked_address *b)
 {
-	const address_entry*	a_ref = (const address_entry*)a;
-	const address_entry*	b_ref = (const address_entry*)b;
-	gint			a_weight = weight_addr_match(a_ref);
-	gint			b_weight = weight_addr_match(b_ref);
-	gint			cmp;
+	gint cmp;
 
-	if (a_weight < b_weight)
+	if (a->weight < b->weight)
 		return -1;
-	else if (a_weight > b_weight)
+	else if (a->weight > b->weight)
 		return 1;
 	else {
-		cmp = strcmp(a_ref->name, b_ref->name);
-		return cmp ? cmp : g_strcmp0(a_ref->address, b_ref->address);
+		cmp = strcmp(a->ref->name, b->ref->name);
+		return cmp ? cmp : g_strcmp0(a->ref->address, b->ref->address);
+	}
+}
+
+static gint addr_comparison_sort_func(gconstpointer a, gconstpointer b)
+{
+	return addr_comparison_func((const ranked_address *)a,
+				    (const ranked_address *)b);
+}
+
+/**
+ * Keep the worst of the best addresses found so far at the top of the heap.
+ */
+static void ranked_heap_sift_down(ranked_address *heap, guint len, guint i)
+{
+	ranked_address tmp;
+	guint child;
+
+	while ((child = 2 * i + 1) < len) {
+		if (child + 1 < len
+		 && addr_comparison_func(&heap[child + 1], &heap[child]) > 0)
+			child++;
+		if (addr_comparison_func(&heap[child], &heap[i]) <= 0)
+			break;
+		tmp = heap[i];
+		heap[i] = heap[child];
+		heap[child] = tmp;
+		i = child;
+	}
+}
+
+static void ranked_heap_sift_up(ranked_address *heap, guint i)
+{
+	ranked_address tmp;
+	guint parent;
+
+	while (i > 0) {
+		parent = (i - 1) / 2;
+		if (addr_comparison_func(&heap[i], &heap[parent]) <= 0)
+			break;
+		tmp = heap[i];
+		heap[i] = heap[parent];
+		heap[parent] = tmp;
+		i = parent;
+	}
+}
+
+/**
+ * Rank the matched addresses and return the best ones, best first.
+ * Each address is weighted once, and only a bounded heap of the best
+ * results is kept instead of sorting all matches.
+ * \param found Unique matched address entries.
+ * \param max   Maximum number of addresses to return.
+ * \return Array of address entries.
+ */
+static GPtrArray *rank_addresses(GPtrArray *found, guint max)
+{
+	ranked_address *heap;
+	ranked_address cur;
+	GPtrArray *result;
+	guint len = 0;
+	guint i;
+
+	heap = g_new(ranked_address, MIN(found->len, max));
+
+	for (i = 0; i < found->len; i++) {
+		cur.ref = g_ptr_array_index(found, i);
+		cur.weight = weight_addr_match(cur.ref);
+
+		if (len < max) {
+			heap[len] = cur;
+			ranked_heap_sift_up(heap, len++);
+		} else if (addr_comparison_func(&cur, &heap[0]) < 0) {
+			heap[0] = cur;
+			ranked_heap_sift_down(heap, len, 0);
+		}
+	}
+
+	qsort(heap, len, sizeof(ranked_address), addr_comparison_sort_func);
+
+	result = g_ptr_array_sized_new(len);
+	for (i = 0; i < len; i++)
+		g_ptr_array_add(result, heap[i].ref);
+	g_free(heap);
+
+	return result;
+}
+
+/**
+ * Compare index keys in byte order, so that all keys starting with the
+ * same prefix are adjacent.
+ */
+static gint index_key_compare(gconstpointer a, gconstpointer b)
+{
+	return strcmp(((const index_key *)a)->key, ((const index_key *)b)->key);
+}
+
+static gboolean is_word_char(const gchar *p)
+{
+	return g_unichar_isalnum(g_utf8_get_char(p));
+}
+
+/**
+ * Pack up to INDEX_GRAM_LEN bytes of a string into an n-gram key. The
+ * bytes are never 0, so n-grams of different lengths never collide.
+ */
+static guint index_gram(const gchar *p, gsize len)
+{
+	guint gram = 0;
+	gsize i;
+
+	for (i = 0; i < len; i++)
+		gram = (gram << 8) | (guchar)p[i];
+
+	return gram;
+}
+
+/**
+ * Add the distinct n-grams of a string to a set.
+ */
+static void index_collect_grams(const gchar *str, GHashTable *grams)
+{
+	gsize len = strlen(str), i, n;
+	gpointer gram;
+
+	for (i = 0; i < len; i++) {
+		for (n = 1; n <= INDEX_GRAM_LEN && i + n <= len; n++) {
+			gram = GUINT_TO_POINTER(index_gram(str + i, n));
+			g_hash_table_insert(grams, gram, gram);
+		}
+	}
+}
+
+/**
+ * List a completion string under each of its n-grams.
+ */
+static void index_add_grams(completion_entry *ce)
+{
+	GHashTable *grams = g_hash_table_new(NULL, NULL);
+	GHashTableIter iter;
+	GPtrArray *entries;
+	gpointer gram;
+
+	index_collect_grams(ce->string, grams);
+
+	g_hash_table_iter_init(&iter, grams);
+	while (g_hash_table_iter_next(&iter, &gram, NULL)) {
+		entries = g_hash_table_lookup(g_index_grams, gram);
+		if (entries == NULL) {
+			entries = g_ptr_array_new();
+			g_hash_table_insert(g_index_grams, gram, entries);
+		}
+		g_ptr_array_add(entries, ce);
 	}
+	g_hash_table_destroy(grams);
+}
+
+/**
+ * Drop the entries marked for removal from the n-gram lists of the
+ * removed addresses. Each list is compacted once.
+ */
+static void index_prune_grams(GSList *removed)
+{
+	GHashTable *grams = g_hash_table_new(NULL, NULL);
+	GHashTableIter iter;
+	GPtrArray *entries;
+	gpointer gram;
+	GSList *walk, *c;
+	guint i, kept;
+
+	for (walk = removed; walk != NULL; walk = walk->next) {
+		c = g_hash_table_lookup(g_index_entries, walk->data);
+		for (; c != NULL; c = c->next)
+			index_collect_grams(((completion_entry *)c->data)->string,
+					    grams);
+	}
+
+	g_hash_table_iter_init(&iter, grams);
+	while (g_hash_table_iter_next(&iter, &gram, NULL)) {
+		entries = g_hash_table_lookup(g_index_grams, gram);
+		if (entries == NULL)
+			continue;
+		for (i = 0, kept = 0; i < entries->len; i++) {
+			completion_entry *ce = g_ptr_array_index(entries, i);
+
+			if (ce->ref != NULL)
+				g_ptr_array_index(entries, kept++) = ce;
+		}
+		if (kept == 0)
+			g_hash_table_remove(g_index_grams, gram);
+		else
+			g_ptr_array_set_size(entries, kept);
+	}
+	g_hash_table_destroy(grams);
+}
+
+/**
+ * Append the word starts of a completion string to the (unsorted) tail
+ * of the index, and list it under its n-grams.
+ */
+static void index_add_entry(completion_entry *ce)
+{
+	index_key k;
+	const gchar *p, *prev;
+
+	g_index_count++;
+	if (*ce->string == '\0')
+		return;
+
+	k.ce = ce;
+	k.key = ce->string;
+	g_array_append_val(g_index_keys, k);
+	index_add_grams(ce);
+
+	if (!g_utf8_validate(ce->string, -1, NULL))
+		return;
+
+	for (prev = ce->string, p = g_utf8_next_char(prev);
+	     *p != '\0';
+	     prev = p, p = g_utf8_next_char(p)) {
+		if (is_word_char(p) && !is_word_char(prev)) {
+			k.key = p;
+			g_array_append_val(g_index_keys, k);
+		}
+	}
+}
+
+/**
+ * Sort the keys appended since the last call and merge them into the
+ * sorted part of the index. Keys of removed entries are dropped.
+ */
+static void index_merge(guint sorted_len)
+{
+	GArray *merged;
+	index_key *old, *new;
+	guint n_old, n_new, i = 0, j = 0;
+
+	n_old = sorted_len;
+	n_new = g_index_keys->len - sorted_len;
+	old = (index_key *)g_index_keys->data;
+	new = old + sorted_len;
+
+	if (n_new > 0)
+		qsort(new, n_new, sizeof(index_key), index_key_compare);
+
+	merged = g_array_sized_new(FALSE, FALSE, sizeof(index_key),
+				   g_index_keys->len);
+	while (i < n_old || j < n_new) {
+		index_key *k;
+
+		if (j >= n_new || (i < n_old && index_key_compare(&old[i], &new[j]) <= 0))
+			k = &old[i++];
+		else
+			k = &new[j++];
+		if (k->ce->ref != NULL)
+			g_array_append_val(merged, *k);
+	}
+
+	g_array_free(g_index_keys, TRUE);
+	g_index_keys = merged;
+}
+
+/**
+ * Return the position of the first key not smaller than prefix.
+ */
+static guint index_lower_bound(const gchar *prefix)
+{
+	guint lo = 0, hi = g_index_keys->len, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (strcmp(g_array_index(g_index_keys, index_key, mid).key, prefix) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/**
+ * Look up the address entries containing a case folded string anywhere.
+ * Only the entries listed under its least common n-gram are looked at,
+ * and those are certain matches if the string is no longer than an
+ * n-gram.
+ * \param str   Case folded search string.
+ * \param seen  Address entries found already.
+ * \param found Array receiving the unique matching address entries.
+ * \param max   Stop once found holds this many entries.
+ */
+static void index_lookup_infix(const gchar *str, GHashTable *seen,
+			       GPtrArray *found, guint max)
+{
+	GPtrArray *entries = NULL, *cur;
+	gsize len = strlen(str), n, i;
+	guint j;
+
+	n = MIN(len, INDEX_GRAM_LEN);
+	for (i = 0; i + n <= len; i++) {
+		cur = g_hash_table_lookup(g_index_grams,
+				GUINT_TO_POINTER(index_gram(str + i, n)));
+		if (cur == NULL)
+			return;
+		if (entries == NULL || cur->len < entries->len)
+			entries = cur;
+	}
+
+	for (j = 0; j < entries->len && found->len < max; j++) {
+		completion_entry *ce = g_ptr_array_index(entries, j);
+
+		if (ce->ref == NULL || g_hash_table_lookup(seen, ce->ref) != NULL)
+			continue;
+		if (len > n && strstr(ce->string, str) == NULL)
+			continue;
+		g_hash_table_insert(seen, ce->ref, ce->ref);
+		g_ptr_array_add(found, ce->ref);
+	}
+}
+
+/**
+ * Look up the address entries matching a case folded prefix.
+ * \param prefix   Case folded search string.
+ * \param found    Array receiving the unique matching address entries.
+ * \param scan_max When matching any part and fewer entries than this were
+ *                 found at word starts, also look for the prefix inside
+ *                 words.
+ */
+static void index_lookup(const gchar *prefix, GPtrArray *found, guint scan_max)
+{
+	GHashTable *seen;
+	gboolean any_part;
+	gsize len;
+	guint i;
+
+	if (g_index_keys == NULL || *prefix == '\0')
+		return;
+
+	any_part = g_match_any_part && prefs_common.address_search_wildcard;
+	len = strlen(prefix);
+	seen = g_hash_table_new(NULL, NULL);
+
+	for (i = index_lower_bound(prefix); i < g_index_keys->len; i++) {
+		index_key *k = &g_array_index(g_index_keys, index_key, i);
+
+		if (strncmp(k->key, prefix, len) != 0)
+			break;
+		if (!any_part && k->key != k->ce->string)
+			continue;
+		if (g_hash_table_lookup(seen, k->ce->ref) == NULL) {
+			g_hash_table_insert(seen, k->ce->ref, k->ce->ref);
+			g_ptr_array_add(found, k->ce->ref);
+		}
+	}
+
+	if (any_part && found->len < scan_max)
+		index_lookup_infix(prefix, seen, found, scan_max);
+
+	g_hash_table_destroy(seen);
 }
 
 /**
@@ -242,19 +614,55 @@ static gint addr_comparison_func(gconstpointer a, gconstpointer b)
  */
 static void init_all(void)
 {
-	g_completion = g_completion_new(completion_func);
-	cm_return_if_fail(g_completion != NULL);
+	g_index_keys = g_array_new(FALSE, FALSE, sizeof(index_key));
+	g_index_grams = g_hash_table_new_full(NULL, NULL, NULL,
+					      (GDestroyNotify)g_ptr_array_unref);
+	g_index_entries = g_hash_table_new_full(NULL, NULL, NULL,
+						(GDestroyNotify)g_slist_free);
+	g_index_addresses = g_hash_table_new_full(g_str_hash, g_str_equal,
+						  g_free, NULL);
+	g_index_count = 0;
 }
 
 /**
- * set the compare function (default is strncmp)
+ * set whether matching is done on word starts or only on the start of
+ * the completion strings
  */
 static void set_match_any_part(const gboolean any_part)
 {
-	if (any_part && prefs_common.address_search_wildcard)
-		g_completion_set_compare(g_completion, addr_completion_func);
-	else
-		g_completion_set_compare(g_completion, strncmp);
+	g_match_any_part = any_part;
+}
+
+static void free_address_entry(address_entry *ae)
+{
+	g_free(ae->name);
+	g_free(ae->address);
+	g_list_free(ae->grp_emails);
+	g_free(ae);
+}
+
+static void free_completion_entry(completion_entry *ce)
+{
+	g_free(ce->string);
+	g_free(ce);
+}
+
+static void index_address_ref(const address_entry *ae, gint delta)
+{
+	gchar *key;
+	gint count;
+
+	if (ae->address == NULL || *ae->address == '\0')
+		return;
+
+	key = g_utf8_strdown(ae->address, -1);
+	count = GPOINTER_TO_INT(g_hash_table_lookup(g_index_addresses, key)) + delta;
+	if (count > 0)
+		g_hash_table_replace(g_index_addresses, key, GINT_TO_POINTER(count));
+	else {
+		g_hash_table_remove(g_index_addresses, key);
+		g_free(key);
+	}
 }
 
 static void free_all_addresses(void)
@@ -265,10 +673,11 @@ static void free_all_addresses(void)
 	walk = g_address_list;
 	for (; walk != NULL; walk = g_list_next(walk)) {
 		address_entry *ae = (address_entry *) walk->data;
-		g_free(ae->name);
-		g_free(ae->address);
-		g_list_free(ae->grp_emails);
-		g_free(walk->data);
+		GSList *ces = g_hash_table_lookup(g_index_entries, ae);
+
+		g_slist_free_full(ces, (GDestroyNotify)free_completion_entry);
+		g_hash_table_steal(g_index_entries, ae);
+		free_address_entry(ae);
 	}
 	g_list_free(g_address_list);
 	g_address_list = NULL;
@@ -280,21 +689,9 @@ static void free_all_addresses(void)
 static void clear_completion_cache(void);
 static void free_completion_list(void)
 {
-	GList *walk;
-	if (!g_completion_list)
-		return;
-	
 	clear_completion_cache();
-	if (g_completion)
-		g_completion_clear_items(g_completion);
 
-	walk = g_list_first(g_completion_list);
-	for (; walk != NULL; walk = g_list_next(walk)) {
-		completion_entry *ce = (completion_entry *) walk->data;
-		g_free(ce->string);
-		g_free(walk->data);
-	}
-	g_list_free(g_completion_list);
+	g_list_free_full(g_completion_list, (GDestroyNotify)free_completion_entry);
 	g_completion_list = NULL;
 }
 /**
@@ -304,8 +701,15 @@ static void free_all(void)
 {
 	free_completion_list();	
 	free_all_addresses();	
-	g_completion_free(g_completion);
-	g_completion = NULL;
+	g_array_free(g_index_keys, TRUE);
+	g_index_keys = NULL;
+	g_hash_table_destroy(g_index_grams);
+	g_index_grams = NULL;
+	g_hash_table_destroy(g_index_entries);
+	g_index_entries = NULL;
+	g_hash_table_destroy(g_index_addresses);
+	g_index_addresses = NULL;
+	g_index_count = 0;
 }
 
 /**
@@ -317,7 +721,7 @@ void addr_compl_add_address1(const char *str, address_entry *ae)
 {
 	completion_entry *ce1;
 	ce1 = g_new0(completion_entry, 1),
-	/* GCompletion list is case sensitive */
+	/* the index is case insensitive */
 	ce1->string = g_utf8_strdown(str, -1);
 	ce1->ref = ae;
 
@@ -332,11 +736,13 @@ void addr_compl_add_address1(const char *str, address_entry *ae)
  * \param alias   Alias to append.
  * \param grp_emails the emails in case of a group. List should be freed later, 
  * but not its strings
+ * \param item    Address book person or group the address belongs to.
  * \return <code>0</code> if entry appended successfully, or <code>-1</code>
  *         if failure.
  */
 static gint add_address(const gchar *name, const gchar *address, 
-			const gchar *nick, const gchar *alias, GList *grp_emails)
+			const gchar *nick, const gchar *alias, GList *grp_emails,
+			gpointer item)
 {
 	address_entry *ae;
 
@@ -352,6 +758,7 @@ static gint add_address(const gchar *name, const gchar *address,
 	ae->name = g_strdup(name);
 	ae->address = g_strdup(address);
 	ae->grp_emails = grp_emails;
+	ae->item = item;
 	g_address_list = g_list_prepend(g_address_list, ae);
 
 	addr_compl_add_address1(name, ae);
@@ -368,12 +775,191 @@ static gint add_address(const gchar *name, const gchar *address,
 	return 0;
 }
 
+#ifdef USE_ALT_ADDRBOOK
+static gint add_address_dbus(const gchar *name, const gchar *address,
+			     const gchar *nick, const gchar *alias,
+			     GList *grp_emails)
+{
+	return add_address(name, address, nick, alias, grp_emails, NULL);
+}
+#endif
+
+/**
+ * Identify an address entry by its content, to recognize unchanged
+ * entries when the address book is read again.
+ */
+static gchar *address_entry_signature(const address_entry *ae, GSList *ces)
+{
+	GString *sig;
+
+	sig = g_string_new(ae->name);
+	g_string_append_c(sig, '\001');
+	if (ae->address)
+		g_string_append(sig, ae->address);
+	for (; ces != NULL; ces = ces->next) {
+		g_string_append_c(sig, '\001');
+		g_string_append(sig, ((completion_entry *)ces->data)->string);
+	}
+
+	return g_string_free(sig, FALSE);
+}
+
+/**
+ * Group the completion strings added since the last indexing by address.
+ */
+static GHashTable *group_completion_list(GList *list)
+{
+	GHashTable *entries;
+	GList *walk;
+
+	entries = g_hash_table_new_full(NULL, NULL, NULL,
+					(GDestroyNotify)g_slist_free);
+	/* the list is prepended to, walk it backwards to keep the order */
+	for (walk = g_list_last(list); walk != NULL; walk = g_list_previous(walk)) {
+		completion_entry *ce = (completion_entry *)walk->data;
+		GSList *ces = g_hash_table_lookup(entries, ce->ref);
+
+		g_hash_table_steal(entries, ce->ref);
+		g_hash_table_insert(entries, ce->ref, g_slist_append(ces, ce));
+	}
+
+	return entries;
+}
+
+/**
+ * Update the index after (a part of) the address book was read again:
+ * entries that did not change are kept together with their index keys,
+ * the others are removed from or added to the index.
+ * \param old_addresses Entries before reading the address book.
+ * \param new_addresses Entries read; unchanged ones are replaced by
+ *                      the old entry.
+ */
+static void index_update(GList *old_addresses, GList *new_addresses)
+{
+	GHashTable *new_entries;
+	GHashTable *old_by_sig;
+	GHashTableIter iter;
+	gpointer value;
+	GSList *removed = NULL, *walk;
+	GList *cur;
+	guint sorted_len = g_index_keys->len;
+	guint kept = 0, added = 0, n_removed;
+
+	new_entries = group_completion_list(g_completion_list);
+	g_list_free(g_completion_list);
+	g_completion_list = NULL;
+
+	/* groups refer to the address book's email items, which may have
+	 * been reloaded: never keep them. */
+	old_by_sig = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	for (cur = old_addresses; cur != NULL; cur = cur->next) {
+		address_entry *ae = (address_entry *)cur->data;
+		gchar *sig;
+
+		if (ae->address == NULL) {
+			removed = g_slist_prepend(removed, ae);
+			continue;
+		}
+		sig = address_entry_signature(ae,
+				g_hash_table_lookup(g_index_entries, ae));
+		if (g_hash_table_lookup(old_by_sig, sig) == NULL)
+			g_hash_table_insert(old_by_sig, sig, ae);
+		else {
+			removed = g_slist_prepend(removed, ae);
+			g_free(sig);
+		}
+	}
+
+	for (cur = new_addresses; cur != NULL; cur = cur->next) {
+		address_entry *ae = (address_entry *)cur->data;
+		GSList *ces = g_hash_table_lookup(new_entries, ae);
+		address_entry *old = NULL;
+
+		if (ae->address != NULL) {
+			gchar *sig = address_entry_signature(ae, ces);
+
+			old = g_hash_table_lookup(old_by_sig, sig);
+			if (old != NULL)
+				g_hash_table_remove(old_by_sig, sig);
+			g_free(sig);
+		}
+
+		if (old != NULL) {
+			/* unchanged, keep the indexed entry; the address
+			 * book may have been reloaded, take its new item */
+			old->item = ae->item;
+			cur->data = old;
+			g_slist_free_full(ces, (GDestroyNotify)free_completion_entry);
+			g_hash_table_steal(new_entries, ae);
+			free_address_entry(ae);
+			kept++;
+			continue;
+		}
+
+		g_hash_table_steal(new_entries, ae);
+		g_hash_table_insert(g_index_entries, ae, ces);
+		for (walk = ces; walk != NULL; walk = walk->next)
+			index_add_entry((completion_entry *)walk->data);
+		index_address_ref(ae, 1);
+		added++;
+	}
+
+	/* strings added by plugins for addresses not in the list */
+	g_hash_table_iter_init(&iter, new_entries);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+		g_slist_foreach((GSList *)value, (GFunc)free_completion_entry, NULL);
+	g_hash_table_destroy(new_entries);
+
+	/* what is left did not show up again */
+	g_hash_table_iter_init(&iter, old_by_sig);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+		removed = g_slist_prepend(removed, value);
+	g_hash_table_destroy(old_by_sig);
+	n_removed = g_slist_length(removed);
+
+	for (walk = removed; walk != NULL; walk = walk->next) {
+		address_entry *ae = (address_entry *)walk->data;
+		GSList *ces = g_hash_table_lookup(g_index_entries, ae), *c;
+
+		/* mark the keys for removal by the merge below */
+		for (c = ces; c != NULL; c = c->next)
+			((completion_entry *)c->data)->ref = NULL;
+		g_index_count -= g_slist_length(ces);
+		index_address_ref(ae, -1);
+	}
+
+	if (added > 0 || n_removed > 0)
+		index_merge(sorted_len);
+	if (n_removed > 0)
+		index_prune_grams(removed);
+
+	for (walk = removed; walk != NULL; walk = walk->next) {
+		address_entry *ae = (address_entry *)walk->data;
+		GSList *ces = g_hash_table_lookup(g_index_entries, ae);
+
+		g_slist_free_full(ces, (GDestroyNotify)free_completion_entry);
+		g_hash_table_steal(g_index_entries, ae);
+		free_address_entry(ae);
+	}
+	g_slist_free(removed);
+
+	debug_print("address completion index: %d kept, %d added, %d removed, "
+		    "%d keys\n", kept, added, n_removed, g_index_keys->len);
+}
+
 /**
- * Read address book, creating all entries in the completion index.
+ * Read address book, updating the entries of the completion index.
  */ 
 static void read_address_book(gchar *folderpath) {
-	free_all_addresses();
+	GList *old_addresses;
+
 	free_completion_list();
+	if (_groupAddresses_)
+		g_hash_table_destroy(_groupAddresses_);
+	_groupAddresses_ = NULL;
+
+	old_addresses = g_address_list;
+	g_address_list = NULL;
 
 #ifndef USE_ALT_ADDRBOOK
 	addrindex_load_completion( add_address, folderpath );
@@ -381,10 +967,9 @@ static void read_address_book(gchar *folderpath) {
 	GError* error = NULL;
 	
 	addrcompl_initialize();
-	if (! addrindex_dbus_load_completion(add_address, &error)) {
+	if (! addrindex_dbus_load_completion(add_address_dbus, &error)) {
 		g_warning("Failed to populate address completion list");
         g_error_free(error);
-		return;
 	}
 #endif
 	/* plugins may hook in here to modify/extend the completion list */
@@ -393,14 +978,30 @@ static void read_address_book(gchar *folderpath) {
 	}
 
 	g_address_list = g_list_reverse(g_address_list);
-	g_completion_list = g_list_reverse(g_completion_list);
-	/* merge the completion entry list into g_completion */
-	if (g_completion_list) {
-		g_completion_add_items(g_completion, g_completion_list);
-		if (debug_get_mode())
-			debug_print("read %d items in %s\n",
-				g_list_length(g_completion_list),
-				folderpath?folderpath:"(null)");
+
+	START_TIMING("indexing addresses");
+	index_update(old_addresses, g_address_list);
+	END_TIMING();
+	g_list_free(old_addresses);
+
+	if (debug_get_mode())
+		debug_print("read %d items in %s\n", g_index_count,
+			folderpath?folderpath:"(null)");
+}
+
+/**
+ * Build the index if there is none yet, or read the address book again
+ * if it changed since. Called with the index lock held.
+ */
+static void index_ensure(void)
+{
+	if (g_index_keys == NULL) {
+		init_all();
+		g_index_dirty = TRUE;
+	}
+	if (g_index_dirty) {
+		g_index_dirty = FALSE;
+		read_address_book(completion_folder_path);
 	}
 }
 
@@ -424,7 +1025,7 @@ static void clear_completion_cache(void)
 		g_free(g_completion_prefix);
 
 		if (g_completion_addresses) {
-			g_slist_free(g_completion_addresses);
+			g_ptr_array_free(g_completion_addresses, TRUE);
 			g_completion_addresses = NULL;
 		}
 
@@ -439,11 +1040,13 @@ static void clear_completion_cache(void)
  */
 guint start_address_completion(gchar *folderpath)
 {
-	gboolean different_book = FALSE;
+	guint count;
+
+	G_LOCK(completion_index);
 	clear_completion_cache();
 
 	if (g_strcmp0(completion_folder_path,folderpath))
-		different_book = TRUE;
+		g_index_dirty = TRUE;
 
 	g_free(completion_folder_path);
 	if (folderpath != NULL)
@@ -451,18 +1054,20 @@ guint start_address_completion(gchar *folderpath)
 	else
 		completion_folder_path = NULL;
 
-	if (!g_ref_count) {
-		init_all();
-		/* open the address book */
-		read_address_book(folderpath);
-	} else if (different_book)
-		read_address_book(folderpath);
+	/* the first user gets the default matching */
+	if (g_ref_count == 0)
+		set_match_any_part(FALSE);
+
+	/* open the address book */
+	index_ensure();
 
 	g_ref_count++;
 	debug_print("start_address_completion(%s) ref count %d\n",
 				folderpath?folderpath:"(null)", g_ref_count);
+	count = g_index_count;
+	G_UNLOCK(completion_index);
 
-	return g_list_length(g_completion_list);
+	return count;
 }
 
 /**
@@ -589,49 +1194,37 @@ static void replace_address_in_edit(GtkEntry *entry, const gchar *newtext,
  */
 guint complete_address(const gchar *str)
 {
-	GList *result = NULL;
+	GPtrArray *found;
 	gchar *d = NULL;
 	guint  count = 0;
-	guint  cpl = 0;
-	completion_entry *ce = NULL;
 
 	cm_return_val_if_fail(str != NULL, 0);
 
-	/* g_completion is case sensitive */
+	/* the index is case folded */
 	d = g_utf8_strdown(str, -1);
 
+	G_LOCK(completion_index);
+	index_ensure();
 	clear_completion_cache();
 	g_completion_prefix = g_strdup(str);
 
-	result = g_completion_complete(g_completion, d, NULL);
-
-	count = g_list_length(result);
-	if (count) {
-		/* create list with unique addresses  */
-		for (cpl = 0, result = g_list_first(result);
-		     result != NULL;
-		     result = g_list_next(result)) {
-			ce = (completion_entry *)(result->data);
-			if (NULL == g_slist_find(g_completion_addresses,
-						 ce->ref)) {
-				cpl++;
-				g_completion_addresses =
-					g_slist_append(g_completion_addresses,
-						       ce->ref);
-			}
-		}
-		count = cpl + 1;	/* index 0 is the original prefix */
+	found = g_ptr_array_new();
+	index_lookup(d, found, ADDR_COMPL_MAX_RESULTS);
+
+	if (found->len) {
+		/* keep the best unique addresses */
+		g_completion_addresses = rank_addresses(found, ADDR_COMPL_MAX_RESULTS);
+		count = g_completion_addresses->len + 1;	/* index 0 is the original prefix */
 		g_completion_next = 1;	/* we start at the first completed one */
-		if (prefs_common.address_search_wildcard)
-		    g_completion_addresses = g_slist_sort(g_completion_addresses,
-							  addr_comparison_func);
 	} else {
 		g_free(g_completion_prefix);
 		g_completion_prefix = NULL;
 	}
 
 	g_completion_count = count;
+	G_UNLOCK(completion_index);
 
+	g_ptr_array_free(found, TRUE);
 	g_free(d);
 
 	return count;
@@ -645,32 +1238,34 @@ guint complete_address(const gchar *str)
  */
 guint complete_matches_found(const gchar *str)
 {
-	GList *result = NULL;
+	GPtrArray *found;
 	gchar *d = NULL;
+	guint count;
 
 	cm_return_val_if_fail(str != NULL, 0);
 
-	/* g_completion is case sensitive */
+	/* the index is case folded */
 	d = g_utf8_strdown(str, -1);
 
+	G_LOCK(completion_index);
+	index_ensure();
 	clear_completion_cache();
-	g_completion_prefix = g_strdup(str);
 
-	result = g_completion_complete(g_completion, d, NULL);
+	found = g_ptr_array_new();
+	index_lookup(d, found, 1);
+	count = found->len;
+	G_UNLOCK(completion_index);
 
-	g_free(g_completion_prefix);
+	g_ptr_array_free(found, TRUE);
 	g_free(d);
 
-	return g_list_length(result);
+	return count;
 }
 
 /**
- * Return a complete address from the index.
- * \param index Index of entry that was found (by the previous call to
- *              <code>complete_address()</code>
- * \return Completed address string; this should be freed when done.
+ * get_complete_address() with the index lock held.
  */
-gchar *get_complete_address(gint index)
+static gchar *get_complete_address_real(gint index)
 {
 	const address_entry *p;
 	gchar *address = NULL;
@@ -680,7 +1275,7 @@ gchar *get_complete_address(gint index)
 			address = g_strdup(g_completion_prefix);
 		else {
 			/* get something from the unique addresses */
-			p = (address_entry *)g_slist_nth_data
+			p = (address_entry *)g_ptr_array_index
 				(g_completion_addresses, index - 1);
 			if (p != NULL && p->address != NULL) {
 				address = get_complete_address_from_name_email(p->name, p->address);
@@ -701,23 +1296,41 @@ gchar *get_complete_address(gint index)
 	return address;
 }
 
+/**
+ * Return a complete address from the index.
+ * \param index Index of entry that was found (by the previous call to
+ *              <code>complete_address()</code>
+ * \return Completed address string; this should be freed when done.
+ */
+gchar *get_complete_address(gint index)
+{
+	gchar *address;
+
+	G_LOCK(completion_index);
+	address = get_complete_address_real(index);
+	G_UNLOCK(completion_index);
+
+	return address;
+}
+
 /**
  * Return the next complete address match from the completion index.
  * \return Completed address string; this should be freed when done.
  */
 static gchar *get_next_complete_address(void)
 {
-	if (is_completion_pending()) {
-		gchar *res;
+	gchar *res = NULL;
 
-		res = get_complete_address(g_completion_next);
+	G_LOCK(completion_index);
+	if (is_completion_pending()) {
+		res = get_complete_address_real(g_completion_next);
 		g_completion_next += 1;
 		if (g_completion_next >= g_completion_count)
 			g_completion_next = 0;
+	}
+	G_UNLOCK(completion_index);
 
-		return res;
-	} else
-		return NULL;
+	return res;
 }
 
 /**
@@ -726,56 +1339,111 @@ static gchar *get_next_complete_address(void)
  */
 static guint get_completion_count(void)
 {
+	guint count = 0;
+
+	G_LOCK(completion_index);
 	if (is_completion_pending())
-		return g_completion_count;
-	else
-		return 0;
+		count = g_completion_count;
+	G_UNLOCK(completion_index);
+
+	return count;
 }
 
 /**
  * Invalidate address completion index. This function should be called whenever
- * the address book changes. This forces data to be read into the completion
- * data.
+ * the address book changes. The address book is read again when the index
+ * is used next.
  * \return Number of entries in index.
  */
 gint invalidate_address_completion(void)
 {
-	if (g_ref_count) {
-		/* simply the same as start_address_completion() */
-		debug_print("Invalidation request for address completion\n");
-		read_address_book(completion_folder_path);
-		clear_completion_cache();
+	gint count;
+
+	G_LOCK(completion_index);
+	debug_print("Invalidation request for address completion\n");
+	g_index_dirty = TRUE;
+	clear_completion_cache();
+	count = g_index_count;
+	G_UNLOCK(completion_index);
+
+	return count;
+}
+
+/**
+ * Update the index after a person of the address book was edited, without
+ * reading the whole address book again.
+ * \param person Person that was added or changed.
+ */
+void address_completion_update_person(ItemPerson *person)
+{
+	GList *cur, *next, *old_addresses = NULL, *rest;
+
+	cm_return_if_fail(person != NULL);
+
+	G_LOCK(completion_index);
+#ifdef USE_ALT_ADDRBOOK
+	g_index_dirty = TRUE;
+#endif
+	if (g_index_keys == NULL || g_index_dirty) {
+		/* nothing to update, or read again anyway */
+		G_UNLOCK(completion_index);
+		return;
 	}
+	if (completion_folder_path != NULL) {
+		/* the person may have moved in or out of the folder */
+		g_index_dirty = TRUE;
+		G_UNLOCK(completion_index);
+		return;
+	}
+
+	clear_completion_cache();
+	free_completion_list();
 
-	return g_list_length(g_completion_list);
+	for (cur = g_address_list; cur != NULL; cur = next) {
+		next = cur->next;
+		if (((address_entry *)cur->data)->item == person) {
+			g_address_list = g_list_remove_link(g_address_list, cur);
+			old_addresses = g_list_concat(cur, old_addresses);
+		}
+	}
+	rest = g_address_list;
+	g_address_list = NULL;
+
+#ifndef USE_ALT_ADDRBOOK
+	addrindex_load_person_completion(add_address, person);
+#endif
+	g_address_list = g_list_reverse(g_address_list);
+	index_update(old_addresses, g_address_list);
+	g_list_free(old_addresses);
+
+	g_address_list = g_list_concat(rest, g_address_list);
+	G_UNLOCK(completion_index);
 }
 
 /**
  * Finished with completion index. This function should be called after
- * matching addresses.
+ * matching addresses. The index is kept for the next user.
  * \return Reference count.
  */
 gint end_address_completion(void)
 {
-	gboolean different_folder = FALSE;
+	gint count;
+
+	G_LOCK(completion_index);
 	clear_completion_cache();
 
 	/* reset the folderpath to NULL */
 	if (completion_folder_path) {
 		g_free(completion_folder_path);
 		completion_folder_path = NULL;
-		different_folder = TRUE;
+		debug_print("different folder\n");
+		g_index_dirty = TRUE;
 	}
-	if (0 == --g_ref_count)
-		free_all();
+	count = --g_ref_count;
+	debug_print("end_address_completion ref count %d\n", count);
+	G_UNLOCK(completion_index);
 
-	debug_print("end_address_completion ref count %d\n", g_ref_count);
-	if (g_ref_count && different_folder) {
-		debug_print("still ref'd, different folder\n");
-		invalidate_address_completion();
-	}
-
-	return g_ref_count; 
+	return count;
 }
 
 /**
@@ -1718,6 +2386,11 @@ void addrcompl_teardown( void ) {
 	addrcompl_clear_queue();
 
 	_completionIdleID_ = 0;
+
+	G_LOCK(completion_index);
+	if (g_index_keys != NULL)
+		free_all();
+	G_UNLOCK(completion_index);
 	/* g_print( "addrcompl_teardown...done\n" ); */
 }
 
@@ -1836,26 +2509,22 @@ static gboolean addr_compl_defer_select_destruct(CompletionWindow *window)
 gboolean found_in_addressbook(const gchar *address)
 {
 	gchar *addr = NULL;
+	gchar *folded = NULL;
 	gboolean found = FALSE;
-	gint num_addr = 0;
 
 	if (!address)
 		return FALSE;
 
 	addr = g_strdup(address);
 	extract_address(addr);
-	num_addr = complete_address(addr);
-	if (num_addr > 1) {
-		/* skip first item (this is the search string itself) */
-		int i = 1;
-		for (; i < num_addr && !found; i++) {
-			gchar *caddr = get_complete_address(i);
-			extract_address(caddr);
-			if (strcasecmp(caddr, addr) == 0)
-				found = TRUE;
-			g_free(caddr);
-		}
-	}
+	folded = g_utf8_strdown(addr, -1);
+
+	G_LOCK(completion_index);
+	index_ensure();
+	found = g_hash_table_lookup(g_index_addresses, folded) != NULL;
+	G_UNLOCK(completion_index);
+
+	g_free(folded);
 	g_free(addr);
 	return found;
 }
@@ -23,6 +23,8 @@
 
 #include <gtk/gtk.h>
 
+#include "addritem.h"
+
 #define ADDDRESS_COMPLETION_BUILD_ADDRESS_LIST_HOOKLIST "address_completion_build_address_list_hooklist"
 
 /**
@@ -34,6 +36,7 @@ typedef struct
     gchar *name;
     gchar *address;
     GList *grp_emails;
+    gpointer item;	/* address book person or group, or NULL */
 } address_entry;
 
 guint start_address_completion		(gchar *folderpath);
@@ -43,6 +46,7 @@ gchar *get_complete_address		(gint index);
 gint invalidate_address_completion	(void);
 gint end_address_completion		(void);
 gboolean found_in_addressbook(const gchar *address);
+void address_completion_update_person	(ItemPerson *person);
 
 /* ui functions */
 void address_completion_start		(GtkWidget *mainwindow);
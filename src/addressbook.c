@@ -3408,16 +3408,22 @@ static void addressbook_move_nodes_up( GtkCMCTree *ctree, GtkCMCTreeNode *node )
 static void addressbook_edit_address_post_cb( ItemPerson *person )
 {
 	if( person ) {
+		gboolean external = FALSE;
 #ifdef USE_LDAP
 		AddressBookFile *abf = addressbook_get_book_file();
 
 		if (abf && abf->type == ADBOOKTYPE_LDAP) {
 			if (g_strcmp0(person->nickName, ADDRITEM_NAME(person)))
 				addritem_person_set_nick_name( person, ADDRITEM_NAME(person));
+			external = TRUE;
 		}
 #endif
 		addressbook_folder_refresh_one_person( GTK_CMCTREE(addrbook.clist), person );
-		invalidate_address_completion();
+		/* only the edited person needs to be indexed again */
+		if (external)
+			invalidate_address_completion();
+		else
+			address_completion_update_person(person);
 	}
 	addressbook_address_list_set_focus();
 }
@@ -4256,19 +4262,18 @@ static gboolean migrate_addrbook(const gchar *origdir, const gchar *destdir)
 	return !failed;
 }
 
-void addressbook_read_file( void ) {
+/*
+* Read the address index, and the address books it lists, without
+* touching the interface: this can be done in a startup thread.
+* Return: The index, to give to addressbook_read_file_done().
+*/
+AddressIndex *addressbook_read_index( void ) {
 	AddressIndex *addrIndex = NULL;
 	gchar *indexdir = g_strconcat(get_rc_dir(), G_DIR_SEPARATOR_S, ADDRBOOK_DIR, NULL);
+	GList *nodeIf, *nodeDS;
 
 	debug_print( "Reading address index...\n" );
-	if( _addressIndex_ ) {
-		debug_print( "address book already read!!!\n" );
-		g_free(indexdir);
-		return;
-	}
-
 	addrIndex = addrindex_create_index();
-	addrindex_initialize();
 
 	/* Use new address book index. */
 	
@@ -4291,6 +4296,31 @@ void addressbook_read_file( void ) {
 	g_free(indexdir);
 	addrindex_set_file_name( addrIndex, ADDRESSBOOK_INDEX_FILE );
 	addrindex_read_data( addrIndex );
+	if( addrIndex->retVal != MGU_SUCCESS )
+		return addrIndex;
+
+	/* Local address books are read on first use anyway, which is
+	 * the first address completion */
+	for( nodeIf = addrindex_get_interface_list( addrIndex ); nodeIf; nodeIf = g_list_next( nodeIf ) ) {
+		AddressInterface *iface = nodeIf->data;
+
+		if( iface->type != ADDR_IF_BOOK )
+			continue;
+		for( nodeDS = iface->listSource; nodeDS; nodeDS = g_list_next( nodeDS ) )
+			addrindex_ds_read_data( nodeDS->data );
+	}
+
+	return addrIndex;
+}
+
+/*
+* Finish reading the address index in the main thread, converting it
+* from the old format if needed.
+* Enter: addrIndex	Index from addressbook_read_index().
+*/
+void addressbook_read_file_done( AddressIndex *addrIndex ) {
+	addrindex_initialize();
+
 	if( addrIndex->retVal == MGU_NO_FILE ) {
 		/* Conversion required */
 		debug_print( "Converting...\n" );
@@ -4313,6 +4343,15 @@ void addressbook_read_file( void ) {
 	debug_print( "done.\n" );
 }
 
+void addressbook_read_file( void ) {
+	if( _addressIndex_ ) {
+		debug_print( "address book already read!!!\n" );
+		return;
+	}
+
+	addressbook_read_file_done( addressbook_read_index() );
+}
+
 /*
 * Add object into the address index tree widget.
 * Enter: node	Parent node.
@@ -2832,14 +2832,38 @@ void addrindex_remove_results( AddressDataSource *ds, ItemFolder *folder ) {
 * ***********************************************************************
 */
 
+static void addrindex_load_completion_person(
+		gint (*callBackFunc) ( const gchar *, const gchar *, 
+				       const gchar *, const gchar *, GList *,
+				       gpointer ),
+		ItemPerson *person)
+{
+	GList *nodeM;
+	gchar *sName;
+
+	/* Figure out name to use */
+	sName = ADDRITEM_NAME(person);
+	if( sName == NULL || *sName == '\0' ) {
+		sName = person->nickName;
+	}
+
+	/* Process each E-Mail address */
+	for( nodeM = person->listEMail; nodeM; nodeM = g_list_next( nodeM ) ) {
+		ItemEMail *email = nodeM->data;
+
+		callBackFunc( sName, email->address, person->nickName, 
+			      ADDRITEM_NAME(email), NULL, person );
+	}
+}
+
 static void addrindex_load_completion_load_persons(
 		gint (*callBackFunc) ( const gchar *, const gchar *, 
-				       const gchar *, const gchar *, GList * ),
+				       const gchar *, const gchar *, GList *,
+				       gpointer ),
 		AddressDataSource *ds)
 {
 	GList *listP, *nodeP;
 	GList *nodeM;
-	gchar *sName;
 
 	/* Read address book */
 	if( addrindex_ds_get_modify_flag( ds ) ) {
@@ -2862,7 +2886,7 @@ static void addrindex_load_completion_load_persons(
 				emails = g_list_append(emails, email);
 		}
 		callBackFunc( ((AddrItemObject *)group)->name, NULL,
-			      NULL, NULL, emails );
+			      NULL, NULL, emails, group );
 		nodeP = g_list_next( nodeP );
 	}
 
@@ -2872,24 +2896,7 @@ static void addrindex_load_completion_load_persons(
 	listP = addrindex_ds_get_all_persons( ds );
 	nodeP = listP;
 	while( nodeP ) {
-		ItemPerson *person = nodeP->data;
-		nodeM = person->listEMail;
-
-		/* Figure out name to use */
-		sName = ADDRITEM_NAME(person);
-		if( sName == NULL || *sName == '\0' ) {
-			sName = person->nickName;
-		}
-
-		/* Process each E-Mail address */
-		while( nodeM ) {
-			ItemEMail *email = nodeM->data;
-
-			callBackFunc( sName, email->address, person->nickName, 
-				      ADDRITEM_NAME(email), NULL );
-
-			nodeM = g_list_next( nodeM );
-		}
+		addrindex_load_completion_person( callBackFunc, nodeP->data );
 		nodeP = g_list_next( nodeP );
 	}
 
@@ -2910,7 +2917,8 @@ static void addrindex_load_completion_load_persons(
 
 gboolean addrindex_load_completion(
 		gint (*callBackFunc) ( const gchar *, const gchar *, 
-				       const gchar *, const gchar *, GList * ),
+				       const gchar *, const gchar *, GList *,
+				       gpointer ),
 		gchar *folderpath )
 {
 	GList *nodeIf, *nodeDS;
@@ -2932,33 +2940,13 @@ gboolean addrindex_load_completion(
 		if( folder != NULL ) {
 
 			GList *items;
-			GList *nodeM;
-			gchar *sName;
-			ItemPerson *person;
 
 			debug_print("addrindex_load_completion: folder %p '%s'\n", folder, folder->obj.name);
 
 			/* Load email addresses */
 			items = addritem_folder_get_person_list( folder );
 			for( ; items != NULL; items = g_list_next( items ) ) {
-				person = items->data;
-				nodeM = person->listEMail;
-
-				/* Figure out name to use */
-				sName = ADDRITEM_NAME(person);
-				if( sName == NULL || *sName == '\0' ) {
-					sName = person->nickName;
-				}
-
-				/* Process each E-Mail address */
-				while( nodeM ) {
-					ItemEMail *email = nodeM->data;
-
-					callBackFunc( sName, email->address, person->nickName, 
-							  ADDRITEM_NAME(email), NULL );
-
-					nodeM = g_list_next( nodeM );
-				}
+				addrindex_load_completion_person( callBackFunc, items->data );
 			}
 			/* Free up the list (but not the data inside the
 			 * individual list items) */
@@ -3006,6 +2994,26 @@ gboolean addrindex_load_completion(
 	return TRUE;
 }
 
+/**
+ * This function is used by the address completion function to load
+ * the addresses of a single person again after it was edited.
+ *
+ * \param callBackFunc Function to be called when an address is
+ *                     to be loaded.
+ * \param person       Person to load.
+ * \return <i>TRUE</i>
+ */
+gboolean addrindex_load_person_completion(
+		gint (*callBackFunc) ( const gchar *, const gchar *, 
+				       const gchar *, const gchar *, GList *,
+				       gpointer ),
+		ItemPerson *person )
+{
+	addrindex_load_completion_person( callBackFunc, person );
+
+	return TRUE;
+}
+
 /**
  * This function can be used to collect information about
  * addressbook entries that contain a specific attribute.
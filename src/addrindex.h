@@ -170,9 +170,17 @@ void addrindex_remove_results		( AddressDataSource *ds,
 gboolean addrindex_load_completion(
 		gint (*callBackFunc)
 			( const gchar *, const gchar *, 
-			  const gchar *, const gchar *, GList * ),
+			  const gchar *, const gchar *, GList *,
+			  gpointer ),
 			gchar *folderpath );
 
+gboolean addrindex_load_person_completion(
+		gint (*callBackFunc)
+			( const gchar *, const gchar *, 
+			  const gchar *, const gchar *, GList *,
+			  gpointer ),
+			ItemPerson *person );
+
 gboolean addrindex_load_person_attribute( const gchar *attr,
 		gint (*callBackFunc)
 			( ItemPerson *, const gchar * ) );
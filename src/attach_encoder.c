@@ -0,0 +1,262 @@
+/*
+ * Claws Mail -- a GTK+ based, lightweight, and fast e-mail client
+ * Copyright (C) 2026 the Claws Mail team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#include "claws-features.h"
+#endif
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "attach_encoder.h"
+#include "utils.h"
+#include "file-utils.h"
+
+/* Encoding is mostly disk bound, a few threads are enough */
+#define ATTACH_ENCODER_MAX_THREADS	4
+
+typedef enum
+{
+	ENCODER_RUNNING,
+	ENCODER_DONE,
+	ENCODER_FAILED
+} EncoderState;
+
+struct _AttachEncoder
+{
+	gchar *file;
+	EncodingType encoding;
+
+	/* the file when it was queued */
+	goffset size;
+	time_t mtime;
+
+	gchar *encoded;
+	/* only used by the worker */
+	FILE *outfp;
+
+	/* protected by mutex */
+	EncoderState state;
+	goffset length;
+	/* freed while running, the worker cleans up */
+	gboolean freed;
+
+	GMutex *mutex;
+	GCond *cond;
+};
+
+static GThreadPool *encoder_pool = NULL;
+
+static void attach_encoder_destroy(AttachEncoder *encoder)
+{
+	if (encoder->encoded) {
+		claws_unlink(encoder->encoded);
+		g_free(encoder->encoded);
+	}
+	g_free(encoder->file);
+#if !GLIB_CHECK_VERSION(2,32,0)
+	g_cond_free(encoder->cond);
+#else
+	g_cond_clear(encoder->cond);
+	g_free(encoder->cond);
+#endif
+	cm_mutex_free(encoder->mutex);
+	g_free(encoder);
+}
+
+static void attach_encoder_func(gpointer data, gpointer user_data)
+{
+	AttachEncoder *encoder = (AttachEncoder *)data;
+	FILE *infp;
+	EncoderState state = ENCODER_FAILED;
+	GStatBuf s;
+	gboolean freed;
+
+	/* Only touches the encoder's file names, which don't change while
+	 * it runs */
+	if ((infp = claws_fopen(encoder->file, "rb")) == NULL) {
+		FILE_OP_ERROR(encoder->file, "claws_fopen");
+		claws_fclose(encoder->outfp);
+	} else {
+		gboolean ok = procmime_encode_stream(infp, encoder->outfp,
+						     encoder->encoding);
+
+		claws_fclose(infp);
+		if (claws_safe_fclose(encoder->outfp) == EOF)
+			ok = FALSE;
+		if (ok && g_stat(encoder->encoded, &s) == 0)
+			state = ENCODER_DONE;
+	}
+	encoder->outfp = NULL;
+
+	g_mutex_lock(encoder->mutex);
+	encoder->state = state;
+	if (state == ENCODER_DONE)
+		encoder->length = s.st_size;
+	freed = encoder->freed;
+	g_cond_signal(encoder->cond);
+	g_mutex_unlock(encoder->mutex);
+
+	if (freed)
+		attach_encoder_destroy(encoder);
+}
+
+static gboolean attach_encoder_stat(const gchar *file, goffset *size,
+				    time_t *mtime)
+{
+	GStatBuf s;
+
+	if (g_stat(file, &s) < 0)
+		return FALSE;
+
+	*size = s.st_size;
+	*mtime = s.st_mtime;
+	return TRUE;
+}
+
+/* Encodes the current content of the file. The encoder must not be
+ * running. */
+static void attach_encoder_start(AttachEncoder *encoder)
+{
+	GError *error = NULL;
+
+	if (encoder->encoded) {
+		claws_unlink(encoder->encoded);
+		g_free(encoder->encoded);
+		encoder->encoded = NULL;
+	}
+	encoder->state = ENCODER_FAILED;
+
+	if (!attach_encoder_stat(encoder->file, &encoder->size, &encoder->mtime))
+		return;
+
+	encoder->outfp = get_tmpfile_in_dir(get_mime_tmp_dir(), &encoder->encoded);
+	if (encoder->outfp == NULL) {
+		FILE_OP_ERROR(get_mime_tmp_dir(), "get_tmpfile_in_dir");
+		g_free(encoder->encoded);
+		encoder->encoded = NULL;
+		return;
+	}
+
+	if (encoder_pool == NULL) {
+		encoder_pool = g_thread_pool_new(attach_encoder_func, NULL,
+				MIN(cm_get_num_processors(), ATTACH_ENCODER_MAX_THREADS),
+				FALSE, &error);
+		if (encoder_pool == NULL) {
+			g_warning("couldn't create attachment encoding threads: %s",
+				  error ? error->message : "unknown error");
+			if (error)
+				g_error_free(error);
+			claws_fclose(encoder->outfp);
+			encoder->outfp = NULL;
+			return;
+		}
+	}
+
+	debug_print("encoding %s in the background\n", encoder->file);
+	encoder->state = ENCODER_RUNNING;
+	g_thread_pool_push(encoder_pool, encoder, NULL);
+}
+
+/* attach_encoder_new() - starts encoding file in the background.
+ * Returns NULL if the encoding is not one that can be done this way. */
+AttachEncoder *attach_encoder_new(const gchar *file, EncodingType encoding)
+{
+	AttachEncoder *encoder;
+
+	cm_return_val_if_fail(file != NULL, NULL);
+
+	if (encoding != ENC_BASE64 && encoding != ENC_QUOTED_PRINTABLE)
+		return NULL;
+
+	encoder = g_new0(AttachEncoder, 1);
+	encoder->file = g_strdup(file);
+	encoder->encoding = encoding;
+	encoder->mutex = cm_mutex_new();
+#if !GLIB_CHECK_VERSION(2,32,0)
+	encoder->cond = g_cond_new();
+#else
+	encoder->cond = g_new0(GCond, 1);
+	g_cond_init(encoder->cond);
+#endif
+
+	attach_encoder_start(encoder);
+
+	return encoder;
+}
+
+void attach_encoder_free(AttachEncoder *encoder)
+{
+	if (!encoder)
+		return;
+
+	g_mutex_lock(encoder->mutex);
+	if (encoder->state == ENCODER_RUNNING) {
+		encoder->freed = TRUE;
+		g_mutex_unlock(encoder->mutex);
+		return;
+	}
+	g_mutex_unlock(encoder->mutex);
+
+	attach_encoder_destroy(encoder);
+}
+
+/* attach_encoder_get_result() - returns the name of the file holding
+ * the encoded content of file, waiting for it if need be, and its
+ * length. Returns NULL if file or encoding are not those of the encoder
+ * any more, if encoding failed, or if file has changed since it was
+ * encoded; in the last case, it is encoded again for the next time.
+ * The returned file belongs to the encoder. */
+const gchar *attach_encoder_get_result(AttachEncoder *encoder,
+				       const gchar *file,
+				       EncodingType encoding,
+				       goffset *length)
+{
+	EncoderState state;
+	goffset size;
+	time_t mtime;
+
+	cm_return_val_if_fail(file != NULL, NULL);
+	cm_return_val_if_fail(length != NULL, NULL);
+
+	if (encoder == NULL || encoding != encoder->encoding ||
+	    strcmp(file, encoder->file))
+		return NULL;
+
+	g_mutex_lock(encoder->mutex);
+	if (encoder->state == ENCODER_RUNNING)
+		debug_print("waiting for %s to be encoded\n", encoder->file);
+	while (encoder->state == ENCODER_RUNNING)
+		g_cond_wait(encoder->cond, encoder->mutex);
+	state = encoder->state;
+	*length = encoder->length;
+	g_mutex_unlock(encoder->mutex);
+
+	if (!attach_encoder_stat(encoder->file, &size, &mtime))
+		return NULL;
+	if (size != encoder->size || mtime != encoder->mtime) {
+		debug_print("%s changed since it was encoded\n", encoder->file);
+		attach_encoder_start(encoder);
+		return NULL;
+	}
+
+	return state == ENCODER_DONE ? encoder->encoded : NULL;
+}
@@ -0,0 +1,44 @@
+/*
+ * Claws Mail -- a GTK+ based, lightweight, and fast e-mail client
+ * Copyright (C) 2026 the Claws Mail team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __ATTACH_ENCODER_H__
+#define __ATTACH_ENCODER_H__
+
+#include <glib.h>
+
+#include "procmime.h"
+
+/* An attach encoder encodes a file in a worker thread as soon as it is
+ * attached, so that writing the message only has to copy the result.
+ * The result is dropped, and the file encoded again, when the file has
+ * changed since. Only the encodings that don't need canonicalization
+ * are done this way: base64 of binary content and quoted-printable.
+ * All the functions are to be called from the main thread. */
+
+typedef struct _AttachEncoder	AttachEncoder;
+
+AttachEncoder *attach_encoder_new	(const gchar	*file,
+					 EncodingType	 encoding);
+void attach_encoder_free		(AttachEncoder	*encoder);
+
+const gchar *attach_encoder_get_result	(AttachEncoder	*encoder,
+					 const gchar	*file,
+					 EncodingType	 encoding,
+					 goffset	*length);
+
+#endif /* __ATTACH_ENCODER_H__ */
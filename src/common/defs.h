@@ -72,6 +72,7 @@
 #define ADDRESSBOOK_CUSTOM_ATTRIBUTES "attributesrc"
 #define TEMPLATE_DIR		"templates"
 #define TMP_DIR			"tmp"
+#define COMPOSE_JOURNAL_DIR	"composejournal"
 #define UIDL_DIR		"uidl"
 #define NEWSGROUP_LIST		".newsgroup_list"
 #define ADDRESS_BOOK		"addressbook.xml"
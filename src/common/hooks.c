@@ -26,24 +26,85 @@
 #include "utils.h"
 #include "hooks.h"
 
+/* subscribers slower than this are reported in the debug output */
+#define HOOKS_SLOW_USEC		(100 * 1000)
+/* deliver queued events before GTK+ redraws (G_PRIORITY_HIGH_IDLE + 20) */
+#define HOOKS_IDLE_PRIORITY	(G_PRIORITY_HIGH_IDLE + 10)
+
+typedef struct _HooksHook	HooksHook;
+typedef struct _HooksEvent	HooksEvent;
+
+struct _HooksList
+{
+	GHookList	 hooklist;
+	gchar		*name;
+
+	HooksCopyFunc	 copy_func;
+	HooksMergeFunc	 merge_func;
+	GDestroyNotify	 free_func;
+	/* key -> link of its HooksEvent in hooks_pending */
+	GHashTable	*pending;
+};
+
+struct _HooksHook
+{
+	GHook	 hook;
+	guint	 calls;
+	gint64	 total_usec;
+	gint64	 max_usec;
+};
+
+struct _HooksEvent
+{
+	HooksList	*list;
+	gconstpointer	 key;
+	gpointer	 source;
+	GDestroyNotify	 free_func;
+};
+
 static GHashTable *hooklist_table;
+G_LOCK_DEFINE_STATIC(hooklist_table);
 
-static GHookList *hooks_get_hooklist(const gchar *hooklist_name)
+/* hooks are invoked from worker threads too */
+G_LOCK_DEFINE_STATIC(hooks_stats);
+
+/* events waiting for delivery on idle, in the order they were raised */
+G_LOCK_DEFINE_STATIC(hooks_pending);
+static GQueue hooks_pending = G_QUEUE_INIT;
+static guint hooks_pending_id = 0;
+
+/**
+ * Resolve a hook list once, so that busy callers do not have to look
+ * it up by name on every invocation. The handle stays valid for the
+ * whole session.
+ */
+HooksList *hooks_get_list(const gchar *hooklist_name)
 {
-	GHookList *hooklist;
+	HooksList *list;
 
+	cm_return_val_if_fail(hooklist_name != NULL, NULL);
+
+	G_LOCK(hooklist_table);
 	if (hooklist_table == NULL)
 		hooklist_table = g_hash_table_new(g_str_hash, g_str_equal);
 	
-	hooklist = (GHookList *) g_hash_table_lookup(hooklist_table, hooklist_name);
-	if (hooklist != NULL)
-		return hooklist;
-	
-	hooklist = g_new0(GHookList, 1);
-	g_hook_list_init(hooklist, sizeof(GHook));
-	g_hash_table_insert(hooklist_table, g_strdup(hooklist_name), hooklist);
+	list = (HooksList *) g_hash_table_lookup(hooklist_table, hooklist_name);
+	if (list == NULL) {
+		list = g_new0(HooksList, 1);
+		g_hook_list_init(&list->hooklist, sizeof(HooksHook));
+		list->name = g_strdup(hooklist_name);
+		g_hash_table_insert(hooklist_table, list->name, list);
+	}
+	G_UNLOCK(hooklist_table);
 	
-	return hooklist;
+	return list;
+}
+
+static GHookList *hooks_get_hooklist(const gchar *hooklist_name)
+{
+	HooksList *list = hooks_get_list(hooklist_name);
+
+	return list != NULL ? &list->hooklist : NULL;
 }
 
 gulong hooks_register_hook(const gchar *hooklist_name,
@@ -95,6 +156,7 @@ void hooks_unregister_hook(const gchar *hooklist_name,
 
 struct MarshalData
 {
+	HooksList	*list;
 	gpointer	source;
 	gboolean	abort;
 };
@@ -103,28 +165,260 @@ static void hooks_marshal(GHook *hook, gpointer data)
 {
 	gboolean (*func) (gpointer source, gpointer data);
 	struct MarshalData *marshal_data = (struct MarshalData *)data;
+	HooksHook *hooks_hook = (HooksHook *)hook;
+	gint64 start, elapsed;
 
 	if (!marshal_data->abort) {
 		func = hook->func;
+		start = g_get_monotonic_time();
 		marshal_data->abort = func(marshal_data->source, hook->data);
+		elapsed = g_get_monotonic_time() - start;
+
+		G_LOCK(hooks_stats);
+		hooks_hook->calls++;
+		hooks_hook->total_usec += elapsed;
+		if (elapsed > hooks_hook->max_usec)
+			hooks_hook->max_usec = elapsed;
+		G_UNLOCK(hooks_stats);
+		if (elapsed >= HOOKS_SLOW_USEC)
+			debug_print("hook %lu in '%s' took %"G_GINT64_FORMAT" ms\n",
+				    hook->hook_id, marshal_data->list->name,
+				    elapsed / 1000);
 	}
 }
 
-gboolean hooks_invoke(const gchar *hooklist_name,
-		  gpointer source)
+gboolean hooks_invoke_list(HooksList *list, gpointer source)
 {
-	GHookList *hooklist;
 	struct MarshalData marshal_data;
-	
-	cm_return_val_if_fail(hooklist_name != NULL, FALSE);
 
-	hooklist = hooks_get_hooklist(hooklist_name);
-	cm_return_val_if_fail(hooklist != NULL, FALSE);
+	cm_return_val_if_fail(list != NULL, FALSE);
 
+	marshal_data.list = list;
 	marshal_data.source = source;
 	marshal_data.abort = FALSE;
 
-	g_hook_list_marshal(hooklist, TRUE, hooks_marshal, &marshal_data);
+	g_hook_list_marshal(&list->hooklist, TRUE, hooks_marshal, &marshal_data);
 
 	return marshal_data.abort;
 }
+
+gboolean hooks_invoke(const gchar *hooklist_name,
+		  gpointer source)
+{
+	cm_return_val_if_fail(hooklist_name != NULL, FALSE);
+
+	return hooks_invoke_list(hooks_get_list(hooklist_name), source);
+}
+
+static void hooks_free_event(HooksEvent *event)
+{
+	if (event->free_func != NULL)
+		event->free_func(event->source);
+	g_free(event);
+}
+
+static gboolean hooks_deliver_pending(gpointer data)
+{
+	HooksEvent *event;
+	guint count;
+
+	G_LOCK(hooks_pending);
+	hooks_pending_id = 0;
+	count = g_queue_get_length(&hooks_pending);
+	G_UNLOCK(hooks_pending);
+
+	/* events raised by the subscribers wait for the next round */
+	while (count-- > 0) {
+		G_LOCK(hooks_pending);
+		event = g_queue_pop_head(&hooks_pending);
+		if (event != NULL && event->key != NULL)
+			g_hash_table_remove(event->list->pending, event->key);
+		G_UNLOCK(hooks_pending);
+
+		if (event == NULL)
+			break;
+
+		hooks_invoke_list(event->list, event->source);
+		hooks_free_event(event);
+	}
+
+	return FALSE;
+}
+
+/* must be called with the hooks_pending lock held */
+static void hooks_queue_event(HooksEvent *event)
+{
+	g_queue_push_tail(&hooks_pending, event);
+	if (hooks_pending_id == 0)
+		hooks_pending_id = g_idle_add_full(HOOKS_IDLE_PRIORITY,
+				hooks_deliver_pending, NULL, NULL);
+}
+
+/**
+ * Deliver source from the main loop instead of synchronously. This
+ * may be called from any thread; free_func releases source after
+ * delivery.
+ */
+void hooks_invoke_idle(HooksList *list, gpointer source,
+		       GDestroyNotify free_func)
+{
+	HooksEvent *event;
+
+	cm_return_if_fail(list != NULL);
+
+	event = g_new0(HooksEvent, 1);
+	event->list = list;
+	event->source = source;
+	event->free_func = free_func;
+
+	G_LOCK(hooks_pending);
+	hooks_queue_event(event);
+	G_UNLOCK(hooks_pending);
+}
+
+/**
+ * Let a list fold repeated coalesced events for the same key into one
+ * delivery per main loop iteration. Without a merge_func the first
+ * pending event for a key wins.
+ */
+void hooks_list_set_coalescing(HooksList *list, HooksCopyFunc copy_func,
+			       HooksMergeFunc merge_func,
+			       GDestroyNotify free_func)
+{
+	cm_return_if_fail(list != NULL);
+	cm_return_if_fail(copy_func != NULL);
+
+	G_LOCK(hooks_pending);
+	list->copy_func = copy_func;
+	list->merge_func = merge_func;
+	list->free_func = free_func;
+	if (list->pending == NULL)
+		list->pending = g_hash_table_new(g_direct_hash, g_direct_equal);
+	G_UNLOCK(hooks_pending);
+}
+
+/**
+ * Raise an event about the object key. If the list coalesces, the
+ * event is merged into a pending one for the same key or queued for
+ * delivery on idle; otherwise it is delivered right away.
+ */
+void hooks_invoke_coalesced(HooksList *list, gconstpointer key,
+			    gconstpointer source)
+{
+	HooksEvent *event;
+	GList *link;
+
+	cm_return_if_fail(list != NULL);
+	cm_return_if_fail(key != NULL);
+
+	if (list->copy_func == NULL) {
+		hooks_invoke_list(list, (gpointer) source);
+		return;
+	}
+
+	G_LOCK(hooks_pending);
+	link = g_hash_table_lookup(list->pending, key);
+	if (link != NULL) {
+		event = (HooksEvent *) link->data;
+		if (list->merge_func != NULL)
+			list->merge_func(event->source, source);
+	} else {
+		event = g_new0(HooksEvent, 1);
+		event->list = list;
+		event->key = key;
+		event->source = list->copy_func(source);
+		event->free_func = list->free_func;
+		hooks_queue_event(event);
+		g_hash_table_insert(list->pending, (gpointer) key,
+				    hooks_pending.tail);
+	}
+	G_UNLOCK(hooks_pending);
+}
+
+/**
+ * Drop a pending coalesced event, typically because key is about to
+ * be freed.
+ */
+void hooks_cancel_coalesced(HooksList *list, gconstpointer key)
+{
+	GList *link;
+
+	cm_return_if_fail(list != NULL);
+
+	if (list->pending == NULL)
+		return;
+
+	G_LOCK(hooks_pending);
+	link = g_hash_table_lookup(list->pending, key);
+	if (link != NULL) {
+		g_hash_table_remove(list->pending, key);
+		hooks_free_event((HooksEvent *) link->data);
+		g_queue_delete_link(&hooks_pending, link);
+	}
+	G_UNLOCK(hooks_pending);
+}
+
+/**
+ * Call func with the statistics of every registered hook. The
+ * statistics are copied first and func is called without any lock
+ * held, so it may use the hooks itself.
+ */
+void hooks_foreach_stats(HooksStatsFunc func, gpointer data)
+{
+	GHashTableIter iter;
+	HooksList *list;
+	GArray *all;
+	GHook *hook;
+	guint i;
+
+	cm_return_if_fail(func != NULL);
+
+	all = g_array_new(FALSE, FALSE, sizeof(HooksStats));
+
+	G_LOCK(hooklist_table);
+	if (hooklist_table != NULL) {
+		g_hash_table_iter_init(&iter, hooklist_table);
+		while (g_hash_table_iter_next(&iter, NULL, (gpointer *) &list)) {
+			for (hook = g_hook_first_valid(&list->hooklist, FALSE);
+			     hook != NULL;
+			     hook = g_hook_next_valid(&list->hooklist, hook, FALSE)) {
+				HooksHook *hooks_hook = (HooksHook *)hook;
+				HooksStats stats;
+
+				stats.hooklist_name = list->name;
+				stats.hook_id = hook->hook_id;
+				stats.hook_func = hook->func;
+				G_LOCK(hooks_stats);
+				stats.calls = hooks_hook->calls;
+				stats.total_usec = hooks_hook->total_usec;
+				stats.max_usec = hooks_hook->max_usec;
+				G_UNLOCK(hooks_stats);
+				g_array_append_val(all, stats);
+			}
+		}
+	}
+	G_UNLOCK(hooklist_table);
+
+	for (i = 0; i < all->len; i++)
+		func(&g_array_index(all, HooksStats, i), data);
+
+	g_array_free(all, TRUE);
+}
+
+static void hooks_print_stats_func(const HooksStats *stats, gpointer data)
+{
+	if (stats->calls == 0)
+		return;
+
+	debug_print("hook %lu (%p) in '%s': %u calls, %"G_GINT64_FORMAT
+		    " ms total, %"G_GINT64_FORMAT" ms max\n",
+		    stats->hook_id, stats->hook_func, stats->hooklist_name,
+		    stats->calls, stats->total_usec / 1000,
+		    stats->max_usec / 1000);
+}
+
+/* debug output of the time spent in every subscriber */
+void hooks_print_stats(void)
+{
+	hooks_foreach_stats(hooks_print_stats_func, NULL);
+}
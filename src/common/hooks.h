@@ -24,9 +24,32 @@
 
 #define HOOK_NONE 0
 
+typedef struct _HooksList	HooksList;
+typedef struct _HooksStats	HooksStats;
+
 typedef gboolean (*SylpheedHookFunction)	(gpointer source,
 						 gpointer userdata);
 
+/* copy_func returns a private copy of a source queued for later
+ * delivery, merge_func folds a newer source into that copy and
+ * free_func releases it once it has been delivered */
+typedef gpointer (*HooksCopyFunc)	(gconstpointer source);
+typedef void (*HooksMergeFunc)		(gpointer pending,
+					 gconstpointer source);
+
+struct _HooksStats
+{
+	const gchar	*hooklist_name;
+	gulong		 hook_id;
+	gpointer	 hook_func;
+	guint		 calls;
+	gint64		 total_usec;
+	gint64		 max_usec;
+};
+
+typedef void (*HooksStatsFunc)		(const HooksStats *stats,
+					 gpointer data);
+
 gulong hooks_register_hook	(const gchar		*hooklist_name,
 				 SylpheedHookFunction	 hook_func,
 				 gpointer		 userdata);
@@ -35,4 +58,25 @@ void hooks_unregister_hook	(const gchar		*hooklist_name,
 gboolean hooks_invoke		(const gchar		*hooklist_name,
 				 gpointer		 source);
 
+HooksList *hooks_get_list	(const gchar		*hooklist_name);
+gboolean hooks_invoke_list	(HooksList		*list,
+				 gpointer		 source);
+void hooks_invoke_idle		(HooksList		*list,
+				 gpointer		 source,
+				 GDestroyNotify		 free_func);
+
+void hooks_list_set_coalescing	(HooksList		*list,
+				 HooksCopyFunc		 copy_func,
+				 HooksMergeFunc		 merge_func,
+				 GDestroyNotify		 free_func);
+void hooks_invoke_coalesced	(HooksList		*list,
+				 gconstpointer		 key,
+				 gconstpointer		 source);
+void hooks_cancel_coalesced	(HooksList		*list,
+				 gconstpointer		 key);
+
+void hooks_foreach_stats	(HooksStatsFunc		 func,
+				 gpointer		 data);
+void hooks_print_stats		(void);
+
 #endif /* HOOKS_H */
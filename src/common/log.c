@@ -89,13 +89,22 @@ gboolean prefs_common_enable_log_warning(void);
 gboolean prefs_common_enable_log_error(void);
 gboolean prefs_common_enable_log_status(void);
 
-static gboolean invoke_hook_cb (gpointer data)
+static void free_logtext(gpointer data)
 {
 	LogText *logtext = (LogText *)data;
-	hooks_invoke(get_log_hook(logtext->instance), logtext);
+
 	g_free(logtext->text);
 	g_free(logtext);
-	return FALSE;
+}
+
+/* log lines are delivered in one batch per main loop iteration */
+static void invoke_hook(LogText *logtext)
+{
+	static HooksList *lists[LOG_INSTANCE_MAX];
+
+	if (lists[logtext->instance] == NULL)
+		lists[logtext->instance] = hooks_get_list(get_log_hook(logtext->instance));
+	hooks_invoke_idle(lists[logtext->instance], logtext, free_logtext);
 }
 
 void set_log_file(LogInstance instance, const gchar *filename)
@@ -211,7 +220,7 @@ void log_print(LogInstance instance, const gchar *format, ...)
 	logtext->text = g_strdup(buf);
 	logtext->type = LOG_NORMAL;
 	
-	g_timeout_add(0, invoke_hook_cb, logtext);
+	invoke_hook(logtext);
 
 	if (log_fp[instance] && prefs_common_enable_log_standard()) {
 		FPUTS(buf, log_fp[instance])
@@ -242,7 +251,7 @@ void log_message(LogInstance instance, const gchar *format, ...)
 	logtext->text = g_strdup(buf + LOG_TIME_LEN);
 	logtext->type = LOG_MSG;
 	
-	g_timeout_add(0, invoke_hook_cb, logtext);
+	invoke_hook(logtext);
 
 	if (log_fp[instance] && prefs_common_enable_log_standard()) {
 		FWRITE(buf, 1, LOG_TIME_LEN, log_fp[instance])
@@ -276,7 +285,7 @@ void log_warning(LogInstance instance, const gchar *format, ...)
 	logtext->text = g_strdup(buf + LOG_TIME_LEN);
 	logtext->type = LOG_WARN;
 	
-	g_timeout_add(0, invoke_hook_cb, logtext);
+	invoke_hook(logtext);
 
 	if (log_fp[instance] && prefs_common_enable_log_warning()) {
 		FWRITE(buf, 1, LOG_TIME_LEN, log_fp[instance])
@@ -310,7 +319,7 @@ void log_error(LogInstance instance, const gchar *format, ...)
 	logtext->text = g_strdup(buf + LOG_TIME_LEN);
 	logtext->type = LOG_ERROR;
 	
-	g_timeout_add(0, invoke_hook_cb, logtext);
+	invoke_hook(logtext);
 
 	if (log_fp[instance] && prefs_common_enable_log_error()) {
 		FWRITE(buf, 1, LOG_TIME_LEN, log_fp[instance])
@@ -344,7 +353,7 @@ void log_status_ok(LogInstance instance, const gchar *format, ...)
 	logtext->text = g_strdup(buf + LOG_TIME_LEN);
 	logtext->type = LOG_STATUS_OK;
 	
-	g_timeout_add(0, invoke_hook_cb, logtext);
+	invoke_hook(logtext);
 
 	if (log_fp[instance] && prefs_common_enable_log_status()) {
 		FWRITE(buf, 1, LOG_TIME_LEN, log_fp[instance])
@@ -378,7 +387,7 @@ void log_status_nok(LogInstance instance, const gchar *format, ...)
 	logtext->text = g_strdup(buf + LOG_TIME_LEN);
 	logtext->type = LOG_STATUS_NOK;
 	
-	g_timeout_add(0, invoke_hook_cb, logtext);
+	invoke_hook(logtext);
 
 	if (log_fp[instance] && prefs_common_enable_log_status()) {
 		FWRITE(buf, 1, LOG_TIME_LEN, log_fp[instance])
@@ -412,7 +421,7 @@ void log_status_skip(LogInstance instance, const gchar *format, ...)
 	logtext->text = g_strdup(buf + LOG_TIME_LEN);
 	logtext->type = LOG_STATUS_SKIP;
 	
-	g_timeout_add(0, invoke_hook_cb, logtext);
+	invoke_hook(logtext);
 
 	if (log_fp[instance] && prefs_common_enable_log_status()) {
 		FWRITE(buf, 1, LOG_TIME_LEN, log_fp[instance])
@@ -0,0 +1,443 @@
+/*
+ * Claws Mail -- a GTK+ based, lightweight, and fast e-mail client
+ * Copyright (C) 2026 the Claws Mail team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#include "claws-features.h"
+#endif
+
+#include <glib.h>
+#include <string.h>
+
+#include "metrics.h"
+#include "utils.h"
+
+/* bucket n holds the values from 2^(n-1) to 2^n - 1, 0 the others */
+#define METRICS_BUCKETS		64
+/* the spans kept for the trace, the oldest are dropped */
+#define METRICS_EVENTS		16384
+/* the threads told apart in the trace, the others share one */
+#define METRICS_THREADS		256
+
+typedef struct _Metric
+{
+	gchar *name;
+	MetricsType type;
+	gint64 count;
+	gint64 sum;
+	gint64 min;
+	gint64 max;
+	guint buckets[METRICS_BUCKETS];
+} Metric;
+
+typedef struct _MetricsEvent
+{
+	/* of its Metric, which stays until exit */
+	const gchar *name;
+	guint thread;
+	gint64 start;
+	gint64 duration;
+} MetricsEvent;
+
+/* everything below is protected by the lock */
+G_LOCK_DEFINE_STATIC(metrics);
+
+static GHashTable *metrics_table = NULL;
+static gint64 metrics_origin = 0;
+
+static MetricsEvent *metrics_events = NULL;
+static guint metrics_events_next = 0;
+static guint metrics_events_len = 0;
+
+static GThread *metrics_threads[METRICS_THREADS];
+static guint metrics_threads_len = 0;
+
+static Metric *metrics_get(const gchar *name, MetricsType type)
+{
+	Metric *metric;
+
+	if (metrics_table == NULL) {
+		metrics_table = g_hash_table_new(g_str_hash, g_str_equal);
+		metrics_origin = g_get_monotonic_time();
+	}
+
+	metric = g_hash_table_lookup(metrics_table, name);
+	if (metric == NULL) {
+		metric = g_new0(Metric, 1);
+		metric->name = g_strdup(name);
+		metric->type = type;
+		g_hash_table_insert(metrics_table, metric->name, metric);
+	}
+
+	return metric;
+}
+
+static guint metrics_bucket(gint64 value)
+{
+	guint bucket = 0;
+
+	for (; value > 0 && bucket < METRICS_BUCKETS - 1; value >>= 1)
+		bucket++;
+
+	return bucket;
+}
+
+static void metrics_record(Metric *metric, gint64 value)
+{
+	if (metric->count == 0 || value < metric->min)
+		metric->min = value;
+	if (metric->count == 0 || value > metric->max)
+		metric->max = value;
+	metric->count++;
+	metric->sum += value;
+	metric->buckets[metrics_bucket(value)]++;
+}
+
+/* the number of the calling thread in the trace */
+static guint metrics_thread(void)
+{
+	GThread *self = g_thread_self();
+	guint i;
+
+	for (i = 0; i < metrics_threads_len; i++)
+		if (metrics_threads[i] == self)
+			return i + 1;
+
+	if (metrics_threads_len == METRICS_THREADS)
+		return 0;
+
+	metrics_threads[metrics_threads_len++] = self;
+	return metrics_threads_len;
+}
+
+void metrics_counter_add(const gchar *name, gint64 value)
+{
+	Metric *metric;
+
+	cm_return_if_fail(name != NULL);
+
+	G_LOCK(metrics);
+	metric = metrics_get(name, METRICS_COUNTER);
+	metric->count += value;
+	G_UNLOCK(metrics);
+}
+
+void metrics_histogram_record(const gchar *name, gint64 value)
+{
+	cm_return_if_fail(name != NULL);
+
+	G_LOCK(metrics);
+	metrics_record(metrics_get(name, METRICS_HISTOGRAM), value);
+	G_UNLOCK(metrics);
+}
+
+void metrics_span_begin_detail(MetricsSpan *span, const gchar *name,
+			       const gchar *detail)
+{
+	cm_return_if_fail(span != NULL);
+
+	span->name = name;
+	span->detail = detail;
+	span->start = g_get_monotonic_time();
+}
+
+void metrics_span_begin(MetricsSpan *span, const gchar *name)
+{
+	metrics_span_begin_detail(span, name, NULL);
+}
+
+/* metrics_span_end() - records the span, and returns its duration in
+ * microseconds */
+gint64 metrics_span_end(MetricsSpan *span)
+{
+	gint64 duration;
+	gchar *name = NULL;
+	Metric *metric;
+	MetricsEvent *event;
+
+	cm_return_val_if_fail(span != NULL, 0);
+	cm_return_val_if_fail(span->name != NULL, 0);
+
+	duration = g_get_monotonic_time() - span->start;
+
+	if (span->detail != NULL && *span->detail != '\0')
+		name = g_strconcat(span->name, ": ", span->detail, NULL);
+
+	G_LOCK(metrics);
+	metric = metrics_get(name ? name : span->name, METRICS_HISTOGRAM);
+	metrics_record(metric, duration);
+
+	if (metrics_events == NULL)
+		metrics_events = g_new(MetricsEvent, METRICS_EVENTS);
+	event = &metrics_events[metrics_events_next];
+	event->name = metric->name;
+	event->thread = metrics_thread();
+	event->start = span->start;
+	event->duration = duration;
+	metrics_events_next = (metrics_events_next + 1) % METRICS_EVENTS;
+	if (metrics_events_len < METRICS_EVENTS)
+		metrics_events_len++;
+	G_UNLOCK(metrics);
+
+	g_free(name);
+
+	return duration;
+}
+
+static gint64 metrics_percentile(Metric *metric, gint percent)
+{
+	gint64 rank, seen = 0;
+	guint i;
+
+	if (metric->count == 0)
+		return 0;
+
+	rank = (metric->count * percent + 99) / 100;
+	for (i = 0; i < METRICS_BUCKETS; i++) {
+		seen += metric->buckets[i];
+		if (seen >= rank)
+			break;
+	}
+	if (i == 0)
+		return metric->min;
+
+	/* the top of the bucket, within what was seen */
+	return CLAMP((i < 63 ? ((gint64)1 << i) - 1 : G_MAXINT64),
+		     metric->min, metric->max);
+}
+
+static gint metrics_compare_stat(gconstpointer a, gconstpointer b)
+{
+	return strcmp(((const MetricsStat *)a)->name,
+		      ((const MetricsStat *)b)->name);
+}
+
+static void metrics_add_stat(gpointer key, gpointer value, gpointer data)
+{
+	Metric *metric = (Metric *)value;
+	GSList **stats = (GSList **)data;
+	MetricsStat *stat;
+
+	stat = g_new0(MetricsStat, 1);
+	stat->name = g_strdup(metric->name);
+	stat->type = metric->type;
+	stat->count = metric->count;
+	stat->sum = metric->sum;
+	stat->min = metric->min;
+	stat->max = metric->max;
+	stat->p50 = metrics_percentile(metric, 50);
+	stat->p95 = metrics_percentile(metric, 95);
+	stat->p99 = metrics_percentile(metric, 99);
+
+	*stats = g_slist_prepend(*stats, stat);
+}
+
+/* metrics_get_stats() - returns a copy of all the metrics, by name, to
+ * be freed with metrics_free_stats() */
+GSList *metrics_get_stats(void)
+{
+	GSList *stats = NULL;
+
+	G_LOCK(metrics);
+	if (metrics_table != NULL)
+		g_hash_table_foreach(metrics_table, metrics_add_stat, &stats);
+	G_UNLOCK(metrics);
+
+	return g_slist_sort(stats, metrics_compare_stat);
+}
+
+void metrics_free_stats(GSList *stats)
+{
+	GSList *cur;
+
+	for (cur = stats; cur != NULL; cur = cur->next) {
+		MetricsStat *stat = (MetricsStat *)cur->data;
+
+		g_free(stat->name);
+		g_free(stat);
+	}
+	g_slist_free(stats);
+}
+
+static void metrics_reset_metric(gpointer key, gpointer value, gpointer data)
+{
+	Metric *metric = (Metric *)value;
+
+	/* the names stay, the trace may still point to them */
+	metric->count = metric->sum = metric->min = metric->max = 0;
+	memset(metric->buckets, 0, sizeof(metric->buckets));
+}
+
+/* metrics_reset() - sets all the metrics back to zero, and forgets the
+ * trace */
+void metrics_reset(void)
+{
+	G_LOCK(metrics);
+	if (metrics_table != NULL)
+		g_hash_table_foreach(metrics_table, metrics_reset_metric, NULL);
+	metrics_events_next = 0;
+	metrics_events_len = 0;
+	G_UNLOCK(metrics);
+}
+
+static void metrics_append_json_string(GString *str, const gchar *text)
+{
+	const gchar *p;
+
+	g_string_append_c(str, '"');
+	for (p = text; *p != '\0'; p++) {
+		switch (*p) {
+		case '"':
+			g_string_append(str, "\\\"");
+			break;
+		case '\\':
+			g_string_append(str, "\\\\");
+			break;
+		case '\n':
+			g_string_append(str, "\\n");
+			break;
+		case '\t':
+			g_string_append(str, "\\t");
+			break;
+		default:
+			if ((guchar)*p < 0x20)
+				g_string_append_printf(str, "\\u%04x", (guchar)*p);
+			else
+				g_string_append_c(str, *p);
+		}
+	}
+	g_string_append_c(str, '"');
+}
+
+/* metrics_to_json() - returns the metrics as a JSON object, with the
+ * counters and the histograms by name */
+gchar *metrics_to_json(void)
+{
+	GSList *stats, *cur;
+	GString *str;
+	gint64 uptime;
+	gboolean first;
+	gint pass;
+
+	stats = metrics_get_stats();
+	G_LOCK(metrics);
+	uptime = metrics_table ? g_get_monotonic_time() - metrics_origin : 0;
+	G_UNLOCK(metrics);
+
+	str = g_string_new("{\n");
+	g_string_append_printf(str, "  \"uptime_us\": %" G_GINT64_FORMAT ",\n",
+			       uptime);
+
+	for (pass = 0; pass < 2; pass++) {
+		MetricsType type = pass == 0 ? METRICS_COUNTER : METRICS_HISTOGRAM;
+
+		g_string_append(str, type == METRICS_COUNTER ?
+				"  \"counters\": {" : "  \"histograms\": {");
+		first = TRUE;
+		for (cur = stats; cur != NULL; cur = cur->next) {
+			MetricsStat *stat = (MetricsStat *)cur->data;
+
+			if (stat->type != type)
+				continue;
+
+			g_string_append(str, first ? "\n    " : ",\n    ");
+			first = FALSE;
+			metrics_append_json_string(str, stat->name);
+			if (type == METRICS_COUNTER) {
+				g_string_append_printf(str, ": %" G_GINT64_FORMAT,
+						       stat->count);
+				continue;
+			}
+			g_string_append_printf(str,
+				": {\"count\": %" G_GINT64_FORMAT
+				", \"sum\": %" G_GINT64_FORMAT
+				", \"min\": %" G_GINT64_FORMAT
+				", \"max\": %" G_GINT64_FORMAT
+				", \"p50\": %" G_GINT64_FORMAT
+				", \"p95\": %" G_GINT64_FORMAT
+				", \"p99\": %" G_GINT64_FORMAT "}",
+				stat->count, stat->sum, stat->min, stat->max,
+				stat->p50, stat->p95, stat->p99);
+		}
+		g_string_append(str, first ? "}" : "\n  }");
+		g_string_append(str, pass == 0 ? ",\n" : "\n");
+	}
+	g_string_append(str, "}\n");
+
+	metrics_free_stats(stats);
+
+	return g_string_free(str, FALSE);
+}
+
+/* metrics_to_chrome_trace() - returns the recent spans, and the current
+ * value of the counters, in the Trace Event Format of chrome://tracing */
+gchar *metrics_to_chrome_trace(void)
+{
+	GSList *stats, *cur;
+	GString *str;
+	gint64 now;
+	guint i;
+
+	stats = metrics_get_stats();
+
+	str = g_string_new("{\"traceEvents\": [\n");
+
+	G_LOCK(metrics);
+	now = g_get_monotonic_time() - metrics_origin;
+	for (i = 0; i < metrics_events_len; i++) {
+		MetricsEvent *event;
+
+		/* the oldest first */
+		event = &metrics_events[(metrics_events_next + METRICS_EVENTS
+					 - metrics_events_len + i) % METRICS_EVENTS];
+		g_string_append(str, "{\"name\": ");
+		metrics_append_json_string(str, event->name);
+		g_string_append_printf(str,
+			", \"cat\": \"claws\", \"ph\": \"X\""
+			", \"ts\": %" G_GINT64_FORMAT
+			", \"dur\": %" G_GINT64_FORMAT
+			", \"pid\": 1, \"tid\": %u},\n",
+			event->start - metrics_origin, event->duration,
+			event->thread);
+	}
+	G_UNLOCK(metrics);
+
+	for (cur = stats; cur != NULL; cur = cur->next) {
+		MetricsStat *stat = (MetricsStat *)cur->data;
+
+		if (stat->type != METRICS_COUNTER)
+			continue;
+		g_string_append(str, "{\"name\": ");
+		metrics_append_json_string(str, stat->name);
+		g_string_append_printf(str,
+			", \"cat\": \"claws\", \"ph\": \"C\""
+			", \"ts\": %" G_GINT64_FORMAT
+			", \"pid\": 1, \"args\": {\"value\": %" G_GINT64_FORMAT "}},\n",
+			now, stat->count);
+	}
+
+	/* an event without a trailing comma to end the list */
+	g_string_append(str,
+		"{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1"
+		", \"args\": {\"name\": \"Claws Mail\"}}\n"
+		"], \"displayTimeUnit\": \"ms\"}\n");
+
+	metrics_free_stats(stats);
+
+	return g_string_free(str, FALSE);
+}
@@ -0,0 +1,84 @@
+/*
+ * Claws Mail -- a GTK+ based, lightweight, and fast e-mail client
+ * Copyright (C) 2026 the Claws Mail team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+#include <glib.h>
+
+/* Metrics: counters, and histograms of values such as durations in
+ * microseconds, by name. A span times a piece of code with the
+ * monotonic clock: its duration goes to the histogram of its name, and
+ * to the recent events that make up the trace. All of them are always
+ * recorded, from any thread; they can be exported as JSON, or as a
+ * trace for chrome://tracing. */
+
+typedef struct _MetricsSpan	MetricsSpan;
+typedef struct _MetricsStat	MetricsStat;
+
+typedef enum
+{
+	METRICS_COUNTER,
+	METRICS_HISTOGRAM
+} MetricsType;
+
+/* On the stack of the code it times, nothing to free */
+struct _MetricsSpan
+{
+	const gchar *name;
+	/* added to the name if not NULL nor empty */
+	const gchar *detail;
+	gint64 start;
+};
+
+/* A copy of a metric, as got by metrics_get_stats() */
+struct _MetricsStat
+{
+	gchar *name;
+	MetricsType type;
+	/* the value of a counter, or the number of values */
+	gint64 count;
+	gint64 sum;
+	gint64 min;
+	gint64 max;
+	/* estimated from powers of two */
+	gint64 p50;
+	gint64 p95;
+	gint64 p99;
+};
+
+void metrics_counter_add		(const gchar	*name,
+					 gint64		 value);
+void metrics_histogram_record		(const gchar	*name,
+					 gint64		 value);
+
+void metrics_span_begin			(MetricsSpan	*span,
+					 const gchar	*name);
+void metrics_span_begin_detail		(MetricsSpan	*span,
+					 const gchar	*name,
+					 const gchar	*detail);
+gint64 metrics_span_end			(MetricsSpan	*span);
+
+GSList *metrics_get_stats		(void);
+void metrics_free_stats			(GSList		*stats);
+void metrics_reset			(void);
+
+gchar *metrics_to_json			(void);
+gchar *metrics_to_chrome_trace		(void);
+
+#endif /* __METRICS_H__ */
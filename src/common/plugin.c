@@ -586,6 +586,21 @@ static void replace_old_plugin_name(gchar *plugin_name)
 	}
 }
 
+/* reads the next file name of a plugins block, under its current name */
+static gboolean plugin_list_next(PrefFile *pfile, gchar *buf, gint len)
+{
+	while (claws_fgets(buf, len, pfile->fp) != NULL) {
+		if (buf[0] == '[')
+			return FALSE;
+
+		g_strstrip(buf);
+		replace_old_plugin_name(buf);
+		if (buf[0] != '\0')
+			return TRUE;
+	}
+	return FALSE;
+}
+
 void plugin_load_all(const gchar *type)
 {
 	gchar *rcpath;
@@ -606,14 +621,8 @@ void plugin_load_all(const gchar *type)
 	}
 	g_free(block);
 
-	while (claws_fgets(buf, sizeof(buf), pfile->fp) != NULL) {
-		if (buf[0] == '[')
-			break;
-
-		g_strstrip(buf);
-		replace_old_plugin_name(buf);
-
-		if ((buf[0] != '\0') && (plugin_load(buf, &error) == NULL)) {
+	while (plugin_list_next(pfile, buf, sizeof(buf))) {
+		if (plugin_load(buf, &error) == NULL) {
 			g_warning("plugin loading error: %s", error);
 			g_free(error);
 		}							
@@ -623,6 +632,97 @@ void plugin_load_all(const gchar *type)
 	g_free(rcpath);
 }
 
+/* reads the file, so that it is in the page cache when it is mapped */
+static gboolean plugin_prefetch_file(const gchar *filename)
+{
+	gchar buf[BUFFSIZE * 4];
+	FILE *fp;
+
+	if ((fp = claws_fopen(filename, "rb")) == NULL)
+		return FALSE;
+	while (claws_fread(buf, 1, sizeof(buf), fp) == sizeof(buf))
+		;
+	claws_fclose(fp);
+
+	return TRUE;
+}
+
+/* reads the plugin and its dependancies, from where plugin_load()
+ * finds them */
+static void plugin_prefetch(const gchar *filename)
+{
+	gchar *path, *tmp, *p, *deps_file;
+	gchar dep[BUFFSIZE];
+	FILE *fp;
+
+	if (is_file_exist(filename) ||
+	    plugin_filename_is_standard_dir(filename)) {
+		path = g_strdup(filename);
+	} else {
+		gchar *plugin_name = g_path_get_basename(filename);
+
+		path = g_strconcat(get_plugin_dir(), plugin_name, NULL);
+		g_free(plugin_name);
+	}
+
+	tmp = g_strdup(path);
+	if ((p = strrchr(tmp, '.')) != NULL)
+		*p = '\0';
+	deps_file = g_strconcat(tmp, ".deps", NULL);
+	g_free(tmp);
+	if ((fp = claws_fopen(deps_file, "rb")) != NULL) {
+		while (claws_fgets(dep, sizeof(dep), fp) != NULL) {
+			gchar *dep_path;
+
+			g_strstrip(dep);
+			if (dep[0] == '\0')
+				continue;
+			dep_path = g_strconcat(get_plugin_dir(), dep,
+					".", G_MODULE_SUFFIX, NULL);
+			plugin_prefetch(dep_path);
+			g_free(dep_path);
+		}
+		claws_fclose(fp);
+	}
+	g_free(deps_file);
+
+	if (!plugin_prefetch_file(path))
+		debug_print("couldn't prefetch %s\n", filename);
+	g_free(path);
+}
+
+/**
+ * Reads the files of the plugins of a type, and of their dependancies,
+ * so that plugin_load_all() doesn't wait for the disk. The modules are
+ * not opened: their constructors may use GTK+, which is only done from
+ * the main thread. Doesn't touch the list of plugins, so it can run in
+ * another thread than the one loading them.
+ *
+ * \param type The type of the plugins, as for plugin_load_all()
+ */
+void plugin_prefetch_all(const gchar *type)
+{
+	gchar *rcpath, *block;
+	gchar buf[BUFFSIZE];
+	PrefFile *pfile;
+
+	rcpath = g_strconcat(get_rc_dir(), G_DIR_SEPARATOR_S, COMMON_RC, NULL);
+	block = g_strconcat(PLUGINS_BLOCK_PREFIX, type, NULL);
+	pfile = prefs_read_open(rcpath);
+	g_free(rcpath);
+	if (pfile == NULL || prefs_set_block_label(pfile, block) < 0) {
+		g_free(block);
+		if (pfile)
+			prefs_file_close(pfile);
+		return;
+	}
+	g_free(block);
+
+	while (plugin_list_next(pfile, buf, sizeof(buf)))
+		plugin_prefetch(buf);
+	prefs_file_close(pfile);
+}
+
 void plugin_unload_all(const gchar *type)
 {
 	GSList *list, *cur;
@@ -56,6 +56,7 @@ Plugin *plugin_load		(const gchar	 *filename,
 void plugin_unload		(Plugin		 *plugin);
 void plugin_load_all		(const gchar	 *type);
 void plugin_unload_all		(const gchar	 *type);
+void plugin_prefetch_all	(const gchar	 *type);
 void plugin_save_list		(void);
 void plugin_load_standard_plugins (void);
 
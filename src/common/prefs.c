@@ -27,6 +27,9 @@
 #include "defs.h"
 
 #include <glib.h>
+#ifndef G_OS_WIN32
+#include <unistd.h>
+#endif
 
 #include "prefs.h"
 #include "utils.h"
@@ -174,7 +177,6 @@ gint prefs_file_close(PrefFile *pfile)
 		bakpath = g_strconcat(path, ".bak", NULL);
 #ifdef G_OS_WIN32
                 claws_unlink(bakpath);
-#endif
 		if (g_rename(path, bakpath) < 0) {
 			FILE_OP_ERROR(path, "rename");
 			claws_unlink(tmppath);
@@ -183,6 +185,20 @@ gint prefs_file_close(PrefFile *pfile)
 			g_free(bakpath);
 			return -1;
 		}
+#else
+		/* the file stays in place until the new one replaces it
+		 * at once, there's always one to read */
+		claws_unlink(bakpath);
+		if (link(path, bakpath) < 0 &&
+		    copy_file(path, bakpath, FALSE) < 0) {
+			FILE_OP_ERROR(path, "link");
+			claws_unlink(tmppath);
+			g_free(path);
+			g_free(tmppath);
+			g_free(bakpath);
+			return -1;
+		}
+#endif
 	}
 
 #ifdef G_OS_WIN32
@@ -31,6 +31,7 @@
 #endif
 #include <stdio.h>
 #include <string.h>
+#include <sys/stat.h>
 
 #include "smtp.h"
 #include "md5.h"
@@ -56,7 +57,71 @@ static gint smtp_ehlo_recv(SMTPSession *session, const gchar *msg);
 static gint smtp_helo(SMTPSession *session);
 static gint smtp_rcpt(SMTPSession *session);
 static gint smtp_data(SMTPSession *session);
-static gint smtp_send_data(SMTPSession *session);
+static gint smtp_send_data(SMTPSession *session)
+{
+	session->state = SMTP_SEND_DATA;
+
+	if (session->send_fp != NULL) {
+		session->send_fp_eof = FALSE;
+		session->send_data_sent = 0;
+		session->send_chunk_len = 0;
+		return smtp_send_chunk(session);
+	}
+
+	session_send_data(SESSION(session), session->send_data,
+			  session->send_data_len);
+
+	return SM_OK;
+}
+
+/* Sends the chunk of send_fp after the one just sent, or ends the
+ * message when there is none left */
+static gint smtp_send_chunk(SMTPSession *session)
+{
+	GString *chunk;
+
+	session->send_data_sent += session->send_chunk_len;
+	session->send_chunk_len = 0;
+	if (session->send_fp_eof) {
+		/* the whole message has been sent, it is its real length */
+		session->send_data_len = session->send_data_sent;
+		return smtp_eom(session);
+	}
+
+	chunk = g_string_sized_new(SMTP_SEND_CHUNK_SIZE + MESSAGEBUFSIZE);
+	session->send_fp_eof = !get_outgoing_rfc2822_chunk(session->send_fp,
+				chunk, SMTP_SEND_CHUNK_SIZE,
+				&session->send_fp_in_body);
+	g_free(session->send_data);
+	session->send_chunk_len = chunk->len;
+	session->send_data = (guchar *)g_string_free(chunk, FALSE);
+
+	if (session->send_chunk_len == 0) {
+		session->send_data_len = session->send_data_sent;
+		return smtp_eom(session);
+	}
+	if (session->send_data_sent + session->send_chunk_len >
+	    session->send_data_len)
+		session->send_data_len = session->send_data_sent +
+					 session->send_chunk_len;
+
+	session_send_data(SESSION(session), session->send_data,
+			  session->send_chunk_len);
+
+	return SM_OK;
+}
+
+static gboolean smtp_send_chunk_idle(gpointer data)
+{
+	SMTPSession *session = SMTP_SESSION(data);
+
+	session->send_chunk_tag = 0;
+	if (smtp_send_chunk(session) != SM_OK)
+		session->error_val = SM_ERROR;
+
+	return FALSE;
+}
+
 static gint smtp_make_ready(SMTPSession *session);
 static gint smtp_eom(SMTPSession *session);
 
@@ -97,6 +162,12 @@ Session *smtp_session_new(void *prefs_account)
 
 	session->send_data                 = NULL;
 	session->send_data_len             = 0;
+	session->send_fp                   = NULL;
+	session->send_fp_in_body           = FALSE;
+	session->send_fp_eof               = FALSE;
+	session->send_data_sent            = 0;
+	session->send_chunk_len            = 0;
+	session->send_chunk_tag            = 0;
 
 	session->max_message_size          = -1;
 
@@ -121,10 +192,47 @@ static void smtp_session_destroy(Session *session)
 	g_free(smtp_session->from);
 
 	g_free(smtp_session->send_data);
+	if (smtp_session->send_chunk_tag > 0)
+		g_source_remove(smtp_session->send_chunk_tag);
 
 	g_free(smtp_session->error_msg);
 }
 
+/* smtp_set_send_fp() - makes the session send the message in fp, from
+ * its current position, reading it chunk by chunk as it is sent instead
+ * of holding all of it in memory. fp must be left open until the
+ * message is sent. */
+gint smtp_set_send_fp(SMTPSession *session, FILE *fp)
+{
+	struct stat s;
+	long pos;
+
+	cm_return_val_if_fail(fp != NULL, -1);
+
+	/* The file is only read once, as it is sent, so SIZE and the
+	 * progress go by its length; CRLF line endings and dot-stuffing
+	 * make the message a little longer than that */
+	if ((pos = ftell(fp)) < 0) {
+		perror("ftell");
+		return -1;
+	}
+	if (fstat(fileno(fp), &s) < 0) {
+		perror("fstat");
+		return -1;
+	}
+
+	g_free(session->send_data);
+	session->send_data = NULL;
+	session->send_data_len = s.st_size > pos ? s.st_size - pos : 0;
+	session->send_fp = fp;
+	session->send_fp_in_body = FALSE;
+	session->send_fp_eof = FALSE;
+	session->send_data_sent = 0;
+	session->send_chunk_len = 0;
+
+	return 0;
+}
+
 gint smtp_from(SMTPSession *session)
 {
 	gchar buf[MESSAGEBUFSIZE];
@@ -502,12 +610,48 @@ static gint smtp_send_data(SMTPSession *session)
 {
 	session->state = SMTP_SEND_DATA;
 
+	if (session->send_fp != NULL) {
+		session->send_data_sent = 0;
+		session->send_chunk_len = 0;
+		return smtp_send_chunk(session);
+	}
+
 	session_send_data(SESSION(session), session->send_data,
 			  session->send_data_len);
 
 	return SM_OK;
 }
 
+/* Sends the chunk of send_fp after the one just sent, or ends the
+ * message when there is none left */
+static gint smtp_send_chunk(SMTPSession *session)
+{
+	GString *chunk;
+
+	session->send_data_sent += session->send_chunk_len;
+	if (session->send_data_sent >= session->send_data_len)
+		return smtp_eom(session);
+
+	chunk = g_string_sized_new(SMTP_SEND_CHUNK_SIZE + MESSAGEBUFSIZE);
+	get_outgoing_rfc2822_chunk(session->send_fp, chunk,
+				   SMTP_SEND_CHUNK_SIZE,
+				   &session->send_fp_in_body);
+	g_free(session->send_data);
+	session->send_chunk_len = chunk->len;
+	session->send_data = (guchar *)g_string_free(chunk, FALSE);
+
+	if (session->send_chunk_len == 0) {
+		/* the file got shorter */
+		g_warning("message to send is shorter than expected");
+		return smtp_eom(session);
+	}
+
+	session_send_data(SESSION(session), session->send_data,
+			  session->send_chunk_len);
+
+	return SM_OK;
+}
+
 static gint smtp_make_ready(SMTPSession *session)
 {
 	session->state = SMTP_MAIL_SENT_OK;
@@ -722,5 +866,19 @@ static gint smtp_session_recv_msg(Session *session, const gchar *msg)
 
 static gint smtp_session_send_data_finished(Session *session, guint len)
 {
-	return smtp_eom(SMTP_SESSION(session));
+	SMTPSession *smtp_session = SMTP_SESSION(session);
+
+	if (smtp_session->send_fp == NULL)
+		return smtp_eom(smtp_session);
+
+	if (smtp_session->send_fp_eof)
+		return smtp_send_chunk(smtp_session);
+
+	/* A chunk may be written at once; sending the next one from here
+	 * would nest the writes, and the notifications, of all of them */
+	if (smtp_session->send_chunk_tag == 0)
+		smtp_session->send_chunk_tag =
+			g_idle_add(smtp_send_chunk_idle, smtp_session);
+
+	return 0;
 }
@@ -33,6 +33,8 @@ typedef struct _SMTPSession	SMTPSession;
 #define SMTP_SESSION(obj)	((SMTPSession *)obj)
 
 #define MESSAGEBUFSIZE		8192
+/* how much of a message smtp_set_send_fp() reads at a time */
+#define SMTP_SEND_CHUNK_SIZE	(1024 * 1024)
 
 typedef enum
 {
@@ -106,6 +108,18 @@ struct _SMTPSession
 
 	guchar *send_data;
 	guint send_data_len;
+	/* With smtp_set_send_fp(), the message is read from send_fp as it
+	 * is sent: send_data holds the chunk being sent, which starts at
+	 * send_data_sent and is send_chunk_len long. send_data_len is the
+	 * estimated length of the whole message until it has all been
+	 * sent, and send_fp_eof is set once the last chunk is read. The
+	 * next chunk is sent from send_chunk_tag, an idle source. */
+	FILE *send_fp;
+	gboolean send_fp_in_body;
+	gboolean send_fp_eof;
+	guint send_data_sent;
+	guint send_chunk_len;
+	guint send_chunk_tag;
 
 	gint max_message_size;
 
@@ -126,6 +140,7 @@ struct _SMTPSession
 };
 
 Session *smtp_session_new	(void *prefs_account);
+gint smtp_set_send_fp(SMTPSession *session, FILE *fp);
 gint smtp_from(SMTPSession *session);
 gint smtp_quit(SMTPSession *session);
 
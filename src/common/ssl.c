@@ -28,14 +28,17 @@
 #include <stdlib.h>
 #include <glib.h>
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 #include <errno.h>
 #include <pthread.h>
 
 #include "claws.h"
 #include "utils.h"
 #include "ssl.h"
+#include "ssl_cache.h"
 #include "ssl_certificate.h"
 #include "hooks.h"
+#include "log.h"
 
 #if GNUTLS_VERSION_NUMBER <= 0x020b00
 #include <gcrypt.h>
@@ -265,9 +268,94 @@ void ssl_init(void)
 
 void ssl_done(void)
 {
+	ssl_cache_done();
 	gnutls_global_deinit();
 }
 
+static void ssl_credentials_setup(gnutls_certificate_credentials_t xcred)
+{
+	gnutls_certificate_set_verify_flags (xcred, GNUTLS_VERIFY_ALLOW_X509_V1_CA_CRT);
+
+#if GNUTLS_VERSION_NUMBER < 0x030000
+#  if GNUTLS_VERSION_NUMBER <= 0x020c00
+	gnutls_certificate_client_set_retrieve_function(xcred, gnutls_client_cert_cb);
+#  else
+	gnutls_certificate_set_retrieve_function(xcred, gnutls_cert_cb);
+#  endif
+#else
+	debug_print("setting certificate callback function\n");
+	gnutls_certificate_set_retrieve_function2(xcred, gnutls_cert_cb);
+#endif
+}
+
+/* Returns a new reference to the shared credentials, loading them
+ * again if the CA bundle changed since they were. */
+static gnutls_certificate_credentials_t ssl_credentials_get(void)
+{
+	return ssl_cache_credentials_get(claws_ssl_get_cert_file(),
+					 ssl_credentials_setup);
+}
+
+/* Loads the CA certificates ahead of the first connection; they are
+ * kept for the connections to come. Can be called from any thread. */
+void ssl_preload_credentials(void)
+{
+	gnutls_certificate_credentials_t xcred = ssl_credentials_get();
+
+	if (xcred != NULL)
+		ssl_cache_credentials_unref(xcred);
+}
+
+static gchar *ssl_session_key(SockInfo *sockinfo)
+{
+	if (sockinfo->hostname == NULL)
+		return NULL;
+
+	/* Resuming skips client certificate authentication, so sessions
+	 * are not shared between accounts */
+	return g_strdup_printf("%p %s:%d", sockinfo->account,
+			sockinfo->hostname, sockinfo->port);
+}
+
+static void ssl_session_restore(SockInfo *sockinfo, gnutls_session_t session)
+{
+	gchar *key = ssl_session_key(sockinfo);
+
+	if (key == NULL)
+		return;
+
+	ssl_cache_session_restore(key, session);
+	g_free(key);
+}
+
+/* Remembers the session for the next connection. With TLS 1.3, the
+ * server sends the tickets after the handshake, so this is done again
+ * when the connection is closed. */
+static void ssl_session_save(SockInfo *sockinfo, gnutls_session_t session)
+{
+	gchar *key = ssl_session_key(sockinfo);
+
+	if (key == NULL)
+		return;
+
+	ssl_cache_session_save(key, session);
+	g_free(key);
+}
+
+static void ssl_session_count(SockInfo *sockinfo, gnutls_session_t session)
+{
+	gboolean resumed = gnutls_session_is_resumed(session);
+	guint full, res;
+
+	ssl_cache_session_count(resumed, &full, &res);
+
+	log_print(LOG_PROTOCOL, resumed
+			? _("TLS session with %s:%d resumed (%u full, %u resumed handshakes so far)\n")
+			: _("TLS session with %s:%d established (%u full, %u resumed handshakes so far)\n"),
+			sockinfo->hostname ? sockinfo->hostname : "?",
+			sockinfo->port, full, res);
+}
+
 #ifdef USE_PTHREAD
 static void *SSL_connect_thread(void *data)
 {
@@ -392,12 +480,14 @@ gboolean ssl_init_socket(SockInfo *sockinfo)
 	gnutls_x509_crt_t *certs = NULL;
 	gnutls_certificate_credentials_t xcred;
 
-	if (gnutls_certificate_allocate_credentials (&xcred) != 0)
+	if ((xcred = ssl_credentials_get()) == NULL)
 		return FALSE;
 
 	r = gnutls_init(&session, GNUTLS_CLIENT);
-	if (session == NULL || r != 0)
+	if (session == NULL || r != 0) {
+		ssl_cache_credentials_unref(xcred);
 		return FALSE;
+	}
 
 	if (sockinfo->gnutls_priority && strlen(sockinfo->gnutls_priority)) {
 		r = gnutls_priority_set_direct(session, sockinfo->gnutls_priority, NULL);
@@ -426,31 +516,11 @@ gboolean ssl_init_socket(SockInfo *sockinfo)
 
 	gnutls_credentials_set(session, GNUTLS_CRD_CERTIFICATE, xcred);
 
-	if (claws_ssl_get_cert_file()) {
-		r = gnutls_certificate_set_x509_trust_file(xcred, claws_ssl_get_cert_file(),  GNUTLS_X509_FMT_PEM);
-		if (r < 0)
-			g_warning("Can't read SSL_CERT_FILE '%s': %s",
-				claws_ssl_get_cert_file(), 
-				gnutls_strerror(r));
-	} else {
-		debug_print("Can't find SSL ca-certificates file\n");
-	}
-	gnutls_certificate_set_verify_flags (xcred, GNUTLS_VERIFY_ALLOW_X509_V1_CA_CRT);
-
 	gnutls_transport_set_ptr(session, (gnutls_transport_ptr_t) GINT_TO_POINTER(sockinfo->sock));
 
 	gnutls_session_set_ptr(session, sockinfo);
 
-#if GNUTLS_VERSION_NUMBER < 0x030000
-#  if GNUTLS_VERSION_NUMBER <= 0x020c00
-	gnutls_certificate_client_set_retrieve_function(xcred, gnutls_client_cert_cb);
-#  else
-	gnutls_certificate_set_retrieve_function(xcred, gnutls_cert_cb);
-#  endif
-#else
-	debug_print("setting certificate callback function\n");
-	gnutls_certificate_set_retrieve_function2(xcred, gnutls_cert_cb);
-#endif
+	ssl_session_restore(sockinfo, session);
 
 #if GNUTLS_VERSION_NUMBER < 0x030107
 	/* Starting from GnuTLS 3.1.7, minimal size of the DH prime is
@@ -461,33 +531,41 @@ gboolean ssl_init_socket(SockInfo *sockinfo)
 
 	if ((r = SSL_connect_nb(session)) < 0) {
 		g_warning("SSL/TLS connection failed (%s)", gnutls_strerror(r));
-		gnutls_certificate_free_credentials(xcred);
+		ssl_cache_credentials_unref(xcred);
 		gnutls_deinit(session);
 		return FALSE;
 	}
 
+	ssl_session_count(sockinfo, session);
+
 	/* Get server's certificate (note: beware of dynamic allocation) */
 	certs = ssl_get_certificate_chain(session, &cert_list_length);
 
 	if (!certs) {
-		gnutls_certificate_free_credentials(xcred);
-		gnutls_deinit(session);
-		return FALSE;
-	}
+		/* Sessions are only saved once their certificates were
+		 * accepted, so a resumed one may not carry them */
+		if (!gnutls_session_is_resumed(session)) {
+			ssl_cache_credentials_unref(xcred);
+			gnutls_deinit(session);
+			return FALSE;
+		}
+	} else {
+		if (!ssl_certificate_check_chain(certs, cert_list_length, sockinfo->hostname, sockinfo->port,
+						 sockinfo->ssl_cert_auto_accept)) {
+			for (i = 0; i < cert_list_length; i++)
+				gnutls_x509_crt_deinit(certs[i]);
+			g_free(certs);
+			ssl_cache_credentials_unref(xcred);
+			gnutls_deinit(session);
+			return FALSE;
+		}
 
-	if (!ssl_certificate_check_chain(certs, cert_list_length, sockinfo->hostname, sockinfo->port,
-					 sockinfo->ssl_cert_auto_accept)) {
 		for (i = 0; i < cert_list_length; i++)
 			gnutls_x509_crt_deinit(certs[i]);
 		g_free(certs);
-		gnutls_certificate_free_credentials(xcred);
-		gnutls_deinit(session);
-		return FALSE;
 	}
 
-	for (i = 0; i < cert_list_length; i++)
-		gnutls_x509_crt_deinit(certs[i]);
-	g_free(certs);
+	ssl_session_save(sockinfo, session);
 
 	sockinfo->ssl = session;
 	sockinfo->xcred = xcred;
@@ -497,8 +575,9 @@ gboolean ssl_init_socket(SockInfo *sockinfo)
 void ssl_done_socket(SockInfo *sockinfo)
 {
 	if (sockinfo && sockinfo->ssl) {
+		ssl_session_save(sockinfo, sockinfo->ssl);
 		if (sockinfo->xcred)
-			gnutls_certificate_free_credentials(sockinfo->xcred);
+			ssl_cache_credentials_unref(sockinfo->xcred);
 		gnutls_deinit(sockinfo->ssl);
 #if GNUTLS_VERSION_NUMBER < 0x030000
 		if (sockinfo->client_crt)
@@ -43,6 +43,7 @@ typedef enum {
 
 void ssl_init				(void);
 void ssl_done				(void);
+void ssl_preload_credentials		(void);
 gboolean ssl_init_socket		(SockInfo	*sockinfo);
 void ssl_done_socket			(SockInfo	*sockinfo);
 
@@ -0,0 +1,234 @@
+/*
+ * Claws Mail -- a GTK+ based, lightweight, and fast e-mail client
+ * Copyright (C) 2026 the Claws Mail team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#include "claws-features.h"
+#endif
+
+#ifdef USE_GNUTLS
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "utils.h"
+#include "ssl_cache.h"
+
+/* Certificate credentials shared by all connections, so that the CA
+ * bundle is only parsed again when it changes. Each connection holds
+ * a reference on the credentials it was set up with, as does the cache
+ * on the current ones; they are freed with the last one. */
+static gnutls_certificate_credentials_t shared_xcred = NULL;
+static gchar *shared_cert_file = NULL;
+static time_t shared_cert_mtime = 0;
+static goffset shared_cert_size = 0;
+static GHashTable *xcred_refs = NULL;
+G_LOCK_DEFINE_STATIC(ssl_credentials);
+
+/* Session data of the last connection to each server, to resume them
+ * without a full handshake */
+static GHashTable *session_cache = NULL;
+static guint full_handshakes = 0;
+static guint resumed_handshakes = 0;
+G_LOCK_DEFINE_STATIC(ssl_sessions);
+
+/* must be called with the ssl_credentials lock held */
+static void ssl_cache_credentials_unref_locked(gnutls_certificate_credentials_t xcred)
+{
+	gint refs = GPOINTER_TO_INT(g_hash_table_lookup(xcred_refs, xcred));
+
+	if (--refs > 0) {
+		g_hash_table_insert(xcred_refs, xcred, GINT_TO_POINTER(refs));
+		return;
+	}
+
+	g_hash_table_remove(xcred_refs, xcred);
+	gnutls_certificate_free_credentials(xcred);
+}
+
+void ssl_cache_credentials_unref(gnutls_certificate_credentials_t xcred)
+{
+	cm_return_if_fail(xcred != NULL);
+
+	G_LOCK(ssl_credentials);
+	if (xcred_refs != NULL && g_hash_table_lookup(xcred_refs, xcred) != NULL)
+		ssl_cache_credentials_unref_locked(xcred);
+	else
+		g_warning("unreferencing unknown TLS credentials %p", xcred);
+	G_UNLOCK(ssl_credentials);
+}
+
+/**
+ * Returns a new reference to the shared credentials, loading them
+ * again if cert_file, the CA bundle, changed since they were.
+ * Connections still using the old ones keep them until they release
+ * them with ssl_cache_credentials_unref().
+ */
+gnutls_certificate_credentials_t ssl_cache_credentials_get(const gchar *cert_file,
+		SSLCredentialsSetupFunc setup)
+{
+	gnutls_certificate_credentials_t xcred;
+	time_t mtime = 0;
+	goffset size = 0;
+	GStatBuf s;
+	int r;
+
+	if (cert_file != NULL && g_stat(cert_file, &s) == 0) {
+		mtime = s.st_mtime;
+		size = s.st_size;
+	}
+
+	G_LOCK(ssl_credentials);
+
+	if (xcred_refs == NULL)
+		xcred_refs = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+	if (shared_xcred != NULL &&
+			g_strcmp0(cert_file, shared_cert_file) == 0 &&
+			mtime == shared_cert_mtime && size == shared_cert_size) {
+		xcred = shared_xcred;
+		goto out;
+	}
+
+	if (gnutls_certificate_allocate_credentials(&xcred) != 0) {
+		G_UNLOCK(ssl_credentials);
+		return NULL;
+	}
+
+	if (cert_file != NULL) {
+		debug_print("Loading SSL ca-certificates from '%s'\n", cert_file);
+		r = gnutls_certificate_set_x509_trust_file(xcred, cert_file, GNUTLS_X509_FMT_PEM);
+		if (r < 0)
+			g_warning("Can't read SSL_CERT_FILE '%s': %s",
+				cert_file,
+				gnutls_strerror(r));
+	} else {
+		debug_print("Can't find SSL ca-certificates file\n");
+	}
+	if (setup != NULL)
+		setup(xcred);
+
+	if (shared_xcred != NULL)
+		ssl_cache_credentials_unref_locked(shared_xcred);
+
+	shared_xcred = xcred;
+	g_free(shared_cert_file);
+	shared_cert_file = g_strdup(cert_file);
+	shared_cert_mtime = mtime;
+	shared_cert_size = size;
+	g_hash_table_insert(xcred_refs, xcred, GINT_TO_POINTER(1));
+
+out:
+	g_hash_table_insert(xcred_refs, xcred, GINT_TO_POINTER(
+			GPOINTER_TO_INT(g_hash_table_lookup(xcred_refs, xcred)) + 1));
+	G_UNLOCK(ssl_credentials);
+
+	return xcred;
+}
+
+/* Lets session resume the last session saved under key, if any */
+void ssl_cache_session_restore(const gchar *key, gnutls_session_t session)
+{
+	GByteArray *data;
+
+	cm_return_if_fail(key != NULL);
+
+	G_LOCK(ssl_sessions);
+	if (session_cache != NULL &&
+			(data = g_hash_table_lookup(session_cache, key)) != NULL) {
+		debug_print("Trying to resume TLS session with %s\n", key);
+		gnutls_session_set_data(session, data->data, data->len);
+	}
+	G_UNLOCK(ssl_sessions);
+}
+
+/* Remembers session under key for the next connection */
+void ssl_cache_session_save(const gchar *key, gnutls_session_t session)
+{
+	gnutls_datum_t datum;
+	GByteArray *data;
+
+	cm_return_if_fail(key != NULL);
+
+	if (gnutls_session_get_data2(session, &datum) < 0)
+		return;
+
+	data = g_byte_array_sized_new(datum.size);
+	g_byte_array_append(data, datum.data, datum.size);
+	gnutls_free(datum.data);
+
+	G_LOCK(ssl_sessions);
+	if (session_cache == NULL)
+		session_cache = g_hash_table_new_full(g_str_hash, g_str_equal,
+				g_free, (GDestroyNotify)g_byte_array_unref);
+
+	if (g_hash_table_size(session_cache) >= SSL_SESSION_CACHE_MAX &&
+			g_hash_table_lookup(session_cache, key) == NULL) {
+		GHashTableIter iter;
+		gpointer old;
+
+		/* make room, any entry will do */
+		g_hash_table_iter_init(&iter, session_cache);
+		if (g_hash_table_iter_next(&iter, &old, NULL))
+			g_hash_table_iter_remove(&iter);
+	}
+	g_hash_table_replace(session_cache, g_strdup(key), data);
+	G_UNLOCK(ssl_sessions);
+}
+
+/* Counts a handshake, and returns the totals so far */
+void ssl_cache_session_count(gboolean resumed, guint *full,
+			     guint *resumed_total)
+{
+	G_LOCK(ssl_sessions);
+	if (resumed)
+		resumed_handshakes++;
+	else
+		full_handshakes++;
+	*full = full_handshakes;
+	*resumed_total = resumed_handshakes;
+	G_UNLOCK(ssl_sessions);
+}
+
+/**
+ * Drops the cache's own reference to the credentials, and the saved
+ * sessions. Connections still open keep their credentials, and the
+ * last one to close frees them.
+ */
+void ssl_cache_done(void)
+{
+	G_LOCK(ssl_credentials);
+	if (shared_xcred != NULL) {
+		ssl_cache_credentials_unref_locked(shared_xcred);
+		shared_xcred = NULL;
+	}
+	if (xcred_refs != NULL && g_hash_table_size(xcred_refs) == 0) {
+		g_hash_table_destroy(xcred_refs);
+		xcred_refs = NULL;
+	}
+	g_free(shared_cert_file);
+	shared_cert_file = NULL;
+	G_UNLOCK(ssl_credentials);
+
+	G_LOCK(ssl_sessions);
+	if (session_cache != NULL) {
+		g_hash_table_destroy(session_cache);
+		session_cache = NULL;
+	}
+	G_UNLOCK(ssl_sessions);
+}
+#endif /* USE_GNUTLS */
@@ -0,0 +1,53 @@
+/*
+ * Claws Mail -- a GTK+ based, lightweight, and fast e-mail client
+ * Copyright (C) 2026 the Claws Mail team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SSL_CACHE_H__
+#define __SSL_CACHE_H__
+
+#ifdef HAVE_CONFIG_H
+#include "claws-features.h"
+#endif
+
+#ifdef USE_GNUTLS
+#include <glib.h>
+
+#include <gnutls/gnutls.h>
+
+/* Maximum number of servers whose TLS session is kept for resumption */
+#define SSL_SESSION_CACHE_MAX 64
+
+/* Sets up newly loaded credentials, beyond their trusted CAs */
+typedef void (*SSLCredentialsSetupFunc)	(gnutls_certificate_credentials_t xcred);
+
+gnutls_certificate_credentials_t ssl_cache_credentials_get
+					(const gchar		*cert_file,
+					 SSLCredentialsSetupFunc setup);
+void ssl_cache_credentials_unref	(gnutls_certificate_credentials_t xcred);
+
+void ssl_cache_session_restore		(const gchar		*key,
+					 gnutls_session_t	 session);
+void ssl_cache_session_save		(const gchar		*key,
+					 gnutls_session_t	 session);
+void ssl_cache_session_count		(gboolean		 resumed,
+					 guint			*full,
+					 guint			*resumed_total);
+
+void ssl_cache_done			(void);
+#endif /* USE_GNUTLS */
+
+#endif /* __SSL_CACHE_H__ */
@@ -0,0 +1,329 @@
+/*
+ * Claws Mail -- a GTK+ based, lightweight, and fast e-mail client
+ * Copyright (C) 2026 the Claws Mail team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#include "claws-features.h"
+#endif
+
+#include <glib.h>
+#include <time.h>
+#ifdef G_OS_WIN32
+#include <windows.h>
+#endif
+
+#include "startup.h"
+#include "utils.h"
+
+struct _StartupPhase
+{
+	gchar *name;
+	GThread *thread;
+	/* the innermost phase of the same thread running when this one
+	 * began */
+	StartupPhase *parent;
+	/* begun by startup_task_run() */
+	gboolean task;
+
+	gint64 start;
+	gint64 end;
+	gint64 cpu_start;
+	gint64 cpu_end;
+};
+
+struct _StartupTask
+{
+	gchar *name;
+	StartupTaskFunc func;
+	gpointer data;
+
+	/* protected by mutex */
+	gboolean done;
+	gpointer result;
+
+	GMutex *mutex;
+	GCond *cond;
+};
+
+/* the recorded phases, in the order they began */
+static GPtrArray *startup_phases = NULL;
+static gboolean startup_trace_done = FALSE;
+G_LOCK_DEFINE_STATIC(startup_trace);
+
+static GThreadPool *startup_pool = NULL;
+
+/* CPU time used by the calling thread so far, in microseconds, or -1 if
+ * it can't be known */
+static gint64 startup_thread_cpu_time(void)
+{
+#ifdef G_OS_WIN32
+	FILETIME creation, exit, kernel, user;
+	ULARGE_INTEGER k, u;
+
+	if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+		return -1;
+	k.LowPart = kernel.dwLowDateTime;
+	k.HighPart = kernel.dwHighDateTime;
+	u.LowPart = user.dwLowDateTime;
+	u.HighPart = user.dwHighDateTime;
+	/* in 100ns units */
+	return (k.QuadPart + u.QuadPart) / 10;
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) < 0)
+		return -1;
+	return (gint64)ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+#else
+	return -1;
+#endif
+}
+
+static StartupPhase *startup_phase_begin_full(const gchar *name, gboolean task)
+{
+	StartupPhase *phase;
+	GThread *self = g_thread_self();
+	guint i;
+
+	cm_return_val_if_fail(name != NULL, NULL);
+
+	G_LOCK(startup_trace);
+	if (startup_trace_done) {
+		G_UNLOCK(startup_trace);
+		return NULL;
+	}
+	if (startup_phases == NULL)
+		startup_phases = g_ptr_array_new();
+
+	phase = g_new0(StartupPhase, 1);
+	phase->name = g_strdup(name);
+	phase->thread = self;
+	phase->task = task;
+	for (i = startup_phases->len; i > 0; i--) {
+		StartupPhase *p = g_ptr_array_index(startup_phases, i - 1);
+
+		if (p->thread == self && p->end == 0) {
+			phase->parent = p;
+			break;
+		}
+	}
+	g_ptr_array_add(startup_phases, phase);
+	G_UNLOCK(startup_trace);
+
+	phase->cpu_start = startup_thread_cpu_time();
+	phase->start = g_get_monotonic_time();
+
+	return phase;
+}
+
+/* startup_phase_begin() - starts timing a phase of startup, until
+ * startup_phase_end(). Returns NULL when startup is over. */
+StartupPhase *startup_phase_begin(const gchar *name)
+{
+	return startup_phase_begin_full(name, FALSE);
+}
+
+void startup_phase_end(StartupPhase *phase)
+{
+	gint64 end, cpu_end;
+
+	if (phase == NULL)
+		return;
+
+	end = g_get_monotonic_time();
+	cpu_end = startup_thread_cpu_time();
+
+	G_LOCK(startup_trace);
+	/* phases are freed by startup_trace_dump(), ending one after it
+	 * is harmless */
+	if (!startup_trace_done) {
+		phase->end = MAX(end, phase->start + 1);
+		phase->cpu_end = cpu_end;
+	}
+	G_UNLOCK(startup_trace);
+}
+
+static gint startup_phase_depth(StartupPhase *phase)
+{
+	gint depth = 0;
+
+	for (; phase->parent != NULL; phase = phase->parent)
+		depth++;
+
+	return depth;
+}
+
+static const gchar *startup_phase_thread_name(StartupPhase *phase)
+{
+	while (phase->parent != NULL)
+		phase = phase->parent;
+
+	return phase->task ? phase->name : "main";
+}
+
+/* startup_trace_dump() - prints the recorded phases and stops
+ * recording. */
+void startup_trace_dump(void)
+{
+	GPtrArray *phases;
+	gint64 origin;
+	guint i;
+
+	G_LOCK(startup_trace);
+	phases = startup_phases;
+	startup_phases = NULL;
+	startup_trace_done = TRUE;
+	G_UNLOCK(startup_trace);
+
+	if (phases == NULL)
+		return;
+
+	origin = ((StartupPhase *)g_ptr_array_index(phases, 0))->start;
+
+	debug_print("startup trace (ms): start, wall, cpu, thread, phase\n");
+	for (i = 0; i < phases->len; i++) {
+		StartupPhase *phase = g_ptr_array_index(phases, i);
+		gchar *cpu;
+
+		if (phase->end == 0) {
+			debug_print("%8.1f %8s %8s  %-12s %*s%s (not ended)\n",
+				    (phase->start - origin) / 1000.0, "", "",
+				    startup_phase_thread_name(phase),
+				    2 * startup_phase_depth(phase), "",
+				    phase->name);
+			continue;
+		}
+
+		if (phase->cpu_start >= 0 && phase->cpu_end >= 0)
+			cpu = g_strdup_printf("%.1f",
+				(phase->cpu_end - phase->cpu_start) / 1000.0);
+		else
+			cpu = g_strdup("-");
+		debug_print("%8.1f %8.1f %8s  %-12s %*s%s\n",
+			    (phase->start - origin) / 1000.0,
+			    (phase->end - phase->start) / 1000.0, cpu,
+			    startup_phase_thread_name(phase),
+			    2 * startup_phase_depth(phase), "",
+			    phase->name);
+		g_free(cpu);
+	}
+
+	for (i = 0; i < phases->len; i++) {
+		StartupPhase *phase = g_ptr_array_index(phases, i);
+
+		g_free(phase->name);
+		g_free(phase);
+	}
+	g_ptr_array_free(phases, TRUE);
+}
+
+static void startup_task_func(gpointer data, gpointer user_data)
+{
+	StartupTask *task = (StartupTask *)data;
+	StartupPhase *phase;
+	gpointer result;
+
+	phase = startup_phase_begin_full(task->name, TRUE);
+	result = task->func(task->data);
+	startup_phase_end(phase);
+
+	g_mutex_lock(task->mutex);
+	task->result = result;
+	task->done = TRUE;
+	g_cond_signal(task->cond);
+	g_mutex_unlock(task->mutex);
+}
+
+/* startup_task_run() - runs func(data) in a worker thread. Its result
+ * is got with startup_task_wait(), which must be called for every
+ * task. If no thread can be started, func is run right away. */
+StartupTask *startup_task_run(const gchar *name, StartupTaskFunc func,
+			      gpointer data)
+{
+	StartupTask *task;
+	GError *error = NULL;
+
+	cm_return_val_if_fail(name != NULL, NULL);
+	cm_return_val_if_fail(func != NULL, NULL);
+
+	task = g_new0(StartupTask, 1);
+	task->name = g_strdup(name);
+	task->func = func;
+	task->data = data;
+	task->mutex = cm_mutex_new();
+#if !GLIB_CHECK_VERSION(2,32,0)
+	task->cond = g_cond_new();
+#else
+	task->cond = g_new0(GCond, 1);
+	g_cond_init(task->cond);
+#endif
+
+	if (startup_pool == NULL) {
+		/* the tasks mostly wait for the disk, one thread each */
+		startup_pool = g_thread_pool_new(startup_task_func, NULL,
+				-1, FALSE, &error);
+		if (startup_pool == NULL) {
+			g_warning("couldn't create startup threads: %s",
+				  error ? error->message : "unknown error");
+			if (error)
+				g_error_free(error);
+		}
+	}
+
+	if (startup_pool != NULL)
+		g_thread_pool_push(startup_pool, task, NULL);
+	else
+		startup_task_func(task, NULL);
+
+	return task;
+}
+
+/* startup_task_wait() - waits for task to be done, frees it, and
+ * returns the result of its function. */
+gpointer startup_task_wait(StartupTask *task)
+{
+	StartupPhase *phase = NULL;
+	gpointer result;
+	gchar *name;
+
+	cm_return_val_if_fail(task != NULL, NULL);
+
+	g_mutex_lock(task->mutex);
+	if (!task->done) {
+		name = g_strconcat("waiting for ", task->name, NULL);
+		phase = startup_phase_begin(name);
+		g_free(name);
+	}
+	while (!task->done)
+		g_cond_wait(task->cond, task->mutex);
+	result = task->result;
+	g_mutex_unlock(task->mutex);
+	startup_phase_end(phase);
+
+	g_free(task->name);
+#if !GLIB_CHECK_VERSION(2,32,0)
+	g_cond_free(task->cond);
+#else
+	g_cond_clear(task->cond);
+	g_free(task->cond);
+#endif
+	cm_mutex_free(task->mutex);
+	g_free(task);
+
+	return result;
+}
@@ -0,0 +1,49 @@
+/*
+ * Claws Mail -- a GTK+ based, lightweight, and fast e-mail client
+ * Copyright (C) 2026 the Claws Mail team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __STARTUP_H__
+#define __STARTUP_H__
+
+#include <glib.h>
+
+/* Startup trace: the phases of startup are recorded with their wall
+ * and CPU time, nested when begun while another one of the same thread
+ * is running, and dumped to the debug output once startup is done.
+ * Phases begun after that are not recorded.
+ *
+ * Startup tasks: the parts of startup that don't depend on each other
+ * nor on the interface are run in worker threads. The main thread waits
+ * for each one before the first thing that needs its result; that wait
+ * is recorded in the trace too. */
+
+typedef struct _StartupPhase	StartupPhase;
+typedef struct _StartupTask	StartupTask;
+
+typedef gpointer (*StartupTaskFunc)	(gpointer	 data);
+
+StartupPhase *startup_phase_begin	(const gchar	*name);
+void startup_phase_end			(StartupPhase	*phase);
+
+void startup_trace_dump			(void);
+
+StartupTask *startup_task_run		(const gchar	*name,
+					 StartupTaskFunc func,
+					 gpointer	 data);
+gpointer startup_task_wait		(StartupTask	*task);
+
+#endif /* __STARTUP_H__ */
@@ -0,0 +1,215 @@
+#include <glib.h>
+
+#include "hooks.h"
+
+#include "mock_prefs_common_get_use_shred.h"
+#include "mock_prefs_common_get_flush_metadata.h"
+
+typedef struct {
+	gconstpointer key;
+	guint flags;
+} TestSource;
+
+typedef struct {
+	GSList *seen;
+	const gchar *raise_on;
+	HooksList *list;
+} TestRecorder;
+
+static gpointer
+copy_source(gconstpointer source)
+{
+	TestSource *copy = g_new(TestSource, 1);
+
+	*copy = *(const TestSource *)source;
+	return copy;
+}
+
+static void
+merge_source(gpointer pending, gconstpointer source)
+{
+	((TestSource *)pending)->flags |= ((const TestSource *)source)->flags;
+}
+
+static gboolean
+record_source(gpointer source, gpointer data)
+{
+	TestRecorder *recorder = (TestRecorder *)data;
+
+	recorder->seen = g_slist_append(recorder->seen, copy_source(source));
+	return FALSE;
+}
+
+static void
+run_idle(void)
+{
+	while (g_main_context_iteration(NULL, FALSE))
+		;
+}
+
+static void
+test_hooks_coalesced(void)
+{
+	HooksList *list = hooks_get_list("test-coalesced");
+	TestRecorder recorder = { NULL, NULL, NULL };
+	gint key_a, key_b;
+	TestSource source;
+	TestSource *seen;
+	gulong id;
+
+	id = hooks_register_hook("test-coalesced", record_source, &recorder);
+	g_assert_true(hooks_get_list("test-coalesced") == list);
+
+	/* without coalescing, the events are delivered at once */
+	source.key = &key_a;
+	source.flags = 1;
+	hooks_invoke_coalesced(list, &key_a, &source);
+	g_assert_cmpuint(g_slist_length(recorder.seen), ==, 1);
+	g_slist_free_full(recorder.seen, g_free);
+	recorder.seen = NULL;
+
+	hooks_list_set_coalescing(list, copy_source, merge_source, g_free);
+
+	hooks_invoke_coalesced(list, &key_a, &source);
+	source.flags = 2;
+	hooks_invoke_coalesced(list, &key_a, &source);
+	source.key = &key_b;
+	source.flags = 4;
+	hooks_invoke_coalesced(list, &key_b, &source);
+	g_assert_null(recorder.seen);
+
+	/* one delivery per key, in the order of the first events */
+	run_idle();
+	g_assert_cmpuint(g_slist_length(recorder.seen), ==, 2);
+	seen = (TestSource *)recorder.seen->data;
+	g_assert_true(seen->key == &key_a);
+	g_assert_cmpuint(seen->flags, ==, 3);
+	seen = (TestSource *)recorder.seen->next->data;
+	g_assert_true(seen->key == &key_b);
+	g_assert_cmpuint(seen->flags, ==, 4);
+	g_slist_free_full(recorder.seen, g_free);
+	recorder.seen = NULL;
+
+	/* a cancelled event is never delivered */
+	hooks_invoke_coalesced(list, &key_b, &source);
+	hooks_cancel_coalesced(list, &key_b);
+	run_idle();
+	g_assert_null(recorder.seen);
+
+	/* once delivered, the next event for the key is a new one */
+	source.flags = 8;
+	hooks_invoke_coalesced(list, &key_b, &source);
+	run_idle();
+	g_assert_cmpuint(g_slist_length(recorder.seen), ==, 1);
+	g_assert_cmpuint(((TestSource *)recorder.seen->data)->flags, ==, 8);
+	g_slist_free_full(recorder.seen, g_free);
+
+	hooks_unregister_hook("test-coalesced", id);
+}
+
+static gboolean
+record_and_raise(gpointer source, gpointer data)
+{
+	TestRecorder *recorder = (TestRecorder *)data;
+
+	recorder->seen = g_slist_append(recorder->seen, g_strdup(source));
+	if (g_strcmp0(source, recorder->raise_on) == 0)
+		hooks_invoke_idle(recorder->list, g_strdup("raised"), g_free);
+	return FALSE;
+}
+
+static gpointer
+invoke_from_thread(gpointer data)
+{
+	hooks_invoke_idle((HooksList *)data, g_strdup("thread"), g_free);
+	return NULL;
+}
+
+static void
+test_hooks_idle(void)
+{
+	HooksList *list = hooks_get_list("test-idle");
+	TestRecorder recorder = { NULL, "second", list };
+	gulong id;
+
+	id = hooks_register_hook("test-idle", record_and_raise, &recorder);
+
+	hooks_invoke_idle(list, g_strdup("first"), g_free);
+	hooks_invoke_idle(list, g_strdup("second"), g_free);
+	g_thread_join(g_thread_new("hooks-test", invoke_from_thread, list));
+	g_assert_null(recorder.seen);
+
+	/* the event raised by the subscriber waits for the next round */
+	g_main_context_iteration(NULL, FALSE);
+	g_assert_cmpuint(g_slist_length(recorder.seen), ==, 3);
+	g_assert_cmpstr(recorder.seen->data, ==, "first");
+	g_assert_cmpstr(recorder.seen->next->data, ==, "second");
+	g_assert_cmpstr(recorder.seen->next->next->data, ==, "thread");
+
+	run_idle();
+	g_assert_cmpuint(g_slist_length(recorder.seen), ==, 4);
+	g_assert_cmpstr(g_slist_last(recorder.seen)->data, ==, "raised");
+
+	g_slist_free_full(recorder.seen, g_free);
+	hooks_unregister_hook("test-idle", id);
+}
+
+static gboolean
+do_nothing(gpointer source, gpointer data)
+{
+	return FALSE;
+}
+
+static void
+register_from_stats(const HooksStats *stats, gpointer data)
+{
+	GSList **ids = (GSList **)data;
+
+	/* the hooks can be used from the callback */
+	if (g_strcmp0(stats->hooklist_name, "test-stats") == 0)
+		*ids = g_slist_prepend(*ids, GUINT_TO_POINTER(
+			hooks_register_hook("test-stats-more", do_nothing, NULL)));
+}
+
+static void
+count_calls(const HooksStats *stats, gpointer data)
+{
+	if (g_strcmp0(stats->hooklist_name, "test-stats") == 0)
+		*(guint *)data += stats->calls;
+}
+
+static void
+test_hooks_stats(void)
+{
+	GSList *ids = NULL, *cur;
+	guint calls = 0;
+	gulong id;
+
+	id = hooks_register_hook("test-stats", do_nothing, NULL);
+	hooks_invoke("test-stats", NULL);
+	hooks_invoke("test-stats", NULL);
+
+	hooks_foreach_stats(count_calls, &calls);
+	g_assert_cmpuint(calls, ==, 2);
+
+	hooks_foreach_stats(register_from_stats, &ids);
+	g_assert_cmpuint(g_slist_length(ids), ==, 1);
+
+	for (cur = ids; cur != NULL; cur = cur->next)
+		hooks_unregister_hook("test-stats-more",
+				      GPOINTER_TO_UINT(cur->data));
+	g_slist_free(ids);
+	hooks_unregister_hook("test-stats", id);
+}
+
+int
+main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/common/hooks/coalesced", test_hooks_coalesced);
+	g_test_add_func("/common/hooks/idle", test_hooks_idle);
+	g_test_add_func("/common/hooks/stats", test_hooks_stats);
+
+	return g_test_run();
+}
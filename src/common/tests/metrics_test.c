@@ -0,0 +1,118 @@
+#include <string.h>
+#include <glib.h>
+
+#include "metrics.h"
+
+#include "mock_prefs_common_get_use_shred.h"
+#include "mock_prefs_common_get_flush_metadata.h"
+
+static MetricsStat *
+find_stat(GSList *stats, const gchar *name)
+{
+	for (; stats != NULL; stats = stats->next) {
+		MetricsStat *stat = (MetricsStat *)stats->data;
+
+		if (!strcmp(stat->name, name))
+			return stat;
+	}
+
+	return NULL;
+}
+
+static void
+test_metrics_counter(void)
+{
+	GSList *stats;
+	MetricsStat *stat;
+
+	metrics_reset();
+	metrics_counter_add("test.counter", 2);
+	metrics_counter_add("test.counter", 3);
+
+	stats = metrics_get_stats();
+	stat = find_stat(stats, "test.counter");
+	g_assert_nonnull(stat);
+	g_assert_cmpint(stat->type, ==, METRICS_COUNTER);
+	g_assert_cmpint(stat->count, ==, 5);
+	metrics_free_stats(stats);
+}
+
+static void
+test_metrics_histogram(void)
+{
+	GSList *stats;
+	MetricsStat *stat;
+	gint i;
+
+	metrics_reset();
+	for (i = 1; i <= 100; i++)
+		metrics_histogram_record("test.histogram", i);
+
+	stats = metrics_get_stats();
+	stat = find_stat(stats, "test.histogram");
+	g_assert_nonnull(stat);
+	g_assert_cmpint(stat->type, ==, METRICS_HISTOGRAM);
+	g_assert_cmpint(stat->count, ==, 100);
+	g_assert_cmpint(stat->sum, ==, 5050);
+	g_assert_cmpint(stat->min, ==, 1);
+	g_assert_cmpint(stat->max, ==, 100);
+	/* within a power of two */
+	g_assert_cmpint(stat->p50, >=, 50);
+	g_assert_cmpint(stat->p50, <, 100);
+	g_assert_cmpint(stat->p99, ==, 100);
+	metrics_free_stats(stats);
+}
+
+static void
+test_metrics_span(void)
+{
+	MetricsSpan span;
+	GSList *stats;
+	MetricsStat *stat;
+	gchar *trace;
+
+	metrics_reset();
+	metrics_span_begin_detail(&span, "test.span", "detail");
+	g_usleep(1000);
+	g_assert_cmpint(metrics_span_end(&span), >=, 1000);
+
+	stats = metrics_get_stats();
+	stat = find_stat(stats, "test.span: detail");
+	g_assert_nonnull(stat);
+	g_assert_cmpint(stat->count, ==, 1);
+	g_assert_cmpint(stat->min, >=, 1000);
+	metrics_free_stats(stats);
+
+	trace = metrics_to_chrome_trace();
+	g_assert_nonnull(strstr(trace, "\"name\": \"test.span: detail\""));
+	g_assert_nonnull(strstr(trace, "\"ph\": \"X\""));
+	g_free(trace);
+}
+
+static void
+test_metrics_json(void)
+{
+	gchar *json;
+
+	metrics_reset();
+	metrics_counter_add("test.\"quoted\"", 1);
+	metrics_histogram_record("test.histogram", 7);
+
+	json = metrics_to_json();
+	g_assert_nonnull(strstr(json, "\"test.\\\"quoted\\\"\": 1"));
+	g_assert_nonnull(strstr(json, "\"test.histogram\": {\"count\": 1, \"sum\": 7"));
+	g_free(json);
+}
+
+int
+main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/common/metrics/counter", test_metrics_counter);
+	g_test_add_func("/common/metrics/histogram", test_metrics_histogram);
+	g_test_add_func("/common/metrics/span", test_metrics_span);
+	g_test_add_func("/common/metrics/json", test_metrics_json);
+
+	return g_test_run();
+}
@@ -0,0 +1,249 @@
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "ssl_cache.h"
+
+#include "mock_prefs_common_get_use_shred.h"
+#include "mock_prefs_common_get_flush_metadata.h"
+
+#ifdef USE_GNUTLS
+
+#define DATADIR "data/"
+#define CERT_FILE DATADIR "ssl_test_cert.pem"
+#define KEY_FILE DATADIR "ssl_test_key.pem"
+
+static gnutls_datum_t ticket_key;
+
+/* a copy of the CA bundle, that the tests can change */
+static gchar *
+copy_cert_file(gchar **dir)
+{
+	gchar *contents, *path;
+	gsize len;
+
+	*dir = g_dir_make_tmp("ssl_cache_test_XXXXXX", NULL);
+	g_assert_nonnull(*dir);
+	path = g_build_filename(*dir, "ca.pem", NULL);
+	g_assert_true(g_file_get_contents(CERT_FILE, &contents, &len, NULL));
+	g_assert_true(g_file_set_contents(path, contents, len, NULL));
+	g_free(contents);
+
+	return path;
+}
+
+static void
+remove_cert_file(gchar *dir, gchar *path)
+{
+	g_unlink(path);
+	g_rmdir(dir);
+	g_free(path);
+	g_free(dir);
+}
+
+static void
+test_credentials_shared(void)
+{
+	gnutls_certificate_credentials_t a, b;
+	gchar *dir, *path = copy_cert_file(&dir);
+
+	a = ssl_cache_credentials_get(path, NULL);
+	b = ssl_cache_credentials_get(path, NULL);
+	g_assert_nonnull(a);
+	g_assert_true(a == b);
+
+	ssl_cache_credentials_unref(a);
+	ssl_cache_credentials_unref(b);
+	/* still held by the cache */
+	b = ssl_cache_credentials_get(path, NULL);
+	g_assert_true(a == b);
+	ssl_cache_credentials_unref(b);
+
+	ssl_cache_done();
+	remove_cert_file(dir, path);
+}
+
+static void
+test_credentials_reload(void)
+{
+	gnutls_certificate_credentials_t old, cur, again;
+	gchar *dir, *path = copy_cert_file(&dir);
+	gchar *contents, *longer;
+	gsize len;
+
+	old = ssl_cache_credentials_get(path, NULL);
+
+	/* the bundle changed: new credentials, the old ones stay usable
+	 * by whoever holds them */
+	g_assert_true(g_file_get_contents(path, &contents, &len, NULL));
+	longer = g_strconcat(contents, "\n", NULL);
+	g_assert_true(g_file_set_contents(path, longer, -1, NULL));
+	g_free(longer);
+	g_free(contents);
+
+	cur = ssl_cache_credentials_get(path, NULL);
+	g_assert_nonnull(cur);
+	g_assert_true(cur != old);
+	ssl_cache_credentials_unref(old);
+
+	again = ssl_cache_credentials_get(path, NULL);
+	g_assert_true(again == cur);
+	ssl_cache_credentials_unref(again);
+	ssl_cache_credentials_unref(cur);
+
+	ssl_cache_done();
+	remove_cert_file(dir, path);
+}
+
+static void
+test_credentials_done_in_use(void)
+{
+	gnutls_certificate_credentials_t xcred, other;
+	gchar *dir, *path = copy_cert_file(&dir);
+
+	xcred = ssl_cache_credentials_get(path, NULL);
+	other = ssl_cache_credentials_get(path, NULL);
+
+	/* the connections still open keep their credentials, the last
+	 * one frees them, once */
+	ssl_cache_done();
+	ssl_cache_credentials_unref(xcred);
+	ssl_cache_credentials_unref(other);
+
+	xcred = ssl_cache_credentials_get(path, NULL);
+	g_assert_nonnull(xcred);
+	ssl_cache_credentials_unref(xcred);
+
+	ssl_cache_done();
+	remove_cert_file(dir, path);
+}
+
+/* a TLS server for one connection, with session tickets */
+static gpointer
+serve_connection(gpointer data)
+{
+	int fd = GPOINTER_TO_INT(data);
+	gnutls_certificate_credentials_t xcred;
+	gnutls_session_t session;
+	int r;
+
+	g_assert_cmpint(gnutls_certificate_allocate_credentials(&xcred), ==, 0);
+	g_assert_cmpint(gnutls_certificate_set_x509_key_file(xcred, CERT_FILE,
+			KEY_FILE, GNUTLS_X509_FMT_PEM), ==, 0);
+	g_assert_cmpint(gnutls_init(&session, GNUTLS_SERVER), ==, 0);
+	gnutls_set_default_priority(session);
+	gnutls_credentials_set(session, GNUTLS_CRD_CERTIFICATE, xcred);
+	gnutls_session_ticket_enable_server(session, &ticket_key);
+	gnutls_transport_set_ptr(session, (gnutls_transport_ptr_t) GINT_TO_POINTER(fd));
+
+	do {
+		r = gnutls_handshake(session);
+	} while (r < 0 && !gnutls_error_is_fatal(r));
+	g_assert_cmpint(r, ==, 0);
+
+	/* with TLS 1.3 the ticket goes with the first data */
+	g_assert_cmpint(gnutls_record_send(session, "x", 1), ==, 1);
+	gnutls_bye(session, GNUTLS_SHUT_WR);
+
+	gnutls_deinit(session);
+	gnutls_certificate_free_credentials(xcred);
+	close(fd);
+	return NULL;
+}
+
+/* connects to a new server, as ssl_init_socket() does, and returns
+ * whether the session was resumed */
+static gboolean
+connect_with_cache(const gchar *key, const gchar *cert_file)
+{
+	gnutls_certificate_credentials_t xcred;
+	gnutls_session_t session;
+	GThread *server;
+	gboolean resumed;
+	gchar byte;
+	int fds[2], r;
+
+	g_assert_cmpint(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), ==, 0);
+	server = g_thread_new("tls-server", serve_connection, GINT_TO_POINTER(fds[1]));
+
+	xcred = ssl_cache_credentials_get(cert_file, NULL);
+	g_assert_nonnull(xcred);
+	g_assert_cmpint(gnutls_init(&session, GNUTLS_CLIENT), ==, 0);
+	gnutls_set_default_priority(session);
+	gnutls_server_name_set(session, GNUTLS_NAME_DNS, "localhost", 9);
+	gnutls_credentials_set(session, GNUTLS_CRD_CERTIFICATE, xcred);
+	gnutls_transport_set_ptr(session, (gnutls_transport_ptr_t) GINT_TO_POINTER(fds[0]));
+	ssl_cache_session_restore(key, session);
+
+	do {
+		r = gnutls_handshake(session);
+	} while (r < 0 && !gnutls_error_is_fatal(r));
+	g_assert_cmpint(r, ==, 0);
+	resumed = gnutls_session_is_resumed(session);
+
+	g_assert_cmpint(gnutls_record_recv(session, &byte, 1), ==, 1);
+	ssl_cache_session_save(key, session);
+
+	/* no close_notify: the server may be gone already */
+	g_thread_join(server);
+	gnutls_deinit(session);
+	ssl_cache_credentials_unref(xcred);
+	close(fds[0]);
+
+	return resumed;
+}
+
+static void
+test_session_resume(void)
+{
+	gchar *dir, *path = copy_cert_file(&dir);
+	guint full, resumed;
+
+	g_assert_false(connect_with_cache("account localhost:993", path));
+	g_assert_true(connect_with_cache("account localhost:993", path));
+	/* sessions are kept per key */
+	g_assert_false(connect_with_cache("other localhost:993", path));
+
+	ssl_cache_session_count(FALSE, &full, &resumed);
+	ssl_cache_session_count(TRUE, &full, &resumed);
+	g_assert_cmpuint(full, ==, 1);
+	g_assert_cmpuint(resumed, ==, 1);
+
+	/* the saved sessions go with the cache */
+	ssl_cache_done();
+	g_assert_false(connect_with_cache("account localhost:993", path));
+
+	ssl_cache_done();
+	remove_cert_file(dir, path);
+}
+
+#endif /* USE_GNUTLS */
+
+int
+main(int argc, char *argv[])
+{
+	int r;
+
+	g_test_init(&argc, &argv, NULL);
+
+#ifdef USE_GNUTLS
+	gnutls_global_init();
+	gnutls_session_ticket_key_generate(&ticket_key);
+
+	g_test_add_func("/common/ssl_cache/credentials/shared", test_credentials_shared);
+	g_test_add_func("/common/ssl_cache/credentials/reload", test_credentials_reload);
+	g_test_add_func("/common/ssl_cache/credentials/done_in_use", test_credentials_done_in_use);
+	g_test_add_func("/common/ssl_cache/session/resume", test_session_resume);
+#endif
+
+	r = g_test_run();
+
+#ifdef USE_GNUTLS
+	gnutls_free(ticket_key.data);
+	gnutls_global_deinit();
+#endif
+
+	return r;
+}
@@ -0,0 +1,72 @@
+#include <glib.h>
+
+#include "startup.h"
+
+#include "mock_prefs_common_get_use_shred.h"
+#include "mock_prefs_common_get_flush_metadata.h"
+
+static gpointer
+add_one(gpointer data)
+{
+	g_usleep(10000);
+	return GINT_TO_POINTER(GPOINTER_TO_INT(data) + 1);
+}
+
+static gpointer
+nested_phases(gpointer data)
+{
+	StartupPhase *phase = startup_phase_begin("inner");
+
+	g_assert_nonnull(phase);
+	startup_phase_end(phase);
+
+	return data;
+}
+
+static void
+test_startup_tasks(void)
+{
+	StartupTask *tasks[8];
+	gint i;
+
+	for (i = 0; i < 8; i++)
+		tasks[i] = startup_task_run("add one", add_one, GINT_TO_POINTER(i));
+
+	/* in any order */
+	for (i = 7; i >= 0; i--)
+		g_assert_cmpint(GPOINTER_TO_INT(startup_task_wait(tasks[i])), ==, i + 1);
+}
+
+static void
+test_startup_trace(void)
+{
+	StartupPhase *outer, *inner;
+	StartupTask *task;
+
+	outer = startup_phase_begin("outer");
+	g_assert_nonnull(outer);
+	inner = startup_phase_begin("inner");
+	task = startup_task_run("nested", nested_phases, outer);
+	startup_phase_end(inner);
+	g_assert_true(startup_task_wait(task) == outer);
+	startup_phase_end(outer);
+
+	startup_trace_dump();
+
+	/* nothing is recorded after the dump */
+	g_assert_null(startup_phase_begin("late"));
+	startup_phase_end(NULL);
+	task = startup_task_run("late", add_one, GINT_TO_POINTER(41));
+	g_assert_cmpint(GPOINTER_TO_INT(startup_task_wait(task)), ==, 42);
+}
+
+int
+main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/common/startup/tasks", test_startup_tasks);
+	g_test_add_func("/common/startup/trace", test_startup_trace);
+
+	return g_test_run();
+}
@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+
+#include "utils.h"
+
+#include "mock_prefs_common_get_use_shred.h"
+#include "mock_prefs_common_get_flush_metadata.h"
+
+#define MESSAGE \
+	"From: user@example.com\n" \
+	"To: other@example.com\n" \
+	"Bcc: hidden@example.com,\n" \
+	" another@example.com\n" \
+	"Subject: test\n" \
+	"\n" \
+	"Hello,\n" \
+	".\n" \
+	"..and a line starting with dots\n" \
+	"Bcc: this is the body\n"
+
+#define EXPECTED \
+	"From: user@example.com\r\n" \
+	"To: other@example.com\r\n" \
+	"Subject: test\r\n" \
+	"\r\n" \
+	"Hello,\r\n" \
+	"..\r\n" \
+	"...and a line starting with dots\r\n" \
+	"Bcc: this is the body\r\n"
+
+static FILE *
+open_message(void)
+{
+	FILE *fp = tmpfile();
+
+	g_assert_nonnull(fp);
+	g_assert_cmpint(fputs(MESSAGE, fp), !=, EOF);
+	rewind(fp);
+
+	return fp;
+}
+
+static void
+test_utils_get_outgoing_rfc2822_str(void)
+{
+	FILE *fp = open_message();
+	gchar *str = get_outgoing_rfc2822_str(fp);
+
+	g_assert_cmpstr(str, ==, EXPECTED);
+
+	g_free(str);
+	fclose(fp);
+}
+
+static void
+test_utils_get_outgoing_rfc2822_chunk(void)
+{
+	gsize max;
+
+	/* whatever the chunk size, the chunks make up the same message */
+	for (max = 1; max <= strlen(EXPECTED) + 1; max++) {
+		FILE *fp = open_message();
+		GString *str = g_string_new(NULL);
+		GString *chunk = g_string_new(NULL);
+		gboolean in_body = FALSE, more;
+
+		do {
+			g_string_truncate(chunk, 0);
+			more = get_outgoing_rfc2822_chunk(fp, chunk, max, &in_body);
+			if (more)
+				g_assert_cmpuint(chunk->len, >=, max);
+			g_string_append_len(str, chunk->str, chunk->len);
+		} while (more);
+
+		g_assert_cmpstr(str->str, ==, EXPECTED);
+
+		g_string_free(chunk, TRUE);
+		g_string_free(str, TRUE);
+		fclose(fp);
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/common/utils/get_outgoing_rfc2822/str",
+			test_utils_get_outgoing_rfc2822_str);
+	g_test_add_func("/common/utils/get_outgoing_rfc2822/chunk",
+			test_utils_get_outgoing_rfc2822_chunk);
+
+	return g_test_run();
+}
@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+
+#include "utils.h"
+
+#include "mock_prefs_common_get_use_shred.h"
+#include "mock_prefs_common_get_flush_metadata.h"
+
+/* The table walk scan_uri_parts() replaces, one strcasestr() per token
+ * for each part found, kept here to compare against. */
+static const struct {
+	const gchar *needle;
+	URIPartType type;
+} parser[] = {
+	{"http://",   URI_PART_URI},
+	{"https://",  URI_PART_URI},
+	{"ftp://",    URI_PART_URI},
+	{"sftp://",   URI_PART_URI},
+	{"gopher://", URI_PART_URI},
+	{"www.",      URI_PART_HTTP},
+	{"mailto:",   URI_PART_URI},
+	{"@",         URI_PART_EMAIL}
+};
+
+static GArray *
+scan_table(const gchar *buf, gboolean hdr)
+{
+	GArray *parts = g_array_new(FALSE, FALSE, sizeof(URIPart));
+	const gchar *walk = buf;
+
+	for (;;) {
+		const gchar *scanpos = NULL;
+		const gchar *bp, *ep;
+		guint n, last_index = 0;
+		gboolean ok;
+
+		for (n = 0; n < G_N_ELEMENTS(parser); n++) {
+			const gchar *tmp = strcasestr(walk, parser[n].needle);
+
+			if (tmp && (scanpos == NULL || tmp < scanpos)) {
+				scanpos = tmp;
+				last_index = n;
+			}
+		}
+		if (scanpos == NULL)
+			break;
+
+		if (parser[last_index].type == URI_PART_EMAIL)
+			ok = get_email_part(walk, scanpos, &bp, &ep, hdr);
+		else
+			ok = get_uri_part(walk, scanpos, &bp, &ep, hdr);
+
+		if (ok && (size_t) (ep - bp - 1) > strlen(parser[last_index].needle)) {
+			URIPart part = { bp, ep, parser[last_index].type };
+
+			g_array_append_val(parts, part);
+			walk = ep;
+		} else
+			walk = scanpos + strlen(parser[last_index].needle);
+	}
+
+	return parts;
+}
+
+static const gchar *td_scan_uri_parts[] = {
+	"",
+	"no links here.",
+	"http://www.example.com",
+	"See http://www.example.com/foo?bar=1, or www.example.org.",
+	"HTTPS://Example.COM/ and Www.example.net",
+	"sftp://host/path and ftp://host/path",
+	"gopher://gopher.example.com/1/",
+	"Write to user@example.com or mailto:other@example.com",
+	"<a.b@example.com>, \"C\" <c@example.org>",
+	"http:// www. @ mailto: ftp:/ ftp:// x@",
+	"www.www.example.com user@www.example.com",
+	"http://www.example.com/a@b.c/http://x.y",
+	"xhttp://nospace.example.com/wwwx.example.com",
+	"not an email: a@, @b, a@b",
+	"http://www.examöple.com user@exämple.com",
+	"http://www.漢字.com と www.漢字.jp",
+	"(http://example.com/f(o)o) [www.example.com/f[oo]",
+	"....:::@@@wwwwww.example.comhttps://https://a.b"
+};
+
+static void
+check_parts(const gchar *str, gboolean hdr)
+{
+	GArray *expected = scan_table(str, hdr);
+	GArray *parts = scan_uri_parts(str, URI_SCAN_GOPHER |
+				       (hdr ? URI_SCAN_HEADER : 0));
+	guint n;
+
+	g_assert_cmpuint(parts->len, ==, expected->len);
+	for (n = 0; n < parts->len; n++) {
+		URIPart *a = &g_array_index(parts, URIPart, n);
+		URIPart *b = &g_array_index(expected, URIPart, n);
+
+		g_assert_true(a->bp == b->bp);
+		g_assert_true(a->ep == b->ep);
+		g_assert_cmpint(a->type, ==, b->type);
+	}
+
+	g_array_free(parts, TRUE);
+	g_array_free(expected, TRUE);
+}
+
+static void
+test_utils_scan_uri_parts(gconstpointer user_data)
+{
+	const gchar *str = (const gchar *)user_data;
+
+	check_parts(str, FALSE);
+	check_parts(str, TRUE);
+}
+
+static void
+test_utils_scan_uri_parts_types(void)
+{
+	const gchar *str = "www.example.com user@example.com ftp://example.com";
+	GArray *parts = scan_uri_parts(str, 0);
+	gchar *uri;
+
+	g_assert_cmpuint(parts->len, ==, 3);
+
+	uri = make_uri_part_string(&g_array_index(parts, URIPart, 0));
+	g_assert_cmpstr(uri, ==, "http://www.example.com");
+	g_free(uri);
+	uri = make_uri_part_string(&g_array_index(parts, URIPart, 1));
+	g_assert_cmpstr(uri, ==, "mailto:user@example.com");
+	g_free(uri);
+	uri = make_uri_part_string(&g_array_index(parts, URIPart, 2));
+	g_assert_cmpstr(uri, ==, "ftp://example.com");
+	g_free(uri);
+
+	g_array_free(parts, TRUE);
+}
+
+static void
+test_utils_scan_uri_parts_gopher(void)
+{
+	const gchar *str = "gopher://gopher.example.com/";
+	GArray *parts;
+
+	parts = scan_uri_parts(str, 0);
+	g_assert_cmpuint(parts->len, ==, 0);
+	g_array_free(parts, TRUE);
+
+	parts = scan_uri_parts(str, URI_SCAN_GOPHER);
+	g_assert_cmpuint(parts->len, ==, 1);
+	g_assert_true(g_array_index(parts, URIPart, 0).bp == str);
+	g_array_free(parts, TRUE);
+}
+
+/* A long mail body, mostly text with a link or an address here and
+ * there, as in a log or a digest. */
+static gchar *
+make_body(gsize size)
+{
+	GString *body = g_string_sized_new(size + 128);
+	guint n = 0;
+
+	while (body->len < size) {
+		switch (n++ % 8) {
+		case 0:
+			g_string_append_printf(body,
+				"2026-10-19 12:00:%02u worker %u: fetched "
+				"http://www.example.com/item/%u in 12 ms\n",
+				n % 60, n % 16, n);
+			break;
+		case 3:
+			g_string_append_printf(body,
+				"Reported by user%u@example.org, see "
+				"www.example.net/bugs/%u.\n", n, n);
+			break;
+		default:
+			g_string_append(body,
+				"Lorem ipsum dolor sit amet, consectetur adipiscing "
+				"elit, sed do eiusmod tempor incididunt ut labore.\n");
+			break;
+		}
+	}
+
+	return g_string_free(body, FALSE);
+}
+
+static void
+test_utils_scan_uri_parts_perf(void)
+{
+	gchar *body = make_body(2 * 1024 * 1024);
+	gchar **lines = g_strsplit(body, "\n", -1);
+	gdouble table_time, scan_time;
+	guint table_parts = 0, scan_parts = 0;
+	gint i;
+
+	/* line by line, as the text view does */
+	g_test_timer_start();
+	for (i = 0; lines[i] != NULL; i++) {
+		GArray *parts = scan_table(lines[i], FALSE);
+
+		table_parts += parts->len;
+		g_array_free(parts, TRUE);
+	}
+	table_time = g_test_timer_elapsed();
+
+	g_test_timer_start();
+	for (i = 0; lines[i] != NULL; i++) {
+		GArray *parts = scan_uri_parts(lines[i], URI_SCAN_GOPHER);
+
+		scan_parts += parts->len;
+		g_array_free(parts, TRUE);
+	}
+	scan_time = g_test_timer_elapsed();
+
+	g_assert_cmpuint(scan_parts, ==, table_parts);
+	g_test_minimized_result(table_time, "table walk: %u parts in %.3f s",
+				table_parts, table_time);
+	g_test_minimized_result(scan_time, "single pass: %u parts in %.3f s",
+				scan_parts, scan_time);
+
+	g_strfreev(lines);
+	g_free(body);
+}
+
+int
+main(int argc, char *argv[])
+{
+	guint n;
+
+	g_test_init(&argc, &argv, NULL);
+
+	for (n = 0; n < G_N_ELEMENTS(td_scan_uri_parts); n++) {
+		gchar *path = g_strdup_printf("/common/utils/scan_uri_parts/%u", n);
+
+		g_test_add_data_func(path, td_scan_uri_parts[n],
+				test_utils_scan_uri_parts);
+		g_free(path);
+	}
+	g_test_add_func("/common/utils/scan_uri_parts/types",
+			test_utils_scan_uri_parts_types);
+	g_test_add_func("/common/utils/scan_uri_parts/gopher",
+			test_utils_scan_uri_parts_gopher);
+	if (g_test_perf())
+		g_test_add_func("/common/utils/scan_uri_parts/perf",
+				test_utils_scan_uri_parts_perf);
+
+	return g_test_run();
+}
@@ -1,4 +1,6 @@
 #include <glib.h>
+#include <glib/gstdio.h>
+#include <unistd.h>
 
 #include "xml.h"
 
@@ -28,6 +30,128 @@ test_xml_open_file_empty(void)
 	g_assert_false(xf->is_empty_element);
 }
 
+static gchar *
+write_tmp_xml(const gchar *contents)
+{
+	gchar *path;
+	gint fd = g_file_open_tmp("xml_test.XXXXXX", &path, NULL);
+
+	g_assert_cmpint(fd, >=, 0);
+	close(fd);
+	g_assert_true(g_file_set_contents(path, contents, -1, NULL));
+
+	return path;
+}
+
+static gint
+record_start(XMLTag *tag, gpointer data)
+{
+	GString *events = (GString *)data;
+	GList *cur;
+
+	g_string_append_printf(events, "<%s", tag->tag);
+	for (cur = tag->attr; cur != NULL; cur = cur->next) {
+		XMLAttr *attr = (XMLAttr *)cur->data;
+
+		g_string_append_printf(events, " %s=%s", attr->name, attr->value);
+	}
+	g_string_append(events, ">");
+
+	return 0;
+}
+
+static gint
+record_end(const gchar *name, gpointer data)
+{
+	g_string_append_printf((GString *)data, "</%s>", name);
+	return 0;
+}
+
+static gint
+record_text(const gchar *text, gpointer data)
+{
+	g_string_append_printf((GString *)data, "[%s]", text);
+	return 0;
+}
+
+static const XMLSaxHandler record_handler = {
+	record_start, record_end, record_text
+};
+
+static void
+test_xml_sax_parse_file(void)
+{
+	GString *events = g_string_new(NULL);
+	gchar *path = write_tmp_xml(
+		"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		"<!-- a <comment> -->\n"
+		"<list version='2'>\n"
+		"  <item name=\"a &amp; b\" empty=\"\"/>\n"
+		"  <item name = \"&lt;c&gt;\" ><!-- inside -->\n"
+		"    text &quot;here&quot;\n"
+		"  </item >\n"
+		"</list>\n");
+
+	g_assert_cmpint(xml_sax_parse_file(path, &record_handler, events), ==, 0);
+	g_assert_cmpstr(events->str, ==,
+		"<list version=2>"
+		"<item name=a & b empty=></item>"
+		"<item name=<c>>[text \"here\"]</item>"
+		"</list>");
+
+	g_unlink(path);
+	g_free(path);
+	g_string_free(events, TRUE);
+}
+
+static void
+test_xml_sax_parse_file_mismatch(void)
+{
+	if (g_test_subprocess()) {
+		GString *events = g_string_new(NULL);
+		gchar *path = write_tmp_xml(
+			"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+			"<list><item></list>\n");
+		gint ret = xml_sax_parse_file(path, &record_handler, events);
+
+		g_unlink(path);
+		g_assert_cmpint(ret, ==, -1);
+		return;
+	}
+
+	g_test_trap_subprocess(NULL, 0, 0);
+	g_test_trap_assert_failed();
+	g_test_trap_assert_stderr("*Tag name mismatch*");
+}
+
+static void
+test_xml_string_append(void)
+{
+	static const gchar *value = "<\"quoted\" & 'single'>";
+	GString *str = g_string_new("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+	GString *events = g_string_new(NULL);
+	XMLTag *tag = xml_tag_new("list");
+	gchar *path;
+	gchar *expected;
+
+	xml_tag_add_attr(tag, xml_attr_new("value", value));
+	xml_string_append_tag(str, tag, 0, FALSE);
+	xml_string_append_escape(str, value);
+	xml_string_append_end_tag(str, tag->tag, 0);
+	xml_free_tag(tag);
+
+	path = write_tmp_xml(str->str);
+	g_assert_cmpint(xml_sax_parse_file(path, &record_handler, events), ==, 0);
+	expected = g_strdup_printf("<list value=%s>[%s]</list>", value, value);
+	g_assert_cmpstr(events->str, ==, expected);
+
+	g_free(expected);
+	g_unlink(path);
+	g_free(path);
+	g_string_free(events, TRUE);
+	g_string_free(str, TRUE);
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -35,6 +159,10 @@ main(int argc, char *argv[])
 
 	g_test_add_func("/common/xml_open_file_missing", test_xml_open_file_missing);
 	g_test_add_func("/common/xml_open_file_empty", test_xml_open_file_empty);
+	g_test_add_func("/common/xml_sax_parse_file", test_xml_sax_parse_file);
+	g_test_add_func("/common/xml_sax_parse_file_mismatch",
+			test_xml_sax_parse_file_mismatch);
+	g_test_add_func("/common/xml_string_append", test_xml_string_append);
 
 	return g_test_run();
 }
@@ -24,7 +24,8 @@
  * be able to get functions timing information. As the implementation is
  * naive, START_TIMING("message"); must be present just at the end of a
  * declaration block (or compilation would fail with gcc 2.x), and the
- * END_TIMING() call must be in the same scope.
+ * END_TIMING() call must be in the same scope. The time is also recorded
+ * in the metrics, under the name of the function and the message.
  */
 #ifndef __TIMING_H__
 #define __TIMING_H__
@@ -36,6 +37,7 @@
 #endif
 
 #include "utils.h"
+#include "metrics.h"
 # define mytimersub(a, b, result)                                             \
   do {                                                                        \
     (result)->tv_sec = (a)->tv_sec - (b)->tv_sec;                             \
@@ -62,6 +64,8 @@
 	LARGE_INTEGER end; \
 	LARGE_INTEGER diff; \
 	const char *timing_name=str; \
+	MetricsSpan timing_span; \
+	metrics_span_begin_detail(&timing_span, G_STRFUNC, timing_name); \
 	QueryPerformanceFrequency (&frequency); \
 	QueryPerformanceCounter (&start);
 
@@ -72,7 +76,8 @@
 			* 1000000/frequency.QuadPart; \
 	debug_print("TIMING %s: %ds%03dms\n", timing_name, \
 			(unsigned int) (diff.QuadPart / 1000000), \
-			(unsigned int) ((diff.QuadPart / 1000) % 1000));
+			(unsigned int) ((diff.QuadPart / 1000) % 1000)); \
+	metrics_span_end(&timing_span);
 
 #else
 /* no {} by purpose */
@@ -81,6 +86,8 @@
 	struct timeval end;						\
 	struct timeval diff;						\
 	const char *timing_name=str;					\
+	MetricsSpan timing_span;					\
+	metrics_span_begin_detail(&timing_span, G_STRFUNC, timing_name); \
 	gettimeofday(&start, NULL);
 
 #ifdef __GLIBC__
@@ -90,14 +97,16 @@
 	debug_print("TIMING %s %s: %ds%03dms\n", 			\
 		__FUNCTION__,						\
 		timing_name, (unsigned int)diff.tv_sec, 		\
-		(unsigned int)diff.tv_usec/1000);
+		(unsigned int)diff.tv_usec/1000);			\
+	metrics_span_end(&timing_span);
 #else
 #define END_TIMING()							\
 	gettimeofday(&end, NULL);					\
 	mytimersub(&end, &start, &diff);				\
 	debug_print("TIMING %s: %ds%03dms\n", 				\
 		timing_name, (unsigned int)diff.tv_sec, 		\
-		(unsigned int)diff.tv_usec/1000);			
+		(unsigned int)diff.tv_usec/1000);			\
+	metrics_span_end(&timing_span);
 #endif
 
 #endif 
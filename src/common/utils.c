@@ -455,6 +455,21 @@ gint subject_compare_for_sort(const gchar *s1, const gchar *s2)
 	return g_utf8_collate(str1, str2);
 }
 
+/* returns a key which orders with strcmp() like subject_compare_for_sort() */
+gchar *subject_get_sort_key(const gchar *subject)
+{
+	gchar *str, *key;
+
+	if (!subject) return NULL;
+
+	str = g_strdup(subject);
+	trim_subject_for_sort(str);
+	key = g_utf8_collate_key(str, -1);
+	g_free(str);
+
+	return key;
+}
+
 void trim_subject(gchar *str)
 {
 	register gchar *srcp;
@@ -2422,18 +2437,27 @@ gchar *normalize_newlines(const gchar *str)
 	return out;
 }
 
-gchar *get_outgoing_rfc2822_str(FILE *fp)
+/* get_outgoing_rfc2822_chunk() - appends the next lines of the message
+ * in fp to str, as they are to be sent: without the Bcc: header, with
+ * CRLF line endings and dot-stuffed. Stops once str holds max bytes or
+ * more. *in_body must be FALSE on the first call. Returns FALSE at the
+ * end of the message. */
+gboolean get_outgoing_rfc2822_chunk(FILE *fp, GString *str, gsize max,
+				    gboolean *in_body)
 {
 	gchar buf[BUFFSIZE];
-	GString *str;
-	gchar *ret;
 
-	str = g_string_new(NULL);
-
-	/* output header part */
-	while (claws_fgets(buf, sizeof(buf), fp) != NULL) {
+	while (str->len < max) {
+		if (claws_fgets(buf, sizeof(buf), fp) == NULL)
+			return FALSE;
 		strretchomp(buf);
-		if (!g_ascii_strncasecmp(buf, "Bcc:", 4)) {
+
+		if (*in_body) {
+			if (buf[0] == '.')
+				g_string_append_c(str, '.');
+			g_string_append(str, buf);
+			g_string_append(str, "\r\n");
+		} else if (!g_ascii_strncasecmp(buf, "Bcc:", 4)) {
 			gint next;
 
 			for (;;) {
@@ -2451,23 +2475,24 @@ gchar *get_outgoing_rfc2822_str(FILE *fp)
 			g_string_append(str, buf);
 			g_string_append(str, "\r\n");
 			if (buf[0] == '\0')
-				break;
+				*in_body = TRUE;
 		}
 	}
 
-	/* output body part */
-	while (claws_fgets(buf, sizeof(buf), fp) != NULL) {
-		strretchomp(buf);
-		if (buf[0] == '.')
-			g_string_append_c(str, '.');
-		g_string_append(str, buf);
-		g_string_append(str, "\r\n");
-	}
+	return TRUE;
+}
 
-	ret = str->str;
-	g_string_free(str, FALSE);
+gchar *get_outgoing_rfc2822_str(FILE *fp)
+{
+	GString *str;
+	gboolean in_body = FALSE;
 
-	return ret;
+	str = g_string_new(NULL);
+
+	while (get_outgoing_rfc2822_chunk(fp, str, G_MAXSIZE, &in_body))
+		;
+
+	return g_string_free(str, FALSE);
 }
 
 /*
@@ -3782,6 +3807,131 @@ gchar *make_http_string(const gchar *bp, const gchar *ep)
 	return result;
 }
 
+/* Schemes recognized in front of a colon, longest first where one ends
+ * another, so that the earliest starting one is used. */
+static const struct {
+	const gchar *name;
+	gsize len;
+	gboolean slashes;	/* followed by "//" */
+	guint flag;		/* scan flag needed, if any */
+} uri_schemes[] = {
+	{"https",  5, TRUE,  0},
+	{"http",   4, TRUE,  0},
+	{"sftp",   4, TRUE,  0},
+	{"ftp",    3, TRUE,  0},
+	{"gopher", 6, TRUE,  URI_SCAN_GOPHER},
+	{"mailto", 6, FALSE, 0}
+};
+
+/* get_next_uri_part() - finds the next URI or email address from *walk
+ * in a single pass: only ':', '.' and '@' can end the token starting a
+ * part, so the text is only looked at around them, then the part is
+ * parsed by get_uri_part() or get_email_part(). Parts are found in the
+ * same order, and with the same bounds, as with one strcasestr() per
+ * token. On success, *walk is moved to the end of the part. */
+gboolean get_next_uri_part(const gchar **walk, guint flags, URIPart *part)
+{
+	const gchar *start = *walk;
+	const gchar *search = start;
+	const gchar *p;
+
+	cm_return_val_if_fail(walk != NULL && *walk != NULL, FALSE);
+	cm_return_val_if_fail(part != NULL, FALSE);
+
+	while ((p = strpbrk(search, ":.@")) != NULL) {
+		const gchar *scanpos = NULL;
+		const gchar *bp, *ep;
+		gsize token_len = 0;
+		gboolean ok;
+		guint n;
+
+		search = p + 1;
+
+		if (*p == ':') {
+			for (n = 0; n < G_N_ELEMENTS(uri_schemes); n++) {
+				const gchar *s;
+
+				if (uri_schemes[n].flag && !(flags & uri_schemes[n].flag))
+					continue;
+				if ((gsize) (p - start) < uri_schemes[n].len)
+					continue;
+				s = p - uri_schemes[n].len;
+				if (g_ascii_strncasecmp(s, uri_schemes[n].name,
+							uri_schemes[n].len))
+					continue;
+				if (uri_schemes[n].slashes &&
+				    (p[1] != '/' || p[2] != '/'))
+					continue;
+				scanpos = s;
+				token_len = uri_schemes[n].len +
+					(uri_schemes[n].slashes ? 3 : 1);
+				part->type = URI_PART_URI;
+				break;
+			}
+		} else if (*p == '.') {
+			if (p - start >= 3 && !g_ascii_strncasecmp(p - 3, "www", 3)) {
+				scanpos = p - 3;
+				token_len = 4;
+				part->type = URI_PART_HTTP;
+			}
+		} else {
+			scanpos = p;
+			token_len = 1;
+			part->type = URI_PART_EMAIL;
+		}
+
+		if (scanpos == NULL)
+			continue;
+
+		if (part->type == URI_PART_EMAIL)
+			ok = get_email_part(start, scanpos, &bp, &ep,
+					    flags & URI_SCAN_HEADER);
+		else
+			ok = get_uri_part(start, scanpos, &bp, &ep,
+					  flags & URI_SCAN_HEADER);
+
+		if (ok && (size_t) (ep - bp - 1) > token_len) {
+			part->bp = bp;
+			part->ep = ep;
+			*walk = ep;
+			return TRUE;
+		}
+
+		start = search = scanpos + token_len;
+	}
+
+	*walk = start + strlen(start);
+	return FALSE;
+}
+
+/* scan_uri_parts() - returns all the URIs and email addresses of buf,
+ * as an array of URIPart pointing into it */
+GArray *scan_uri_parts(const gchar *buf, guint flags)
+{
+	GArray *parts = g_array_new(FALSE, FALSE, sizeof(URIPart));
+	const gchar *walk = buf;
+	URIPart part;
+
+	cm_return_val_if_fail(buf != NULL, parts);
+
+	while (get_next_uri_part(&walk, flags, &part))
+		g_array_append_val(parts, part);
+
+	return parts;
+}
+
+gchar *make_uri_part_string(const URIPart *part)
+{
+	switch (part->type) {
+	case URI_PART_HTTP:
+		return make_http_string(part->bp, part->ep);
+	case URI_PART_EMAIL:
+		return make_email_string(part->bp, part->ep);
+	default:
+		return make_uri_string(part->bp, part->ep);
+	}
+}
+
 static gchar *mailcap_get_command_in_file(const gchar *path, const gchar *type, const gchar *file_to_open)
 {
 	FILE *fp = claws_fopen(path, "rb");
@@ -4374,6 +4524,18 @@ void cm_mutex_free(GMutex *mutex) {
 #endif
 }
 
+gint cm_get_num_processors(void)
+{
+#if GLIB_CHECK_VERSION(2,36,0)
+	return g_get_num_processors();
+#elif defined(_SC_NPROCESSORS_ONLN)
+	glong n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (gint)n : 1;
+#else
+	return 1;
+#endif
+}
+
 static gchar *canonical_list_to_file(GSList *list)
 {
 	GString *result = g_string_new(NULL);
@@ -304,6 +304,7 @@ gint subject_compare			(const gchar	*s1,
 					 const gchar	*s2);
 gint subject_compare_for_sort		(const gchar	*s1,
 					 const gchar	*s2);
+gchar *subject_get_sort_key		(const gchar	*subject);
 void trim_subject			(gchar		*str);
 void eliminate_parenthesis		(gchar		*str,
 					 gchar		 op,
@@ -432,6 +433,10 @@ gint remove_dir_recursive	(const gchar	*dir);
 gchar *canonicalize_str		(const gchar	*str);
 gchar *normalize_newlines	(const gchar	*str);
 
+gboolean get_outgoing_rfc2822_chunk	(FILE		*fp,
+					 GString	*str,
+					 gsize		 max,
+					 gboolean	*in_body);
 gchar *get_outgoing_rfc2822_str	(FILE		*fp);
 
 char *fgets_crlf(char *buf, int size, FILE *stream);
@@ -517,6 +522,34 @@ gchar *make_email_string(const gchar *bp,
 gchar *make_http_string (const gchar *bp,
 			 const gchar *ep);
 
+typedef enum
+{
+	URI_PART_URI,		/* "scheme://..." or "mailto:..." */
+	URI_PART_HTTP,		/* "www..." */
+	URI_PART_EMAIL
+} URIPartType;
+
+typedef struct _URIPart URIPart;
+struct _URIPart
+{
+	const gchar *bp;
+	const gchar *ep;
+	URIPartType type;
+};
+
+/* flags for scan_uri_parts() and get_next_uri_part() */
+#define URI_SCAN_HEADER	(1 << 0)	/* buf is the body of an address header */
+#define URI_SCAN_GOPHER	(1 << 1)	/* also look for gopher:// URIs */
+
+GArray *scan_uri_parts	(const gchar *buf,
+			 guint flags);
+gboolean get_next_uri_part
+			(const gchar **walk,
+			 guint flags,
+			 URIPart *part);
+gchar *make_uri_part_string
+			(const URIPart *part);
+
 gchar *mailcap_get_command_for_type(const gchar *type,
 				    const gchar *file_to_open);
 void mailcap_update_default	   (const gchar *type,
@@ -528,6 +561,7 @@ gboolean sc_g_slist_bigger(GSList *list, gint max);
 
 GMutex *cm_mutex_new(void);
 void cm_mutex_free(GMutex *mutex);
+gint cm_get_num_processors(void);
 
 int cm_canonicalize_filename(const gchar *filename, gchar **canonical_name);
 
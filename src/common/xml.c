@@ -39,10 +39,8 @@
 #include "stringtable.h" 
 
 static StringTable *xml_string_table;
-static XMLTag  *xml_copy_tag		(XMLTag		*tag);
 static XMLAttr *xml_copy_attr		(XMLAttr	*attr);
 static void xml_free_node		(XMLNode	*node);
-static void xml_free_tag		(XMLTag 	*tag);
 static void xml_pop_tag		(XMLFile	*file);
 static void xml_push_tag		(XMLFile	*file,
 				 XMLTag		*tag);
@@ -50,15 +48,42 @@ static gint xml_read_line		(XMLFile	*file);
 static void xml_truncate_buf		(XMLFile	*file);
 static gint xml_unescape_str		(gchar		*str);
 
+/* files can be parsed from several threads, as at startup */
+G_LOCK_DEFINE_STATIC(xml_string_table);
+
 static void xml_string_table_create(void)
 {
+	G_LOCK(xml_string_table);
+	if (xml_string_table == NULL)
+		xml_string_table = string_table_new();
+	G_UNLOCK(xml_string_table);
+}
+
+static gchar *xml_string_add(const gchar *str)
+{
+	gchar *ret;
+
+	G_LOCK(xml_string_table);
+	/* tags can be made without any file being opened */
 	if (xml_string_table == NULL)
 		xml_string_table = string_table_new();
+	ret = string_table_insert_string(xml_string_table, str);
+	G_UNLOCK(xml_string_table);
+
+	return ret;
+}
+
+static void xml_string_free(const gchar *str)
+{
+	G_LOCK(xml_string_table);
+	string_table_free_string(xml_string_table, str);
+	G_UNLOCK(xml_string_table);
 }
+
 #define XML_STRING_ADD(str) \
-	string_table_insert_string(xml_string_table, (str))
+	xml_string_add(str)
 #define XML_STRING_FREE(str) \
-	string_table_free_string(xml_string_table, (str))
+	xml_string_free(str)
 
 #define XML_STRING_TABLE_CREATE() \
 	xml_string_table_create()
@@ -172,13 +197,267 @@ GNode *xml_parse_file(const gchar *path)
 	xml_close_file(file);
 
 #if defined(SPARSE_MEMORY)
-	if (debug_get_mode())
+	if (debug_get_mode()) {
+		G_LOCK(xml_string_table);
 		string_table_get_stats(xml_string_table);
+		G_UNLOCK(xml_string_table);
+	}
 #endif
 
 	return node;
 }
 
+#define XML_SPACES	" \t\r\n"
+
+/* Parses the elements of buf, which is modified in place */
+static gint xml_sax_parse(gchar *buf, const gchar *path,
+			  const XMLSaxHandler *handler, gpointer data)
+{
+	/* the interned names of the open elements */
+	GPtrArray *stack = g_ptr_array_new();
+	GArray *attrs = g_array_new(FALSE, FALSE, sizeof(XMLAttr));
+	gchar *p = buf;
+	gint ret = 0;
+
+	while (ret >= 0) {
+		gchar *text = p;
+		gchar *q;
+		gchar c;
+		XMLTag tag;
+		gboolean empty = FALSE;
+		guint i;
+
+		if ((p = strchr(p, '<')) != NULL)
+			*p++ = '\0';
+
+		/* character data, only reported inside an element */
+		if (handler->text && stack->len > 0) {
+			/* this is not XML1.0 strict */
+			g_strstrip(text);
+			if (*text != '\0') {
+				xml_unescape_str(text);
+				ret = handler->text(text, data);
+				if (ret < 0)
+					break;
+			}
+		}
+
+		if (p == NULL)
+			break;
+
+		/* comments, processing instructions and declarations */
+		if (!strncmp(p, "!--", 3)) {
+			if ((q = strstr(p + 3, "-->")) == NULL) {
+				g_warning("xml_sax_parse(): Unterminated comment in %s", path);
+				ret = -1;
+				break;
+			}
+			p = q + 3;
+			continue;
+		}
+		if (*p == '?' || *p == '!') {
+			if ((q = strchr(p, '>')) == NULL) {
+				g_warning("xml_sax_parse(): Can't parse next tag in %s", path);
+				ret = -1;
+				break;
+			}
+			p = q + 1;
+			continue;
+		}
+
+		/* end-tag */
+		if (*p == '/') {
+			gchar *end_name = p + 1;
+			const gchar *name;
+
+			if ((q = strchr(end_name, '>')) == NULL) {
+				g_warning("xml_sax_parse(): Can't parse next tag in %s", path);
+				ret = -1;
+				break;
+			}
+			*q = '\0';
+			g_strstrip(end_name);
+			p = q + 1;
+			name = stack->len > 0 ?
+				g_ptr_array_index(stack, stack->len - 1) : NULL;
+			if (name == NULL || strcmp(name, end_name) != 0) {
+				g_warning("xml_sax_parse(): Tag name mismatch in %s : /%s (%s)",
+					  path, end_name, name ? name : "");
+				ret = -1;
+				break;
+			}
+			g_ptr_array_remove_index(stack, stack->len - 1);
+			if (handler->end_element)
+				ret = handler->end_element(name, data);
+			continue;
+		}
+
+		/* start-tag */
+		q = p + strcspn(p, XML_SPACES "/>");
+		c = *q;
+		if (c == '\0') {
+			g_warning("xml_sax_parse(): Can't parse next tag in %s", path);
+			ret = -1;
+			break;
+		}
+		*q = '\0';
+		if (*p == '\0') {
+			g_warning("xml_sax_parse(): Tag name is empty in %s", path);
+			ret = -1;
+			break;
+		}
+		tag.tag = (gchar *)g_intern_string(p);
+		tag.attr = NULL;
+		g_array_set_size(attrs, 0);
+		p = q + 1;
+
+		/* attributes ( name=value ), c is the character that ended
+		 * the previous token */
+		while (c != '>') {
+			XMLAttr attr;
+			gchar *name;
+			gchar quote;
+
+			if (c == '/') {
+				p += strspn(p, XML_SPACES);
+				if (*p != '>') {
+					g_warning("xml_sax_parse(): Syntax error in %s, tag %s", path, tag.tag);
+					ret = -1;
+					break;
+				}
+				p++;
+				empty = TRUE;
+				break;
+			}
+
+			p += strspn(p, XML_SPACES);
+			if (*p == '>' || *p == '/') {
+				c = *p++;
+				continue;
+			}
+
+			name = p;
+			if ((q = strpbrk(name, "=<>")) == NULL || *q != '=') {
+				g_warning("xml_sax_parse(): Syntax error in %s, tag (a) %s", path, tag.tag);
+				ret = -1;
+				break;
+			}
+			*q = '\0';
+			g_strchomp(name);
+			p = q + 1;
+			p += strspn(p, XML_SPACES);
+			if (*p != '"' && *p != '\'') {
+				g_warning("xml_sax_parse(): Syntax error in %s, tag (b) %s", path, tag.tag);
+				ret = -1;
+				break;
+			}
+			quote = *p++;
+			if ((q = strchr(p, quote)) == NULL) {
+				g_warning("xml_sax_parse(): Syntax error in %s, tag (c) %s", path, tag.tag);
+				ret = -1;
+				break;
+			}
+			*q = '\0';
+			xml_unescape_str(p);
+			attr.name = (gchar *)g_intern_string(name);
+			attr.value = p;
+			g_array_append_val(attrs, attr);
+			p = q + 1;
+			/* whatever follows is looked at as after a space */
+			c = ' ';
+		}
+		if (ret < 0)
+			break;
+
+		for (i = attrs->len; i > 0; i--)
+			tag.attr = g_list_prepend(tag.attr,
+					&g_array_index(attrs, XMLAttr, i - 1));
+		if (handler->start_element)
+			ret = handler->start_element(&tag, data);
+		g_list_free(tag.attr);
+		if (ret < 0)
+			break;
+
+		if (empty) {
+			if (handler->end_element)
+				ret = handler->end_element(tag.tag, data);
+		} else
+			g_ptr_array_add(stack, tag.tag);
+	}
+
+	if (ret >= 0 && stack->len > 0) {
+		g_warning("xml_sax_parse(): Unexpected end of file in %s, in %s",
+			  path, (gchar *)g_ptr_array_index(stack, stack->len - 1));
+		ret = -1;
+	}
+
+	g_array_free(attrs, TRUE);
+	g_ptr_array_free(stack, TRUE);
+
+	return ret < 0 ? -1 : 0;
+}
+
+#undef XML_SPACES
+
+/* xml_sax_parse_file() - reads the file at once and calls the handler
+ * for each element, as it is met, instead of building a tree. Returns
+ * -1 if the file can't be read or isn't well formed, or if a callback
+ * returned a negative value; the callbacks already called stay done. */
+gint xml_sax_parse_file(const gchar *path, const XMLSaxHandler *handler,
+			gpointer data)
+{
+	gchar *contents;
+	gchar *body;
+	gchar *decl;
+	gchar *end;
+	gchar *encoding;
+	gchar *conv = NULL;
+	GError *error = NULL;
+	gint ret;
+
+	cm_return_val_if_fail(path != NULL, -1);
+	cm_return_val_if_fail(handler != NULL, -1);
+
+	if (!g_file_get_contents(path, &contents, NULL, &error)) {
+		g_warning("couldn't read %s: %s", path, error->message);
+		g_error_free(error);
+		return -1;
+	}
+
+	decl = strchr(contents, '<');
+	if (decl == NULL || decl[1] != '?' ||
+	    (end = strstr(decl, "?>")) == NULL) {
+		g_warning("Can't get XML DTD in %s", path);
+		g_free(contents);
+		return -1;
+	}
+	*end = '\0';
+	body = end + 2;
+	if (!strcasestr(decl, "xml") || !strcasestr(decl, "version")) {
+		g_warning("Can't get XML DTD in %s", path);
+		g_free(contents);
+		return -1;
+	}
+
+	/* the whole file is converted at once, the names and values then
+	 * need no conversion of their own */
+	if ((encoding = strcasestr(decl, "encoding=\"")) != NULL) {
+		encoding += 9;
+		extract_quote(encoding, '"');
+		if (g_strcmp0(encoding, CS_INTERNAL) != 0)
+			conv = conv_codeset_strdup(body, encoding, CS_INTERNAL);
+		if (conv != NULL)
+			body = conv;
+	}
+
+	ret = xml_sax_parse(body, path, handler, data);
+
+	g_free(conv);
+	g_free(contents);
+
+	return ret;
+}
+
 gint xml_get_dtd(XMLFile *file)
 {
 	gchar buf[XMLBUFSIZE];
@@ -420,17 +699,21 @@ gchar *xml_get_element(XMLFile *file)
 	return new_str;
 }
 
+/* reads the next chunk of the file, not just a line: address books
+ * usually hold few but long lines */
 static gint xml_read_line(XMLFile *file)
 {
 	gchar buf[XMLBUFSIZE];
+	gsize len;
 	gint index;
 
-	if (claws_fgets(buf, sizeof(buf), file->fp) == NULL)
+	len = claws_fread(buf, 1, sizeof(buf), file->fp);
+	if (len == 0)
 		return -1;
 
 	index = file->bufp - file->buf->str;
 
-	g_string_append(file->buf, buf);
+	g_string_append_len(file->buf, buf, len);
 
 	file->bufp = file->buf->str + index;
 
@@ -441,8 +724,10 @@ static void xml_truncate_buf(XMLFile *file)
 {
 	gint len;
 
+	/* only drop what was parsed once it is half the buffer, not after
+	 * each tag, or every tag would move the rest of the chunk */
 	len = file->bufp - file->buf->str;
-	if (len > 0) {
+	if (len > 0 && len >= file->buf->len / 2) {
 		g_string_erase(file->buf, 0, len);
 		file->bufp = file->buf->str;
 	}
@@ -515,7 +800,7 @@ void xml_tag_add_attr(XMLTag *tag, XMLAttr *attr)
 	tag->attr = g_list_prepend(tag->attr, attr);
 }
 
-static XMLTag *xml_copy_tag(XMLTag *tag)
+XMLTag *xml_copy_tag(XMLTag *tag)
 {
 	XMLTag *new_tag;
 	XMLAttr *attr;
@@ -526,7 +811,7 @@ static XMLTag *xml_copy_tag(XMLTag *tag)
 		attr = xml_copy_attr((XMLAttr *)list->data);
 		xml_tag_add_attr(new_tag, attr);
 	}
-	tag->attr = g_list_reverse(tag->attr);
+	new_tag->attr = g_list_reverse(new_tag->attr);
 
 	return new_tag;
 }
@@ -581,35 +866,52 @@ static gint xml_unescape_str(gchar *str)
 	return 0;
 }
 
-gint xml_file_put_escape_str(FILE *fp, const gchar *str)
+void xml_string_append_escape(GString *str, const gchar *text)
 {
-	const gchar *p;
-	int result = 0;
-	cm_return_val_if_fail(fp != NULL, -1);
+	cm_return_if_fail(str != NULL);
 
-	if (!str) return 0;
+	if (!text) return;
+
+	while (*text != '\0') {
+		gsize len = strcspn(text, "<>&'\"");
 
-	for (p = str; *p != '\0'; p++) {
-		switch (*p) {
+		g_string_append_len(str, text, len);
+		text += len;
+		switch (*text) {
 		case '<':
-			result = claws_fputs("&lt;", fp);
+			g_string_append(str, "&lt;");
 			break;
 		case '>':
-			result = claws_fputs("&gt;", fp);
+			g_string_append(str, "&gt;");
 			break;
 		case '&':
-			result = claws_fputs("&amp;", fp);
+			g_string_append(str, "&amp;");
 			break;
 		case '\'':
-			result = claws_fputs("&apos;", fp);
+			g_string_append(str, "&apos;");
 			break;
 		case '\"':
-			result = claws_fputs("&quot;", fp);
+			g_string_append(str, "&quot;");
 			break;
 		default:
-			result = claws_fputc(*p, fp);
+			return;
 		}
+		text++;
 	}
+}
+
+gint xml_file_put_escape_str(FILE *fp, const gchar *str)
+{
+	GString *buf;
+	int result;
+	cm_return_val_if_fail(fp != NULL, -1);
+
+	if (!str) return 0;
+
+	buf = g_string_sized_new(strlen(str) + 16);
+	xml_string_append_escape(buf, str);
+	result = claws_fwrite(buf->str, 1, buf->len, fp) < buf->len ? EOF : 0;
+	g_string_free(buf, TRUE);
 
 	return (result == EOF ? -1 : 0);
 }
@@ -649,7 +951,7 @@ void xml_free_tree(GNode *node)
 	g_node_destroy(node);
 }
 
-static void xml_free_tag(XMLTag *tag)
+void xml_free_tag(XMLTag *tag)
 {
 	if (!tag) return;
 
@@ -688,66 +990,91 @@ static gint xml_get_parenthesis(XMLFile *file, gchar *buf, gint len)
 	return 0;
 }
 
-#define TRY(func) \
-if (!(func)) \
-{ \
-	g_warning("failed to write part of XML tree"); \
-	return -1; \
-} \
-
-static int xml_write_tree_recursive(GNode *node, FILE *fp)
+static void xml_string_append_indent(GString *str, guint depth)
 {
-	gint i, depth;
-	XMLTag *tag;
-	GList *cur;
-
-	cm_return_val_if_fail(node != NULL, -1);
-	cm_return_val_if_fail(fp != NULL, -1);
+	guint i;
 
-	depth = g_node_depth(node) - 1;
 	for (i = 0; i < depth; i++)
-		TRY(claws_fputs("    ", fp) != EOF);
+		g_string_append(str, "    ");
+}
 
-	tag = ((XMLNode *) node->data)->tag;
+/* xml_string_append_tag() - appends the start-tag of tag, on a line of
+ * its own, or the whole element if empty */
+void xml_string_append_tag(GString *str, XMLTag *tag, guint depth,
+			   gboolean empty)
+{
+	GList *cur;
 
-	TRY(fprintf(fp, "<%s", tag->tag) > 0);
+	cm_return_if_fail(str != NULL);
+	cm_return_if_fail(tag != NULL);
+
+	xml_string_append_indent(str, depth);
+	g_string_append_c(str, '<');
+	g_string_append(str, tag->tag);
 
 	for (cur = tag->attr; cur != NULL; cur = g_list_next(cur)) {
 		XMLAttr *attr = (XMLAttr *) cur->data;
 
-		TRY(fprintf(fp, " %s=\"", attr->name) > 0);
-		TRY(xml_file_put_escape_str(fp, attr->value) == 0);
-		TRY(claws_fputs("\"", fp) != EOF);
-		
+		g_string_append_c(str, ' ');
+		g_string_append(str, attr->name);
+		g_string_append(str, "=\"");
+		xml_string_append_escape(str, attr->value);
+		g_string_append_c(str, '"');
 	}
 
-	if (node->children) {
-		GNode *child;
-		TRY(claws_fputs(">\n", fp) != EOF);
-
-		child = node->children;
-		while (child) {
-			GNode *cur;
+	g_string_append(str, empty ? " />\n" : ">\n");
+}
 
-			cur = child;
-			child = cur->next;
-			TRY(xml_write_tree_recursive(cur, fp) == 0);
-		}
+void xml_string_append_end_tag(GString *str, const gchar *name, guint depth)
+{
+	cm_return_if_fail(str != NULL);
+	cm_return_if_fail(name != NULL);
 
-		for (i = 0; i < depth; i++)
-			TRY(claws_fputs("    ", fp) != EOF);
-		TRY(fprintf(fp, "</%s>\n", tag->tag) > 0);
-	} else
-		TRY(claws_fputs(" />\n", fp) != EOF);
-	
-	return 0;
+	xml_string_append_indent(str, depth);
+	g_string_append(str, "</");
+	g_string_append(str, name);
+	g_string_append(str, ">\n");
 }
 
-#undef TRY
+/* xml_string_append_tree() - appends the elements of the tree, as
+ * xml_write_tree() writes them, node being indented depth times */
+void xml_string_append_tree(GString *str, GNode *node, guint depth)
+{
+	XMLTag *tag;
+	GNode *child;
+
+	cm_return_if_fail(str != NULL);
+	cm_return_if_fail(node != NULL);
+
+	tag = ((XMLNode *) node->data)->tag;
+
+	xml_string_append_tag(str, tag, depth, node->children == NULL);
+	if (node->children == NULL)
+		return;
+
+	for (child = node->children; child != NULL; child = child->next)
+		xml_string_append_tree(str, child, depth + 1);
+	xml_string_append_end_tag(str, tag->tag, depth);
+}
 
 int xml_write_tree(GNode *node, FILE *fp)
 {
-	return xml_write_tree_recursive(node, fp);
+	GString *str;
+	int ret = 0;
+
+	cm_return_val_if_fail(node != NULL, -1);
+	cm_return_val_if_fail(fp != NULL, -1);
+
+	/* built first, then written at once */
+	str = g_string_sized_new(XMLBUFSIZE);
+	xml_string_append_tree(str, node, g_node_depth(node) - 1);
+	if (claws_fwrite(str->str, 1, str->len, fp) < str->len) {
+		g_warning("failed to write part of XML tree");
+		ret = -1;
+	}
+	g_string_free(str, TRUE);
+
+	return ret;
 }
 
 static gpointer copy_node_func(gpointer nodedata, gpointer data)
@@ -29,6 +29,7 @@ typedef struct _XMLAttr		XMLAttr;
 typedef struct _XMLTag		XMLTag;
 typedef struct _XMLNode		XMLNode;
 typedef struct _XMLFile		XMLFile;
+typedef struct _XMLSaxHandler	XMLSaxHandler;
 
 struct _XMLAttr
 {
@@ -66,9 +67,26 @@ struct _XMLFile
 	gboolean is_empty_element;
 };
 
+/* Handler of xml_sax_parse_file(). The tag, its attributes and the
+ * text are only valid during the call, the tag and attribute names are
+ * interned. A negative return value stops the parsing. */
+struct _XMLSaxHandler
+{
+	gint (*start_element)	(XMLTag		*tag,
+				 gpointer	 data);
+	gint (*end_element)	(const gchar	*name,
+				 gpointer	 data);
+	/* character data of an element, stripped, never empty */
+	gint (*text)		(const gchar	*text,
+				 gpointer	 data);
+};
+
 XMLFile *xml_open_file		(const gchar	*path);
 void     xml_close_file		(XMLFile	*file);
 GNode   *xml_parse_file		(const gchar	*path);
+gint     xml_sax_parse_file	(const gchar	*path,
+				 const XMLSaxHandler *handler,
+				 gpointer	 data);
 
 gint xml_get_dtd		(XMLFile	*file);
 gint xml_parse_next_tag		(XMLFile	*file);
@@ -84,6 +102,7 @@ XMLNode *xml_node_new		(XMLTag		*tag,
 				 const gchar	*text);
 
 XMLTag	*xml_tag_new		(const gchar	*tag);
+XMLTag	*xml_copy_tag		(XMLTag		*tag);
 XMLAttr *xml_attr_new		(const gchar	*name,
 				 const gchar	*value);
 XMLAttr *xml_attr_new_int	(const gchar	*name,
@@ -97,6 +116,20 @@ gint xml_file_put_escape_str	(FILE		*fp,
 
 gint xml_file_put_xml_decl	(FILE		*fp);
 
+void xml_string_append_escape	(GString	*str,
+				 const gchar	*text);
+void xml_string_append_tag	(GString	*str,
+				 XMLTag		*tag,
+				 guint		 depth,
+				 gboolean	 empty);
+void xml_string_append_end_tag	(GString	*str,
+				 const gchar	*name,
+				 guint		 depth);
+void xml_string_append_tree	(GString	*str,
+				 GNode		*node,
+				 guint		 depth);
+
+void xml_free_tag		(XMLTag		*tag);
 void xml_free_tree		(GNode		*node);
 
 int  xml_write_tree		(GNode		*node,
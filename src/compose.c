@@ -316,6 +316,7 @@ static gint compose_write_body_to_file		(Compose	*compose,
 static gint compose_remove_reedit_target	(Compose	*compose,
 						 gboolean	 force);
 static void compose_remove_draft			(Compose	*compose);
+static gboolean compose_save_journal		(Compose	*compose);
 static ComposeQueueResult compose_queue_sub			(Compose	*compose,
 						 gint		*msgnum,
 						 FolderItem	**item,
@@ -335,6 +336,7 @@ static void compose_convert_header		(Compose	*compose,
 						 gboolean	 addr_field);
 
 static void compose_attach_info_free		(AttachInfo	*ainfo);
+static void compose_attach_encode		(AttachInfo	*ainfo);
 static void compose_attach_remove_selected	(GtkAction	*action,
 						 gpointer	 data);
 
@@ -3885,6 +3887,8 @@ static gboolean compose_attach_append(Compose *compose, const gchar *file,
 	ainfo->size = (goffset)size;
 	size_text = to_human_readable((goffset)size);
 
+	compose_attach_encode(ainfo);
+
 	store = GTK_LIST_STORE(gtk_tree_view_get_model
 			(GTK_TREE_VIEW(compose->attach_clist)));
 		
@@ -4501,39 +4505,9 @@ static gboolean compose_beautify_paragraph(Compose *compose, GtkTextIter *par_it
 
 	/* go until paragraph end (empty line) */
 	while (start || !gtk_text_iter_ends_line(&iter)) {
-		gchar *scanpos = NULL;
-		/* parse table - in order of priority */
-		struct table {
-			const gchar *needle; /* token */
-
-			/* token search function */
-			gchar    *(*search)	(const gchar *haystack,
-						 const gchar *needle);
-			/* part parsing function */
-			gboolean  (*parse)	(const gchar *start,
-						 const gchar *scanpos,
-						 const gchar **bp_,
-						 const gchar **ep_,
-						 gboolean hdr);
-			/* part to URI function */
-			gchar    *(*build_uri)	(const gchar *bp,
-						 const gchar *ep);
-		};
-
-		static struct table parser[] = {
-			{"http://",  strcasestr, get_uri_part,   make_uri_string},
-			{"https://", strcasestr, get_uri_part,   make_uri_string},
-			{"ftp://",   strcasestr, get_uri_part,   make_uri_string},
-			{"sftp://",  strcasestr, get_uri_part,   make_uri_string},
-			{"gopher://",strcasestr, get_uri_part,   make_uri_string},
-			{"www.",     strcasestr, get_uri_part,   make_http_string},
-			{"mailto:",  strcasestr, get_uri_part,   make_uri_string},
-			{"@",        strcasestr, get_email_part, make_email_string}
-		};
-		const gint PARSE_ELEMS = sizeof parser / sizeof parser[0];
-		gint last_index = PARSE_ELEMS;
-		gint  n;
-		gchar *o_walk = NULL, *walk = NULL, *bp = NULL, *ep = NULL;
+		URIPart part;
+		gchar *walk = NULL;
+		const gchar *scanpos;
 		gint walk_pos;
 		
 		start = FALSE;
@@ -4656,42 +4630,19 @@ colorize:
 		while (!gtk_text_iter_ends_line(&end_of_line)) {
 			gtk_text_iter_forward_char(&end_of_line);
 		}
-		o_walk = walk = gtk_text_buffer_get_text(buffer, &iter, &end_of_line, FALSE);
+		walk = gtk_text_buffer_get_text(buffer, &iter, &end_of_line, FALSE);
 
 		nouri_start = gtk_text_iter_get_offset(&iter);
 		nouri_stop = gtk_text_iter_get_offset(&end_of_line);
 
 		walk_pos = gtk_text_iter_get_offset(&iter);
-		/* FIXME: this looks phony. scanning for anything in the parse table */
-		for (n = 0; n < PARSE_ELEMS; n++) {
-			gchar *tmp;
-
-			tmp = parser[n].search(walk, parser[n].needle);
-			if (tmp) {
-				if (scanpos == NULL || tmp < scanpos) {
-					scanpos = tmp;
-					last_index = n;
-				}
-			}					
-		}
-
-		bp = ep = 0;
-		if (scanpos) {
-			/* check if URI can be parsed */
-			if (parser[last_index].parse(walk, scanpos, (const gchar **)&bp,
-					(const gchar **)&ep, FALSE)
-			    && (size_t) (ep - bp - 1) > strlen(parser[last_index].needle)) {
-					walk = ep;
-			} else
-				walk = scanpos +
-					strlen(parser[last_index].needle);
-		} 
-		if (bp && ep) {
-			uri_start = walk_pos + (bp - o_walk);
-			uri_stop  = walk_pos + (ep - o_walk);
+		scanpos = walk;
+		if (get_next_uri_part(&scanpos, URI_SCAN_GOPHER, &part)) {
+			uri_start = walk_pos + (part.bp - walk);
+			uri_stop  = walk_pos + (part.ep - walk);
 		}
-		g_free(o_walk);
-		o_walk = NULL;
+		g_free(walk);
+		walk = NULL;
 		gtk_text_iter_forward_line(&iter);
 		g_free(quote_str);
 		quote_str = NULL;
@@ -6386,6 +6337,7 @@ static int compose_add_attachments(Compose *compose, MimeInfo *parent)
 #endif
 	goffset size;
 	gchar *type, *subtype;
+	const gchar *encoded;
 	GtkTreeModel *model;
 	GtkTreeIter iter;
 
@@ -6482,7 +6434,19 @@ static int compose_add_attachments(Compose *compose, MimeInfo *parent)
 				ainfo->encoding = ENC_BASE64;
 		}
 
-		procmime_encode_content(mimepart, ainfo->encoding);
+		/* use what was encoded in the background if it is still
+		 * good, text encoded in base64 has to be canonicalized */
+		if ((ainfo->encoding != ENC_BASE64 ||
+		     (mimepart->type != MIMETYPE_TEXT &&
+		      mimepart->type != MIMETYPE_MESSAGE)) &&
+		    (encoded = attach_encoder_get_result(ainfo->encoder,
+				ainfo->file, ainfo->encoding, &size)) != NULL) {
+			g_free(mimepart->data.filename);
+			mimepart->data.filename = g_strdup(encoded);
+			mimepart->length = size;
+			mimepart->encoding_type = ainfo->encoding;
+		} else
+			procmime_encode_content(mimepart, ainfo->encoding);
 
 		g_node_append(parent->node, mimepart->node);
 	} while (gtk_tree_model_iter_next(model, &iter));
@@ -9192,6 +9156,12 @@ static void compose_destroy(Compose *compose)
 	clipboard = gtk_clipboard_get(GDK_SELECTION_PRIMARY);
 	gtk_text_buffer_remove_selection_clipboard(buffer, clipboard);
 
+	/* closed after being sent, saved, or discarded */
+	if (compose->journal) {
+		compose_journal_remove(compose->journal);
+		compose_journal_free(compose->journal);
+	}
+
 	message_search_close(compose);
 	gtk_widget_destroy(compose->window);
 	toolbar_destroy(compose->toolbar);
@@ -9202,6 +9172,7 @@ static void compose_destroy(Compose *compose)
 
 static void compose_attach_info_free(AttachInfo *ainfo)
 {
+	attach_encoder_free(ainfo->encoder);
 	g_free(ainfo->file);
 	g_free(ainfo->content_type);
 	g_free(ainfo->name);
@@ -9209,6 +9180,21 @@ static void compose_attach_info_free(AttachInfo *ainfo)
 	g_free(ainfo);
 }
 
+/* Starts encoding the attachment in the background, unless it has to
+ * be canonicalized first: that is done when the message is written. */
+static void compose_attach_encode(AttachInfo *ainfo)
+{
+	attach_encoder_free(ainfo->encoder);
+	ainfo->encoder = NULL;
+
+	if (ainfo->encoding == ENC_BASE64 &&
+	    (!g_ascii_strncasecmp(ainfo->content_type, "text/", 5) ||
+	     !g_ascii_strncasecmp(ainfo->content_type, "message/", 8)))
+		return;
+
+	ainfo->encoder = attach_encoder_new(ainfo->file, ainfo->encoding);
+}
+
 static void compose_attach_update_label(Compose *compose)
 {
 	GtkTreeIter iter;
@@ -9407,6 +9393,8 @@ static void compose_attach_property(GtkAction *action, gpointer data)
 		if (size)
 			ainfo->size = (goffset)size;
 
+		compose_attach_encode(ainfo);
+
 		/* update tree store */
 		text = to_human_readable(ainfo->size);
 		gtk_tree_model_get_iter(model, &iter, path);
@@ -10294,6 +10282,413 @@ static void compose_send_later_cb(GtkAction *action, gpointer data)
 	toolbar_main_set_sensitive(mainwindow_get_mainwindow());
 }
 
+/* records msginfo, the message replied to or forwarded, as the draft
+ * does: folder, number and Message-ID */
+static void compose_journal_info_msg(GString *info, const gchar *key,
+				     MsgInfo *msginfo)
+{
+	gchar *folderid = NULL;
+
+	if (msginfo == NULL || msginfo->msgid == NULL)
+		return;
+
+	if (msginfo->folder)
+		folderid = folder_item_get_identifier(msginfo->folder);
+	if (folderid == NULL)
+		folderid = g_strdup("NULL");
+
+	g_string_append_printf(info, "%s%s\t%d\t%s\n", key, folderid,
+			       msginfo->msgnum, msginfo->msgid);
+	g_free(folderid);
+}
+
+/* the threading headers may have been folded */
+static void compose_journal_info_str(GString *info, const gchar *key,
+				     const gchar *value)
+{
+	gchar *line;
+
+	if (value == NULL || *value == '\0')
+		return;
+
+	line = g_strdup(value);
+	g_strdelimit(line, "\r\n", ' ');
+	g_string_append_printf(info, "%s%s\n", key, line);
+	g_free(line);
+}
+
+static gchar *compose_get_journal_info(Compose *compose)
+{
+	GString *info = g_string_new(NULL);
+	GSList *list;
+
+	g_string_append_printf(info, "X-Claws-Account-Id:%d\n",
+			       compose->account->account_id);
+	g_string_append_printf(info, "Mode:%d\n", compose->mode);
+	if (compose->folder) {
+		gchar *folderid = folder_item_get_identifier(compose->folder);
+
+		compose_journal_info_str(info, "Folder:", folderid);
+		g_free(folderid);
+	}
+	/* the message being edited, that saving the draft replaces */
+	if (compose->mode == COMPOSE_REEDIT && compose->targetinfo &&
+	    compose->targetinfo->folder) {
+		gchar *folderid = folder_item_get_identifier(compose->targetinfo->folder);
+
+		if (folderid)
+			g_string_append_printf(info, "Target:%s\t%d\n", folderid,
+					       compose->targetinfo->msgnum);
+		g_free(folderid);
+	}
+
+	if (gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(compose->savemsg_checkbtn))) {
+		gchar *savefolderid = compose_get_save_to(compose);
+
+		compose_journal_info_str(info, "SCF:", savefolderid);
+		g_free(savefolderid);
+	}
+	if (compose->return_receipt)
+		g_string_append(info, "RRCPT:1\n");
+	g_string_append_printf(info, "X-Priority: %d\n", compose->priority);
+	if (compose->privacy_system) {
+		g_string_append_printf(info, "X-Claws-Sign:%d\n", compose->use_signing);
+		g_string_append_printf(info, "X-Claws-Encrypt:%d\n", compose->use_encryption);
+		g_string_append_printf(info, "X-Claws-Privacy-System:%s\n", compose->privacy_system);
+	}
+	compose_journal_info_msg(info, "RMID:", compose->replyinfo);
+	compose_journal_info_msg(info, "FMID:", compose->fwdinfo);
+	compose_journal_info_str(info, "In-Reply-To:", compose->inreplyto);
+	compose_journal_info_str(info, "References:", compose->references);
+	g_string_append_printf(info, "X-Claws-Auto-Wrapping:%d\n", compose->autowrap);
+	g_string_append_printf(info, "X-Claws-Auto-Indent:%d\n", compose->autoindent);
+
+	g_string_append_printf(info, "Subject:%s\n",
+			       gtk_entry_get_text(GTK_ENTRY(compose->subject_entry)));
+
+	for (list = compose->header_list; list; list = list->next) {
+		ComposeHeaderEntry *headerentry = (ComposeHeaderEntry *)list->data;
+		const gchar *headerentryname;
+		const gchar *value;
+
+		headerentryname = gtk_entry_get_text(GTK_ENTRY(gtk_bin_get_child(GTK_BIN((headerentry->combo)))));
+		value = gtk_entry_get_text(GTK_ENTRY(headerentry->entry));
+		if (value == NULL || *value == '\0')
+			continue;
+		g_string_append_printf(info, "Header:%s\t%s\n", headerentryname, value);
+	}
+
+	return g_string_free(info, FALSE);
+}
+
+static gchar *compose_get_journal_attachments(Compose *compose)
+{
+	GtkTreeModel *model = gtk_tree_view_get_model(GTK_TREE_VIEW(compose->attach_clist));
+	GtkTreeIter iter;
+	GString *attachments = g_string_new(NULL);
+	AttachInfo *ainfo;
+
+	if (gtk_tree_model_get_iter_first(model, &iter)) {
+		do {
+			gtk_tree_model_get(model, &iter, COL_DATA, &ainfo, -1);
+			g_string_append_printf(attachments, "%s\t%s\t%s\t%s\n",
+					       ainfo->file,
+					       ainfo->content_type ? ainfo->content_type : "",
+					       ainfo->name ? ainfo->name : "",
+					       ainfo->charset ? ainfo->charset : "");
+		} while (gtk_tree_model_iter_next(model, &iter));
+	}
+
+	return g_string_free(attachments, FALSE);
+}
+
+/* compose_save_journal() - records the message in the compose journal,
+ * so that it can be recovered after a crash. Only the changes since the
+ * last call are written, and attachments are only referenced. */
+static gboolean compose_save_journal(Compose *compose)
+{
+	GtkTextBuffer *buffer;
+	GtkTextIter start, end;
+	gchar *info, *attachments, *body;
+	gint ret;
+
+	if (compose->journal == NULL) {
+		gchar *dir, *path;
+
+		dir = g_strconcat(get_rc_dir(), G_DIR_SEPARATOR_S,
+				  COMPOSE_JOURNAL_DIR, NULL);
+		if (!is_dir_exist(dir) && make_dir_hier(dir) < 0) {
+			g_free(dir);
+			return FALSE;
+		}
+		path = g_strdup_printf("%s%c%ld.%p", dir, G_DIR_SEPARATOR,
+				       (long)time(NULL), compose);
+		compose->journal = compose_journal_new(path);
+		g_free(path);
+		g_free(dir);
+	}
+
+	buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(compose->text));
+	gtk_text_buffer_get_start_iter(buffer, &start);
+	gtk_text_buffer_get_end_iter(buffer, &end);
+	body = gtk_text_buffer_get_text(buffer, &start, &end, FALSE);
+	info = compose_get_journal_info(compose);
+	attachments = compose_get_journal_attachments(compose);
+
+	ret = compose_journal_save(compose->journal, info, attachments, body);
+
+	g_free(body);
+	g_free(info);
+	g_free(attachments);
+
+	if (ret < 0) {
+		g_warning("couldn't save compose journal %s",
+			  compose_journal_get_path(compose->journal));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* finds the message recorded by compose_journal_info_msg() */
+static MsgInfo *compose_journal_find_msg(const gchar *value)
+{
+	gchar **tokens = g_strsplit(value, "\t", 0);
+	MsgInfo *msginfo = NULL;
+
+	if (tokens[0] && tokens[1] && tokens[2]) {
+		FolderItem *item = folder_find_item_from_identifier(tokens[0]);
+
+		if (item != NULL)
+			msginfo = folder_item_get_msginfo_by_msgid(item, tokens[2]);
+	}
+	g_strfreev(tokens);
+
+	return msginfo;
+}
+
+/* finds the message being edited when the journal was written */
+static MsgInfo *compose_journal_find_target(const gchar *value)
+{
+	gchar **tokens = g_strsplit(value, "\t", 2);
+	MsgInfo *msginfo = NULL;
+
+	if (tokens[0] && tokens[1]) {
+		FolderItem *item = folder_find_item_from_identifier(tokens[0]);
+
+		if (item != NULL)
+			msginfo = folder_item_get_msginfo(item, atoi(tokens[1]));
+	}
+	g_strfreev(tokens);
+
+	return msginfo;
+}
+
+#define JOURNAL_KEY(line, key) (!strncmp(line, key, strlen(key)))
+#define JOURNAL_VALUE(line, key) ((line) + strlen(key))
+
+static void compose_reopen_journal(const gchar *path, const gchar *info,
+				   const gchar *attachments, const gchar *body)
+{
+	Compose *compose;
+	PrefsAccount *account = NULL;
+	FolderItem *folder = NULL;
+	ComposeMode mode = COMPOSE_NEW;
+	MsgInfo *targetinfo = NULL, *replyinfo = NULL, *fwdinfo = NULL;
+	gchar *privacy_system = NULL;
+	gboolean use_signing = FALSE, use_encryption = FALSE;
+	gboolean autowrap = prefs_common.autowrap;
+	gboolean autoindent = prefs_common.auto_indent;
+	gint priority = PRIORITY_NORMAL;
+	GtkTextBuffer *buffer;
+	GtkTextIter iter;
+	gchar **lines;
+	gint i;
+
+	lines = g_strsplit(info, "\n", -1);
+	for (i = 0; lines[i] != NULL; i++) {
+		const gchar *line = lines[i];
+
+		if (JOURNAL_KEY(line, "X-Claws-Account-Id:"))
+			account = account_find_from_id(atoi(JOURNAL_VALUE(line, "X-Claws-Account-Id:")));
+		else if (JOURNAL_KEY(line, "Mode:"))
+			mode = atoi(JOURNAL_VALUE(line, "Mode:"));
+		else if (JOURNAL_KEY(line, "Folder:"))
+			folder = folder_find_item_from_identifier(JOURNAL_VALUE(line, "Folder:"));
+		else if (JOURNAL_KEY(line, "Target:") && targetinfo == NULL)
+			targetinfo = compose_journal_find_target(JOURNAL_VALUE(line, "Target:"));
+		else if (JOURNAL_KEY(line, "RMID:") && replyinfo == NULL)
+			replyinfo = compose_journal_find_msg(JOURNAL_VALUE(line, "RMID:"));
+		else if (JOURNAL_KEY(line, "FMID:") && fwdinfo == NULL)
+			fwdinfo = compose_journal_find_msg(JOURNAL_VALUE(line, "FMID:"));
+		else if (JOURNAL_KEY(line, "X-Priority: "))
+			priority = atoi(JOURNAL_VALUE(line, "X-Priority: "));
+		else if (JOURNAL_KEY(line, "X-Claws-Sign:"))
+			use_signing = atoi(JOURNAL_VALUE(line, "X-Claws-Sign:"));
+		else if (JOURNAL_KEY(line, "X-Claws-Encrypt:"))
+			use_encryption = atoi(JOURNAL_VALUE(line, "X-Claws-Encrypt:"));
+		else if (JOURNAL_KEY(line, "X-Claws-Privacy-System:")) {
+			g_free(privacy_system);
+			privacy_system = g_strdup(JOURNAL_VALUE(line, "X-Claws-Privacy-System:"));
+		} else if (JOURNAL_KEY(line, "X-Claws-Auto-Wrapping:"))
+			autowrap = atoi(JOURNAL_VALUE(line, "X-Claws-Auto-Wrapping:"));
+		else if (JOURNAL_KEY(line, "X-Claws-Auto-Indent:"))
+			autoindent = atoi(JOURNAL_VALUE(line, "X-Claws-Auto-Indent:"));
+	}
+	if (!account)
+		account = cur_account;
+	if (!account) {
+		g_strfreev(lines);
+		g_free(privacy_system);
+		procmsg_msginfo_free(&targetinfo);
+		procmsg_msginfo_free(&replyinfo);
+		procmsg_msginfo_free(&fwdinfo);
+		return;
+	}
+
+	/* the message being edited may be gone since, and a redirection
+	 * has nothing of its own to recover */
+	if (mode < COMPOSE_REPLY || mode > COMPOSE_REEDIT ||
+	    mode == COMPOSE_REDIRECT ||
+	    (mode == COMPOSE_REEDIT && targetinfo == NULL))
+		mode = COMPOSE_NEW;
+	if (mode != COMPOSE_REEDIT)
+		procmsg_msginfo_free(&targetinfo);
+
+	compose = compose_create(account, folder, mode, FALSE);
+
+	cm_toggle_menu_set_active_full(compose->ui_manager, "Menu/Edit/AutoWrap", autowrap);
+	cm_toggle_menu_set_active_full(compose->ui_manager, "Menu/Edit/AutoIndent", autoindent);
+	compose->autowrap = autowrap;
+	compose->autoindent = autoindent;
+	compose->targetinfo = targetinfo;
+	compose->replyinfo = replyinfo;
+	compose->fwdinfo = fwdinfo;
+
+	compose->updating = TRUE;
+	compose->priority = priority;
+	compose_update_priority_menu_item(compose);
+
+	if (privacy_system != NULL) {
+		g_free(compose->privacy_system);
+		compose->privacy_system = privacy_system;
+		compose_use_signing(compose, use_signing);
+		compose_use_encryption(compose, use_encryption);
+		compose_update_privacy_system_menu_item(compose, FALSE);
+	}
+
+	for (i = 0; lines[i] != NULL; i++) {
+		const gchar *line = lines[i];
+
+		if (JOURNAL_KEY(line, "Subject:")) {
+			gtk_entry_set_text(GTK_ENTRY(compose->subject_entry),
+					   JOURNAL_VALUE(line, "Subject:"));
+		} else if (JOURNAL_KEY(line, "Header:")) {
+			gchar **header = g_strsplit(JOURNAL_VALUE(line, "Header:"), "\t", 2);
+
+			if (header[0] && header[1])
+				compose_add_header_entry(compose, header[0],
+							 header[1], PREF_NONE);
+			g_strfreev(header);
+		} else if (JOURNAL_KEY(line, "In-Reply-To:")) {
+			g_free(compose->inreplyto);
+			compose->inreplyto = g_strdup(JOURNAL_VALUE(line, "In-Reply-To:"));
+		} else if (JOURNAL_KEY(line, "References:")) {
+			g_free(compose->references);
+			compose->references = g_strdup(JOURNAL_VALUE(line, "References:"));
+		} else if (JOURNAL_KEY(line, "SCF:")) {
+			gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(compose->savemsg_checkbtn), TRUE);
+			gtk_widget_set_sensitive(GTK_WIDGET(compose->savemsg_combo), TRUE);
+			compose_set_save_to(compose, JOURNAL_VALUE(line, "SCF:"));
+		} else if (JOURNAL_KEY(line, "RRCPT:")) {
+			if (atoi(JOURNAL_VALUE(line, "RRCPT:")))
+				cm_toggle_menu_set_active_full(compose->ui_manager,
+						"Menu/Options/RequestRetRcpt", TRUE);
+		}
+	}
+	g_strfreev(lines);
+
+	buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(compose->text));
+	SIGNAL_BLOCK(buffer);
+	gtk_text_buffer_get_start_iter(buffer, &iter);
+	gtk_text_buffer_insert(buffer, &iter, body, -1);
+	SIGNAL_UNBLOCK(buffer);
+
+	lines = g_strsplit(attachments, "\n", -1);
+	for (i = 0; lines[i] != NULL; i++) {
+		gchar **attach = g_strsplit(lines[i], "\t", 4);
+
+		if (attach[0] && *attach[0] && attach[1] && attach[2] && attach[3])
+			compose_attach_append(compose, attach[0], attach[2],
+					      *attach[1] ? attach[1] : NULL,
+					      *attach[3] ? attach[3] : NULL);
+		g_strfreev(attach);
+	}
+	g_strfreev(lines);
+
+	compose->updating = FALSE;
+	compose->draft_timeout_tag = COMPOSE_DRAFT_TIMEOUT_UNSET;
+	compose->modified = TRUE;
+	compose_set_title(compose);
+
+	if (compose->deferred_destroy) {
+		compose_destroy(compose);
+		return;
+	}
+
+	/* keep it safe in the new journal before forgetting the old one */
+	if (compose_save_journal(compose) &&
+	    strcmp(compose_journal_get_path(compose->journal), path))
+		claws_unlink(path);
+}
+
+#undef JOURNAL_KEY
+#undef JOURNAL_VALUE
+
+/* compose_reopen_journals() - reopens the messages left in compose
+ * journals by a crash */
+void compose_reopen_journals(void)
+{
+	gchar *dir = g_strconcat(get_rc_dir(), G_DIR_SEPARATOR_S,
+				 COMPOSE_JOURNAL_DIR, NULL);
+	GDir *dp;
+	const gchar *name;
+	GSList *paths = NULL, *cur;
+
+	if ((dp = g_dir_open(dir, 0, NULL)) == NULL) {
+		g_free(dir);
+		return;
+	}
+	/* list them first, as reopening writes new journals here */
+	while ((name = g_dir_read_name(dp)) != NULL)
+		paths = g_slist_prepend(paths, g_strconcat(dir, G_DIR_SEPARATOR_S,
+							   name, NULL));
+	g_dir_close(dp);
+	g_free(dir);
+
+	for (cur = paths; cur != NULL; cur = cur->next) {
+		gchar *path = (gchar *)cur->data;
+		gchar *info, *attachments, *body;
+
+		/* a snapshot interrupted by the crash, the journal
+		 * still holds the previous one */
+		if (g_str_has_suffix(path, ".tmp")) {
+			claws_unlink(path);
+			continue;
+		}
+		if (compose_journal_read(path, &info, &attachments, &body) < 0) {
+			g_warning("couldn't recover message from %s", path);
+			continue;
+		}
+		debug_print("reopening message from compose journal %s\n", path);
+		compose_reopen_journal(path, info, attachments, body);
+		g_free(info);
+		g_free(attachments);
+		g_free(body);
+	}
+	slist_free_strings_full(paths);
+}
+
+
 #define DRAFTED_AT_EXIT "drafted_at_exit"
 static void compose_register_draft(MsgInfo *info)
 {
@@ -10343,6 +10738,15 @@ gboolean compose_draft (gpointer data, guint action)
 
 	lock = TRUE;
 
+	/* autosaving only records the changes in the journal, the draft
+	 * is written when asked for. Messages to be encrypted are not
+	 * journaled, as it would keep them in clear text. */
+	if (action == COMPOSE_AUTO_SAVE &&
+	    !(compose->privacy_system && compose->use_encryption)) {
+		compose_save_journal(compose);
+		goto unlock;
+	}
+
 	tmp = g_strdup_printf("%s%cdraft.%p", get_tmp_dir(),
 			      G_DIR_SEPARATOR, compose);
 	if ((fp = claws_fopen(tmp, "wb")) == NULL) {
@@ -10503,6 +10907,10 @@ warn_err:
 	}
 	
 	folder_item_scan(draft);
+
+	/* the draft now holds everything */
+	if (compose->journal)
+		compose_journal_remove(compose->journal);
 	
 	if (action == COMPOSE_QUIT_EDITING || action == COMPOSE_DRAFT_FOR_EXIT) {
 		lock = FALSE;
@@ -10791,7 +11199,9 @@ static void compose_print_cb(GtkAction *action, gpointer data)
 {
 	Compose *compose = (Compose *) data;
 
-	compose_draft((gpointer)compose, COMPOSE_AUTO_SAVE);
+	/* printing needs the message as a draft, autosaving doesn't
+	 * write one anymore */
+	compose_draft((gpointer)compose, COMPOSE_KEEP_EDITING);
 	if (compose->targetinfo)
 		messageview_print(compose->targetinfo, FALSE, -1, -1, 0);
 }
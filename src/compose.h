@@ -35,6 +35,8 @@ typedef struct _AttachInfo	AttachInfo;
 #include "template.h"
 #include "viewtypes.h"
 #include "folder.h"
+#include "compose_journal.h"
+#include "attach_encoder.h"
 
 #ifdef USE_ENCHANT
 #include "gtkaspell.h"
@@ -235,6 +237,8 @@ struct _Compose
 	gboolean remove_references;
 
 	gint64 draft_timeout_tag;
+	/* records the changes for autosaving */
+	ComposeJournal *journal;
 	
 	GtkTextTag *no_wrap_tag;
 	GtkTextTag *no_join_tag;
@@ -281,6 +285,8 @@ struct _AttachInfo
 	goffset size;
 	gchar *charset;
 	gboolean insert;
+	/* the content, encoded in the background */
+	AttachEncoder *encoder;
 };
 
 typedef enum
@@ -360,6 +366,7 @@ gboolean compose_close			(Compose *compose);
 void compose_close_toolbar		(Compose *compose);
 void compose_clear_exit_drafts		(void);
 void compose_reopen_exit_drafts		(void);
+void compose_reopen_journals		(void);
 void compose_attach_from_list (Compose *compose, GList *file_list, gboolean free_data);
 void compose_check_for_email_account(Compose *compose);
 
@@ -0,0 +1,365 @@
+/*
+ * Claws Mail -- a GTK+ based, lightweight, and fast e-mail client
+ * Copyright (C) 2026 the Claws Mail team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#include "claws-features.h"
+#endif
+
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "compose_journal.h"
+#include "utils.h"
+#include "file-utils.h"
+
+/* The journal starts with this line, then holds records made of a
+ * "<tag> <start> <removed> <length>\n" line, <length> bytes of data and
+ * a newline:
+ *   I 0 0 <length>		header information of the message
+ *   A 0 0 <length>		attachment references
+ *   B <start> <removed> <length>	replaces <removed> bytes of the
+ *				body at <start> with the data
+ * A snapshot is I, A, then B 0 0 with the whole body. A record cut
+ * short by a crash ends the journal. */
+#define JOURNAL_MAGIC		"Claws-Mail-Compose-Journal 1\n"
+
+/* The journal is rewritten as a snapshot when it gets larger than this
+ * many times the snapshot, plus JOURNAL_SLACK bytes */
+#define JOURNAL_MAX_GROWTH	2
+#define JOURNAL_SLACK		(64 * 1024)
+
+struct _ComposeJournal
+{
+	gchar *path;
+
+	/* what the journal holds, NULL until a snapshot is written */
+	gchar *info;
+	gchar *attachments;
+	GString *body;
+
+	goffset size;
+};
+
+ComposeJournal *compose_journal_new(const gchar *path)
+{
+	ComposeJournal *journal;
+
+	cm_return_val_if_fail(path != NULL, NULL);
+
+	journal = g_new0(ComposeJournal, 1);
+	journal->path = g_strdup(path);
+
+	return journal;
+}
+
+static void compose_journal_reset(ComposeJournal *journal)
+{
+	g_free(journal->info);
+	journal->info = NULL;
+	g_free(journal->attachments);
+	journal->attachments = NULL;
+	if (journal->body)
+		g_string_free(journal->body, TRUE);
+	journal->body = NULL;
+	journal->size = 0;
+}
+
+void compose_journal_free(ComposeJournal *journal)
+{
+	if (!journal)
+		return;
+
+	compose_journal_reset(journal);
+	g_free(journal->path);
+	g_free(journal);
+}
+
+const gchar *compose_journal_get_path(ComposeJournal *journal)
+{
+	cm_return_val_if_fail(journal != NULL, NULL);
+
+	return journal->path;
+}
+
+static gint journal_write_record(FILE *fp, gchar tag, gsize start,
+				 gsize removed, const gchar *data, gsize len,
+				 goffset *size)
+{
+	gchar *head;
+	gsize head_len;
+	gint ret = 0;
+
+	head = g_strdup_printf("%c %" G_GSIZE_FORMAT " %" G_GSIZE_FORMAT
+			       " %" G_GSIZE_FORMAT "\n", tag, start, removed, len);
+	head_len = strlen(head);
+
+	if (claws_fwrite(head, 1, head_len, fp) != head_len ||
+	    (len > 0 && claws_fwrite(data, 1, len, fp) != len) ||
+	    claws_fputc('\n', fp) == EOF)
+		ret = -1;
+	else
+		*size += head_len + len + 1;
+
+	g_free(head);
+	return ret;
+}
+
+static gint journal_write_snapshot(ComposeJournal *journal, const gchar *info,
+				   const gchar *attachments, const gchar *body)
+{
+	gchar *tmp;
+	FILE *fp;
+	goffset size = 0;
+	gint ret = 0;
+
+	tmp = g_strconcat(journal->path, ".tmp", NULL);
+	if ((fp = claws_fopen(tmp, "wb")) == NULL) {
+		FILE_OP_ERROR(tmp, "claws_fopen");
+		g_free(tmp);
+		return -1;
+	}
+	if (change_file_mode_rw(fp, tmp) < 0) {
+		FILE_OP_ERROR(tmp, "chmod");
+		g_warning("can't change file mode");
+	}
+
+	if (claws_fputs(JOURNAL_MAGIC, fp) == EOF)
+		ret = -1;
+	size += strlen(JOURNAL_MAGIC);
+	if (ret == 0)
+		ret = journal_write_record(fp, 'I', 0, 0, info,
+					   strlen(info), &size);
+	if (ret == 0)
+		ret = journal_write_record(fp, 'A', 0, 0, attachments,
+					   strlen(attachments), &size);
+	if (ret == 0)
+		ret = journal_write_record(fp, 'B', 0, 0, body,
+					   strlen(body), &size);
+
+	if (claws_safe_fclose(fp) == EOF)
+		ret = -1;
+	if (ret == 0 && rename_force(tmp, journal->path) < 0) {
+		FILE_OP_ERROR(journal->path, "rename");
+		ret = -1;
+	}
+	if (ret < 0) {
+		claws_unlink(tmp);
+		g_free(tmp);
+		return -1;
+	}
+	g_free(tmp);
+
+	compose_journal_reset(journal);
+	journal->info = g_strdup(info);
+	journal->attachments = g_strdup(attachments);
+	journal->body = g_string_new(body);
+	journal->size = size;
+
+	debug_print("wrote compose journal snapshot %s (%" G_GOFFSET_FORMAT " bytes)\n",
+		    journal->path, size);
+
+	return 0;
+}
+
+/* compose_journal_save() - records info, attachments and body in the
+ * journal. Only what changed since the last call is written. */
+gint compose_journal_save(ComposeJournal *journal, const gchar *info,
+			  const gchar *attachments, const gchar *body)
+{
+	gsize old_len, new_len, prefix = 0, suffix = 0;
+	gboolean info_changed, attachments_changed;
+	goffset size;
+	FILE *fp;
+	gint ret = 0;
+
+	cm_return_val_if_fail(journal != NULL, -1);
+	cm_return_val_if_fail(info != NULL && attachments != NULL && body != NULL, -1);
+
+	new_len = strlen(body);
+
+	if (journal->info == NULL ||
+	    journal->size > JOURNAL_MAX_GROWTH *
+	    (goffset)(strlen(info) + strlen(attachments) + new_len) + JOURNAL_SLACK)
+		return journal_write_snapshot(journal, info, attachments, body);
+
+	info_changed = strcmp(journal->info, info) != 0;
+	attachments_changed = strcmp(journal->attachments, attachments) != 0;
+
+	/* the edited range of the body: what is left between the common
+	 * start and the common end */
+	old_len = journal->body->len;
+	while (prefix < old_len && prefix < new_len &&
+	       journal->body->str[prefix] == body[prefix])
+		prefix++;
+	while (suffix < old_len - prefix && suffix < new_len - prefix &&
+	       journal->body->str[old_len - suffix - 1] == body[new_len - suffix - 1])
+		suffix++;
+
+	if (!info_changed && !attachments_changed &&
+	    prefix + suffix == old_len && old_len == new_len)
+		return 0;
+
+	if ((fp = claws_fopen(journal->path, "ab")) == NULL) {
+		FILE_OP_ERROR(journal->path, "claws_fopen");
+		return -1;
+	}
+
+	size = journal->size;
+	if (info_changed)
+		ret = journal_write_record(fp, 'I', 0, 0, info,
+					   strlen(info), &size);
+	if (ret == 0 && attachments_changed)
+		ret = journal_write_record(fp, 'A', 0, 0, attachments,
+					   strlen(attachments), &size);
+	if (ret == 0 && (prefix + suffix != old_len || old_len != new_len))
+		ret = journal_write_record(fp, 'B', prefix,
+					   old_len - prefix - suffix,
+					   body + prefix,
+					   new_len - prefix - suffix, &size);
+	if (claws_safe_fclose(fp) == EOF)
+		ret = -1;
+
+	if (ret < 0) {
+		/* records appended after a broken one would be lost,
+		 * so start again from a snapshot next time */
+		FILE_OP_ERROR(journal->path, "write");
+		compose_journal_reset(journal);
+		return -1;
+	}
+
+	debug_print("appended %" G_GOFFSET_FORMAT " bytes to compose journal %s\n",
+		    size - journal->size, journal->path);
+
+	if (info_changed) {
+		g_free(journal->info);
+		journal->info = g_strdup(info);
+	}
+	if (attachments_changed) {
+		g_free(journal->attachments);
+		journal->attachments = g_strdup(attachments);
+	}
+	g_string_assign(journal->body, body);
+	journal->size = size;
+
+	return 0;
+}
+
+/* compose_journal_remove() - deletes the journal file, e.g. once the
+ * message has been saved as a draft or sent. The next save writes a new
+ * snapshot. */
+void compose_journal_remove(ComposeJournal *journal)
+{
+	cm_return_if_fail(journal != NULL);
+
+	if (journal->info != NULL && claws_unlink(journal->path) < 0)
+		FILE_OP_ERROR(journal->path, "unlink");
+	compose_journal_reset(journal);
+}
+
+/* compose_journal_read() - replays the journal at path. Returns 0 and
+ * the recorded message if it holds a complete snapshot, -1 otherwise. */
+gint compose_journal_read(const gchar *path, gchar **info,
+			  gchar **attachments, gchar **body)
+{
+	gchar *contents, *p, *end;
+	gsize len;
+	gchar *cur_info = NULL, *cur_attachments = NULL;
+	GString *cur_body = NULL;
+	GError *error = NULL;
+
+	cm_return_val_if_fail(path != NULL, -1);
+	cm_return_val_if_fail(info != NULL && attachments != NULL && body != NULL, -1);
+
+	if (!g_file_get_contents(path, &contents, &len, &error)) {
+		g_warning("couldn't read compose journal %s: %s",
+			  path, error->message);
+		g_error_free(error);
+		return -1;
+	}
+
+	if (len < strlen(JOURNAL_MAGIC) ||
+	    strncmp(contents, JOURNAL_MAGIC, strlen(JOURNAL_MAGIC))) {
+		g_warning("%s is not a compose journal", path);
+		g_free(contents);
+		return -1;
+	}
+
+	p = contents + strlen(JOURNAL_MAGIC);
+	end = contents + len;
+	while (p < end) {
+		gchar *nl, *line;
+		gchar tag;
+		gsize start, removed, n;
+		gint fields;
+
+		if ((nl = memchr(p, '\n', end - p)) == NULL)
+			break;
+		line = g_strndup(p, nl - p);
+		fields = sscanf(line, "%c %" G_GSIZE_FORMAT " %" G_GSIZE_FORMAT
+				" %" G_GSIZE_FORMAT, &tag, &start, &removed, &n);
+		g_free(line);
+		if (fields != 4)
+			break;
+
+		p = nl + 1;
+		if (n >= (gsize)(end - p) || p[n] != '\n') {
+			debug_print("compose journal %s: last record is incomplete\n",
+				    path);
+			break;
+		}
+
+		if (tag == 'I') {
+			g_free(cur_info);
+			cur_info = g_strndup(p, n);
+		} else if (tag == 'A') {
+			g_free(cur_attachments);
+			cur_attachments = g_strndup(p, n);
+		} else if (tag == 'B') {
+			if (cur_body == NULL) {
+				if (start != 0 || removed != 0)
+					break;
+				cur_body = g_string_new(NULL);
+			}
+			if (start > cur_body->len ||
+			    removed > cur_body->len - start)
+				break;
+			g_string_erase(cur_body, start, removed);
+			g_string_insert_len(cur_body, start, p, n);
+		} else
+			break;
+
+		p += n + 1;
+	}
+	g_free(contents);
+
+	if (cur_info == NULL || cur_attachments == NULL || cur_body == NULL) {
+		g_free(cur_info);
+		g_free(cur_attachments);
+		if (cur_body)
+			g_string_free(cur_body, TRUE);
+		return -1;
+	}
+
+	*info = cur_info;
+	*attachments = cur_attachments;
+	*body = g_string_free(cur_body, FALSE);
+
+	return 0;
+}
@@ -0,0 +1,50 @@
+/*
+ * Claws Mail -- a GTK+ based, lightweight, and fast e-mail client
+ * Copyright (C) 2026 the Claws Mail team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __COMPOSE_JOURNAL_H__
+#define __COMPOSE_JOURNAL_H__
+
+#include <glib.h>
+
+/* A compose journal keeps the state of a message being written, so that
+ * it can be recovered after a crash, without writing a draft. It starts
+ * with a snapshot of the message; each save then only appends what
+ * changed since the previous one: the edited range of the body, and the
+ * header and attachment blocks when they differ. Attachments are only
+ * referenced by file name. The journal is rewritten as a new snapshot
+ * once it has grown too much. */
+
+typedef struct _ComposeJournal	ComposeJournal;
+
+ComposeJournal *compose_journal_new	(const gchar	*path);
+void compose_journal_free		(ComposeJournal	*journal);
+
+const gchar *compose_journal_get_path	(ComposeJournal	*journal);
+
+gint compose_journal_save		(ComposeJournal	*journal,
+					 const gchar	*info,
+					 const gchar	*attachments,
+					 const gchar	*body);
+void compose_journal_remove		(ComposeJournal	*journal);
+
+gint compose_journal_read		(const gchar	*path,
+					 gchar		**info,
+					 gchar		**attachments,
+					 gchar		**body);
+
+#endif /* __COMPOSE_JOURNAL_H__ */
@@ -22,10 +22,23 @@
 
 #include "utils.h"
 
+#include "entity.h"
+
 #define ENTITY_MAX_LEN 8
-#define DECODED_MAX_LEN 6
 
-static GHashTable *symbol_table = NULL;
+/* The symbol table is perfect-hashed: a key goes to one of
+ * ENTITY_BUCKETS buckets, each bucket has a seed that sends its keys to
+ * distinct slots of the ENTITY_SLOTS ones. */
+#define ENTITY_BUCKETS	128
+#define ENTITY_SLOTS	512
+
+/* built on the first lookup, which may happen in several threads at
+ * once: 0 until then, then one of these */
+#define ENTITY_HASH_READY	1
+#define ENTITY_HASH_FAILED	2
+static gsize symbol_hash_state = 0;
+static guint16 symbol_seeds[ENTITY_BUCKETS];
+static gint16 symbol_slots[ENTITY_SLOTS];
 
 typedef struct _EntitySymbol EntitySymbol;
 
@@ -317,7 +330,121 @@ static EntitySymbol symbolic_entities[] = {
 	{NULL, NULL}
 };
 
-static gchar* entity_extract_to_buffer(gchar *p, gchar b[])
+static guint32 entity_hash(const gchar *key, guint32 seed)
+{
+	guint32 h = 2166136261u ^ (seed * 16777619u);
+
+	while (*key != '\0') {
+		h ^= (guchar)*key++;
+		h *= 16777619u;
+	}
+	h ^= h >> 15;
+
+	return h;
+}
+
+/* Finds a seed for each bucket, the fullest buckets first */
+static gboolean entity_build_symbol_hash(void)
+{
+	GSList *buckets[ENTITY_BUCKETS] = { NULL };
+	gint order[ENTITY_BUCKETS];
+	gint i, j, n;
+
+	for (i = 0; symbolic_entities[i].key != NULL; ++i) {
+		guint32 b = entity_hash(symbolic_entities[i].key, 0) % ENTITY_BUCKETS;
+		buckets[b] = g_slist_prepend(buckets[b], GINT_TO_POINTER(i));
+	}
+	n = i;
+
+	for (i = 0; i < ENTITY_BUCKETS; i++)
+		order[i] = i;
+	for (i = 1; i < ENTITY_BUCKETS; i++) {
+		gint b = order[i];
+		guint len = g_slist_length(buckets[b]);
+
+		for (j = i; j > 0 && g_slist_length(buckets[order[j - 1]]) < len; j--)
+			order[j] = order[j - 1];
+		order[j] = b;
+	}
+
+	for (i = 0; i < ENTITY_SLOTS; i++)
+		symbol_slots[i] = -1;
+
+	for (i = 0; i < ENTITY_BUCKETS; i++) {
+		gint b = order[i];
+		guint32 seed;
+
+		if (buckets[b] == NULL)
+			break;
+
+		for (seed = 1; seed <= G_MAXUINT16; seed++) {
+			GSList *cur;
+
+			for (cur = buckets[b]; cur != NULL; cur = cur->next) {
+				gint e = GPOINTER_TO_INT(cur->data);
+				guint32 slot = entity_hash(symbolic_entities[e].key, seed) % ENTITY_SLOTS;
+
+				if (symbol_slots[slot] != -1)
+					break;
+				symbol_slots[slot] = e;
+			}
+			if (cur == NULL)
+				break;
+
+			/* undo, and try the next seed */
+			for (cur = buckets[b]; cur != NULL; cur = cur->next) {
+				gint e = GPOINTER_TO_INT(cur->data);
+				guint32 slot = entity_hash(symbolic_entities[e].key, seed) % ENTITY_SLOTS;
+
+				if (symbol_slots[slot] == e)
+					symbol_slots[slot] = -1;
+			}
+		}
+		if (seed > G_MAXUINT16) {
+			g_warning("couldn't build the HTML entities table");
+			for (j = 0; j < ENTITY_BUCKETS; j++)
+				g_slist_free(buckets[j]);
+			return FALSE;
+		}
+		symbol_seeds[b] = seed;
+	}
+
+	for (i = 0; i < ENTITY_BUCKETS; i++)
+		g_slist_free(buckets[i]);
+
+	debug_print("initialized entities table with %d symbols\n", n);
+	return TRUE;
+}
+
+static const gchar *entity_lookup_symbol(const gchar *name)
+{
+	guint32 b, slot;
+	gint e;
+
+	if (g_once_init_enter(&symbol_hash_state))
+		g_once_init_leave(&symbol_hash_state,
+				  entity_build_symbol_hash() ?
+				  ENTITY_HASH_READY : ENTITY_HASH_FAILED);
+
+	if (symbol_hash_state == ENTITY_HASH_FAILED) {
+		gint i;
+
+		for (i = 0; symbolic_entities[i].key != NULL; ++i)
+			if (!strcmp(symbolic_entities[i].key, name))
+				return symbolic_entities[i].value;
+		return NULL;
+	}
+
+	b = entity_hash(name, 0) % ENTITY_BUCKETS;
+	slot = entity_hash(name, symbol_seeds[b]) % ENTITY_SLOTS;
+	e = symbol_slots[slot];
+	if (e < 0 || strcmp(symbolic_entities[e].key, name))
+		return NULL;
+
+	return symbolic_entities[e].value;
+}
+
+static const gchar* entity_extract_to_buffer(const gchar *p, gchar b[])
 {
 	gint i = 0;
 
@@ -332,88 +459,90 @@ static gchar* entity_extract_to_buffer(gchar *p, gchar b[])
 	return b;
 }
 
-static gchar *entity_decode_numeric(gchar *str)
+static gboolean entity_decode_numeric(const gchar *str, gchar *out)
 {
 	gchar b[ENTITY_MAX_LEN];
-	gchar *p = str, *res;
+	const gchar *p = str;
 	gboolean hex = FALSE;
 	gunichar c = 0;
 	gint ret;
 
 	++p;
 	if (*p == '\0')
-		return NULL;
+		return FALSE;
 
 	if (*p == 'x') {
 		hex = TRUE;
 		++p;
 		if (*p == '\0')
-			return NULL;
+			return FALSE;
 	}
 
 	if (entity_extract_to_buffer (p, b) == NULL)
-		return NULL;
+		return FALSE;
 
 	if (strlen(b) > 0)
 		c = g_ascii_strtoll (b, NULL, (hex ? 16 : 10));
 
-	if (c < 32)
+	if (c < 32) {
 		/* An unprintable character; return the Unicode replacement symbol */
-		return g_strdup("\xef\xbf\xbd");
+		strcpy(out, "\xef\xbf\xbd");
+		return TRUE;
+	}
 
 	if (!g_unichar_validate(c)) {
 		/* Make sure the character is valid Unicode */
 		debug_print("Numeric reference '&#%s;' is invalid in Unicode codespace\n", b);
-		return NULL;
+		return FALSE;
 	}
 
-	res = g_malloc0 (DECODED_MAX_LEN + 1);
-	ret = g_unichar_to_utf8 (c, res);
+	ret = g_unichar_to_utf8 (c, out);
 	if (ret == 0) {
 		debug_print("Failed to convert unicode character %u to UTF-8\n", c);
-		g_free(res);
-		res = NULL;
+		return FALSE;
 	}
+	out[ret] = '\0';
 
-	return res;
+	return TRUE;
 }
 
-static gchar *entity_decode_symbol(gchar *str)
+static gboolean entity_decode_symbol(const gchar *str, gchar *out)
 {
 	gchar b[ENTITY_MAX_LEN];
-	gchar *decoded;
+	const gchar *decoded;
 
 	if (entity_extract_to_buffer (str, b) == NULL)
-		return NULL;
+		return FALSE;
 
-	if (symbol_table == NULL) {
-		gint i;
+	decoded = entity_lookup_symbol(b);
+	if (decoded == NULL)
+		return FALSE;
 
-		symbol_table = g_hash_table_new (g_str_hash, g_str_equal);
-		for (i = 0; symbolic_entities[i].key != NULL; ++i) {
-			g_hash_table_insert (symbol_table,
-				symbolic_entities[i].key, symbolic_entities[i].value);
-		}
-		debug_print("initialized entities table with %d symbols\n", i);
-	}
-
-	decoded = g_hash_table_lookup (symbol_table, b);
-	if (decoded != NULL)
-		return g_strdup (decoded);
-
-	return NULL;
+	strcpy(out, decoded);
+	return TRUE;
 }
 
-gchar *entity_decode(gchar *str)
+gboolean entity_decode_to_buffer(const gchar *str, gchar *out)
 {
-	gchar *p = str;
+	const gchar *p = str;
+
 	if (p == NULL || *p != '&')
-		return NULL;
+		return FALSE;
 	++p;
 	if (*p == '\0')
-		return NULL;
+		return FALSE;
 	if (*p == '#')
-		return entity_decode_numeric(p);
+		return entity_decode_numeric(p, out);
 	else
-		return entity_decode_symbol(p);
+		return entity_decode_symbol(p, out);
+}
+
+gchar *entity_decode(gchar *str)
+{
+	gchar out[ENTITY_DECODED_MAX_LEN + 1];
+
+	if (!entity_decode_to_buffer(str, out))
+		return NULL;
+
+	return g_strdup(out);
 }
@@ -20,6 +20,9 @@
 
 #include <glib.h>
 
+/* The longest decoded entity, in bytes */
+#define ENTITY_DECODED_MAX_LEN 6
+
 /*
  * Try to decode the HTML entity pointed by str, whose first element
  * must be the '&' character.
@@ -30,4 +33,13 @@
  */
 gchar *entity_decode(gchar *str);
 
+/*
+ * Same as entity_decode(), but writes the decoded entity to out, which
+ * must have room for ENTITY_DECODED_MAX_LEN + 1 bytes, instead of
+ * allocating it.
+ *
+ * Returns FALSE on failure to decode.
+ */
+gboolean entity_decode_to_buffer(const gchar *str, gchar *out);
+
 #endif /* __ENTITY_H__ */
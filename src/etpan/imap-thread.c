@@ -45,6 +45,7 @@
 #include "mainwindow.h"
 #include "proxy.h"
 #include "file-utils.h"
+#include "metrics.h"
 #include "ssl.h"
 #include "ssl_certificate.h"
 #include "socket.h"
@@ -491,8 +492,10 @@ static int threaded_run(Folder * folder, void * param, void * result,
 	struct etpan_thread_op * op;
 	struct etpan_thread * thread;
 	struct mailimap * imap = get_imap(folder);
+	MetricsSpan span;
 	
 	imap_folder_ref(folder);
+	metrics_span_begin(&span, "imap.round_trip");
 
 	op = etpan_thread_op_new();
 	
@@ -510,6 +513,7 @@ static int threaded_run(Folder * folder, void * param, void * result,
 	while (!op->finished) {
 		gtk_main_iteration();
 	}
+	metrics_span_end(&span);
 
 	etpan_thread_op_free(op);
 
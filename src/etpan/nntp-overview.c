@@ -0,0 +1,193 @@
+/*
+ * Claws Mail -- a GTK+ based, lightweight, and fast e-mail client
+ * Copyright (C) 2026 the Claws Mail team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#include "claws-features.h"
+#endif
+
+#ifdef HAVE_LIBETPAN
+
+#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nntp-overview.h"
+#include "utils.h"
+
+static int overview_send(newsnntp *nntp, struct nntp_overview_request *request)
+{
+	gchar *command;
+	ssize_t r;
+
+	if (request->header)
+		command = g_strdup_printf("XHDR %s %u-%u\r\n", request->header,
+					  request->beg, request->end);
+	else
+		command = g_strdup_printf("XOVER %u-%u\r\n",
+					  request->beg, request->end);
+	r = mailstream_write(nntp->nntp_stream, command, strlen(command));
+	g_free(command);
+
+	return r < 0 ? NEWSNNTP_ERROR_STREAM : NEWSNNTP_NO_ERROR;
+}
+
+static int overview_read_reply(newsnntp *nntp, GPtrArray *lines)
+{
+	char *line;
+
+	line = mailstream_read_line_remove_eol(nntp->nntp_stream,
+					       nntp->nntp_stream_buffer);
+	if (line == NULL)
+		return NEWSNNTP_ERROR_STREAM;
+
+	switch (strtol(line, NULL, 10)) {
+	case 221:
+	case 224:
+		break;
+	case 420:
+	case 423:
+		/* no article in the batch */
+		return NEWSNNTP_NO_ERROR;
+	default:
+		/* a single line, the next reply follows */
+		return NEWSNNTP_ERROR_UNEXPECTED_RESPONSE;
+	}
+
+	for (;;) {
+		line = mailstream_read_line_remove_eol(nntp->nntp_stream,
+						       nntp->nntp_stream_buffer);
+		if (line == NULL)
+			return NEWSNNTP_ERROR_STREAM;
+		if (line[0] == '.') {
+			if (line[1] == '\0')
+				break;
+			line++;
+		}
+		g_ptr_array_add(lines, g_strdup(line));
+	}
+
+	return NEWSNNTP_NO_ERROR;
+}
+
+void nntp_overview_reply_free(struct nntp_overview_reply *reply)
+{
+	g_ptr_array_free(reply->lines, TRUE);
+	g_free(reply);
+}
+
+/* nntp_overview_pipeline() - sends the n_requests requests on nntp,
+ * up to NNTP_PIPELINE_DEPTH ahead of the reply being read, and pushes
+ * the replies to replies in the order of the requests. The failed
+ * requests are skipped. Returns the first error, or
+ * NEWSNNTP_ERROR_STREAM at once if the connection fails. */
+int nntp_overview_pipeline(newsnntp *nntp,
+			   struct nntp_overview_request *requests,
+			   guint n_requests, GAsyncQueue *replies)
+{
+	guint sent = 0, received = 0;
+	int r = NEWSNNTP_NO_ERROR, error = NEWSNNTP_NO_ERROR;
+
+	while (received < n_requests) {
+		struct nntp_overview_reply *reply;
+
+		/* keep the server busy with the next requests while the
+		 * reply to this one is read */
+		if (sent < n_requests && sent - received < NNTP_PIPELINE_DEPTH) {
+			while (r == NEWSNNTP_NO_ERROR && sent < n_requests &&
+			       sent - received < NNTP_PIPELINE_DEPTH) {
+				r = overview_send(nntp, &requests[sent]);
+				sent++;
+			}
+			if (r == NEWSNNTP_NO_ERROR &&
+			    mailstream_flush(nntp->nntp_stream) < 0)
+				r = NEWSNNTP_ERROR_STREAM;
+			if (r != NEWSNNTP_NO_ERROR)
+				return r;
+		}
+
+		reply = g_new0(struct nntp_overview_reply, 1);
+		reply->request = &requests[received];
+		reply->lines = g_ptr_array_new_with_free_func(g_free);
+		r = overview_read_reply(nntp, reply->lines);
+		received++;
+
+		if (r != NEWSNNTP_NO_ERROR) {
+			debug_print("couldn't get %s %d-%d\n",
+				    reply->request->header ?
+				    reply->request->header : "xover",
+				    reply->request->beg, reply->request->end);
+			nntp_overview_reply_free(reply);
+			if (r == NEWSNNTP_ERROR_STREAM)
+				return r;
+			/* the other replies are still usable */
+			if (error == NEWSNNTP_NO_ERROR)
+				error = r;
+			r = NEWSNNTP_NO_ERROR;
+			continue;
+		}
+
+		g_async_queue_push(replies, reply);
+		g_main_context_wakeup(NULL);
+	}
+
+	return error;
+}
+
+/* splits a line of XOVER reply in place */
+void nntp_overview_parse_xover(gchar *line,
+			       struct newsnntp_xover_resp_item *item)
+{
+	gchar *fields[8];
+	gint i;
+
+	for (i = 0; i < 8; i++) {
+		gchar *tab;
+
+		fields[i] = line;
+		if ((tab = strchr(line, '\t')) != NULL) {
+			*tab = '\0';
+			line = tab + 1;
+		} else
+			line += strlen(line);
+	}
+
+	memset(item, 0, sizeof(*item));
+	item->ovr_article = strtoul(fields[0], NULL, 10);
+	item->ovr_subject = fields[1];
+	item->ovr_author = fields[2];
+	item->ovr_date = fields[3];
+	item->ovr_message_id = fields[4];
+	item->ovr_references = fields[5];
+	item->ovr_size = strtoul(fields[6], NULL, 10);
+	item->ovr_line_count = strtoul(fields[7], NULL, 10);
+}
+
+/* splits a line of XHDR reply, the value points into it */
+void nntp_overview_parse_xhdr(gchar *line,
+			      struct newsnntp_xhdr_resp_item *item)
+{
+	gchar *value;
+
+	item->hdr_article = strtoul(line, &value, 10);
+	if (*value == ' ')
+		value++;
+	item->hdr_value = value;
+}
+
+#endif
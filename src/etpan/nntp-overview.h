@@ -0,0 +1,52 @@
+/*
+ * Claws Mail -- a GTK+ based, lightweight, and fast e-mail client
+ * Copyright (C) 2026 the Claws Mail team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NNTP_OVERVIEW_H
+#define NNTP_OVERVIEW_H
+
+#include <glib.h>
+#include <libetpan/libetpan.h>
+
+/* overview requests sent ahead of the one being answered */
+#define NNTP_PIPELINE_DEPTH 4
+
+/* One XOVER or XHDR request, for a batch of articles */
+struct nntp_overview_request {
+	/* NULL for the overview itself */
+	const char *header;
+	guint32 beg;
+	guint32 end;
+};
+
+struct nntp_overview_reply {
+	struct nntp_overview_request *request;
+	/* the lines of the reply, unstuffed */
+	GPtrArray *lines;
+};
+
+int nntp_overview_pipeline(newsnntp *nntp,
+			   struct nntp_overview_request *requests,
+			   guint n_requests, GAsyncQueue *replies);
+void nntp_overview_reply_free(struct nntp_overview_reply *reply);
+
+void nntp_overview_parse_xover(gchar *line,
+			       struct newsnntp_xover_resp_item *item);
+void nntp_overview_parse_xhdr(gchar *line,
+			      struct newsnntp_xhdr_resp_item *item);
+
+#endif
@@ -27,6 +27,8 @@
 #include <glib/gi18n.h>
 #include "nntp-thread.h"
 #include "news.h"
+#include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #if (defined(__DragonFly__) || defined (__NetBSD__) || defined (__FreeBSD__) || defined (__OpenBSD__) || defined (__CYGWIN__))
@@ -41,6 +43,7 @@
 #include <log.h>
 #include "etpan-thread-manager.h"
 #include "etpan-ssl.h"
+#include "nntp-overview.h"
 #include "utils.h"
 #include "mainwindow.h"
 #include "ssl_certificate.h"
@@ -343,8 +346,11 @@ static void generic_cb(int cancelled, void * result, void * callback_data)
 	op->finished = 1;
 }
 
-static void threaded_run(Folder * folder, void * param, void * result,
-			 void (* func)(struct etpan_thread_op * ))
+/* idle, if not NULL, is called with param each time the main loop has
+ * run while the operation is being done, and once it is done */
+static void threaded_run_full(Folder * folder, void * param, void * result,
+			 void (* func)(struct etpan_thread_op * ),
+			 void (* idle)(void * param))
 {
 	struct etpan_thread_op * op;
 	struct etpan_thread * thread;
@@ -371,7 +377,11 @@ static void threaded_run(Folder * folder, void * param, void * result,
 	
 	while (!op->finished) {
 		gtk_main_iteration();
+		if (idle)
+			idle(param);
 	}
+	if (idle)
+		idle(param);
 	
 	mailstream_logger = previous_stream_logger;
 
@@ -380,6 +390,12 @@ static void threaded_run(Folder * folder, void * param, void * result,
 	nntp_folder_unref(folder);
 }
 
+static void threaded_run(Folder * folder, void * param, void * result,
+			 void (* func)(struct etpan_thread_op * ))
+{
+	threaded_run_full(folder, param, result, func, NULL);
+}
+
 
 /* connect */
 
@@ -1075,6 +1091,144 @@ int nntp_threaded_xhdr(Folder * folder, const char *header, guint32 beg, guint32
 	return result.error;
 }
 
+struct overview_param {
+	newsnntp * nntp;
+	struct nntp_overview_request *requests;
+	guint n_requests;
+	/* the replies read by the thread, in the order of the requests,
+	 * for the main thread */
+	GAsyncQueue *replies;
+
+	/* only used by the main thread */
+	guint n_done;
+	NNTPXoverFunc xover_func;
+	NNTPXhdrFunc xhdr_func;
+	gpointer data;
+};
+
+struct overview_result {
+	int error;
+};
+
+static void overview_run(struct etpan_thread_op * op)
+{
+	struct overview_param * param;
+	struct overview_result * result;
+
+	param = op->param;
+	result = op->result;
+
+	CHECK_NNTP();
+
+	result->error = nntp_overview_pipeline(param->nntp, param->requests,
+					       param->n_requests, param->replies);
+
+	debug_print("nntp overview run - end %i\n", result->error);
+}
+
+/* hands the replies read so far to the callbacks */
+static void overview_deliver(void * data)
+{
+	struct overview_param * param = (struct overview_param *)data;
+	struct nntp_overview_reply *reply;
+
+	while ((reply = g_async_queue_try_pop(param->replies)) != NULL) {
+		guint i;
+
+		for (i = 0; i < reply->lines->len; i++) {
+			gchar *line = g_ptr_array_index(reply->lines, i);
+
+			if (reply->request->header == NULL) {
+				struct newsnntp_xover_resp_item item;
+
+				nntp_overview_parse_xover(line, &item);
+				param->xover_func(&item, param->data);
+			} else {
+				struct newsnntp_xhdr_resp_item item;
+
+				nntp_overview_parse_xhdr(line, &item);
+				param->xhdr_func(reply->request->header,
+						 &item, param->data);
+			}
+		}
+		nntp_overview_reply_free(reply);
+
+		param->n_done++;
+		statusbar_progress_all(param->n_done, param->n_requests, 1);
+	}
+}
+
+/* nntp_threaded_overview() - gets the overview of the articles of the
+ * ranges, n_ranges pairs of first and last numbers, and the headers
+ * that aren't in it, from the NULL terminated array headers. Several
+ * requests are kept in flight, and their replies are handed to
+ * xover_func and xhdr_func, in the main thread, as they come. The
+ * items are only valid during the call. If a request fails, the others
+ * are still done and the first error is returned; if the connection
+ * fails, NEWSNNTP_ERROR_STREAM is. */
+int nntp_threaded_overview(Folder * folder, const guint32 *ranges, guint n_ranges,
+			   const char **headers, NNTPXoverFunc xover_func,
+			   NNTPXhdrFunc xhdr_func, gpointer data)
+{
+	struct overview_param param;
+	struct overview_result result;
+	GArray *requests;
+	guint i, n_headers = 0;
+
+	debug_print("nntp overview - begin\n");
+
+	while (headers && headers[n_headers])
+		n_headers++;
+
+	/* in batches of NNTP_BATCH_SIZE, as nntp_threaded_xover() */
+	requests = g_array_new(FALSE, FALSE, sizeof(struct nntp_overview_request));
+	for (i = 0; i < n_ranges; i++) {
+		guint32 beg = ranges[2 * i], end = ranges[2 * i + 1];
+		guint32 cbeg;
+
+		for (cbeg = beg; cbeg <= end; ) {
+			struct nntp_overview_request request;
+			guint j;
+
+			request.beg = cbeg;
+			request.end = MIN(end, cbeg + (NNTP_BATCH_SIZE - 1));
+			request.header = NULL;
+			g_array_append_val(requests, request);
+			for (j = 0; j < n_headers; j++) {
+				request.header = headers[j];
+				g_array_append_val(requests, request);
+			}
+
+			if (request.end == end)
+				break;
+			cbeg = request.end + 1;
+		}
+	}
+
+	param.nntp = get_nntp(folder);
+	param.requests = (struct nntp_overview_request *)requests->data;
+	param.n_requests = requests->len;
+	param.replies = g_async_queue_new();
+	param.n_done = 0;
+	param.xover_func = xover_func;
+	param.xhdr_func = xhdr_func;
+	param.data = data;
+
+	result.error = NEWSNNTP_NO_ERROR;
+	if (param.n_requests > 0)
+		threaded_run_full(folder, &param, &result, overview_run,
+				  overview_deliver);
+
+	statusbar_progress_all(0, 0, 0);
+
+	g_async_queue_unref(param.replies);
+	g_array_free(requests, TRUE);
+
+	debug_print("nntp overview - end %i\n", result.error);
+
+	return result.error;
+}
+
 void nntp_main_set_timeout(int sec)
 {
 	mailstream_network_delay.tv_sec = sec;
@@ -25,6 +25,12 @@
 #include "folder.h"
 #include "proxy.h"
 
+typedef void (*NNTPXoverFunc)(struct newsnntp_xover_resp_item *item,
+			      gpointer data);
+typedef void (*NNTPXhdrFunc)(const char *header,
+			     struct newsnntp_xhdr_resp_item *item,
+			     gpointer data);
+
 void nntp_main_set_timeout(int sec);
 void nntp_main_init(gboolean skip_ssl_cert_check);
 void nntp_main_done(gboolean have_connectivity);
@@ -48,5 +54,8 @@ int nntp_threaded_group(Folder * folder, const char *group, struct newsnntp_grou
 int nntp_threaded_mode_reader(Folder * folder);
 int nntp_threaded_xover(Folder * folder, guint32 beg, guint32 end, struct newsnntp_xover_resp_item **single_result, clist **multiple_result);
 int nntp_threaded_xhdr(Folder * folder, const char *header, guint32 beg, guint32 end, clist **hdrlist);
+int nntp_threaded_overview(Folder * folder, const guint32 *ranges, guint n_ranges,
+			   const char **headers, NNTPXoverFunc xover_func,
+			   NNTPXhdrFunc xhdr_func, gpointer data);
 
 #endif
@@ -0,0 +1,312 @@
+#include <glib.h>
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "mock_debug_print.h"
+
+#include "nntp-overview.h"
+
+/* A fake news server, answering a fixed list of commands once it has
+ * read as many as a pipelining client sends ahead */
+typedef struct {
+	const gchar *command;
+	/* NULL to hang up instead */
+	const gchar *reply;
+} FakeExchange;
+
+typedef struct {
+	const FakeExchange *exchanges;
+	guint n_exchanges;
+	int listen_fd;
+	guint16 port;
+	GThread *thread;
+	/* the most commands read ahead of a reply */
+	guint max_ahead;
+} FakeNews;
+
+static gchar *
+read_command(int fd)
+{
+	GString *cmd = g_string_new(NULL);
+	gchar c;
+
+	while (read(fd, &c, 1) == 1) {
+		if (c == '\n') {
+			if (cmd->len > 0 && cmd->str[cmd->len - 1] == '\r')
+				g_string_truncate(cmd, cmd->len - 1);
+			return g_string_free(cmd, FALSE);
+		}
+		g_string_append_c(cmd, c);
+	}
+	g_string_free(cmd, TRUE);
+	return NULL;
+}
+
+static void
+write_string(int fd, const gchar *str)
+{
+	g_assert_cmpint(write(fd, str, strlen(str)), ==, strlen(str));
+}
+
+static gpointer
+fake_news_thread(gpointer data)
+{
+	FakeNews *fake = (FakeNews *)data;
+	struct timeval timeout = { 5, 0 };
+	guint n_read = 0, n_answered = 0;
+	int fd;
+
+	fd = accept(fake->listen_fd, NULL, NULL);
+	g_assert_cmpint(fd, >=, 0);
+	/* don't wait forever on a client that doesn't pipeline */
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+	write_string(fd, "200 fake news server ready\r\n");
+
+	while (n_answered < fake->n_exchanges) {
+		const FakeExchange *exchange;
+
+		while (n_read < fake->n_exchanges &&
+		       n_read < n_answered + NNTP_PIPELINE_DEPTH) {
+			gchar *cmd = read_command(fd);
+
+			if (cmd == NULL)
+				goto out;
+			g_assert_cmpstr(cmd, ==, fake->exchanges[n_read].command);
+			g_free(cmd);
+			n_read++;
+		}
+		fake->max_ahead = MAX(fake->max_ahead, n_read - n_answered);
+
+		exchange = &fake->exchanges[n_answered++];
+		if (exchange->reply == NULL)
+			break;
+		write_string(fd, exchange->reply);
+	}
+out:
+	close(fd);
+	return NULL;
+}
+
+static FakeNews *
+fake_news_new(const FakeExchange *exchanges, guint n_exchanges)
+{
+	FakeNews *fake = g_new0(FakeNews, 1);
+	struct sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+
+	fake->exchanges = exchanges;
+	fake->n_exchanges = n_exchanges;
+
+	fake->listen_fd = socket(PF_INET, SOCK_STREAM, 0);
+	g_assert_cmpint(fake->listen_fd, >=, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	g_assert_cmpint(bind(fake->listen_fd, (struct sockaddr *)&addr, sizeof(addr)), ==, 0);
+	g_assert_cmpint(listen(fake->listen_fd, 1), ==, 0);
+	g_assert_cmpint(getsockname(fake->listen_fd, (struct sockaddr *)&addr, &len), ==, 0);
+	fake->port = ntohs(addr.sin_port);
+
+	fake->thread = g_thread_new("fake-news", fake_news_thread, fake);
+
+	return fake;
+}
+
+static void
+fake_news_free(FakeNews *fake)
+{
+	g_thread_join(fake->thread);
+	close(fake->listen_fd);
+	g_free(fake);
+}
+
+static newsnntp *
+fake_news_connect(FakeNews *fake)
+{
+	newsnntp *nntp = newsnntp_new(0, NULL);
+
+	g_assert_cmpint(newsnntp_socket_connect(nntp, "127.0.0.1", fake->port),
+			==, NEWSNNTP_NO_ERROR);
+	return nntp;
+}
+
+static void
+assert_reply(GAsyncQueue *replies, struct nntp_overview_request *request,
+	     const gchar **lines)
+{
+	struct nntp_overview_reply *reply = g_async_queue_try_pop(replies);
+	guint i;
+
+	g_assert_nonnull(reply);
+	g_assert_true(reply->request == request);
+	for (i = 0; lines[i] != NULL; i++) {
+		g_assert_cmpuint(i, <, reply->lines->len);
+		g_assert_cmpstr(g_ptr_array_index(reply->lines, i), ==, lines[i]);
+	}
+	g_assert_cmpuint(reply->lines->len, ==, i);
+	nntp_overview_reply_free(reply);
+}
+
+#define XOVER_1 "1\tHello\tjoe@example.com\tMon, 1 Jun 2026 10:00:00 +0000\t<1@example.com>\t\t1200\t20"
+#define XOVER_2 "2\tRe: Hello\tann@example.com\tMon, 1 Jun 2026 11:00:00 +0000\t<2@example.com>\t<1@example.com>\t900\t12"
+
+static void
+test_overview_pipeline(void)
+{
+	struct nntp_overview_request requests[] = {
+		{ NULL, 1, 2 },
+		{ "Newsgroups", 1, 2 },
+		{ NULL, 3, 4 },
+		{ "Newsgroups", 3, 4 },
+		{ NULL, 5, 5 },
+		{ "X-Odd", 5, 5 },
+	};
+	const FakeExchange exchanges[] = {
+		{ "XOVER 1-2", "224 overview follows\r\n" XOVER_1 "\r\n" XOVER_2 "\r\n.\r\n" },
+		{ "XHDR Newsgroups 1-2", "221 Newsgroups follow\r\n1 a.b\r\n2 a.b,c.d\r\n.\r\n" },
+		{ "XOVER 3-4", "423 no articles in that range\r\n" },
+		{ "XHDR Newsgroups 3-4", "420 no current article\r\n" },
+		{ "XOVER 5-5", "224 overview follows\r\n.\r\n" },
+		{ "XHDR X-Odd 5-5", "221 X-Odd follows\r\n..starts with a dot\r\n.\r\n" },
+	};
+	const gchar *xover_lines[] = { XOVER_1, XOVER_2, NULL };
+	const gchar *xhdr_lines[] = { "1 a.b", "2 a.b,c.d", NULL };
+	const gchar *no_lines[] = { NULL };
+	const gchar *odd_lines[] = { ".starts with a dot", NULL };
+	FakeNews *fake = fake_news_new(exchanges, G_N_ELEMENTS(exchanges));
+	newsnntp *nntp = fake_news_connect(fake);
+	GAsyncQueue *replies = g_async_queue_new();
+
+	g_assert_cmpint(nntp_overview_pipeline(nntp, requests,
+			G_N_ELEMENTS(requests), replies), ==, NEWSNNTP_NO_ERROR);
+
+	/* every reply, in the order of the requests */
+	assert_reply(replies, &requests[0], xover_lines);
+	assert_reply(replies, &requests[1], xhdr_lines);
+	assert_reply(replies, &requests[2], no_lines);
+	assert_reply(replies, &requests[3], no_lines);
+	assert_reply(replies, &requests[4], no_lines);
+	assert_reply(replies, &requests[5], odd_lines);
+	g_assert_null(g_async_queue_try_pop(replies));
+
+	newsnntp_free(nntp);
+	g_async_queue_unref(replies);
+	/* the requests were sent ahead of the replies */
+	g_assert_cmpuint(fake->max_ahead, ==, NNTP_PIPELINE_DEPTH);
+	fake_news_free(fake);
+}
+
+static void
+test_overview_failed_request(void)
+{
+	struct nntp_overview_request requests[] = {
+		{ NULL, 1, 1 },
+		{ "Newsgroups", 1, 1 },
+		{ NULL, 2, 2 },
+	};
+	const FakeExchange exchanges[] = {
+		{ "XOVER 1-1", "224 overview follows\r\n" XOVER_1 "\r\n.\r\n" },
+		{ "XHDR Newsgroups 1-1", "500 what?\r\n" },
+		{ "XOVER 2-2", "224 overview follows\r\n" XOVER_2 "\r\n.\r\n" },
+	};
+	const gchar *lines_1[] = { XOVER_1, NULL };
+	const gchar *lines_2[] = { XOVER_2, NULL };
+	FakeNews *fake = fake_news_new(exchanges, G_N_ELEMENTS(exchanges));
+	newsnntp *nntp = fake_news_connect(fake);
+	GAsyncQueue *replies = g_async_queue_new();
+
+	/* the failed request is skipped, the next ones are still read */
+	g_assert_cmpint(nntp_overview_pipeline(nntp, requests,
+			G_N_ELEMENTS(requests), replies), ==,
+			NEWSNNTP_ERROR_UNEXPECTED_RESPONSE);
+	assert_reply(replies, &requests[0], lines_1);
+	assert_reply(replies, &requests[2], lines_2);
+	g_assert_null(g_async_queue_try_pop(replies));
+
+	newsnntp_free(nntp);
+	g_async_queue_unref(replies);
+	fake_news_free(fake);
+}
+
+static void
+test_overview_hang_up(void)
+{
+	struct nntp_overview_request requests[] = {
+		{ NULL, 1, 1 },
+		{ NULL, 2, 2 },
+		{ NULL, 3, 3 },
+	};
+	const FakeExchange exchanges[] = {
+		{ "XOVER 1-1", "224 overview follows\r\n" XOVER_1 "\r\n.\r\n" },
+		{ "XOVER 2-2", NULL },
+		{ "XOVER 3-3", NULL },
+	};
+	const gchar *lines_1[] = { XOVER_1, NULL };
+	FakeNews *fake = fake_news_new(exchanges, G_N_ELEMENTS(exchanges));
+	newsnntp *nntp = fake_news_connect(fake);
+	GAsyncQueue *replies = g_async_queue_new();
+
+	g_assert_cmpint(nntp_overview_pipeline(nntp, requests,
+			G_N_ELEMENTS(requests), replies), ==,
+			NEWSNNTP_ERROR_STREAM);
+	assert_reply(replies, &requests[0], lines_1);
+	g_assert_null(g_async_queue_try_pop(replies));
+
+	newsnntp_free(nntp);
+	g_async_queue_unref(replies);
+	fake_news_free(fake);
+}
+
+static void
+test_overview_parse(void)
+{
+	struct newsnntp_xover_resp_item xover;
+	struct newsnntp_xhdr_resp_item xhdr;
+	gchar *line;
+
+	line = g_strdup(XOVER_2);
+	nntp_overview_parse_xover(line, &xover);
+	g_assert_cmpuint(xover.ovr_article, ==, 2);
+	g_assert_cmpstr(xover.ovr_subject, ==, "Re: Hello");
+	g_assert_cmpstr(xover.ovr_author, ==, "ann@example.com");
+	g_assert_cmpstr(xover.ovr_date, ==, "Mon, 1 Jun 2026 11:00:00 +0000");
+	g_assert_cmpstr(xover.ovr_message_id, ==, "<2@example.com>");
+	g_assert_cmpstr(xover.ovr_references, ==, "<1@example.com>");
+	g_assert_cmpuint(xover.ovr_size, ==, 900);
+	g_assert_cmpuint(xover.ovr_line_count, ==, 12);
+	g_free(line);
+
+	/* a short line leaves the missing fields empty */
+	line = g_strdup("7\tShort");
+	nntp_overview_parse_xover(line, &xover);
+	g_assert_cmpuint(xover.ovr_article, ==, 7);
+	g_assert_cmpstr(xover.ovr_subject, ==, "Short");
+	g_assert_cmpstr(xover.ovr_message_id, ==, "");
+	g_assert_cmpuint(xover.ovr_size, ==, 0);
+	g_free(line);
+
+	line = g_strdup("42 a.b,c.d");
+	nntp_overview_parse_xhdr(line, &xhdr);
+	g_assert_cmpuint(xhdr.hdr_article, ==, 42);
+	g_assert_cmpstr(xhdr.hdr_value, ==, "a.b,c.d");
+	g_free(line);
+}
+
+int
+main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/nntp/overview/pipeline", test_overview_pipeline);
+	g_test_add_func("/nntp/overview/failed_request", test_overview_failed_request);
+	g_test_add_func("/nntp/overview/hang_up", test_overview_hang_up);
+	g_test_add_func("/nntp/overview/parse", test_overview_parse);
+
+	return g_test_run();
+}
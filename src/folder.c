@@ -42,6 +42,7 @@
 #include "imap.h"
 #include "news.h"
 #include "mh.h"
+#include "maildir.h"
 #include "utils.h"
 #include "xml.h"
 #include "codeconv.h"
@@ -64,6 +65,7 @@
 #include "prefs_common.h"
 #include "prefs_migration.h"
 #include "file-utils.h"
+#include "metrics.h"
 
 /* Dependecies to be removed ?! */
 #include "prefs_account.h"
@@ -92,6 +94,11 @@ static gchar *folder_item_get_mark_file	(FolderItem	*item);
 static gchar *folder_item_get_tags_file	(FolderItem	*item);
 static GNode *folder_get_xml_node	(Folder 	*folder);
 static Folder *folder_get_from_xml	(GNode 		*node);
+static FolderClass *folder_get_class_from_xml	(XMLTag		*tag);
+static Folder *folder_new_from_xml	(FolderClass	*klass,
+					 XMLTag		*tag);
+static FolderItem *folder_item_new_from_xml	(Folder		*folder,
+						 XMLTag		*tag);
 static void folder_update_op_count_rec	(GNode		*node);
 
 
@@ -102,6 +109,7 @@ static void folder_item_read_cache		(FolderItem *item);
 gint folder_item_scan_full		(FolderItem *item, gboolean filtering);
 static void folder_item_update_with_msg (FolderItem *item, FolderItemUpdateFlags update_flags,
                                          MsgInfo *msg);
+static HooksList *folder_item_update_hooks	(void);
 static GHashTable *folder_persist_prefs_new	(Folder *folder);
 static void folder_persist_prefs_free		(GHashTable *pptable);
 static void folder_item_restore_persist_prefs	(FolderItem *item, GHashTable *pptable);
@@ -109,6 +117,7 @@ static void folder_item_restore_persist_prefs	(FolderItem *item, GHashTable *ppt
 void folder_system_init(void)
 {
 	folder_register_class(mh_get_class());
+	folder_register_class(maildir_get_class());
 	folder_register_class(imap_get_class());
 	folder_register_class(news_get_class());
 }
@@ -506,6 +515,8 @@ void folder_item_destroy(FolderItem *item)
 			folder->trash = NULL;
 	}
 
+	hooks_cancel_coalesced(folder_item_update_hooks(), item);
+
 	if (item->cache)
 		folder_item_free_cache(item, TRUE);
 	if (item->prefs)
@@ -830,52 +841,181 @@ GList *folder_get_list(void)
 	return folder_list;
 }
 
-gint folder_read_list(void)
+/* State of folder_read_list() while the folder list is parsed */
+typedef struct _FolderListReader
 {
-	GNode *node, *cur;
-	XMLNode *xmlnode;
-	gchar *path;
+	gint config_version;
+	/* depth of the element being read, 1 for the folder list */
+	guint level;
+	/* open elements that are ignored */
+	guint skip;
+
+	/* the folder being read, or the tree of the one whose class isn't
+	 * registered, kept as is */
+	Folder *folder;
+	GNode *unloaded;
+	/* where the next element goes */
+	GNode *parent;
+} FolderListReader;
+
+static gint folder_list_start_element(XMLTag *tag, gpointer data)
+{
+	FolderListReader *reader = (FolderListReader *)data;
+	FolderClass *klass;
+	FolderItem *item;
 	GList *list;
-	gint config_version = -1;
 
-	path = folder_get_list_path();
-	if (!is_file_exist(path)) return -1;
-	node = xml_parse_file(path);
-	if (!node) return -1;
+	reader->level++;
 
-	xmlnode = node->data;
-	if (g_strcmp0(xmlnode->tag->tag, "folderlist") != 0) {
-		g_warning("wrong folder list");
-		xml_free_tree(node);
-		return -1;
+	if (reader->skip > 0) {
+		reader->skip++;
+		return 0;
 	}
 
-	cur = node->children;
-	while (cur != NULL) {
-		Folder *folder;
+	if (reader->level == 1) {
+		if (strcmp(tag->tag, "folderlist") != 0) {
+			g_warning("wrong folder list");
+			return -1;
+		}
+		for (list = tag->attr; list != NULL; list = list->next) {
+			XMLAttr *attr = list->data;
 
-		folder = folder_get_from_xml(cur);
-		if (folder != NULL)
-			folder_add(folder);
-		else
-			folder_unloaded_list = g_slist_append(folder_unloaded_list,
-				(gpointer) xml_copy_tree(cur));
-		cur = cur->next;
+			if (!attr || !attr->name || !attr->value) continue;
+			if (!strcmp(attr->name, "config_version")) {
+				reader->config_version = atoi(attr->value);
+				debug_print("Found folderlist config_version %d\n",
+					    reader->config_version);
+			}
+		}
+		return 0;
 	}
 
-	for (list = xmlnode->tag->attr; list != NULL; list = list->next) {
-		XMLAttr *attr = list->data;
+	if (reader->level == 2) {
+		klass = folder_get_class_from_xml(tag);
+		if (klass != NULL)
+			reader->folder = folder_new_from_xml(klass, tag);
+		if (reader->folder != NULL) {
+			reader->parent = reader->folder->node;
+		} else {
+			reader->unloaded = g_node_new(
+				xml_node_new(xml_copy_tag(tag), NULL));
+			reader->parent = reader->unloaded;
+		}
+		return 0;
+	}
 
-		if (!attr || !attr->name || !attr->value) continue;
-		if (!strcmp(attr->name, "config_version")) {
-			config_version = atoi(attr->value);
-			debug_print("Found folderlist config_version %d\n", config_version);
+	if (reader->unloaded != NULL) {
+		reader->parent = g_node_append_data(reader->parent,
+				xml_node_new(xml_copy_tag(tag), NULL));
+		return 0;
+	}
+
+	item = folder_item_new_from_xml(reader->folder, tag);
+	if (item == NULL) {
+		reader->skip = 1;
+		return 0;
+	}
+	g_node_append(reader->parent, item->node);
+	reader->parent = item->node;
+
+	return 0;
+}
+
+static void folder_list_end_folder(FolderListReader *reader)
+{
+	if (reader->folder != NULL)
+		folder_add(reader->folder);
+	else if (reader->unloaded != NULL)
+		folder_unloaded_list = g_slist_append(folder_unloaded_list,
+						      reader->unloaded);
+	reader->folder = NULL;
+	reader->unloaded = NULL;
+	reader->parent = NULL;
+}
+
+static gint folder_list_end_element(const gchar *name, gpointer data)
+{
+	FolderListReader *reader = (FolderListReader *)data;
+
+	reader->level--;
+
+	if (reader->skip > 0)
+		reader->skip--;
+	else if (reader->level == 1)
+		folder_list_end_folder(reader);
+	else if (reader->level > 1)
+		reader->parent = reader->parent->parent;
+
+	return 0;
+}
+
+static const XMLSaxHandler folder_list_handler = {
+	folder_list_start_element,
+	folder_list_end_element,
+	NULL
+};
+
+/* Forgets what a broken folder list file was read into */
+static void folder_list_discard(FolderListReader *reader, GList *old_folders,
+				GSList *old_unloaded)
+{
+	GList *folders, *cur;
+	GSList *scur;
+
+	if (reader->folder != NULL)
+		folder_destroy(reader->folder);
+	if (reader->unloaded != NULL)
+		xml_free_tree(reader->unloaded);
+
+	folders = g_list_copy(folder_list);
+	for (cur = folders; cur != NULL; cur = cur->next) {
+		if (g_list_find(old_folders, cur->data) == NULL)
+			folder_destroy((Folder *)cur->data);
+	}
+	g_list_free(folders);
+
+	for (scur = folder_unloaded_list; scur != NULL; ) {
+		GNode *node = (GNode *)scur->data;
+
+		scur = scur->next;
+		if (g_slist_find(old_unloaded, node) == NULL) {
+			folder_unloaded_list = g_slist_remove(folder_unloaded_list,
+							      node);
+			xml_free_tree(node);
 		}
 	}
+}
 
-	xml_free_tree(node);
+gint folder_read_list(void)
+{
+	FolderListReader reader;
+	GList *old_folders;
+	GSList *old_unloaded;
+	gchar *path;
+
+	path = folder_get_list_path();
+	if (!is_file_exist(path)) return -1;
 
-	if (prefs_update_config_version_folderlist(config_version) < 0) {
+	memset(&reader, 0, sizeof(reader));
+	reader.config_version = -1;
+
+	old_folders = g_list_copy(folder_list);
+	old_unloaded = g_slist_copy(folder_unloaded_list);
+
+	/* the folders and items are made as the file is parsed, without
+	 * building its tree first */
+	if (xml_sax_parse_file(path, &folder_list_handler, &reader) < 0) {
+		/* a partial list would be written back over the file */
+		g_warning("couldn't read the folder list");
+		folder_list_discard(&reader, old_folders, old_unloaded);
+		g_list_free(old_folders);
+		g_slist_free(old_unloaded);
+		return -1;
+	}
+	g_list_free(old_folders);
+	g_slist_free(old_unloaded);
+
+	if (prefs_update_config_version_folderlist(reader.config_version) < 0) {
 		debug_print("Folderlist configuration file version upgrade failed\n");
 		return -2;
 	}
@@ -886,16 +1026,58 @@ gint folder_read_list(void)
 		return -1;
 }
 
+static void folder_item_append_xml(GString *str, GNode *node, guint depth)
+{
+	FolderItem *item = FOLDER_ITEM(node->data);
+	XMLTag *tag;
+	GNode *child;
+
+	if (item->folder->klass->item_get_xml != NULL)
+		tag = item->folder->klass->item_get_xml(item->folder, item);
+	else
+		tag = folder_item_get_xml(item->folder, item);
+
+	xml_string_append_tag(str, tag, depth, node->children == NULL);
+	if (node->children != NULL) {
+		for (child = node->children; child != NULL; child = child->next)
+			folder_item_append_xml(str, child, depth + 1);
+		xml_string_append_end_tag(str, tag->tag, depth);
+	}
+
+	xml_free_tag(tag);
+}
+
+static void folder_append_xml(GString *str, Folder *folder)
+{
+	XMLTag *tag;
+	GNode *child;
+
+	if (folder->klass->get_xml != NULL)
+		tag = folder->klass->get_xml(folder);
+	else
+		tag = folder_get_xml(folder);
+
+	xml_tag_add_attr(tag, xml_attr_new("type", folder->klass->idstr));
+
+	xml_string_append_tag(str, tag, 1, folder->node->children == NULL);
+	if (folder->node->children != NULL) {
+		for (child = folder->node->children; child != NULL; child = child->next)
+			folder_item_append_xml(str, child, 2);
+		xml_string_append_end_tag(str, tag->tag, 1);
+	}
+
+	xml_free_tag(tag);
+}
+
 void folder_write_list(void)
 {
 	GList *list;
 	GSList *slist;
-	Folder *folder;
 	gchar *path;
 	PrefFile *pfile;
-	GNode *rootnode;
-	XMLNode *xmlnode;
 	XMLTag *tag;
+	GString *str;
+	gboolean empty;
 
 	path = folder_get_list_path();
 	if ((pfile = prefs_write_open(path)) == NULL) return;
@@ -905,36 +1087,38 @@ void folder_write_list(void)
 		g_warning("failed to start write folder list.");
 		return;		
 	}
+
+	/* the whole list is made in memory and written at once, straight
+	 * from the folders instead of from a copy of them as a tree */
+	str = g_string_sized_new(XMLBUFSIZE);
+
 	tag = xml_tag_new("folderlist");
 	xml_tag_add_attr(tag, xml_attr_new_int("config_version",
 				CLAWS_CONFIG_VERSION));
-
-	xmlnode = xml_node_new(tag, NULL);
-
-	rootnode = g_node_new(xmlnode);
+	empty = folder_list == NULL && folder_unloaded_list == NULL;
+	xml_string_append_tag(str, tag, 0, empty);
 
 	for (list = folder_list; list != NULL; list = list->next) {
-		GNode *node;
+		Folder *folder = list->data;
 
-		folder = list->data;
-		node = folder_get_xml_node(folder);
-		if (node != NULL)
-			g_node_append(rootnode, node);
+		if (folder->node != NULL)
+			folder_append_xml(str, folder);
 	}
 
-	for (slist = folder_unloaded_list; slist != NULL; slist = g_slist_next(slist)) {
-		GNode *node = (GNode *) slist->data;
+	for (slist = folder_unloaded_list; slist != NULL; slist = g_slist_next(slist))
+		xml_string_append_tree(str, (GNode *) slist->data, 1);
 
-		g_node_append(rootnode, (gpointer) xml_copy_tree(node));
-	}
+	if (!empty)
+		xml_string_append_end_tag(str, tag->tag, 0);
+	xml_free_tag(tag);
 
-	if (xml_write_tree(rootnode, pfile->fp) < 0) {
+	if (claws_fwrite(str->str, 1, str->len, pfile->fp) < str->len) {
 		prefs_file_close_revert(pfile);
 		g_warning("failed to write folder list.");
 	} else if (prefs_file_close(pfile) < 0) {
 		g_warning("failed to write folder list.");
 	}
-	xml_free_tree(rootnode);
+	g_string_free(str, TRUE);
 }
 
 static gboolean folder_scan_tree_func(GNode *node, gpointer data)
@@ -1263,8 +1447,7 @@ Folder *folder_find_from_path(const gchar *path)
 
 	for (list = folder_list; list != NULL; list = list->next) {
 		folder = list->data;
-		if ((FOLDER_TYPE(folder) == F_MH || 
-		     FOLDER_TYPE(folder) == F_MBOX) &&
+		if (FOLDER_IS_LOCAL(folder) &&
 		    !path_cmp(LOCAL_FOLDER(folder)->rootpath, path))
 			return folder;
 	}
@@ -2116,9 +2299,12 @@ static MsgInfoList *get_msginfos(FolderItem *item, MsgNumberList *numlist)
 {
 	MsgInfoList *msglist = NULL;
 	Folder *folder = item->folder;
+	MetricsSpan span;
+
 	if (item->no_select)
 		return NULL;
 	
+	metrics_span_begin(&span, "folder.get_msginfos");
 	if (folder->klass->get_msginfos != NULL)
 		msglist = folder->klass->get_msginfos(folder, item, numlist);
 	else {
@@ -2134,6 +2320,8 @@ static MsgInfoList *get_msginfos(FolderItem *item, MsgNumberList *numlist)
 				msglist = g_slist_prepend(msglist, msginfo);
 		}		
 	}
+	metrics_span_end(&span);
+	metrics_counter_add("folder.msginfos_fetched", g_slist_length(msglist));
 
 	return msglist;
 }
@@ -2169,6 +2357,7 @@ gint folder_item_scan_full(FolderItem *item, gboolean filtering)
 	guint cache_max_num, folder_max_num, cache_cur_num, folder_cur_num;
 	gboolean update_flags = 0, old_uids_valid = FALSE;
 	GHashTable *subject_table = NULL;
+	MetricsSpan span, num_list_span;
 	
 	cm_return_val_if_fail(item != NULL, -1);
 	if (item->path == NULL) return -1;
@@ -2181,13 +2370,19 @@ gint folder_item_scan_full(FolderItem *item, gboolean filtering)
 	item->scanning = ITEM_SCANNING_WITH_FLAGS;
 
 	debug_print("Scanning folder %s for cache changes.\n", item->path ? item->path : "(null)");
+	metrics_span_begin(&span, "folder.scan");
 	
 	/* Get list of messages for folder and cache */
+	metrics_span_begin(&num_list_span, "folder.get_num_list");
 	if (folder->klass->get_num_list(item->folder, item, &folder_list, &old_uids_valid) < 0) {
 		debug_print("Error fetching list of message numbers\n");
 		item->scanning = ITEM_NOT_SCANNING;
+		metrics_span_end(&num_list_span);
+		metrics_span_end(&span);
+		metrics_counter_add("folder.scan_errors", 1);
 		return(-1);
 	}
+	metrics_span_end(&num_list_span);
 
 	if(prefs_common.thread_by_subject) {
 		subject_table = g_hash_table_new(g_str_hash, g_str_equal);
@@ -2518,6 +2713,7 @@ gint folder_item_scan_full(FolderItem *item, gboolean filtering)
 	folder_item_update_thaw();
 	
 	item->scanning = ITEM_NOT_SCANNING;
+	metrics_span_end(&span);
 
 	return 0;
 }
@@ -2904,6 +3100,7 @@ gchar *folder_item_fetch_msg(FolderItem *item, gint num)
 	Folder *folder;
 	gchar *msgfile;
 	MsgInfo *msginfo;
+	MetricsSpan span;
 
 	cm_return_val_if_fail(item != NULL, NULL);
 
@@ -2913,7 +3110,9 @@ gchar *folder_item_fetch_msg(FolderItem *item, gint num)
 	if (item->no_select)
 		return NULL;
 
+	metrics_span_begin(&span, "folder.fetch_msg");
 	msgfile = folder->klass->fetch_msg(folder, item, num);
+	metrics_span_end(&span);
 
 	if (msgfile != NULL) {
 		msginfo = folder_item_get_msginfo(item, num);
@@ -4066,26 +4265,22 @@ static gchar *folder_item_get_tags_file(FolderItem *item)
 	return file;
 }
 
-static gpointer xml_to_folder_item(gpointer nodedata, gpointer data)
+static FolderItem *folder_item_new_from_xml(Folder *folder, XMLTag *tag)
 {
-	XMLNode *xmlnode = (XMLNode *) nodedata;
-	Folder *folder = (Folder *) data;
 	FolderItem *item;
 
-	cm_return_val_if_fail(xmlnode != NULL, NULL);
 	cm_return_val_if_fail(folder != NULL, NULL);
 
-	if (g_strcmp0(xmlnode->tag->tag, "folderitem") != 0) {
+	if (g_strcmp0(tag->tag, "folderitem") != 0) {
 		g_warning("tag name != \"folderitem\"");
 		return NULL;
 	}
 
 	item = folder_item_new(folder, "", "");
-	g_node_destroy(item->node);
 	if (folder->klass->item_set_xml != NULL)
-		folder->klass->item_set_xml(folder, item, xmlnode->tag);
+		folder->klass->item_set_xml(folder, item, tag);
 	else
-		folder_item_set_xml(folder, item, xmlnode->tag);
+		folder_item_set_xml(folder, item, tag);
 
 	item->folder = folder;
 
@@ -4102,6 +4297,24 @@ static gpointer xml_to_folder_item(gpointer nodedata, gpointer data)
 	return item;
 }
 
+static gpointer xml_to_folder_item(gpointer nodedata, gpointer data)
+{
+	XMLNode *xmlnode = (XMLNode *) nodedata;
+	Folder *folder = (Folder *) data;
+	FolderItem *item;
+
+	cm_return_val_if_fail(xmlnode != NULL, NULL);
+
+	item = folder_item_new_from_xml(folder, xmlnode->tag);
+	/* the node is the one made by the g_node_map() */
+	if (item != NULL) {
+		g_node_destroy(item->node);
+		item->node = NULL;
+	}
+
+	return item;
+}
+
 static gboolean folder_item_set_node(GNode *node, gpointer data)
 {
 	cm_return_val_if_fail(node->data != NULL, -1);
@@ -4112,39 +4325,59 @@ static gboolean folder_item_set_node(GNode *node, gpointer data)
 	return FALSE;
 }
 
-static Folder *folder_get_from_xml(GNode *node)
+/* the class of the folder of the tag, if it is registered */
+static FolderClass *folder_get_class_from_xml(XMLTag *tag)
 {
-	Folder *folder;
-	XMLNode *xmlnode;
-	GList *list;
 	FolderClass *klass = NULL;
-	GNode *cur;
-
-	cm_return_val_if_fail(node->data != NULL, NULL);
+	GList *list;
 
-	xmlnode = node->data;
-	if (g_strcmp0(xmlnode->tag->tag, "folder") != 0) {
+	if (g_strcmp0(tag->tag, "folder") != 0) {
 		g_warning("tag name != \"folder\"");
 		return NULL;
 	}
-	list = xmlnode->tag->attr;
-	for (; list != NULL; list = list->next) {
+	for (list = tag->attr; list != NULL; list = list->next) {
 		XMLAttr *attr = list->data;
 
 		if (!attr || !attr->name || !attr->value) continue;
 		if (!strcmp(attr->name, "type"))
 			klass = folder_get_class_from_string(attr->value);
 	}
-	if (klass == NULL)
-		return NULL;
+
+	return klass;
+}
+
+static Folder *folder_new_from_xml(FolderClass *klass, XMLTag *tag)
+{
+	Folder *folder;
 
 	folder = folder_new(klass, "", "");
 	cm_return_val_if_fail(folder != NULL, NULL);
 
 	if (klass->set_xml)
-		klass->set_xml(folder, xmlnode->tag);
+		klass->set_xml(folder, tag);
 	else
-		folder_set_xml(folder, xmlnode->tag);
+		folder_set_xml(folder, tag);
+
+	return folder;
+}
+
+static Folder *folder_get_from_xml(GNode *node)
+{
+	Folder *folder;
+	XMLNode *xmlnode;
+	FolderClass *klass;
+	GNode *cur;
+
+	cm_return_val_if_fail(node->data != NULL, NULL);
+
+	xmlnode = node->data;
+	klass = folder_get_class_from_xml(xmlnode->tag);
+	if (klass == NULL)
+		return NULL;
+
+	folder = folder_new_from_xml(klass, xmlnode->tag);
+	if (folder == NULL)
+		return NULL;
 
 	cur = node->children;
 	while (cur != NULL) {
@@ -4514,6 +4747,31 @@ void folder_item_apply_processing(FolderItem *item)
  */
 static gint folder_item_update_freeze_cnt = 0;
 
+static gpointer folder_item_update_copy(gconstpointer source)
+{
+	return g_memdup(source, sizeof(FolderItemUpdateData));
+}
+
+static void folder_item_update_merge(gpointer pending, gconstpointer source)
+{
+	((FolderItemUpdateData *) pending)->update_flags |=
+		((const FolderItemUpdateData *) source)->update_flags;
+}
+
+/* updates without a message are coalesced per item and delivered once
+ * per main loop iteration */
+static HooksList *folder_item_update_hooks(void)
+{
+	static HooksList *list = NULL;
+
+	if (list == NULL) {
+		list = hooks_get_list(FOLDER_ITEM_UPDATE_HOOKLIST);
+		hooks_list_set_coalescing(list, folder_item_update_copy,
+					  folder_item_update_merge, g_free);
+	}
+	return list;
+}
+
 static void folder_item_update_with_msg(FolderItem *item, FolderItemUpdateFlags update_flags, MsgInfo *msg)
 {
 	if (folder_item_update_freeze_cnt == 0 /* || (msg != NULL && item->opened) */) {
@@ -4522,7 +4780,11 @@ static void folder_item_update_with_msg(FolderItem *item, FolderItemUpdateFlags
 		source.item = item;
 		source.update_flags = update_flags;
 		source.msg = msg;
-    		hooks_invoke(FOLDER_ITEM_UPDATE_HOOKLIST, &source);
+		if (msg != NULL)
+			hooks_invoke_list(folder_item_update_hooks(), &source);
+		else
+			hooks_invoke_coalesced(folder_item_update_hooks(),
+					       item, &source);
 	} else {
 		item->update_flags |= update_flags & ~(F_ITEM_UPDATE_ADDMSG | F_ITEM_UPDATE_REMOVEMSG);
 	}
@@ -4573,7 +4835,7 @@ static void folder_item_update_func(FolderItem *item, gpointer data)
 		source.item = item;
 		source.update_flags = item->update_flags;
 		source.msg = NULL;
-		hooks_invoke(FOLDER_ITEM_UPDATE_HOOKLIST, &source);				
+		hooks_invoke_coalesced(folder_item_update_hooks(), item, &source);
 		item->update_flags = 0;
 	}
 }
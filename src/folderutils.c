@@ -146,25 +146,24 @@ void folderutils_mark_all_read(FolderItem *item, gboolean mark_as_read)
 			folder_item_update_thaw();
 			return;
 		}
-		folder_item_set_batch(item, TRUE);
 		for (cur = msglist; cur != NULL; cur = g_slist_next(cur)) {
 			MsgInfo *msginfo = cur->data;
 
 			if (mark_as_read) {
-				if (msginfo->flags.perm_flags & (MSG_NEW | MSG_UNREAD)) {
-					procmsg_msginfo_unset_flags(msginfo, MSG_NEW | MSG_UNREAD, 0);
+				if (msginfo->flags.perm_flags & (MSG_NEW | MSG_UNREAD))
 					m++;
-				}
 			} else {
-				if (!(msginfo->flags.perm_flags & MSG_UNREAD)) {
-					procmsg_msginfo_set_flags(msginfo, MSG_UNREAD, 0);
+				if (!(msginfo->flags.perm_flags & MSG_UNREAD))
 					m++;
-				}
 			}
 			i++;
-			procmsg_msginfo_free(&msginfo);
 		}
-		folder_item_set_batch(item, FALSE);
+		if (mark_as_read)
+			procmsg_msglist_change_flags(msglist, 0, 0, MSG_NEW | MSG_UNREAD, 0);
+		else
+			procmsg_msglist_change_flags(msglist, MSG_UNREAD, 0, 0, 0);
+		for (cur = msglist; cur != NULL; cur = g_slist_next(cur))
+			procmsg_msginfo_free((MsgInfo **)&(cur->data));
 		folder_item_close(item);
 		debug_print("marked %d messages out of %d as %s\n", m, i, msg);
 		g_slist_free(msglist);
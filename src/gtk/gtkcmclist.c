@@ -1109,6 +1109,12 @@ gtk_cmclist_init (GtkCMCList *clist)
   clist->sort_column = 0;
 
   clist->drag_highlight_row = -1;
+
+  clist->row_fill_func = NULL;
+  clist->row_fill_batch_func = NULL;
+  clist->row_fill_data = NULL;
+  clist->filled_rows = g_queue_new ();
+  clist->max_filled_rows = 0;
 }
 
 /* Constructor */
@@ -4482,6 +4488,9 @@ gtk_cmclist_finalize (GObject *object)
 
   columns_delete (clist);
 
+  g_queue_free (clist->filled_rows);
+  clist->filled_rows = NULL;
+
   G_OBJECT_CLASS (gtk_cmclist_parent_class)->finalize (object);
 }
 
@@ -5855,6 +5864,70 @@ draw_row (GtkCMCList     *clist,
 
 }
 
+/* ROW FILLING
+ *   clist_fill_row
+ *   _gtk_cmclist_row_fill_forget
+ */
+static void
+clist_fill_row (GtkCMCList *clist,
+		GList      *element)
+{
+  GtkCMCListRow *clist_row = element->data;
+  GList *link;
+
+  if (clist_row->fill_link)
+    {
+      /* already filled, it is now the most recently drawn */
+      g_queue_unlink (clist->filled_rows, clist_row->fill_link);
+      g_queue_push_tail_link (clist->filled_rows, clist_row->fill_link);
+      return;
+    }
+
+  if (!clist_row->fill_pending)
+    return;
+
+  /* cells are set while drawing, don't redraw for each of them */
+  clist->freeze_count++;
+
+  clist_row->fill_pending = FALSE;
+  clist->row_fill_func (clist, element, TRUE, clist->row_fill_data);
+
+  link = g_list_alloc ();
+  link->data = element;
+  clist_row->fill_link = link;
+  g_queue_push_tail_link (clist->filled_rows, link);
+
+  while (clist->max_filled_rows > 0 &&
+	 g_queue_get_length (clist->filled_rows) > clist->max_filled_rows)
+    {
+      GList *old_element;
+      GtkCMCListRow *old_row;
+
+      link = g_queue_pop_head_link (clist->filled_rows);
+      old_element = link->data;
+      old_row = old_element->data;
+      g_list_free_1 (link);
+
+      old_row->fill_link = NULL;
+      clist->row_fill_func (clist, old_element, FALSE, clist->row_fill_data);
+      old_row->fill_pending = TRUE;
+    }
+
+  clist->freeze_count--;
+}
+
+void
+_gtk_cmclist_row_fill_forget (GtkCMCList    *clist,
+			      GtkCMCListRow *clist_row)
+{
+  if (clist_row->fill_link)
+    {
+      g_queue_delete_link (clist->filled_rows, clist_row->fill_link);
+      clist_row->fill_link = NULL;
+    }
+  clist_row->fill_pending = FALSE;
+}
+
 static void
 draw_rows (GtkCMCList     *clist,
 	   GdkRectangle *area)
@@ -5864,6 +5937,7 @@ draw_rows (GtkCMCList     *clist,
   gint i;
   gint first_row;
   gint last_row;
+  gboolean batch = FALSE;
 
   cm_return_if_fail (GTK_IS_CMCLIST (clist));
 
@@ -5894,15 +5968,30 @@ draw_rows (GtkCMCList     *clist,
   while (list)
     {
       clist_row = list->data;
-      list = list->next;
 
       if (i > last_row)
-	return;
+	break;
+
+      if (clist->row_fill_func)
+	{
+	  if (!batch && clist_row->fill_pending && clist->row_fill_batch_func)
+	    {
+	      batch = TRUE;
+	      clist->row_fill_batch_func (clist, TRUE, clist->row_fill_data);
+	    }
+	  clist_fill_row (clist, list);
+	}
+      list = list->next;
 
       GTK_CMCLIST_GET_CLASS (clist)->draw_row (clist, area, i, clist_row);
       i++;
     }
 
+  if (batch)
+    clist->row_fill_batch_func (clist, FALSE, clist->row_fill_data);
+  if (i > last_row)
+    return;
+
   if (!area) {
     int w, h, y;
     cairo_t *cr;
@@ -6314,6 +6403,8 @@ row_new (GtkCMCList *clist)
   clist_row->bg_set = FALSE;
   clist_row->style = NULL;
   clist_row->selectable = TRUE;
+  clist_row->fill_pending = FALSE;
+  clist_row->fill_link = NULL;
   clist_row->state = GTK_STATE_NORMAL;
   clist_row->data = NULL;
   clist_row->destroy = NULL;
@@ -6327,6 +6418,8 @@ row_delete (GtkCMCList    *clist,
 {
   gint i;
 
+  _gtk_cmclist_row_fill_forget (clist, clist_row);
+
   for (i = 0; i < clist->columns; i++)
     {
       GTK_CMCLIST_GET_CLASS (clist)->set_cell_contents
@@ -7098,6 +7191,49 @@ gtk_cmclist_sort (GtkCMCList *clist)
   GTK_CMCLIST_GET_CLASS (clist)->sort_list (clist);
 }
 
+void
+gtk_cmclist_set_row_fill_func (GtkCMCList                 *clist,
+			       GtkCMCListRowFillFunc       func,
+			       GtkCMCListRowFillBatchFunc  batch_func,
+			       gpointer                    data,
+			       guint                       max_filled_rows)
+{
+  cm_return_if_fail (GTK_IS_CMCLIST (clist));
+
+  clist->row_fill_func = func;
+  clist->row_fill_batch_func = batch_func;
+  clist->row_fill_data = data;
+  clist->max_filled_rows = max_filled_rows;
+}
+
+void
+gtk_cmclist_fill_pending_rows (GtkCMCList *clist)
+{
+  GList *list;
+
+  cm_return_if_fail (GTK_IS_CMCLIST (clist));
+
+  if (!clist->row_fill_func)
+    return;
+
+  clist->freeze_count++;
+  if (clist->row_fill_batch_func)
+    clist->row_fill_batch_func (clist, TRUE, clist->row_fill_data);
+  for (list = clist->row_list; list; list = list->next)
+    {
+      GtkCMCListRow *clist_row = list->data;
+
+      if (clist_row->fill_pending)
+	{
+	  clist_row->fill_pending = FALSE;
+	  clist->row_fill_func (clist, list, TRUE, clist->row_fill_data);
+	}
+    }
+  if (clist->row_fill_batch_func)
+    clist->row_fill_batch_func (clist, FALSE, clist->row_fill_data);
+  clist->freeze_count--;
+}
+
 void
 gtk_cmclist_set_compare_func (GtkCMCList            *clist,
 			    GtkCMCListCompareFunc  cmp_func)
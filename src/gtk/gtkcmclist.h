@@ -121,6 +121,18 @@ typedef gint (*GtkCMCListCompareFunc) (GtkCMCList     *clist,
 				     gconstpointer ptr1,
 				     gconstpointer ptr2);
 
+/* fills (fill == TRUE) or empties the cells of a row set up with
+ * fill_pending */
+typedef void (*GtkCMCListRowFillFunc) (GtkCMCList *clist,
+				       GList      *row_element,
+				       gboolean    fill,
+				       gpointer    data);
+
+/* called before (begin == TRUE) and after a batch of rows is filled */
+typedef void (*GtkCMCListRowFillBatchFunc) (GtkCMCList *clist,
+					    gboolean    begin,
+					    gpointer    data);
+
 typedef struct _GtkCMCListCellInfo GtkCMCListCellInfo;
 typedef struct _GtkCMCListDestInfo GtkCMCListDestInfo;
 
@@ -226,6 +238,13 @@ struct _GtkCMCList
 
   gint drag_highlight_row;
   GtkCMCListDragPos drag_highlight_pos;
+
+  /* rows whose cells are filled when they are first drawn */
+  GtkCMCListRowFillFunc row_fill_func;
+  GtkCMCListRowFillBatchFunc row_fill_batch_func;
+  gpointer row_fill_data;
+  GQueue *filled_rows;
+  guint max_filled_rows;
 };
 
 struct _GtkCMCListClass
@@ -335,9 +354,13 @@ struct _GtkCMCListRow
   gpointer data;
   GDestroyNotify destroy;
   
+  /* link in the clist's filled_rows queue */
+  GList *fill_link;
+
   guint fg_set     : 1;
   guint bg_set     : 1;
   guint selectable : 1;
+  guint fill_pending : 1;
 };
 
 /* Cell Structures */
@@ -738,6 +761,20 @@ void gtk_cmclist_row_move (GtkCMCList *clist,
 			 gint      dest_row);
 
 /* sets a compare function different to the default */
+/* Rows inserted with fill_pending set get their cells from func right
+ * before they are drawn the first time. At most max_filled_rows of them
+ * (0 means no limit) are kept filled; the least recently drawn ones are
+ * emptied again and refilled when needed. batch_func, if not NULL,
+ * brackets the rows filled together. */
+void gtk_cmclist_set_row_fill_func (GtkCMCList                 *clist,
+				    GtkCMCListRowFillFunc       func,
+				    GtkCMCListRowFillBatchFunc  batch_func,
+				    gpointer                    data,
+				    guint                       max_filled_rows);
+
+/* Fill all rows still pending, e.g. before measuring the columns */
+void gtk_cmclist_fill_pending_rows (GtkCMCList *clist);
+
 void gtk_cmclist_set_compare_func (GtkCMCList            *clist,
 				 GtkCMCListCompareFunc  cmp_func);
 
@@ -762,6 +799,9 @@ PangoLayout *_gtk_cmclist_create_cell_layout (GtkCMCList       *clist,
 					    GtkCMCListRow    *clist_row,
 					    gint            column);
 
+void _gtk_cmclist_row_fill_forget (GtkCMCList    *clist,
+				   GtkCMCListRow *clist_row);
+
 
 G_END_DECLS
 
@@ -2547,6 +2547,8 @@ row_new (GtkCMCTree *ctree)
   ctree_row->row.bg_set     = FALSE;
   ctree_row->row.style      = NULL;
   ctree_row->row.selectable = TRUE;
+  ctree_row->row.fill_pending = FALSE;
+  ctree_row->row.fill_link = NULL;
   ctree_row->row.state      = GTK_STATE_NORMAL;
   ctree_row->row.data       = NULL;
   ctree_row->row.destroy    = NULL;
@@ -2571,6 +2573,8 @@ row_delete (GtkCMCTree    *ctree,
 
   clist = GTK_CMCLIST (ctree);
 
+  _gtk_cmclist_row_fill_forget (clist, &(ctree_row->row));
+
   for (i = 0; i < clist->columns; i++)
     {
       GTK_CMCLIST_GET_CLASS (clist)->set_cell_contents
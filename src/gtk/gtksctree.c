@@ -27,6 +27,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "gtksctree.h"
 #include "claws-marshal.h"
@@ -44,6 +45,11 @@
 #define COLUMN_INSET               3
 #define PM_SIZE                    8
 #define TAB_SIZE                   (PM_SIZE + 6)
+
+/* sibling lists at least this long are sorted with several threads */
+#define STREE_PARALLEL_SORT_MIN    16384
+#define STREE_SORT_MAX_THREADS     8
+
 #define ROW_TOP_YPIXEL(clist, row) (((clist)->row_height * (row)) + \
 				    (((row) + 1) * CELL_SPACING) + \
 				    (clist)->voffset)
@@ -84,6 +90,7 @@ static void gtk_sctree_clear (GtkCMCList *clist);
 static void gtk_sctree_real_unselect_all (GtkCMCList *clist);
        
 static void stree_sort (GtkCMCTree *ctree, GtkCMCTreeNode  *node, gpointer data);
+static void stree_sort_by_keys (GtkCMCTree *ctree, GtkCMCTreeNode  *node, gpointer data);
 void gtk_sctree_sort_node (GtkCMCTree *ctree, GtkCMCTreeNode *node);
 void gtk_sctree_sort_recursive (GtkCMCTree *ctree, GtkCMCTreeNode *node);
 
@@ -1178,9 +1185,294 @@ stree_sort (GtkCMCTree    *ctree,
 	g_ptr_array_free( viewable_array, TRUE);
 }
 
-void
-gtk_sctree_sort_recursive (GtkCMCTree     *ctree, 
-			  GtkCMCTreeNode *node)
+typedef struct _StreeSortKeys StreeSortKeys;
+struct _StreeSortKeys {
+	GtkSCTreeSortKeyFunc func;
+	gpointer data;
+};
+
+typedef struct _StreeSortTask StreeSortTask;
+struct _StreeSortTask {
+	GtkSCTreeSortKey *src;
+	GtkSCTreeSortKey *dst;
+	gsize start, mid, end;
+	gboolean merge;
+};
+
+static gint stree_sort_key_cmp(gconstpointer a, gconstpointer b)
+{
+	const GtkSCTreeSortKey *key1 = a;
+	const GtkSCTreeSortKey *key2 = b;
+	guint i;
+	gint res;
+
+	if (key1->str != key2->str) {
+		if (!key1->str)
+			return 1;
+		if (!key2->str)
+			return -1;
+		res = strcmp(key1->str, key2->str);
+		if (res != 0)
+			return res;
+	}
+
+	for (i = 0; i < G_N_ELEMENTS(key1->num); i++) {
+		if (key1->num[i] != key2->num[i])
+			return (key1->num[i] < key2->num[i]) ? -1 : 1;
+	}
+
+	return 0;
+}
+
+/* Either sorts src[start, end) in place, or merges the sorted runs
+ * src[start, mid) and src[mid, end) into dst[start, end). Only reads
+ * the keys, so that it can run in any thread. */
+static void stree_sort_task_func(gpointer data, gpointer user_data)
+{
+	StreeSortTask *task = (StreeSortTask *)data;
+	GtkSCTreeSortKey *src = task->src;
+	GtkSCTreeSortKey *dst = task->dst;
+	gsize i, j, k;
+
+	if (!task->merge) {
+		qsort(src + task->start, task->end - task->start,
+		      sizeof(GtkSCTreeSortKey), stree_sort_key_cmp);
+		return;
+	}
+
+	i = task->start;
+	j = task->mid;
+	k = task->start;
+	while (i < task->mid && j < task->end) {
+		if (stree_sort_key_cmp(&src[i], &src[j]) <= 0)
+			dst[k++] = src[i++];
+		else
+			dst[k++] = src[j++];
+	}
+	if (i < task->mid)
+		memcpy(&dst[k], &src[i], (task->mid - i) * sizeof(GtkSCTreeSortKey));
+	if (j < task->end)
+		memcpy(&dst[k], &src[j], (task->end - j) * sizeof(GtkSCTreeSortKey));
+}
+
+static void stree_sort_run_tasks(StreeSortTask *tasks, gint count)
+{
+	GThreadPool *pool;
+	GError *error = NULL;
+	gint i;
+
+	if (count == 1) {
+		stree_sort_task_func(&tasks[0], NULL);
+		return;
+	}
+
+	pool = g_thread_pool_new(stree_sort_task_func, NULL, count, TRUE, &error);
+	if (pool == NULL) {
+		g_warning("couldn't create sort threads: %s",
+			  error ? error->message : "unknown error");
+		if (error)
+			g_error_free(error);
+		for (i = 0; i < count; i++)
+			stree_sort_task_func(&tasks[i], NULL);
+		return;
+	}
+
+	for (i = 0; i < count; i++)
+		g_thread_pool_push(pool, &tasks[i], NULL);
+	/* Waits for all queued tasks to finish */
+	g_thread_pool_free(pool, FALSE, TRUE);
+}
+
+/* Sorts the packed keys. Long arrays are cut in one run per thread,
+ * the runs are sorted concurrently and then merged pairwise, each
+ * round of merges running concurrently as well. */
+static void stree_sort_keys(GtkSCTreeSortKey *keys, gsize n)
+{
+	GtkSCTreeSortKey *src, *dst, *tmp;
+	StreeSortTask *tasks;
+	gsize *bounds;
+	gint threads, runs, new_runs, i;
+
+	threads = MIN(cm_get_num_processors(), STREE_SORT_MAX_THREADS);
+	if (threads < 2 || n < STREE_PARALLEL_SORT_MIN) {
+		qsort(keys, n, sizeof(GtkSCTreeSortKey), stree_sort_key_cmp);
+		return;
+	}
+
+	tmp = g_new(GtkSCTreeSortKey, n);
+	tasks = g_new0(StreeSortTask, threads);
+	bounds = g_new(gsize, threads + 1);
+
+	runs = threads;
+	for (i = 0; i <= runs; i++)
+		bounds[i] = n * i / runs;
+
+	src = keys;
+	dst = tmp;
+	for (i = 0; i < runs; i++) {
+		tasks[i].src = src;
+		tasks[i].start = bounds[i];
+		tasks[i].end = bounds[i + 1];
+		tasks[i].merge = FALSE;
+	}
+	stree_sort_run_tasks(tasks, runs);
+
+	while (runs > 1) {
+		GtkSCTreeSortKey *swap;
+
+		new_runs = (runs + 1) / 2;
+		for (i = 0; i + 1 < runs; i += 2) {
+			StreeSortTask *task = &tasks[i / 2];
+
+			task->src = src;
+			task->dst = dst;
+			task->start = bounds[i];
+			task->mid = bounds[i + 1];
+			task->end = bounds[i + 2];
+			task->merge = TRUE;
+		}
+		/* an odd run out is carried over to the next round */
+		if (runs % 2)
+			memcpy(&dst[bounds[runs - 1]], &src[bounds[runs - 1]],
+			       (bounds[runs] - bounds[runs - 1]) * sizeof(GtkSCTreeSortKey));
+		stree_sort_run_tasks(tasks, runs / 2);
+
+		for (i = 0; i < new_runs; i++)
+			bounds[i] = bounds[i * 2];
+		bounds[new_runs] = n;
+		runs = new_runs;
+
+		swap = src;
+		src = dst;
+		dst = swap;
+	}
+
+	if (src != keys)
+		memcpy(keys, src, n * sizeof(GtkSCTreeSortKey));
+
+	g_free(bounds);
+	g_free(tasks);
+	g_free(tmp);
+}
+
+/* Puts the children of node (the toplevel rows if node is NULL) in the
+ * order of nodes, which holds all of them. Each child keeps its visible
+ * subtree, so only the links between those subtrees change, and the
+ * rows count, levels and expansion states stay as they are. */
+static void
+stree_relink_children (GtkCMCTree     *ctree,
+		       GtkCMCTreeNode *node,
+		       GtkCMCTreeNode **nodes,
+		       gsize           n)
+{
+	GtkCMCList *clist;
+	GtkCMCTreeNode *first, *last;
+	GList *before, *after, *end, *prev_end, *list;
+	gboolean link_before;
+	gsize i;
+
+	clist = GTK_CMCLIST (ctree);
+
+	if (node)
+		first = GTK_CMCTREE_ROW (node)->children;
+	else
+		first = GTK_CMCTREE_NODE (clist->row_list);
+
+	for (last = first; GTK_CMCTREE_ROW (last)->sibling;
+	     last = GTK_CMCTREE_ROW (last)->sibling)
+		;
+
+	end = (GList *) gtk_sctree_last_visible (ctree, last);
+	before = ((GList *) first)->prev;
+	after = end->next;
+	/* the children of a collapsed node point back to it, but are not
+	 * linked from it */
+	link_before = (before && before->next == (GList *) first);
+
+	prev_end = NULL;
+	for (i = 0; i < n; i++) {
+		list = (GList *) nodes[i];
+		if (prev_end) {
+			prev_end->next = list;
+			list->prev = prev_end;
+		} else
+			list->prev = before;
+		GTK_CMCTREE_ROW (nodes[i])->sibling = (i + 1 < n) ? nodes[i + 1] : NULL;
+		prev_end = (GList *) gtk_sctree_last_visible (ctree, nodes[i]);
+	}
+
+	prev_end->next = after;
+	if (after)
+		after->prev = prev_end;
+	if (link_before)
+		before->next = (GList *) nodes[0];
+
+	if (node)
+		GTK_CMCTREE_ROW (node)->children = nodes[0];
+	else
+		clist->row_list = (GList *) nodes[0];
+
+	if (clist->row_list_end == end)
+		clist->row_list_end = prev_end;
+}
+
+static void
+stree_sort_by_keys (GtkCMCTree    *ctree,
+		    GtkCMCTreeNode *node,
+		    gpointer      data)
+{
+	StreeSortKeys *sort_keys = (StreeSortKeys *) data;
+	GtkCMCTreeNode *work;
+	GtkCMCTreeNode **nodes;
+	GtkSCTreeSortKey *keys;
+	GtkCMCList *clist;
+	gsize n, i;
+
+	clist = GTK_CMCLIST (ctree);
+
+	if (node)
+		work = GTK_CMCTREE_ROW (node)->children;
+	else
+		work = GTK_CMCTREE_NODE (clist->row_list);
+
+	for (n = 0; work; work = GTK_CMCTREE_ROW (work)->sibling)
+		n++;
+	if (n < 2)
+		return;
+
+	if (node)
+		work = GTK_CMCTREE_ROW (node)->children;
+	else
+		work = GTK_CMCTREE_NODE (clist->row_list);
+
+	keys = g_new0 (GtkSCTreeSortKey, n);
+	for (i = 0; i < n; i++, work = GTK_CMCTREE_ROW (work)->sibling) {
+		keys[i].node = work;
+		sort_keys->func (GTK_SCTREE (ctree), work, &keys[i], sort_keys->data);
+	}
+
+	stree_sort_keys (keys, n);
+
+	nodes = g_new (GtkCMCTreeNode *, n);
+	for (i = 0; i < n; i++) {
+		if (clist->sort_type == GTK_SORT_ASCENDING)
+			nodes[i] = keys[i].node;
+		else
+			nodes[n - 1 - i] = keys[i].node;
+		g_free (keys[i].str);
+	}
+	g_free (keys);
+
+	stree_relink_children (ctree, node, nodes, n);
+
+	g_free (nodes);
+}
+
+static void
+stree_sort_recursive (GtkCMCTree     *ctree, 
+		      GtkCMCTreeNode *node,
+		      GtkCMCTreeFunc  sort_func,
+		      gpointer        data)
 {
 	GtkCMCList *clist;
 	GtkCMCTreeNode *focus_node = NULL;
@@ -1206,10 +1498,10 @@ gtk_sctree_sort_recursive (GtkCMCTree     *ctree,
       
 	GTK_SCTREE(ctree)->sorting = TRUE;
 
-	gtk_cmctree_post_recursive (ctree, node, GTK_CMCTREE_FUNC (stree_sort), NULL);
+	gtk_cmctree_post_recursive (ctree, node, sort_func, data);
 
 	if (!node)
-		stree_sort (ctree, NULL, NULL);
+		sort_func (ctree, NULL, data);
 
 	GTK_SCTREE(ctree)->sorting = FALSE;
 
@@ -1221,6 +1513,33 @@ gtk_sctree_sort_recursive (GtkCMCTree     *ctree,
 	gtk_cmclist_thaw (clist);
 }
 
+void
+gtk_sctree_sort_recursive (GtkCMCTree     *ctree, 
+			  GtkCMCTreeNode *node)
+{
+	stree_sort_recursive (ctree, node, GTK_CMCTREE_FUNC (stree_sort), NULL);
+}
+
+/* Like gtk_sctree_sort_recursive(), but func is asked once for the sort
+ * key of every row instead of comparing rows with clist->compare, and
+ * each list of siblings is put in its new order in one go. */
+void
+gtk_sctree_sort_recursive_by_keys (GtkCMCTree           *ctree, 
+				   GtkCMCTreeNode       *node,
+				   GtkSCTreeSortKeyFunc  func,
+				   gpointer              data)
+{
+	StreeSortKeys sort_keys;
+
+	cm_return_if_fail (func != NULL);
+
+	sort_keys.func = func;
+	sort_keys.data = data;
+
+	stree_sort_recursive (ctree, node, GTK_CMCTREE_FUNC (stree_sort_by_keys),
+			      &sort_keys);
+}
+
 void
 gtk_sctree_sort_node (GtkCMCTree     *ctree, 
 		     GtkCMCTreeNode *node)
@@ -17,6 +17,21 @@
 
 typedef struct _GtkSCTree GtkSCTree;
 typedef struct _GtkSCTreeClass GtkSCTreeClass;
+typedef struct _GtkSCTreeSortKey GtkSCTreeSortKey;
+
+/* A sort key extracted once per row. str is compared first with
+ * strcmp(), rows without one go last, then the numbers in order.
+ * str is freed by the tree after sorting. */
+struct _GtkSCTreeSortKey {
+	gchar *str;
+	gint64 num[3];
+	GtkCMCTreeNode *node;
+};
+
+typedef void (*GtkSCTreeSortKeyFunc) (GtkSCTree		*sctree,
+				      GtkCMCTreeNode	*node,
+				      GtkSCTreeSortKey	*key,
+				      gpointer		 data);
 
 struct _GtkSCTree {
 	GtkCMCTree ctree;
@@ -88,6 +103,9 @@ void gtk_sctree_sort_node (GtkCMCTree *ctree, GtkCMCTreeNode *node);
 
 void gtk_sctree_sort_recursive (GtkCMCTree *ctree, GtkCMCTreeNode *node);
 
+void gtk_sctree_sort_recursive_by_keys (GtkCMCTree *ctree, GtkCMCTreeNode *node,
+					GtkSCTreeSortKeyFunc func, gpointer data);
+
 GtkCMCTreeNode* gtk_sctree_insert_node        (GtkCMCTree *ctree,
                                              GtkCMCTreeNode *parent,
                                              GtkCMCTreeNode *sibling,
@@ -0,0 +1,335 @@
+/*
+ * Claws Mail -- a GTK+ based, lightweight, and fast e-mail client
+ * Copyright (C) 2026 the Claws Mail team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#include "claws-features.h"
+#endif
+
+#include <glib.h>
+#include <glib/gi18n.h>
+
+#include <gtk/gtk.h>
+#include <gdk/gdkkeysyms.h>
+
+#include "defs.h"
+#include "metricswindow.h"
+#include "metrics.h"
+#include "gtkutils.h"
+#include "filesel.h"
+#include "alertpanel.h"
+#include "manage_window.h"
+#include "prefs_common.h"
+#include "file-utils.h"
+#include "utils.h"
+
+/* how often the shown values are refreshed, in milliseconds */
+#define METRICSWINDOW_REFRESH	1000
+
+enum {
+	METRICSWINDOW_NAME,
+	METRICSWINDOW_COUNT,
+	METRICSWINDOW_TOTAL,
+	METRICSWINDOW_MEAN,
+	METRICSWINDOW_P95,
+	METRICSWINDOW_MAX,
+	N_METRICSWINDOW_COLUMNS
+};
+
+typedef struct _MetricsWindow
+{
+	GtkWidget *window;
+	GtkWidget *list_view;
+
+	guint refresh_tag;
+} MetricsWindow;
+
+static MetricsWindow *metricswindow = NULL;
+
+static gchar *metrics_window_format_ms(gint64 usec)
+{
+	return g_strdup_printf("%.2f", usec / 1000.0);
+}
+
+static void metrics_window_set_stat(GtkListStore *store, GtkTreeIter *iter,
+				    MetricsStat *stat)
+{
+	gchar *count, *total = NULL, *mean = NULL, *p95 = NULL, *max = NULL;
+
+	count = g_strdup_printf("%" G_GINT64_FORMAT, stat->count);
+	if (stat->type == METRICS_HISTOGRAM && stat->count > 0) {
+		total = metrics_window_format_ms(stat->sum);
+		mean = metrics_window_format_ms(stat->sum / stat->count);
+		p95 = metrics_window_format_ms(stat->p95);
+		max = metrics_window_format_ms(stat->max);
+	}
+
+	gtk_list_store_set(store, iter,
+			   METRICSWINDOW_NAME, stat->name,
+			   METRICSWINDOW_COUNT, count,
+			   METRICSWINDOW_TOTAL, total ? total : "",
+			   METRICSWINDOW_MEAN, mean ? mean : "",
+			   METRICSWINDOW_P95, p95 ? p95 : "",
+			   METRICSWINDOW_MAX, max ? max : "",
+			   -1);
+
+	g_free(count);
+	g_free(total);
+	g_free(mean);
+	g_free(p95);
+	g_free(max);
+}
+
+/* the metrics are never removed and come sorted by name, so the rows
+ * are updated in place and the selection and scrolling are kept */
+static void metrics_window_refresh(MetricsWindow *mwin)
+{
+	GtkListStore *store;
+	GtkTreeIter iter;
+	GSList *stats, *cur;
+	gboolean valid;
+
+	store = GTK_LIST_STORE(gtk_tree_view_get_model
+			       (GTK_TREE_VIEW(mwin->list_view)));
+	stats = metrics_get_stats();
+
+	valid = gtk_tree_model_get_iter_first(GTK_TREE_MODEL(store), &iter);
+	for (cur = stats; cur != NULL; cur = cur->next) {
+		if (!valid)
+			gtk_list_store_append(store, &iter);
+		metrics_window_set_stat(store, &iter, (MetricsStat *)cur->data);
+		if (valid)
+			valid = gtk_tree_model_iter_next(GTK_TREE_MODEL(store),
+							 &iter);
+	}
+	while (valid)
+		valid = gtk_list_store_remove(store, &iter);
+
+	metrics_free_stats(stats);
+}
+
+static gboolean metrics_window_refresh_cb(gpointer data)
+{
+	metrics_window_refresh((MetricsWindow *)data);
+
+	return TRUE;
+}
+
+static void metrics_window_export(const gchar *title, const gchar *filename,
+				  gchar *str)
+{
+	gchar *path;
+
+	path = filesel_select_file_save(title, filename);
+	if (path != NULL && *path != '\0') {
+		if (str_write_to_file(str, path, TRUE) < 0)
+			alertpanel_error(_("Couldn't write to file '%s'."), path);
+	}
+	g_free(path);
+	g_free(str);
+}
+
+static void export_json_cb(GtkButton *button, MetricsWindow *mwin)
+{
+	metrics_window_export(_("Export metrics as JSON"),
+			      "claws-metrics.json", metrics_to_json());
+}
+
+static void export_trace_cb(GtkButton *button, MetricsWindow *mwin)
+{
+	metrics_window_export(_("Export metrics as trace"),
+			      "claws-trace.json", metrics_to_chrome_trace());
+}
+
+static void reset_cb(GtkButton *button, MetricsWindow *mwin)
+{
+	metrics_reset();
+	metrics_window_refresh(mwin);
+}
+
+static void close_cb(GtkButton *button, MetricsWindow *mwin)
+{
+	g_source_remove(mwin->refresh_tag);
+	gtk_widget_destroy(mwin->window);
+	g_free(mwin);
+	metricswindow = NULL;
+}
+
+static gint metrics_window_delete_cb(GtkWidget *widget, GdkEventAny *event,
+				     MetricsWindow *mwin)
+{
+	close_cb(NULL, mwin);
+	return TRUE;
+}
+
+static gboolean metrics_window_key_pressed(GtkWidget *widget,
+					   GdkEventKey *event,
+					   MetricsWindow *mwin)
+{
+	if (event && event->keyval == GDK_KEY_Escape) {
+		close_cb(NULL, mwin);
+		return TRUE;
+	}
+	return FALSE;
+}
+
+static void metrics_window_add_column(GtkTreeView *list_view,
+				      const gchar *title, gint col,
+				      gboolean numeric)
+{
+	GtkTreeViewColumn *column;
+	GtkCellRenderer *renderer;
+
+	renderer = gtk_cell_renderer_text_new();
+	if (numeric)
+		g_object_set(renderer, "xalign", 1.0, NULL);
+	column = gtk_tree_view_column_new_with_attributes
+		(title, renderer, "text", col, NULL);
+	gtk_tree_view_column_set_resizable(column, TRUE);
+	if (!numeric)
+		gtk_tree_view_column_set_expand(column, TRUE);
+	gtk_tree_view_append_column(list_view, column);
+}
+
+static GtkWidget *metrics_window_list_view_create(void)
+{
+	GtkTreeView *list_view;
+	GtkListStore *store;
+
+	store = gtk_list_store_new(N_METRICSWINDOW_COLUMNS,
+				   G_TYPE_STRING, G_TYPE_STRING,
+				   G_TYPE_STRING, G_TYPE_STRING,
+				   G_TYPE_STRING, G_TYPE_STRING,
+				   -1);
+	list_view = GTK_TREE_VIEW(gtk_tree_view_new_with_model
+				  (GTK_TREE_MODEL(store)));
+	g_object_unref(store);
+
+	gtk_tree_view_set_rules_hint(list_view, prefs_common.use_stripes_everywhere);
+	gtk_tree_view_set_search_column(list_view, METRICSWINDOW_NAME);
+
+	metrics_window_add_column(list_view, _("Name"),
+				  METRICSWINDOW_NAME, FALSE);
+	metrics_window_add_column(list_view, _("Count"),
+				  METRICSWINDOW_COUNT, TRUE);
+	metrics_window_add_column(list_view, _("Total (ms)"),
+				  METRICSWINDOW_TOTAL, TRUE);
+	metrics_window_add_column(list_view, _("Mean (ms)"),
+				  METRICSWINDOW_MEAN, TRUE);
+	metrics_window_add_column(list_view, _("95% (ms)"),
+				  METRICSWINDOW_P95, TRUE);
+	metrics_window_add_column(list_view, _("Max (ms)"),
+				  METRICSWINDOW_MAX, TRUE);
+
+	return GTK_WIDGET(list_view);
+}
+
+static MetricsWindow *metrics_window_create(void)
+{
+	MetricsWindow *mwin;
+	GtkWidget *window;
+	GtkWidget *vbox;
+	GtkWidget *scrolledwin;
+	GtkWidget *list_view;
+	GtkWidget *hbox;
+	GtkWidget *action_bbox;
+	GtkWidget *close_bbox;
+	GtkWidget *reset_btn;
+	GtkWidget *json_btn;
+	GtkWidget *trace_btn;
+	GtkWidget *close_btn;
+
+	debug_print("Creating metrics window...\n");
+
+	mwin = g_new0(MetricsWindow, 1);
+
+	window = gtkut_window_new(GTK_WINDOW_TOPLEVEL, "metricswindow");
+	gtk_container_set_border_width(GTK_CONTAINER(window), 8);
+	gtk_window_set_title(GTK_WINDOW(window), _("Performance metrics"));
+	gtk_window_set_default_size(GTK_WINDOW(window), 600, 400);
+	manage_window_set_transient(GTK_WINDOW(window));
+
+	vbox = gtk_vbox_new(FALSE, 6);
+	gtk_container_add(GTK_CONTAINER(window), vbox);
+
+	scrolledwin = gtk_scrolled_window_new(NULL, NULL);
+	gtk_scrolled_window_set_shadow_type(GTK_SCROLLED_WINDOW(scrolledwin),
+					    GTK_SHADOW_ETCHED_IN);
+	gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(scrolledwin),
+				       GTK_POLICY_AUTOMATIC,
+				       GTK_POLICY_AUTOMATIC);
+	gtk_box_pack_start(GTK_BOX(vbox), scrolledwin, TRUE, TRUE, 0);
+
+	list_view = metrics_window_list_view_create();
+	gtk_container_add(GTK_CONTAINER(scrolledwin), list_view);
+
+	hbox = gtk_hbox_new(FALSE, 6);
+	gtk_box_pack_end(GTK_BOX(vbox), hbox, FALSE, FALSE, 0);
+
+	gtkut_stock_button_set_create(&action_bbox,
+				      &reset_btn, _("_Reset"),
+				      &json_btn, _("Export as _JSON..."),
+				      &trace_btn, _("Export as _trace..."));
+	gtk_button_box_set_layout(GTK_BUTTON_BOX(action_bbox),
+				  GTK_BUTTONBOX_START);
+	gtk_box_pack_start(GTK_BOX(hbox), action_bbox, TRUE, TRUE, 0);
+
+	gtkut_stock_button_set_create(&close_bbox,
+				      &close_btn, GTK_STOCK_CLOSE,
+				      NULL, NULL, NULL, NULL);
+	gtk_box_pack_end(GTK_BOX(hbox), close_bbox, FALSE, FALSE, 0);
+
+	CLAWS_SET_TIP(trace_btn,
+		      _("Save the recent timings in a format chrome://tracing "
+			"can load"));
+
+	g_signal_connect(G_OBJECT(reset_btn), "clicked",
+			 G_CALLBACK(reset_cb), mwin);
+	g_signal_connect(G_OBJECT(json_btn), "clicked",
+			 G_CALLBACK(export_json_cb), mwin);
+	g_signal_connect(G_OBJECT(trace_btn), "clicked",
+			 G_CALLBACK(export_trace_cb), mwin);
+	g_signal_connect(G_OBJECT(close_btn), "clicked",
+			 G_CALLBACK(close_cb), mwin);
+	g_signal_connect(G_OBJECT(window), "key_press_event",
+			 G_CALLBACK(metrics_window_key_pressed), mwin);
+	g_signal_connect(G_OBJECT(window), "delete_event",
+			 G_CALLBACK(metrics_window_delete_cb), mwin);
+	MANAGE_WINDOW_SIGNALS_CONNECT(window);
+
+	mwin->window = window;
+	mwin->list_view = list_view;
+
+	return mwin;
+}
+
+/* metrics_window_show() - opens the metrics window, or raises it if it
+ * is already open. The values are refreshed while it is open. */
+void metrics_window_show(void)
+{
+	if (metricswindow == NULL) {
+		metricswindow = metrics_window_create();
+		metrics_window_refresh(metricswindow);
+		metricswindow->refresh_tag =
+			g_timeout_add(METRICSWINDOW_REFRESH,
+				      metrics_window_refresh_cb, metricswindow);
+		gtk_widget_show_all(metricswindow->window);
+	}
+
+	gtk_window_present(GTK_WINDOW(metricswindow->window));
+}
@@ -42,6 +42,7 @@ static void sc_html_append_char			(SC_HTMLParser	*parser,
 static void sc_html_append_str			(SC_HTMLParser	*parser,
 					 const gchar	*str,
 					 gint		 len);
+static void sc_html_append_text			(SC_HTMLParser	*parser);
 static SC_HTMLState sc_html_parse_tag	(SC_HTMLParser	*parser);
 static void sc_html_parse_special		(SC_HTMLParser	*parser);
 static void sc_html_get_parenthesis		(SC_HTMLParser	*parser,
@@ -123,9 +124,10 @@ gchar *sc_html_parse(SC_HTMLParser *parser)
 				parser->bufp++;
 				break;
 			}
-			/* fallthrough */
-		default:
 			sc_html_append_char(parser, *parser->bufp++);
+			break;
+		default:
+			sc_html_append_text(parser);
 		}
 	}
 
@@ -195,6 +197,27 @@ static void sc_html_append_char(SC_HTMLParser *parser, gchar ch)
 		parser->newline = FALSE;
 }
 
+/* Appends the text at bufp up to the next markup or white space, as
+ * sc_html_append_char() would one char at a time */
+static void sc_html_append_text(SC_HTMLParser *parser)
+{
+	const gchar *p = parser->bufp;
+
+	while (*p != '\0' && *p != '<' && *p != '&' && *p != ' ' &&
+	       *p != '\t' && *p != '\r' && *p != '\n')
+		p++;
+
+	if (!parser->pre && parser->space) {
+		g_string_append_c(parser->str, ' ');
+		parser->space = FALSE;
+	}
+	g_string_append_len(parser->str, parser->bufp, p - parser->bufp);
+	parser->bufp = (gchar *)p;
+
+	parser->empty_line = FALSE;
+	parser->newline = FALSE;
+}
+
 static void sc_html_append_str(SC_HTMLParser *parser, const gchar *str, gint len)
 {
 	GString *string = parser->str;
@@ -341,24 +364,164 @@ static void decode_href(SC_HTMLParser *parser)
 	sc_html_parser_destroy(tparser);
 }
 
+typedef enum
+{
+	SC_HTML_TAG_OTHER,
+	SC_HTML_TAG_A,
+	SC_HTML_TAG_A_END,
+	SC_HTML_TAG_BLOCKQUOTE,
+	SC_HTML_TAG_BLOCKQUOTE_END,
+	SC_HTML_TAG_BR,
+	SC_HTML_TAG_DIV,	/* and the other blocks starting a line */
+	SC_HTML_TAG_DIV_END,	/* and the other blocks ending a line */
+	SC_HTML_TAG_H,
+	SC_HTML_TAG_HR,
+	SC_HTML_TAG_LI,
+	SC_HTML_TAG_P,
+	SC_HTML_TAG_PRE,
+	SC_HTML_TAG_PRE_END,
+	SC_HTML_TAG_TABLE_END	/* and the headings' ends */
+} SC_HTMLTagId;
+
+/* Identifies the tag named by the lower-case name */
+static SC_HTMLTagId sc_html_get_tag_id(const gchar *name)
+{
+	switch (name[0]) {
+	case 'a':
+		if (name[1] == '\0')
+			return SC_HTML_TAG_A;
+		break;
+	case 'b':
+		if (!strcmp(name, "br") || !strcmp(name, "br/"))
+			return SC_HTML_TAG_BR;
+		if (!strcmp(name, "blockquote"))
+			return SC_HTML_TAG_BLOCKQUOTE;
+		break;
+	case 'd':
+		if (!strcmp(name, "div") || !strcmp(name, "dd"))
+			return SC_HTML_TAG_DIV;
+		break;
+	case 'h':
+		if (!strcmp(name, "hr"))
+			return SC_HTML_TAG_HR;
+		if (g_ascii_isdigit(name[1]))
+			return SC_HTML_TAG_H;
+		break;
+	case 'l':
+		if (!strcmp(name, "li"))
+			return SC_HTML_TAG_LI;
+		break;
+	case 'p':
+		if (name[1] == '\0')
+			return SC_HTML_TAG_P;
+		if (!strcmp(name, "pre"))
+			return SC_HTML_TAG_PRE;
+		break;
+	case 't':
+		if (!strcmp(name, "table") || !strcmp(name, "tr"))
+			return SC_HTML_TAG_DIV;
+		break;
+	case 'u':
+		if (!strcmp(name, "ul"))
+			return SC_HTML_TAG_DIV;
+		break;
+	case '/':
+		switch (name[1]) {
+		case 'a':
+			if (name[2] == '\0')
+				return SC_HTML_TAG_A_END;
+			break;
+		case 'b':
+			if (!strcmp(name, "/blockquote"))
+				return SC_HTML_TAG_BLOCKQUOTE_END;
+			break;
+		case 'd':
+			if (!strcmp(name, "/div"))
+				return SC_HTML_TAG_DIV_END;
+			break;
+		case 'h':
+			if (g_ascii_isdigit(name[2]))
+				return SC_HTML_TAG_TABLE_END;
+			break;
+		case 'l':
+			if (!strcmp(name, "/li"))
+				return SC_HTML_TAG_DIV_END;
+			break;
+		case 'p':
+			if (!strcmp(name, "/pre"))
+				return SC_HTML_TAG_PRE_END;
+			break;
+		case 't':
+			if (!strcmp(name, "/table"))
+				return SC_HTML_TAG_TABLE_END;
+			break;
+		case 'u':
+			if (!strcmp(name, "/ul"))
+				return SC_HTML_TAG_DIV_END;
+			break;
+		}
+		break;
+	}
+
+	return SC_HTML_TAG_OTHER;
+}
+
+/* Identifies the tag in buf, as sc_html_get_tag() would name it, without
+ * parsing its attributes */
+static SC_HTMLTagId sc_html_get_tag_id_from_buf(const gchar *buf)
+{
+	gchar name[16];
+	gchar *tmp, *lower;
+	SC_HTMLTagId id;
+	gint i;
+
+	for (i = 0; buf[i] != '\0' && !g_ascii_isspace(buf[i]); i++) {
+		if (i == sizeof(name) - 1 || (guchar)buf[i] >= 0x80)
+			break;
+		name[i] = g_ascii_tolower(buf[i]);
+	}
+	if (buf[i] == '\0' || g_ascii_isspace(buf[i])) {
+		name[i] = '\0';
+		return sc_html_get_tag_id(name);
+	}
+
+	/* long or not ASCII, the way sc_html_get_tag() does it */
+	for (; buf[i] != '\0' && !g_ascii_isspace(buf[i]); i++)
+		;
+	tmp = g_strndup(buf, i);
+	lower = g_utf8_strdown(tmp, -1);
+	id = sc_html_get_tag_id(lower);
+	g_free(lower);
+	g_free(tmp);
+
+	return id;
+}
+
 static SC_HTMLState sc_html_parse_tag(SC_HTMLParser *parser)
 {
 	gchar buf[SC_HTMLBUFSIZE];
 	SC_HTMLTag *tag;
+	SC_HTMLTagId id;
 
 	sc_html_get_parenthesis(parser, buf, sizeof(buf));
 
-	tag = sc_html_get_tag(buf);
-
 	parser->state = SC_HTML_UNKNOWN;
-	if (!tag) return SC_HTML_UNKNOWN;
+	if (buf[0] == '\0' || buf[0] == '!')
+		return SC_HTML_UNKNOWN;
+
+	id = sc_html_get_tag_id_from_buf(buf);
 
-	if (!strcmp(tag->name, "br") || !strcmp(tag->name, "br/")) {
+	switch (id) {
+	case SC_HTML_TAG_BR:
 		parser->space = FALSE;
 		sc_html_append_char(parser, '\n');
 		parser->state = SC_HTML_BR;
-	} else if (!strcmp(tag->name, "a")) {
+		break;
+	case SC_HTML_TAG_A: {
 		GList *cur;
+
+		/* the only tag whose attributes matter */
+		tag = sc_html_get_tag(buf);
 		if (parser->href != NULL) {
 			g_free(parser->href);
 			parser->href = NULL;
@@ -375,9 +538,13 @@ static SC_HTMLState sc_html_parse_tag(SC_HTMLParser *parser)
 		if (parser->href == NULL)
 			parser->href = g_strdup("");
 		parser->state = SC_HTML_HREF_BEG;
-	} else if (!strcmp(tag->name, "/a")) {
+		sc_html_free_tag(tag);
+		break;
+	}
+	case SC_HTML_TAG_A_END:
 		parser->state = SC_HTML_HREF;
-	} else if (!strcmp(tag->name, "p")) {
+		break;
+	case SC_HTML_TAG_P:
 		parser->space = FALSE;
 		if (!parser->empty_line) {
 			parser->space = FALSE;
@@ -385,13 +552,16 @@ static SC_HTMLState sc_html_parse_tag(SC_HTMLParser *parser)
 			sc_html_append_char(parser, '\n');
 		}
 		parser->state = SC_HTML_PAR;
-	} else if (!strcmp(tag->name, "pre")) {
+		break;
+	case SC_HTML_TAG_PRE:
 		parser->pre = TRUE;
 		parser->state = SC_HTML_PRE;
-	} else if (!strcmp(tag->name, "/pre")) {
+		break;
+	case SC_HTML_TAG_PRE_END:
 		parser->pre = FALSE;
 		parser->state = SC_HTML_NORMAL;
-	} else if (!strcmp(tag->name, "hr")) {
+		break;
+	case SC_HTML_TAG_HR:
 		if (!parser->newline) {
 			parser->space = FALSE;
 			sc_html_append_char(parser, '\n');
@@ -399,68 +569,64 @@ static SC_HTMLState sc_html_parse_tag(SC_HTMLParser *parser)
 		sc_html_append_str(parser, HR_STR, -1);
 		sc_html_append_char(parser, '\n');
 		parser->state = SC_HTML_HR;
-	} else if (!strcmp(tag->name, "div")    ||
-		   !strcmp(tag->name, "ul")     ||
-		   !strcmp(tag->name, "li")     ||
-		   !strcmp(tag->name, "table")  ||
-		   !strcmp(tag->name, "dd")     ||
-		   !strcmp(tag->name, "tr")) {
+		break;
+	case SC_HTML_TAG_DIV:
+	case SC_HTML_TAG_LI:
 		if (!parser->newline) {
 			parser->space = FALSE;
 			sc_html_append_char(parser, '\n');
 		}
-		if (!strcmp(tag->name, "li")) {
+		if (id == SC_HTML_TAG_LI) {
 			sc_html_append_str(parser, LI_STR, -1);
 		}
 		parser->state = SC_HTML_NORMAL;
-	} else if (tag->name[0] == 'h' && g_ascii_isdigit(tag->name[1])) {
+		break;
+	case SC_HTML_TAG_H:
 		if (!parser->newline) {
 			parser->space = FALSE;
 			sc_html_append_char(parser, '\n');
 		}
 		sc_html_append_char(parser, '\n');
-	} else if (!strcmp(tag->name, "blockquote")) {
+		break;
+	case SC_HTML_TAG_BLOCKQUOTE:
 		parser->state = SC_HTML_NORMAL;
 		parser->indent++;
-	} else if (!strcmp(tag->name, "/blockquote")) {
+		break;
+	case SC_HTML_TAG_BLOCKQUOTE_END:
 		parser->state = SC_HTML_NORMAL;
 		parser->indent--;
-	} else if (!strcmp(tag->name, "/table") ||
-		   (tag->name[0] == '/' &&
-		    tag->name[1] == 'h' &&
-		    g_ascii_isdigit(tag->name[2]))) {
+		break;
+	case SC_HTML_TAG_TABLE_END:
 		if (!parser->empty_line) {
 			parser->space = FALSE;
 			if (!parser->newline) sc_html_append_char(parser, '\n');
 			sc_html_append_char(parser, '\n');
 		}
 		parser->state = SC_HTML_NORMAL;
-	} else if (!strcmp(tag->name, "/div")   ||
-		   !strcmp(tag->name, "/ul")    ||
-		   !strcmp(tag->name, "/li")) {
+		break;
+	case SC_HTML_TAG_DIV_END:
 		if (!parser->newline) {
 			parser->space = FALSE;
 			sc_html_append_char(parser, '\n');
 		}
 		parser->state = SC_HTML_NORMAL;
-			}
-
-	sc_html_free_tag(tag);
+		break;
+	case SC_HTML_TAG_OTHER:
+		break;
+	}
 
 	return parser->state;
 }
 
 static void sc_html_parse_special(SC_HTMLParser *parser)
 {
-	gchar *entity;
+	gchar entity[ENTITY_DECODED_MAX_LEN + 1];
 
 	parser->state = SC_HTML_UNKNOWN;
 	cm_return_if_fail(*parser->bufp == '&');
 
-	entity = entity_decode(parser->bufp);
-	if (entity != NULL) {
+	if (entity_decode_to_buffer(parser->bufp, entity)) {
 		sc_html_append_str(parser, entity, -1);
-		g_free(entity);
 		while (*parser->bufp++ != ';');
 	} else {
 		/* output literal `&' */
@@ -76,6 +76,7 @@
 #include "main.h"
 #include "passwordstore.h"
 #include "file-utils.h"
+#include "metrics.h"
 
 typedef struct _IMAPFolder	IMAPFolder;
 typedef struct _IMAPSession	IMAPSession;
@@ -3678,6 +3679,7 @@ static GSList *imap_get_uncached_messages(IMAPSession *session,
 	GSList *result = NULL;
 	GSList * cur;
 	uncached_data *data = g_new0(uncached_data, 1);
+	MetricsSpan span;
 	
 	cur = numlist;
 	data->total = g_slist_length(numlist);
@@ -3725,12 +3727,16 @@ static GSList *imap_get_uncached_messages(IMAPSession *session,
 			return NULL;
 		}
 		
+		metrics_span_begin(&span, "imap.fetch_envelopes");
 		partial_result =
 			(GSList *)imap_get_uncached_messages_thread(data);
+		metrics_span_end(&span);
 		*r = data->ok;
 		if (data->ok != MAILIMAP_NO_ERROR) {
 			goto bail;
 		}
+		metrics_counter_add("imap.envelopes_fetched",
+				    g_slist_length(partial_result));
 		statusbar_progress_all(data->cur,data->total, 1);
 		
 		g_slist_free(newlist);
@@ -4369,6 +4375,7 @@ static gint imap_cmd_fetch(IMAPSession *session, guint32 uid,
 {
 	fetch_data *data = g_new0(fetch_data, 1);
 	int result = 0;
+	MetricsSpan span;
 	data->done = FALSE;
 	data->session = session;
 	data->uid = uid;
@@ -4384,7 +4391,9 @@ static gint imap_cmd_fetch(IMAPSession *session, guint32 uid,
 		return -1;
 	}
 	statusbar_print_all(_("Fetching message..."));
+	metrics_span_begin(&span, "imap.fetch_msg");
 	result = GPOINTER_TO_INT(imap_cmd_fetch_thread(data));
+	metrics_span_end(&span);
 	statusbar_pop_all();
 	g_free(data);
 	return result;
@@ -4398,14 +4407,17 @@ static gint imap_cmd_append(IMAPSession *session,
 			    guint32 *new_uid)
 {
 	struct mailimap_flag_list * flag_list;
+	MetricsSpan span;
 	int r;
 	
 	cm_return_val_if_fail(file != NULL, MAILIMAP_ERROR_BAD_STATE);
 
 	flag_list = imap_flag_to_lep(item, flags, NULL);
 	lock_session(session);
+	metrics_span_begin(&span, "imap.append");
 	r = imap_threaded_append(session->folder, destfolder,
 			 file, flag_list, (int *)new_uid);
+	metrics_span_end(&span);
 	mailimap_flag_list_free(flag_list);
 
 	if (r != MAILIMAP_NO_ERROR) {
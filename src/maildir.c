@@ -0,0 +1,1220 @@
+/*
+ * Claws Mail -- a GTK+ based, lightweight, and fast e-mail client
+ * Copyright (C) 2026 the Claws Mail team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Maildir++ folder class.
+ *
+ * The mailbox root is itself a maildir and shows up as INBOX; every other
+ * folder is a maildir named ".Parent.Child" directly below the root.
+ * Deliveries go through tmp/ and are renamed into new/ (or cur/ when they
+ * already carry flags), so external MDAs can write to the same store
+ * without any locking. The standard flags are kept in the ":2," suffix of
+ * the file names; everything else is left to the MsgCache mark file.
+ *
+ * Maildir file names are not numbers, so each folder keeps a persistent
+ * map from the unique part of the file name to the message number Claws
+ * uses, in MAILDIR_UIDMAP_FILE. Renames done by other MUAs keep the
+ * unique part, so neither flag changes nor new deliveries invalidate the
+ * MsgCache.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#include "claws-features.h"
+#endif
+
+#include "defs.h"
+
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+
+#include "folder.h"
+#include "folder_item_prefs.h"
+#include "maildir.h"
+#include "maildir_store.h"
+#include "procmsg.h"
+#include "procheader.h"
+#include "utils.h"
+#include "file-utils.h"
+#include "statusbar.h"
+#include "gtkutils.h"
+
+#define MAILDIR_INBOX		"INBOX"
+
+static Folder	*maildir_folder_new		(const gchar	*name,
+						 const gchar	*path);
+static void	 maildir_folder_destroy		(Folder		*folder);
+static gint	 maildir_scan_tree		(Folder		*folder);
+static gint	 maildir_create_tree		(Folder		*folder);
+
+static FolderItem *maildir_item_new		(Folder		*folder);
+static void	 maildir_item_destroy		(Folder		*folder,
+						 FolderItem	*item);
+static gchar	*maildir_item_get_path		(Folder		*folder,
+						 FolderItem	*item);
+static FolderItem *maildir_create_folder	(Folder		*folder,
+						 FolderItem	*parent,
+						 const gchar	*name);
+static gint	 maildir_rename_folder		(Folder		*folder,
+						 FolderItem	*item,
+						 const gchar	*name);
+static gint	 maildir_remove_folder		(Folder		*folder,
+						 FolderItem	*item);
+static gint	 maildir_get_num_list		(Folder		*folder,
+						 FolderItem	*item,
+						 GSList		**list,
+						 gboolean	*old_uids_valid);
+static gboolean	 maildir_scan_required		(Folder		*folder,
+						 FolderItem	*item);
+static void	 maildir_set_mtime		(Folder		*folder,
+						 FolderItem	*item);
+
+static MsgInfo	*maildir_get_msginfo		(Folder		*folder,
+						 FolderItem	*item,
+						 gint		 num);
+static gchar	*maildir_fetch_msg		(Folder		*folder,
+						 FolderItem	*item,
+						 gint		 num);
+static gint	 maildir_add_msg		(Folder		*folder,
+						 FolderItem	*dest,
+						 const gchar	*file,
+						 MsgFlags	*flags);
+static gint	 maildir_add_msgs		(Folder		*folder,
+						 FolderItem	*dest,
+						 GSList		*file_list,
+						 GHashTable	*relation);
+static gint	 maildir_copy_msg		(Folder		*folder,
+						 FolderItem	*dest,
+						 MsgInfo	*msginfo);
+static gint	 maildir_copy_msgs		(Folder		*folder,
+						 FolderItem	*dest,
+						 MsgInfoList	*msglist,
+						 GHashTable	*relation);
+static gint	 maildir_remove_msg		(Folder		*folder,
+						 FolderItem	*item,
+						 gint		 num);
+static gint	 maildir_remove_msgs		(Folder		*folder,
+						 FolderItem	*item,
+						 MsgInfoList	*msglist,
+						 GHashTable	*relation);
+static gint	 maildir_remove_all_msg		(Folder		*folder,
+						 FolderItem	*item);
+static gboolean	 maildir_is_msg_changed		(Folder		*folder,
+						 FolderItem	*item,
+						 MsgInfo	*msginfo);
+static void	 maildir_change_flags		(Folder		*folder,
+						 FolderItem	*item,
+						 MsgInfo	*msginfo,
+						 MsgPermFlags	 newflags);
+static gint	 maildir_get_flags		(Folder		*folder,
+						 FolderItem	*item,
+						 MsgInfoList	*msglist,
+						 GHashTable	*msgflags);
+
+static gboolean	 maildir_item_rescan		(FolderItem	*item);
+
+static FolderClass maildir_class;
+
+FolderClass *maildir_get_class(void)
+{
+	if (maildir_class.idstr == NULL) {
+		maildir_class.type = F_MAILDIR;
+		maildir_class.idstr = "maildir";
+		maildir_class.uistr = "Maildir++";
+		maildir_class.supports_server_search = FALSE;
+
+		/* Folder functions */
+		maildir_class.new_folder = maildir_folder_new;
+		maildir_class.destroy_folder = maildir_folder_destroy;
+		maildir_class.set_xml = folder_local_set_xml;
+		maildir_class.get_xml = folder_local_get_xml;
+		maildir_class.scan_tree = maildir_scan_tree;
+		maildir_class.create_tree = maildir_create_tree;
+
+		/* FolderItem functions */
+		maildir_class.item_new = maildir_item_new;
+		maildir_class.item_destroy = maildir_item_destroy;
+		maildir_class.item_get_path = maildir_item_get_path;
+		maildir_class.create_folder = maildir_create_folder;
+		maildir_class.rename_folder = maildir_rename_folder;
+		maildir_class.remove_folder = maildir_remove_folder;
+		maildir_class.get_num_list = maildir_get_num_list;
+		maildir_class.scan_required = maildir_scan_required;
+		maildir_class.set_mtime = maildir_set_mtime;
+
+		/* Message functions */
+		maildir_class.get_msginfo = maildir_get_msginfo;
+		maildir_class.fetch_msg = maildir_fetch_msg;
+		maildir_class.add_msg = maildir_add_msg;
+		maildir_class.add_msgs = maildir_add_msgs;
+		maildir_class.copy_msg = maildir_copy_msg;
+		maildir_class.copy_msgs = maildir_copy_msgs;
+		maildir_class.search_msgs = folder_item_search_msgs_local;
+		maildir_class.remove_msg = maildir_remove_msg;
+		maildir_class.remove_msgs = maildir_remove_msgs;
+		maildir_class.remove_all_msg = maildir_remove_all_msg;
+		maildir_class.is_msg_changed = maildir_is_msg_changed;
+		maildir_class.change_flags = maildir_change_flags;
+		maildir_class.get_flags = maildir_get_flags;
+	}
+
+	return &maildir_class;
+}
+
+static Folder *maildir_folder_new(const gchar *name, const gchar *path)
+{
+	Folder *folder;
+
+	folder = (Folder *)g_new0(MaildirFolder, 1);
+	folder->klass = &maildir_class;
+	folder_local_folder_init(folder, name, path);
+
+	return folder;
+}
+
+static void maildir_folder_destroy(Folder *folder)
+{
+	folder_local_folder_destroy(LOCAL_FOLDER(folder));
+}
+
+static FolderItem *maildir_item_new(Folder *folder)
+{
+	return (FolderItem *)g_new0(MaildirFolderItem, 1);
+}
+
+static void maildir_item_destroy(Folder *folder, FolderItem *item)
+{
+	cm_return_if_fail(item != NULL);
+
+	maildir_uid_map_clear(&MAILDIR_FOLDER_ITEM(item)->map);
+	g_free(item);
+}
+
+/*
+ * uid map, see maildir_store.c
+ */
+
+/* Returns FALSE if there was no map yet, i.e. the numbers in an existing
+ * cache can not be trusted. */
+static gboolean maildir_item_read_map(FolderItem *item)
+{
+	gchar *path;
+	gboolean ret;
+
+	path = folder_item_get_path(item);
+	cm_return_val_if_fail(path != NULL, FALSE);
+	ret = maildir_uid_map_read(&MAILDIR_FOLDER_ITEM(item)->map, path);
+	g_free(path);
+
+	return ret;
+}
+
+static void maildir_item_prepare(FolderItem *item)
+{
+	if (MAILDIR_FOLDER_ITEM(item)->map.uid_by_uniq != NULL)
+		return;
+
+	maildir_item_read_map(item);
+	maildir_item_rescan(item);
+}
+
+/* Lists new/ and cur/ and brings the uid map in sync with them. */
+static gboolean maildir_item_rescan(FolderItem *item)
+{
+	gchar *path;
+	gboolean changed;
+
+	path = folder_item_get_path(item);
+	cm_return_val_if_fail(path != NULL, FALSE);
+	changed = maildir_uid_map_rescan(&MAILDIR_FOLDER_ITEM(item)->map, path);
+	g_free(path);
+
+	return changed;
+}
+
+static const gchar *maildir_item_lookup(FolderItem *item, gint num)
+{
+	MaildirFolderItem *mitem = MAILDIR_FOLDER_ITEM(item);
+
+	maildir_item_prepare(item);
+	return g_hash_table_lookup(mitem->map.file_by_uid, GINT_TO_POINTER(num));
+}
+
+static void maildir_item_forget(FolderItem *item, gint num)
+{
+	maildir_uid_map_forget(&MAILDIR_FOLDER_ITEM(item)->map, num);
+}
+
+/*
+ * Folder functions
+ */
+
+static gchar *maildir_get_root_path(Folder *folder)
+{
+	const gchar *rootpath = LOCAL_FOLDER(folder)->rootpath;
+
+	if (!is_relative_filename(rootpath))
+		return g_strdup(rootpath);
+	return g_strconcat(get_home_dir(), G_DIR_SEPARATOR_S, rootpath, NULL);
+}
+
+static gchar *maildir_item_get_path(Folder *folder, FolderItem *item)
+{
+	gchar *rootpath, *dotted, *fsname, *path;
+
+	cm_return_val_if_fail(folder != NULL, NULL);
+	cm_return_val_if_fail(item != NULL, NULL);
+
+	rootpath = maildir_get_root_path(folder);
+	if (item->path == NULL || !strcmp(item->path, MAILDIR_INBOX))
+		return rootpath;
+
+	dotted = g_strdup(item->path);
+	subst_char(dotted, G_DIR_SEPARATOR, '.');
+	fsname = g_filename_from_utf8(dotted, -1, NULL, NULL, NULL);
+	if (fsname == NULL)
+		fsname = g_strdup(dotted);
+
+	path = g_strconcat(rootpath, G_DIR_SEPARATOR_S, ".", fsname, NULL);
+	g_free(fsname);
+	g_free(dotted);
+	g_free(rootpath);
+
+	return path;
+}
+
+static gint maildir_create_tree(Folder *folder)
+{
+	struct {
+		FolderItem *item;
+		const gchar *name;
+	} specials[] = {
+		{ folder->outbox, "Sent" },
+		{ folder->draft, "Drafts" },
+		{ folder->queue, "Queue" },
+		{ folder->trash, "Trash" }
+	};
+	gchar *rootpath, *path;
+	gint i;
+
+	cm_return_val_if_fail(folder != NULL, -1);
+
+	rootpath = maildir_get_root_path(folder);
+	if (is_file_exist(rootpath) && !is_dir_exist(rootpath)) {
+		g_warning("file '%s' already exists, can't create maildir",
+			  rootpath);
+		g_free(rootpath);
+		return -1;
+	}
+	if (maildir_make_maildir(rootpath) < 0) {
+		g_free(rootpath);
+		return -1;
+	}
+
+	for (i = 0; i < G_N_ELEMENTS(specials); i++) {
+		if (specials[i].item != NULL)
+			continue;
+		path = g_strconcat(rootpath, G_DIR_SEPARATOR_S, ".",
+				   specials[i].name, NULL);
+		if (maildir_make_maildir(path) < 0) {
+			g_free(path);
+			g_free(rootpath);
+			return -1;
+		}
+		g_free(path);
+	}
+
+	g_free(rootpath);
+	return 0;
+}
+
+static FolderItem *maildir_find_child(FolderItem *parent, const gchar *path)
+{
+	GNode *node;
+
+	for (node = parent->node->children; node != NULL; node = node->next) {
+		FolderItem *child = FOLDER_ITEM(node->data);
+
+		if (child->path && !strcmp(child->path, path))
+			return child;
+	}
+
+	return NULL;
+}
+
+static void maildir_set_special(Folder *folder, FolderItem *item)
+{
+	if (!folder->outbox && !g_ascii_strcasecmp(item->path, "Sent")) {
+		item->stype = F_OUTBOX;
+		folder->outbox = item;
+	} else if (!folder->draft && !g_ascii_strcasecmp(item->path, "Drafts")) {
+		item->stype = F_DRAFT;
+		folder->draft = item;
+	} else if (!folder->queue && !g_ascii_strcasecmp(item->path, "Queue")) {
+		item->stype = F_QUEUE;
+		folder->queue = item;
+	} else if (!folder->trash && !g_ascii_strcasecmp(item->path, "Trash")) {
+		item->stype = F_TRASH;
+		folder->trash = item;
+	}
+}
+
+static gboolean maildir_remove_missing_folder_items_func(GNode *node,
+							  gpointer data)
+{
+	FolderItem *item;
+	gchar *path;
+
+	cm_return_val_if_fail(node->data != NULL, FALSE);
+
+	if (G_NODE_IS_ROOT(node))
+		return FALSE;
+
+	item = FOLDER_ITEM(node->data);
+
+	path = folder_item_get_path(item);
+	if (!maildir_is_maildir(path)) {
+		debug_print("maildir '%s' not found. removing...\n",
+			    path ? path : "(null)");
+		folder_item_remove(item);
+	}
+	g_free(path);
+
+	return FALSE;
+}
+
+static gint maildir_scan_tree(Folder *folder)
+{
+	FolderItem *rootitem, *item;
+	GSList *names = NULL, *cur;
+	gchar *rootpath;
+	const gchar *d;
+	GDir *dp;
+	GError *error = NULL;
+
+	cm_return_val_if_fail(folder != NULL, -1);
+
+	if (!folder->node) {
+		rootitem = folder_item_new(folder, folder->name, NULL);
+		rootitem->folder = folder;
+		folder->node = rootitem->node = g_node_new(rootitem);
+	} else
+		rootitem = FOLDER_ITEM(folder->node->data);
+
+	if (maildir_create_tree(folder) < 0)
+		return -1;
+
+	debug_print("searching missing folders...\n");
+	g_node_traverse(folder->node, G_POST_ORDER, G_TRAVERSE_ALL, -1,
+			maildir_remove_missing_folder_items_func, folder);
+
+	if (folder->ui_func)
+		folder->ui_func(folder, rootitem, folder->ui_func_data);
+
+	item = maildir_find_child(rootitem, MAILDIR_INBOX);
+	if (item == NULL) {
+		item = folder_item_new(folder, MAILDIR_INBOX, MAILDIR_INBOX);
+		folder_item_append(rootitem, item);
+	}
+	if (!folder->inbox) {
+		item->stype = F_INBOX;
+		folder->inbox = item;
+	}
+
+	rootpath = maildir_get_root_path(folder);
+	if ((dp = g_dir_open(rootpath, 0, &error)) == NULL) {
+		g_warning("failed to open directory '%s': %s (%d)",
+			  rootpath, error->message, error->code);
+		g_error_free(error);
+		g_free(rootpath);
+		return -1;
+	}
+
+	while ((d = g_dir_read_name(dp)) != NULL) {
+		gchar *entry;
+
+		if (d[0] != '.' || d[1] == '\0' || d[1] == '.')
+			continue;
+		entry = g_strconcat(rootpath, G_DIR_SEPARATOR_S, d, NULL);
+		if (maildir_is_maildir(entry))
+			names = g_slist_prepend(names, g_strdup(d + 1));
+		g_free(entry);
+	}
+	g_dir_close(dp);
+	g_free(rootpath);
+
+	/* Parents sort before their children */
+	names = g_slist_sort(names, (GCompareFunc)strcmp);
+
+	for (cur = names; cur != NULL; cur = cur->next) {
+		gchar *utf8name, **parts, *path = NULL, *tmp;
+		FolderItem *parent = rootitem;
+		gint i;
+
+		utf8name = g_filename_to_utf8(cur->data, -1, NULL, NULL, NULL);
+		if (utf8name == NULL)
+			utf8name = g_strdup(cur->data);
+		parts = g_strsplit(utf8name, ".", -1);
+
+		for (i = 0; parts[i] != NULL; i++) {
+			if (*parts[i] == '\0')
+				break;
+			tmp = path ? g_strconcat(path, G_DIR_SEPARATOR_S,
+						 parts[i], NULL)
+				   : g_strdup(parts[i]);
+			g_free(path);
+			path = tmp;
+
+			item = maildir_find_child(parent, path);
+			if (item == NULL) {
+				debug_print("new maildir '%s' found.\n", path);
+				item = folder_item_new(folder, parts[i], path);
+				folder_item_append(parent, item);
+				/* Maildir++ allows ".a.b" without ".a" */
+				if (parts[i + 1] != NULL) {
+					gchar *fspath = folder_item_get_path(item);
+					maildir_make_maildir(fspath);
+					g_free(fspath);
+				}
+			}
+			if (parent == rootitem)
+				maildir_set_special(folder, item);
+			parent = item;
+		}
+
+		g_free(path);
+		g_strfreev(parts);
+		g_free(utf8name);
+	}
+	slist_free_strings_full(names);
+
+	return 0;
+}
+
+static FolderItem *maildir_create_folder(Folder *folder, FolderItem *parent,
+					 const gchar *name)
+{
+	FolderItem *new_item;
+	gchar *path, *fspath, *dotted;
+	gchar *rootpath;
+
+	cm_return_val_if_fail(folder != NULL, NULL);
+	cm_return_val_if_fail(parent != NULL, NULL);
+	cm_return_val_if_fail(name != NULL, NULL);
+
+	/* '.' is the hierarchy separator on disk */
+	if (strchr(name, '.') != NULL || strchr(name, G_DIR_SEPARATOR) != NULL) {
+		g_warning("maildir folder names can't contain '.' or '%c'",
+			  G_DIR_SEPARATOR);
+		return NULL;
+	}
+
+	/* Sub-folders of INBOX live next to it, as with any Maildir++ MUA */
+	if (parent->path == NULL || !strcmp(parent->path, MAILDIR_INBOX)) {
+		parent = FOLDER_ITEM(folder->node->data);
+		path = g_strdup(name);
+	} else
+		path = g_strconcat(parent->path, G_DIR_SEPARATOR_S, name, NULL);
+
+	dotted = g_strdup(path);
+	subst_char(dotted, G_DIR_SEPARATOR, '.');
+	fspath = g_filename_from_utf8(dotted, -1, NULL, NULL, NULL);
+	if (fspath == NULL)
+		fspath = g_strdup(dotted);
+	g_free(dotted);
+
+	rootpath = maildir_get_root_path(folder);
+	dotted = g_strconcat(rootpath, G_DIR_SEPARATOR_S, ".", fspath, NULL);
+	g_free(rootpath);
+	g_free(fspath);
+
+	if (maildir_make_maildir(dotted) < 0) {
+		g_free(dotted);
+		g_free(path);
+		return NULL;
+	}
+	g_free(dotted);
+
+	new_item = folder_item_new(folder, name, path);
+	folder_item_append(parent, new_item);
+	g_free(path);
+
+	return new_item;
+}
+
+static gboolean maildir_collect_items_func(GNode *node, gpointer data)
+{
+	GSList **items = (GSList **)data;
+
+	*items = g_slist_prepend(*items, node->data);
+	return FALSE;
+}
+
+static gint maildir_rename_folder(Folder *folder, FolderItem *item,
+				  const gchar *name)
+{
+	GSList *items = NULL, *cur;
+	gchar *newpath, *dirname;
+	gsize oldlen;
+	gint ret = 0;
+
+	cm_return_val_if_fail(folder != NULL, -1);
+	cm_return_val_if_fail(item != NULL, -1);
+	cm_return_val_if_fail(item->path != NULL, -1);
+	cm_return_val_if_fail(name != NULL, -1);
+
+	if (!strcmp(item->path, MAILDIR_INBOX))
+		return -1;
+	if (strchr(name, '.') != NULL || strchr(name, G_DIR_SEPARATOR) != NULL) {
+		g_warning("maildir folder names can't contain '.' or '%c'",
+			  G_DIR_SEPARATOR);
+		return -1;
+	}
+
+	if (strchr(item->path, G_DIR_SEPARATOR) != NULL) {
+		dirname = g_path_get_dirname(item->path);
+		newpath = g_strconcat(dirname, G_DIR_SEPARATOR_S, name, NULL);
+		g_free(dirname);
+	} else
+		newpath = g_strdup(name);
+
+	/* Children are siblings on disk, so each one is renamed by itself */
+	oldlen = strlen(item->path);
+	g_node_traverse(item->node, G_PRE_ORDER, G_TRAVERSE_ALL, -1,
+			maildir_collect_items_func, &items);
+	items = g_slist_reverse(items);
+
+	for (cur = items; cur != NULL; cur = cur->next) {
+		FolderItem *child = FOLDER_ITEM(cur->data);
+		gchar *oldfs, *newfs, *childpath;
+
+		childpath = g_strconcat(newpath, child->path + oldlen, NULL);
+		oldfs = folder_item_get_path(child);
+		g_free(child->path);
+		child->path = childpath;
+		newfs = folder_item_get_path(child);
+
+		if (g_rename(oldfs, newfs) < 0) {
+			FILE_OP_ERROR(oldfs, "rename");
+			ret = -1;
+		}
+		g_free(oldfs);
+		g_free(newfs);
+	}
+	g_slist_free(items);
+	g_free(newpath);
+
+	g_free(item->name);
+	item->name = g_strdup(name);
+
+	return ret;
+}
+
+static gint maildir_remove_folder(Folder *folder, FolderItem *item)
+{
+	GSList *items = NULL, *cur;
+	gint ret = 0;
+
+	cm_return_val_if_fail(folder != NULL, -1);
+	cm_return_val_if_fail(item != NULL, -1);
+	cm_return_val_if_fail(item->path != NULL, -1);
+
+	if (!strcmp(item->path, MAILDIR_INBOX))
+		return -1;
+
+	g_node_traverse(item->node, G_PRE_ORDER, G_TRAVERSE_ALL, -1,
+			maildir_collect_items_func, &items);
+
+	for (cur = items; cur != NULL; cur = cur->next) {
+		gchar *path = folder_item_get_path(FOLDER_ITEM(cur->data));
+
+		if (remove_dir_recursive(path) < 0) {
+			g_warning("can't remove directory '%s'", path);
+			ret = -1;
+		}
+		g_free(path);
+	}
+	g_slist_free(items);
+
+	if (ret == 0)
+		folder_item_remove(item);
+	return ret;
+}
+
+/*
+ * FolderItem functions
+ */
+
+static time_t maildir_get_mtime(FolderItem *item)
+{
+	const gchar *subdirs[] = { "new", "cur" };
+	time_t mtime = -1;
+	GStatBuf s;
+	gchar *path, *dir;
+	gint i;
+
+	path = folder_item_get_path(item);
+	cm_return_val_if_fail(path != NULL, -1);
+
+	for (i = 0; i < G_N_ELEMENTS(subdirs); i++) {
+		dir = g_strconcat(path, G_DIR_SEPARATOR_S, subdirs[i], NULL);
+		if (g_stat(dir, &s) < 0)
+			FILE_OP_ERROR(dir, "stat");
+		else if (s.st_mtime > mtime)
+			mtime = s.st_mtime;
+		g_free(dir);
+	}
+	g_free(path);
+
+	return mtime;
+}
+
+static gboolean maildir_scan_required(Folder *folder, FolderItem *item)
+{
+	time_t mtime = maildir_get_mtime(item);
+
+	if (mtime < 0)
+		return FALSE;
+
+	return (mtime > item->mtime) && (mtime - 3600 != item->mtime);
+}
+
+static void maildir_set_mtime(Folder *folder, FolderItem *item)
+{
+	time_t mtime = maildir_get_mtime(item);
+
+	if (mtime >= 0)
+		item->mtime = mtime;
+}
+
+static gint maildir_get_num_list(Folder *folder, FolderItem *item,
+				 GSList **list, gboolean *old_uids_valid)
+{
+	MaildirFolderItem *mitem = MAILDIR_FOLDER_ITEM(item);
+	GHashTableIter iter;
+	gpointer key;
+	gint nummsgs = 0;
+
+	cm_return_val_if_fail(item != NULL, -1);
+
+	debug_print("maildir_get_num_list(): Scanning %s ...\n",
+		    item->path ? item->path : "(null)");
+
+	if (mitem->map.uid_by_uniq == NULL)
+		*old_uids_valid = maildir_item_read_map(item);
+	else
+		*old_uids_valid = TRUE;
+	maildir_item_rescan(item);
+
+	g_hash_table_iter_init(&iter, mitem->map.file_by_uid);
+	while (g_hash_table_iter_next(&iter, &key, NULL)) {
+		*list = g_slist_prepend(*list, key);
+		nummsgs++;
+	}
+
+	maildir_set_mtime(folder, item);
+	return nummsgs;
+}
+
+/*
+ * Message functions
+ */
+
+static gchar *maildir_fetch_msg(Folder *folder, FolderItem *item, gint num)
+{
+	const gchar *relfile;
+	gchar *path, *file;
+
+	cm_return_val_if_fail(item != NULL, NULL);
+	cm_return_val_if_fail(num > 0, NULL);
+
+	path = folder_item_get_path(item);
+	cm_return_val_if_fail(path != NULL, NULL);
+
+	relfile = maildir_item_lookup(item, num);
+	file = relfile ? g_strconcat(path, G_DIR_SEPARATOR_S, relfile, NULL)
+		       : NULL;
+
+	/* Another MUA may have renamed it since we last looked */
+	if (file == NULL || !is_file_exist(file)) {
+		g_free(file);
+		file = NULL;
+		maildir_item_rescan(item);
+		relfile = maildir_item_lookup(item, num);
+		if (relfile != NULL)
+			file = g_strconcat(path, G_DIR_SEPARATOR_S, relfile, NULL);
+	}
+	g_free(path);
+
+	return file;
+}
+
+static MsgInfo *maildir_get_msginfo(Folder *folder, FolderItem *item, gint num)
+{
+	MsgInfo *msginfo;
+	MsgFlags flags;
+	gchar *file;
+
+	cm_return_val_if_fail(item != NULL, NULL);
+	if (num <= 0)
+		return NULL;
+
+	file = maildir_fetch_msg(folder, item, num);
+	if (!file)
+		return NULL;
+
+	flags.perm_flags = maildir_flags_from_file(maildir_item_lookup(item, num));
+	flags.tmp_flags = 0;
+	if (folder_has_parent_of_type(item, F_QUEUE)) {
+		MSG_SET_TMP_FLAGS(flags, MSG_QUEUED);
+	} else if (folder_has_parent_of_type(item, F_DRAFT)) {
+		MSG_SET_TMP_FLAGS(flags, MSG_DRAFT);
+	}
+
+	msginfo = procheader_parse_file(file, flags, FALSE, FALSE);
+	if (msginfo) {
+		msginfo->msgnum = num;
+		msginfo->folder = item;
+	}
+	g_free(file);
+
+	return msginfo;
+}
+
+static gboolean maildir_is_msg_changed(Folder *folder, FolderItem *item,
+				       MsgInfo *msginfo)
+{
+	GStatBuf s;
+	gchar *file;
+	gint r;
+
+	file = maildir_fetch_msg(folder, item, msginfo->msgnum);
+	if (file == NULL)
+		return TRUE;
+
+	/* Renames only change flags, which get_flags takes care of */
+	r = g_stat(file, &s);
+	g_free(file);
+	if (r < 0 ||
+	    msginfo->size != s.st_size || (
+		(msginfo->mtime - s.st_mtime != 0) &&
+		(msginfo->mtime - s.st_mtime != 3600) &&
+		(msginfo->mtime - s.st_mtime != -3600))) {
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* Puts srcfile into dest and returns its new number. */
+static gint maildir_deliver(FolderItem *dest, const gchar *srcfile,
+			    MsgPermFlags flags, gboolean move,
+			    gboolean *moved)
+{
+	FolderItemPrefs *prefs = dest->prefs;
+	gchar *path, *uniq, *relfile;
+	guint mode = 0;
+	gint uid = -1;
+
+	if (moved)
+		*moved = FALSE;
+
+	path = folder_item_get_path(dest);
+	cm_return_val_if_fail(path != NULL, -1);
+
+	maildir_item_prepare(dest);
+
+	if (prefs && prefs->enable_folder_chmod)
+		mode = prefs->folder_chmod;
+
+	if (maildir_deliver_file(path, srcfile, flags, move, mode, moved,
+				 &uniq, &relfile) == 0) {
+		uid = maildir_uid_map_register(&MAILDIR_FOLDER_ITEM(dest)->map,
+					       path, uniq, relfile);
+		g_free(relfile);
+		g_free(uniq);
+	}
+
+	g_free(path);
+	return uid;
+}
+
+static gint maildir_add_msg(Folder *folder, FolderItem *dest,
+			    const gchar *file, MsgFlags *flags)
+{
+	GSList file_list;
+	MsgFileInfo fileinfo;
+
+	cm_return_val_if_fail(file != NULL, -1);
+
+	fileinfo.msginfo = NULL;
+	fileinfo.file = (gchar *)file;
+	fileinfo.flags = flags;
+	file_list.data = &fileinfo;
+	file_list.next = NULL;
+
+	return maildir_add_msgs(folder, dest, &file_list, NULL);
+}
+
+static gint maildir_add_msgs(Folder *folder, FolderItem *dest,
+			     GSList *file_list, GHashTable *relation)
+{
+	gboolean need_scan;
+	time_t last_mtime;
+	GSList *cur;
+	gint uid = -1;
+
+	cm_return_val_if_fail(dest != NULL, -1);
+	cm_return_val_if_fail(file_list != NULL, -1);
+
+	need_scan = maildir_scan_required(folder, dest);
+	last_mtime = dest->mtime;
+
+	for (cur = file_list; cur != NULL; cur = cur->next) {
+		MsgFileInfo *fileinfo = (MsgFileInfo *)cur->data;
+		MsgPermFlags flags = MSG_NEW | MSG_UNREAD;
+
+		if (fileinfo->flags)
+			flags = fileinfo->flags->perm_flags;
+
+		uid = maildir_deliver(dest, fileinfo->file, flags, FALSE, NULL);
+		if (uid < 0)
+			return -1;
+
+		if (relation != NULL)
+			g_hash_table_insert(relation, fileinfo,
+					    GINT_TO_POINTER(uid));
+	}
+
+	if (dest->mtime == last_mtime && !need_scan)
+		maildir_set_mtime(folder, dest);
+
+	return uid;
+}
+
+static gint maildir_copy_msg(Folder *folder, FolderItem *dest, MsgInfo *msginfo)
+{
+	GSList msglist;
+
+	cm_return_val_if_fail(msginfo != NULL, -1);
+
+	msglist.data = msginfo;
+	msglist.next = NULL;
+
+	return maildir_copy_msgs(folder, dest, &msglist, NULL);
+}
+
+static gint maildir_copy_msgs(Folder *folder, FolderItem *dest,
+			      MsgInfoList *msglist, GHashTable *relation)
+{
+	FolderItem *src;
+	MsgInfo *msginfo;
+	MsgInfoList *cur;
+	gboolean dest_need_scan, src_need_scan = FALSE;
+	gboolean can_move = FALSE;
+	time_t last_dest_mtime, last_src_mtime = 0;
+	gint uid = -1, curnum = 0, total;
+
+	cm_return_val_if_fail(dest != NULL, -1);
+	cm_return_val_if_fail(msglist != NULL, -1);
+
+	msginfo = (MsgInfo *)msglist->data;
+	cm_return_val_if_fail(msginfo != NULL, -1);
+
+	src = msginfo->folder;
+	if (src == dest) {
+		g_warning("the src folder is identical to the dest.");
+		return -1;
+	}
+
+	/* Local files can be renamed into place; anything else is a
+	 * cache file that has to stay where it is. */
+	if (FOLDER_TYPE(src->folder) == F_MAILDIR ||
+	    FOLDER_TYPE(src->folder) == F_MH) {
+		can_move = TRUE;
+		src_need_scan = src->folder->klass->scan_required(src->folder, src);
+		last_src_mtime = src->mtime;
+	}
+
+	dest_need_scan = maildir_scan_required(folder, dest);
+	last_dest_mtime = dest->mtime;
+
+	total = g_slist_length(msglist);
+	if (total > 100) {
+		if (MSG_IS_MOVE(msginfo->flags))
+			statusbar_print_all(_("Moving messages..."));
+		else
+			statusbar_print_all(_("Copying messages..."));
+	}
+
+	for (cur = msglist; cur != NULL; cur = cur->next) {
+		gboolean moved = FALSE;
+		gchar *srcfile;
+
+		msginfo = (MsgInfo *)cur->data;
+		if (msginfo == NULL)
+			continue;
+
+		if (total > 100) {
+			statusbar_progress_all(curnum, total, 100);
+			if (curnum % 100 == 0)
+				GTK_EVENTS_FLUSH();
+			curnum++;
+		}
+
+		srcfile = procmsg_get_message_file(msginfo);
+		if (srcfile == NULL) {
+			uid = -1;
+			break;
+		}
+
+		msginfo->flags.tmp_flags &= ~MSG_MOVE_DONE;
+		uid = maildir_deliver(dest, srcfile, msginfo->flags.perm_flags,
+				      can_move && MSG_IS_MOVE(msginfo->flags),
+				      &moved);
+		g_free(srcfile);
+		if (uid < 0)
+			break;
+
+		/* tells remove_msgs the source file is already gone */
+		if (moved)
+			msginfo->flags.tmp_flags |= MSG_MOVE_DONE;
+
+		if (relation != NULL)
+			g_hash_table_insert(relation, msginfo,
+					    GINT_TO_POINTER(uid));
+	}
+
+	if (dest->mtime == last_dest_mtime && !dest_need_scan)
+		maildir_set_mtime(folder, dest);
+	if (can_move && src->mtime == last_src_mtime && !src_need_scan)
+		src->folder->klass->set_mtime(src->folder, src);
+
+	if (total > 100) {
+		statusbar_progress_all(0, 0, 0);
+		statusbar_pop_all();
+	}
+
+	return uid;
+}
+
+static gint maildir_remove_msg(Folder *folder, FolderItem *item, gint num)
+{
+	gboolean need_scan;
+	time_t last_mtime;
+	gchar *file;
+
+	cm_return_val_if_fail(item != NULL, -1);
+
+	file = maildir_fetch_msg(folder, item, num);
+	cm_return_val_if_fail(file != NULL, -1);
+
+	need_scan = maildir_scan_required(folder, item);
+	last_mtime = item->mtime;
+
+	if (claws_unlink(file) < 0) {
+		FILE_OP_ERROR(file, "unlink");
+		g_free(file);
+		return -1;
+	}
+	g_free(file);
+	maildir_item_forget(item, num);
+
+	if (item->mtime == last_mtime && !need_scan)
+		maildir_set_mtime(folder, item);
+
+	return 0;
+}
+
+static gint maildir_remove_msgs(Folder *folder, FolderItem *item,
+				MsgInfoList *msglist, GHashTable *relation)
+{
+	gboolean need_scan;
+	time_t last_mtime;
+	MsgInfoList *cur;
+	gint total, curnum = 0;
+
+	cm_return_val_if_fail(item != NULL, -1);
+
+	need_scan = maildir_scan_required(folder, item);
+	last_mtime = item->mtime;
+
+	total = g_slist_length(msglist);
+	if (total > 100)
+		statusbar_print_all(_("Deleting messages..."));
+
+	for (cur = msglist; cur != NULL; cur = cur->next) {
+		MsgInfo *msginfo = (MsgInfo *)cur->data;
+		gchar *file;
+
+		if (msginfo == NULL)
+			continue;
+		if (MSG_IS_MOVE(msginfo->flags) &&
+		    MSG_IS_MOVE_DONE(msginfo->flags)) {
+			msginfo->flags.tmp_flags &= ~MSG_MOVE_DONE;
+			maildir_item_forget(item, msginfo->msgnum);
+			continue;
+		}
+		if (total > 100) {
+			statusbar_progress_all(curnum, total, 100);
+			if (curnum % 100 == 0)
+				GTK_EVENTS_FLUSH();
+			curnum++;
+		}
+
+		file = maildir_fetch_msg(folder, item, msginfo->msgnum);
+		if (file == NULL)
+			continue;
+		if (claws_unlink(file) == 0)
+			maildir_item_forget(item, msginfo->msgnum);
+		g_free(file);
+	}
+
+	if (total > 100) {
+		statusbar_progress_all(0, 0, 0);
+		statusbar_pop_all();
+	}
+	if (item->mtime == last_mtime && !need_scan)
+		maildir_set_mtime(folder, item);
+
+	return 0;
+}
+
+static gint maildir_remove_all_msg(Folder *folder, FolderItem *item)
+{
+	MaildirFolderItem *mitem = MAILDIR_FOLDER_ITEM(item);
+	GHashTableIter iter;
+	gpointer value;
+	gchar *path, *file;
+	gint ret = 0;
+
+	cm_return_val_if_fail(item != NULL, -1);
+
+	path = folder_item_get_path(item);
+	cm_return_val_if_fail(path != NULL, -1);
+
+	maildir_item_prepare(item);
+	maildir_item_rescan(item);
+
+	g_hash_table_iter_init(&iter, mitem->map.file_by_uid);
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		file = g_strconcat(path, G_DIR_SEPARATOR_S,
+				   (gchar *)value, NULL);
+		if (claws_unlink(file) < 0) {
+			FILE_OP_ERROR(file, "unlink");
+			ret = -1;
+		}
+		g_free(file);
+	}
+	g_free(path);
+
+	/* keeps next_uid, numbers are never reused */
+	maildir_item_rescan(item);
+
+	return ret;
+}
+
+static void maildir_change_flags(Folder *folder, FolderItem *item,
+				 MsgInfo *msginfo, MsgPermFlags newflags)
+{
+	MaildirFolderItem *mitem = MAILDIR_FOLDER_ITEM(item);
+	const gchar *relfile;
+	gchar *path, *uniq, *newrel, *oldfile, *newfile;
+	gboolean need_scan;
+	time_t last_mtime;
+
+	relfile = maildir_item_lookup(item, msginfo->msgnum);
+	if (relfile == NULL) {
+		maildir_item_rescan(item);
+		relfile = maildir_item_lookup(item, msginfo->msgnum);
+	}
+	if (relfile == NULL ||
+	    (msginfo->flags.perm_flags & MAILDIR_FILE_FLAGS) ==
+	    (newflags & MAILDIR_FILE_FLAGS)) {
+		msginfo->flags.perm_flags = newflags;
+		return;
+	}
+
+	uniq = maildir_get_uniq(relfile + 4);
+	newrel = maildir_make_relfile(uniq, newflags, maildir_get_info(relfile),
+				      maildir_relfile_is_new(relfile));
+	g_free(uniq);
+
+	if (!strcmp(newrel, relfile)) {
+		g_free(newrel);
+		msginfo->flags.perm_flags = newflags;
+		return;
+	}
+
+	need_scan = maildir_scan_required(folder, item);
+	last_mtime = item->mtime;
+
+	path = folder_item_get_path(item);
+	oldfile = g_strconcat(path, G_DIR_SEPARATOR_S, relfile, NULL);
+	newfile = g_strconcat(path, G_DIR_SEPARATOR_S, newrel, NULL);
+	g_free(path);
+
+	if (g_rename(oldfile, newfile) < 0) {
+		FILE_OP_ERROR(oldfile, "rename");
+		g_free(newrel);
+	} else {
+		g_hash_table_insert(mitem->map.file_by_uid,
+				    GINT_TO_POINTER(msginfo->msgnum), newrel);
+		if (item->mtime == last_mtime && !need_scan)
+			maildir_set_mtime(folder, item);
+	}
+	g_free(oldfile);
+	g_free(newfile);
+
+	msginfo->flags.perm_flags = newflags;
+}
+
+static gint maildir_get_flags(Folder *folder, FolderItem *item,
+			      MsgInfoList *msglist, GHashTable *msgflags)
+{
+	MsgInfoList *cur;
+
+	cm_return_val_if_fail(item != NULL, -1);
+
+	maildir_item_prepare(item);
+
+	for (cur = msglist; cur != NULL; cur = cur->next) {
+		MsgInfo *msginfo = (MsgInfo *)cur->data;
+		const gchar *relfile;
+		MsgPermFlags flags;
+
+		relfile = g_hash_table_lookup(MAILDIR_FOLDER_ITEM(item)->map.file_by_uid,
+					      GINT_TO_POINTER(msginfo->msgnum));
+		if (relfile == NULL)
+			continue;
+
+		flags = msginfo->flags.perm_flags & ~MAILDIR_FILE_FLAGS;
+		flags |= maildir_flags_from_file(relfile);
+		g_hash_table_insert(msgflags, msginfo, GINT_TO_POINTER(flags));
+	}
+
+	return 0;
+}
@@ -0,0 +1,49 @@
+/*
+ * Claws Mail -- a GTK+ based, lightweight, and fast e-mail client
+ * Copyright (C) 2026 the Claws Mail team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __MAILDIR_H__
+#define __MAILDIR_H__
+
+#include <glib.h>
+
+#include "folder.h"
+#include "localfolder.h"
+#include "maildir_store.h"
+
+typedef struct _MaildirFolder	MaildirFolder;
+typedef struct _MaildirFolderItem	MaildirFolderItem;
+
+#define MAILDIR_FOLDER(obj)		((MaildirFolder *)obj)
+#define MAILDIR_FOLDER_ITEM(obj)	((MaildirFolderItem *)obj)
+
+struct _MaildirFolder
+{
+	LocalFolder lfolder;
+};
+
+struct _MaildirFolderItem
+{
+	FolderItem item;
+
+	MaildirUidMap map;
+};
+
+FolderClass *maildir_get_class	(void);
+
+#endif /* __MAILDIR_H__ */
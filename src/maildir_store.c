@@ -0,0 +1,490 @@
+/*
+ * Claws Mail -- a GTK+ based, lightweight, and fast e-mail client
+ * Copyright (C) 2026 the Claws Mail team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#include "claws-features.h"
+#endif
+
+#include "defs.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include "maildir_store.h"
+#include "utils.h"
+#include "file-utils.h"
+
+/*
+ * File name helpers
+ */
+
+gchar *maildir_get_uniq(const gchar *basename)
+{
+	const gchar *sep = strchr(basename, MAILDIR_INFO_SEP);
+
+	if (sep)
+		return g_strndup(basename, sep - basename);
+	return g_strdup(basename);
+}
+
+const gchar *maildir_get_info(const gchar *relfile)
+{
+	const gchar *sep = strrchr(relfile, MAILDIR_INFO_SEP);
+
+	if (sep && sep[1] == '2' && sep[2] == ',')
+		return sep + 3;
+	return NULL;
+}
+
+gboolean maildir_relfile_is_new(const gchar *relfile)
+{
+	return strncmp(relfile, "new", 3) == 0;
+}
+
+MsgPermFlags maildir_flags_from_file(const gchar *relfile)
+{
+	MsgPermFlags flags;
+	const gchar *info;
+
+	if (maildir_relfile_is_new(relfile))
+		return MSG_NEW | MSG_UNREAD;
+
+	flags = MSG_UNREAD;
+	for (info = maildir_get_info(relfile); info && *info; info++) {
+		switch (*info) {
+		case 'F': flags |= MSG_MARKED; break;
+		case 'P': flags |= MSG_FORWARDED; break;
+		case 'R': flags |= MSG_REPLIED; break;
+		case 'S': flags &= ~MSG_UNREAD; break;
+		case 'T': flags |= MSG_DELETED; break;
+		default: break;
+		}
+	}
+
+	return flags;
+}
+
+/* Builds the info part for flags, keeping the letters we don't manage
+ * (such as D or keyword letters set by other MUAs). The letters must
+ * be in ASCII order. */
+static gchar *maildir_build_info(MsgPermFlags flags, const gchar *old_info)
+{
+	gboolean letters[128];
+	GString *str;
+	gint c;
+
+	memset(letters, 0, sizeof(letters));
+	for (; old_info && *old_info; old_info++) {
+		if ((guchar)*old_info < 128)
+			letters[(guchar)*old_info] = TRUE;
+	}
+
+	letters['F'] = (flags & MSG_MARKED) != 0;
+	letters['P'] = (flags & MSG_FORWARDED) != 0;
+	letters['R'] = (flags & MSG_REPLIED) != 0;
+	letters['S'] = (flags & MSG_UNREAD) == 0;
+	letters['T'] = (flags & MSG_DELETED) != 0;
+
+	str = g_string_sized_new(8);
+	for (c = '!'; c < 127; c++) {
+		if (letters[c])
+			g_string_append_c(str, c);
+	}
+
+	return g_string_free(str, FALSE);
+}
+
+/* Messages only stay in new/ while they are new and carry no flags;
+ * once in cur/ they never go back. */
+gchar *maildir_make_relfile(const gchar *uniq, MsgPermFlags flags,
+			    const gchar *old_info, gboolean in_new)
+{
+	gchar *info, *relfile;
+
+	info = maildir_build_info(flags, old_info);
+	if (in_new && (flags & MSG_NEW) && *info == '\0')
+		relfile = g_strconcat("new", G_DIR_SEPARATOR_S, uniq, NULL);
+	else
+		relfile = g_strdup_printf("cur%c%s%c2,%s", G_DIR_SEPARATOR,
+					  uniq, MAILDIR_INFO_SEP, info);
+	g_free(info);
+
+	return relfile;
+}
+
+gchar *maildir_new_uniq(void)
+{
+	static gchar *host = NULL;
+	static guint counter = 0;
+	gint64 now;
+
+	if (host == NULL) {
+		const gchar *p;
+		GString *str = g_string_new(NULL);
+
+		/* '/' and ':' are not allowed in the host part */
+		for (p = g_get_host_name(); *p; p++) {
+			if (*p == '/')
+				g_string_append(str, "\\057");
+			else if (*p == ':')
+				g_string_append(str, "\\072");
+			else
+				g_string_append_c(str, *p);
+		}
+		host = g_string_free(str, FALSE);
+	}
+
+	now = g_get_real_time();
+	return g_strdup_printf("%"G_GINT64_FORMAT".M%dP%dQ%u.%s",
+			       now / G_USEC_PER_SEC,
+			       (gint)(now % G_USEC_PER_SEC),
+			       (gint)getpid(), ++counter, host);
+}
+
+gint maildir_make_maildir(const gchar *path)
+{
+	const gchar *subdirs[] = { "tmp", "new", "cur" };
+	gchar *dir;
+	gint i;
+
+	for (i = 0; i < G_N_ELEMENTS(subdirs); i++) {
+		dir = g_strconcat(path, G_DIR_SEPARATOR_S, subdirs[i], NULL);
+		if (!is_dir_exist(dir) && make_dir_hier(dir) < 0) {
+			g_free(dir);
+			return -1;
+		}
+		g_free(dir);
+	}
+
+	return 0;
+}
+
+gboolean maildir_is_maildir(const gchar *path)
+{
+	gchar *cur;
+	gboolean ret;
+
+	cur = g_strconcat(path, G_DIR_SEPARATOR_S, "cur", NULL);
+	ret = is_dir_exist(cur);
+	g_free(cur);
+
+	return ret;
+}
+
+/* Puts srcfile into the maildir at path, and returns the unique part and
+ * the relative name it got there. Copies are written to tmp/ first and
+ * renamed into place, so that readers never see a partial message. A
+ * non-zero mode is applied to copies. */
+gint maildir_deliver_file(const gchar *path, const gchar *srcfile,
+			  MsgPermFlags flags, gboolean move, guint mode,
+			  gboolean *moved, gchar **uniq, gchar **relfile)
+{
+	gchar *destfile, *tmpfile = NULL;
+	gint ret = -1;
+
+	if (moved)
+		*moved = FALSE;
+
+	*uniq = maildir_new_uniq();
+	*relfile = maildir_make_relfile(*uniq, flags, NULL, TRUE);
+	destfile = g_strconcat(path, G_DIR_SEPARATOR_S, *relfile, NULL);
+
+	if (move && g_rename(srcfile, destfile) == 0) {
+		if (moved)
+			*moved = TRUE;
+	} else {
+		tmpfile = g_strconcat(path, G_DIR_SEPARATOR_S, "tmp",
+				      G_DIR_SEPARATOR_S, *uniq, NULL);
+#ifdef G_OS_UNIX
+		if (link(srcfile, tmpfile) < 0) {
+#endif
+			if (copy_file(srcfile, tmpfile, FALSE) < 0) {
+				g_warning("can't copy message %s to %s",
+					  srcfile, tmpfile);
+				goto out;
+			}
+#ifdef G_OS_UNIX
+		}
+#endif
+		if (mode != 0) {
+			if (chmod(tmpfile, mode) < 0)
+				FILE_OP_ERROR(tmpfile, "chmod");
+		}
+		if (g_rename(tmpfile, destfile) < 0) {
+			FILE_OP_ERROR(tmpfile, "rename");
+			claws_unlink(tmpfile);
+			goto out;
+		}
+	}
+	ret = 0;
+
+out:
+	if (ret < 0) {
+		g_free(*uniq);
+		g_free(*relfile);
+		*uniq = NULL;
+		*relfile = NULL;
+	}
+	g_free(tmpfile);
+	g_free(destfile);
+	return ret;
+}
+
+/*
+ * uid map
+ */
+
+static gchar *maildir_uid_map_get_file(const gchar *path)
+{
+	return g_strconcat(path, G_DIR_SEPARATOR_S, MAILDIR_UIDMAP_FILE, NULL);
+}
+
+void maildir_uid_map_clear(MaildirUidMap *map)
+{
+	if (map->uid_by_uniq)
+		g_hash_table_destroy(map->uid_by_uniq);
+	if (map->file_by_uid)
+		g_hash_table_destroy(map->file_by_uid);
+	map->uid_by_uniq = NULL;
+	map->file_by_uid = NULL;
+}
+
+/* Returns FALSE if there was no map yet, i.e. the numbers in an existing
+ * cache can not be trusted. */
+gboolean maildir_uid_map_read(MaildirUidMap *map, const gchar *path)
+{
+	gchar buf[BUFFSIZE];
+	gchar *file, *end;
+	FILE *fp;
+	guint version = 0, next_uid = 1, uid;
+
+	maildir_uid_map_clear(map);
+	map->uid_by_uniq = g_hash_table_new_full(g_str_hash, g_str_equal,
+						 g_free, NULL);
+	map->file_by_uid = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+						 NULL, g_free);
+	map->next_uid = 1;
+
+	file = maildir_uid_map_get_file(path);
+	if ((fp = claws_fopen(file, "rb")) == NULL) {
+		if (ENOENT != errno)
+			FILE_OP_ERROR(file, "claws_fopen");
+		g_free(file);
+		return FALSE;
+	}
+
+	if (claws_fgets(buf, sizeof(buf), fp) == NULL ||
+	    sscanf(buf, "%u %u", &version, &next_uid) != 2 ||
+	    version != MAILDIR_UIDMAP_VERSION) {
+		g_warning("invalid maildir uid map '%s', rebuilding it", file);
+		claws_fclose(fp);
+		g_free(file);
+		return FALSE;
+	}
+	g_free(file);
+
+	while (claws_fgets(buf, sizeof(buf), fp) != NULL) {
+		strretchomp(buf);
+		uid = (guint)strtoul(buf, &end, 10);
+		if (uid == 0 || *end != ' ' || end[1] == '\0')
+			continue;
+		g_hash_table_insert(map->uid_by_uniq, g_strdup(end + 1),
+				    GUINT_TO_POINTER(uid));
+		next_uid = MAX(next_uid, uid + 1);
+	}
+	claws_fclose(fp);
+
+	map->next_uid = next_uid;
+	return TRUE;
+}
+
+gint maildir_uid_map_write(MaildirUidMap *map, const gchar *path)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+	gchar *file, *tmpfile;
+	FILE *fp;
+	gint ret = 0;
+
+	file = maildir_uid_map_get_file(path);
+	tmpfile = g_strconcat(file, ".tmp", NULL);
+
+	if ((fp = claws_fopen(tmpfile, "wb")) == NULL) {
+		FILE_OP_ERROR(tmpfile, "claws_fopen");
+		g_free(tmpfile);
+		g_free(file);
+		return -1;
+	}
+
+	if (fprintf(fp, "%d %u\n", MAILDIR_UIDMAP_VERSION, map->next_uid) < 0)
+		ret = -1;
+	g_hash_table_iter_init(&iter, map->uid_by_uniq);
+	while (ret == 0 && g_hash_table_iter_next(&iter, &key, &value)) {
+		if (fprintf(fp, "%u %s\n", GPOINTER_TO_UINT(value),
+			    (gchar *)key) < 0)
+			ret = -1;
+	}
+
+	if (claws_safe_fclose(fp) == EOF)
+		ret = -1;
+	if (ret == 0 && rename_force(tmpfile, file) < 0) {
+		FILE_OP_ERROR(file, "rename");
+		ret = -1;
+	}
+	if (ret < 0)
+		claws_unlink(tmpfile);
+
+	g_free(tmpfile);
+	g_free(file);
+	return ret;
+}
+
+static void maildir_uid_map_append(MaildirUidMap *map, const gchar *path,
+				   guint uid, const gchar *uniq)
+{
+	gchar *file;
+	FILE *fp;
+
+	file = maildir_uid_map_get_file(path);
+
+	if (!is_file_exist(file)) {
+		g_free(file);
+		maildir_uid_map_write(map, path);
+		return;
+	}
+
+	if ((fp = claws_fopen(file, "ab")) == NULL) {
+		FILE_OP_ERROR(file, "claws_fopen");
+		g_free(file);
+		return;
+	}
+	if (fprintf(fp, "%u %s\n", uid, uniq) < 0)
+		FILE_OP_ERROR(file, "fprintf");
+	claws_safe_fclose(fp);
+	g_free(file);
+}
+
+/* Lists new/ and cur/ and brings the uid map in sync with them. Returns
+ * whether it changed. */
+gboolean maildir_uid_map_rescan(MaildirUidMap *map, const gchar *path)
+{
+	const gchar *subdirs[] = { "new", "cur" };
+	GHashTable *uid_by_uniq, *file_by_uid;
+	gboolean changed = FALSE;
+	guint reused = 0;
+	gchar *dirpath;
+	const gchar *d;
+	GDir *dp;
+	gint i;
+
+	uid_by_uniq = g_hash_table_new_full(g_str_hash, g_str_equal,
+					    g_free, NULL);
+	file_by_uid = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+					    NULL, g_free);
+
+	for (i = 0; i < G_N_ELEMENTS(subdirs); i++) {
+		dirpath = g_strconcat(path, G_DIR_SEPARATOR_S, subdirs[i], NULL);
+		dp = g_dir_open(dirpath, 0, NULL);
+		g_free(dirpath);
+		if (dp == NULL)
+			continue;
+
+		while ((d = g_dir_read_name(dp)) != NULL) {
+			gchar *uniq;
+			guint uid;
+
+			if (d[0] == '.')
+				continue;
+
+			uniq = maildir_get_uniq(d);
+			/* Seen twice if another MUA moved it while we listed */
+			if (g_hash_table_lookup(uid_by_uniq, uniq) != NULL) {
+				g_free(uniq);
+				continue;
+			}
+
+			uid = map->uid_by_uniq ? GPOINTER_TO_UINT(
+				g_hash_table_lookup(map->uid_by_uniq, uniq)) : 0;
+			if (uid == 0) {
+				uid = map->next_uid++;
+				changed = TRUE;
+			} else
+				reused++;
+
+			g_hash_table_insert(uid_by_uniq, uniq,
+					    GUINT_TO_POINTER(uid));
+			g_hash_table_insert(file_by_uid, GUINT_TO_POINTER(uid),
+					    g_strconcat(subdirs[i],
+							G_DIR_SEPARATOR_S,
+							d, NULL));
+		}
+		g_dir_close(dp);
+	}
+
+	if (map->uid_by_uniq == NULL ||
+	    reused != g_hash_table_size(map->uid_by_uniq))
+		changed = TRUE;
+
+	maildir_uid_map_clear(map);
+	map->uid_by_uniq = uid_by_uniq;
+	map->file_by_uid = file_by_uid;
+
+	if (changed)
+		maildir_uid_map_write(map, path);
+
+	return changed;
+}
+
+/* Gives the next number to a message just put in the maildir */
+guint maildir_uid_map_register(MaildirUidMap *map, const gchar *path,
+			       const gchar *uniq, const gchar *relfile)
+{
+	guint uid;
+
+	uid = map->next_uid++;
+	g_hash_table_insert(map->uid_by_uniq, g_strdup(uniq),
+			    GUINT_TO_POINTER(uid));
+	g_hash_table_insert(map->file_by_uid, GUINT_TO_POINTER(uid),
+			    g_strdup(relfile));
+	maildir_uid_map_append(map, path, uid, uniq);
+
+	return uid;
+}
+
+void maildir_uid_map_forget(MaildirUidMap *map, guint uid)
+{
+	const gchar *relfile;
+	gchar *uniq;
+
+	relfile = g_hash_table_lookup(map->file_by_uid, GUINT_TO_POINTER(uid));
+	if (relfile == NULL)
+		return;
+
+	uniq = maildir_get_uniq(relfile + 4);
+	g_hash_table_remove(map->uid_by_uniq, uniq);
+	g_hash_table_remove(map->file_by_uid, GUINT_TO_POINTER(uid));
+	g_free(uniq);
+}
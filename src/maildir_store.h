@@ -0,0 +1,91 @@
+/*
+ * Claws Mail -- a GTK+ based, lightweight, and fast e-mail client
+ * Copyright (C) 2026 the Claws Mail team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __MAILDIR_STORE_H__
+#define __MAILDIR_STORE_H__
+
+#include <glib.h>
+
+#include "procmsg.h"
+
+/* The files of a maildir, without the folder tree: file names and the
+ * flags they carry, deliveries, and the map from the unique part of the
+ * file names to message numbers, kept in MAILDIR_UIDMAP_FILE. */
+
+#define MAILDIR_UIDMAP_FILE	".claws_uidmap"
+#define MAILDIR_UIDMAP_VERSION	1
+
+#ifdef G_OS_WIN32
+#define MAILDIR_INFO_SEP	'!'
+#else
+#define MAILDIR_INFO_SEP	':'
+#endif
+
+/* Flags that live in the file name (and its directory) */
+#define MAILDIR_FILE_FLAGS	(MSG_NEW | MSG_UNREAD | MSG_MARKED | \
+				 MSG_DELETED | MSG_REPLIED | MSG_FORWARDED)
+
+typedef struct _MaildirUidMap	MaildirUidMap;
+
+struct _MaildirUidMap
+{
+	/* uniq part of the file name -> uid */
+	GHashTable *uid_by_uniq;
+	/* uid -> "new/<uniq>" or "cur/<uniq>:2,<info>" */
+	GHashTable *file_by_uid;
+	guint next_uid;
+};
+
+gchar *maildir_get_uniq			(const gchar	*basename);
+const gchar *maildir_get_info		(const gchar	*relfile);
+gboolean maildir_relfile_is_new		(const gchar	*relfile);
+MsgPermFlags maildir_flags_from_file	(const gchar	*relfile);
+gchar *maildir_make_relfile		(const gchar	*uniq,
+					 MsgPermFlags	 flags,
+					 const gchar	*old_info,
+					 gboolean	 in_new);
+gchar *maildir_new_uniq			(void);
+
+gint maildir_make_maildir		(const gchar	*path);
+gboolean maildir_is_maildir		(const gchar	*path);
+
+gint maildir_deliver_file		(const gchar	*path,
+					 const gchar	*srcfile,
+					 MsgPermFlags	 flags,
+					 gboolean	 move,
+					 guint		 mode,
+					 gboolean	*moved,
+					 gchar		**uniq,
+					 gchar		**relfile);
+
+void maildir_uid_map_clear		(MaildirUidMap	*map);
+gboolean maildir_uid_map_read		(MaildirUidMap	*map,
+					 const gchar	*path);
+gint maildir_uid_map_write		(MaildirUidMap	*map,
+					 const gchar	*path);
+gboolean maildir_uid_map_rescan		(MaildirUidMap	*map,
+					 const gchar	*path);
+guint maildir_uid_map_register		(MaildirUidMap	*map,
+					 const gchar	*path,
+					 const gchar	*uniq,
+					 const gchar	*relfile);
+void maildir_uid_map_forget		(MaildirUidMap	*map,
+					 guint		 uid);
+
+#endif /* __MAILDIR_STORE_H__ */
@@ -148,6 +148,7 @@
 #include "crash.h"
 
 #include "timing.h"
+#include "startup.h"
 
 #ifdef HAVE_NETWORKMANAGER_SUPPORT
 /* Went offline due to NetworkManager */
@@ -315,6 +316,43 @@ static void claws_gtk_idle(void)
 
 static gboolean sc_starting = FALSE;
 
+/* Startup tasks, see startup.h */
+static gpointer startup_prefetch_plugins(gpointer data)
+{
+	plugin_prefetch_all((const gchar *)data);
+	return NULL;
+}
+
+#ifdef USE_GNUTLS
+static gpointer startup_load_certificates(gpointer data)
+{
+	ssl_preload_credentials();
+	return NULL;
+}
+#endif
+
+typedef struct _StartupStores {
+#ifndef USE_ALT_ADDRBOOK
+	AddressIndex *addressbook;
+#endif
+	gint passwd_ret;
+	gint passwd_config_version;
+} StartupStores;
+
+/* Reading the address books can move LDAP passwords to the password
+ * store, so the password store is read after them, as it always was */
+static gpointer startup_read_stores(gpointer data)
+{
+	StartupStores *stores = (StartupStores *)data;
+
+#ifndef USE_ALT_ADDRBOOK
+	stores->addressbook = addressbook_read_index();
+#endif
+	stores->passwd_ret = passwd_store_read_file(&stores->passwd_config_version);
+
+	return NULL;
+}
+
 static gboolean defer_check_all(void *data)
 {
 	gboolean autochk = GPOINTER_TO_INT(data);
@@ -1009,6 +1047,12 @@ int main(int argc, char *argv[])
 	gboolean never_ran = FALSE;
 	gboolean mainwin_shown = FALSE;
 	gint ret;
+	StartupPhase *startup_phase, *phase;
+	StartupTask *plugins_task = NULL, *stores_task;
+#ifdef USE_GNUTLS
+	StartupTask *certificates_task;
+#endif
+	StartupStores stores;
 
 	START_TIMING("startup");
 
@@ -1023,6 +1067,7 @@ int main(int argc, char *argv[])
 #endif
 		return 0;
 	}
+	startup_phase = startup_phase_begin("startup");
 
 	prog_version = PROG_VERSION;
 #if (defined HAVE_LIBSM || defined CRASH_DIALOG)
@@ -1200,8 +1245,20 @@ int main(int argc, char *argv[])
 			  RC_DIR G_DIR_SEPARATOR_S COMMON_RC);
 	}
 
-	if (!cmd.exit)
+	if (!cmd.exit) {
+		phase = startup_phase_begin("Common plugins");
 		plugin_load_all("Common");
+		startup_phase_end(phase);
+	}
+
+	/* what doesn't depend on the rest goes on meanwhile */
+	if (!cmd.exit)
+		plugins_task = startup_task_run("GTK2 plugins",
+				startup_prefetch_plugins, "GTK2");
+#ifdef USE_GNUTLS
+	certificates_task = startup_task_run("certificates",
+			startup_load_certificates, NULL);
+#endif
 
 	userrc = g_strconcat(get_rc_dir(), G_DIR_SEPARATOR_S, "gtkrc-2.0", NULL);
 	gtk_rc_parse(userrc);
@@ -1251,6 +1308,7 @@ int main(int argc, char *argv[])
 #endif
 
 	folder_system_init();
+	phase = startup_phase_begin("preferences");
 	prefs_common_read_config();
 
 	if (prefs_update_config_version_common() < 0) {
@@ -1261,6 +1319,9 @@ int main(int argc, char *argv[])
 		exit(200);
 	}
 
+	stores_task = startup_task_run("address books and passwords",
+			startup_read_stores, &stores);
+
 	prefs_themes_init();
 	prefs_fonts_init();
 	prefs_ext_prog_init();
@@ -1300,9 +1361,8 @@ int main(int argc, char *argv[])
 	prefs_actions_read_config();
 	prefs_display_header_read_config();
 	/* prefs_filtering_read_config(); */
-#ifndef USE_ALT_ADDRBOOK
-	addressbook_read_file();
-#else
+	startup_phase_end(phase);
+#ifdef USE_ALT_ADDRBOOK
 	g_clear_error(&error);
 	if (! addressbook_start_service(&error)) {
 		g_warning("%s", error->message);
@@ -1322,7 +1382,9 @@ int main(int argc, char *argv[])
 	imap_gtk_init();
 	news_gtk_init();
 
+	phase = startup_phase_begin("main window");
 	mainwin = main_window_create();
+	startup_phase_end(phase);
 
 	if (!check_file_integrity())
 		exit(1);
@@ -1337,7 +1399,11 @@ int main(int argc, char *argv[])
 	folderview_freeze(mainwin->folderview);
 	folder_item_update_freeze();
 
-	if ((ret = passwd_store_read_config()) < 0) {
+	startup_task_wait(stores_task);
+	ret = stores.passwd_ret;
+	if (ret > 0)
+		ret = passwd_store_upgrade_config(stores.passwd_config_version);
+	if (ret < 0) {
 		debug_print("Password store configuration file version upgrade failed (%d), exiting\n", ret);
 #ifdef G_OS_WIN32
 		win32_close_log();
@@ -1345,8 +1411,10 @@ int main(int argc, char *argv[])
 		exit(202);
 	}
 
+	phase = startup_phase_begin("accounts");
 	prefs_account_init();
 	account_read_config_all();
+	startup_phase_end(phase);
 
 	if (prefs_update_config_version_accounts() < 0) {
 		debug_print("Accounts configuration file version upgrade failed, exiting\n");
@@ -1366,7 +1434,13 @@ int main(int argc, char *argv[])
 	 * a brand new install, a failed/refused migration,
 	 * or a failed config_version upgrade.
 	 */
-	if ((ret = folder_read_list()) < 0) {
+#ifndef USE_ALT_ADDRBOOK
+	addressbook_read_file_done(stores.addressbook);
+#endif
+	phase = startup_phase_begin("folder list");
+	ret = folder_read_list();
+	startup_phase_end(phase);
+	if (ret < 0) {
 		debug_print("Folderlist read failed (%d)\n", ret);
 		prefs_destroy_cache();
 		
@@ -1438,7 +1512,9 @@ int main(int argc, char *argv[])
 
 	/* make one all-folder processing before using claws */
 	main_window_cursor_wait(mainwin);
+	phase = startup_phase_begin("initial processing");
 	folder_func_to_all_folders(initial_processing, (gpointer *)mainwin);
+	startup_phase_end(phase);
 
 	/* if claws crashed, rebuild caches */
 	if (claws_crashed()) {
@@ -1483,7 +1559,11 @@ int main(int argc, char *argv[])
 
 	num_folder_class = g_list_length(folder_get_list());
 
+	if (plugins_task != NULL)
+		startup_task_wait(plugins_task);
+	phase = startup_phase_begin("GTK2 plugins");
 	plugin_load_all("GTK2");
+	startup_phase_end(phase);
 
 	if (g_list_length(folder_get_list()) != num_folder_class) {
 		debug_print("new folders loaded, reloading processing rules\n");
@@ -1622,6 +1702,7 @@ int main(int argc, char *argv[])
 	prefs_destroy_cache();
 	
 	compose_reopen_exit_drafts();
+	compose_reopen_journals();
 
 	if (start_done) {
 		sc_starting = FALSE;
@@ -1635,6 +1716,12 @@ int main(int argc, char *argv[])
 					lock_socket_input_cb,
 					mainwin, TRUE);
 
+#ifdef USE_GNUTLS
+	startup_task_wait(certificates_task);
+#endif
+	startup_phase_end(startup_phase);
+	startup_trace_dump();
+
 	END_TIMING();
 
 	gtk_main();
@@ -1742,6 +1829,8 @@ static void exit_claws(MainWindow *mainwin)
 	mainwin->smc_conn = NULL;
 #endif
 
+	hooks_print_stats();
+
 	main_window_destroy_all();
 	
 	plugin_unload_all("GTK2");
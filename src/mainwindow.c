@@ -68,6 +68,7 @@
 	#include "addressbook-dbus.h"
 #endif
 #include "logwindow.h"
+#include "metricswindow.h"
 #include "manage_window.h"
 #include "alertpanel.h"
 #include "statusbar.h"
@@ -190,6 +191,8 @@ static void addressbook_open_cb	(GtkAction	*action,
 				  gpointer	 data);
 static void log_window_show_cb	(GtkAction	*action,
 				  gpointer	 data);
+static void metrics_window_show_cb	(GtkAction	*action,
+				  gpointer	 data);
 static void filtering_debug_window_show_cb	(GtkAction	*action,
 				  gpointer	 data);
 #ifdef G_OS_WIN32
@@ -530,6 +533,7 @@ static GtkActionEntry mainwin_entries[] =
 /* File menu */
 	{"File/AddMailbox",             NULL, N_("_Add mailbox"), NULL, NULL, NULL },
 	{"File/AddMailbox/MH",          NULL, N_("MH..."), NULL, NULL, G_CALLBACK(add_mailbox_cb) },
+	{"File/AddMailbox/Maildir",     NULL, N_("Maildir++..."), NULL, NULL, G_CALLBACK(add_mailbox_cb) },
 	{"File/---",                    NULL, "---", NULL, NULL, NULL },
 
 	{"File/SortMailboxes",          NULL, N_("Change mailbox order..."), NULL, NULL, G_CALLBACK(foldersort_cb) },
@@ -787,6 +791,7 @@ static GtkActionEntry mainwin_entries[] =
 	/* {"Tools/---",                             NULL, "---", NULL, NULL, NULL }, */
 	{"Tools/FilteringLog",                       NULL, N_("Filtering Lo_g"), NULL, NULL, G_CALLBACK(filtering_debug_window_show_cb) }, 
 	{"Tools/NetworkLog",                         NULL, N_("Network _Log"), "<shift><control>L", NULL, G_CALLBACK(log_window_show_cb) }, 
+	{"Tools/Metrics",                            NULL, N_("Performance _Metrics"), NULL, NULL, G_CALLBACK(metrics_window_show_cb) }, 
 #ifdef G_OS_WIN32
 	{"Tools/DebugLog",                           NULL, N_("Debug _Log"), NULL, NULL, G_CALLBACK(debug_log_show_cb) },
 #endif
@@ -1521,6 +1526,7 @@ MainWindow *main_window_create()
 /* File menu */
 	MENUITEM_ADDUI_MANAGER(mainwin->ui_manager, "/Menu/File", "AddMailbox", "File/AddMailbox", GTK_UI_MANAGER_MENU)
 	MENUITEM_ADDUI_MANAGER(mainwin->ui_manager, "/Menu/File/AddMailbox", "MH", "File/AddMailbox/MH", GTK_UI_MANAGER_MENUITEM)
+	MENUITEM_ADDUI_MANAGER(mainwin->ui_manager, "/Menu/File/AddMailbox", "Maildir", "File/AddMailbox/Maildir", GTK_UI_MANAGER_MENUITEM)
 	MENUITEM_ADDUI_MANAGER(mainwin->ui_manager, "/Menu/File", "Separator1", "File/---", GTK_UI_MANAGER_SEPARATOR)
 	MENUITEM_ADDUI_MANAGER(mainwin->ui_manager, "/Menu/File", "SortMailboxes", "File/SortMailboxes", GTK_UI_MANAGER_MENUITEM)
 	MENUITEM_ADDUI_MANAGER(mainwin->ui_manager, "/Menu/File", "Separator2", "File/---", GTK_UI_MANAGER_SEPARATOR)
@@ -1850,6 +1856,7 @@ MainWindow *main_window_create()
 	MENUITEM_ADDUI_MANAGER(mainwin->ui_manager, "/Menu/Tools", "Separator7", "Tools/---", GTK_UI_MANAGER_SEPARATOR)
 	MENUITEM_ADDUI_MANAGER(mainwin->ui_manager, "/Menu/Tools", "FilteringLog", "Tools/FilteringLog", GTK_UI_MANAGER_MENUITEM)
 	MENUITEM_ADDUI_MANAGER(mainwin->ui_manager, "/Menu/Tools", "NetworkLog", "Tools/NetworkLog", GTK_UI_MANAGER_MENUITEM)
+	MENUITEM_ADDUI_MANAGER(mainwin->ui_manager, "/Menu/Tools", "Metrics", "Tools/Metrics", GTK_UI_MANAGER_MENUITEM)
 #ifdef G_OS_WIN32
 	MENUITEM_ADDUI_MANAGER(mainwin->ui_manager, "/Menu/Tools", "DebugLog", "Tools/DebugLog", GTK_UI_MANAGER_MENUITEM)
 #endif
@@ -2921,7 +2928,7 @@ gboolean main_window_empty_trash(MainWindow *mainwin, gboolean confirm, gboolean
 	return TRUE;
 }
 
-static void main_window_add_mailbox(MainWindow *mainwin)
+static void main_window_add_mailbox(MainWindow *mainwin, const gchar *klass)
 {
 	gchar *path;
 	Folder *folder;
@@ -2932,14 +2939,14 @@ static void main_window_add_mailbox(MainWindow *mainwin)
 			      "home directory.\n"
 			      "If the location of an existing mailbox is specified, it will be\n"
 			      "scanned automatically."),
-			    "Mail");
+			    !strcmp(klass, "maildir") ? "Maildir" : "Mail");
 	if (!path) return;
 	if (folder_find_from_path(path)) {
 		alertpanel_error(_("The mailbox '%s' already exists."), path);
 		g_free(path);
 		return;
 	}
-	folder = folder_new(folder_get_class_from_string("mh"), 
+	folder = folder_new(folder_get_class_from_string(klass), 
 			    !strcmp(path, "Mail") ? _("Mailbox") : 
 			    g_path_get_basename(path), path);
 	g_free(path);
@@ -3974,7 +3981,12 @@ static void message_window_size_allocate_cb(GtkWidget *widget,
 static void add_mailbox_cb(GtkAction *action, gpointer data)
 {
 	MainWindow *mainwin = (MainWindow *)data;
-	main_window_add_mailbox(mainwin);
+	const gchar *a_name = gtk_action_get_name(action);
+
+	if (!strcmp(a_name, "File/AddMailbox/Maildir"))
+		main_window_add_mailbox(mainwin, "maildir");
+	else
+		main_window_add_mailbox(mainwin, "mh");
 }
 
 static void update_folderview_cb(GtkAction *action, gpointer data)
@@ -4334,6 +4346,11 @@ static void log_window_show_cb(GtkAction *action, gpointer data)
 	log_window_show(mainwin->logwin);
 }
 
+static void metrics_window_show_cb(GtkAction *action, gpointer data)
+{
+	metrics_window_show();
+}
+
 static void filtering_debug_window_show_cb(GtkAction *action, gpointer data)
 {
 	MainWindow *mainwin = (MainWindow *)data;
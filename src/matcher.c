@@ -50,6 +50,7 @@
 #include "folder_item_prefs.h"
 #include "procmsg.h"
 #include "file-utils.h"
+#include "metrics.h"
 
 /*!
  *\brief	Keyword lookup element
@@ -1795,6 +1796,7 @@ static gboolean matcherlist_match_file(MatcherList *matchers, MsgInfo *info,
 	GSList *l;
 	FILE *fp;
 	gchar *file;
+	MetricsSpan span;
 
 	/* file need to be read ? */
 
@@ -1820,13 +1822,17 @@ static gboolean matcherlist_match_file(MatcherList *matchers, MsgInfo *info,
 	if (!read_headers && !read_body)
 		return result;
 
+	metrics_span_begin(&span, "matcher.match_file");
 	file = procmsg_get_message_file_full(info, read_headers, read_body);
-	if (file == NULL)
+	if (file == NULL) {
+		metrics_span_end(&span);
 		return FALSE;
+	}
 
 	if ((fp = claws_fopen(file, "rb")) == NULL) {
 		FILE_OP_ERROR(file, "claws_fopen");
 		g_free(file);
+		metrics_span_end(&span);
 		return result;
 	}
 
@@ -1868,6 +1874,7 @@ static gboolean matcherlist_match_file(MatcherList *matchers, MsgInfo *info,
 	g_free(file);
 
 	claws_fclose(fp);
+	metrics_span_end(&span);
 	
 	return result;
 }
@@ -1888,6 +1895,8 @@ gboolean matcherlist_match(MatcherList *matchers, MsgInfo *info)
 	if (!matchers)
 		return FALSE;
 
+	metrics_counter_add("matcher.lists_matched", 1);
+
 	if (matchers->bool_and)
 		result = TRUE;
 	else
@@ -187,6 +187,7 @@ static void about_cb			(GtkAction	*action,
 static void messageview_update		(MessageView	*msgview,
 					 MsgInfo	*old_msginfo);
 static gboolean messageview_update_msg	(gpointer source, gpointer data);
+static gboolean messageview_update_msglist	(gpointer source, gpointer data);
 
 static void save_part_as_cb(GtkAction *action, gpointer data);
 static void view_part_as_text_cb(GtkAction *action, gpointer data);
@@ -440,6 +441,8 @@ MessageView *messageview_create(MainWindow *mainwin)
 
 	messageview->msginfo_update_callback_id =
 		hooks_register_hook(MSGINFO_UPDATE_HOOKLIST, messageview_update_msg, (gpointer) messageview);
+	messageview->msginfo_list_update_callback_id =
+		hooks_register_hook(MSGINFO_LIST_UPDATE_HOOKLIST, messageview_update_msglist, (gpointer) messageview);
 
 	return messageview;
 }
@@ -1606,9 +1609,12 @@ void messageview_destroy(MessageView *messageview)
 		messageview->mainwin->summaryview->displayed = NULL;
 		messageview->mainwin->summaryview->ext_messageview = NULL;
 	}
-	if (!messageview->deferred_destroy)
+	if (!messageview->deferred_destroy) {
 		hooks_unregister_hook(MSGINFO_UPDATE_HOOKLIST,
 			      messageview->msginfo_update_callback_id);
+		hooks_unregister_hook(MSGINFO_LIST_UPDATE_HOOKLIST,
+			      messageview->msginfo_list_update_callback_id);
+	}
 
 	if (messageview->updating) {
 		debug_print("uh oh, better not touch that now (fetching)\n");
@@ -2963,6 +2969,22 @@ static gboolean messageview_update_msg(gpointer source, gpointer data)
 	return FALSE;
 }
 
+static gboolean messageview_update_msglist(gpointer source, gpointer data)
+{
+	MsgInfoListUpdate *list_update = (MsgInfoListUpdate *) source;
+	MessageView *messageview = (MessageView *)data;
+	MsgInfoUpdate msginfo_update;
+
+	if (!messageview->msginfo ||
+	    !g_slist_find(list_update->msglist, messageview->msginfo))
+		return FALSE;
+
+	msginfo_update.msginfo = messageview->msginfo;
+	msginfo_update.flags = list_update->flags;
+
+	return messageview_update_msg(&msginfo_update, messageview);
+}
+
 void messageview_set_menu_sensitive(MessageView *messageview)
 {
 	if (!messageview || !messageview->ui_manager)
@@ -69,6 +69,7 @@ struct _MessageView
 	gboolean all_headers;
 
 	gint msginfo_update_callback_id;
+	gint msginfo_list_update_callback_id;
 	gboolean updating;
 	gboolean deferred_destroy;
 	
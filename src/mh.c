@@ -45,6 +45,7 @@
 #include "timing.h"
 #include "msgcache.h"
 #include "file-utils.h"
+#include "prefs_common.h"
 
 /* Define possible missing constants for Windows. */
 #ifdef G_OS_WIN32
@@ -72,6 +73,9 @@ static gchar   *mh_fetch_msg		(Folder		*folder,
 static MsgInfo *mh_get_msginfo		(Folder		*folder,
 					 FolderItem	*item,
 					 gint		 num);
+static MsgInfoList *mh_get_msginfos	(Folder		*folder,
+					 FolderItem	*item,
+					 MsgNumberList	*numlist);
 static gint     mh_add_msg		(Folder		*folder,
 					 FolderItem	*dest,
 					 const gchar	*file,
@@ -120,6 +124,7 @@ static gchar   *mh_get_new_msg_filename		(FolderItem	*dest);
 
 static MsgInfo *mh_parse_msg			(const gchar	*file,
 						 FolderItem	*item);
+static MsgFlags mh_get_default_flags		(FolderItem	*item);
 static void	mh_remove_missing_folder_items	(Folder		*folder);
 static gchar	*mh_filename_from_utf8		(const gchar	*path);
 static gchar	*mh_filename_to_utf8		(const gchar	*path);
@@ -173,6 +178,7 @@ FolderClass *mh_get_class(void)
 
 		/* Message functions */
 		mh_class.get_msginfo = mh_get_msginfo;
+		mh_class.get_msginfos = mh_get_msginfos;
 		mh_class.fetch_msg = mh_fetch_msg;
 		mh_class.add_msg = mh_add_msg;
 		mh_class.add_msgs = mh_add_msgs;
@@ -365,6 +371,128 @@ static MsgInfo *mh_get_msginfo(Folder *folder, FolderItem *item, gint num)
 	return msginfo;
 }
 
+/* Below this many messages, the thread setup costs more than it saves */
+#define MH_PARALLEL_SCAN_MIN	64
+
+typedef struct _MHParseTask MHParseTask;
+
+struct _MHParseTask {
+	gchar *file;
+	gint num;
+	MsgFlags flags;
+	FolderItem *item;
+	MsgInfo *msginfo;
+	/* for the avatar hooks, which run in the main thread */
+	GSList *avatar_headers;
+};
+
+static gint mh_get_scan_threads(void)
+{
+	gint threads = prefs_common.mh_scan_threads;
+
+	if (threads <= 0)
+		threads = cm_get_num_processors();
+
+	return MAX(threads, 1);
+}
+
+static void mh_parse_task_func(gpointer data, gpointer user_data)
+{
+	MHParseTask *task = (MHParseTask *)data;
+
+	/* Only touches the task itself: the MsgInfo is not shared with
+	 * anybody until the pool has been drained. The avatar hooks call
+	 * plugins, they are left for the merge. */
+	task->msginfo = procheader_parse_file_full(task->file, task->flags,
+						   FALSE, FALSE,
+						   &task->avatar_headers);
+	if (task->msginfo) {
+		task->msginfo->msgnum = task->num;
+		task->msginfo->folder = task->item;
+	}
+}
+
+static MsgInfoList *mh_get_msginfos(Folder *folder, FolderItem *item,
+				    MsgNumberList *numlist)
+{
+	MsgInfoList *msglist = NULL;
+	MsgNumberList *cur;
+	MHParseTask *tasks;
+	GThreadPool *pool;
+	GError *error = NULL;
+	gchar *path;
+	gint threads, count, i;
+	MsgFlags flags;
+
+	cm_return_val_if_fail(item != NULL, NULL);
+
+	count = g_slist_length(numlist);
+	threads = mh_get_scan_threads();
+
+	if (threads < 2 || count < MH_PARALLEL_SCAN_MIN) {
+		for (cur = numlist; cur != NULL; cur = cur->next) {
+			MsgInfo *msginfo = mh_get_msginfo(folder, item,
+					GPOINTER_TO_INT(cur->data));
+			if (msginfo != NULL)
+				msglist = g_slist_prepend(msglist, msginfo);
+		}
+		return g_slist_reverse(msglist);
+	}
+
+	START_TIMING("");
+	debug_print("mh_get_msginfos(): parsing %d messages in %s with %d threads\n",
+		    count, item->path ? item->path : "(null)", threads);
+
+	path = folder_item_get_path(item);
+	cm_return_val_if_fail(path != NULL, NULL);
+
+	flags = mh_get_default_flags(item);
+	tasks = g_new0(MHParseTask, count);
+	for (cur = numlist, i = 0; cur != NULL; cur = cur->next, i++) {
+		tasks[i].num = GPOINTER_TO_INT(cur->data);
+		tasks[i].file = g_strdup_printf("%s%c%d", path,
+						G_DIR_SEPARATOR, tasks[i].num);
+		tasks[i].flags = flags;
+		tasks[i].item = item;
+	}
+	g_free(path);
+
+	/* The first message is parsed here, so that the lazily built
+	 * codeconv tables exist before any worker needs them. */
+	if (tasks[0].num > 0)
+		mh_parse_task_func(&tasks[0], NULL);
+
+	pool = g_thread_pool_new(mh_parse_task_func, NULL, threads, TRUE, &error);
+	if (pool == NULL) {
+		g_warning("couldn't create MH scan threads: %s",
+			  error ? error->message : "unknown error");
+		if (error)
+			g_error_free(error);
+		for (i = 1; i < count; i++)
+			if (tasks[i].num > 0)
+				mh_parse_task_func(&tasks[i], NULL);
+	} else {
+		for (i = 1; i < count; i++)
+			if (tasks[i].num > 0)
+				g_thread_pool_push(pool, &tasks[i], NULL);
+		/* Waits for all queued tasks to finish */
+		g_thread_pool_free(pool, FALSE, TRUE);
+	}
+
+	/* Merge back in the order the numbers were asked for */
+	for (i = count - 1; i >= 0; i--) {
+		procheader_run_avatar_hooks(tasks[i].msginfo,
+					    tasks[i].avatar_headers);
+		if (tasks[i].msginfo != NULL)
+			msglist = g_slist_prepend(msglist, tasks[i].msginfo);
+		g_free(tasks[i].file);
+	}
+	g_free(tasks);
+
+	END_TIMING();
+	return msglist;
+}
+
 static gchar *mh_get_new_msg_filename(FolderItem *dest)
 {
 	gchar *destfile;
@@ -1095,14 +1223,10 @@ static gint mh_remove_folder(Folder *folder, FolderItem *item)
 	return 0;
 }
 
-static MsgInfo *mh_parse_msg(const gchar *file, FolderItem *item)
+static MsgFlags mh_get_default_flags(FolderItem *item)
 {
-	MsgInfo *msginfo;
 	MsgFlags flags;
 
-	cm_return_val_if_fail(item != NULL, NULL);
-	cm_return_val_if_fail(file != NULL, NULL);
-
 	flags.perm_flags = MSG_NEW|MSG_UNREAD;
 	flags.tmp_flags = 0;
 
@@ -1112,6 +1236,19 @@ static MsgInfo *mh_parse_msg(const gchar *file, FolderItem *item)
 		MSG_SET_TMP_FLAGS(flags, MSG_DRAFT);
 	}
 
+	return flags;
+}
+
+static MsgInfo *mh_parse_msg(const gchar *file, FolderItem *item)
+{
+	MsgInfo *msginfo;
+	MsgFlags flags;
+
+	cm_return_val_if_fail(item != NULL, NULL);
+	cm_return_val_if_fail(file != NULL, NULL);
+
+	flags = mh_get_default_flags(item);
+
 	msginfo = procheader_parse_file(file, flags, FALSE, FALSE);
 	if (!msginfo) return NULL;
 
@@ -38,6 +38,7 @@
 #include "alertpanel.h"
 #include "inputdialog.h"
 #include "mh.h"
+#include "maildir.h"
 #include "foldersel.h"
 #include "prefs_common.h"
 #include "prefs_actions.h"
@@ -77,9 +78,23 @@ static FolderViewPopup mh_popup =
 	set_sensitivity
 };
 
+/* Maildir++ folders are handled by the same callbacks */
+static FolderViewPopup maildir_popup =
+{
+	"maildir",
+	"<MaildirFolder>",
+	mh_popup_entries,
+	G_N_ELEMENTS(mh_popup_entries),
+	NULL, 0,
+	NULL, 0, 0, NULL,
+	add_menuitems,
+	set_sensitivity
+};
+
 void mh_gtk_init(void)
 {
 	folderview_register_popup(&mh_popup);
+	folderview_register_popup(&maildir_popup);
 }
 
 static void add_menuitems(GtkUIManager *ui_manager, FolderItem *item)
@@ -301,7 +316,8 @@ static void move_folder_cb(GtkAction *action, gpointer data)
 	gchar *msg;
 
 	from_folder = folderview_get_selected_item(folderview);
-	if (!from_folder || from_folder->folder->klass != mh_get_class())
+	if (!from_folder || (from_folder->folder->klass != mh_get_class() &&
+			     from_folder->folder->klass != maildir_get_class()))
 		return;
 
 	msg = g_strdup_printf(_("Select folder to move folder '%s' to"),
@@ -321,7 +337,8 @@ static void copy_folder_cb(GtkAction *action, gpointer data)
 	gchar *msg;
 
 	from_folder = folderview_get_selected_item(folderview);
-	if (!from_folder || from_folder->folder->klass != mh_get_class())
+	if (!from_folder || (from_folder->folder->klass != mh_get_class() &&
+			     from_folder->folder->klass != maildir_get_class()))
 		return;
 
 	msg = g_strdup_printf(_("Select folder to copy folder '%s' to"),
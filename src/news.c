@@ -1110,141 +1110,80 @@ static void news_set_msg_flags(FolderItem *item, MsgInfo *msginfo)
 	}
 }
 
-static void news_get_extra_fields(NewsSession *session, FolderItem *item, GSList *msglist)
-{
-	MsgInfo *msginfo = NULL;
-	gint ok;
-	GSList *cur;
-	clist *hdrlist = NULL;
-	clistiter *hdr;
-	gint first = -1, last = -1;
-	GHashTable *hash_table;
-	
-	cm_return_if_fail(session != NULL);
-	cm_return_if_fail(item != NULL);
-	cm_return_if_fail(item->folder != NULL);
-	cm_return_if_fail(FOLDER_CLASS(item->folder) == &news_class);
-
-	if (msglist == NULL)
-		return;
-
-	news_folder_lock(NEWS_FOLDER(item->folder));
+/* the headers that are not in the overview */
+static const char *news_extra_headers[] = { "newsgroups", "to", "cc", NULL };
 
-	hash_table = g_hash_table_new(g_direct_hash, g_direct_equal);
-	
-	for (cur = msglist; cur; cur = cur->next) {
-		msginfo = (MsgInfo *)cur->data;
-		if (first == -1 || msginfo->msgnum < first)
-			first = msginfo->msgnum;
-		if (last == -1 || msginfo->msgnum > last)
-			last = msginfo->msgnum;
-		g_hash_table_insert(hash_table,
-				GINT_TO_POINTER(msginfo->msgnum), msginfo);
-	}
+typedef struct _NewsOverviewData
+{
+	FolderItem *item;
+	/* the MsgInfos by number */
+	GHashTable *msginfos;
+	/* the MsgInfos, last first */
+	GSList *list;
+} NewsOverviewData;
+
+static void news_overview_xover(struct newsnntp_xover_resp_item *ritem,
+				gpointer data)
+{
+	NewsOverviewData *overview = (NewsOverviewData *)data;
+	MsgInfo *msginfo;
 
-	if (first == -1 || last == -1) {
-		g_hash_table_destroy(hash_table);
+	msginfo = news_parse_xover(ritem);
+	if (!msginfo) {
+		log_warning(LOG_PROTOCOL, _("invalid xover line\n"));
 		return;
 	}
 
-/* Newsgroups */
-	ok = nntp_threaded_xhdr(item->folder, "newsgroups", first, last, &hdrlist);
+	msginfo->folder = overview->item;
+	news_set_msg_flags(overview->item, msginfo);
+	msginfo->flags.tmp_flags |= MSG_NEWS;
 
-	if (ok != NEWSNNTP_NO_ERROR) {
-		log_warning(LOG_PROTOCOL, _("couldn't get xhdr\n"));
-		if (ok == NEWSNNTP_ERROR_STREAM) {
-			session_destroy(SESSION(session));
-			REMOTE_FOLDER(item->folder)->session = NULL;
-		}
-		news_folder_unlock(NEWS_FOLDER(item->folder));
-		if (hdrlist != NULL)
-			newsnntp_xhdr_free(hdrlist);
-		return;
-	}
+	g_hash_table_insert(overview->msginfos,
+			GINT_TO_POINTER(msginfo->msgnum), msginfo);
+	overview->list = g_slist_prepend(overview->list, msginfo);
+}
 
-	for (hdr = clist_begin(hdrlist); hdr; hdr = clist_next(hdr)) {
-		struct newsnntp_xhdr_resp_item *hdrval = clist_content(hdr);
-		msginfo = g_hash_table_lookup(hash_table, GINT_TO_POINTER(hdrval->hdr_article));
-		if (msginfo) {
-			if (msginfo->newsgroups)
-				g_free(msginfo->newsgroups);
-			msginfo->newsgroups = g_strdup(hdrval->hdr_value);
-		}
-	}
-	newsnntp_xhdr_free(hdrlist);
-	hdrlist = NULL;
-	
-/* To */
-	ok = nntp_threaded_xhdr(item->folder, "to", first, last, &hdrlist);
+static void news_overview_xhdr(const char *header,
+			       struct newsnntp_xhdr_resp_item *hdrval,
+			       gpointer data)
+{
+	NewsOverviewData *overview = (NewsOverviewData *)data;
+	MsgInfo *msginfo;
+	gchar **field;
 
-	if (ok != NEWSNNTP_NO_ERROR) {
-		log_warning(LOG_PROTOCOL, _("couldn't get xhdr\n"));
-		if (ok == NEWSNNTP_ERROR_STREAM) {
-			session_destroy(SESSION(session));
-			REMOTE_FOLDER(item->folder)->session = NULL;
-		}
-		news_folder_unlock(NEWS_FOLDER(item->folder));
-		if (hdrlist != NULL)
-			newsnntp_xhdr_free(hdrlist);
+	/* the overview of the batch is always got before its headers */
+	msginfo = g_hash_table_lookup(overview->msginfos,
+			GINT_TO_POINTER(hdrval->hdr_article));
+	if (!msginfo)
 		return;
-	}
-
-	for (hdr = clist_begin(hdrlist); hdr; hdr = clist_next(hdr)) {
-		struct newsnntp_xhdr_resp_item *hdrval = clist_content(hdr);
-		msginfo = g_hash_table_lookup(hash_table, GINT_TO_POINTER(hdrval->hdr_article));
-		if (msginfo) {
-			if (msginfo->to)
-				g_free(msginfo->to);
-			msginfo->to = g_strdup(hdrval->hdr_value);
-		}
-	}
-	newsnntp_xhdr_free(hdrlist);
-	hdrlist = NULL;
-	
-/* Cc */
-	ok = nntp_threaded_xhdr(item->folder, "cc", first, last, &hdrlist);
 
-	if (ok != NEWSNNTP_NO_ERROR) {
-		log_warning(LOG_PROTOCOL, _("couldn't get xhdr\n"));
-		if (ok == NEWSNNTP_ERROR_STREAM) {
-			session_destroy(SESSION(session));
-			REMOTE_FOLDER(item->folder)->session = NULL;
-		}
-		news_folder_unlock(NEWS_FOLDER(item->folder));
-		if (hdrlist != NULL)
-			newsnntp_xhdr_free(hdrlist);
+	if (!strcmp(header, "newsgroups"))
+		field = &msginfo->newsgroups;
+	else if (!strcmp(header, "to"))
+		field = &msginfo->to;
+	else if (!strcmp(header, "cc"))
+		field = &msginfo->cc;
+	else
 		return;
-	}
 
-	for (hdr = clist_begin(hdrlist); hdr; hdr = clist_next(hdr)) {
-		struct newsnntp_xhdr_resp_item *hdrval = clist_content(hdr);
-		msginfo = g_hash_table_lookup(hash_table, GINT_TO_POINTER(hdrval->hdr_article));
-		if (msginfo) {
-			if (msginfo->cc)
-				g_free(msginfo->cc);
-			msginfo->cc = g_strdup(hdrval->hdr_value);
-		}
-	}
-	newsnntp_xhdr_free(hdrlist);
-	hdrlist = NULL;
-
-	g_hash_table_destroy(hash_table);
-	news_folder_unlock(NEWS_FOLDER(item->folder));
+	g_free(*field);
+	*field = g_strdup(hdrval->hdr_value);
 }
 
-static GSList *news_get_msginfos_for_range(NewsSession *session, FolderItem *item, guint begin, guint end)
+/* Gets the MsgInfos of the articles of the ranges, n_ranges pairs of
+ * first and last numbers, all in one go */
+static GSList *news_get_msginfos_for_ranges(NewsSession *session, FolderItem *item,
+					    const guint32 *ranges, guint n_ranges)
 {
-	GSList *newlist = NULL;
-	GSList *llast = NULL;
-	MsgInfo *msginfo;
+	NewsOverviewData overview;
 	gint ok;
-	clist *msglist = NULL;
-	clistiter *cur;
+
 	cm_return_val_if_fail(session != NULL, NULL);
 	cm_return_val_if_fail(item != NULL, NULL);
+	cm_return_val_if_fail(n_ranges > 0, NULL);
 
 	log_message(LOG_PROTOCOL, _("getting xover %d - %d in %s...\n"),
-		    begin, end, item->path);
+		    ranges[0], ranges[2 * n_ranges - 1], item->path);
 
 	news_folder_lock(NEWS_FOLDER(item->folder));
 	
@@ -1255,51 +1194,28 @@ static GSList *news_get_msginfos_for_range(NewsSession *session, FolderItem *ite
 		return NULL;
 	}
 
-	ok = nntp_threaded_xover(item->folder, begin, end, NULL, &msglist);
-	
+	overview.item = item;
+	overview.msginfos = g_hash_table_new(g_direct_hash, g_direct_equal);
+	overview.list = NULL;
+
+	/* the MsgInfos are made while the next batches are on their way */
+	ok = nntp_threaded_overview(item->folder, ranges, n_ranges,
+				    news_extra_headers, news_overview_xover,
+				    news_overview_xhdr, &overview);
+
 	if (ok != NEWSNNTP_NO_ERROR) {
 		log_warning(LOG_PROTOCOL, _("couldn't get xover\n"));
 		if (ok == NEWSNNTP_ERROR_STREAM) {
 			session_destroy(SESSION(session));
 			REMOTE_FOLDER(item->folder)->session = NULL;
 		}
-		news_folder_unlock(NEWS_FOLDER(item->folder));
-		if (msglist != NULL)
-			newsnntp_xover_resp_list_free(msglist);
-		return NULL;
-	}
-
-	if (msglist) {
-		for (cur = clist_begin(msglist); cur; cur = clist_next(cur)) {
-			struct newsnntp_xover_resp_item *ritem = (struct newsnntp_xover_resp_item *)clist_content(cur);
-			msginfo = news_parse_xover(ritem);
-			
-			if (!msginfo) {
-				log_warning(LOG_PROTOCOL, _("invalid xover line\n"));
-				continue;
-			}
-
-			msginfo->folder = item;
-			news_set_msg_flags(item, msginfo);
-			msginfo->flags.tmp_flags |= MSG_NEWS;
-
-			if (!newlist)
-				llast = newlist = g_slist_append(newlist, msginfo);
-			else {
-				llast = g_slist_append(llast, msginfo);
-				llast = llast->next;
-			}
-		}
-		newsnntp_xover_resp_list_free(msglist);
-	}
+	} else
+		session_set_access_time(SESSION(session));
 
+	g_hash_table_destroy(overview.msginfos);
 	news_folder_unlock(NEWS_FOLDER(item->folder));
 
-	session_set_access_time(SESSION(session));
-
-	news_get_extra_fields(session, item, newlist);
-	
-	return newlist;
+	return g_slist_reverse(overview.list);
 }
 
 static MsgInfo *news_get_msginfo(Folder *folder, FolderItem *item, gint num)
@@ -1307,6 +1223,7 @@ static MsgInfo *news_get_msginfo(Folder *folder, FolderItem *item, gint num)
 	GSList *msglist = NULL;
 	NewsSession *session;
 	MsgInfo *msginfo = NULL;
+	guint32 range[2];
 
 	session = news_session_get(folder);
 	cm_return_val_if_fail(session != NULL, NULL);
@@ -1314,7 +1231,8 @@ static MsgInfo *news_get_msginfo(Folder *folder, FolderItem *item, gint num)
 	cm_return_val_if_fail(item->folder != NULL, NULL);
 	cm_return_val_if_fail(FOLDER_CLASS(item->folder) == &news_class, NULL);
 
- 	msglist = news_get_msginfos_for_range(session, item, num, num);
+	range[0] = range[1] = num;
+ 	msglist = news_get_msginfos_for_ranges(session, item, range, 1);
  
  	if (msglist)
 		msginfo = msglist->data;
@@ -1327,8 +1245,9 @@ static MsgInfo *news_get_msginfo(Folder *folder, FolderItem *item, gint num)
 static GSList *news_get_msginfos(Folder *folder, FolderItem *item, GSList *msgnum_list)
 {
 	NewsSession *session;
-	GSList *elem, *msginfo_list = NULL, *tmp_msgnum_list, *tmp_msginfo_list;
-	guint first, last, next;
+	GSList *elem, *msginfo_list = NULL, *tmp_msgnum_list;
+	GArray *ranges;
+	guint32 first, last, next;
 	
 	cm_return_val_if_fail(folder != NULL, NULL);
 	cm_return_val_if_fail(FOLDER_CLASS(folder) == &news_class, NULL);
@@ -1341,28 +1260,31 @@ static GSList *news_get_msginfos(Folder *folder, FolderItem *item, GSList *msgnu
 	tmp_msgnum_list = g_slist_copy(msgnum_list);
 	tmp_msgnum_list = g_slist_sort(tmp_msgnum_list, g_int_compare);
 
+	elem = tmp_msgnum_list;
+
 	progressindicator_start(PROGRESS_TYPE_NETWORK);
 
-	first = GPOINTER_TO_INT(tmp_msgnum_list->data);
+	/* the contiguous ranges of numbers, all asked at once */
+	ranges = g_array_new(FALSE, FALSE, sizeof(guint32));
+	first = GPOINTER_TO_INT(elem->data);
 	last = first;
 	
-	news_folder_lock(NEWS_FOLDER(item->folder));
-	
-	for(elem = g_slist_next(tmp_msgnum_list); elem != NULL; elem = g_slist_next(elem)) {
+	for (elem = g_slist_next(elem); elem != NULL; elem = g_slist_next(elem)) {
 		next = GPOINTER_TO_INT(elem->data);
-		if(next != (last + 1)) {
-			tmp_msginfo_list = news_get_msginfos_for_range(session, item, first, last);
-			msginfo_list = g_slist_concat(msginfo_list, tmp_msginfo_list);
+		if (next != (last + 1)) {
+			g_array_append_val(ranges, first);
+			g_array_append_val(ranges, last);
 			first = next;
 		}
 		last = next;
 	}
-	
-	news_folder_unlock(NEWS_FOLDER(item->folder));
-	
-	tmp_msginfo_list = news_get_msginfos_for_range(session, item, first, last);
-	msginfo_list = g_slist_concat(msginfo_list, tmp_msginfo_list);
+	g_array_append_val(ranges, first);
+	g_array_append_val(ranges, last);
+
+	msginfo_list = news_get_msginfos_for_ranges(session, item,
+			(guint32 *)ranges->data, ranges->len / 2);
 
+	g_array_free(ranges, TRUE);
 	g_slist_free(tmp_msgnum_list);
 	
 	progressindicator_stop(PROGRESS_TYPE_NETWORK);
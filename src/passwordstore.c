@@ -467,7 +467,7 @@ void passwd_store_write_config(void)
 	}
 }
 
-int passwd_store_read_config(void)
+int passwd_store_read_file(gint *config_version_ret)
 {
 	gchar *rcpath, *contents, **lines, **line, *typestr, *name;
 	GError *error = NULL;
@@ -563,6 +563,12 @@ int passwd_store_read_config(void)
 	}
 	g_strfreev(lines);
 
+	*config_version_ret = config_version;
+	return 1;
+}
+
+int passwd_store_upgrade_config(gint config_version)
+{
 	if (prefs_update_config_version_password_store(config_version) < 0) {
 		debug_print("Password store configuration file version upgrade failed\n");
 		return -2;
@@ -570,3 +576,14 @@ int passwd_store_read_config(void)
 
 	return g_slist_length(_password_store);
 }
+
+int passwd_store_read_config(void)
+{
+	gint config_version;
+	int ret = passwd_store_read_file(&config_version);
+
+	if (ret <= 0)
+		return ret;
+
+	return passwd_store_upgrade_config(config_version);
+}
@@ -75,6 +75,14 @@ void passwd_store_reencrypt_all(const gchar *old_mpwd,
 void passwd_store_write_config(void);
 int passwd_store_read_config(void);
 
+/* The two halves of passwd_store_read_config(). Reading the file
+ * doesn't involve the interface, so it can be done in another thread;
+ * it returns 0 if there is no file, in which case there is nothing to
+ * upgrade either. Upgrading its config_version must be done in the main
+ * thread. */
+int passwd_store_read_file(gint *config_version);
+int passwd_store_upgrade_config(gint config_version);
+
 /* Convenience wrappers for handling account passwords.
  * (This is to save some boilerplate code converting account_id to
  * a string and freeing the string afterwards.) */
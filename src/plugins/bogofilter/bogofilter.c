@@ -163,18 +163,161 @@ static pthread_mutex_t wait_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t wait_cond = PTHREAD_COND_INITIALIZER; 
 #endif
 
+/* how many file names are sent to bogofilter ahead of its answers */
+#define BOGOFILTER_MAX_IN_FLIGHT 16
+
+typedef struct _BogoFilterJob {
+	MsgInfo *msginfo;
+	gchar *file;
+	gboolean whitelisted;
+} BogoFilterJob;
+
+/* files the message according to bogofilter's answer buf, NULL if
+ * there was none */
+static void bogofilter_handle_result(BogoFilterData *data, BogoFilterJob *job,
+				     gchar *buf)
+{
+	MsgInfo *msginfo = job->msginfo;
+	gchar *file = job->file;
+	gboolean whitelisted = job->whitelisted;
+
+	if (buf == NULL) {
+		g_warning("bogofilter short read");
+		debug_print("message %d is ham\n", msginfo->msgnum);
+		data->mail_filtering_data->unfiltered = g_slist_prepend(
+			data->mail_filtering_data->unfiltered, msginfo);
+		data->new_hams = g_slist_prepend(data->new_hams, msginfo);
+	} else {
+		gchar **parts = NULL;
+		gchar *tmp;
+
+		if (strchr(buf, '/')) {
+			tmp = strrchr(buf, '/')+1;
+		} else {
+			tmp = buf;
+		}
+		parts = g_strsplit(tmp, " ", 0);
+		debug_print("read %s\n", buf);
+		
+		/* note the result if the header if needed */
+		if (parts && parts[0] && parts[1] && parts[2] && 
+		    FOLDER_TYPE(msginfo->folder->folder) == F_MH &&
+		    config.insert_header) {
+			gchar *tmpfile = get_tmp_file();
+			FILE *input = claws_fopen(file, "r");
+			FILE *output = claws_fopen(tmpfile, "w");
+			if (strstr(parts[2], "\n"))
+				*(strstr(parts[2], "\n")) = '\0';
+			if (input && !output) 
+				claws_fclose (input);
+			else if (!input && output)
+				claws_fclose (output);
+			else if (input && output) {
+				gchar tmpbuf[BUFFSIZE];
+				gboolean err = FALSE;
+				const gchar *bogosity = *parts[1] == 'S' ? "Spam":
+							 (*parts[1] == 'H' ? "Ham":"Unsure");
+				gchar *tmpstr = g_strdup_printf(
+						"X-Bogosity: %s, spamicity=%s%s\n",
+						bogosity, parts[2],
+						whitelisted?" [whitelisted]":"");
+				if (claws_fwrite(tmpstr, 1, strlen(tmpstr), output) < strlen(tmpstr)) {
+					err = TRUE;
+				} else {
+					while (claws_fgets(tmpbuf, sizeof(tmpbuf), input)) {
+						if (claws_fputs(tmpbuf, output) == EOF) {
+							err = TRUE;
+							break;
+						}
+					}
+				}
+				claws_fclose(input);
+				if (claws_safe_fclose(output) == EOF)
+					err = TRUE;
+				if (!err)
+					move_file(tmpfile, file, TRUE);
+				g_free(tmpstr);
+			}
+			g_free(tmpfile);
+		}
+
+		/* file the mail */
+		if (!whitelisted && parts && parts[0] && parts[1] && *parts[1] == 'S') {
+
+			debug_print("message %d is spam\n", msginfo->msgnum);
+			/* Spam will be filtered away, unless we want "mark only".
+			 * In that case, we want it among unfiltered messages, so
+			 * it gets processed further. */
+			if (config.receive_spam == SPAM_MARK_ONLY) {
+				data->mail_filtering_data->unfiltered = g_slist_prepend(
+					data->mail_filtering_data->unfiltered, msginfo);
+			} else {
+				data->mail_filtering_data->filtered = g_slist_prepend(
+					data->mail_filtering_data->filtered, msginfo);
+			}
+			data->new_spams = g_slist_prepend(data->new_spams, msginfo);
+
+		} else if (whitelisted && parts && parts[0] && parts[1] && 
+				(*parts[1] == 'S' || *parts[1] == 'U')) {
+
+			debug_print("message %d is whitelisted %s\n", msginfo->msgnum,
+				*parts[1] == 'S' ? "spam":"unsure");
+			/* Whitelisted spam will *not* be filtered away, but continue
+			 * their trip through filtering as if it was ham. */
+			data->mail_filtering_data->unfiltered = g_slist_prepend(
+				data->mail_filtering_data->unfiltered, msginfo);
+			/* But it gets put in a different list, so that we 
+			 * can still flag it and inform the user that it is
+			 * considered a spam (so that he can teach bogo that 
+			 * it was not). */
+			data->whitelisted_new_spams = g_slist_prepend(data->whitelisted_new_spams, msginfo);
+
+		} else if (config.save_unsure && parts && parts[0] && parts[1] && *parts[1] == 'U') {
+			
+			debug_print("message %d is unsure\n", msginfo->msgnum);
+			/* Spam will be filtered away */
+			data->mail_filtering_data->filtered = g_slist_prepend(
+				data->mail_filtering_data->filtered, msginfo);
+			data->new_unsure = g_slist_prepend(data->new_unsure, msginfo);
+
+		} else {
+			
+			debug_print("message %d is ham\n", msginfo->msgnum);
+			data->mail_filtering_data->unfiltered = g_slist_prepend(
+				data->mail_filtering_data->unfiltered, msginfo);
+			data->new_hams = g_slist_prepend(data->new_hams, msginfo);
+
+		}
+		g_strfreev(parts);
+	}
+}
+
+static void bogofilter_read_result(BogoFilterData *data, BogoFilterJob *job,
+				   FILE *bogo_out)
+{
+	gchar buf[BUFSIZ];
+
+	if (claws_fgets(buf, sizeof(buf), bogo_out) == NULL)
+		bogofilter_handle_result(data, job, NULL);
+	else
+		bogofilter_handle_result(data, job, buf);
+
+	g_free(job->file);
+	g_free(job);
+}
+
 static void bogofilter_do_filter(BogoFilterData *data)
 {
 	GPid bogo_pid;
 	gint bogo_stdin, bogo_stdout;
+	FILE *bogo_out = NULL;
 	GError *error = NULL;
 	gboolean bogo_forked;
 	int status = 0;
 	MsgInfo *msginfo;
 	GSList *cur = NULL;
+	GQueue in_flight = G_QUEUE_INIT;
 	int total = 0, curnum = 1;
-	gchar *file = NULL;
-	gchar buf[BUFSIZ];
 
 	total = g_slist_length(data->msglist);
 
@@ -189,6 +332,7 @@ static void bogofilter_do_filter(BogoFilterData *data)
 		error = NULL;
 		status = -1;
 	} else {
+		bogo_out = fdopen(bogo_stdout, "r");
 	
 		if (config.whitelist_ab) {
 			gchar *ab_folderpath;
@@ -205,151 +349,56 @@ static void bogofilter_do_filter(BogoFilterData *data)
 			start_address_completion(ab_folderpath);
 		}
 
+		/* bogofilter answers in order, so the next messages are
+		 * prepared and sent while it works on the previous ones */
 		for (cur = data->msglist; cur; cur = cur->next) {
-			gboolean whitelisted = FALSE;
+			BogoFilterJob *job = g_new0(BogoFilterJob, 1);
+
 			msginfo = (MsgInfo *)cur->data;
 			debug_print("Filtering message %d (%d/%d)\n", msginfo->msgnum, curnum, total);
 
 			if (message_callback != NULL)
 				message_callback(NULL, total, curnum++, data->in_thread);
 
+			job->msginfo = msginfo;
 			if (config.whitelist_ab && msginfo->from && 
 			    found_in_addressbook(msginfo->from))
-				whitelisted = TRUE;
+				job->whitelisted = TRUE;
 
 			/* can set flags (SCANNED, ATTACHMENT) but that's ok 
 			 * as GUI updates are hooked not direct */
 
-			file = procmsg_get_message_file(msginfo);
+			job->file = procmsg_get_message_file(msginfo);
 
-			if (file) {
-				gchar *tmp = g_strdup_printf("%s\n",file);
+			if (job->file && bogo_out) {
+				gchar *tmp = g_strdup_printf("%s\n", job->file);
 				/* send filename to bogofilter */
 				write_all(bogo_stdin, tmp, strlen(tmp));
 				g_free(tmp);
-				memset(buf, 0, sizeof(buf));
-				/* get the result */
-				if (read(bogo_stdout, buf, sizeof(buf)-1) < 0) {
-					g_warning("bogofilter short read");
-					debug_print("message %d is ham\n", msginfo->msgnum);
-					data->mail_filtering_data->unfiltered = g_slist_prepend(
-						data->mail_filtering_data->unfiltered, msginfo);
-					data->new_hams = g_slist_prepend(data->new_hams, msginfo);
-				} else {
-					gchar **parts = NULL;
-
-					buf[sizeof(buf) - 1] = '\0';
-					if (strchr(buf, '/')) {
-						tmp = strrchr(buf, '/')+1;
-					} else {
-						tmp = buf;
-					}
-					parts = g_strsplit(tmp, " ", 0);
-					debug_print("read %s\n", buf);
-					
-					/* note the result if the header if needed */
-					if (parts && parts[0] && parts[1] && parts[2] && 
-					    FOLDER_TYPE(msginfo->folder->folder) == F_MH &&
-					    config.insert_header) {
-						gchar *tmpfile = get_tmp_file();
-						FILE *input = claws_fopen(file, "r");
-						FILE *output = claws_fopen(tmpfile, "w");
-						if (strstr(parts[2], "\n"))
-							*(strstr(parts[2], "\n")) = '\0';
-						if (input && !output) 
-							claws_fclose (input);
-						else if (!input && output)
-							claws_fclose (output);
-						else if (input && output) {
-							gchar tmpbuf[BUFFSIZE];
-							gboolean err = FALSE;
-							const gchar *bogosity = *parts[1] == 'S' ? "Spam":
-										 (*parts[1] == 'H' ? "Ham":"Unsure");
-							gchar *tmpstr = g_strdup_printf(
-									"X-Bogosity: %s, spamicity=%s%s\n",
-									bogosity, parts[2],
-									whitelisted?" [whitelisted]":"");
-							if (claws_fwrite(tmpstr, 1, strlen(tmpstr), output) < strlen(tmpstr)) {
-								err = TRUE;
-							} else {
-								while (claws_fgets(tmpbuf, sizeof(buf), input)) {
-									if (claws_fputs(tmpbuf, output) == EOF) {
-										err = TRUE;
-										break;
-									}
-								}
-							}
-							claws_fclose(input);
-							if (claws_safe_fclose(output) == EOF)
-								err = TRUE;
-							if (!err)
-								move_file(tmpfile, file, TRUE);
-							g_free(tmpstr);
-						}
-						g_free(tmpfile);
-					}
-
-					/* file the mail */
-					if (!whitelisted && parts && parts[0] && parts[1] && *parts[1] == 'S') {
-
-						debug_print("message %d is spam\n", msginfo->msgnum);
-						/* Spam will be filtered away, unless we want "mark only".
-						 * In that case, we want it among unfiltered messages, so
-						 * it gets processed further. */
-						if (config.receive_spam == SPAM_MARK_ONLY) {
-							data->mail_filtering_data->unfiltered = g_slist_prepend(
-								data->mail_filtering_data->unfiltered, msginfo);
-						} else {
-							data->mail_filtering_data->filtered = g_slist_prepend(
-								data->mail_filtering_data->filtered, msginfo);
-						}
-						data->new_spams = g_slist_prepend(data->new_spams, msginfo);
-
-					} else if (whitelisted && parts && parts[0] && parts[1] && 
-							(*parts[1] == 'S' || *parts[1] == 'U')) {
-
-						debug_print("message %d is whitelisted %s\n", msginfo->msgnum,
-							*parts[1] == 'S' ? "spam":"unsure");
-						/* Whitelisted spam will *not* be filtered away, but continue
-						 * their trip through filtering as if it was ham. */
-						data->mail_filtering_data->unfiltered = g_slist_prepend(
-							data->mail_filtering_data->unfiltered, msginfo);
-						/* But it gets put in a different list, so that we 
-						 * can still flag it and inform the user that it is
-						 * considered a spam (so that he can teach bogo that 
-						 * it was not). */
-						data->whitelisted_new_spams = g_slist_prepend(data->whitelisted_new_spams, msginfo);
-
-					} else if (config.save_unsure && parts && parts[0] && parts[1] && *parts[1] == 'U') {
-						
-						debug_print("message %d is unsure\n", msginfo->msgnum);
-						/* Spam will be filtered away */
-						data->mail_filtering_data->filtered = g_slist_prepend(
-							data->mail_filtering_data->filtered, msginfo);
-						data->new_unsure = g_slist_prepend(data->new_unsure, msginfo);
-
-					} else {
-						
-						debug_print("message %d is ham\n", msginfo->msgnum);
-						data->mail_filtering_data->unfiltered = g_slist_prepend(
-							data->mail_filtering_data->unfiltered, msginfo);
-						data->new_hams = g_slist_prepend(data->new_hams, msginfo);
-
-					}
-					g_strfreev(parts);
-				}
-				g_free(file);
+				g_queue_push_tail(&in_flight, job);
+				if (g_queue_get_length(&in_flight) >= BOGOFILTER_MAX_IN_FLIGHT)
+					bogofilter_read_result(data,
+						g_queue_pop_head(&in_flight), bogo_out);
 			} else {
 				data->mail_filtering_data->unfiltered = g_slist_prepend(
 					data->mail_filtering_data->unfiltered, msginfo);
 				data->new_hams = g_slist_prepend(data->new_hams, msginfo);
+				g_free(job->file);
+				g_free(job);
 			}
 		}
+		while (!g_queue_is_empty(&in_flight))
+			bogofilter_read_result(data, g_queue_pop_head(&in_flight),
+					       bogo_out);
+
 		if (config.whitelist_ab)
 			end_address_completion();
 	}
 	if (status != -1) {
-		close(bogo_stdout);
+		if (bogo_out)
+			claws_fclose(bogo_out);
+		else
+			close(bogo_stdout);
 		close(bogo_stdin);
 		waitpid(bogo_pid, &status, 0);
 		if (!WIFEXITED(status))
@@ -720,6 +769,63 @@ BogofilterConfig *bogofilter_get_config(void)
 	return &config;
 }
 
+/* trains bogofilter with all messages of msglist in one run, feeding
+ * their file names on its standard input */
+static gint bogofilter_learn_batch(const gchar *bogo_exec, const gchar *mode,
+				   GSList *msglist, int total, int *done)
+{
+	gchar *bogo_args[4];
+	GPid bogo_pid;
+	gint bogo_stdin;
+	GError *error = NULL;
+	gboolean bogo_forked;
+	gint status = 0;
+	GSList *cur;
+
+	bogo_args[0] = (gchar *)bogo_exec;
+	bogo_args[1] = (gchar *)mode;
+	bogo_args[2] = "-b";
+	bogo_args[3] = NULL;
+	debug_print("|%s %s %s ...\n", bogo_args[0], bogo_args[1], bogo_args[2]);
+	bogo_forked = g_spawn_async_with_pipes(
+			NULL, bogo_args,NULL, G_SPAWN_SEARCH_PATH|G_SPAWN_DO_NOT_REAP_CHILD,
+			NULL, NULL, &bogo_pid, &bogo_stdin,
+			NULL, NULL, &error);
+
+	for (cur = msglist; bogo_forked && cur; cur = cur->next) {
+		MsgInfo *info = (MsgInfo *)cur->data;
+		gchar *file = procmsg_get_message_file(info);
+
+		if (file) {
+			gchar *tmp = g_strdup_printf("%s\n", file);
+			write_all(bogo_stdin, tmp, strlen(tmp));
+			g_free(tmp);
+		}
+		g_free(file);
+		(*done)++;
+		if (message_callback != NULL)
+			message_callback(NULL, total, *done, FALSE);
+	}
+	if (bogo_forked) {
+		close(bogo_stdin);
+		waitpid(bogo_pid, &status, 0);
+		if (!WIFEXITED(status))
+			status = -1;
+		else
+			status = WEXITSTATUS(status);
+	}
+	if (!bogo_forked || status != 0) {
+		log_error(LOG_PROTOCOL, _("Learning failed; `%s %s %s` returned with error:\n%s"),
+				bogo_args[0], bogo_args[1], bogo_args[2], 
+				error ? error->message:_("Unknown error"));
+		if (error)
+			g_error_free(error);
+		if (status == 0)
+			status = -1;
+	}
+	return status;
+}
+
 int bogofilter_learn(MsgInfo *msginfo, GSList *msglist, gboolean spam)
 {
 	gchar *cmd = NULL;
@@ -758,109 +864,38 @@ int bogofilter_learn(MsgInfo *msginfo, GSList *msglist, gboolean spam)
 				message_callback(NULL, 0, 0, FALSE);
 		}
 	} else if (msglist) {
-		GSList *cur = msglist;
+		GSList *cur;
+		GSList *corrections = NULL, *others = NULL;
 		MsgInfo *info;
 		int total = g_slist_length(msglist);
 		int done = 0;
-		gboolean some_correction = FALSE, some_no_correction = FALSE;
 	
 		if (message_callback != NULL)
 			message_callback(_("Bogofilter: learning from messages..."), total, 0, FALSE);
 		
-		for (cur = msglist; cur && status == 0; cur = cur->next) {
+		for (cur = msglist; cur; cur = cur->next) {
 			info = (MsgInfo *)cur->data;
-			if (spam)
-				some_no_correction = TRUE;
-			else if (MSG_IS_SPAM(info->flags))
+			if (!spam && MSG_IS_SPAM(info->flags))
 				/* correct bogofilter, this wasn't spam */
-				some_correction = TRUE;
-			else 
-				some_no_correction = TRUE;
-			
+				corrections = g_slist_prepend(corrections, info);
+			else
+				others = g_slist_prepend(others, info);
 		}
 		
-		if (some_correction && some_no_correction) {
-			/* we potentially have to do different stuff for every mail */
-			for (cur = msglist; cur && status == 0; cur = cur->next) {
-				info = (MsgInfo *)cur->data;
-				file = procmsg_get_message_file(info);
-
-				if (spam)
-					/* learn as spam */
-					cmd = g_strdup_printf("%s -s -I '%s'", bogo_exec, file);
-				else if (MSG_IS_SPAM(info->flags))
-					/* correct bogofilter, this wasn't spam */
-					cmd = g_strdup_printf("%s -Sn -I '%s'", bogo_exec, file);
-				else 
-					/* learn as ham */
-					cmd = g_strdup_printf("%s -n -I '%s'", bogo_exec, file);
-				
-				debug_print("%s\n", cmd);
-				if ((status = execute_command_line(cmd, FALSE, NULL)) != 0)
-					log_error(LOG_PROTOCOL, _("Learning failed; `%s` returned with status %d."),
-							cmd, status);
-
-				g_free(cmd);
-				g_free(file);
-				done++;
-				if (message_callback != NULL)
-					message_callback(NULL, total, done, FALSE);
-			}
-		} else if (some_correction || some_no_correction) {
-			cur = msglist;
-			
-			gchar *bogo_args[4];
-			GPid bogo_pid;
-			gint bogo_stdin;
-			GError *error = NULL;
-			gboolean bogo_forked;
-
-			bogo_args[0] = (gchar *)bogo_exec;
-			if (some_correction && !some_no_correction)
-				bogo_args[1] = "-Sn";
-			else if (some_no_correction && !some_correction)
-				bogo_args[1] = spam ? "-s":"-n";
-			bogo_args[2] = "-b";
-			bogo_args[3] = NULL;
-			debug_print("|%s %s %s ...\n", bogo_args[0], bogo_args[1], bogo_args[2]);
-			bogo_forked = g_spawn_async_with_pipes(
-					NULL, bogo_args,NULL, G_SPAWN_SEARCH_PATH|G_SPAWN_DO_NOT_REAP_CHILD,
-					NULL, NULL, &bogo_pid, &bogo_stdin,
-					NULL, NULL, &error);
-
-			while (bogo_forked && cur) {
-				gchar *tmp = NULL;
-				info = (MsgInfo *)cur->data;
-				file = procmsg_get_message_file(info);
-				if (file) {
-					tmp = g_strdup_printf("%s\n", 
-						file);
-					write_all(bogo_stdin, tmp, strlen(tmp));
-					g_free(tmp);
-				}
-				g_free(file);
-				done++;
-				if (message_callback != NULL)
-					message_callback(NULL, total, done, FALSE);
-				cur = cur->next;
-			}
-			if (bogo_forked) {
-				close(bogo_stdin);
-				waitpid(bogo_pid, &status, 0);
-				if (!WIFEXITED(status))
-					status = -1;
-				else
-					status = WEXITSTATUS(status);
-			}
-			if (!bogo_forked || status != 0) {
-				log_error(LOG_PROTOCOL, _("Learning failed; `%s %s %s` returned with error:\n%s"),
-						bogo_args[0], bogo_args[1], bogo_args[2], 
-						error ? error->message:_("Unknown error"));
-				if (error)
-					g_error_free(error);
-			}
-
+		/* one bogofilter run per kind of training rather than
+		 * one per message */
+		if (corrections) {
+			corrections = g_slist_reverse(corrections);
+			status = bogofilter_learn_batch(bogo_exec, "-Sn",
+					corrections, total, &done);
+		}
+		if (others && status == 0) {
+			others = g_slist_reverse(others);
+			status = bogofilter_learn_batch(bogo_exec, spam ? "-s":"-n",
+					others, total, &done);
 		}
+		g_slist_free(corrections);
+		g_slist_free(others);
 
 		if (message_callback != NULL)
 			message_callback(NULL, 0, 0, FALSE);
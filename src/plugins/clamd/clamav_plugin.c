@@ -43,10 +43,12 @@
 
 #include "clamav_plugin.h"
 #include "clamd-plugin.h"
+#include "clamd-session.h"
 
 #define PLUGIN_NAME (_("Clam AntiVirus"))
 
 static gulong hook_id = HOOK_NONE;
+static gulong list_hook_id = HOOK_NONE;
 static MessageCallback message_callback;
 
 static ClamAvConfig config;
@@ -74,109 +76,286 @@ static PrefParam param[] = {
 	{NULL, NULL, NULL, P_OTHER, NULL, NULL, NULL}
 };
 
-struct clamd_result {
+struct clamd_part_scan {
+	MimeInfo *mimeinfo;
 	Clamd_Stat status;
+	response buf;
+};
+
+struct clamd_msg_scan {
+	MsgInfo *msginfo;
+	MimeInfo *mimeinfo;
+	GSList *parts;
 };
 
-static gboolean scan_func(GNode *node, gpointer data)
+/* messages scanned ahead by the list filtering hook, MsgInfo -> scan */
+static GHashTable *prescanned = NULL;
+
+static gboolean scan_feed_func(Clamd_Write_Func write_func, gpointer stream, gpointer data)
+{
+	MimeInfo *mimeinfo = (MimeInfo *) data;
+
+	return procmime_get_part_to_callback(mimeinfo, write_func, stream) == 0;
+}
+
+static void scan_part_func(gpointer data, gpointer user_data)
+{
+	struct clamd_part_scan *part = (struct clamd_part_scan *) data;
+
+	part->status = clamd_session_scan(clamd_get_socket(), scan_feed_func,
+					  part->mimeinfo, &part->buf);
+	debug_print("status: %d\n", part->status);
+}
+
+/* decoded size of a part, as far as it can be told without decoding it */
+static goffset part_size(MimeInfo *mimeinfo)
+{
+	if (mimeinfo->encoding_type == ENC_BASE64)
+		return mimeinfo->length / 4 * 3;
+	return mimeinfo->length;
+}
+
+/* the whole message, so that clamd sees its structure, and every leaf
+ * part decoded */
+static gboolean collect_part_func(GNode *node, gpointer data)
 {
-	struct clamd_result *result = (struct clamd_result *) data;
+	struct clamd_msg_scan *scan = (struct clamd_msg_scan *) data;
 	MimeInfo *mimeinfo = (MimeInfo *) node->data;
-	gchar *outfile;
-	response buf;
-	int max;
-	GStatBuf info;
+	struct clamd_part_scan *part;
+	goffset max = (goffset) config.clamav_max_size * 1048576;
+	gchar *msg;
+
+	if (!G_NODE_IS_ROOT(node) && !G_NODE_IS_LEAF(node))
+		return FALSE;
+
+	if (part_size(mimeinfo) > max) {
+		msg = g_strdup_printf(_("Part %s of message %d. Size (%d) greater than limit (%d)\n"),
+				      mimeinfo->id ? mimeinfo->id : "",
+				      scan->msginfo->msgnum,
+				      (int) part_size(mimeinfo), (int) max);
+		statusbar_print_all("%s", msg);
+		debug_print("%s", msg);
+		g_free(msg);
+		return FALSE;
+	}
+
+	part = g_new0(struct clamd_part_scan, 1);
+	part->mimeinfo = mimeinfo;
+	part->status = OK;
+	scan->parts = g_slist_prepend(scan->parts, part);
+
+	return FALSE;
+}
+
+static struct clamd_msg_scan *msg_scan_new(MsgInfo *msginfo)
+{
+	struct clamd_msg_scan *scan;
+	MimeInfo *mimeinfo;
+
+	/* fetches the message if needed, so it has to run here */
+	mimeinfo = procmime_scan_message(msginfo);
+	if (!mimeinfo)
+		return NULL;
+
+	scan = g_new0(struct clamd_msg_scan, 1);
+	scan->msginfo = procmsg_msginfo_new_ref(msginfo);
+	scan->mimeinfo = mimeinfo;
+	g_node_traverse(mimeinfo->node, G_PRE_ORDER, G_TRAVERSE_ALL, -1,
+			collect_part_func, scan);
+	scan->parts = g_slist_reverse(scan->parts);
+
+	return scan;
+}
+
+static void msg_scan_free(gpointer data)
+{
+	struct clamd_msg_scan *scan = (struct clamd_msg_scan *) data;
+	GSList *cur;
+
+	for (cur = scan->parts; cur; cur = cur->next) {
+		struct clamd_part_scan *part = (struct clamd_part_scan *) cur->data;
+
+		g_free(part->buf.msg);
+		g_free(part);
+	}
+	g_slist_free(scan->parts);
+	procmime_mimeinfo_free_all(&scan->mimeinfo);
+	procmsg_msginfo_free(&scan->msginfo);
+	g_free(scan);
+}
+
+/* scans the parts of all messages, several at once */
+static void msg_scans_run(GSList *scans)
+{
+	GThreadPool *pool = NULL;
+	GError *error = NULL;
+	GSList *parts = NULL, *cur;
+	gint count;
+
+	for (cur = scans; cur; cur = cur->next) {
+		struct clamd_msg_scan *scan = (struct clamd_msg_scan *) cur->data;
+
+		parts = g_slist_concat(parts, g_slist_copy(scan->parts));
+	}
+
+	count = g_slist_length(parts);
+	if (count > 1) {
+		pool = g_thread_pool_new(scan_part_func, NULL,
+					 MIN(count, CLAMD_SESSION_POOL_MAX),
+					 TRUE, &error);
+		if (pool == NULL) {
+			g_warning("couldn't create clamd scan threads: %s",
+				  error ? error->message : "unknown error");
+			if (error)
+				g_error_free(error);
+		}
+	}
+
+	for (cur = parts; cur; cur = cur->next) {
+		if (pool != NULL)
+			g_thread_pool_push(pool, cur->data, NULL);
+		else
+			scan_part_func(cur->data, NULL);
+	}
+	/* Waits for all queued scans to finish */
+	if (pool != NULL)
+		g_thread_pool_free(pool, FALSE, TRUE);
+
+	g_slist_free(parts);
+}
+
+static void report_status(Clamd_Stat status, response *buf)
+{
 	gchar* msg;
 
-	outfile = procmime_get_tmp_file_name(mimeinfo);
-	if (procmime_get_part(outfile, mimeinfo) < 0)
-		g_warning("Can't get the part of multipart message.");
-	else {
-    	max = config.clamav_max_size * 1048576; /* maximum file size */
-		if (g_stat(outfile, &info) == -1)
-			g_warning("Can't determine file size");
-		else {
-			if (info.st_size <= max) {
-				debug_print("Scanning %s\n", outfile);
-				result->status = clamd_verify_email(outfile, &buf);
-				debug_print("status: %d\n", result->status);
-				switch (result->status) {
-					case NO_SOCKET: 
-						g_warning("[scanning] No socket information");
-						if (config.alert_ack) {
-						    alertpanel_error(_("Scanning\nNo socket information.\nAntivirus disabled."));
-						    config.alert_ack = FALSE;
-						}
-						break;
-					case NO_CONNECTION:
-						g_warning("[scanning] Clamd does not respond to ping");
-						if (config.alert_ack) {
-						    alertpanel_warning(_("Scanning\nClamd does not respond to ping.\nIs clamd running?"));
-						    config.alert_ack = FALSE;
-						}
-						break;
-					case VIRUS: 
-						msg = g_strconcat(_("Detected %s virus."),
-							clamd_get_virus_name(buf.msg), NULL);
-						g_warning("%s", msg);
-						debug_print("no_recv: %d\n", prefs_common_get_prefs()->no_recv_err_panel);
-						if (prefs_common_get_prefs()->no_recv_err_panel) {
-						    statusbar_print_all("%s", msg);
-						}
-						else {
-						    alertpanel_warning("%s\n", msg);
-						}
-						g_free(msg);
-						config.alert_ack = TRUE;
-						break;
-					case SCAN_ERROR:
-						debug_print("Error: %s\n", buf.msg);
-						if (config.alert_ack) {
-						    alertpanel_error(_("Scanning error:\n%s"), buf.msg);
-						    config.alert_ack = FALSE;
-						}
-						break;
-					case OK:
-						debug_print("No virus detected.\n");
-						config.alert_ack = TRUE;
-						break;
-				}
+	switch (status) {
+		case NO_SOCKET: 
+			g_warning("[scanning] No socket information");
+			if (config.alert_ack) {
+			    alertpanel_error(_("Scanning\nNo socket information.\nAntivirus disabled."));
+			    config.alert_ack = FALSE;
+			}
+			break;
+		case NO_CONNECTION:
+			g_warning("[scanning] Clamd does not respond to ping");
+			if (config.alert_ack) {
+			    alertpanel_warning(_("Scanning\nClamd does not respond to ping.\nIs clamd running?"));
+			    config.alert_ack = FALSE;
+			}
+			break;
+		case VIRUS: 
+			msg = g_strconcat(_("Detected %s virus."),
+				clamd_get_virus_name(buf->msg), NULL);
+			g_warning("%s", msg);
+			debug_print("no_recv: %d\n", prefs_common_get_prefs()->no_recv_err_panel);
+			if (prefs_common_get_prefs()->no_recv_err_panel) {
+			    statusbar_print_all("%s", msg);
 			}
 			else {
-				msg = g_strdup_printf(_("File: %s. Size (%d) greater than limit (%d)\n"), outfile, (int) info.st_size, max);
-				statusbar_print_all("%s", msg);
-				debug_print("%s", msg);
-				g_free(msg);
+			    alertpanel_warning("%s\n", msg);
+			}
+			g_free(msg);
+			config.alert_ack = TRUE;
+			break;
+		case SCAN_ERROR:
+			debug_print("Error: %s\n", buf->msg);
+			if (config.alert_ack) {
+			    alertpanel_error(_("Scanning error:\n%s"), buf->msg);
+			    config.alert_ack = FALSE;
 			}
+			break;
+		case OK:
+			debug_print("No virus detected.\n");
+			config.alert_ack = TRUE;
+			break;
+	}
+}
+
+/* reports the first part which is not clean, in message order */
+static Clamd_Stat msg_scan_status(struct clamd_msg_scan *scan)
+{
+	GSList *cur;
+
+	for (cur = scan->parts; cur; cur = cur->next) {
+		struct clamd_part_scan *part = (struct clamd_part_scan *) cur->data;
+
+		if (part->status != OK) {
+			report_status(part->status, &part->buf);
+			return part->status;
 		}
-		g_unlink(outfile);
 	}
-	
-	return (result->status == OK) ? FALSE : TRUE;
+	report_status(OK, NULL);
+
+	return OK;
+}
+
+static gboolean mail_listfiltering_hook(gpointer source, gpointer data)
+{
+	MailFilteringData *mail_filtering_data = (MailFilteringData *) source;
+	GSList *scans = NULL, *cur;
+
+	if (!config.clamav_enable || mail_filtering_data->msglist == NULL)
+		return FALSE;
+
+	/* results left over by messages other plugins took care of */
+	g_hash_table_remove_all(prescanned);
+
+	debug_print("Scanning %d messages for viruses\n",
+		    g_slist_length(mail_filtering_data->msglist));
+	if (message_callback != NULL)
+		message_callback(_("ClamAV: scanning messages..."));
+
+	for (cur = mail_filtering_data->msglist; cur; cur = cur->next) {
+		struct clamd_msg_scan *scan = msg_scan_new((MsgInfo *) cur->data);
+
+		if (scan != NULL)
+			scans = g_slist_prepend(scans, scan);
+	}
+
+	msg_scans_run(scans);
+
+	/* the results are acted upon message by message */
+	for (cur = scans; cur; cur = cur->next) {
+		struct clamd_msg_scan *scan = (struct clamd_msg_scan *) cur->data;
+
+		g_hash_table_replace(prescanned, scan->msginfo, scan);
+	}
+	g_slist_free(scans);
+
+	return FALSE;
 }
 
 static gboolean mail_filtering_hook(gpointer source, gpointer data)
 {
 	MailFilteringData *mail_filtering_data = (MailFilteringData *) source;
 	MsgInfo *msginfo = mail_filtering_data->msginfo;
-	MimeInfo *mimeinfo;
-
-	struct clamd_result result;
+	struct clamd_msg_scan *scan;
+	GSList *scans;
+	Clamd_Stat status;
 
 	if (!config.clamav_enable)
 		return FALSE;
 
-	mimeinfo = procmime_scan_message(msginfo);
-	if (!mimeinfo) return FALSE;
+	scan = g_hash_table_lookup(prescanned, msginfo);
+	if (scan != NULL) {
+		g_hash_table_steal(prescanned, msginfo);
+	} else {
+		scan = msg_scan_new(msginfo);
+		if (!scan) return FALSE;
 
-	debug_print("Scanning message %d for viruses\n", msginfo->msgnum);
-	if (message_callback != NULL)
-		message_callback(_("ClamAV: scanning message..."));
+		debug_print("Scanning message %d for viruses\n", msginfo->msgnum);
+		if (message_callback != NULL)
+			message_callback(_("ClamAV: scanning message..."));
 
-	g_node_traverse(mimeinfo->node, G_PRE_ORDER, G_TRAVERSE_ALL, -1, scan_func, &result);
-	debug_print("status: %d\n", result.status);
+		scans = g_slist_prepend(NULL, scan);
+		msg_scans_run(scans);
+		g_slist_free(scans);
+	}
+
+	status = msg_scan_status(scan);
+	debug_print("status: %d\n", status);
 
-	if (result.status == VIRUS) {
+	if (status == VIRUS) {
 		if (config.clamav_recv_infected) {
 			FolderItem *clamav_save_folder;
 
@@ -193,9 +372,9 @@ static gboolean mail_filtering_hook(gpointer source, gpointer data)
 		}
 	}
 	
-	procmime_mimeinfo_free_all(&mimeinfo);
+	msg_scan_free(scan);
 
-	return (result.status == OK) ? FALSE : TRUE;
+	return (status == OK) ? FALSE : TRUE;
 }
 
 Clamd_Stat clamd_prepare(void) {
@@ -280,6 +459,15 @@ gint plugin_init(gchar **error)
 		*error = g_strdup(_("Failed to register mail filtering hook"));
 		return -1;
 	}
+	list_hook_id = hooks_register_hook(MAIL_LISTFILTERING_HOOKLIST, mail_listfiltering_hook, NULL);
+	if (list_hook_id == HOOK_NONE) {
+		*error = g_strdup(_("Failed to register mail list filtering hook"));
+		hooks_unregister_hook(MAIL_FILTERING_HOOKLIST, hook_id);
+		return -1;
+	}
+
+	prescanned = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+					   NULL, msg_scan_free);
 
 	prefs_set_default(param);
 	rcpath = g_strconcat(get_rc_dir(), G_DIR_SEPARATOR_S, COMMON_RC, NULL);
@@ -315,6 +503,9 @@ gint plugin_init(gchar **error)
 gboolean plugin_done(void)
 {
 	hooks_unregister_hook(MAIL_FILTERING_HOOKLIST, hook_id);
+	hooks_unregister_hook(MAIL_LISTFILTERING_HOOKLIST, list_hook_id);
+	g_hash_table_destroy(prescanned);
+	prescanned = NULL;
 	g_free(config.clamav_save_folder);
 	clamav_gtk_done();
 	clamd_free();
@@ -55,12 +55,9 @@
 #include "statusbar.h"
 #include "alertpanel.h"
 #include "clamd-plugin.h"
+#include "clamd-session.h"
 #include "file-utils.h"
 
-#ifndef UNIX_PATH_MAX
-#define UNIX_PATH_MAX 108
-#endif
-
 /* needs to be generic */
 static const gchar* config_dirs[] = { 
 	"/etc", 
@@ -283,71 +280,9 @@ Clamd_Socket* clamd_get_socket() {
 }
 
 static int create_socket() {
-	struct sockaddr_un addr_u;
-	struct sockaddr_in addr_i;
-	struct hostent *hp;
-
-	int new_sock = -1;
-
-	/*debug_set_mode(TRUE);*/
-	if (! Socket) {
-		return -1;
-	}
-	memset(&addr_u, 0, sizeof(addr_u));
-	memset(&addr_i, 0, sizeof(addr_i));
-	debug_print("socket->type: %d\n", Socket->type);
-	switch (Socket->type) {
-		case UNIX_SOCKET:
-			debug_print("socket path: %s\n", Socket->socket.path);
-			new_sock = socket(PF_UNIX, SOCK_STREAM, 0);
-			if (new_sock < 0) {
-				perror("create socket");
-				return new_sock;
-			}
-			debug_print("socket file (create): %d\n", new_sock);
-			addr_u.sun_family = AF_UNIX;
-			if (strlen(Socket->socket.path) > UNIX_PATH_MAX) {
-				g_error("socket path longer than %d-char: %s",
-					UNIX_PATH_MAX, Socket->socket.path);
-				new_sock = -2;
-			} else {
-				memcpy(addr_u.sun_path, Socket->socket.path, 
-						strlen(Socket->socket.path));
-				if (connect(new_sock, (struct sockaddr *) &addr_u, sizeof(addr_u)) < 0) {
-					perror("connect socket");
-					close(new_sock);
-					new_sock = -2;
-				}
-			}
-			debug_print("socket file (connect): %d\n", new_sock);
-			break;
-		case INET_SOCKET:
-			addr_i.sin_family = AF_INET;
-			addr_i.sin_port = htons(Socket->socket.port);
-			hp = gethostbyname(Socket->socket.host);
-			if (!hp) {
-				g_error("fail to get host by: %s", Socket->socket.host);
-				return new_sock;
-			}
-			debug_print("IP socket host: %s:%d\n",
-					Socket->socket.host, Socket->socket.port);
-			bcopy((void *)hp->h_addr, (void *)&addr_i.sin_addr, hp->h_length);
-			new_sock = socket(PF_INET, SOCK_STREAM, 0);
-			if (new_sock < 0) {
-				perror("create socket");
-				return new_sock;
-			}
-			debug_print("IP socket (create): %d\n", new_sock);
-			if (connect(new_sock, (struct sockaddr *)&addr_i, sizeof(addr_i)) < 0) {
-				perror("connect socket");
-				close(new_sock);
-				new_sock = -2;
-			}
-			debug_print("IP socket (connect): %d\n", new_sock);
-			break;
-	}
-
-	return new_sock;
+	if (Socket)
+		debug_print("socket->type: %d\n", Socket->type);
+	return clamd_socket_connect(Socket);
 }
 
 static void copy_socket(Clamd_Socket* sock) {
@@ -650,6 +585,7 @@ gchar* clamd_get_virus_name(gchar* msg) {
 }
 
 void clamd_free() {
+	clamd_session_pool_free();
 	if (Socket) {
 		switch (Socket->type) {
 		    case UNIX_SOCKET:
@@ -0,0 +1,407 @@
+/* vim: set textwidth=80 tabstop=4: */
+
+/*
+ * Claws Mail -- a GTK+ based, lightweight, and fast e-mail client
+ * Copyright (C) 2026 Michael Rasmussen and the Claws Mail Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+#include <glib.h>
+#include <glib/gi18n.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <errno.h>
+
+#include "utils.h"
+#include "clamd-session.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/* clamd closes sessions idle for IdleTimeout (30s by default) */
+#define SESSION_IDLE_USEC (20 * G_USEC_PER_SEC)
+
+/* the largest chunk sent at once inside INSTREAM */
+#define SESSION_CHUNK_MAX (64 * 1024)
+
+static const gchar idsession[] = "zIDSESSION";
+static const gchar end[] = "zEND";
+static const gchar instream[] = "zINSTREAM";
+
+typedef struct _Clamd_Session Clamd_Session;
+struct _Clamd_Session {
+	int			sock;
+	gchar*		target;
+	/* id of the last command sent inside the session */
+	guint		id;
+	gint64		last_used;
+	gboolean	failed;
+};
+
+/* idle sessions, most recently used first */
+static GSList* pool = NULL;
+G_LOCK_DEFINE_STATIC(pool);
+
+int clamd_socket_connect(const Clamd_Socket* sock) {
+	struct sockaddr_un addr_u;
+	struct addrinfo hints, *ai, *cur;
+	gchar* port;
+	int new_sock = -1;
+	int r;
+
+	if (! sock) {
+		return -1;
+	}
+	switch (sock->type) {
+		case UNIX_SOCKET:
+			debug_print("socket path: %s\n", sock->socket.path);
+			new_sock = socket(PF_UNIX, SOCK_STREAM, 0);
+			if (new_sock < 0) {
+				perror("create socket");
+				return new_sock;
+			}
+			memset(&addr_u, 0, sizeof(addr_u));
+			addr_u.sun_family = AF_UNIX;
+			if (strlen(sock->socket.path) >= sizeof(addr_u.sun_path)) {
+				g_warning("socket path longer than %d-char: %s",
+					(int) sizeof(addr_u.sun_path) - 1, sock->socket.path);
+				close(new_sock);
+				return -2;
+			}
+			memcpy(addr_u.sun_path, sock->socket.path,
+					strlen(sock->socket.path));
+			if (connect(new_sock, (struct sockaddr *) &addr_u, sizeof(addr_u)) < 0) {
+				perror("connect socket");
+				close(new_sock);
+				new_sock = -2;
+			}
+			debug_print("socket file (connect): %d\n", new_sock);
+			break;
+		case INET_SOCKET:
+			/* getaddrinfo() rather than gethostbyname(): scans
+			 * connect from several threads */
+			memset(&hints, 0, sizeof(hints));
+			hints.ai_family = AF_UNSPEC;
+			hints.ai_socktype = SOCK_STREAM;
+			port = g_strdup_printf("%d", sock->socket.port);
+			r = getaddrinfo(sock->socket.host, port, &hints, &ai);
+			g_free(port);
+			if (r != 0) {
+				g_warning("fail to get host by: %s: %s",
+					sock->socket.host, gai_strerror(r));
+				return -1;
+			}
+			debug_print("IP socket host: %s:%d\n",
+					sock->socket.host, sock->socket.port);
+			new_sock = -2;
+			for (cur = ai; cur != NULL; cur = cur->ai_next) {
+				int s = socket(cur->ai_family, cur->ai_socktype,
+						cur->ai_protocol);
+				if (s < 0)
+					continue;
+				if (connect(s, cur->ai_addr, cur->ai_addrlen) == 0) {
+					new_sock = s;
+					break;
+				}
+				close(s);
+			}
+			freeaddrinfo(ai);
+			if (new_sock < 0)
+				perror("connect socket");
+			debug_print("IP socket (connect): %d\n", new_sock);
+			break;
+	}
+
+	return new_sock;
+}
+
+static gchar* socket_target(const Clamd_Socket* sock) {
+	if (sock->type == UNIX_SOCKET)
+		return g_strdup(sock->socket.path);
+	return g_strdup_printf("%s:%d", sock->socket.host, sock->socket.port);
+}
+
+static gboolean session_send(Clamd_Session* session,
+		const void* data, gsize len) {
+	const gchar* p = data;
+	ssize_t n;
+
+	while (len > 0) {
+		n = send(session->sock, p, len, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0) {
+			debug_print("clamd session: write error %d\n", errno);
+			session->failed = TRUE;
+			return FALSE;
+		}
+		p += n;
+		len -= n;
+	}
+	return TRUE;
+}
+
+static Clamd_Session* session_open(const Clamd_Socket* sock, gchar* target) {
+	Clamd_Session* session;
+	int fd;
+
+	fd = clamd_socket_connect(sock);
+	if (fd < 0) {
+		g_free(target);
+		return NULL;
+	}
+
+	session = g_new0(Clamd_Session, 1);
+	session->sock = fd;
+	session->target = target;
+	if (! session_send(session, idsession, sizeof(idsession))) {
+		close(fd);
+		g_free(session->target);
+		g_free(session);
+		return NULL;
+	}
+	debug_print("clamd session opened to %s\n", target);
+
+	return session;
+}
+
+static void session_close(Clamd_Session* session) {
+	if (! session->failed)
+		session_send(session, end, sizeof(end));
+	close(session->sock);
+	debug_print("clamd session to %s closed after %u commands\n",
+			session->target, session->id);
+	g_free(session->target);
+	g_free(session);
+}
+
+/* returns a pooled session to target, or NULL if there is none */
+static Clamd_Session* session_get_pooled(const gchar* target) {
+	Clamd_Session* session = NULL;
+	GSList* stale = NULL;
+	GSList* cur;
+	gint64 now = g_get_monotonic_time();
+
+	G_LOCK(pool);
+	while (pool != NULL && session == NULL) {
+		Clamd_Session* s = (Clamd_Session *) pool->data;
+
+		pool = g_slist_delete_link(pool, pool);
+		if (strcmp(s->target, target) != 0 ||
+				now - s->last_used > SESSION_IDLE_USEC)
+			stale = g_slist_prepend(stale, s);
+		else
+			session = s;
+	}
+	G_UNLOCK(pool);
+
+	for (cur = stale; cur != NULL; cur = cur->next)
+		session_close((Clamd_Session *) cur->data);
+	g_slist_free(stale);
+
+	return session;
+}
+
+static void session_put(Clamd_Session* session) {
+	session->last_used = g_get_monotonic_time();
+
+	G_LOCK(pool);
+	if (g_slist_length(pool) < CLAMD_SESSION_POOL_MAX) {
+		pool = g_slist_prepend(pool, session);
+		session = NULL;
+	}
+	G_UNLOCK(pool);
+
+	if (session)
+		session_close(session);
+}
+
+static gboolean session_write_chunk(const gchar* data, gsize len,
+		gpointer stream) {
+	Clamd_Session* session = (Clamd_Session *) stream;
+	guint32 chunk;
+	gsize n;
+
+	while (len > 0) {
+		n = MIN(len, SESSION_CHUNK_MAX);
+		chunk = htonl(n);
+		if (! session_send(session, &chunk, 4) ||
+				! session_send(session, data, n))
+			return FALSE;
+		data += n;
+		len -= n;
+	}
+	return TRUE;
+}
+
+/* reads one NUL terminated reply and strips its "<id>: " prefix */
+static gchar* session_read_reply(Clamd_Session* session) {
+	GString* reply = g_string_new(NULL);
+	gchar buf[BUFSIZ];
+	gchar* nul = NULL;
+	gchar* p;
+	ssize_t n;
+	guint id;
+
+	while (nul == NULL) {
+		n = recv(session->sock, buf, sizeof(buf), 0);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0) {
+			debug_print("clamd session: read error %d\n", n < 0 ? errno : 0);
+			session->failed = TRUE;
+			g_string_free(reply, TRUE);
+			return NULL;
+		}
+		/* clamd answers one command at a time, nothing follows */
+		nul = memchr(buf, '\0', n);
+		g_string_append_len(reply, buf, nul ? nul - buf : n);
+	}
+
+	id = (guint) strtoul(reply->str, &p, 10);
+	if (p == reply->str || id != session->id || strncmp(p, ": ", 2) != 0) {
+		g_warning("unexpected reply from clamd: %s", reply->str);
+		session->failed = TRUE;
+		g_string_free(reply, TRUE);
+		return NULL;
+	}
+	g_string_erase(reply, 0, p + 2 - reply->str);
+	g_strchomp(reply->str);
+
+	return g_string_free(reply, FALSE);
+}
+
+static Clamd_Stat session_instream(Clamd_Session* session, Clamd_Feed_Func feed,
+		gpointer data, response* result) {
+	gboolean fed;
+	guint32 chunk = 0;
+	gchar* reply;
+	Clamd_Stat stat;
+
+	session->id++;
+	debug_print("clamd session: command %u: %s\n", session->id, instream);
+	if (! session_send(session, instream, sizeof(instream)))
+		return NO_CONNECTION;
+
+	fed = feed(session_write_chunk, session, data);
+	if (session->failed)
+		return NO_CONNECTION;
+
+	/* the stream has to be terminated even if feeding it failed */
+	if (! session_send(session, &chunk, 4))
+		return NO_CONNECTION;
+
+	reply = session_read_reply(session);
+	if (reply == NULL)
+		return NO_CONNECTION;
+	debug_print("clamd session: reply %u: %s\n", session->id, reply);
+
+	if (! fed) {
+		result->msg = g_strconcat("ERROR -> ", _("Unable to read part"), NULL);
+		g_free(reply);
+		return SCAN_ERROR;
+	}
+
+	if (strstr(reply, "ERROR")) {
+		/* clamd ends the session after errors such as size limits */
+		session->failed = TRUE;
+		stat = SCAN_ERROR;
+		result->msg = reply;
+	}
+	else if (strstr(reply, "FOUND")) {
+		stat = VIRUS;
+		result->msg = reply;
+	}
+	else {
+		stat = OK;
+		result->msg = NULL;
+		g_free(reply);
+	}
+
+	return stat;
+}
+
+Clamd_Stat clamd_session_scan(const Clamd_Socket* sock, Clamd_Feed_Func feed,
+		gpointer data, response* result) {
+	Clamd_Session* session;
+	Clamd_Stat stat;
+	gchar* target;
+	gboolean pooled;
+
+	if (! result || ! feed)
+		return SCAN_ERROR;
+	result->msg = NULL;
+	if (! sock)
+		return NO_SOCKET;
+
+	target = socket_target(sock);
+	session = session_get_pooled(target);
+	pooled = (session != NULL);
+	if (! session)
+		session = session_open(sock, g_strdup(target));
+
+	while (session) {
+		stat = session_instream(session, feed, data, result);
+		if (session->failed) {
+			session_close(session);
+			session = NULL;
+		}
+		else
+			session_put(session);
+
+		/* a pooled session may have been closed by clamd meanwhile */
+		if (stat == NO_CONNECTION && pooled) {
+			debug_print("clamd session: retrying with a new session\n");
+			pooled = FALSE;
+			session = session_open(sock, g_strdup(target));
+			continue;
+		}
+
+		g_free(target);
+		return stat;
+	}
+
+	g_free(target);
+	return NO_CONNECTION;
+}
+
+void clamd_session_pool_free() {
+	GSList* sessions;
+	GSList* cur;
+
+	G_LOCK(pool);
+	sessions = pool;
+	pool = NULL;
+	G_UNLOCK(pool);
+
+	for (cur = sessions; cur != NULL; cur = cur->next)
+		session_close((Clamd_Session *) cur->data);
+	g_slist_free(sessions);
+}
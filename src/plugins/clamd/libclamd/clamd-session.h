@@ -0,0 +1,78 @@
+/* vim: set textwidth=80 tabstop=4: */
+
+/*
+ * Claws Mail -- a GTK+ based, lightweight, and fast e-mail client
+ * Copyright (C) 2026 Michael Rasmussen and the Claws Mail Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __CLAMD_SESSION_H__
+#define __CLAMD_SESSION_H__
+
+#include <glib.h>
+
+#include "clamd-plugin.h"
+
+/**
+ * Maximum number of idle sessions kept open to clamd. This is also
+ * the number of scans the plugin runs concurrently.
+ */
+#define CLAMD_SESSION_POOL_MAX 4
+
+/**
+ * Function sending a chunk of data to clamd.
+ * @return <b>FALSE</b> if the chunk could not be sent.
+ */
+typedef gboolean (*Clamd_Write_Func) (const gchar* data, gsize len,
+		gpointer stream);
+
+/**
+ * Function producing the data to scan by calling write_func for every chunk.
+ * It may be called a second time if a pooled session turned out to be
+ * closed by clamd.
+ * @return <b>FALSE</b> if the data could not be read.
+ */
+typedef gboolean (*Clamd_Feed_Func) (Clamd_Write_Func write_func, gpointer stream,
+		gpointer data);
+
+/**
+ * Function to open a new connection to clamd.
+ * @param sock The socket to connect to.
+ * @return the connected socket, -2 if the connection failed and -1 if
+ * no socket could be created.
+ */
+int clamd_socket_connect(const Clamd_Socket* sock);
+
+/**
+ * Function which streams data to clamd with INSTREAM inside an
+ * IDSESSION. Sessions are taken from a pool and put back after the
+ * scan, so several scans may run concurrently from different threads.
+ * @param sock The socket to connect to.
+ * @param feed Function producing the data.
+ * @param data User data passed to feed.
+ * @param result Set to the reply of clamd if a virus or an error was
+ * found, <b>NULL</b> otherwise.
+ * @return Clamd_Stat. @see _Clamd_Stat.
+ */
+Clamd_Stat clamd_session_scan(const Clamd_Socket* sock, Clamd_Feed_Func feed,
+		gpointer data, response* result);
+
+/**
+ * Function which closes all idle sessions.
+ */
+void clamd_session_pool_free();
+
+#endif
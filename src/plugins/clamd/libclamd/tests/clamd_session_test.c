@@ -0,0 +1,353 @@
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <arpa/inet.h>
+
+#include "mock_debug_print.h"
+
+#include "clamd-session.h"
+
+#define EICAR "EICAR-STANDARD-ANTIVIRUS-TEST-FILE"
+
+/* A fake clamd serving IDSESSION and INSTREAM on a unix socket */
+typedef struct {
+	gchar *dir;
+	gchar *path;
+	int listen_fd;
+	GThread *thread;
+	GSList *connection_threads;
+	gint connections;
+	/* close the connection after every reply, like an idle timeout */
+	gboolean hang_up;
+} FakeClamd;
+
+static gboolean
+read_all(int fd, gpointer buf, gsize len)
+{
+	gchar *p = buf;
+	ssize_t n;
+
+	while (len > 0) {
+		n = read(fd, p, len);
+		if (n <= 0)
+			return FALSE;
+		p += n;
+		len -= n;
+	}
+	return TRUE;
+}
+
+static gchar *
+read_command(int fd)
+{
+	GString *cmd = g_string_new(NULL);
+	gchar c;
+
+	while (read(fd, &c, 1) == 1) {
+		if (c == '\0')
+			return g_string_free(cmd, FALSE);
+		g_string_append_c(cmd, c);
+	}
+	g_string_free(cmd, TRUE);
+	return NULL;
+}
+
+typedef struct {
+	FakeClamd *fake;
+	int fd;
+} Connection;
+
+static gpointer
+serve_connection(gpointer data)
+{
+	Connection *conn = (Connection *)data;
+	FakeClamd *fake = conn->fake;
+	int fd = conn->fd;
+	gchar *cmd;
+	guint id = 0;
+
+	cmd = read_command(fd);
+	g_assert_cmpstr(cmd, ==, "zIDSESSION");
+	g_free(cmd);
+
+	while ((cmd = read_command(fd)) != NULL) {
+		GString *data;
+		guint32 len;
+		gchar *reply;
+
+		if (strcmp(cmd, "zEND") == 0) {
+			g_free(cmd);
+			break;
+		}
+		g_assert_cmpstr(cmd, ==, "zINSTREAM");
+		g_free(cmd);
+
+		data = g_string_new(NULL);
+		while (read_all(fd, &len, 4) && (len = ntohl(len)) > 0) {
+			gchar *chunk = g_malloc(len);
+
+			g_assert_true(read_all(fd, chunk, len));
+			g_string_append_len(data, chunk, len);
+			g_free(chunk);
+		}
+
+		if (strstr(data->str, EICAR))
+			reply = g_strdup_printf("%u: stream: Eicar-Test-Signature FOUND", ++id);
+		else
+			reply = g_strdup_printf("%u: stream: OK", ++id);
+		g_assert_cmpint(write(fd, reply, strlen(reply) + 1), ==, strlen(reply) + 1);
+		g_free(reply);
+		g_string_free(data, TRUE);
+
+		if (fake->hang_up)
+			break;
+	}
+	close(fd);
+	g_free(conn);
+	return NULL;
+}
+
+static gpointer
+fake_clamd_thread(gpointer data)
+{
+	FakeClamd *fake = (FakeClamd *)data;
+	int fd;
+
+	/* one thread per connection, sessions stay open between scans */
+	while ((fd = accept(fake->listen_fd, NULL, NULL)) >= 0) {
+		Connection *conn = g_new0(Connection, 1);
+
+		conn->fake = fake;
+		conn->fd = fd;
+		g_atomic_int_inc(&fake->connections);
+		fake->connection_threads = g_slist_prepend(fake->connection_threads,
+				g_thread_new("fake-clamd-connection", serve_connection, conn));
+	}
+	return NULL;
+}
+
+static FakeClamd *
+fake_clamd_new(gboolean hang_up)
+{
+	FakeClamd *fake = g_new0(FakeClamd, 1);
+	struct sockaddr_un addr;
+
+	fake->dir = g_dir_make_tmp("clamd_test_XXXXXX", NULL);
+	g_assert_nonnull(fake->dir);
+	fake->path = g_build_filename(fake->dir, "clamd.sock", NULL);
+	fake->hang_up = hang_up;
+
+	fake->listen_fd = socket(PF_UNIX, SOCK_STREAM, 0);
+	g_assert_cmpint(fake->listen_fd, >=, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	g_strlcpy(addr.sun_path, fake->path, sizeof(addr.sun_path));
+	g_assert_cmpint(bind(fake->listen_fd, (struct sockaddr *)&addr, sizeof(addr)), ==, 0);
+	g_assert_cmpint(listen(fake->listen_fd, 16), ==, 0);
+
+	fake->thread = g_thread_new("fake-clamd", fake_clamd_thread, fake);
+
+	return fake;
+}
+
+static void
+fake_clamd_free(FakeClamd *fake)
+{
+	clamd_session_pool_free();
+	shutdown(fake->listen_fd, SHUT_RDWR);
+	close(fake->listen_fd);
+	g_thread_join(fake->thread);
+	g_slist_free_full(fake->connection_threads, (GDestroyNotify)g_thread_join);
+	g_unlink(fake->path);
+	g_rmdir(fake->dir);
+	g_free(fake->path);
+	g_free(fake->dir);
+	g_free(fake);
+}
+
+static Clamd_Socket *
+fake_clamd_socket(FakeClamd *fake)
+{
+	Clamd_Socket *sock = g_new0(Clamd_Socket, 1);
+
+	sock->type = UNIX_SOCKET;
+	sock->socket.path = fake->path;
+	return sock;
+}
+
+/* sends data in small chunks, like procmime does */
+static gboolean
+feed_string(Clamd_Write_Func write_func, gpointer stream, gpointer data)
+{
+	const gchar *str = (const gchar *)data;
+	gsize len = strlen(str);
+
+	while (len > 0) {
+		gsize n = MIN(len, 7);
+
+		if (!write_func(str, n, stream))
+			return FALSE;
+		str += n;
+		len -= n;
+	}
+	return TRUE;
+}
+
+static gboolean
+feed_fail(Clamd_Write_Func write_func, gpointer stream, gpointer data)
+{
+	return write_func("partial", 7, stream) && FALSE;
+}
+
+static void
+test_clamd_session_clean(void)
+{
+	FakeClamd *fake = fake_clamd_new(FALSE);
+	Clamd_Socket *sock = fake_clamd_socket(fake);
+	response result;
+
+	g_assert_cmpint(clamd_session_scan(sock, feed_string,
+			"just a regular message", &result), ==, OK);
+	g_assert_null(result.msg);
+
+	g_free(sock);
+	fake_clamd_free(fake);
+}
+
+static void
+test_clamd_session_virus(void)
+{
+	FakeClamd *fake = fake_clamd_new(FALSE);
+	Clamd_Socket *sock = fake_clamd_socket(fake);
+	response result;
+
+	g_assert_cmpint(clamd_session_scan(sock, feed_string,
+			"X5O!P%@AP " EICAR "!$H+H*", &result), ==, VIRUS);
+	g_assert_cmpstr(result.msg, ==, "stream: Eicar-Test-Signature FOUND");
+	g_free(result.msg);
+
+	g_free(sock);
+	fake_clamd_free(fake);
+}
+
+static void
+test_clamd_session_reuse(void)
+{
+	FakeClamd *fake = fake_clamd_new(FALSE);
+	Clamd_Socket *sock = fake_clamd_socket(fake);
+	response result;
+	gint i;
+
+	for (i = 0; i < 5; i++) {
+		g_assert_cmpint(clamd_session_scan(sock, feed_string,
+				"message", &result), ==, OK);
+	}
+	g_assert_cmpint(g_atomic_int_get(&fake->connections), ==, 1);
+
+	g_free(sock);
+	fake_clamd_free(fake);
+}
+
+static void
+test_clamd_session_feed_error(void)
+{
+	FakeClamd *fake = fake_clamd_new(FALSE);
+	Clamd_Socket *sock = fake_clamd_socket(fake);
+	response result;
+
+	g_assert_cmpint(clamd_session_scan(sock, feed_fail, NULL, &result),
+			==, SCAN_ERROR);
+	g_assert_nonnull(result.msg);
+	g_free(result.msg);
+
+	/* the stream was terminated, the session is still usable */
+	g_assert_cmpint(clamd_session_scan(sock, feed_string, "message", &result),
+			==, OK);
+	g_assert_cmpint(g_atomic_int_get(&fake->connections), ==, 1);
+
+	g_free(sock);
+	fake_clamd_free(fake);
+}
+
+static void
+test_clamd_session_reconnect(void)
+{
+	FakeClamd *fake = fake_clamd_new(TRUE);
+	Clamd_Socket *sock = fake_clamd_socket(fake);
+	response result;
+
+	g_assert_cmpint(clamd_session_scan(sock, feed_string, "first", &result),
+			==, OK);
+	/* the pooled session was closed by the server */
+	g_assert_cmpint(clamd_session_scan(sock, feed_string, "second", &result),
+			==, OK);
+	g_assert_cmpint(g_atomic_int_get(&fake->connections), ==, 2);
+
+	g_free(sock);
+	fake_clamd_free(fake);
+}
+
+static gpointer
+scan_thread(gpointer data)
+{
+	Clamd_Socket *sock = (Clamd_Socket *)data;
+	response result;
+	gint i;
+
+	for (i = 0; i < 10; i++) {
+		if (clamd_session_scan(sock, feed_string, EICAR, &result) != VIRUS)
+			return GINT_TO_POINTER(FALSE);
+		g_free(result.msg);
+	}
+	return GINT_TO_POINTER(TRUE);
+}
+
+static void
+test_clamd_session_no_server(void)
+{
+	Clamd_Socket sock;
+	response result;
+
+	sock.type = UNIX_SOCKET;
+	sock.socket.path = "/nonexistent/clamd.sock";
+	g_assert_cmpint(clamd_session_scan(&sock, feed_string, "message", &result),
+			==, NO_CONNECTION);
+	g_assert_null(result.msg);
+}
+
+static void
+test_clamd_session_concurrent(void)
+{
+	FakeClamd *fake = fake_clamd_new(FALSE);
+	Clamd_Socket *sock = fake_clamd_socket(fake);
+	GThread *threads[CLAMD_SESSION_POOL_MAX];
+	gint i;
+
+	for (i = 0; i < CLAMD_SESSION_POOL_MAX; i++)
+		threads[i] = g_thread_new("scan", scan_thread, sock);
+	for (i = 0; i < CLAMD_SESSION_POOL_MAX; i++)
+		g_assert_true(GPOINTER_TO_INT(g_thread_join(threads[i])));
+
+	g_free(sock);
+	fake_clamd_free(fake);
+}
+
+int
+main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/clamd/session/clean", test_clamd_session_clean);
+	g_test_add_func("/clamd/session/virus", test_clamd_session_virus);
+	g_test_add_func("/clamd/session/reuse", test_clamd_session_reuse);
+	g_test_add_func("/clamd/session/feed_error", test_clamd_session_feed_error);
+	g_test_add_func("/clamd/session/reconnect", test_clamd_session_reconnect);
+	g_test_add_func("/clamd/session/no_server", test_clamd_session_no_server);
+	g_test_add_func("/clamd/session/concurrent", test_clamd_session_concurrent);
+
+	return g_test_run();
+}
@@ -21,6 +21,7 @@
 #endif
 
 #include "container_linux.h"
+#include "http_fetcher.h"
 
 #include <cairo-ft.h>
 
@@ -36,10 +37,12 @@ container_linux::container_linux(void)
 	m_temp_surface	= cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 2, 2);
 	m_temp_cr		= cairo_create(m_temp_surface);
 	g_rec_mutex_init(&m_images_lock);
+	m_dpi = gdk_screen_get_resolution(gdk_screen_get_default());
 }
 
 container_linux::~container_linux(void)
 {
+	http_fetcher_cancel(this);
 	clear_images();
 	cairo_surface_destroy(m_temp_surface);
 	cairo_destroy(m_temp_cr);
@@ -48,10 +51,7 @@ container_linux::~container_linux(void)
 
 int container_linux::pt_to_px( int pt )
 {
-	GdkScreen* screen = gdk_screen_get_default();
-	double dpi = gdk_screen_get_resolution(screen);
-
-	return (int) ((double) pt * dpi / 72.0);
+	return (int) ((double) pt * m_dpi / 72.0);
 }
 
 void container_linux::draw_list_marker( litehtml::uint_ptr hdc, const litehtml::list_marker& marker )
@@ -63,6 +63,9 @@ protected:
 	images_map					m_images;
 	GRecMutex					m_images_lock;
 	cairo_clip_box::vector				m_clips;
+	/* screen resolution, read once as layouts may be computed
+	 * outside of the main thread */
+	double						m_dpi;
 
 public:
 	container_linux(void);
@@ -23,70 +23,18 @@
 #include "common/utils.h"
 
 #include "container_linux.h"
-#include "http.h"
+#include "http_fetcher.h"
 #include "lh_prefs.h"
 
-static GdkPixbuf *lh_get_image(const litehtml::tchar_t* url)
+static void get_image_callback(const gchar *url, GdkPixbuf *pixbuf,
+		gpointer user_data)
 {
-	GError *error = NULL;
-	GdkPixbuf *pixbuf = NULL;
-	http* http_loader = NULL;
-
-	http_loader = new http();
-	GInputStream *image = http_loader->load_url(url, &error);
-
-	if (error || !image) {
-		if (error) {
-			g_warning("lh_get_image: Could not create pixbuf %s",
-					error->message);
-			g_clear_error(&error);
-		}
-		goto theend;
-	}
-
-	pixbuf = gdk_pixbuf_new_from_stream(image, NULL, &error);
-	if (error) {
-		g_warning("lh_get_image: Could not create pixbuf %s",
-				error->message);
-		pixbuf = NULL;
-		g_clear_error(&error);
-	}
-
-theend:
-	if (http_loader) {
-		delete http_loader;
-	}
-
-	return pixbuf;
-}
-
-struct FetchCtx {
-	container_linux *container;
-	gchar *url;
-};
-
-static void get_image_threaded(GTask *task, gpointer source, gpointer task_data, GCancellable *cancellable)
-{
-	struct FetchCtx *ctx = (struct FetchCtx *)task_data;
-	GdkPixbuf *pixbuf = lh_get_image(ctx->url);
-
-	g_task_return_pointer(task, pixbuf, NULL);
-}
-
-static void get_image_callback(GObject *source, GAsyncResult *res, gpointer user_data)
-{
-	GdkPixbuf *pixbuf;
-	struct FetchCtx *ctx = (struct FetchCtx *)user_data;
-
-	pixbuf = GDK_PIXBUF(g_task_propagate_pointer(G_TASK(res), NULL));
+	container_linux *container = (container_linux *)user_data;
 
 	if (pixbuf != NULL) {
-		ctx->container->add_image_to_cache(ctx->url, pixbuf);
-		ctx->container->redraw(true);
+		container->add_image_to_cache(url, pixbuf);
+		container->redraw(true);
 	}
-
-	g_free(ctx->url);
-	g_free(ctx);
 }
 
 void container_linux::load_image( const litehtml::tchar_t* src, const litehtml::tchar_t* baseurl, bool redraw_on_ready )
@@ -109,8 +57,6 @@ void container_linux::load_image( const litehtml::tchar_t* src, const litehtml::
 	unlock_images_cache();
 
 	if (!found) {
-		struct FetchCtx *ctx;
-
 		/* Attached images can be loaded into cache right here. */
 		if (!strncmp(src, "cid:", 4)) {
 			GdkPixbuf *pixbuf = get_local_image(src);
@@ -128,13 +74,7 @@ void container_linux::load_image( const litehtml::tchar_t* src, const litehtml::
 
 		debug_print("allowing download of image from '%s'\n", src);
 
-		ctx = g_new(struct FetchCtx, 1);
-		ctx->url = g_strdup(url.c_str());
-		ctx->container = this;
-
-		GTask *task = g_task_new(this, NULL, get_image_callback, ctx);
-		g_task_set_task_data(task, ctx, NULL);
-		g_task_run_in_thread(task, get_image_threaded);
+		http_fetcher_get_image(url.c_str(), get_image_callback, this);
 	} else {
 		debug_print("found image in cache: '%s'\n", url.c_str());
 	}
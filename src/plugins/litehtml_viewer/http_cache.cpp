@@ -0,0 +1,229 @@
+/*
+ * Claws Mail -- A GTK+ based, lightweight, and fast e-mail client
+ * Copyright(C) 2026 the Claws Mail Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write tothe Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <vector>
+#include <algorithm>
+
+#include "utils.h"
+
+#include "http_cache.h"
+#include "lh_prefs.h"
+
+#define HTTP_CACHE_DIR "litehtml_cache"
+
+/* Each entry is a file named after the SHA1 of its URL:
+ *   <fetch time> <etag or "-">\n
+ *   <data>
+ */
+
+G_LOCK_DEFINE_STATIC(http_cache);
+/* size of the entries on disk, -1 until the directory was scanned */
+static goffset cache_total = -1;
+
+static gchar *cache_dir(void)
+{
+	return g_strconcat(get_rc_dir(), G_DIR_SEPARATOR_S,
+			HTTP_CACHE_DIR, NULL);
+}
+
+static gchar *cache_path(const gchar *url)
+{
+	gchar *dir = cache_dir();
+	gchar *sum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, url, -1);
+	gchar *path = g_strconcat(dir, G_DIR_SEPARATOR_S, sum, NULL);
+
+	g_free(sum);
+	g_free(dir);
+	return path;
+}
+
+static goffset cache_limit(void)
+{
+	return (goffset)lh_prefs_get()->disk_cache_size * 1024 * 1024;
+}
+
+void http_cache_entry_clear(http_cache_entry *entry)
+{
+	g_free(entry->data);
+	g_free(entry->etag);
+	entry->data = NULL;
+	entry->etag = NULL;
+	entry->len = 0;
+}
+
+bool http_cache_lookup(const gchar *url, http_cache_entry *entry)
+{
+	gchar *path, *contents = NULL, *nl, *sp;
+	gsize len;
+	gint64 fetched;
+
+	memset(entry, 0, sizeof(*entry));
+
+	if (cache_limit() <= 0)
+		return false;
+
+	path = cache_path(url);
+	if (!g_file_get_contents(path, &contents, &len, NULL)) {
+		g_free(path);
+		return false;
+	}
+
+	nl = (gchar *)memchr(contents, '\n', len);
+	sp = nl ? (gchar *)memchr(contents, ' ', nl - contents) : NULL;
+	if (sp == NULL) {
+		debug_print("http cache: dropping broken entry for '%s'\n", url);
+		G_LOCK(http_cache);
+		if (g_unlink(path) == 0 && cache_total >= 0)
+			cache_total -= len;
+		G_UNLOCK(http_cache);
+		g_free(contents);
+		g_free(path);
+		return false;
+	}
+	*sp = *nl = '\0';
+
+	fetched = g_ascii_strtoll(contents, NULL, 10);
+	entry->fresh = (time(NULL) - fetched < HTTP_CACHE_FRESH_SECS);
+	if (strcmp(sp + 1, "-"))
+		entry->etag = g_strdup(sp + 1);
+	entry->len = len - (nl + 1 - contents);
+	entry->data = (gchar *)g_memdup(nl + 1, entry->len);
+	g_free(contents);
+
+	/* remember the use for the LRU trimming */
+	g_utime(path, NULL);
+	g_free(path);
+
+	debug_print("http cache: found '%s' (%s)\n", url,
+			entry->fresh ? "fresh" : "stale");
+	return true;
+}
+
+struct cache_file
+{
+	gchar *path;
+	goffset size;
+	time_t mtime;
+};
+
+/* removes the least recently used entries over the size limit and
+ * returns the size of what is left */
+static goffset http_cache_trim(const gchar *dir, goffset limit)
+{
+	std::vector<cache_file> files;
+	const gchar *name;
+	goffset total = 0;
+	GDir *d;
+
+	if ((d = g_dir_open(dir, 0, NULL)) == NULL)
+		return 0;
+
+	while ((name = g_dir_read_name(d)) != NULL) {
+		GStatBuf s;
+		gchar *path = g_strconcat(dir, G_DIR_SEPARATOR_S, name, NULL);
+
+		if (g_stat(path, &s) < 0 || !S_ISREG(s.st_mode)) {
+			g_free(path);
+			continue;
+		}
+		files.push_back({ path, (goffset)s.st_size, s.st_mtime });
+		total += s.st_size;
+	}
+	g_dir_close(d);
+
+	if (total > limit) {
+		std::sort(files.begin(), files.end(),
+				[](const cache_file &a, const cache_file &b) {
+					return a.mtime < b.mtime;
+				});
+		for (auto &f : files) {
+			if (total <= limit)
+				break;
+			if (g_unlink(f.path) == 0)
+				total -= f.size;
+		}
+		debug_print("http cache: trimmed to %" G_GOFFSET_FORMAT " bytes\n",
+				total);
+	}
+
+	for (auto &f : files)
+		g_free(f.path);
+
+	return total;
+}
+
+void http_cache_store(const gchar *url, const gchar *data, gsize len,
+		const gchar *etag)
+{
+	goffset limit = cache_limit();
+	gchar *dir, *path, *header;
+	GByteArray *contents;
+	GStatBuf st;
+
+	if (limit <= 0 || (goffset)len > limit)
+		return;
+
+	dir = cache_dir();
+	if (!is_dir_exist(dir) && make_dir_hier(dir) < 0) {
+		g_free(dir);
+		return;
+	}
+
+	path = cache_path(url);
+	header = g_strdup_printf("%" G_GINT64_FORMAT " %s\n",
+			(gint64)time(NULL), (etag && *etag) ? etag : "-");
+	contents = g_byte_array_sized_new(strlen(header) + len);
+	g_byte_array_append(contents, (const guint8 *)header, strlen(header));
+	g_byte_array_append(contents, (const guint8 *)data, len);
+
+	G_LOCK(http_cache);
+	/* the directory is only scanned once, then the size is kept up to
+	 * date here */
+	if (cache_total < 0)
+		cache_total = http_cache_trim(dir, limit);
+	if (g_stat(path, &st) == 0)
+		cache_total -= st.st_size;
+
+	/* g_file_set_contents() renames a temporary file into place, so
+	 * entries are never seen half-written */
+	if (g_file_set_contents(path, (const gchar *)contents->data,
+				contents->len, NULL))
+		cache_total += contents->len;
+	else
+		debug_print("http cache: couldn't store '%s'\n", url);
+	g_byte_array_free(contents, TRUE);
+
+	if (cache_total > limit)
+		cache_total = http_cache_trim(dir, limit);
+	G_UNLOCK(http_cache);
+
+	g_free(header);
+	g_free(path);
+	g_free(dir);
+}
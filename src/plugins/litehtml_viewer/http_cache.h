@@ -0,0 +1,51 @@
+/*
+ * Claws Mail -- A GTK+ based, lightweight, and fast e-mail client
+ * Copyright(C) 2026 the Claws Mail Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write tothe Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef HTTP_CACHE_H
+#define HTTP_CACHE_H
+
+#include <glib.h>
+
+/* Entries fetched less than this long ago are used without asking
+ * the server. Older ones are revalidated with their ETag. */
+#define HTTP_CACHE_FRESH_SECS (24 * 60 * 60)
+
+/* On-disk cache of downloaded remote resources, keyed by URL.
+ * Entries are files in the cache directory; their modification time
+ * is bumped on every use, and the least recently used ones are
+ * removed when the cache grows over the configured size. */
+struct http_cache_entry
+{
+	gchar *data;
+	gsize len;
+	gchar *etag;
+	/* TRUE if the entry can be used without revalidation */
+	bool fresh;
+};
+
+/* Fills entry and returns true if url is cached. The entry must be
+ * freed with http_cache_entry_clear(). */
+bool http_cache_lookup(const gchar *url, http_cache_entry *entry);
+
+/* Stores (or refreshes) url, then trims the cache if it grew over its
+ * size limit. */
+void http_cache_store(const gchar *url, const gchar *data, gsize len,
+		const gchar *etag);
+
+void http_cache_entry_clear(http_cache_entry *entry);
+
+#endif /* HTTP_CACHE_H */
@@ -0,0 +1,685 @@
+/*
+ * Claws Mail -- A GTK+ based, lightweight, and fast e-mail client
+ * Copyright(C) 2026 the Claws Mail Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write tothe Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <glib.h>
+#include <curl/curl.h>
+
+#include "utils.h"
+
+#include "http_fetcher.h"
+#include "http_cache.h"
+
+/* Transfer timeout, in seconds, from the time it is started. */
+#define HTTP_FETCH_TIMEOUT 10L
+
+/* Threads reading and writing the disk cache and local files. */
+#define HTTP_IO_THREADS 2
+
+struct http_fetch_waiter
+{
+	http_fetch_func func;
+	gpointer data;
+};
+
+struct http_fetch
+{
+	gchar *url;
+	CURL *curl;
+	struct curl_slist *headers;
+	GdkPixbufLoader *loader;
+	/* the loader refused the data */
+	gboolean broken;
+	/* what was received, for the disk cache */
+	GByteArray *body;
+	gchar *etag;
+	http_cache_entry cached;
+	bool have_cached;
+	/* list of http_fetch_waiter */
+	GSList *waiters;
+};
+
+/* Disk work done off the main loop. The fetch is left alone by the
+ * main loop until the job comes back. */
+enum http_io_op
+{
+	/* read a local file or the cached copy */
+	HTTP_IO_START,
+	/* use the cached copy after a 304 or a failure */
+	HTTP_IO_CACHED,
+	/* store what was received; nothing comes back */
+	HTTP_IO_STORE
+};
+
+struct http_io_job
+{
+	http_io_op op;
+	http_fetch *fetch;
+	/* HTTP_IO_CACHED: the server confirmed the cached copy */
+	bool refresh;
+	/* HTTP_IO_STORE */
+	gchar *url;
+	GByteArray *body;
+	gchar *etag;
+	/* HTTP_IO_START: nothing usable was found, fetch it */
+	bool network;
+	GdkPixbuf *pixbuf;
+};
+
+/* A socket curl wants to be told about */
+struct http_socket
+{
+	GIOChannel *channel;
+	guint source_id;
+};
+
+static CURLM *multi = NULL;
+static guint timer_id = 0;
+/* all the transfers, queued or running, by URL */
+static GHashTable *fetches = NULL;
+/* transfers not started yet */
+static GQueue queue = G_QUEUE_INIT;
+static guint active = 0;
+/* list of http_socket */
+static GSList *sockets = NULL;
+/* disk work, and the jobs back from it for the main loop */
+static GThreadPool *io_pool = NULL;
+static GAsyncQueue *io_done = NULL;
+
+static void http_fetcher_start_next(void);
+static void http_fetch_start_network(http_fetch *fetch);
+
+static void http_fetch_free(http_fetch *fetch)
+{
+	if (fetch->curl != NULL)
+		curl_easy_cleanup(fetch->curl);
+	curl_slist_free_all(fetch->headers);
+	if (fetch->loader != NULL) {
+		gdk_pixbuf_loader_close(fetch->loader, NULL);
+		g_object_unref(fetch->loader);
+	}
+	if (fetch->body != NULL)
+		g_byte_array_free(fetch->body, TRUE);
+	g_free(fetch->etag);
+	if (fetch->have_cached)
+		http_cache_entry_clear(&fetch->cached);
+	g_slist_free_full(fetch->waiters, g_free);
+	g_free(fetch->url);
+	g_free(fetch);
+}
+
+static void http_fetch_feed(http_fetch *fetch, const gchar *data, gsize len)
+{
+	if (!fetch->broken && !gdk_pixbuf_loader_write(fetch->loader,
+				(const guchar *)data, len, NULL))
+		fetch->broken = TRUE;
+}
+
+static GdkPixbuf *http_decode(const gchar *data, gsize len)
+{
+	GdkPixbufLoader *loader = gdk_pixbuf_loader_new();
+	GdkPixbuf *pixbuf = NULL;
+	gboolean ok;
+
+	ok = gdk_pixbuf_loader_write(loader, (const guchar *)data, len, NULL);
+	if (gdk_pixbuf_loader_close(loader, NULL) && ok)
+		pixbuf = gdk_pixbuf_loader_get_pixbuf(loader);
+	if (pixbuf != NULL)
+		g_object_ref(pixbuf);
+	g_object_unref(loader);
+
+	return pixbuf;
+}
+
+/* Hands the image (consumed) to the waiters, and forgets the transfer */
+static void http_fetch_deliver(http_fetch *fetch, GdkPixbuf *pixbuf)
+{
+	GSList *cur;
+
+	debug_print("http fetcher: done with '%s' (%s)\n", fetch->url,
+			pixbuf != NULL ? "ok" : "failed");
+
+	g_hash_table_remove(fetches, fetch->url);
+	active--;
+
+	for (cur = fetch->waiters; cur != NULL; cur = cur->next) {
+		http_fetch_waiter *waiter = (http_fetch_waiter *)cur->data;
+
+		waiter->func(fetch->url,
+				pixbuf != NULL ? GDK_PIXBUF(g_object_ref(pixbuf)) : NULL,
+				waiter->data);
+	}
+
+	if (pixbuf != NULL)
+		g_object_unref(pixbuf);
+	http_fetch_free(fetch);
+}
+
+/* Hands over what the loader decoded while it was received */
+static void http_fetch_finish(http_fetch *fetch)
+{
+	GdkPixbuf *pixbuf = NULL;
+
+	if (fetch->loader != NULL) {
+		if (gdk_pixbuf_loader_close(fetch->loader, NULL) && !fetch->broken)
+			pixbuf = gdk_pixbuf_loader_get_pixbuf(fetch->loader);
+		if (pixbuf != NULL)
+			g_object_ref(pixbuf);
+		g_object_unref(fetch->loader);
+		fetch->loader = NULL;
+	}
+
+	http_fetch_deliver(fetch, pixbuf);
+}
+
+static gboolean http_io_done_cb(gpointer data);
+
+static void http_io_job_free(http_io_job *job)
+{
+	g_free(job->url);
+	if (job->body != NULL)
+		g_byte_array_free(job->body, TRUE);
+	g_free(job->etag);
+	if (job->pixbuf != NULL)
+		g_object_unref(job->pixbuf);
+	g_free(job);
+}
+
+/* Local files, and recently fetched resources, don't need the network */
+static void http_io_start(http_io_job *job)
+{
+	http_fetch *fetch = job->fetch;
+	gchar *content, *path;
+	gsize len;
+
+	if (!strncmp(fetch->url, "file:///", 8) ||
+			g_file_test(fetch->url, G_FILE_TEST_EXISTS)) {
+		path = g_filename_from_uri(fetch->url, NULL, NULL);
+		if (g_file_get_contents(path ? path : fetch->url, &content, &len, NULL)) {
+			job->pixbuf = http_decode(content, len);
+			g_free(content);
+		}
+		g_free(path);
+		return;
+	}
+
+	fetch->have_cached = http_cache_lookup(fetch->url, &fetch->cached);
+	if (fetch->have_cached && fetch->cached.fresh)
+		job->pixbuf = http_decode(fetch->cached.data, fetch->cached.len);
+	else
+		job->network = true;
+}
+
+static void http_io_func(gpointer data, gpointer user_data)
+{
+	http_io_job *job = (http_io_job *)data;
+	http_fetch *fetch = job->fetch;
+
+	switch (job->op) {
+	case HTTP_IO_START:
+		http_io_start(job);
+		break;
+	case HTTP_IO_CACHED:
+		if (job->refresh)
+			http_cache_store(fetch->url, fetch->cached.data,
+					fetch->cached.len, fetch->cached.etag);
+		job->pixbuf = http_decode(fetch->cached.data, fetch->cached.len);
+		break;
+	case HTTP_IO_STORE:
+		http_cache_store(job->url, (const gchar *)job->body->data,
+				job->body->len, job->etag);
+		http_io_job_free(job);
+		return;
+	}
+
+	g_async_queue_push(io_done, job);
+	g_idle_add(http_io_done_cb, &io_done);
+}
+
+/* Back in the main loop with what the disk work found */
+static gboolean http_io_done_cb(gpointer data)
+{
+	http_io_job *job;
+
+	while ((job = (http_io_job *)g_async_queue_try_pop(io_done)) != NULL) {
+		http_fetch *fetch = job->fetch;
+
+		if (job->op == HTTP_IO_START && job->network) {
+			http_fetch_start_network(fetch);
+		} else {
+			http_fetch_deliver(fetch, job->pixbuf);
+			job->pixbuf = NULL;
+		}
+		http_io_job_free(job);
+	}
+
+	http_fetcher_start_next();
+
+	return FALSE;
+}
+
+static void http_io_push(http_io_job *job)
+{
+	GError *error = NULL;
+
+	if (io_pool == NULL) {
+		io_pool = g_thread_pool_new(http_io_func, NULL,
+				HTTP_IO_THREADS, FALSE, &error);
+		if (io_pool == NULL) {
+			g_warning("couldn't create the http cache threads: %s",
+					error ? error->message : "unknown error");
+			if (error)
+				g_error_free(error);
+		}
+	}
+
+	/* without threads, block rather than lose the job */
+	if (io_pool != NULL)
+		g_thread_pool_push(io_pool, job, NULL);
+	else
+		http_io_func(job, NULL);
+}
+
+static size_t write_data(char *ptr, size_t size, size_t nmemb, void *data_ptr)
+{
+	http_fetch *fetch = (http_fetch *)data_ptr;
+	size_t realsize = size * nmemb;
+	long code = 0;
+
+	/* Error pages are no use, and a 304 means the cached copy is */
+	curl_easy_getinfo(fetch->curl, CURLINFO_RESPONSE_CODE, &code);
+	if (code != 200)
+		return realsize;
+
+	g_byte_array_append(fetch->body, (const guint8 *)ptr, realsize);
+	http_fetch_feed(fetch, ptr, realsize);
+
+	return realsize;
+}
+
+static size_t write_header(char *ptr, size_t size, size_t nmemb, void *data_ptr)
+{
+	http_fetch *fetch = (http_fetch *)data_ptr;
+	size_t realsize = size * nmemb;
+
+	/* only the headers of the last response count after redirects */
+	if (realsize > 5 && !g_ascii_strncasecmp(ptr, "HTTP/", 5)) {
+		g_free(fetch->etag);
+		fetch->etag = NULL;
+	} else if (realsize > 5 && !g_ascii_strncasecmp(ptr, "ETag:", 5)) {
+		g_free(fetch->etag);
+		fetch->etag = g_strstrip(g_strndup(ptr + 5, realsize - 5));
+	}
+
+	return realsize;
+}
+
+/* Called once curl is done with a transfer */
+static void http_fetch_done(http_fetch *fetch, CURLcode res)
+{
+	long code = 0;
+
+	if (res == CURLE_OK)
+		curl_easy_getinfo(fetch->curl, CURLINFO_RESPONSE_CODE, &code);
+
+	if (fetch->have_cached && (code == 304 || res != CURLE_OK)) {
+		http_io_job *job = g_new0(http_io_job, 1);
+
+		/* still valid, or better than nothing; part of a failed
+		 * transfer may have been fed, decode the copy on its own */
+		debug_print("http fetcher: using cached copy of '%s' (%ld)\n",
+				fetch->url, code);
+		job->op = HTTP_IO_CACHED;
+		job->fetch = fetch;
+		job->refresh = (code == 304);
+		http_io_push(job);
+		return;
+	} else if (res != CURLE_OK) {
+		debug_print("http fetcher: couldn't get '%s': %s\n", fetch->url,
+				curl_easy_strerror(res));
+		fetch->broken = TRUE;
+	} else if (code == 200) {
+		http_io_job *job = g_new0(http_io_job, 1);
+
+		job->op = HTTP_IO_STORE;
+		job->url = g_strdup(fetch->url);
+		job->body = fetch->body;
+		job->etag = g_strdup(fetch->etag);
+		fetch->body = NULL;
+		http_io_push(job);
+	} else {
+		debug_print("http fetcher: got %ld for '%s'\n", code, fetch->url);
+		fetch->broken = TRUE;
+	}
+
+	http_fetch_finish(fetch);
+}
+
+static void http_fetcher_check_done(void)
+{
+	CURLMsg *msg;
+	http_fetch *fetch;
+	gint left;
+
+	while ((msg = curl_multi_info_read(multi, &left)) != NULL) {
+		if (msg->msg != CURLMSG_DONE)
+			continue;
+
+		curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE,
+				(char **)&fetch);
+		curl_multi_remove_handle(multi, fetch->curl);
+
+		http_fetch_done(fetch, msg->data.result);
+	}
+
+	http_fetcher_start_next();
+}
+
+static gboolean timeout_cb(gpointer data)
+{
+	gint running;
+
+	/* curl may set a new timer from here */
+	timer_id = 0;
+	curl_multi_socket_action(multi, CURL_SOCKET_TIMEOUT, 0, &running);
+	http_fetcher_check_done();
+
+	return FALSE;
+}
+
+static int timer_func(CURLM *m, long timeout_ms, void *userp)
+{
+	if (timer_id != 0) {
+		g_source_remove(timer_id);
+		timer_id = 0;
+	}
+
+	if (timeout_ms >= 0)
+		timer_id = g_timeout_add(timeout_ms, timeout_cb, NULL);
+
+	return 0;
+}
+
+static gboolean socket_event_cb(GIOChannel *channel, GIOCondition cond,
+		gpointer data)
+{
+	curl_socket_t s = GPOINTER_TO_INT(data);
+	gint action = 0, running;
+
+	/* let curl read the end of the stream on hangups */
+	if (cond & (G_IO_IN | G_IO_HUP))
+		action |= CURL_CSELECT_IN;
+	if (cond & G_IO_OUT)
+		action |= CURL_CSELECT_OUT;
+	if (cond & G_IO_ERR)
+		action |= CURL_CSELECT_ERR;
+
+	curl_multi_socket_action(multi, s, action, &running);
+	http_fetcher_check_done();
+
+	/* socket_func() removes the watch when it is no longer needed */
+	return TRUE;
+}
+
+static void http_socket_free(gpointer data)
+{
+	http_socket *sock = (http_socket *)data;
+
+	g_source_remove(sock->source_id);
+	g_io_channel_unref(sock->channel);
+	g_free(sock);
+}
+
+static int socket_func(CURL *easy, curl_socket_t s, int what, void *userp,
+		void *socketp)
+{
+	http_socket *sock = (http_socket *)socketp;
+	GIOCondition cond = (GIOCondition)0;
+
+	if (what == CURL_POLL_REMOVE) {
+		if (sock != NULL) {
+			sockets = g_slist_remove(sockets, sock);
+			http_socket_free(sock);
+		}
+		return 0;
+	}
+
+	if (sock == NULL) {
+		sock = g_new0(http_socket, 1);
+#ifdef G_OS_WIN32
+		sock->channel = g_io_channel_win32_new_socket(s);
+#else
+		sock->channel = g_io_channel_unix_new(s);
+#endif
+		curl_multi_assign(multi, s, sock);
+		sockets = g_slist_prepend(sockets, sock);
+	} else {
+		g_source_remove(sock->source_id);
+	}
+
+	if (what & CURL_POLL_IN)
+		cond = (GIOCondition)(cond | G_IO_IN | G_IO_HUP | G_IO_ERR);
+	if (what & CURL_POLL_OUT)
+		cond = (GIOCondition)(cond | G_IO_OUT | G_IO_ERR);
+
+	sock->source_id = g_io_add_watch(sock->channel, cond,
+			socket_event_cb, GINT_TO_POINTER(s));
+
+	return 0;
+}
+
+static void http_fetcher_init(void)
+{
+	if (multi != NULL)
+		return;
+
+	multi = curl_multi_init();
+	curl_multi_setopt(multi, CURLMOPT_SOCKETFUNCTION, socket_func);
+	curl_multi_setopt(multi, CURLMOPT_TIMERFUNCTION, timer_func);
+	/* keep enough idle connections around for reuse */
+	curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS,
+			(long)(HTTP_FETCH_MAX_ACTIVE * 2));
+#if LIBCURL_VERSION_NUM >= 0x071e00
+	curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS,
+			(long)HTTP_FETCH_MAX_PER_HOST);
+#endif
+#if LIBCURL_VERSION_NUM >= 0x072b00
+	curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif
+
+	fetches = g_hash_table_new(g_str_hash, g_str_equal);
+	io_done = g_async_queue_new();
+}
+
+/* The disk is looked at first, off the main loop */
+static void http_fetch_start(http_fetch *fetch)
+{
+	http_io_job *job = g_new0(http_io_job, 1);
+
+	active++;
+	job->op = HTTP_IO_START;
+	job->fetch = fetch;
+	http_io_push(job);
+}
+
+static void http_fetch_start_network(http_fetch *fetch)
+{
+	fetch->loader = gdk_pixbuf_loader_new();
+
+	if ((fetch->curl = curl_easy_init()) == NULL) {
+		fetch->broken = TRUE;
+		http_fetch_finish(fetch);
+		return;
+	}
+
+	if (fetch->have_cached && fetch->cached.etag) {
+		gchar *header = g_strconcat("If-None-Match: ", fetch->cached.etag, NULL);
+		fetch->headers = curl_slist_append(fetch->headers, header);
+		g_free(header);
+	}
+
+	curl_easy_setopt(fetch->curl, CURLOPT_URL, fetch->url);
+	curl_easy_setopt(fetch->curl, CURLOPT_PRIVATE, fetch);
+	curl_easy_setopt(fetch->curl, CURLOPT_FOLLOWLOCATION, 1L);
+	curl_easy_setopt(fetch->curl, CURLOPT_TIMEOUT, HTTP_FETCH_TIMEOUT);
+	curl_easy_setopt(fetch->curl, CURLOPT_NOSIGNAL, 1L);
+	curl_easy_setopt(fetch->curl, CURLOPT_TCP_KEEPALIVE, 1L);
+	curl_easy_setopt(fetch->curl, CURLOPT_TCP_KEEPIDLE, 120L);
+	curl_easy_setopt(fetch->curl, CURLOPT_TCP_KEEPINTVL, 60L);
+	curl_easy_setopt(fetch->curl, CURLOPT_HTTPHEADER, fetch->headers);
+	curl_easy_setopt(fetch->curl, CURLOPT_WRITEFUNCTION, write_data);
+	curl_easy_setopt(fetch->curl, CURLOPT_WRITEDATA, (void *)fetch);
+	curl_easy_setopt(fetch->curl, CURLOPT_HEADERFUNCTION, write_header);
+	curl_easy_setopt(fetch->curl, CURLOPT_HEADERDATA, (void *)fetch);
+
+	debug_print("http fetcher: starting '%s'\n", fetch->url);
+	curl_multi_add_handle(multi, fetch->curl);
+}
+
+static void http_fetcher_start_next(void)
+{
+	http_fetch *fetch;
+
+	while (active < HTTP_FETCH_MAX_ACTIVE &&
+			(fetch = (http_fetch *)g_queue_pop_head(&queue)) != NULL) {
+		/* nobody wants it anymore */
+		if (fetch->waiters == NULL) {
+			g_hash_table_remove(fetches, fetch->url);
+			http_fetch_free(fetch);
+			continue;
+		}
+		http_fetch_start(fetch);
+	}
+}
+
+void http_fetcher_get_image(const gchar *url, http_fetch_func func,
+		gpointer data)
+{
+	http_fetch_waiter *waiter;
+	http_fetch *fetch;
+
+	g_return_if_fail(url != NULL);
+	g_return_if_fail(func != NULL);
+
+	http_fetcher_init();
+
+	waiter = g_new(http_fetch_waiter, 1);
+	waiter->func = func;
+	waiter->data = data;
+
+	fetch = (http_fetch *)g_hash_table_lookup(fetches, url);
+	if (fetch != NULL) {
+		GSList *cur;
+
+		debug_print("http fetcher: already fetching '%s'\n", url);
+		for (cur = fetch->waiters; cur != NULL; cur = cur->next) {
+			http_fetch_waiter *w = (http_fetch_waiter *)cur->data;
+
+			if (w->func == func && w->data == data) {
+				g_free(waiter);
+				return;
+			}
+		}
+		fetch->waiters = g_slist_append(fetch->waiters, waiter);
+		return;
+	}
+
+	fetch = g_new0(http_fetch, 1);
+	fetch->url = g_strdup(url);
+	fetch->body = g_byte_array_new();
+	fetch->waiters = g_slist_append(NULL, waiter);
+	g_hash_table_insert(fetches, fetch->url, fetch);
+	g_queue_push_tail(&queue, fetch);
+
+	http_fetcher_start_next();
+}
+
+void http_fetcher_cancel(gpointer data)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	if (fetches == NULL)
+		return;
+
+	g_hash_table_iter_init(&iter, fetches);
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		http_fetch *fetch = (http_fetch *)value;
+		GSList *cur = fetch->waiters;
+
+		while (cur != NULL) {
+			GSList *next = cur->next;
+
+			if (((http_fetch_waiter *)cur->data)->data == data) {
+				g_free(cur->data);
+				fetch->waiters = g_slist_delete_link(fetch->waiters, cur);
+			}
+			cur = next;
+		}
+	}
+}
+
+void http_fetcher_done(void)
+{
+	GHashTableIter iter;
+	gpointer value;
+	http_io_job *job;
+
+	if (multi == NULL)
+		return;
+
+	/* let the disk work end, the fetches are freed below */
+	if (io_pool != NULL) {
+		g_thread_pool_free(io_pool, FALSE, TRUE);
+		io_pool = NULL;
+	}
+	while (g_idle_remove_by_data(&io_done))
+		;
+	while ((job = (http_io_job *)g_async_queue_try_pop(io_done)) != NULL)
+		http_io_job_free(job);
+	g_async_queue_unref(io_done);
+	io_done = NULL;
+
+	g_hash_table_iter_init(&iter, fetches);
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		http_fetch *fetch = (http_fetch *)value;
+
+		if (fetch->curl != NULL)
+			curl_multi_remove_handle(multi, fetch->curl);
+		http_fetch_free(fetch);
+	}
+	g_hash_table_destroy(fetches);
+	fetches = NULL;
+	g_queue_clear(&queue);
+	active = 0;
+
+	curl_multi_cleanup(multi);
+	multi = NULL;
+
+	/* curl doesn't always say when it closes the idle connections */
+	g_slist_free_full(sockets, http_socket_free);
+	sockets = NULL;
+
+	if (timer_id != 0) {
+		g_source_remove(timer_id);
+		timer_id = 0;
+	}
+}
@@ -0,0 +1,58 @@
+/*
+ * Claws Mail -- A GTK+ based, lightweight, and fast e-mail client
+ * Copyright(C) 2026 the Claws Mail Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write tothe Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef HTTP_FETCHER_H
+#define HTTP_FETCHER_H
+
+#include <glib.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Maximum number of images downloaded at the same time. */
+#define HTTP_FETCH_MAX_ACTIVE 8
+
+/* Maximum number of connections to a single host. */
+#define HTTP_FETCH_MAX_PER_HOST 4
+
+/* Called from the main loop when url has been fetched, with a new
+ * reference to the decoded image, or NULL if it couldn't be. Local
+ * files and cached copies are read and decoded in other threads, and
+ * handed over from the main loop too. */
+typedef void (*http_fetch_func)(const gchar *url, GdkPixbuf *pixbuf,
+		gpointer data);
+
+/* Asynchronous image loader, driven by the main loop. Transfers share
+ * one curl multi handle, so connections are kept open and reused per
+ * host, and the images are decoded while they are received. Requests
+ * for a URL already being fetched wait for the same transfer. */
+void http_fetcher_get_image(const gchar *url, http_fetch_func func,
+		gpointer data);
+
+/* Forgets the requests made with data, e.g. as it is going away. */
+void http_fetcher_cancel(gpointer data);
+
+/* Aborts all transfers and closes the connections. */
+void http_fetcher_done(void);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* HTTP_FETCHER_H */
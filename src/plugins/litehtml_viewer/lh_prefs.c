@@ -44,6 +44,7 @@ struct _LHPrefsPage {
 	PrefsPage page;
 	GtkWidget *enable_remote_content;
 	GtkWidget *image_cache_size;
+	GtkWidget *disk_cache_size;
 	GtkWidget *default_font;
 };
 typedef struct _LHPrefsPage LHPrefsPage;
@@ -53,6 +54,8 @@ static PrefParam param[] = {
 		NULL, NULL, NULL },
 	{ "image_cache_size", "20", &lh_prefs.image_cache_size, P_INT,
 		NULL, NULL, NULL },
+	{ "disk_cache_size", "50", &lh_prefs.disk_cache_size, P_INT,
+		NULL, NULL, NULL },
 	{ "default_font", "Sans 16", &lh_prefs.default_font, P_STRING,
 		NULL, NULL, NULL },
 	{ NULL, NULL, NULL, 0, NULL, NULL, NULL }
@@ -103,6 +106,7 @@ static void create_lh_prefs_page(PrefsPage *page, GtkWindow *window,
 	GtkWidget *label;
 	GtkWidget *enable_remote_content;
 	GtkWidget *image_cache_size;
+	GtkWidget *disk_cache_size;
 	GtkWidget *default_font;
 	GtkObject *adj;
 
@@ -141,6 +145,22 @@ static void create_lh_prefs_page(PrefsPage *page, GtkWindow *window,
 			lh_prefs.image_cache_size);
 	gtk_box_pack_start(GTK_BOX(hbox), image_cache_size, FALSE, FALSE, 0);
 
+	/* Disk cache size */
+	hbox = gtk_hbox_new(FALSE, 8);
+	gtk_box_pack_start(GTK_BOX(vbox), hbox, FALSE, FALSE, 0);
+
+	label = gtk_label_new(_("Size of on-disk cache of remote images in megabytes"));
+	gtk_box_pack_start(GTK_BOX(hbox), label, FALSE, FALSE, 0);
+
+	adj = gtk_adjustment_new(0, 0, 99999, 1, 10, 0);
+	disk_cache_size = gtk_spin_button_new(GTK_ADJUSTMENT(adj), 1, 0);
+	gtk_spin_button_set_numeric(GTK_SPIN_BUTTON(disk_cache_size), TRUE);
+	gtk_spin_button_set_wrap(GTK_SPIN_BUTTON(disk_cache_size), FALSE);
+	gtk_spin_button_set_value(GTK_SPIN_BUTTON(disk_cache_size),
+			lh_prefs.disk_cache_size);
+	gtk_box_pack_start(GTK_BOX(hbox), disk_cache_size, FALSE, FALSE, 0);
+	gtk_widget_show_all(hbox);
+
 	/* Font */
 	hbox = gtk_hbox_new(FALSE, 8);
 	gtk_box_pack_start(GTK_BOX(vbox), hbox, FALSE, FALSE, 0);
@@ -156,6 +176,7 @@ static void create_lh_prefs_page(PrefsPage *page, GtkWindow *window,
 
 	prefs_page->enable_remote_content = enable_remote_content;
 	prefs_page->image_cache_size = image_cache_size;
+	prefs_page->disk_cache_size = disk_cache_size;
 	prefs_page->default_font = default_font;
 	prefs_page->page.widget = vbox;
 }
@@ -174,6 +195,9 @@ static void save_lh_prefs_page(PrefsPage *page)
 	lh_prefs.image_cache_size = gtk_spin_button_get_value_as_int(
 			GTK_SPIN_BUTTON(prefs_page->image_cache_size));
 
+	lh_prefs.disk_cache_size = gtk_spin_button_get_value_as_int(
+			GTK_SPIN_BUTTON(prefs_page->disk_cache_size));
+
 	g_free(lh_prefs.default_font);
 	lh_prefs.default_font = g_strdup(gtk_font_button_get_font_name(
 			GTK_FONT_BUTTON(prefs_page->default_font)));
@@ -99,6 +99,15 @@ lh_widget::lh_widget()
 
 	m_html = NULL;
 	m_rendered_width = 0;
+	m_height = 0;
+	m_layout_valid = FALSE;
+	m_render = NULL;
+	m_tile_count = 0;
+	if (gdk_screen_get_font_options(gdk_screen_get_default()) != NULL)
+		m_font_options = cairo_font_options_copy(
+				gdk_screen_get_font_options(gdk_screen_get_default()));
+	else
+		m_font_options = NULL;
 	m_context.load_master_stylesheet(master_css);
 
 	m_font_name = NULL;
@@ -116,12 +125,24 @@ lh_widget::lh_widget()
 
 lh_widget::~lh_widget()
 {
+	/* Leave the layout being computed, if any, to render_callback(),
+	 * but release the document while the fonts can be deleted. */
+	if (m_render != NULL) {
+		wait_render();
+		m_render->widget = NULL;
+		m_render->doc = nullptr;
+		m_render = NULL;
+	}
+	clear_layouts();
+	m_documents.clear();
 	g_object_unref(m_drawing_area);
 	m_drawing_area = NULL;
 	g_object_unref(m_scrolled_window);
 	m_scrolled_window = NULL;
 	m_html = NULL;
 	g_free(m_font_name);
+	if (m_font_options != NULL)
+		cairo_font_options_destroy(m_font_options);
 }
 
 GtkWidget *lh_widget::get_widget() const
@@ -177,18 +198,55 @@ void lh_widget::get_client_rect(litehtml::position& client) const
 
 void lh_widget::open_html(const gchar *contents)
 {
-	gint num = clear_images(lh_prefs_get()->image_cache_size * 1024 * 1000);
 	GtkAdjustment *adj;
+	gchar *sum;
+	litehtml::tstring key;
+	gint num;
+
+	/* The worker thread may still be laying out a cached document,
+	 * with the current font and images */
+	wait_render();
 
+	num = clear_images(lh_prefs_get()->image_cache_size * 1024 * 1000);
 	debug_print("LH: cleared %d images from image cache\n", num);
 
 	update_font();
 
-	lh_widget_statusbar_push("Loading HTML part ...");
-	m_html = litehtml::document::createFromString(contents, this, &m_context);
-	m_rendered_width = 0;
+	/* The parsed document depends on the HTML and on the default font */
+	sum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, contents, -1);
+	key = litehtml::tstring(sum) + " " + lh_prefs_get()->default_font;
+	g_free(sum);
+
+	clear_layouts();
+
+	m_html = NULL;
+	for (auto i = m_documents.begin(); i != m_documents.end(); ++i) {
+		if (i->key == key) {
+			m_html = i->document;
+			m_base_url = i->base_url;
+			m_documents.splice(m_documents.begin(), m_documents, i);
+			break;
+		}
+	}
+
+	if (m_html != NULL) {
+		debug_print("lh_widget::open_html reusing cached document\n");
+		/* the images cache may have been trimmed meanwhile */
+		load_images(m_html->root());
+	} else {
+		lh_widget_statusbar_push("Loading HTML part ...");
+		m_html = litehtml::document::createFromString(contents, this, &m_context);
+		lh_widget_statusbar_pop();
+
+		if (m_html != NULL) {
+			debug_print("lh_widget::open_html created document\n");
+			m_documents.push_front({ key, m_base_url, m_html });
+			while (m_documents.size() > LH_DOCUMENT_CACHE_SIZE)
+				m_documents.pop_back();
+		}
+	}
+
 	if (m_html != NULL) {
-		debug_print("lh_widget::open_html created document\n");
 		adj = gtk_scrolled_window_get_hadjustment(
 				GTK_SCROLLED_WINDOW(m_scrolled_window));
 		gtk_adjustment_set_value(adj, 0.0);
@@ -197,103 +255,432 @@ void lh_widget::open_html(const gchar *contents)
 		gtk_adjustment_set_value(adj, 0.0);
 		redraw(false);
 	}
-	lh_widget_statusbar_pop();
 }
 
-void lh_widget::draw(cairo_t *cr)
+/* Asks again for the images of a document taken from the cache, as
+ * they may have been dropped from the images cache since it was
+ * parsed. */
+void lh_widget::load_images(const litehtml::element::ptr &el)
 {
-	double x1, x2, y1, y2;
-	double width, height;
+	const litehtml::background *bg = el->get_background(true);
+	const litehtml::tchar_t *src;
 
-	if (m_html == NULL)
+	if (bg != NULL && !bg->m_image.empty())
+		load_image(bg->m_image.c_str(),
+				bg->m_baseurl.empty() ? 0 : bg->m_baseurl.c_str(), true);
+
+	if (!strcmp(el->get_tagName(), "img") &&
+			(src = el->get_attr(_t("src"))) != NULL)
+		load_image(src, 0, true);
+
+	for (size_t i = 0; i < el->get_children_count(); i++)
+		load_images(el->get_child(i));
+}
+
+/* A layout computed by a worker thread. The widget owns it while
+ * rendering is set, and forgets it (setting widget to NULL) if it goes
+ * away before the computation is over. */
+struct lh_render_ctx
+{
+	lh_widget *widget;
+	litehtml::document::ptr doc;
+	gint width;
+	gint doc_width;
+	gint doc_height;
+	/* the content changed during the computation */
+	gboolean stale;
+	gboolean done;
+	GMutex mutex;
+	GCond cond;
+};
+
+static void render_threaded(GTask *task, gpointer source, gpointer task_data,
+		GCancellable *cancellable)
+{
+	lh_render_ctx *ctx = (lh_render_ctx *)task_data;
+
+	ctx->doc->render(ctx->width);
+	ctx->doc_width = ctx->doc->width();
+	ctx->doc_height = ctx->doc->height();
+
+	g_mutex_lock(&ctx->mutex);
+	ctx->done = TRUE;
+	g_cond_signal(&ctx->cond);
+	g_mutex_unlock(&ctx->mutex);
+
+	g_task_return_boolean(task, TRUE);
+}
+
+static void render_callback(GObject *source, GAsyncResult *res,
+		gpointer user_data)
+{
+	lh_render_ctx *ctx = (lh_render_ctx *)user_data;
+
+	if (ctx->widget != NULL)
+		ctx->widget->render_done(ctx);
+
+	g_mutex_clear(&ctx->mutex);
+	g_cond_clear(&ctx->cond);
+	delete ctx;
+}
+
+/* Width the document is laid out for: the width of the viewport,
+ * rounded down to a multiple of LH_LAYOUT_WIDTH_STEP. */
+gint lh_widget::get_layout_width() const
+{
+	GdkWindow *gdkwin = gtk_viewport_get_view_window(GTK_VIEWPORT(m_viewport));
+	gint width = gdk_window_get_width(gdkwin);
+
+	if (width < LH_LAYOUT_WIDTH_STEP)
+		return width;
+
+	return width - width % LH_LAYOUT_WIDTH_STEP;
+}
+
+void lh_widget::start_render(gint width)
+{
+	GdkWindow *gdkwin = gtk_viewport_get_view_window(GTK_VIEWPORT(m_viewport));
+	lh_render_ctx *ctx;
+	GTask *task;
+
+	debug_print("lh_widget::start_render: width %d, was %d\n",
+			width, m_rendered_width);
+
+	/* Update our internally stored size, so that
+	 * lh_widget::get_client_rect() gives the correct one during the
+	 * render. They are not changed again until it is over. */
+	m_rendered_width = width;
+	m_height = gdk_window_get_height(gdkwin);
+	m_layout_valid = FALSE;
+
+	m_html->media_changed();
+
+	ctx = new lh_render_ctx;
+	ctx->widget = this;
+	ctx->doc = m_html;
+	ctx->width = width;
+	ctx->doc_width = 0;
+	ctx->doc_height = 0;
+	ctx->stale = FALSE;
+	ctx->done = FALSE;
+	g_mutex_init(&ctx->mutex);
+	g_cond_init(&ctx->cond);
+	m_render = ctx;
+
+	task = g_task_new(NULL, NULL, render_callback, ctx);
+	g_task_set_task_data(task, ctx, NULL);
+	g_task_run_in_thread(task, render_threaded);
+	g_object_unref(task);
+}
+
+/* Blocks until the worker thread is done with the document, if it is
+ * computing a layout. */
+void lh_widget::wait_render()
+{
+	if (m_render == NULL)
 		return;
 
-	cairo_clip_extents(cr, &x1, &y1, &x2, &y2);
+	g_mutex_lock(&m_render->mutex);
+	while (!m_render->done)
+		g_cond_wait(&m_render->cond, &m_render->mutex);
+	g_mutex_unlock(&m_render->mutex);
+}
+
+void lh_widget::render_done(lh_render_ctx *ctx)
+{
+	lh_layout *layout;
 
-	width = x2 - x1;
-	height = y2 - y1;
+	m_render = NULL;
 
-	litehtml::position pos;
-	pos.width = (int)width;
-	pos.height = (int)height;
-	pos.x = (int)x1;
-	pos.y = (int)y1;
+	/* Another document was opened meanwhile */
+	if (ctx->doc != m_html) {
+		if (m_html != NULL)
+			gtk_widget_queue_draw(m_drawing_area);
+		return;
+	}
+
+	debug_print("render is %dx%d\n", ctx->doc_width, ctx->doc_height);
+
+	layout = get_layout(ctx->width);
 
-	m_html->draw((litehtml::uint_ptr)cr, 0, 0, &pos);
+	/* Keep showing what we have, the content will be laid out again */
+	if (ctx->stale) {
+		layout->stale = true;
+		gtk_widget_queue_draw(m_drawing_area);
+		return;
+	}
+
+	/* The tiles of an up to date layout of this width can be reused */
+	if (layout->stale || layout->doc_width != ctx->doc_width ||
+			layout->doc_height != ctx->doc_height) {
+		for (auto &t : layout->tiles)
+			cairo_surface_destroy(t.second);
+		m_tile_count -= layout->tiles.size();
+		layout->tiles.clear();
+	}
+	layout->doc_width = ctx->doc_width;
+	layout->doc_height = ctx->doc_height;
+	layout->stale = false;
+	m_layout_valid = TRUE;
+
+	/* Change drawing area's size to match what was rendered. */
+	gtk_widget_set_size_request(m_drawing_area,
+			layout->doc_width, layout->doc_height);
+	gtk_widget_queue_draw(m_drawing_area);
 }
 
-void lh_widget::redraw(gboolean force_render)
+/* Returns the layout of the given width, moved to the front of the list,
+ * creating it if needed. */
+lh_layout *lh_widget::get_layout(gint width)
 {
-	GtkAllocation rect;
-	gint width;
-	GdkWindow *gdkwin;
-	cairo_t *cr;
+	for (auto i = m_layouts.begin(); i != m_layouts.end(); ++i) {
+		if (i->width == width) {
+			m_layouts.splice(m_layouts.begin(), m_layouts, i);
+			return &m_layouts.front();
+		}
+	}
 
-	paint_white();
+	m_layouts.push_front(lh_layout());
+	m_layouts.front().width = width;
+	m_layouts.front().doc_width = 0;
+	m_layouts.front().doc_height = 0;
+	m_layouts.front().stale = true;
+
+	while (m_layouts.size() > LH_LAYOUT_CACHE_SIZE) {
+		for (auto &t : m_layouts.back().tiles)
+			cairo_surface_destroy(t.second);
+		m_tile_count -= m_layouts.back().tiles.size();
+		m_layouts.pop_back();
+	}
 
-	if (m_html == NULL)
+	return &m_layouts.front();
+}
+
+/* Returns the layout whose tiles are to be shown. While a new layout is
+ * computed, that is the one previously computed for the same width if
+ * its content is still current, or else the last one shown. */
+lh_layout *lh_widget::get_shown_layout()
+{
+	if (m_render != NULL) {
+		for (auto &l : m_layouts) {
+			if (l.width == m_render->width && !l.stale && !l.tiles.empty())
+				return &l;
+		}
+	}
+
+	if (m_layouts.empty())
+		return NULL;
+
+	return &m_layouts.front();
+}
+
+void lh_widget::clear_layouts()
+{
+	for (auto &l : m_layouts) {
+		for (auto &t : l.tiles)
+			cairo_surface_destroy(t.second);
+	}
+	m_layouts.clear();
+	m_tile_count = 0;
+	m_layout_valid = FALSE;
+}
+
+/* Drops tiles until there are no more than LH_TILE_CACHE_MAX of them,
+ * starting with the layouts not shown, then the tiles of the shown one
+ * which are farthest from the visible area. */
+void lh_widget::trim_tiles(lh_layout *shown)
+{
+	GtkAdjustment *adj;
+	gint top, bottom;
+
+	for (auto l = m_layouts.rbegin();
+			l != m_layouts.rend() && m_tile_count > LH_TILE_CACHE_MAX; ++l) {
+		if (&(*l) == shown)
+			continue;
+		for (auto &t : l->tiles)
+			cairo_surface_destroy(t.second);
+		m_tile_count -= l->tiles.size();
+		l->tiles.clear();
+	}
+
+	if (shown == NULL || m_tile_count <= LH_TILE_CACHE_MAX)
 		return;
 
-	/* Get width of the viewport. */
-	gdkwin = gtk_viewport_get_view_window(GTK_VIEWPORT(m_viewport));
-	width = gdk_window_get_width(gdkwin);
-	m_height = gdk_window_get_height(gdkwin);
+	adj = gtk_scrolled_window_get_vadjustment(
+			GTK_SCROLLED_WINDOW(m_scrolled_window));
+	top = (gint)gtk_adjustment_get_value(adj) / LH_TILE_SIZE;
+	bottom = ((gint)(gtk_adjustment_get_value(adj) +
+				gtk_adjustment_get_page_size(adj))) / LH_TILE_SIZE;
 
-	/* If the available width has changed, rerender the HTML content. */
-	if (m_rendered_width != width || force_render) {
-		debug_print("lh_widget::redraw: width changed: %d != %d\n",
-				m_rendered_width, width);
+	while (m_tile_count > LH_TILE_CACHE_MAX) {
+		auto victim = shown->tiles.end();
+		gint max_dist = 0;
 
-		/* Update our internally stored width, mainly so that
-		 * lh_widget::get_client_rect() gives correct width during the
-		 * render. */
-		m_rendered_width = width;
+		for (auto i = shown->tiles.begin(); i != shown->tiles.end(); ++i) {
+			gint row = i->first.second;
+			gint dist = row < top ? top - row : row - bottom;
+
+			if (dist > max_dist) {
+				max_dist = dist;
+				victim = i;
+			}
+		}
 
-		/* Re-render HTML for this width. */
-		m_html->media_changed();
-		m_html->render(m_rendered_width);
-		debug_print("render is %dx%d\n", m_html->width(), m_html->height());
+		/* all the remaining tiles are visible */
+		if (victim == shown->tiles.end())
+			break;
 
-		/* Change drawing area's size to match what was rendered. */
-		gtk_widget_set_size_request(m_drawing_area,
-				m_html->width(), m_html->height());
+		cairo_surface_destroy(victim->second);
+		shown->tiles.erase(victim);
+		m_tile_count--;
 	}
+}
+cairo_surface_t *lh_widget::paint_tile(cairo_t *cr, gint col, gint row)
+{
+	cairo_surface_t *tile;
+	cairo_t *tile_cr;
+	litehtml::position pos;
+
+	tile = cairo_surface_create_similar(cairo_get_target(cr),
+			CAIRO_CONTENT_COLOR, LH_TILE_SIZE, LH_TILE_SIZE);
+	tile_cr = cairo_create(tile);
+
+	cairo_set_source_rgb(tile_cr, 1, 1, 1);
+	cairo_paint(tile_cr);
+
+	pos.x = col * LH_TILE_SIZE;
+	pos.y = row * LH_TILE_SIZE;
+	pos.width = LH_TILE_SIZE;
+	pos.height = LH_TILE_SIZE;
+
+	cairo_translate(tile_cr, -pos.x, -pos.y);
+	m_html->draw((litehtml::uint_ptr)tile_cr, 0, 0, &pos);
+	cairo_destroy(tile_cr);
+
+	return tile;
+}
+
+void lh_widget::expose(const GdkRectangle *area)
+{
+	GdkWindow *gdkwin;
+	lh_layout *layout;
+	gboolean can_paint;
+	cairo_t *cr;
+	gint col, row;
 
-	/* Paint the rendered HTML. */
 	gdkwin = gtk_widget_get_window(m_drawing_area);
 	if (gdkwin == NULL) {
-		g_warning("lh_widget::redraw: No GdkWindow to draw on!");
+		g_warning("lh_widget::expose: No GdkWindow to draw on!");
 		return;
 	}
+
+	/* If the available width has changed, lay out the HTML content
+	 * again. The current tiles are shown meanwhile. */
+	if (m_html != NULL && m_render == NULL) {
+		gint width = get_layout_width();
+
+		if (width != m_rendered_width || !m_layout_valid)
+			start_render(width);
+	}
+
 	cr = gdk_cairo_create(GDK_DRAWABLE(gdkwin));
-	draw(cr);
+	gdk_cairo_rectangle(cr, area);
+	cairo_clip(cr);
+
+	layout = (m_html != NULL ? get_shown_layout() : NULL);
+
+	/* Missing tiles can only be painted from the current layout */
+	can_paint = (layout != NULL && m_render == NULL && m_layout_valid &&
+			layout == &m_layouts.front());
+
+	for (row = area->y / LH_TILE_SIZE;
+			row * LH_TILE_SIZE < area->y + area->height; row++) {
+		for (col = area->x / LH_TILE_SIZE;
+				col * LH_TILE_SIZE < area->x + area->width; col++) {
+			gint x = col * LH_TILE_SIZE;
+			gint y = row * LH_TILE_SIZE;
+			cairo_surface_t *tile = NULL;
+
+			if (layout != NULL) {
+				auto t = layout->tiles.find(std::make_pair(col, row));
+
+				if (t != layout->tiles.end()) {
+					tile = t->second;
+				} else if (can_paint && x < layout->doc_width &&
+						y < layout->doc_height) {
+					tile = paint_tile(cr, col, row);
+					layout->tiles[std::make_pair(col, row)] = tile;
+					m_tile_count++;
+				}
+			}
+
+			if (tile != NULL)
+				cairo_set_source_surface(cr, tile, x, y);
+			else
+				cairo_set_source_rgb(cr, 1, 1, 1);
+			cairo_rectangle(cr, x, y, LH_TILE_SIZE, LH_TILE_SIZE);
+			cairo_fill(cr);
+		}
+	}
 
 	cairo_destroy(cr);
+
+	trim_tiles(layout);
+}
+
+/* Called when the content of the document changed (force_render, e.g.
+ * an image was loaded) or when it only needs to be shown again. */
+void lh_widget::redraw(gboolean force_render)
+{
+	if (m_html == NULL)
+		return;
+
+	if (force_render) {
+		if (m_render != NULL)
+			m_render->stale = TRUE;
+		for (auto &l : m_layouts)
+			l.stale = true;
+		m_layout_valid = FALSE;
+	}
+
+	gtk_widget_queue_draw(m_drawing_area);
 }
 
-void lh_widget::paint_white()
+/* Drops the tiles of the current layout which intersect pos, after its
+ * elements changed state (hovered, active...). */
+void lh_widget::invalidate_area(const litehtml::position &pos)
 {
-	GdkWindow *gdkwin = gtk_widget_get_window(m_drawing_area);
-	if (gdkwin == NULL) {
-		g_warning("lh_widget::clear: No GdkWindow to draw on!");
+	if (m_layouts.empty())
 		return;
+
+	auto &tiles = m_layouts.front().tiles;
+
+	for (auto t = tiles.begin(); t != tiles.end(); ) {
+		gint x = t->first.first * LH_TILE_SIZE;
+		gint y = t->first.second * LH_TILE_SIZE;
+
+		if (x < pos.right() && x + LH_TILE_SIZE > pos.left() &&
+				y < pos.bottom() && y + LH_TILE_SIZE > pos.top()) {
+			cairo_surface_destroy(t->second);
+			t = tiles.erase(t);
+			m_tile_count--;
+		} else {
+			++t;
+		}
 	}
-	cairo_t *cr = gdk_cairo_create(GDK_DRAWABLE(gdkwin));
 
-	/* Paint white background. */
-	gint width, height;
-	gdk_drawable_get_size(gdkwin, &width, &height);
-	cairo_rectangle(cr, 0, 0, width, height);
-	cairo_set_source_rgb(cr, 255, 255, 255);
-	cairo_fill(cr);
+	for (auto l = std::next(m_layouts.begin()); l != m_layouts.end(); ++l)
+		l->stale = true;
 
-	cairo_destroy(cr);
+	gtk_widget_queue_draw_area(m_drawing_area,
+			pos.x, pos.y, pos.width, pos.height);
 }
+
 void lh_widget::clear()
 {
 	m_html = nullptr;
-	paint_white();
-	m_rendered_width = 0;
+	clear_layouts();
+	gtk_widget_queue_draw(m_drawing_area);
 	m_base_url.clear();
 	m_clicked_url.clear();
 }
@@ -477,7 +864,7 @@ static gboolean expose_event_cb(GtkWidget *widget, GdkEvent *event,
 		gpointer user_data)
 {
 	lh_widget *w = (lh_widget *)user_data;
-	w->redraw(false);
+	w->expose(&event->expose.area);
 	return FALSE;
 }
 
@@ -487,7 +874,8 @@ static gboolean button_press_event(GtkWidget *widget, GdkEventButton *event,
 	litehtml::position::vector redraw_boxes;
 	lh_widget *w = (lh_widget *)user_data;
 
-	if (w->m_html == NULL)
+	/* The document can't be used while it is laid out */
+	if (w->m_html == NULL || w->is_rendering())
 		return false;
 
 	//debug_print("lh_widget on_button_press_event\n");
@@ -510,7 +898,7 @@ static gboolean button_press_event(GtkWidget *widget, GdkEventButton *event,
 				(int) event->x, (int) event->y, redraw_boxes)) {
 		for(auto& pos : redraw_boxes) {
 			debug_print("x: %d y:%d w: %d h: %d\n", pos.x, pos.y, pos.width, pos.height);
-			gtk_widget_queue_draw_area(widget, pos.x, pos.y, pos.width, pos.height);
+			w->invalidate_area(pos);
 		}
 	}
 	
@@ -525,14 +913,14 @@ static gboolean motion_notify_event(GtkWidget *widget, GdkEventButton *event,
     
     //debug_print("lh_widget on_motion_notify_event\n");
 
-    if(w->m_html)
+    if(w->m_html && !w->is_rendering())
     {    
         if(w->m_html->on_mouse_over((int) event->x, (int) event->y, (int) event->x, (int) event->y, redraw_boxes))
         {
             for (auto& pos : redraw_boxes)
             {
 		debug_print("x: %d y:%d w: %d h: %d\n", pos.x, pos.y, pos.width, pos.height);
-                gtk_widget_queue_draw_area(widget, pos.x, pos.y, pos.width, pos.height);
+                w->invalidate_area(pos);
             }
         }
 	}
@@ -547,7 +935,7 @@ static gboolean button_release_event(GtkWidget *widget, GdkEventButton *event,
     lh_widget *w = (lh_widget *)user_data;
     GError* error = NULL;
 
-	if (w->m_html == NULL)
+	if (w->m_html == NULL || w->is_rendering())
 		return false;
 
 	//debug_print("lh_widget on_button_release_event\n");
@@ -567,7 +955,7 @@ static gboolean button_release_event(GtkWidget *widget, GdkEventButton *event,
         for (auto& pos : redraw_boxes)
         {
             debug_print("x: %d y:%d w: %d h: %d\n", pos.x, pos.y, pos.width, pos.height);
-            gtk_widget_queue_draw_area(widget, pos.x, pos.y, pos.width, pos.height);
+            w->invalidate_area(pos);
         }
     }
 
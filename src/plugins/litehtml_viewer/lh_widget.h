@@ -19,10 +19,51 @@
 #include <glib.h>
 #include <gio/gio.h>
 
+#include <map>
+
 #include "procmime.h"
 
 #include "container_linux.h"
 
+/* Number of parsed documents kept, so that coming back to a recently
+ * viewed message doesn't parse and style it again. */
+#define LH_DOCUMENT_CACHE_SIZE 8
+
+struct lh_cached_document
+{
+	litehtml::tstring key;
+	litehtml::tstring base_url;
+	litehtml::document::ptr document;
+};
+
+/* The document is painted in square tiles of this size, kept until the
+ * content or the layout changes. */
+#define LH_TILE_SIZE 256
+
+/* Maximum number of painted tiles kept by a widget. */
+#define LH_TILE_CACHE_MAX 96
+
+/* Layouts are computed for widths rounded down to a multiple of this,
+ * so that small resizes don't need a new one. */
+#define LH_LAYOUT_WIDTH_STEP 16
+
+/* Number of layout widths whose tiles are kept, so that going back to a
+ * recent width shows its tiles while the layout is recomputed. */
+#define LH_LAYOUT_CACHE_SIZE 3
+
+struct lh_layout
+{
+	gint width;
+	gint doc_width;
+	gint doc_height;
+	/* the content changed since these tiles were painted */
+	bool stale;
+	/* painted tiles, by column and row */
+	std::map<std::pair<gint, gint>, cairo_surface_t *> tiles;
+};
+
+struct lh_render_ctx;
+
 struct pango_font
 {
 	PangoFontDescription *font;
@@ -53,8 +94,11 @@ class lh_widget : public container_linux
 		int text_width(const litehtml::tchar_t* text, litehtml::uint_ptr hFont);
 		void draw_text(litehtml::uint_ptr hdc, const litehtml::tchar_t* text, litehtml::uint_ptr hFont, litehtml::web_color color, const litehtml::position& pos);
 
-		void draw(cairo_t *cr);
+		void expose(const GdkRectangle *area);
 		void redraw(gboolean force_render);
+		void render_done(lh_render_ctx *ctx);
+		void invalidate_area(const litehtml::position &pos);
+		gboolean is_rendering() const { return m_render != NULL; };
 		void open_html(const gchar *contents);
 		void clear();
 		void update_cursor(const litehtml::tchar_t* cursor);
@@ -74,7 +118,16 @@ class lh_widget : public container_linux
 		litehtml::tstring m_base_url;
 
 	private:
-		void paint_white();
+		void load_images(const litehtml::element::ptr &el);
+		PangoContext *get_measure_context() const;
+		gint get_layout_width() const;
+		void start_render(gint width);
+		void wait_render();
+		lh_layout *get_layout(gint width);
+		lh_layout *get_shown_layout();
+		void clear_layouts();
+		void trim_tiles(lh_layout *shown);
+		cairo_surface_t *paint_tile(cairo_t *cr, gint col, gint row);
 
 		gint m_rendered_width;
 		GtkWidget *m_drawing_area;
@@ -89,4 +142,18 @@ class lh_widget : public container_linux
 
 		litehtml::tchar_t *m_font_name;
 		int m_font_size;
+
+		/* most recently used first */
+		std::list<lh_cached_document> m_documents;
+
+		/* layouts of m_html, the one for m_rendered_width first */
+		std::list<lh_layout> m_layouts;
+		/* m_html has a layout for m_rendered_width */
+		gboolean m_layout_valid;
+		/* layout being computed in a worker thread, if any */
+		lh_render_ctx *m_render;
+		gint m_tile_count;
+		/* screen font options, for measuring text outside of the main
+		 * thread */
+		cairo_font_options_t *m_font_options;
 };
@@ -23,6 +23,28 @@
 
 #include "lh_widget.h"
 
+/* Text is measured while laying out documents, which is done in worker
+ * threads, where the pango context of the widget can't be used. Each
+ * thread gets its own. */
+static GPrivate measure_context = G_PRIVATE_INIT(g_object_unref);
+
+PangoContext *lh_widget::get_measure_context() const
+{
+	PangoContext *context = (PangoContext *)g_private_get(&measure_context);
+
+	if (context == NULL) {
+		context = pango_font_map_create_context(
+				pango_cairo_font_map_get_default());
+		g_private_set(&measure_context, context);
+	}
+
+	pango_cairo_context_set_resolution(context, m_dpi);
+	if (m_font_options != NULL)
+		pango_cairo_context_set_font_options(context, m_font_options);
+
+	return context;
+}
+
 litehtml::uint_ptr lh_widget::create_font( const litehtml::tchar_t* faceName, int size, int weight, litehtml::font_style italic, unsigned int decoration, litehtml::font_metrics* fm )
 {
 	PangoFontDescription *desc =
@@ -37,7 +59,7 @@ litehtml::uint_ptr lh_widget::create_font( const litehtml::tchar_t* faceName, in
 		pango_font_description_set_style(desc, PANGO_STYLE_NORMAL);
 
 	if(fm != NULL) {
-		PangoContext *context = gtk_widget_get_pango_context(m_drawing_area);
+		PangoContext *context = get_measure_context();
 		PangoFontMetrics *metrics = pango_context_get_metrics(
 				context, desc,
 				pango_context_get_language(context));
@@ -79,7 +101,7 @@ void lh_widget::delete_font( litehtml::uint_ptr hFont )
 int lh_widget::text_width( const litehtml::tchar_t* text, litehtml::uint_ptr hFont )
 {
 	pango_font *fnt = (pango_font *) hFont;
-	PangoContext *context = gtk_widget_get_pango_context(m_drawing_area);
+	PangoContext *context = get_measure_context();
 	PangoLayout *layout = pango_layout_new(context);
 	PangoRectangle rect;
 
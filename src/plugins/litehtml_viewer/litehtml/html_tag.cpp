@@ -165,71 +165,88 @@ void litehtml::html_tag::apply_stylesheet( const litehtml::css& stylesheet )
 {
 	remove_before_after();
 
-	for(const auto& sel : stylesheet.selectors())
+	if(stylesheet.is_indexed())
 	{
-		int apply = select(*sel, false);
+		std::vector<int> candidates;
 
-		if(apply != select_no_match)
+		stylesheet.get_candidates(m_tag, get_attr(_t("id")), m_class_values, candidates);
+		for(int i : candidates)
 		{
-			used_selector::ptr us = std::unique_ptr<used_selector>(new used_selector(sel, false));
+			apply_selector(stylesheet.selectors()[i]);
+		}
+	} else
+	{
+		for(const auto& sel : stylesheet.selectors())
+		{
+			apply_selector(sel);
+		}
+	}
+
+	for(auto& el : m_children)
+	{
+		if(el->get_display() != display_inline_text)
+		{
+			el->apply_stylesheet(stylesheet);
+		}
+	}
+}
 
-			if(sel->is_media_valid())
+void litehtml::html_tag::apply_selector( const css_selector::ptr& sel )
+{
+	int apply = select(*sel, false);
+
+	if(apply != select_no_match)
+	{
+		used_selector::ptr us = std::unique_ptr<used_selector>(new used_selector(sel, false));
+
+		if(sel->is_media_valid())
+		{
+			if(apply & select_match_pseudo_class)
 			{
-				if(apply & select_match_pseudo_class)
+				if(select(*sel, true))
 				{
-					if(select(*sel, true))
+					if(apply & select_match_with_after)
 					{
-						if(apply & select_match_with_after)
+						element::ptr el = get_element_after();
+						if(el)
 						{
-							element::ptr el = get_element_after();
-							if(el)
-							{
-								el->add_style(*sel->m_style);
-							}
-						} else if(apply & select_match_with_before)
-						{
-							element::ptr el = get_element_before();
-							if(el)
-							{
-								el->add_style(*sel->m_style);
-							}
+							el->add_style(*sel->m_style);
 						}
-						else
+					} else if(apply & select_match_with_before)
+					{
+						element::ptr el = get_element_before();
+						if(el)
 						{
-							add_style(*sel->m_style);
-							us->m_used = true;
+							el->add_style(*sel->m_style);
 						}
 					}
-				} else if(apply & select_match_with_after)
-				{
-					element::ptr el = get_element_after();
-					if(el)
+					else
 					{
-						el->add_style(*sel->m_style);
+						add_style(*sel->m_style);
+						us->m_used = true;
 					}
-				} else if(apply & select_match_with_before)
+				}
+			} else if(apply & select_match_with_after)
+			{
+				element::ptr el = get_element_after();
+				if(el)
 				{
-					element::ptr el = get_element_before();
-					if(el)
-					{
-						el->add_style(*sel->m_style);
-					}
-				} else
+					el->add_style(*sel->m_style);
+				}
+			} else if(apply & select_match_with_before)
+			{
+				element::ptr el = get_element_before();
+				if(el)
 				{
-					add_style(*sel->m_style);
-					us->m_used = true;
+					el->add_style(*sel->m_style);
 				}
+			} else
+			{
+				add_style(*sel->m_style);
+				us->m_used = true;
 			}
-			m_used_styles.push_back(std::move(us));
-		}
-	}
-
-	for(auto& el : m_children)
-	{
-		if(el->get_display() != display_inline_text)
-		{
-			el->apply_stylesheet(stylesheet);
 		}
+		m_used_styles.push_back(std::move(us));
 	}
 }
 
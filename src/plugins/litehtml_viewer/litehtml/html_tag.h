@@ -231,6 +231,7 @@ namespace litehtml
 		void						draw_list_marker( uint_ptr hdc, const position &pos );
 		void						parse_nth_child_params( tstring param, int &num, int &off );
 		void						remove_before_after();
+		void						apply_selector(const css_selector::ptr& sel);
 		litehtml::element::ptr		get_element_before();
 		litehtml::element::ptr		get_element_after();
 	};
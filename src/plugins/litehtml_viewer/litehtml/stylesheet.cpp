@@ -124,6 +124,8 @@ bool litehtml::css::parse_selectors( const tstring& txt, const litehtml::style::
 	return added_something;
 }
 
+bool litehtml::css::use_index = true;
+
 void litehtml::css::sort_selectors()
 {
 	std::sort(m_selectors.begin(), m_selectors.end(),
@@ -132,6 +134,107 @@ void litehtml::css::sort_selectors()
 			 return (*v1) < (*v2);
 		 }
 	);
+	build_index();
+}
+
+void litehtml::css::clear_index()
+{
+	m_ids.clear();
+	m_classes.clear();
+	m_tags.clear();
+	m_universal.clear();
+	m_indexed = false;
+}
+
+void litehtml::css::build_index()
+{
+	clear_index();
+	if(!use_index)
+	{
+		return;
+	}
+
+	for(int i = 0; i < (int) m_selectors.size(); i++)
+	{
+		const css_element_selector& right = m_selectors[i]->m_right;
+		tstring id;
+		tstring cls;
+
+		for(const auto& attr : right.m_attrs)
+		{
+			if(attr.condition != select_equal)
+			{
+				continue;
+			}
+			if(attr.attribute == _t("id") && id.empty())
+			{
+				id = attr.val;
+			} else if(attr.attribute == _t("class") && cls.empty() && !attr.class_val.empty())
+			{
+				cls = attr.class_val.front();
+			}
+		}
+
+		// ids and classes are matched case insensitively
+		if(!id.empty())
+		{
+			lcase(id);
+			m_ids[id].push_back(i);
+		} else if(!cls.empty())
+		{
+			lcase(cls);
+			m_classes[cls].push_back(i);
+		} else if(!right.m_tag.empty() && right.m_tag != _t("*"))
+		{
+			m_tags[right.m_tag].push_back(i);
+		} else
+		{
+			m_universal.push_back(i);
+		}
+	}
+	m_indexed = true;
+}
+
+void litehtml::css::get_candidates(const tstring& tag, const tchar_t* id, const string_vector& classes, std::vector<int>& candidates) const
+{
+	selectors_index::const_iterator bucket;
+
+	candidates = m_universal;
+
+	bucket = m_tags.find(tag);
+	if(bucket != m_tags.end())
+	{
+		candidates.insert(candidates.end(), bucket->second.begin(), bucket->second.end());
+	}
+
+	if(id && !m_ids.empty())
+	{
+		tstring key = id;
+		lcase(key);
+		bucket = m_ids.find(key);
+		if(bucket != m_ids.end())
+		{
+			candidates.insert(candidates.end(), bucket->second.begin(), bucket->second.end());
+		}
+	}
+
+	if(!m_classes.empty())
+	{
+		for(const auto& cls : classes)
+		{
+			tstring key = cls;
+			lcase(key);
+			bucket = m_classes.find(key);
+			if(bucket != m_classes.end())
+			{
+				candidates.insert(candidates.end(), bucket->second.begin(), bucket->second.end());
+			}
+		}
+	}
+
+	// selectors are applied in their sorted order, once each
+	std::sort(candidates.begin(), candidates.end());
+	candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
 }
 
 void litehtml::css::parse_atrule(const tstring& text, const tchar_t* baseurl, const std::shared_ptr<document>& doc, const media_query_list::ptr& media)
@@ -10,11 +10,26 @@ namespace litehtml
 
 	class css
 	{
+		typedef std::map<tstring, std::vector<int>>	selectors_index;
+
 		css_selector::vector	m_selectors;
+
+		// Positions in m_selectors of the selectors, bucketed by the id,
+		// the first class or the tag their rightmost compound selector
+		// requires. The others are in m_universal. Built by sort_selectors().
+		selectors_index			m_ids;
+		selectors_index			m_classes;
+		selectors_index			m_tags;
+		std::vector<int>		m_universal;
+		bool					m_indexed;
 	public:
+		// Can be cleared to style elements by testing every selector,
+		// to compare with the index in tests.
+		static bool				use_index;
+
 		css()
 		{
-
+			m_indexed = false;
 		}
 		
 		~css()
@@ -30,8 +45,18 @@ namespace litehtml
 		void clear()
 		{
 			m_selectors.clear();
+			clear_index();
 		}
 
+		bool is_indexed() const
+		{
+			return m_indexed;
+		}
+
+		// Fills candidates, in order, with the positions of the selectors
+		// which may match an element with this tag, id and classes.
+		void	get_candidates(const tstring& tag, const tchar_t* id, const string_vector& classes, std::vector<int>& candidates) const;
+
 		void	parse_stylesheet(const tchar_t* str, const tchar_t* baseurl, const std::shared_ptr <document>& doc, const media_query_list::ptr& media);
 		void	sort_selectors();
 		static void	parse_css_url(const tstring& str, tstring& url);
@@ -39,6 +64,8 @@ namespace litehtml
 	private:
 		void	parse_atrule(const tstring& text, const tchar_t* baseurl, const std::shared_ptr<document>& doc, const media_query_list::ptr& media);
 		void	add_selector(css_selector::ptr selector);
+		void	build_index();
+		void	clear_index();
 		bool	parse_selectors(const tstring& txt, const litehtml::style::ptr& styles, const media_query_list::ptr& media);
 
 	};
@@ -47,6 +74,7 @@ namespace litehtml
 	{
 		selector->m_order = (int) m_selectors.size();
 		m_selectors.push_back(selector);
+		clear_index();
 	}
 
 }
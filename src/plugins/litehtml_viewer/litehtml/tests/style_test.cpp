@@ -0,0 +1,262 @@
+#include <glib.h>
+#include <string.h>
+
+#include "litehtml.h"
+
+/* Builds documents without drawing them */
+class test_container : public litehtml::document_container
+{
+public:
+	litehtml::uint_ptr create_font(const litehtml::tchar_t* faceName, int size, int weight, litehtml::font_style italic, unsigned int decoration, litehtml::font_metrics* fm) override
+	{
+		if (fm) {
+			fm->ascent = size;
+			fm->descent = size / 4;
+			fm->height = fm->ascent + fm->descent;
+			fm->x_height = size / 2;
+		}
+		return (litehtml::uint_ptr) 1;
+	}
+	void delete_font(litehtml::uint_ptr hFont) override {}
+	int text_width(const litehtml::tchar_t* text, litehtml::uint_ptr hFont) override { return 8 * strlen(text); }
+	void draw_text(litehtml::uint_ptr hdc, const litehtml::tchar_t* text, litehtml::uint_ptr hFont, litehtml::web_color color, const litehtml::position& pos) override {}
+	int pt_to_px(int pt) override { return pt; }
+	int get_default_font_size() const override { return 16; }
+	const litehtml::tchar_t* get_default_font_name() const override { return _t("sans"); }
+	void draw_list_marker(litehtml::uint_ptr hdc, const litehtml::list_marker& marker) override {}
+	void load_image(const litehtml::tchar_t* src, const litehtml::tchar_t* baseurl, bool redraw_on_ready) override {}
+	void get_image_size(const litehtml::tchar_t* src, const litehtml::tchar_t* baseurl, litehtml::size& sz) override { sz.width = sz.height = 0; }
+	void draw_background(litehtml::uint_ptr hdc, const litehtml::background_paint& bg) override {}
+	void draw_borders(litehtml::uint_ptr hdc, const litehtml::borders& borders, const litehtml::position& draw_pos, bool root) override {}
+	void set_caption(const litehtml::tchar_t* caption) override {}
+	void set_base_url(const litehtml::tchar_t* base_url) override {}
+	void link(const std::shared_ptr<litehtml::document>& doc, const litehtml::element::ptr& el) override {}
+	void on_anchor_click(const litehtml::tchar_t* url, const litehtml::element::ptr& el) override {}
+	void set_cursor(const litehtml::tchar_t* cursor) override {}
+	void transform_text(litehtml::tstring& text, litehtml::text_transform tt) override {}
+	void import_css(litehtml::tstring& text, const litehtml::tstring& url, litehtml::tstring& baseurl) override {}
+	void set_clip(const litehtml::position& pos, const litehtml::border_radiuses& bdr_radius, bool valid_x, bool valid_y) override {}
+	void del_clip() override {}
+	void get_client_rect(litehtml::position& client) const override
+	{
+		client.x = client.y = 0;
+		client.width = 800;
+		client.height = 600;
+	}
+	std::shared_ptr<litehtml::element> create_element(const litehtml::tchar_t *tag_name,
+			const litehtml::string_map &attributes,
+			const std::shared_ptr<litehtml::document> &doc) override
+	{
+		return nullptr;
+	}
+	void get_media_features(litehtml::media_features& media) const override
+	{
+		media.type = litehtml::media_type_screen;
+		media.width = media.device_width = 800;
+		media.height = media.device_height = 600;
+		media.color = 8;
+		media.color_index = 256;
+		media.monochrome = 0;
+		media.resolution = 96;
+	}
+	void get_language(litehtml::tstring& language, litehtml::tstring& culture) const override
+	{
+		language = _t("en");
+		culture.clear();
+	}
+};
+
+static const litehtml::tchar_t master_css[] =
+	_t("html, body, div, p, table, center { display: block; }")
+	_t("table { display: table; } tr { display: table-row; }")
+	_t("td, th { display: table-cell; } span, a, b, font { display: inline; }")
+	_t("head, style, script, title { display: none; }")
+	_t("a:link { color: blue; } b { font-weight: bold; }");
+
+static const gchar *checked_properties[] = {
+	"color", "font-weight", "margin-left", "padding-top",
+	"display", "background-color", "text-align", NULL
+};
+
+/* A newsletter-like document: many rules of every kind, a deep layout
+ * made of nested tables. */
+static gchar *synthetic_mail(gint rules, gint rows)
+{
+	GString *html = g_string_new("<html><head><style>\n");
+	gint i;
+
+	for (i = 0; i < rules; i++) {
+		switch (i % 8) {
+		case 0:
+			g_string_append_printf(html, ".c%d { color: #%06x; }\n", i, i);
+			break;
+		case 1:
+			g_string_append_printf(html, "#Id%d { margin-left: %dpx; }\n", i, i % 50);
+			break;
+		case 2:
+			g_string_append_printf(html, "td.C%d span { font-weight: bold; }\n", i - 2);
+			break;
+		case 3:
+			g_string_append_printf(html, "table .c%d > a { padding-top: %dpx; }\n", i - 3, i % 20);
+			break;
+		case 4:
+			g_string_append_printf(html, "tr:first-child td.c%d { text-align: center; }\n", i - 4);
+			break;
+		case 5:
+			g_string_append_printf(html, "[data-x=\"%d\"] { background-color: #abcdef; }\n", i);
+			break;
+		case 6:
+			g_string_append_printf(html, "div.c%d.extra { display: inline; }\n", i - 6);
+			break;
+		default:
+			g_string_append_printf(html, "%s { padding-top: %dpx; }\n",
+					i % 16 == 7 ? "*" : "td", i % 10);
+			break;
+		}
+	}
+	g_string_append(html, "</style></head><body><table>\n");
+
+	for (i = 0; i < rows; i++) {
+		gint c = (i * 8) % rules;
+
+		g_string_append_printf(html,
+			"<tr><td class=\"c%d C%d extra\" id=\"id%d\" data-x=\"%d\">"
+			"<table><tr><td><div class=\"c%d extra\"><span>text %d</span>"
+			"<a href=\"#\">link</a></div></td></tr></table>"
+			"</td><td class=\"c%d\"><b>cell</b></td></tr>\n",
+			c, c, c + 1, c + 5, c + 6, i, c + 8);
+	}
+	g_string_append(html, "</table></body></html>\n");
+
+	return g_string_free(html, FALSE);
+}
+
+static litehtml::document::ptr create_document(const gchar *html,
+		test_container *container, bool indexed)
+{
+	litehtml::context ctx;
+	litehtml::document::ptr doc;
+
+	litehtml::css::use_index = indexed;
+	ctx.load_master_stylesheet(master_css);
+	doc = litehtml::document::createFromString(html, container, &ctx);
+	litehtml::css::use_index = true;
+
+	return doc;
+}
+
+static void compare_elements(const litehtml::element::ptr &e1,
+		const litehtml::element::ptr &e2)
+{
+	const gchar **prop;
+
+	g_assert_cmpstr(e1->get_tagName(), ==, e2->get_tagName());
+	for (prop = checked_properties; *prop != NULL; prop++) {
+		g_assert_cmpstr(e1->get_style_property(*prop, false),
+				==, e2->get_style_property(*prop, false));
+	}
+
+	g_assert_cmpuint(e1->get_children_count(), ==, e2->get_children_count());
+	for (size_t i = 0; i < e1->get_children_count(); i++)
+		compare_elements(e1->get_child(i), e2->get_child(i));
+}
+
+static void test_style_index(void)
+{
+	test_container container;
+	gchar *html = synthetic_mail(400, 60);
+	litehtml::document::ptr indexed, scanned;
+
+	indexed = create_document(html, &container, true);
+	scanned = create_document(html, &container, false);
+	g_assert_nonnull(indexed->root());
+	g_assert_nonnull(scanned->root());
+
+	/* the index only skips selectors which can't match */
+	compare_elements(indexed->root(), scanned->root());
+
+	g_free(html);
+}
+
+static gdouble time_document(const gchar *html, test_container *container,
+		bool indexed, gint runs)
+{
+	gdouble best = G_MAXDOUBLE;
+
+	while (runs-- > 0) {
+		litehtml::document::ptr doc;
+
+		g_test_timer_start();
+		doc = create_document(html, container, indexed);
+		best = MIN(best, g_test_timer_elapsed());
+	}
+
+	return best;
+}
+
+static void bench_one(const gchar *name, const gchar *html,
+		test_container *container, gdouble *total_scanned,
+		gdouble *total_indexed)
+{
+	gdouble scanned = time_document(html, container, false, 3);
+	gdouble indexed = time_document(html, container, true, 3);
+
+	g_test_message("%s: %.1f ms without index, %.1f ms with index",
+			name, scanned * 1000, indexed * 1000);
+	*total_scanned += scanned;
+	*total_indexed += indexed;
+}
+
+/* Times document creation, which includes styling, over the HTML
+ * files of the directory in LITEHTML_BENCH_CORPUS (e.g. HTML parts saved
+ * from real mails), or over synthetic newsletters. */
+static void test_style_perf(void)
+{
+	test_container container;
+	const gchar *corpus = g_getenv("LITEHTML_BENCH_CORPUS");
+	gdouble scanned = 0, indexed = 0;
+	GDir *dir;
+
+	if (corpus != NULL && (dir = g_dir_open(corpus, 0, NULL)) != NULL) {
+		const gchar *name;
+
+		while ((name = g_dir_read_name(dir)) != NULL) {
+			gchar *path = g_build_filename(corpus, name, NULL);
+			gchar *html;
+
+			if (g_file_get_contents(path, &html, NULL, NULL)) {
+				bench_one(name, html, &container, &scanned, &indexed);
+				g_free(html);
+			}
+			g_free(path);
+		}
+		g_dir_close(dir);
+	} else {
+		gint rules;
+
+		for (rules = 1000; rules <= 5000; rules += 2000) {
+			gchar *html = synthetic_mail(rules, 300);
+			gchar *name = g_strdup_printf("synthetic, %d rules", rules);
+
+			bench_one(name, html, &container, &scanned, &indexed);
+			g_free(name);
+			g_free(html);
+		}
+	}
+
+	g_test_message("total: %.1f ms without index, %.1f ms with index",
+			scanned * 1000, indexed * 1000);
+	g_test_minimized_result(indexed, "styling with the selector index: %.3fs",
+			indexed);
+}
+
+int main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/litehtml/style/index", test_style_index);
+	if (g_test_perf())
+		g_test_add_func("/litehtml/style/perf", test_style_perf);
+
+	return g_test_run();
+}
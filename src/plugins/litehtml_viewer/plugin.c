@@ -26,6 +26,7 @@
 #include <plugin.h>
 
 #include "lh_prefs.h"
+#include "http_fetcher.h"
 
 extern MimeViewerFactory lh_viewer_factory;
 
@@ -41,6 +42,7 @@ gboolean plugin_done(void)
 {
 	debug_print("LH: plugin_done\n");
 	mimeview_unregister_viewer_factory(&lh_viewer_factory);
+	http_fetcher_done();
 	lh_prefs_done();
 	return TRUE;
 }
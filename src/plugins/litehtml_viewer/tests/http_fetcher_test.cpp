@@ -0,0 +1,327 @@
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include <string.h>
+
+#include "http_fetcher.h"
+#include "lh_prefs.h"
+
+/* What http_cache.cpp needs from Claws Mail */
+static gchar *rc_dir = NULL;
+static LHPrefs prefs = { TRUE, 20, 1, NULL };
+
+extern "C" {
+void debug_print_real(const gchar *format, ...) { return; }
+const char *debug_srcname(const char *file) { return NULL; }
+const gchar *get_rc_dir(void) { return rc_dir; }
+gboolean is_dir_exist(const gchar *dir) { return g_file_test(dir, G_FILE_TEST_IS_DIR); }
+gint make_dir_hier(const gchar *dir) { return g_mkdir_with_parents(dir, 0700); }
+LHPrefs *lh_prefs_get(void) { return &prefs; }
+}
+
+/* A small HTTP/1.1 server with keep-alive, serving the same image for
+ * every path but "/missing", and counting what it does. */
+static gchar *image_data = NULL;
+static gsize image_len = 0;
+static gint connections = 0;
+static gint requests = 0;
+static gint in_flight = 0;
+static gint max_in_flight = 0;
+static guint delay_ms = 0;
+static guint16 port = 0;
+/* calls of fetched_cb() since the last server_reset() */
+static gint callbacks = 0;
+
+static gboolean serve_cb(GThreadedSocketService *service,
+		GSocketConnection *connection, GObject *source, gpointer data)
+{
+	GDataInputStream *in = g_data_input_stream_new(
+			g_io_stream_get_input_stream(G_IO_STREAM(connection)));
+	GOutputStream *out = g_io_stream_get_output_stream(G_IO_STREAM(connection));
+	gchar *line, *path = NULL;
+
+	g_atomic_int_inc(&connections);
+	g_data_input_stream_set_newline_type(in, G_DATA_STREAM_NEWLINE_TYPE_CR_LF);
+
+	while ((line = g_data_input_stream_read_line(in, NULL, NULL, NULL)) != NULL) {
+		gchar *header;
+		gint cur, max;
+
+		if (path == NULL) {
+			gchar **parts = g_strsplit(line, " ", 3);
+
+			path = g_strdup(parts[1]);
+			g_strfreev(parts);
+			g_free(line);
+			continue;
+		}
+		if (*line != '\0') {
+			g_free(line);
+			continue;
+		}
+		g_free(line);
+
+		/* end of a request */
+		g_atomic_int_inc(&requests);
+		cur = g_atomic_int_add(&in_flight, 1) + 1;
+		do {
+			max = g_atomic_int_get(&max_in_flight);
+		} while (cur > max &&
+				!g_atomic_int_compare_and_exchange(&max_in_flight, max, cur));
+
+		if (delay_ms > 0)
+			g_usleep(delay_ms * 1000);
+
+		if (!strcmp(path, "/missing")) {
+			header = g_strdup("HTTP/1.1 404 Not Found\r\n"
+					"Content-Length: 0\r\n\r\n");
+			g_output_stream_write_all(out, header, strlen(header),
+					NULL, NULL, NULL);
+		} else {
+			header = g_strdup_printf("HTTP/1.1 200 OK\r\n"
+					"Content-Type: image/png\r\n"
+					"Content-Length: %" G_GSIZE_FORMAT "\r\n\r\n",
+					image_len);
+			g_output_stream_write_all(out, header, strlen(header),
+					NULL, NULL, NULL);
+			g_output_stream_write_all(out, image_data, image_len,
+					NULL, NULL, NULL);
+		}
+		g_free(header);
+		g_free(path);
+		path = NULL;
+
+		g_atomic_int_add(&in_flight, -1);
+	}
+
+	g_free(path);
+	g_object_unref(in);
+
+	return TRUE;
+}
+
+static void server_reset(guint delay)
+{
+	g_atomic_int_set(&connections, 0);
+	g_atomic_int_set(&requests, 0);
+	g_atomic_int_set(&max_in_flight, 0);
+	delay_ms = delay;
+	callbacks = 0;
+}
+
+static gchar *server_url(const gchar *path)
+{
+	return g_strdup_printf("http://127.0.0.1:%d%s", port, path);
+}
+
+/* Records the images handed over */
+struct fetched
+{
+	gint calls;
+	gint images;
+};
+
+static void fetched_cb(const gchar *url, GdkPixbuf *pixbuf, gpointer data)
+{
+	fetched *f = (fetched *)data;
+
+	callbacks++;
+	f->calls++;
+	if (pixbuf != NULL) {
+		g_assert_cmpint(gdk_pixbuf_get_width(pixbuf), ==, 4);
+		g_assert_cmpint(gdk_pixbuf_get_height(pixbuf), ==, 3);
+		f->images++;
+		g_object_unref(pixbuf);
+	}
+}
+
+static gboolean timeout_cb(gpointer data)
+{
+	g_error("timed out waiting for the images");
+	return FALSE;
+}
+
+static void wait_for(gint n)
+{
+	guint id = g_timeout_add_seconds(20, timeout_cb, NULL);
+
+	while (callbacks < n)
+		g_main_context_iteration(NULL, TRUE);
+
+	g_source_remove(id);
+}
+
+static void test_fetcher_dedup(void)
+{
+	gchar *url = server_url("/dedup.png");
+	fetched f[3] = { { 0, 0 }, { 0, 0 }, { 0, 0 } };
+	gint i;
+
+	server_reset(50);
+
+	for (i = 0; i < 3; i++)
+		http_fetcher_get_image(url, fetched_cb, &f[i]);
+	/* the same request twice only gets one answer */
+	http_fetcher_get_image(url, fetched_cb, &f[0]);
+
+	wait_for(3);
+
+	for (i = 0; i < 3; i++) {
+		g_assert_cmpint(f[i].calls, ==, 1);
+		g_assert_cmpint(f[i].images, ==, 1);
+	}
+	g_assert_cmpint(g_atomic_int_get(&requests), ==, 1);
+
+	g_free(url);
+}
+
+static void test_fetcher_parallel(void)
+{
+	fetched f = { 0, 0 };
+	gint i;
+
+	server_reset(100);
+
+	for (i = 0; i < 20; i++) {
+		gchar *path = g_strdup_printf("/parallel/%d.png", i);
+		gchar *url = server_url(path);
+
+		http_fetcher_get_image(url, fetched_cb, &f);
+		g_free(url);
+		g_free(path);
+	}
+	wait_for(20);
+
+	g_assert_cmpint(f.images, ==, 20);
+	g_assert_cmpint(g_atomic_int_get(&requests), ==, 20);
+	/* in parallel, over a few kept-alive connections */
+	g_assert_cmpint(g_atomic_int_get(&max_in_flight), >, 1);
+	g_assert_cmpint(g_atomic_int_get(&max_in_flight), <=, HTTP_FETCH_MAX_PER_HOST);
+	g_assert_cmpint(g_atomic_int_get(&connections), <=, HTTP_FETCH_MAX_PER_HOST);
+}
+
+static void test_fetcher_missing(void)
+{
+	gchar *url = server_url("/missing");
+	fetched f = { 0, 0 };
+
+	server_reset(0);
+
+	http_fetcher_get_image(url, fetched_cb, &f);
+	wait_for(1);
+
+	g_assert_cmpint(f.images, ==, 0);
+
+	g_free(url);
+}
+
+static void test_fetcher_cancel(void)
+{
+	gchar *url = server_url("/cancel.png");
+	fetched gone = { 0, 0 }, f = { 0, 0 };
+
+	server_reset(50);
+
+	http_fetcher_get_image(url, fetched_cb, &gone);
+	http_fetcher_cancel(&gone);
+	http_fetcher_get_image(url, fetched_cb, &f);
+	wait_for(1);
+
+	g_assert_cmpint(f.images, ==, 1);
+	g_assert_cmpint(gone.calls, ==, 0);
+
+	g_free(url);
+}
+
+static void test_fetcher_cached(void)
+{
+	gchar *url = server_url("/cached.png");
+	gchar *sum, *path;
+	fetched f = { 0, 0 };
+	gint i;
+
+	server_reset(0);
+
+	http_fetcher_get_image(url, fetched_cb, &f);
+	wait_for(1);
+	g_assert_cmpint(g_atomic_int_get(&requests), ==, 1);
+
+	/* the copy is stored by another thread, and renamed into place */
+	sum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, url, -1);
+	path = g_build_filename(rc_dir, "litehtml_cache", sum, NULL);
+	for (i = 0; i < 200 && !g_file_test(path, G_FILE_TEST_EXISTS); i++)
+		g_usleep(10 * 1000);
+	g_assert(g_file_test(path, G_FILE_TEST_EXISTS));
+	g_free(path);
+	g_free(sum);
+
+	/* the copy stored on disk is still fresh */
+	http_fetcher_get_image(url, fetched_cb, &f);
+	/* not before it was read from the disk */
+	g_assert_cmpint(f.calls, ==, 1);
+	wait_for(2);
+
+	g_assert_cmpint(f.images, ==, 2);
+	g_assert_cmpint(g_atomic_int_get(&requests), ==, 1);
+
+	g_free(url);
+}
+
+int main(int argc, char *argv[])
+{
+	GSocketService *service;
+	GdkPixbuf *pixbuf;
+	gchar *cache;
+	int ret;
+
+	g_test_init(&argc, &argv, NULL);
+
+	rc_dir = g_dir_make_tmp("lh_fetcher_XXXXXX", NULL);
+	g_assert(rc_dir != NULL);
+
+	pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, 4, 3);
+	gdk_pixbuf_fill(pixbuf, 0x336699ff);
+	g_assert(gdk_pixbuf_save_to_buffer(pixbuf, &image_data, &image_len,
+				"png", NULL, NULL));
+	g_object_unref(pixbuf);
+
+	service = g_threaded_socket_service_new(8);
+	port = g_socket_listener_add_any_inet_port(G_SOCKET_LISTENER(service),
+			NULL, NULL);
+	g_assert_cmpint(port, !=, 0);
+	g_signal_connect(service, "run", G_CALLBACK(serve_cb), NULL);
+	g_socket_service_start(service);
+
+	g_test_add_func("/litehtml/fetcher/dedup", test_fetcher_dedup);
+	g_test_add_func("/litehtml/fetcher/parallel", test_fetcher_parallel);
+	g_test_add_func("/litehtml/fetcher/missing", test_fetcher_missing);
+	g_test_add_func("/litehtml/fetcher/cancel", test_fetcher_cancel);
+	g_test_add_func("/litehtml/fetcher/cached", test_fetcher_cached);
+
+	ret = g_test_run();
+
+	http_fetcher_done();
+	g_socket_service_stop(service);
+	g_object_unref(service);
+
+	/* leave no cache behind */
+	cache = g_build_filename(rc_dir, "litehtml_cache", NULL);
+	if (g_file_test(cache, G_FILE_TEST_IS_DIR)) {
+		GDir *dir = g_dir_open(cache, 0, NULL);
+		const gchar *name;
+
+		while ((name = g_dir_read_name(dir)) != NULL) {
+			gchar *path = g_build_filename(cache, name, NULL);
+			g_unlink(path);
+			g_free(path);
+		}
+		g_dir_close(dir);
+		g_rmdir(cache);
+	}
+	g_free(cache);
+	g_rmdir(rc_dir);
+	g_free(rc_dir);
+	g_free(image_data);
+
+	return ret;
+}
@@ -57,6 +57,7 @@
 
 #include "mmapstring.h"
 #include "mailmbox_parse.h"
+#include "mailmbox_index.h"
 #include "maillock.h"
 #include "file-utils.h"
 #include "utils.h"
@@ -240,6 +241,31 @@ void claws_mailmbox_close(struct claws_mailmbox_folder * folder)
 }
 
 
+/*
+  parse the mapped file, reusing the messages already known from memory
+  or from the index file when the file was only appended to.
+*/
+
+static int claws_mailmbox_parse_indexed(struct claws_mailmbox_folder * folder)
+{
+  int r;
+
+  if ((carray_count(folder->mb_tab) == 0) && (folder->mb_parsed_size == 0))
+    claws_mailmbox_index_load(folder);
+
+  if (claws_mailmbox_index_match(folder))
+    r = claws_mailmbox_parse_appended(folder);
+  else
+    r = claws_mailmbox_parse(folder);
+  if (r != MAILMBOX_NO_ERROR)
+    return r;
+
+  claws_mailmbox_index_stamp(folder);
+  claws_mailmbox_index_save(folder);
+
+  return MAILMBOX_NO_ERROR;
+}
+
 static int claws_mailmbox_validate_lock(struct claws_mailmbox_folder * folder,
     int (* custom_lock)(struct claws_mailmbox_folder *),
     int (* custom_unlock)(struct claws_mailmbox_folder *))
@@ -278,7 +304,7 @@ static int claws_mailmbox_validate_lock(struct claws_mailmbox_folder * folder,
       goto err_unlock;
     }
 
-    r = claws_mailmbox_parse(folder);
+    r = claws_mailmbox_parse_indexed(folder);
     if (r != MAILMBOX_NO_ERROR) {
       res = r;
       goto err_unlock;
@@ -767,6 +793,8 @@ claws_mailmbox_append_message_list(struct claws_mailmbox_folder * folder,
   }
 
   claws_mailmbox_timestamp(folder);
+  claws_mailmbox_index_stamp(folder);
+  claws_mailmbox_index_save(folder);
 
   claws_mailmbox_write_unlock(folder);
 
@@ -1246,23 +1274,225 @@ static int claws_mailmbox_expunge_to_file_no_lock(char * dest_filename, int dest
   return res;
 }
 
-int claws_mailmbox_expunge_no_lock(struct claws_mailmbox_folder * folder)
+static size_t uid_line(char * line, size_t size, uint32_t uid)
 {
-  char tmpfile[PATH_MAX + 8]; /* for the extra Xs */
-  int r;
-  int res;
-  int dest_fd;
+#if CRLF_BADNESS
+  return snprintf(line, size, UID_HEADER " %u\r\n", uid);
+#else
+  return snprintf(line, size, UID_HEADER " %u\n", uid);
+#endif
+}
+
+/*
+  remove the deleted messages and write the missing UIDs without
+  copying the file: messages before the first one that changes are
+  left untouched, the following ones are moved inside the mapping
+  and only that part of the file is parsed again.
+
+  this is possible as long as all the messages move in the same
+  direction, MAILMBOX_ERROR_INVAL is returned otherwise.
+*/
+
+static int claws_mailmbox_expunge_in_place_no_lock(struct claws_mailmbox_folder * folder)
+{
+  char line[MAX_FROM_LINE_SIZE];
+  unsigned int first;
+  unsigned int count;
+  unsigned int i;
+  size_t start_offset;
+  size_t cur_offset;
   size_t size;
+  int forward;
+  int backward;
+  int r;
 
-  if (folder->mb_read_only)
-    return MAILMBOX_ERROR_READONLY;
+  count = carray_count(folder->mb_tab);
 
-  if (((folder->mb_written_uid >= folder->mb_max_uid) || folder->mb_no_uid) &&
-      (!folder->mb_changed)) {
-    /* no need to expunge */
+  for(first = 0 ; first < count ; first ++) {
+    struct claws_mailmbox_msg_info * info;
+
+    info = carray_get(folder->mb_tab, first);
+    if (info->msg_deleted)
+      break;
+    if (!folder->mb_no_uid && !info->msg_written_uid)
+      break;
+  }
+
+  if (first == count) {
+    /* nothing to remove and all the UIDs are already written */
+    if (!folder->mb_no_uid)
+      folder->mb_written_uid = folder->mb_max_uid;
     return MAILMBOX_NO_ERROR;
   }
 
+  start_offset = 0;
+  if (first > 0) {
+    struct claws_mailmbox_msg_info * info;
+
+    info = carray_get(folder->mb_tab, first - 1);
+    start_offset = info->msg_start + info->msg_size + info->msg_padding;
+  }
+
+  /* compute the destination of the messages */
+
+  forward = TRUE;
+  backward = TRUE;
+  cur_offset = start_offset;
+  for(i = first ; i < count ; i ++) {
+    struct claws_mailmbox_msg_info * info;
+    size_t head_len;
+    size_t line_len;
+
+    info = carray_get(folder->mb_tab, i);
+    if (info->msg_deleted)
+      continue;
+
+    head_len = info->msg_start_len + info->msg_headers_len;
+    line_len = 0;
+    if (!folder->mb_no_uid && !info->msg_written_uid)
+      line_len = uid_line(line, sizeof(line), info->msg_uid);
+
+    if (cur_offset + head_len + line_len > info->msg_start + head_len)
+      forward = FALSE;
+    if (cur_offset < info->msg_start)
+      backward = FALSE;
+
+    cur_offset += info->msg_size + info->msg_padding + line_len;
+  }
+  size = cur_offset;
+
+  if (!forward && !backward)
+    return MAILMBOX_ERROR_INVAL;
+
+  if (size > folder->mb_mapping_size) {
+    size_t old_size;
+
+    old_size = folder->mb_mapping_size;
+    claws_mailmbox_unmap(folder);
+
+    r = ftruncate(folder->mb_fd, size);
+    if (r < 0) {
+      debug_print("ftruncate failed with %d\n", r);
+      claws_mailmbox_map(folder);
+      return MAILMBOX_ERROR_FILE;
+    }
+
+    r = claws_mailmbox_map(folder);
+    if (r != MAILMBOX_NO_ERROR) {
+      r = ftruncate(folder->mb_fd, old_size);
+      if (r < 0)
+        debug_print("ftruncate failed with %d\n", r);
+      claws_mailmbox_map(folder);
+      return MAILMBOX_ERROR_FILE;
+    }
+  }
+
+  /* move the messages */
+
+  if (forward) {
+    cur_offset = start_offset;
+    for(i = first ; i < count ; i ++) {
+      struct claws_mailmbox_msg_info * info;
+      size_t head_len;
+
+      info = carray_get(folder->mb_tab, i);
+      if (info->msg_deleted)
+        continue;
+
+      head_len = info->msg_start_len + info->msg_headers_len;
+      memmove(folder->mb_mapping + cur_offset,
+          folder->mb_mapping + info->msg_start, head_len);
+      cur_offset += head_len;
+
+      if (!folder->mb_no_uid && !info->msg_written_uid) {
+        size_t line_len;
+
+        line_len = uid_line(line, sizeof(line), info->msg_uid);
+        memcpy(folder->mb_mapping + cur_offset, line, line_len);
+        cur_offset += line_len;
+      }
+
+      memmove(folder->mb_mapping + cur_offset,
+          folder->mb_mapping + info->msg_start + head_len,
+          info->msg_size - head_len + info->msg_padding);
+      cur_offset += info->msg_size - head_len + info->msg_padding;
+    }
+  }
+  else {
+    cur_offset = size;
+    i = count;
+    while (i > first) {
+      struct claws_mailmbox_msg_info * info;
+      size_t head_len;
+
+      i --;
+      info = carray_get(folder->mb_tab, i);
+      if (info->msg_deleted)
+        continue;
+
+      head_len = info->msg_start_len + info->msg_headers_len;
+
+      cur_offset -= info->msg_size - head_len + info->msg_padding;
+      memmove(folder->mb_mapping + cur_offset,
+          folder->mb_mapping + info->msg_start + head_len,
+          info->msg_size - head_len + info->msg_padding);
+
+      if (!folder->mb_no_uid && !info->msg_written_uid) {
+        size_t line_len;
+
+        line_len = uid_line(line, sizeof(line), info->msg_uid);
+        cur_offset -= line_len;
+        memcpy(folder->mb_mapping + cur_offset, line, line_len);
+      }
+
+      cur_offset -= head_len;
+      memmove(folder->mb_mapping + cur_offset,
+          folder->mb_mapping + info->msg_start, head_len);
+    }
+  }
+
+  claws_mailmbox_sync(folder);
+
+  if (size != folder->mb_mapping_size) {
+    claws_mailmbox_unmap(folder);
+
+    r = ftruncate(folder->mb_fd, size);
+    if (r < 0)
+      debug_print("ftruncate failed with %d\n", r);
+
+    r = claws_mailmbox_map(folder);
+    if (r != MAILMBOX_NO_ERROR)
+      return r;
+  }
+
+  /* forget the moved messages and parse them again */
+
+  for(i = first ; i < count ; i ++) {
+    struct claws_mailmbox_msg_info * info;
+    chashdatum key;
+
+    info = carray_get(folder->mb_tab, i);
+
+    key.data = &info->msg_uid;
+    key.len = sizeof(info->msg_uid);
+    chash_delete(folder->mb_hash, &key, NULL);
+
+    claws_mailmbox_msg_info_free(info);
+  }
+  carray_set_size(folder->mb_tab, first);
+
+  cur_offset = start_offset;
+  return claws_mailmbox_parse_additionnal(folder, &cur_offset);
+}
+
+static int claws_mailmbox_expunge_copy_no_lock(struct claws_mailmbox_folder * folder)
+{
+  char tmpfile[PATH_MAX + 8]; /* for the extra Xs */
+  int r;
+  int res;
+  int dest_fd;
+  size_t size;
+
   snprintf(tmpfile, sizeof(tmpfile), "%sXXXXXX", folder->mb_filename);
   dest_fd = g_mkstemp(tmpfile);
 
@@ -1307,11 +1537,6 @@ int claws_mailmbox_expunge_no_lock(struct claws_mailmbox_folder * folder)
     goto err;
   }
   
-  claws_mailmbox_timestamp(folder);
-
-  folder->mb_changed = FALSE;
-  folder->mb_deleted_count = 0;
-  
   return MAILMBOX_NO_ERROR;
 
  unlink:
@@ -1321,6 +1546,38 @@ int claws_mailmbox_expunge_no_lock(struct claws_mailmbox_folder * folder)
   return res;
 }
 
+int claws_mailmbox_expunge_no_lock(struct claws_mailmbox_folder * folder)
+{
+  int r;
+
+  if (folder->mb_read_only)
+    return MAILMBOX_ERROR_READONLY;
+
+  if (((folder->mb_written_uid >= folder->mb_max_uid) || folder->mb_no_uid) &&
+      (!folder->mb_changed)) {
+    /* no need to expunge */
+    return MAILMBOX_NO_ERROR;
+  }
+
+  r = claws_mailmbox_expunge_in_place_no_lock(folder);
+  if (r == MAILMBOX_ERROR_INVAL) {
+    debug_print("%s can't be compacted in place, copying it\n",
+        folder->mb_filename);
+    r = claws_mailmbox_expunge_copy_no_lock(folder);
+  }
+  if (r != MAILMBOX_NO_ERROR)
+    return r;
+
+  claws_mailmbox_timestamp(folder);
+  claws_mailmbox_index_stamp(folder);
+  claws_mailmbox_index_save(folder);
+
+  folder->mb_changed = FALSE;
+  folder->mb_deleted_count = 0;
+  
+  return MAILMBOX_NO_ERROR;
+}
+
 int claws_mailmbox_expunge(struct claws_mailmbox_folder * folder)
 {
   int r;
@@ -1388,12 +1645,13 @@ int claws_mailmbox_delete_msg(struct claws_mailmbox_folder * folder, uint32_t ui
 
   - lock the file
 
-  - parse memory
+  - load the index if any, parse memory
 
   - unlock the file
 */
 
 int claws_mailmbox_init(const char * filename,
+		  const char * index_filename,
 		  int force_readonly,
 		  int force_no_uid,
 		  uint32_t default_written_uid,
@@ -1412,6 +1670,10 @@ int claws_mailmbox_init(const char * filename,
   folder->mb_no_uid = force_no_uid;
   folder->mb_read_only = force_readonly;
   folder->mb_written_uid = default_written_uid;
+  if (index_filename != NULL) {
+    strncpy(folder->mb_index_filename, index_filename, PATH_MAX - 1);
+    folder->mb_index_filename[PATH_MAX - 1] = '\0';
+  }
   
   folder->mb_changed = FALSE;
   folder->mb_deleted_count = 0;
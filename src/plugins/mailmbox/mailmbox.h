@@ -74,6 +74,7 @@ int claws_mailmbox_expunge(struct claws_mailmbox_folder * folder);
 int claws_mailmbox_delete_msg(struct claws_mailmbox_folder * folder, uint32_t uid);
 
 int claws_mailmbox_init(const char * filename,
+		  const char * index_filename,
 		  int force_readonly,
 		  int force_no_uid,
 		  uint32_t default_written_uid,
@@ -100,6 +101,8 @@ void claws_mailmbox_unmap(struct claws_mailmbox_folder * folder);
 
 void claws_mailmbox_sync(struct claws_mailmbox_folder * folder);
 
+void claws_mailmbox_timestamp(struct claws_mailmbox_folder * folder);
+
 
 /* open & close file */
 
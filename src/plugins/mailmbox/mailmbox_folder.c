@@ -56,6 +56,7 @@
 #include "mailmbox.h"
 #include "mailmbox_folder.h"
 #include "mailmbox_parse.h"
+#include "mailmbox_index.h"
 #include "file-utils.h"
 
 #define MAILMBOX_CACHE_DIR           "mailmboxcache"
@@ -209,6 +210,7 @@ static FolderItem *claws_mailmbox_folder_item_new(Folder *folder)
 }
 
 #define MAX_UID_FILE "max-uid"
+#define INDEX_FILE "mbox-index"
 
 static void read_max_uid_value(FolderItem *item, guint * pmax_uid)
 {
@@ -348,12 +350,22 @@ static int claws_mailmbox_item_sync(FolderItem *_item, int validate_uid)
         if (item->mbox == NULL) {
                 guint written_uid;
                 gchar * path;
+                gchar * cache_path;
+                gchar * index;
                 
                 written_uid = 0;
                 read_max_uid_value(_item, &written_uid);
                 path = claws_mailmbox_folder_get_path(_item->folder, _item);
-                r = claws_mailmbox_init(path, 0, 0, written_uid, &item->mbox);
+                cache_path = folder_item_get_path(_item);
+                if (!is_dir_exist(cache_path))
+                        make_dir_hier(cache_path);
+                index = g_strconcat(cache_path, G_DIR_SEPARATOR_S,
+                    INDEX_FILE, NULL);
+                g_free(cache_path);
+                r = claws_mailmbox_init(path, index, 0, 0, written_uid,
+                    &item->mbox);
 		debug_print("init %d: %p\n", r, item->mbox);
+                g_free(index);
                 g_free(path);
                 if (r != MAILMBOX_NO_ERROR)
                         return -1;
@@ -753,6 +765,9 @@ static gint claws_mailmbox_add_msgs(Folder *folder, FolderItem *dest,
         }
 
         claws_mailmbox_sync(mbox);
+        claws_mailmbox_timestamp(mbox);
+        claws_mailmbox_index_stamp(mbox);
+        claws_mailmbox_index_save(mbox);
 
         carray_free(append_list);
         claws_mailmbox_write_unlock(mbox);
@@ -0,0 +1,380 @@
+/*
+ * Claws Mail -- a GTK+ based, lightweight, and fast e-mail client
+ * Copyright (C) 2026 the Claws Mail team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#include "claws-features.h"
+#endif
+
+#include "mailmbox_index.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "file-utils.h"
+#include "utils.h"
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+/*
+  index file layout, native byte order (this is a local cache):
+
+  "CMMBXIDX"
+  header: version, count, parsed size, inode, tail checksum,
+          written uid, max uid
+  count records: uid, written uid flag, start, start len, headers,
+                 headers len, body, body len, size, padding
+
+  all numbers are stored as 64 bits values.
+*/
+
+#define INDEX_MAGIC "CMMBXIDX"
+#define INDEX_MAGIC_LEN 8
+#define INDEX_VERSION 1
+
+#define INDEX_TAIL_SIZE 4096
+
+enum {
+  HDR_VERSION,
+  HDR_COUNT,
+  HDR_SIZE,
+  HDR_INO,
+  HDR_SUM,
+  HDR_WRITTEN_UID,
+  HDR_MAX_UID,
+  HDR_LAST,
+};
+
+enum {
+  REC_UID,
+  REC_WRITTEN_UID,
+  REC_START,
+  REC_START_LEN,
+  REC_HEADERS,
+  REC_HEADERS_LEN,
+  REC_BODY,
+  REC_BODY_LEN,
+  REC_SIZE,
+  REC_PADDING,
+  REC_LAST,
+};
+
+/* FNV-1a of the last bytes before size */
+
+static uint32_t tail_checksum(const char * data, size_t size)
+{
+  uint32_t sum;
+  size_t i;
+
+  sum = 2166136261U;
+  i = 0;
+  if (size > INDEX_TAIL_SIZE)
+    i = size - INDEX_TAIL_SIZE;
+
+  for( ; i < size ; i ++) {
+    sum ^= (unsigned char) data[i];
+    sum *= 16777619U;
+  }
+
+  return sum;
+}
+
+static int get_ino(struct claws_mailmbox_folder * folder, ino_t * result)
+{
+  struct stat buf;
+  int r;
+
+  r = fstat(folder->mb_fd, &buf);
+  if (r < 0)
+    return -1;
+
+  * result = buf.st_ino;
+
+  return 0;
+}
+
+/*
+  remember which part of the file is described by the messages table.
+  must be called after each parse of the mapping.
+*/
+
+void claws_mailmbox_index_stamp(struct claws_mailmbox_folder * folder)
+{
+  ino_t ino;
+
+  if (get_ino(folder, &ino) < 0)
+    ino = 0;
+
+  folder->mb_parsed_ino = ino;
+  folder->mb_parsed_size = folder->mb_mapping_size;
+  folder->mb_parsed_sum = tail_checksum(folder->mb_mapping,
+      folder->mb_mapping_size);
+}
+
+/*
+  returns TRUE when the current mapping starts with the content that
+  was last parsed, ie. when messages were only appended since.
+*/
+
+int claws_mailmbox_index_match(struct claws_mailmbox_folder * folder)
+{
+  ino_t ino;
+
+  if (get_ino(folder, &ino) < 0)
+    return FALSE;
+
+  if (ino != folder->mb_parsed_ino)
+    return FALSE;
+
+  if (folder->mb_mapping_size < folder->mb_parsed_size)
+    return FALSE;
+
+  return (tail_checksum(folder->mb_mapping, folder->mb_parsed_size) ==
+      folder->mb_parsed_sum);
+}
+
+static void flush_tab(struct claws_mailmbox_folder * folder)
+{
+  unsigned int i;
+
+  for(i = 0 ; i < carray_count(folder->mb_tab) ; i ++) {
+    struct claws_mailmbox_msg_info * info;
+
+    info = carray_get(folder->mb_tab, i);
+    claws_mailmbox_msg_info_free(info);
+  }
+
+  chash_clear(folder->mb_hash);
+  carray_set_size(folder->mb_tab, 0);
+}
+
+/*
+  fill the (empty) messages table from the index file.
+  on any mismatch, the table is left empty and the caller has to parse
+  the whole file.
+*/
+
+int claws_mailmbox_index_load(struct claws_mailmbox_folder * folder)
+{
+  FILE * f;
+  char magic[INDEX_MAGIC_LEN];
+  uint64_t hdr[HDR_LAST];
+  uint64_t rec[REC_LAST];
+  uint64_t i;
+  size_t last_end;
+  ino_t ino;
+  int res;
+  int r;
+
+  if (folder->mb_index_filename[0] == '\0')
+    return MAILMBOX_ERROR_FILE_NOT_FOUND;
+
+  if (get_ino(folder, &ino) < 0)
+    return MAILMBOX_ERROR_FILE;
+
+  f = claws_fopen(folder->mb_index_filename, "rb");
+  if (f == NULL)
+    return MAILMBOX_ERROR_FILE_NOT_FOUND;
+
+  if (claws_fread(magic, sizeof(magic), 1, f) != 1 ||
+      memcmp(magic, INDEX_MAGIC, INDEX_MAGIC_LEN) != 0 ||
+      claws_fread(hdr, sizeof(hdr), 1, f) != 1) {
+    res = MAILMBOX_ERROR_PARSE;
+    goto close;
+  }
+
+  if ((hdr[HDR_VERSION] != INDEX_VERSION) ||
+      (hdr[HDR_INO] != (uint64_t) ino) ||
+      (hdr[HDR_SIZE] > folder->mb_mapping_size) ||
+      (tail_checksum(folder->mb_mapping, hdr[HDR_SIZE]) != hdr[HDR_SUM])) {
+    debug_print("index of %s is stale\n", folder->mb_filename);
+    res = MAILMBOX_ERROR_PARSE;
+    goto close;
+  }
+
+  last_end = 0;
+  for(i = 0 ; i < hdr[HDR_COUNT] ; i ++) {
+    struct claws_mailmbox_msg_info * info;
+    unsigned int index;
+    uint32_t uid;
+    chashdatum key;
+    chashdatum data;
+
+    if (claws_fread(rec, sizeof(rec), 1, f) != 1) {
+      res = MAILMBOX_ERROR_PARSE;
+      goto free;
+    }
+
+    uid = rec[REC_UID];
+    if ((uid == 0) || (rec[REC_START] < last_end) ||
+	(rec[REC_START] + rec[REC_SIZE] + rec[REC_PADDING] > hdr[HDR_SIZE])) {
+      res = MAILMBOX_ERROR_PARSE;
+      goto free;
+    }
+    last_end = rec[REC_START] + rec[REC_SIZE] + rec[REC_PADDING];
+
+    key.data = &uid;
+    key.len = sizeof(uid);
+    if (chash_get(folder->mb_hash, &key, &data) == 0) {
+      res = MAILMBOX_ERROR_PARSE;
+      goto free;
+    }
+
+    info = claws_mailmbox_msg_info_new(rec[REC_START], rec[REC_START_LEN],
+        rec[REC_HEADERS], rec[REC_HEADERS_LEN],
+        rec[REC_BODY], rec[REC_BODY_LEN],
+        rec[REC_SIZE], rec[REC_PADDING], uid);
+    if (info == NULL) {
+      res = MAILMBOX_ERROR_MEMORY;
+      goto free;
+    }
+    info->msg_written_uid = (rec[REC_WRITTEN_UID] != 0);
+
+    r = carray_add(folder->mb_tab, info, &index);
+    if (r < 0) {
+      claws_mailmbox_msg_info_free(info);
+      res = MAILMBOX_ERROR_MEMORY;
+      goto free;
+    }
+    info->msg_index = index;
+
+    data.data = info;
+    data.len = 0;
+    r = chash_set(folder->mb_hash, &key, &data, NULL);
+    if (r < 0) {
+      res = MAILMBOX_ERROR_MEMORY;
+      goto free;
+    }
+  }
+
+  claws_fclose(f);
+
+  folder->mb_parsed_ino = ino;
+  folder->mb_parsed_size = hdr[HDR_SIZE];
+  folder->mb_parsed_sum = hdr[HDR_SUM];
+  if (hdr[HDR_WRITTEN_UID] > folder->mb_written_uid)
+    folder->mb_written_uid = hdr[HDR_WRITTEN_UID];
+  if (hdr[HDR_MAX_UID] > folder->mb_max_uid)
+    folder->mb_max_uid = hdr[HDR_MAX_UID];
+
+  debug_print("loaded index of %s: %u messages, %lu bytes\n",
+      folder->mb_filename, carray_count(folder->mb_tab),
+      (unsigned long) folder->mb_parsed_size);
+
+  return MAILMBOX_NO_ERROR;
+
+ free:
+  flush_tab(folder);
+ close:
+  claws_fclose(f);
+  return res;
+}
+
+/*
+  write the index of the part of the file that was last stamped.
+  the index is replaced atomically.
+*/
+
+int claws_mailmbox_index_save(struct claws_mailmbox_folder * folder)
+{
+  char tmpfile[PATH_MAX + 8];
+  FILE * f;
+  uint64_t hdr[HDR_LAST];
+  uint64_t rec[REC_LAST];
+  unsigned int i;
+  int res;
+
+  if (folder->mb_index_filename[0] == '\0')
+    return MAILMBOX_NO_ERROR;
+
+  snprintf(tmpfile, sizeof(tmpfile), "%s.tmp", folder->mb_index_filename);
+
+  f = claws_fopen(tmpfile, "wb");
+  if (f == NULL) {
+    res = MAILMBOX_ERROR_FILE;
+    goto err;
+  }
+
+  hdr[HDR_VERSION] = INDEX_VERSION;
+  hdr[HDR_COUNT] = carray_count(folder->mb_tab);
+  hdr[HDR_SIZE] = folder->mb_parsed_size;
+  hdr[HDR_INO] = folder->mb_parsed_ino;
+  hdr[HDR_SUM] = folder->mb_parsed_sum;
+  hdr[HDR_WRITTEN_UID] = folder->mb_written_uid;
+  hdr[HDR_MAX_UID] = folder->mb_max_uid;
+
+  if (claws_fwrite(INDEX_MAGIC, INDEX_MAGIC_LEN, 1, f) != 1 ||
+      claws_fwrite(hdr, sizeof(hdr), 1, f) != 1) {
+    res = MAILMBOX_ERROR_FILE;
+    goto close;
+  }
+
+  for(i = 0 ; i < carray_count(folder->mb_tab) ; i ++) {
+    struct claws_mailmbox_msg_info * info;
+
+    info = carray_get(folder->mb_tab, i);
+
+    rec[REC_UID] = info->msg_uid;
+    rec[REC_WRITTEN_UID] = info->msg_written_uid;
+    rec[REC_START] = info->msg_start;
+    rec[REC_START_LEN] = info->msg_start_len;
+    rec[REC_HEADERS] = info->msg_headers;
+    rec[REC_HEADERS_LEN] = info->msg_headers_len;
+    rec[REC_BODY] = info->msg_body;
+    rec[REC_BODY_LEN] = info->msg_body_len;
+    rec[REC_SIZE] = info->msg_size;
+    rec[REC_PADDING] = info->msg_padding;
+
+    if (claws_fwrite(rec, sizeof(rec), 1, f) != 1) {
+      res = MAILMBOX_ERROR_FILE;
+      goto close;
+    }
+  }
+
+  if (claws_safe_fclose(f) == EOF) {
+    res = MAILMBOX_ERROR_FILE;
+    goto unlink;
+  }
+
+  if (rename_force(tmpfile, folder->mb_index_filename) < 0) {
+    res = MAILMBOX_ERROR_FILE;
+    goto unlink;
+  }
+
+  return MAILMBOX_NO_ERROR;
+
+ close:
+  claws_fclose(f);
+ unlink:
+  unlink(tmpfile);
+ err:
+  debug_print("could not write index of %s\n", folder->mb_filename);
+  return res;
+}
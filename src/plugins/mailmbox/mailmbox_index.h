@@ -0,0 +1,50 @@
+/*
+ * Claws Mail -- a GTK+ based, lightweight, and fast e-mail client
+ * Copyright (C) 2026 the Claws Mail team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MAILMBOX_INDEX_H
+
+#define MAILMBOX_INDEX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "mailmbox_types.h"
+
+/*
+  the index stores the offsets, sizes and uids of the messages of an
+  mbox file together with a checksum of the last bytes that were
+  parsed. As long as the file only grows behind that point, the
+  messages table can be restored from the index and only the appended
+  part of the file needs to be parsed.
+*/
+
+int claws_mailmbox_index_load(struct claws_mailmbox_folder * folder);
+
+int claws_mailmbox_index_save(struct claws_mailmbox_folder * folder);
+
+void claws_mailmbox_index_stamp(struct claws_mailmbox_folder * folder);
+
+int claws_mailmbox_index_match(struct claws_mailmbox_folder * folder);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
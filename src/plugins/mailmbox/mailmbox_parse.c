@@ -622,3 +622,43 @@ int claws_mailmbox_parse(struct claws_mailmbox_folder * folder)
  err:
   return res;
 }
+
+/*
+  parse the messages appended since the last parse.
+  the mapping must still start with the content described by the
+  messages table (see claws_mailmbox_index_match()).
+*/
+
+int claws_mailmbox_parse_appended(struct claws_mailmbox_folder * folder)
+{
+  size_t cur_token;
+  unsigned int count;
+
+  cur_token = folder->mb_parsed_size;
+
+  count = carray_count(folder->mb_tab);
+  if ((count > 0) && (folder->mb_mapping_size > folder->mb_parsed_size)) {
+    struct claws_mailmbox_msg_info * info;
+
+    info = carray_get(folder->mb_tab, count - 1);
+
+    /* the last message ended at end of file and its padding
+       may have been completed by the appending program,
+       parse it again */
+    if ((!info->msg_deleted) &&
+        (info->msg_start + info->msg_size + info->msg_padding ==
+            folder->mb_parsed_size)) {
+      chashdatum key;
+
+      key.data = &info->msg_uid;
+      key.len = sizeof(info->msg_uid);
+      chash_delete(folder->mb_hash, &key, NULL);
+      carray_delete_slow(folder->mb_tab, count - 1);
+
+      cur_token = info->msg_start;
+      claws_mailmbox_msg_info_free(info);
+    }
+  }
+
+  return claws_mailmbox_parse_additionnal(folder, &cur_token);
+}
@@ -49,6 +49,8 @@ int
 claws_mailmbox_parse_additionnal(struct claws_mailmbox_folder * folder,
 			   size_t * index);
 
+int claws_mailmbox_parse_appended(struct claws_mailmbox_folder * folder);
+
 #ifdef __cplusplus
 }
 #endif
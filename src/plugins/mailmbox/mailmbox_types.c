@@ -209,6 +209,11 @@ struct claws_mailmbox_folder * claws_mailmbox_folder_new(const char * mb_filenam
   folder->mb_written_uid = 0;
   folder->mb_max_uid = 0;
 
+  folder->mb_index_filename[0] = '\0';
+  folder->mb_parsed_ino = 0;
+  folder->mb_parsed_size = 0;
+  folder->mb_parsed_sum = 0;
+
   folder->mb_hash = chash_new(CHASH_DEFAULTSIZE, CHASH_COPYKEY);
   if (folder->mb_hash == NULL)
     goto free;
@@ -82,6 +82,14 @@ struct claws_mailmbox_folder {
 
   chash * mb_hash;
   carray * mb_tab;
+
+  /* persistent offset index, empty when disabled */
+  char mb_index_filename[PATH_MAX];
+
+  /* prefix of the file covered by mb_tab */
+  ino_t mb_parsed_ino;
+  size_t mb_parsed_size;
+  uint32_t mb_parsed_sum;
 };
 
 struct claws_mailmbox_folder * claws_mailmbox_folder_new(const char * mb_filename);
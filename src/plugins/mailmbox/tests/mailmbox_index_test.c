@@ -0,0 +1,401 @@
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mailmbox.h"
+#include "mailmbox_index.h"
+#include "mailmbox_parse.h"
+#include "utils.h"
+
+#include "common/tests/mock_prefs_common_get_use_shred.h"
+#include "common/tests/mock_prefs_common_get_flush_metadata.h"
+
+#define MESSAGE(n, body) \
+	"From sender@example.com Mon Jan  1 00:00:00 2024\n" \
+	"From: sender@example.com\n" \
+	"Subject: message " n "\n" \
+	"\n" \
+	body "\n" \
+	"\n"
+
+static gchar *tmpdir = NULL;
+static gchar *mbox_path = NULL;
+static gchar *index_path = NULL;
+
+static void
+write_mbox(const gchar *content)
+{
+	g_unlink(index_path);
+	g_assert_true(g_file_set_contents(mbox_path, content, -1, NULL));
+}
+
+/* appends as a delivery agent does, keeping the file */
+static void
+append_mbox(const gchar *content)
+{
+	FILE *fp = fopen(mbox_path, "ab");
+
+	g_assert_nonnull(fp);
+	g_assert_cmpint(fputs(content, fp), >=, 0);
+	g_assert_cmpint(fclose(fp), ==, 0);
+}
+
+/* changes a byte of the mbox in place, keeping its size and inode */
+static void
+patch_mbox(const gchar *old, gchar byte)
+{
+	gchar *contents, *p;
+	gsize len;
+	FILE *fp;
+
+	g_assert_true(g_file_get_contents(mbox_path, &contents, &len, NULL));
+	p = strstr(contents, old);
+	g_assert_nonnull(p);
+
+	fp = fopen(mbox_path, "r+b");
+	g_assert_nonnull(fp);
+	g_assert_cmpint(fseek(fp, p - contents, SEEK_SET), ==, 0);
+	g_assert_cmpint(fputc(byte, fp), ==, byte);
+	g_assert_cmpint(fclose(fp), ==, 0);
+	g_free(contents);
+}
+
+static ino_t
+mbox_ino(void)
+{
+	GStatBuf s;
+
+	g_assert_cmpint(g_stat(mbox_path, &s), ==, 0);
+	return s.st_ino;
+}
+
+static struct claws_mailmbox_folder *
+open_folder(const gchar *index, int read_only, int no_uid)
+{
+	struct claws_mailmbox_folder *folder = NULL;
+
+	g_assert_cmpint(claws_mailmbox_init(mbox_path, index, read_only,
+			no_uid, 0, &folder), ==, MAILMBOX_NO_ERROR);
+	return folder;
+}
+
+/* the mbox opened and mapped, with nothing parsed yet */
+static struct claws_mailmbox_folder *
+map_folder(void)
+{
+	struct claws_mailmbox_folder *folder;
+
+	folder = claws_mailmbox_folder_new(mbox_path);
+	g_assert_nonnull(folder);
+	g_strlcpy(folder->mb_index_filename, index_path, PATH_MAX);
+	folder->mb_read_only = TRUE;
+	folder->mb_no_uid = TRUE;
+	g_assert_cmpint(claws_mailmbox_open(folder), ==, MAILMBOX_NO_ERROR);
+	g_assert_cmpint(claws_mailmbox_map(folder), ==, MAILMBOX_NO_ERROR);
+
+	return folder;
+}
+
+static void
+unmap_folder(struct claws_mailmbox_folder *folder)
+{
+	claws_mailmbox_unmap(folder);
+	claws_mailmbox_close(folder);
+	claws_mailmbox_folder_free(folder);
+}
+
+static struct claws_mailmbox_msg_info *
+get_info(struct claws_mailmbox_folder *folder, guint i)
+{
+	return carray_get(folder->mb_tab, i);
+}
+
+/* the messages are contiguous, start with a From line, are found by
+ * their uid and cover the whole file */
+static void
+check_table(struct claws_mailmbox_folder *folder)
+{
+	size_t end = 0;
+	GStatBuf s;
+	guint i;
+
+	for (i = 0; i < carray_count(folder->mb_tab); i++) {
+		struct claws_mailmbox_msg_info *info = get_info(folder, i);
+		chashdatum key, data;
+
+		g_assert_cmpuint(info->msg_index, ==, i);
+		g_assert_cmpuint(info->msg_start, ==, end);
+		g_assert_true(strncmp(folder->mb_mapping + info->msg_start,
+				      "From ", 5) == 0);
+
+		key.data = &info->msg_uid;
+		key.len = sizeof(info->msg_uid);
+		g_assert_cmpint(chash_get(folder->mb_hash, &key, &data), ==, 0);
+		g_assert_true(data.data == info);
+
+		end = info->msg_start + info->msg_size + info->msg_padding;
+	}
+
+	g_assert_cmpuint(end, ==, folder->mb_mapping_size);
+	g_assert_cmpint(g_stat(mbox_path, &s), ==, 0);
+	g_assert_cmpuint(s.st_size, ==, folder->mb_mapping_size);
+}
+
+/* compares the messages table with the one of a full parse */
+static void
+check_same_as_parsed(struct claws_mailmbox_folder *folder, int no_uid)
+{
+	struct claws_mailmbox_folder *parsed = open_folder(NULL, TRUE, no_uid);
+	guint i;
+
+	g_assert_cmpuint(carray_count(folder->mb_tab), ==,
+			 carray_count(parsed->mb_tab));
+
+	for (i = 0; i < carray_count(parsed->mb_tab); i++) {
+		struct claws_mailmbox_msg_info *a = get_info(folder, i);
+		struct claws_mailmbox_msg_info *b = get_info(parsed, i);
+
+		g_assert_cmpuint(a->msg_uid, ==, b->msg_uid);
+		g_assert_cmpint(a->msg_written_uid, ==, b->msg_written_uid);
+		g_assert_cmpuint(a->msg_start, ==, b->msg_start);
+		g_assert_cmpuint(a->msg_start_len, ==, b->msg_start_len);
+		g_assert_cmpuint(a->msg_headers, ==, b->msg_headers);
+		g_assert_cmpuint(a->msg_headers_len, ==, b->msg_headers_len);
+		g_assert_cmpuint(a->msg_body, ==, b->msg_body);
+		g_assert_cmpuint(a->msg_body_len, ==, b->msg_body_len);
+		g_assert_cmpuint(a->msg_size, ==, b->msg_size);
+		g_assert_cmpuint(a->msg_padding, ==, b->msg_padding);
+	}
+
+	claws_mailmbox_done(parsed);
+}
+
+static gboolean
+message_contains(struct claws_mailmbox_folder *folder, guint32 uid,
+		 const gchar *text)
+{
+	const char *data;
+	size_t len;
+	gchar *msg;
+	gboolean found;
+
+	g_assert_cmpint(claws_mailmbox_fetch_msg_no_lock(folder, uid, &data, &len),
+			==, MAILMBOX_NO_ERROR);
+	msg = g_strndup(data, len);
+	found = strstr(msg, text) != NULL;
+	g_free(msg);
+
+	return found;
+}
+
+static void
+test_mailmbox_index_append(void)
+{
+	struct claws_mailmbox_folder *folder;
+	struct claws_mailmbox_msg_info *first, *second;
+
+	write_mbox(MESSAGE("1", "one") MESSAGE("2", "two") MESSAGE("3", "three"));
+
+	folder = open_folder(index_path, FALSE, TRUE);
+	g_assert_cmpuint(carray_count(folder->mb_tab), ==, 3);
+	g_assert_cmpuint(folder->mb_parsed_size, ==, folder->mb_mapping_size);
+	g_assert_true(g_file_test(index_path, G_FILE_TEST_EXISTS));
+	check_table(folder);
+
+	/* only the appended part is parsed: the messages before the last
+	 * one are kept as they are */
+	first = get_info(folder, 0);
+	second = get_info(folder, 1);
+	append_mbox(MESSAGE("4", "four"));
+	g_assert_cmpint(claws_mailmbox_validate_read_lock(folder), ==, MAILMBOX_NO_ERROR);
+	claws_mailmbox_read_unlock(folder);
+
+	g_assert_cmpuint(carray_count(folder->mb_tab), ==, 4);
+	g_assert_true(get_info(folder, 0) == first);
+	g_assert_true(get_info(folder, 1) == second);
+	g_assert_cmpuint(folder->mb_parsed_size, ==, folder->mb_mapping_size);
+	check_table(folder);
+	check_same_as_parsed(folder, TRUE);
+	g_assert_true(message_contains(folder, 4, "Subject: message 4"));
+	claws_mailmbox_done(folder);
+
+	/* the next time, the table comes from the index and what was
+	 * appended since is parsed on top of it */
+	append_mbox(MESSAGE("5", "five"));
+	folder = map_folder();
+	g_assert_cmpint(claws_mailmbox_index_load(folder), ==, MAILMBOX_NO_ERROR);
+	g_assert_cmpuint(carray_count(folder->mb_tab), ==, 4);
+	g_assert_cmpuint(folder->mb_parsed_size, <, folder->mb_mapping_size);
+	g_assert_true(claws_mailmbox_index_match(folder));
+	g_assert_cmpint(claws_mailmbox_parse_appended(folder), ==, MAILMBOX_NO_ERROR);
+	g_assert_cmpuint(carray_count(folder->mb_tab), ==, 5);
+	check_table(folder);
+	check_same_as_parsed(folder, TRUE);
+	unmap_folder(folder);
+
+	folder = open_folder(index_path, FALSE, TRUE);
+	check_table(folder);
+	check_same_as_parsed(folder, TRUE);
+	claws_mailmbox_done(folder);
+}
+
+static void
+test_mailmbox_index_invalidation(void)
+{
+	struct claws_mailmbox_folder *folder;
+	gchar *copy;
+
+	write_mbox(MESSAGE("1", "one") MESSAGE("2", "two") MESSAGE("3", "three"));
+	claws_mailmbox_done(open_folder(index_path, FALSE, TRUE));
+
+	/* an unchanged mbox is described by its index */
+	folder = map_folder();
+	g_assert_cmpint(claws_mailmbox_index_load(folder), ==, MAILMBOX_NO_ERROR);
+	g_assert_cmpuint(carray_count(folder->mb_tab), ==, 3);
+	unmap_folder(folder);
+
+	/* a change before the end of what was indexed, even of the same
+	 * size, makes the index stale */
+	patch_mbox("three", 'T');
+	folder = map_folder();
+	g_assert_cmpint(claws_mailmbox_index_load(folder), ==, MAILMBOX_ERROR_PARSE);
+	g_assert_cmpuint(carray_count(folder->mb_tab), ==, 0);
+	unmap_folder(folder);
+
+	/* it is parsed again, and indexed again */
+	folder = open_folder(index_path, FALSE, TRUE);
+	g_assert_cmpuint(carray_count(folder->mb_tab), ==, 3);
+	check_table(folder);
+	check_same_as_parsed(folder, TRUE);
+	g_assert_true(message_contains(folder, 3, "Three"));
+	claws_mailmbox_done(folder);
+
+	folder = map_folder();
+	g_assert_cmpint(claws_mailmbox_index_load(folder), ==, MAILMBOX_NO_ERROR);
+
+	/* a change seen while open means parsing it all again too */
+	patch_mbox("Three", 't');
+	claws_mailmbox_unmap(folder);
+	g_assert_cmpint(claws_mailmbox_map(folder), ==, MAILMBOX_NO_ERROR);
+	g_assert_false(claws_mailmbox_index_match(folder));
+	unmap_folder(folder);
+
+	/* so does a shorter file */
+	write_mbox(MESSAGE("1", "one"));
+	claws_mailmbox_done(open_folder(index_path, FALSE, TRUE));
+	g_assert_cmpint(truncate(mbox_path, strlen(MESSAGE("1", "one")) - 4), ==, 0);
+	folder = map_folder();
+	g_assert_cmpint(claws_mailmbox_index_load(folder), ==, MAILMBOX_ERROR_PARSE);
+	unmap_folder(folder);
+
+	/* and another file under the same name */
+	write_mbox(MESSAGE("1", "one") MESSAGE("2", "two"));
+	claws_mailmbox_done(open_folder(index_path, FALSE, TRUE));
+	copy = g_strconcat(mbox_path, ".copy", NULL);
+	g_assert_cmpint(g_rename(mbox_path, copy), ==, 0);
+	g_assert_true(g_file_set_contents(mbox_path,
+			MESSAGE("1", "one") MESSAGE("2", "two"), -1, NULL));
+	g_unlink(copy);
+	g_free(copy);
+	folder = map_folder();
+	g_assert_cmpint(claws_mailmbox_index_load(folder), ==, MAILMBOX_ERROR_PARSE);
+	unmap_folder(folder);
+}
+
+static void
+test_mailmbox_index_expunge(void)
+{
+	struct claws_mailmbox_folder *folder;
+	struct claws_mailmbox_msg_info *info;
+	size_t size, removed;
+	ino_t ino;
+	guint i;
+
+	write_mbox(MESSAGE("1", "one")
+		   MESSAGE("2", "a body much longer than the UID lines written "
+			   "in front of the messages that follow it, so that "
+			   "removing it leaves the file shorter")
+		   MESSAGE("3", "three")
+		   MESSAGE("4", "four"));
+	ino = mbox_ino();
+
+	folder = open_folder(index_path, FALSE, FALSE);
+	g_assert_cmpuint(carray_count(folder->mb_tab), ==, 4);
+	size = folder->mb_mapping_size;
+
+	/* writing the UIDs moves the messages towards the end */
+	g_assert_cmpint(claws_mailmbox_expunge(folder), ==, MAILMBOX_NO_ERROR);
+	g_assert_true(mbox_ino() == ino);
+	g_assert_cmpuint(folder->mb_mapping_size, ==,
+			 size + 4 * strlen("X-LibEtPan-UID: 1\n"));
+	check_table(folder);
+	for (i = 0; i < 4; i++) {
+		gchar *line = g_strdup_printf("X-LibEtPan-UID: %u\n", i + 1);
+
+		info = get_info(folder, i);
+		g_assert_cmpuint(info->msg_uid, ==, i + 1);
+		g_assert_true(info->msg_written_uid);
+		g_assert_true(message_contains(folder, i + 1, line));
+		g_free(line);
+	}
+	check_same_as_parsed(folder, FALSE);
+
+	/* removing one moves the following ones towards the start, and
+	 * the file is truncated */
+	info = get_info(folder, 1);
+	removed = info->msg_size + info->msg_padding;
+	size = folder->mb_mapping_size;
+	g_assert_cmpint(claws_mailmbox_delete_msg(folder, 2), ==, MAILMBOX_NO_ERROR);
+	g_assert_cmpint(claws_mailmbox_expunge(folder), ==, MAILMBOX_NO_ERROR);
+	g_assert_true(mbox_ino() == ino);
+	g_assert_cmpuint(folder->mb_mapping_size, ==, size - removed);
+	check_table(folder);
+
+	g_assert_cmpuint(carray_count(folder->mb_tab), ==, 3);
+	g_assert_cmpuint(get_info(folder, 0)->msg_uid, ==, 1);
+	g_assert_cmpuint(get_info(folder, 1)->msg_uid, ==, 3);
+	g_assert_cmpuint(get_info(folder, 2)->msg_uid, ==, 4);
+	g_assert_true(message_contains(folder, 3, "Subject: message 3"));
+	g_assert_true(message_contains(folder, 4, "four"));
+	g_assert_null(g_strstr_len(folder->mb_mapping, folder->mb_mapping_size,
+				   "message 2"));
+	check_same_as_parsed(folder, FALSE);
+	claws_mailmbox_done(folder);
+
+	/* the index describes the file as it is now */
+	folder = map_folder();
+	g_assert_cmpint(claws_mailmbox_index_load(folder), ==, MAILMBOX_NO_ERROR);
+	g_assert_true(claws_mailmbox_index_match(folder));
+	g_assert_cmpuint(folder->mb_parsed_size, ==, folder->mb_mapping_size);
+	check_table(folder);
+	check_same_as_parsed(folder, FALSE);
+	unmap_folder(folder);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int ret;
+
+	g_test_init(&argc, &argv, NULL);
+
+	tmpdir = g_dir_make_tmp("mailmbox_index_test_XXXXXX", NULL);
+	g_assert_nonnull(tmpdir);
+	mbox_path = g_build_filename(tmpdir, "mbox", NULL);
+	index_path = g_build_filename(tmpdir, "mbox.index", NULL);
+
+	g_test_add_func("/plugins/mailmbox/index/append", test_mailmbox_index_append);
+	g_test_add_func("/plugins/mailmbox/index/invalidation", test_mailmbox_index_invalidation);
+	g_test_add_func("/plugins/mailmbox/index/expunge", test_mailmbox_index_expunge);
+
+	ret = g_test_run();
+
+	remove_dir_recursive(tmpdir);
+	g_free(index_path);
+	g_free(mbox_path);
+	g_free(tmpdir);
+
+	return ret;
+}
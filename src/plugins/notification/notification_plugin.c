@@ -54,6 +54,7 @@
 static gboolean my_folder_item_update_hook(gpointer, gpointer);
 static gboolean my_folder_update_hook(gpointer, gpointer);
 static gboolean my_msginfo_update_hook(gpointer, gpointer);
+static gboolean my_msginfo_list_update_hook(gpointer, gpointer);
 static gboolean my_offline_switch_hook(gpointer, gpointer);
 static gboolean my_main_window_close_hook(gpointer, gpointer);
 static gboolean my_main_window_got_iconified_hook(gpointer, gpointer);
@@ -67,6 +68,7 @@ static gboolean trayicon_startup_idle(gpointer);
 static gulong hook_f_item;
 static gulong hook_f;
 static gulong hook_m_info;
+static gulong hook_m_info_list;
 static gulong hook_offline;
 static gulong hook_mw_close;
 static gulong hook_got_iconified;
@@ -206,6 +208,20 @@ static gboolean my_msginfo_update_hook(gpointer source, gpointer data)
   return notification_notified_hash_msginfo_update((MsgInfoUpdate*)source);
 }
 
+static gboolean my_msginfo_list_update_hook(gpointer source, gpointer data)
+{
+  MsgInfoListUpdate *list_update = (MsgInfoListUpdate*)source;
+  MsgInfoUpdate msg_update;
+  GSList *walk;
+
+  msg_update.flags = list_update->flags;
+  for(walk = list_update->msglist; walk; walk = g_slist_next(walk)) {
+    msg_update.msginfo = (MsgInfo*)walk->data;
+    notification_notified_hash_msginfo_update(&msg_update);
+  }
+  return FALSE;
+}
+
 gint plugin_init(gchar **error)
 {
   gchar *rcpath;
@@ -250,6 +266,17 @@ gint plugin_init(gchar **error)
     return -1;
   }
 
+  hook_m_info_list = hooks_register_hook(MSGINFO_LIST_UPDATE_HOOKLIST,
+					 my_msginfo_list_update_hook, NULL);
+  if(hook_m_info_list == 0) {
+    *error = g_strdup(_("Failed to register msginfo update hook in the "
+			"Notification plugin"));
+    hooks_unregister_hook(FOLDER_ITEM_UPDATE_HOOKLIST, hook_f_item);
+    hooks_unregister_hook(FOLDER_UPDATE_HOOKLIST, hook_f);
+    hooks_unregister_hook(MSGINFO_UPDATE_HOOKLIST, hook_m_info);
+    return -1;
+  }
+
   hook_offline = hooks_register_hook(OFFLINE_SWITCH_HOOKLIST,
 				     my_offline_switch_hook, NULL);
   if(hook_offline == 0) {
@@ -258,6 +285,7 @@ gint plugin_init(gchar **error)
     hooks_unregister_hook(FOLDER_ITEM_UPDATE_HOOKLIST, hook_f_item);
     hooks_unregister_hook(FOLDER_UPDATE_HOOKLIST, hook_f);
     hooks_unregister_hook(MSGINFO_UPDATE_HOOKLIST, hook_m_info);
+    hooks_unregister_hook(MSGINFO_LIST_UPDATE_HOOKLIST, hook_m_info_list);
     return -1;
   }
 
@@ -269,6 +297,7 @@ gint plugin_init(gchar **error)
     hooks_unregister_hook(FOLDER_ITEM_UPDATE_HOOKLIST, hook_f_item);
     hooks_unregister_hook(FOLDER_UPDATE_HOOKLIST, hook_f);
     hooks_unregister_hook(MSGINFO_UPDATE_HOOKLIST, hook_m_info);
+    hooks_unregister_hook(MSGINFO_LIST_UPDATE_HOOKLIST, hook_m_info_list);
     hooks_unregister_hook(OFFLINE_SWITCH_HOOKLIST, hook_offline);
     return -1;
   }
@@ -282,6 +311,7 @@ gint plugin_init(gchar **error)
     hooks_unregister_hook(FOLDER_ITEM_UPDATE_HOOKLIST, hook_f_item);
     hooks_unregister_hook(FOLDER_UPDATE_HOOKLIST, hook_f);
     hooks_unregister_hook(MSGINFO_UPDATE_HOOKLIST, hook_m_info);
+    hooks_unregister_hook(MSGINFO_LIST_UPDATE_HOOKLIST, hook_m_info_list);
     hooks_unregister_hook(OFFLINE_SWITCH_HOOKLIST, hook_offline);
     hooks_unregister_hook(MAIN_WINDOW_CLOSE, hook_mw_close);
     return -1;
@@ -295,6 +325,7 @@ gint plugin_init(gchar **error)
     hooks_unregister_hook(FOLDER_ITEM_UPDATE_HOOKLIST, hook_f_item);
     hooks_unregister_hook(FOLDER_UPDATE_HOOKLIST, hook_f);
     hooks_unregister_hook(MSGINFO_UPDATE_HOOKLIST, hook_m_info);
+    hooks_unregister_hook(MSGINFO_LIST_UPDATE_HOOKLIST, hook_m_info_list);
     hooks_unregister_hook(OFFLINE_SWITCH_HOOKLIST, hook_offline);
     hooks_unregister_hook(MAIN_WINDOW_CLOSE, hook_mw_close);
     hooks_unregister_hook(MAIN_WINDOW_GOT_ICONIFIED, hook_got_iconified);
@@ -308,6 +339,7 @@ gint plugin_init(gchar **error)
     hooks_unregister_hook(FOLDER_ITEM_UPDATE_HOOKLIST, hook_f_item);
     hooks_unregister_hook(FOLDER_UPDATE_HOOKLIST, hook_f);
     hooks_unregister_hook(MSGINFO_UPDATE_HOOKLIST, hook_m_info);
+    hooks_unregister_hook(MSGINFO_LIST_UPDATE_HOOKLIST, hook_m_info_list);
     hooks_unregister_hook(OFFLINE_SWITCH_HOOKLIST, hook_offline);
     hooks_unregister_hook(MAIN_WINDOW_CLOSE, hook_mw_close);
     hooks_unregister_hook(MAIN_WINDOW_GOT_ICONIFIED, hook_got_iconified);
@@ -367,6 +399,7 @@ gboolean plugin_done(void)
   hooks_unregister_hook(FOLDER_ITEM_UPDATE_HOOKLIST, hook_f_item);
   hooks_unregister_hook(FOLDER_UPDATE_HOOKLIST, hook_f);
   hooks_unregister_hook(MSGINFO_UPDATE_HOOKLIST, hook_m_info);
+  hooks_unregister_hook(MSGINFO_LIST_UPDATE_HOOKLIST, hook_m_info_list);
   hooks_unregister_hook(OFFLINE_SWITCH_HOOKLIST, hook_offline);
   hooks_unregister_hook(MAIN_WINDOW_CLOSE, hook_mw_close);
   hooks_unregister_hook(MAIN_WINDOW_GOT_ICONIFIED, hook_got_iconified);
@@ -20,6 +20,7 @@
 #define __USE_GNU
 
 #include <stdlib.h>
+#include <sys/select.h>
 #include <glib.h>
 #include <curl/curl.h>
 #include <expat.h>
@@ -56,6 +57,9 @@ Feed *feed_new(gchar *url)
 	feed->ssl_verify_peer = TRUE;
 	feed->cacert_file = NULL;
 
+	feed->etag = NULL;
+	feed->last_modified = NULL;
+
 	return feed;
 }
 
@@ -95,6 +99,8 @@ void feed_free(Feed *feed)
 	g_free(feed->fetcherr);
 	g_free(feed->cookies_path);
 	g_free(feed->cacert_file);
+	g_free(feed->etag);
+	g_free(feed->last_modified);
 
 	if( feed->items != NULL ) {
 		g_slist_foreach(feed->items, _free_items, NULL);
@@ -243,24 +249,86 @@ FeedItem *feed_nth_item(Feed *feed, guint n)
 	return g_slist_nth_data(feed->items, n);
 }
 
-/* feed_update()
- * Takes initialized feed with url set, fetches the feed from this url,
- * updates rest of Feed struct members and returns HTTP response code
- * we got from url's server. */
-guint feed_update(Feed *feed, time_t last_update)
+/* Everything needed while a feed is being fetched. */
+typedef struct _FeedTransfer {
+	Feed *feed;
+	CURL *eh;
+	FeedParserCtx *ctx;
+	struct curl_slist *headers;
+	gchar *etag;
+	gchar *last_modified;
+} FeedTransfer;
+
+/* feed_headerfunc()
+ * Remembers the cache validators sent by the server. Headers of
+ * intermediate responses (redirects) are forgotten. */
+static size_t feed_headerfunc(char *ptr, size_t size, size_t nmemb,
+		void *data)
+{
+	FeedTransfer *tr = (FeedTransfer *)data;
+	size_t len = size * nmemb;
+	gchar *line = g_strndup(ptr, len);
+
+	g_strstrip(line);
+
+	if( !g_ascii_strncasecmp(line, "HTTP/", 5) ) {
+		g_free(tr->etag);
+		tr->etag = NULL;
+		g_free(tr->last_modified);
+		tr->last_modified = NULL;
+	} else if( !g_ascii_strncasecmp(line, "ETag:", 5) ) {
+		g_free(tr->etag);
+		tr->etag = g_strdup(g_strstrip(line + 5));
+	} else if( !g_ascii_strncasecmp(line, "Last-Modified:", 14) ) {
+		g_free(tr->last_modified);
+		tr->last_modified = g_strdup(g_strstrip(line + 14));
+	}
+
+	g_free(line);
+
+	return len;
+}
+
+static void feed_transfer_free(FeedTransfer *tr)
+{
+	FeedParserCtx *feed_ctx = tr->ctx;
+
+	curl_easy_cleanup(tr->eh);
+	if (tr->headers != NULL)
+		curl_slist_free_all(tr->headers);
+
+	XML_ParserFree(feed_ctx->parser);
+	g_free(feed_ctx->name);
+	g_free(feed_ctx->mail);
+	if (feed_ctx->str != NULL)
+		g_string_free(feed_ctx->str, TRUE);
+	if (feed_ctx->xhtml_str != NULL)
+		g_string_free(feed_ctx->xhtml_str, TRUE);
+	g_free(feed_ctx);
+
+	g_free(tr->etag);
+	g_free(tr->last_modified);
+	g_free(tr);
+}
+
+/* feed_transfer_new()
+ * Creates the curl handle and parser context for fetching a feed.
+ * Returns NULL and sets error if that is not possible. */
+static FeedTransfer *feed_transfer_new(Feed *feed, time_t last_update,
+		guint *error)
 {
+	FeedTransfer *tr = NULL;
 	CURL *eh = NULL;
-	CURLcode res;
 	FeedParserCtx *feed_ctx = NULL;
-	glong response_code = 0;
-
-	g_return_val_if_fail(feed != NULL, FEED_ERR_NOFEED);
-	g_return_val_if_fail(feed->url != NULL, FEED_ERR_NOURL);
+	gchar *tmp;
 
 	/* Init curl before anything else. */
 	eh = curl_easy_init();
 
-	g_return_val_if_fail(eh != NULL, FEED_ERR_INIT);
+	if (eh == NULL) {
+		*error = FEED_ERR_INIT;
+		return NULL;
+	}
 
 	/* Curl initialized, create parser context now. */
 	feed_ctx = malloc( sizeof(FeedParserCtx) );
@@ -281,6 +349,11 @@ guint feed_update(Feed *feed, time_t last_update)
 	 * correct parser later. */
 	feed_parser_set_expat_handlers(feed_ctx);
 
+	tr = g_new0(FeedTransfer, 1);
+	tr->feed = feed;
+	tr->eh = eh;
+	tr->ctx = feed_ctx;
+
 	curl_easy_setopt(eh, CURLOPT_URL, feed->url);
 	curl_easy_setopt(eh, CURLOPT_NOPROGRESS, 1);
 #ifdef CURLOPT_MUTE
@@ -288,6 +361,8 @@ guint feed_update(Feed *feed, time_t last_update)
 #endif
 	curl_easy_setopt(eh, CURLOPT_WRITEFUNCTION, feed_writefunc);
 	curl_easy_setopt(eh, CURLOPT_WRITEDATA, feed_ctx);
+	curl_easy_setopt(eh, CURLOPT_HEADERFUNCTION, feed_headerfunc);
+	curl_easy_setopt(eh, CURLOPT_HEADERDATA, tr);
 	curl_easy_setopt(eh, CURLOPT_FOLLOWLOCATION, 1);
 	curl_easy_setopt(eh, CURLOPT_MAXREDIRS, 3);
 	curl_easy_setopt(eh, CURLOPT_TIMEOUT, feed->timeout);
@@ -296,9 +371,22 @@ guint feed_update(Feed *feed, time_t last_update)
 	curl_easy_setopt(eh, CURLOPT_USERAGENT, "libfeed 0.1");
 	curl_easy_setopt(eh, CURLOPT_NETRC, CURL_NETRC_OPTIONAL);
 
-	/* Use HTTP's If-Modified-Since feature, if application provided
-	 * the timestamp of last update. */
-	if( last_update != -1 ) {
+	/* Make the request conditional if we know the validators from
+	 * the previous response. Otherwise, use HTTP's If-Modified-Since
+	 * feature, if application provided the timestamp of last update. */
+	if( feed->etag != NULL || feed->last_modified != NULL ) {
+		if( feed->etag != NULL ) {
+			tmp = g_strdup_printf("If-None-Match: %s", feed->etag);
+			tr->headers = curl_slist_append(tr->headers, tmp);
+			g_free(tmp);
+		}
+		if( feed->last_modified != NULL ) {
+			tmp = g_strdup_printf("If-Modified-Since: %s", feed->last_modified);
+			tr->headers = curl_slist_append(tr->headers, tmp);
+			g_free(tmp);
+		}
+		curl_easy_setopt(eh, CURLOPT_HTTPHEADER, tr->headers);
+	} else if( last_update != -1 ) {
 		curl_easy_setopt(eh, CURLOPT_TIMECONDITION,
 				CURL_TIMECOND_IFMODSINCE);
 		curl_easy_setopt(eh, CURLOPT_TIMEVALUE, (long)last_update);
@@ -329,37 +417,156 @@ guint feed_update(Feed *feed, time_t last_update)
 					 feed->auth->password);
 			break;
 		default:
-			response_code = FEED_ERR_UNAUTH; /* unknown auth */
-			goto cleanup;
+			*error = FEED_ERR_UNAUTH; /* unknown auth */
+			feed_transfer_free(tr);
+			return NULL;
 		}
 	}
 
-	res = curl_easy_perform(eh);
-	XML_Parse(feed_ctx->parser, "", 0, TRUE);
+	return tr;
+}
+
+/* feed_transfer_finish()
+ * Completes parsing of a fetched feed, stores the cache validators and
+ * frees the transfer. Returns HTTP response code or FEED_ERR_FETCH. */
+static guint feed_transfer_finish(FeedTransfer *tr, CURLcode res)
+{
+	Feed *feed = tr->feed;
+	glong response_code = 0;
+
+	XML_Parse(tr->ctx->parser, "", 0, TRUE);
 
 	if( res != CURLE_OK ) {
 		feed->fetcherr = g_strdup(curl_easy_strerror(res));
 		response_code = FEED_ERR_FETCH;
 	} else {
-		curl_easy_getinfo(eh, CURLINFO_RESPONSE_CODE, &response_code);
+		curl_easy_getinfo(tr->eh, CURLINFO_RESPONSE_CODE, &response_code);
 	}
 
-cleanup:
-	curl_easy_cleanup(eh);
+	if( response_code == 304 ) {
+		/* Not modified, the server may have sent updated validators. */
+		if( tr->etag != NULL )
+			feed_set_etag(feed, tr->etag);
+		if( tr->last_modified != NULL )
+			feed_set_last_modified(feed, tr->last_modified);
+	} else if( response_code >= 200 && response_code < 300 ) {
+		feed_set_etag(feed, tr->etag);
+		feed_set_last_modified(feed, tr->last_modified);
+	}
 
-	/* Cleanup, we should be done. */
-	XML_ParserFree(feed_ctx->parser);
-	g_free(feed_ctx->name);
-	g_free(feed_ctx->mail);
-	if (feed_ctx->str != NULL)
-		g_string_free(feed_ctx->str, TRUE);
-	if (feed_ctx->xhtml_str != NULL)
-		g_string_free(feed_ctx->xhtml_str, TRUE);
-	g_free(feed_ctx);
+	feed_transfer_free(tr);
 
 	return response_code;
 }
 
+/* feed_update()
+ * Takes initialized feed with url set, fetches the feed from this url,
+ * updates rest of Feed struct members and returns HTTP response code
+ * we got from url's server. */
+guint feed_update(Feed *feed, time_t last_update)
+{
+	FeedTransfer *tr;
+	guint error = 0;
+
+	g_return_val_if_fail(feed != NULL, FEED_ERR_NOFEED);
+	g_return_val_if_fail(feed->url != NULL, FEED_ERR_NOURL);
+
+	if( (tr = feed_transfer_new(feed, last_update, &error)) == NULL )
+		return error;
+
+	return feed_transfer_finish(tr, curl_easy_perform(tr->eh));
+}
+
+/* feed_update_multi()
+ * Fetches n_feeds feeds like feed_update() does, running at most
+ * max_parallel transfers at the same time. func is called from the
+ * calling thread for each feed as soon as it is done. */
+void feed_update_multi(Feed **feeds, guint n_feeds, guint max_parallel,
+		FeedUpdateFunc func, gpointer data)
+{
+	CURLM *mh;
+	CURLMsg *msg;
+	FeedTransfer *tr;
+	Feed *feed;
+	guint next = 0, active = 0, code;
+	gint running, left;
+
+	g_return_if_fail(feeds != NULL || n_feeds == 0);
+
+	if( max_parallel == 0 )
+		max_parallel = 1;
+
+	if( (mh = curl_multi_init()) == NULL ) {
+		/* Fall back to fetching one feed after the other. */
+		for( next = 0; next < n_feeds; next++ ) {
+			code = feed_update(feeds[next], -1);
+			if( func != NULL )
+				func(feeds[next], code, data);
+		}
+		return;
+	}
+
+	while( next < n_feeds || active > 0 ) {
+		/* Keep the pipeline full. */
+		while( active < max_parallel && next < n_feeds ) {
+			code = 0;
+			feed = feeds[next++];
+			if( feed == NULL || feed->url == NULL ) {
+				if( func != NULL )
+					func(feed, FEED_ERR_NOURL, data);
+				continue;
+			}
+			if( (tr = feed_transfer_new(feed, -1, &code)) == NULL ) {
+				if( func != NULL )
+					func(feed, code, data);
+				continue;
+			}
+			curl_easy_setopt(tr->eh, CURLOPT_PRIVATE, tr);
+			curl_multi_add_handle(mh, tr->eh);
+			active++;
+		}
+
+		curl_multi_perform(mh, &running);
+
+		while( (msg = curl_multi_info_read(mh, &left)) != NULL ) {
+			CURLcode res;
+
+			if( msg->msg != CURLMSG_DONE )
+				continue;
+
+			res = msg->data.result;
+			curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&tr);
+			curl_multi_remove_handle(mh, tr->eh);
+			active--;
+
+			feed = tr->feed;
+			code = feed_transfer_finish(tr, res);
+			if( func != NULL )
+				func(feed, code, data);
+		}
+
+		if( active > 0 && running > 0 ) {
+#if LIBCURL_VERSION_NUM >= 0x071c00
+			curl_multi_wait(mh, NULL, 0, 1000, NULL);
+#else
+			fd_set fdread, fdwrite, fdexcep;
+			struct timeval tv;
+			int maxfd = -1;
+
+			FD_ZERO(&fdread);
+			FD_ZERO(&fdwrite);
+			FD_ZERO(&fdexcep);
+			curl_multi_fdset(mh, &fdread, &fdwrite, &fdexcep, &maxfd);
+			tv.tv_sec = 0;
+			tv.tv_usec = (maxfd < 0 ? 100 : 1000) * 1000;
+			select(maxfd + 1, &fdread, &fdwrite, &fdexcep, &tv);
+#endif
+		}
+	}
+
+	curl_multi_cleanup(mh);
+}
+
 void feed_foreach_item(Feed *feed, GFunc func, gpointer data)
 {
 	g_return_if_fail(feed != NULL);
@@ -443,3 +650,39 @@ void feed_set_cacert_file(Feed *feed, const gchar *path)
 
 	feed->cacert_file = (path != NULL ? g_strdup(path) : NULL);
 }
+
+/* Cache validators: sent with the next request, updated from response */
+gchar *feed_get_etag(Feed *feed)
+{
+	g_return_val_if_fail(feed != NULL, NULL);
+	return feed->etag;
+}
+
+void feed_set_etag(Feed *feed, const gchar *etag)
+{
+	g_return_if_fail(feed != NULL);
+
+	if( feed->etag == etag )
+		return;
+
+	g_free(feed->etag);
+	feed->etag = (etag != NULL ? g_strdup(etag) : NULL);
+}
+
+gchar *feed_get_last_modified(Feed *feed)
+{
+	g_return_val_if_fail(feed != NULL, NULL);
+	return feed->last_modified;
+}
+
+void feed_set_last_modified(Feed *feed, const gchar *last_modified)
+{
+	g_return_if_fail(feed != NULL);
+
+	if( feed->last_modified == last_modified )
+		return;
+
+	g_free(feed->last_modified);
+	feed->last_modified = (last_modified != NULL ?
+			g_strdup(last_modified) : NULL);
+}
@@ -61,6 +61,9 @@ struct _Feed {
 	gboolean ssl_verify_peer;
 	gchar *cacert_file;
 
+	gchar *etag;
+	gchar *last_modified;
+
 	GSList *items;
 };
 
@@ -86,6 +89,8 @@ typedef enum {
 	FEED_ERR_UNAUTH
 } FeedErrCodes;
 
+typedef void (*FeedUpdateFunc)(Feed *feed, guint response_code, gpointer data);
+
 /* ---------------- Prototypes */
 
 Feed *feed_new(gchar *url);
@@ -121,6 +126,12 @@ void feed_set_ssl_verify_peer(Feed *feed, gboolean ssl_verify_peer);
 gchar *feed_get_cacert_file(Feed *feed);
 void feed_set_cacert_file(Feed *feed, const gchar *path);
 
+gchar *feed_get_etag(Feed *feed);
+void feed_set_etag(Feed *feed, const gchar *etag);
+
+gchar *feed_get_last_modified(Feed *feed);
+void feed_set_last_modified(Feed *feed, const gchar *last_modified);
+
 gint feed_n_items(Feed *feed);
 FeedItem *feed_nth_item(Feed *feed, guint n);
 
@@ -131,6 +142,8 @@ gboolean feed_append_item(Feed *feed, FeedItem *item);
 gboolean feed_insert_item(Feed *feed, FeedItem *item, gint pos);
 
 guint feed_update(Feed *feed, time_t last_update);
+void feed_update_multi(Feed **feeds, guint n_feeds, guint max_parallel,
+		FeedUpdateFunc func, gpointer data);
 
 #define FILL(n)		do { g_free(n); n = g_strdup(text); } while(0);
 
@@ -1,4 +1,9 @@
 #include <glib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 
 #include "feed.h"
 
@@ -19,12 +24,151 @@ test_Feed_create(void)
 	feed_free(feed);
 }
 
+/* A stand-in HTTP server, serving one RSS feed with an ETag */
+
+#define TEST_ETAG "\"v1\""
+
+static const gchar *test_rss =
+	"<?xml version=\"1.0\"?>\n"
+	"<rss version=\"2.0\"><channel>\n"
+	"<title>Test feed</title>\n"
+	"<link>http://example.com/</link>\n"
+	"<item><title>First</title><guid>1</guid></item>\n"
+	"<item><title>Second</title><guid>2</guid></item>\n"
+	"</channel></rss>\n";
+
+typedef struct {
+	int fd;
+	guint n_requests;
+	guint n_conditional;
+} TestServer;
+
+static gpointer
+test_server_thread(gpointer data)
+{
+	TestServer *server = (TestServer *)data;
+	guint i;
+
+	for (i = 0; i < server->n_requests; i++) {
+		GString *request = g_string_new(NULL);
+		gchar buf[1024], *reply;
+		ssize_t len;
+		int fd;
+
+		fd = accept(server->fd, NULL, NULL);
+		g_assert_cmpint(fd, >=, 0);
+
+		while (strstr(request->str, "\r\n\r\n") == NULL &&
+		       (len = read(fd, buf, sizeof(buf))) > 0)
+			g_string_append_len(request, buf, len);
+
+		if (strstr(request->str, "If-None-Match: " TEST_ETAG) != NULL) {
+			server->n_conditional++;
+			reply = g_strdup("HTTP/1.1 304 Not Modified\r\n"
+					 "ETag: " TEST_ETAG "\r\n"
+					 "Connection: close\r\n\r\n");
+		} else {
+			reply = g_strdup_printf("HTTP/1.1 200 OK\r\n"
+					 "Content-Type: application/rss+xml\r\n"
+					 "ETag: " TEST_ETAG "\r\n"
+					 "Content-Length: %d\r\n"
+					 "Connection: close\r\n\r\n%s",
+					 (gint)strlen(test_rss), test_rss);
+		}
+		g_assert_cmpint(write(fd, reply, strlen(reply)), ==, strlen(reply));
+		close(fd);
+
+		g_free(reply);
+		g_string_free(request, TRUE);
+	}
+
+	return NULL;
+}
+
+static guint16
+test_server_listen(TestServer *server)
+{
+	struct sockaddr_in addr;
+	socklen_t addrlen = sizeof(addr);
+
+	server->fd = socket(AF_INET, SOCK_STREAM, 0);
+	g_assert_cmpint(server->fd, >=, 0);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+	g_assert_cmpint(bind(server->fd, (struct sockaddr *)&addr,
+			     sizeof(addr)), ==, 0);
+	g_assert_cmpint(listen(server->fd, 4), ==, 0);
+	g_assert_cmpint(getsockname(server->fd, (struct sockaddr *)&addr,
+				    &addrlen), ==, 0);
+
+	return ntohs(addr.sin_port);
+}
+
+static void
+test_update_done(Feed *feed, guint response_code, gpointer data)
+{
+	GHashTable *codes = (GHashTable *)data;
+
+	g_hash_table_insert(codes, feed, GUINT_TO_POINTER(response_code));
+}
+
+static void
+test_Feed_update_multi(void)
+{
+	TestServer server = { -1, 3, 0 };
+	GHashTable *codes;
+	GThread *thread;
+	Feed *feeds[2];
+	gchar *url;
+	guint16 port;
+
+	port = test_server_listen(&server);
+	thread = g_thread_new("server", test_server_thread, &server);
+
+	url = g_strdup_printf("http://127.0.0.1:%u/feed.xml", port);
+	feeds[0] = feed_new(url);
+	feeds[1] = feed_new(url);
+	g_free(url);
+
+	/* Both are fetched, and remember the validator */
+	codes = g_hash_table_new(NULL, NULL);
+	feed_update_multi(feeds, 2, 2, test_update_done, codes);
+	g_assert_cmpuint(GPOINTER_TO_UINT(g_hash_table_lookup(codes, feeds[0])),
+			==, 200);
+	g_assert_cmpuint(GPOINTER_TO_UINT(g_hash_table_lookup(codes, feeds[1])),
+			==, 200);
+	g_assert_cmpstr(feed_get_title(feeds[0]), ==, "Test feed");
+	g_assert_cmpint(feed_n_items(feeds[1]), ==, 2);
+	g_assert_cmpstr(feed_get_etag(feeds[0]), ==, TEST_ETAG);
+
+	/* Asking again is conditional, and nothing changed */
+	feed_free_items(feeds[0]);
+	g_hash_table_remove_all(codes);
+	feed_update_multi(feeds, 1, 2, test_update_done, codes);
+	g_assert_cmpuint(GPOINTER_TO_UINT(g_hash_table_lookup(codes, feeds[0])),
+			==, 304);
+	g_assert_cmpint(feed_n_items(feeds[0]), ==, 0);
+
+	g_thread_join(thread);
+	g_assert_cmpuint(server.n_conditional, ==, 1);
+
+	g_hash_table_destroy(codes);
+	feed_free(feeds[0]);
+	feed_free(feeds[1]);
+	close(server.fd);
+}
+
 int
 main(int argc, char *argv[])
 {
 	g_test_init(&argc, &argv, NULL);
 
 	g_test_add_func("/rssyl/libfeed/Feed_create", test_Feed_create);
+	g_test_add_func("/rssyl/libfeed/Feed_update_multi",
+			test_Feed_update_multi);
 
 	return g_test_run();
 }
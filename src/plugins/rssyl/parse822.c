@@ -243,6 +243,99 @@ static void rssyl_flush_folder_func(gpointer data, gpointer user_data)
 	feed_item_free(item);
 }
 
+/* Items of a folder are indexed by their ID and URL, so that incoming
+ * feed items can be matched without walking the whole list. Items
+ * without ID are only counted, they are matched by a full scan. */
+
+void rssyl_folder_items_index_add(RFolderItem *ritem, FeedItem *item)
+{
+	g_return_if_fail(ritem != NULL);
+	g_return_if_fail(item != NULL);
+
+	if( ritem->items_by_id == NULL ) {
+		ritem->items_by_id = g_hash_table_new_full(g_str_hash, g_str_equal,
+				g_free, NULL);
+		ritem->items_by_url = g_hash_table_new_full(g_str_hash, g_str_equal,
+				g_free, NULL);
+	}
+
+	/* Keep the first item if there are duplicates. */
+	if( item->id != NULL ) {
+		if( g_hash_table_lookup(ritem->items_by_id, item->id) == NULL )
+			g_hash_table_insert(ritem->items_by_id, g_strdup(item->id), item);
+	} else
+		ritem->items_without_id++;
+
+	if( item->url != NULL &&
+			g_hash_table_lookup(ritem->items_by_url, item->url) == NULL )
+		g_hash_table_insert(ritem->items_by_url, g_strdup(item->url), item);
+}
+
+static FeedItem *rssyl_folder_items_find_other(RFolderItem *ritem,
+		FeedItem *item, gboolean by_id)
+{
+	GSList *cur;
+
+	for( cur = ritem->items; cur != NULL; cur = cur->next ) {
+		FeedItem *other = (FeedItem *)cur->data;
+
+		if( other == item )
+			continue;
+		if( by_id && !g_strcmp0(other->id, item->id) )
+			return other;
+		if( !by_id && !g_strcmp0(other->url, item->url) )
+			return other;
+	}
+
+	return NULL;
+}
+
+/* Must be called before the item is freed; if it shadowed a duplicate,
+ * the duplicate takes its place in the index. */
+void rssyl_folder_items_index_remove(RFolderItem *ritem, FeedItem *item)
+{
+	FeedItem *other;
+
+	g_return_if_fail(ritem != NULL);
+	g_return_if_fail(item != NULL);
+
+	if( ritem->items_by_id == NULL )
+		return;
+
+	if( item->id == NULL ) {
+		if( ritem->items_without_id > 0 )
+			ritem->items_without_id--;
+	} else if( g_hash_table_lookup(ritem->items_by_id, item->id) == item ) {
+		if( (other = rssyl_folder_items_find_other(ritem, item, TRUE)) != NULL )
+			g_hash_table_insert(ritem->items_by_id, g_strdup(item->id), other);
+		else
+			g_hash_table_remove(ritem->items_by_id, item->id);
+	}
+
+	if( item->url != NULL &&
+			g_hash_table_lookup(ritem->items_by_url, item->url) == item ) {
+		if( (other = rssyl_folder_items_find_other(ritem, item, FALSE)) != NULL )
+			g_hash_table_insert(ritem->items_by_url, g_strdup(item->url), other);
+		else
+			g_hash_table_remove(ritem->items_by_url, item->url);
+	}
+}
+
+void rssyl_folder_items_index_clear(RFolderItem *ritem)
+{
+	g_return_if_fail(ritem != NULL);
+
+	if( ritem->items_by_id != NULL ) {
+		g_hash_table_destroy(ritem->items_by_id);
+		ritem->items_by_id = NULL;
+	}
+	if( ritem->items_by_url != NULL ) {
+		g_hash_table_destroy(ritem->items_by_url);
+		ritem->items_by_url = NULL;
+	}
+	ritem->items_without_id = 0;
+}
+
 static void rssyl_folder_read_existing_real(RFolderItem *ritem)
 {
 	gchar *path = NULL, *fname = NULL;
@@ -261,6 +354,7 @@ static void rssyl_folder_read_existing_real(RFolderItem *ritem)
 	debug_print("RSSyl: reading existing items from '%s'\n", path);
 
 	/* Flush contents if any, so we can add new */
+	rssyl_folder_items_index_clear(ritem);
 	if( g_slist_length(ritem->items) > 0 ) {
 		g_slist_foreach(ritem->items, (GFunc)rssyl_flush_folder_func, NULL);
 		g_slist_free(ritem->items);
@@ -299,6 +393,7 @@ static void rssyl_folder_read_existing_real(RFolderItem *ritem)
 					ritem->last_update = ctx->last_seen;
 				debug_print("RSSyl: Appending '%s'\n", feed_item_get_title(item));
 				ritem->items = g_slist_prepend(ritem->items, item);
+				rssyl_folder_items_index_add(ritem, item);
 			}
 			g_free(fname);
 		}
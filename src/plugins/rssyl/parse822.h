@@ -16,4 +16,8 @@ typedef struct _RFeedCtx RFeedCtx;
 FeedItem *rssyl_parse_folder_item_file(gchar *path);
 void rssyl_folder_read_existing(RFolderItem *ritem);
 
+void rssyl_folder_items_index_add(RFolderItem *ritem, FeedItem *item);
+void rssyl_folder_items_index_remove(RFolderItem *ritem, FeedItem *item);
+void rssyl_folder_items_index_clear(RFolderItem *ritem);
+
 #endif /* __RSSYL_PARSE822_H */
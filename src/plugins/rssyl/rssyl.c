@@ -54,6 +54,7 @@
 #include "rssyl_update_format.h"
 #include "opml_import.h"
 #include "opml_export.h"
+#include "parse822.h"
 #include "strutils.h"
 
 FolderClass rssyl_class;
@@ -164,6 +165,7 @@ void rssyl_init(void)
 
 void rssyl_done(void)
 {
+	rssyl_update_feeds_stop();
 	rssyl_opml_export();
 
 	prefs_toolbar_unregister_plugin_item(TOOLBAR_MAIN, PLUGIN_NAME, _("Refresh all feeds"));
@@ -330,6 +332,16 @@ static void rssyl_item_set_xml(Folder *folder, FolderItem *item, XMLTag *tag)
 		/* (bool) Verify SSL peer  */
 		if( !strcmp(attr->name, "ssl_verify_peer"))
 			ritem->ssl_verify_peer = (atoi(attr->value) == 0 ? FALSE : TRUE );
+		/* (str) ETag of last fetched feed */
+		if( !strcmp(attr->name, "etag")) {
+			g_free(ritem->etag);
+			ritem->etag = g_strdup(attr->value);
+		}
+		/* (str) Last-Modified date of last fetched feed */
+		if( !strcmp(attr->name, "last_modified")) {
+			g_free(ritem->last_modified);
+			ritem->last_modified = g_strdup(attr->value);
+		}
 	}
 }
 
@@ -384,6 +396,12 @@ static XMLTag *rssyl_item_get_xml(Folder *folder, FolderItem *item)
 	/* (bool) Verify SSL peer */
 	xml_tag_add_attr(tag, xml_attr_new("ssl_verify_peer",
 				(ri->ssl_verify_peer ? "1" : "0")) );
+	/* (str) ETag of last fetched feed */
+	if( ri->etag != NULL )
+		xml_tag_add_attr(tag, xml_attr_new("etag", ri->etag));
+	/* (str) Last-Modified date of last fetched feed */
+	if( ri->last_modified != NULL )
+		xml_tag_add_attr(tag, xml_attr_new("last_modified", ri->last_modified));
 
 	return tag;
 }
@@ -446,6 +464,11 @@ static FolderItem *rssyl_item_new(Folder *folder)
 	ritem->fetching_comments = FALSE;
 	ritem->silent_update = 0;
 	ritem->last_update = 0;
+	ritem->etag = NULL;
+	ritem->last_modified = NULL;
+	ritem->items_by_id = NULL;
+	ritem->items_by_url = NULL;
+	ritem->items_without_id = 0;
 	ritem->ignore_title_rename = FALSE;
 	ritem->ssl_verify_peer = TRUE;
 	ritem->feedprop = NULL;
@@ -467,6 +490,9 @@ static void rssyl_item_destroy(Folder *folder, FolderItem *item)
 		g_free(ritem->auth->password);
 	g_free(ritem->auth);
 	g_free(ritem->official_title);
+	g_free(ritem->etag);
+	g_free(ritem->last_modified);
+	rssyl_folder_items_index_clear(ritem);
 	g_slist_free(ritem->items);
 
 	/* Remove a scheduled refresh, if any */
@@ -986,6 +1012,11 @@ static void rssyl_copy_private_data(Folder *folder, FolderItem *oldi,
 	newitem->fetching_comments = olditem->fetching_comments;
 	newitem->last_update = olditem->last_update;
 
+	g_free(newitem->etag);
+	newitem->etag = g_strdup(olditem->etag);
+	g_free(newitem->last_modified);
+	newitem->last_modified = g_strdup(olditem->last_modified);
+
 	dpathold = g_strconcat(rssyl_item_get_path(oldi->folder, oldi),
 			G_DIR_SEPARATOR_S, RSSYL_DELETED_FILE, NULL);
 	dpathnew = g_strconcat(rssyl_item_get_path(newi->folder, newi),
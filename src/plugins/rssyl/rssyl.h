@@ -49,10 +49,19 @@ struct _RFolderItem {
 	gboolean fetching_comments;
 	time_t last_update;
 
+	/* HTTP cache validators of the last successful fetch */
+	gchar *etag;
+	gchar *last_modified;
+
 	struct _RFeedProp *feedprop;
 
 	GSList *items;
 	GSList *deleted_items;
+
+	/* Lookup tables for items, see rssyl_folder_items_index_add() */
+	GHashTable *items_by_id;
+	GHashTable *items_by_url;
+	guint items_without_id;
 };
 
 typedef struct _RFolderItem RFolderItem;
@@ -69,6 +78,7 @@ struct _RFetchCtx {
 	guint response_code;
 	gchar *error;
 	gboolean success;
+	gboolean not_modified;
 	gboolean ready;
 };
 
@@ -249,12 +249,29 @@ static guint rssyl_feed_item_exists(RFolderItem *ritem, FeedItem *fitem,
 	g_return_val_if_fail(ritem != NULL, FALSE);
 	g_return_val_if_fail(fitem != NULL, FALSE);
 
-	if( ritem->items == NULL || g_slist_length(ritem->items) == 0 )
+	if( ritem->items == NULL )
 		return EXISTS_NEW;
 
-	if( (item = g_slist_find_custom(ritem->items,
-					(gconstpointer)fitem, (GCompareFunc)rssyl_cb_feed_compare)) ) {
-		efitem = (FeedItem *)item->data;
+	/* Look the item up in the index first. An item with ID can only
+	 * match a stored item with the same ID, or one without any ID. */
+	if( ritem->items_by_id != NULL ) {
+		if( fitem->id != NULL )
+			efitem = g_hash_table_lookup(ritem->items_by_id, fitem->id);
+		else if( fitem->url != NULL ) {
+			efitem = g_hash_table_lookup(ritem->items_by_url, fitem->url);
+			if( efitem != NULL && rssyl_cb_feed_compare(efitem, fitem) != 0 )
+				efitem = NULL;
+		}
+	}
+
+	if( efitem == NULL && (fitem->id == NULL || ritem->items_by_id == NULL ||
+				ritem->items_without_id > 0) ) {
+		if( (item = g_slist_find_custom(ritem->items,
+						(gconstpointer)fitem, (GCompareFunc)rssyl_cb_feed_compare)) )
+			efitem = (FeedItem *)item->data;
+	}
+
+	if( efitem != NULL ) {
 		if( (changed = rssyl_feed_item_changed(fitem, efitem)) > ITEM_UNCHANGED ) {
 			*oldfitem = efitem;
 			if (changed == ITEM_CHANGED_TEXTONLY)
@@ -388,6 +405,7 @@ void rssyl_add_item(RFolderItem *ritem, FeedItem *feed_item)
 		oldperm_flags = msginfo->flags.perm_flags;
 		procmsg_msginfo_free(&msginfo);
 
+		rssyl_folder_items_index_remove(ritem, old_item);
 		ritem->items = g_slist_remove(ritem->items, old_item);
 		if (g_unlink(ctx->path) != 0) {
 			debug_print("RSSyl: Error, could not delete file '%s': %s\n",
@@ -409,6 +427,7 @@ void rssyl_add_item(RFolderItem *ritem, FeedItem *feed_item)
 	/* Add a new item, formatting its title along the way */
 	debug_print("RSSyl: Adding item '%s'\n", feed_item_get_title(feed_item));
 	ritem->items = g_slist_prepend(ritem->items, feed_item_copy(feed_item));
+	rssyl_folder_items_index_add(ritem, (FeedItem *)ritem->items->data);
 
 	dirname = folder_item_get_path(&ritem->item);
 	template = g_strconcat(dirname, G_DIR_SEPARATOR_S,
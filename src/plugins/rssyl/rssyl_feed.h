@@ -11,6 +11,7 @@
 #define RSSYL_LOG_SUBSCRIBED   _("RSSyl: New feed subscribed: '%s' (%s)\n")
 #define RSSYL_LOG_UPDATING     _("RSSyl: Updating feed: %s\n")
 #define RSSYL_LOG_UPDATED      _("RSSyl: Feed update finished: %s\n")
+#define RSSYL_LOG_NOT_MODIFIED _("RSSyl: Feed not modified since last update: %s\n")
 #define RSSYL_LOG_ERROR_FETCH  _("RSSyl: Error fetching feed at '%s': %s\n")
 #define RSSYL_LOG_ERROR_NOFEED _("RSSyl: No valid feed found at '%s'\n")
 #define RSSYL_LOG_ERROR_PROC   _("RSSyl: Couldn't process feed at '%s'\n")
@@ -53,34 +53,23 @@ static void rssyl_foreach_parse_func(gpointer data, gpointer user_data)
 }
 
 struct _RSSylExpireItemsCtx {
-	gboolean exists;
-	FeedItem *item;
+	GHashTable *fresh_ids;
 	GSList *expired_ids;
 };
 
 typedef struct _RSSylExpireItemsCtx RSSylExpireItemsCtx;
 
-static void expire_items_func(gpointer data, gpointer user_data)
+static void expire_items_collect_func(gpointer data, gpointer user_data)
 {
 	RSSylExpireItemsCtx *ctx = (RSSylExpireItemsCtx *)user_data;
 	FeedItem *item = (FeedItem *)data;
-	gchar *id = NULL, *id2 = NULL;
+	gchar *id = NULL;
 
 	if( (id = feed_item_get_id(item)) == NULL )
 		id = feed_item_get_url(item);
 
-	if( id == NULL )
-		return;
-
-	if( (id2 = feed_item_get_id(ctx->item)) == NULL )
-		id2 = feed_item_get_url(ctx->item);
-
-	if( id2 == NULL )
-		return;
-
-	/* Simply check ID, as we should have up-to-date items right now. */
-	if( !strcmp(id, id2) )
-		ctx->exists = TRUE;
+	if( id != NULL )
+		g_hash_table_insert(ctx->fresh_ids, id, id);
 }
 
 static void rssyl_expire_items(RFolderItem *ritem, Feed *feed)
@@ -89,6 +78,7 @@ static void rssyl_expire_items(RFolderItem *ritem, Feed *feed)
 	GSList *i = NULL;
 	RSSylExpireItemsCtx *ctx = NULL;
 	RFeedCtx *fctx;
+	gchar *id;
 
 	debug_print("RSSyl: rssyl_expire_items()\n");
 
@@ -99,6 +89,12 @@ static void rssyl_expire_items(RFolderItem *ritem, Feed *feed)
 	ctx = malloc( sizeof(RSSylExpireItemsCtx) );
 	ctx->expired_ids = NULL;
 
+	/* Collect IDs of items in the fresh feed, so that each stored item
+	 * can be checked with a single lookup. */
+	ctx->fresh_ids = g_hash_table_new(g_str_hash, g_str_equal);
+	if( feed_n_items(feed) > 0 )
+		feed_foreach_item(feed, expire_items_collect_func, ctx);
+
 	/* Check each locally stored item, if it is still in the upstream
 	 * feed - xnay it if not. */
 	for( i = ritem->items; i != NULL; i = i->next ) {
@@ -109,12 +105,12 @@ static void rssyl_expire_items(RFolderItem *ritem, Feed *feed)
 		if (feed_item_get_parent_id(item) != NULL)
 			continue;
 
-		/* Find matching item in the fresh feed. */
-		ctx->exists = FALSE;
-		ctx->item = item;
-		feed_foreach_item(feed, expire_items_func, ctx);
+		/* Find matching item in the fresh feed. Simply check ID, as we
+		 * should have up-to-date items right now. */
+		if( (id = feed_item_get_id(item)) == NULL )
+			id = feed_item_get_url(item);
 
-		if( !ctx->exists ) {
+		if( id == NULL || g_hash_table_lookup(ctx->fresh_ids, id) == NULL ) {
 			/* No match, add item ids to the list and get rid of it. */
 			debug_print("RSSyl: expiring '%s'\n", feed_item_get_id(item));
 			ctx->expired_ids = g_slist_prepend(ctx->expired_ids,
@@ -150,6 +146,7 @@ static void rssyl_expire_items(RFolderItem *ritem, Feed *feed)
 
 	debug_print("RSSyl: expired %d items\n", g_slist_length(ctx->expired_ids));
 
+	g_hash_table_destroy(ctx->fresh_ids);
 	slist_free_strings_full(ctx->expired_ids);
 	g_free(ctx);
 }
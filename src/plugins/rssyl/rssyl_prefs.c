@@ -59,6 +59,8 @@ static PrefParam param[] = {
 		P_STRING, NULL, NULL, NULL },
 	{ "ssl_verify_peer", "TRUE", &rssyl_prefs.ssl_verify_peer,
 		P_BOOL,	NULL, NULL, NULL },
+	{ "max_parallel_fetches", PREF_DEFAULT_MAX_PARALLEL_FETCHES,
+		&rssyl_prefs.max_parallel_fetches, P_INT, NULL, NULL, NULL },
 	{ 0, 0, 0, 0, 0, 0, 0 }
 };
 
@@ -130,6 +132,8 @@ static void create_rssyl_prefs_page(PrefsPage *page,
 	GtkWidget *label;
 	GtkWidget *refresh_on_startup;
 	GtkObject *refresh_adj;
+	GtkWidget *parallel, *parallel_hbox;
+	GtkObject *parallel_adj;
 	GtkWidget *cookies_path, *cookies_btn, *cookies_hbox;
 	GtkWidget *ssl_verify_peer;
 
@@ -163,6 +167,20 @@ static void create_rssyl_prefs_page(PrefsPage *page,
 			rssyl_prefs.refresh_on_startup);
 	gtk_box_pack_start(GTK_BOX(vbox1), refresh_on_startup, FALSE, FALSE, 0);
 
+	/* How many feeds to fetch at the same time */
+	parallel_hbox = gtk_hbox_new(FALSE, 6);
+	label = gtk_label_new(_("Maximum number of feeds fetched at once"));
+	gtk_box_pack_start(GTK_BOX(parallel_hbox), label, FALSE, FALSE, 0);
+
+	parallel_adj = gtk_adjustment_new(rssyl_prefs.max_parallel_fetches,
+			1, 64, 1, 4, 0);
+	parallel = gtk_spin_button_new(GTK_ADJUSTMENT(parallel_adj), 1, 0);
+	gtk_box_pack_start(GTK_BOX(parallel_hbox), parallel, FALSE, FALSE, 0);
+	gtk_widget_set_tooltip_text(parallel,
+			_("Used when refreshing all feeds or a folder of feeds"));
+
+	gtk_box_pack_start(GTK_BOX(vbox1), parallel_hbox, FALSE, FALSE, 0);
+
 	vbox2 = gtk_vbox_new(FALSE, 6);
 
 	/* Whether to verify SSL peer certificate */
@@ -209,6 +227,7 @@ static void create_rssyl_prefs_page(PrefsPage *page,
 	prefs_page->refresh_on_startup = refresh_on_startup;
 	prefs_page->cookies_path = cookies_path;
 	prefs_page->ssl_verify_peer = ssl_verify_peer;
+	prefs_page->max_parallel_fetches = parallel;
 }
 
 static void destroy_rssyl_prefs_page(PrefsPage *page)
@@ -235,6 +254,8 @@ static void save_rssyl_prefs(PrefsPage *page)
 				GTK_ENTRY(prefs_page->cookies_path)));
 	rssyl_prefs.ssl_verify_peer = gtk_toggle_button_get_active(
 			GTK_TOGGLE_BUTTON(prefs_page->ssl_verify_peer));
+	rssyl_prefs.max_parallel_fetches = gtk_spin_button_get_value_as_int(
+			GTK_SPIN_BUTTON(prefs_page->max_parallel_fetches));
 
 	/* Store prefs in rc file */
 	pref_file = prefs_write_open(rc_file_path);
@@ -26,6 +26,7 @@
 #define PREFS_BLOCK_NAME	"rssyl"
 
 #define PREF_DEFAULT_REFRESH	"180"
+#define PREF_DEFAULT_MAX_PARALLEL_FETCHES	"8"
 
 typedef struct _RPrefs RPrefs;
 
@@ -35,6 +36,7 @@ struct _RPrefs {
 	gboolean refresh_on_startup;
 	gchar *cookies_path;
 	gboolean ssl_verify_peer;
+	gint max_parallel_fetches;
 };
 
 typedef struct _RPrefsPage RPrefsPage;
@@ -46,6 +48,7 @@ struct _RPrefsPage {
 	GtkWidget *refresh_on_startup;
 	GtkWidget *cookies_path;
 	GtkWidget *ssl_verify_peer;
+	GtkWidget *max_parallel_fetches;
 };
 
 void rssyl_prefs_init(void);
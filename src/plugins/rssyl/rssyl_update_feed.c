@@ -35,6 +35,7 @@
 #include <prefs_common.h>
 #include <inc.h>
 #include <main.h>
+#include <folder.h>
 
 /* Local includes */
 #include "libfeed/feed.h"
@@ -45,6 +46,8 @@
 #include "rssyl_prefs.h"
 #include "rssyl_update_comments.h"
 
+static void rssyl_fetch_feed_check(RFetchCtx *ctx, RSSylVerboseFlags verbose);
+
 /* rssyl_fetch_feed_thr() */
 
 static void *rssyl_fetch_feed_thr(void *arg)
@@ -90,8 +93,22 @@ void rssyl_fetch_feed(RFetchCtx *ctx, RSSylVerboseFlags verbose)
 	rssyl_fetch_feed_thr(ctx);
 #endif
 
+	rssyl_fetch_feed_check(ctx, verbose);
+}
+
+/* rssyl_fetch_feed_check()
+ * Interprets the response code of a finished fetch, reporting errors. */
+static void rssyl_fetch_feed_check(RFetchCtx *ctx, RSSylVerboseFlags verbose)
+{
 	debug_print("RSSyl: got response_code %d\n", ctx->response_code);
 
+	if( ctx->response_code == 304 ) {
+		/* Conditional request, nothing changed since last fetch. */
+		debug_print("RSSyl: feed not modified\n");
+		ctx->not_modified = TRUE;
+		return;
+	}
+
 	if( ctx->response_code == FEED_ERR_INIT ) {
 		debug_print("RSSyl: libfeed reports init error from libcurl\n");
 		ctx->error = g_strdup("Internal error");
@@ -178,6 +195,8 @@ RFetchCtx *rssyl_prep_fetchctx_from_item(RFolderItem *ritem)
 	feed_set_cookies_path(ctx->feed, rssyl_prefs_get()->cookies_path);
 	feed_set_ssl_verify_peer(ctx->feed, ritem->ssl_verify_peer);
 	feed_set_auth(ctx->feed, ritem->auth);
+	feed_set_etag(ctx->feed, ritem->etag);
+	feed_set_last_modified(ctx->feed, ritem->last_modified);
 #ifdef G_OS_WIN32
 	if (!g_ascii_strncasecmp(ritem->url, "https", 5)) {
 		feed_set_cacert_file(ctx->feed, claws_ssl_get_cert_file());
@@ -213,52 +232,54 @@ RFetchCtx *rssyl_prep_fetchctx_from_url(gchar *url)
 	return ctx;
 }
 
-/* rssyl_update_feed() */
-
-gboolean rssyl_update_feed(RFolderItem *ritem, RSSylVerboseFlags verbose)
+static void rssyl_fetchctx_free(RFetchCtx *ctx)
 {
-	RFetchCtx *ctx = NULL;
-	MainWindow *mainwin = mainwindow_get_mainwindow();
-	gchar *msg = NULL;
-	gboolean success = FALSE;
-
-	g_return_val_if_fail(ritem != NULL, FALSE);
-	g_return_val_if_fail(ritem->url != NULL, FALSE);
-
-	debug_print("RSSyl: starting to update '%s' (%s)\n",
-			ritem->item.name, ritem->url);
-
-	log_print(LOG_PROTOCOL, RSSYL_LOG_UPDATING, ritem->url);
-
-	msg = g_strdup_printf(_("Updating feed '%s'..."), ritem->item.name);
-	STATUSBAR_PUSH(mainwin, msg);
-	g_free(msg);
-
-	GTK_EVENTS_FLUSH();
+	feed_free(ctx->feed);
+	g_free(ctx->error);
+	g_free(ctx);
+}
 
-	/* Prepare context for fetching the feed file */
-	ctx = rssyl_prep_fetchctx_from_item(ritem);
-	g_return_val_if_fail(ctx != NULL, FALSE);
+/* Remember the validators of a fetched feed for the next request. */
+static void rssyl_update_feed_validators(RFolderItem *ritem, Feed *feed)
+{
+	g_free(ritem->etag);
+	ritem->etag = g_strdup(feed_get_etag(feed));
+	g_free(ritem->last_modified);
+	ritem->last_modified = g_strdup(feed_get_last_modified(feed));
+}
 
-	/* Fetch the feed file */
-	rssyl_fetch_feed(ctx, verbose);
+/* rssyl_update_feed_process()
+ * Merges a fetched feed into its folder. Takes ownership of ctx. */
+static gboolean rssyl_update_feed_process(RFolderItem *ritem, RFetchCtx *ctx,
+		RSSylVerboseFlags verbose)
+{
+	gboolean success = FALSE;
 
 	if (ritem->auth != NULL && ritem->auth->password != NULL) {
 		memset(ritem->auth->password, 0, strlen(ritem->auth->password));
 		g_free(ritem->auth->password);
+		ritem->auth->password = NULL;
 	}
 
 	debug_print("RSSyl: fetch done; success == %s\n",
 			ctx->success ? "TRUE" : "FALSE");
 
 	if (!ctx->success) {
-		feed_free(ctx->feed);
-		g_free(ctx->error);
-		g_free(ctx);
-		STATUSBAR_POP(mainwin);
+		rssyl_fetchctx_free(ctx);
 		return FALSE;
 	}
 
+	if (ctx->not_modified) {
+		log_print(LOG_PROTOCOL, RSSYL_LOG_NOT_MODIFIED, ritem->url);
+		rssyl_update_feed_validators(ritem, ctx->feed);
+		rssyl_fetchctx_free(ctx);
+
+		if( !claws_is_exiting() && ritem->fetch_comments )
+			rssyl_update_comments(ritem);
+
+		return TRUE;
+	}
+
 	rssyl_deleted_update(ritem);
 
 	debug_print("RSSyl: STARTING TO PARSE FEED\n");
@@ -279,15 +300,15 @@ gboolean rssyl_update_feed(RFolderItem *ritem, RSSylVerboseFlags verbose)
 	
 	debug_print("RSSyl: FEED PARSED\n");
 
-	STATUSBAR_POP(mainwin);
-
 	if( claws_is_exiting() ) {
-		feed_free(ctx->feed);
-		g_free(ctx->error);
-		g_free(ctx);
+		rssyl_deleted_free(ritem);
+		rssyl_fetchctx_free(ctx);
 		return FALSE;
 	}
 
+	if( ctx->success )
+		rssyl_update_feed_validators(ritem, ctx->feed);
+
 	if( ritem->fetch_comments )
 		rssyl_update_comments(ritem);
 
@@ -299,15 +320,279 @@ gboolean rssyl_update_feed(RFolderItem *ritem, RSSylVerboseFlags verbose)
 
 	/* Clean up. */
 	success = ctx->success;
-	feed_free(ctx->feed);
-	g_free(ctx->error);
-	g_free(ctx);
+	rssyl_fetchctx_free(ctx);
 
 	return success;
 }
 
-static gboolean rssyl_update_recursively_func(GNode *node, gpointer data)
+/* rssyl_update_feed() */
+
+gboolean rssyl_update_feed(RFolderItem *ritem, RSSylVerboseFlags verbose)
+{
+	RFetchCtx *ctx = NULL;
+	MainWindow *mainwin = mainwindow_get_mainwindow();
+	gchar *msg = NULL;
+	gboolean success = FALSE;
+
+	g_return_val_if_fail(ritem != NULL, FALSE);
+	g_return_val_if_fail(ritem->url != NULL, FALSE);
+
+	debug_print("RSSyl: starting to update '%s' (%s)\n",
+			ritem->item.name, ritem->url);
+
+	log_print(LOG_PROTOCOL, RSSYL_LOG_UPDATING, ritem->url);
+
+	msg = g_strdup_printf(_("Updating feed '%s'..."), ritem->item.name);
+	STATUSBAR_PUSH(mainwin, msg);
+	g_free(msg);
+
+	GTK_EVENTS_FLUSH();
+
+	/* Prepare context for fetching the feed file */
+	ctx = rssyl_prep_fetchctx_from_item(ritem);
+	if (ctx == NULL) {
+		STATUSBAR_POP(mainwin);
+		return FALSE;
+	}
+
+	/* Fetch the feed file */
+	rssyl_fetch_feed(ctx, verbose);
+
+	success = rssyl_update_feed_process(ritem, ctx, verbose);
+
+	STATUSBAR_POP(mainwin);
+
+	return success;
+}
+
+/* Fetching several feeds at once */
+
+typedef struct _RFetchManyCtx RFetchManyCtx;
+
+struct _RFetchManyCtx {
+	Feed **feeds;
+	RFetchCtx **ctxs;
+	/* the folders may go away while fetching, they are looked up
+	 * again when the results are merged */
+	gchar **item_ids;
+	guint n_feeds;
+	guint max_parallel;
+	RSSylVerboseFlags verbose;
+	volatile gint done;
+#ifdef USE_PTHREAD
+	pthread_t pt;
+	gboolean threaded;
+#endif
+};
+
+/* The batch being fetched, only one at a time */
+static RFetchManyCtx *rssyl_fetch_many_running = NULL;
+
+static gboolean rssyl_fetch_many_progress_cb(gpointer data)
+{
+	RFetchManyCtx *mctx = (RFetchManyCtx *)data;
+
+	statusbar_progress_all(g_atomic_int_get(&mctx->done), mctx->n_feeds, 1);
+
+	return FALSE;
+}
+
+static void rssyl_fetch_many_done_func(Feed *feed, guint response_code,
+		gpointer data)
+{
+	RFetchManyCtx *mctx = (RFetchManyCtx *)data;
+	guint i;
+
+	for( i = 0; i < mctx->n_feeds; i++ ) {
+		if( mctx->feeds[i] == feed ) {
+			mctx->ctxs[i]->response_code = response_code;
+			break;
+		}
+	}
+
+	g_atomic_int_inc(&mctx->done);
+#ifdef USE_PTHREAD
+	if( mctx->threaded )
+		g_idle_add(rssyl_fetch_many_progress_cb, mctx);
+#endif
+}
+
+static void rssyl_fetch_many_free(RFetchManyCtx *mctx)
+{
+	guint i;
+
+	for( i = 0; i < mctx->n_feeds; i++ ) {
+		if( mctx->ctxs[i] != NULL )
+			rssyl_fetchctx_free(mctx->ctxs[i]);
+		g_free(mctx->item_ids[i]);
+	}
+
+	g_free(mctx->feeds);
+	g_free(mctx->ctxs);
+	g_free(mctx->item_ids);
+	g_free(mctx);
+}
+
+/* rssyl_fetch_many_finish()
+ * Merges the fetched feeds into their folders, in the main thread. */
+static void rssyl_fetch_many_finish(RFetchManyCtx *mctx)
 {
+	MainWindow *mainwin = mainwindow_get_mainwindow();
+	guint i;
+
+#ifdef USE_PTHREAD
+	if( mctx->threaded )
+		pthread_join(mctx->pt, NULL);
+#endif
+	rssyl_fetch_many_running = NULL;
+
+	debug_print("RSSyl: fetched %d feeds\n", mctx->n_feeds);
+	statusbar_progress_all(0, 0, 0);
+
+	for( i = 0; i < mctx->n_feeds; i++ ) {
+		RFetchCtx *ctx = mctx->ctxs[i];
+		FolderItem *item;
+
+		item = folder_find_item_from_identifier(mctx->item_ids[i]);
+		if( item == NULL || !IS_RSSYL_FOLDER_ITEM(item) ||
+				((RFolderItem *)item)->url == NULL ) {
+			debug_print("RSSyl: '%s' went away while fetching\n",
+					mctx->item_ids[i]);
+			continue;
+		}
+
+		if( claws_is_exiting() ) {
+			log_print(LOG_PROTOCOL, RSSYL_LOG_ABORTED_EXITING,
+					((RFolderItem *)item)->url);
+			continue;
+		}
+
+		/* rssyl_update_feed_process() takes ownership of ctx */
+		mctx->ctxs[i] = NULL;
+		rssyl_fetch_feed_check(ctx, mctx->verbose);
+		rssyl_update_feed_process((RFolderItem *)item, ctx, mctx->verbose);
+	}
+
+	STATUSBAR_POP(mainwin);
+
+	rssyl_fetch_many_free(mctx);
+}
+
+static gboolean rssyl_fetch_many_finish_cb(gpointer data)
+{
+	rssyl_fetch_many_finish((RFetchManyCtx *)data);
+
+	return FALSE;
+}
+
+static void *rssyl_fetch_many_thr(void *arg)
+{
+	RFetchManyCtx *mctx = (RFetchManyCtx *)arg;
+
+	feed_update_multi(mctx->feeds, mctx->n_feeds, mctx->max_parallel,
+			rssyl_fetch_many_done_func, mctx);
+
+#ifdef USE_PTHREAD
+	if( mctx->threaded )
+		g_idle_add(rssyl_fetch_many_finish_cb, mctx);
+#endif
+
+	return NULL;
+}
+
+/* rssyl_update_feed_list()
+ * Starts fetching all feeds of the list concurrently, and returns. Once
+ * they are all fetched, they are merged into their folders one after
+ * the other from the main loop. */
+static void rssyl_update_feed_list(GSList *ritems, RSSylVerboseFlags verbose)
+{
+	RFetchManyCtx *mctx;
+	MainWindow *mainwin = mainwindow_get_mainwindow();
+	GSList *cur;
+	gchar *msg;
+	guint n;
+
+	n = g_slist_length(ritems);
+	if( n == 0 )
+		return;
+
+	if( rssyl_fetch_many_running != NULL ) {
+		debug_print("RSSyl: feeds are already being updated\n");
+		return;
+	}
+
+	mctx = g_new0(RFetchManyCtx, 1);
+	mctx->feeds = g_new0(Feed *, n);
+	mctx->ctxs = g_new0(RFetchCtx *, n);
+	mctx->item_ids = g_new0(gchar *, n);
+	mctx->max_parallel = MAX(1, rssyl_prefs_get()->max_parallel_fetches);
+	mctx->verbose = verbose;
+
+	for( cur = ritems; cur != NULL; cur = cur->next ) {
+		RFolderItem *ritem = (RFolderItem *)cur->data;
+		RFetchCtx *ctx;
+
+		log_print(LOG_PROTOCOL, RSSYL_LOG_UPDATING, ritem->url);
+
+		if( (ctx = rssyl_prep_fetchctx_from_item(ritem)) == NULL )
+			continue;
+		mctx->ctxs[mctx->n_feeds] = ctx;
+		mctx->item_ids[mctx->n_feeds] =
+			folder_item_get_identifier(&ritem->item);
+		mctx->feeds[mctx->n_feeds] = ctx->feed;
+		mctx->n_feeds++;
+	}
+
+	debug_print("RSSyl: fetching %d feeds, %d at a time\n",
+			mctx->n_feeds, mctx->max_parallel);
+
+	msg = g_strdup_printf(ngettext("Updating %d feed...",
+				"Updating %d feeds...", mctx->n_feeds), mctx->n_feeds);
+	STATUSBAR_PUSH(mainwin, msg);
+	g_free(msg);
+
+	rssyl_fetch_many_running = mctx;
+
+#ifdef USE_PTHREAD
+	mctx->threaded = TRUE;
+	if( pthread_create(&mctx->pt, NULL, rssyl_fetch_many_thr,
+				(void *)mctx) == 0 )
+		return;
+	/* Bummer, couldn't create thread. Continue non-threaded. */
+	mctx->threaded = FALSE;
+#endif
+	rssyl_fetch_many_thr(mctx);
+	rssyl_fetch_many_finish(mctx);
+}
+
+/* rssyl_update_feeds_stop()
+ * Waits for the feeds being fetched, and drops them unmerged. To be
+ * called before the plugin goes away. */
+void rssyl_update_feeds_stop(void)
+{
+	RFetchManyCtx *mctx = rssyl_fetch_many_running;
+
+	if( mctx == NULL )
+		return;
+
+	debug_print("RSSyl: waiting for the feeds being fetched\n");
+#ifdef USE_PTHREAD
+	if( mctx->threaded )
+		pthread_join(mctx->pt, NULL);
+#endif
+	/* the progress and finish callbacks are all queued by now */
+	while( g_source_remove_by_user_data(mctx) )
+		;
+	rssyl_fetch_many_running = NULL;
+
+	statusbar_progress_all(0, 0, 0);
+	STATUSBAR_POP(mainwindow_get_mainwindow());
+	rssyl_fetch_many_free(mctx);
+}
+
+static gboolean rssyl_collect_feeds_func(GNode *node, gpointer data)
+{
+	GSList **ritems = (GSList **)data;
 	FolderItem *item;
 	RFolderItem *ritem;
 
@@ -318,7 +603,7 @@ static gboolean rssyl_update_recursively_func(GNode *node, gpointer data)
 
 	if( ritem->url != NULL ) {
 		debug_print("RSSyl: Updating feed '%s'\n", item->name);
-		rssyl_update_feed(ritem, 0);
+		*ritems = g_slist_prepend(*ritems, ritem);
 	} else
 		debug_print("RSSyl: Updating in folder '%s'\n", item->name);
 
@@ -327,6 +612,8 @@ static gboolean rssyl_update_recursively_func(GNode *node, gpointer data)
 
 void rssyl_update_recursively(FolderItem *item)
 {
+	GSList *ritems = NULL;
+
 	g_return_if_fail(item != NULL);
 	g_return_if_fail(item->folder != NULL);
 
@@ -336,26 +623,39 @@ void rssyl_update_recursively(FolderItem *item)
 	debug_print("Recursively updating '%s'\n", item->name);
 
 	g_node_traverse(item->node, G_PRE_ORDER, G_TRAVERSE_ALL, -1,
-			rssyl_update_recursively_func, NULL);
+			rssyl_collect_feeds_func, &ritems);
+
+	ritems = g_slist_reverse(ritems);
+	rssyl_update_feed_list(ritems, 0);
+	g_slist_free(ritems);
 }
 
 void rssyl_update_all_func(FolderItem *item, gpointer data)
 {
+	GSList **ritems = (GSList **)data;
+
 	/* Only try to refresh our feed folders */
 	if( !IS_RSSYL_FOLDER_ITEM(item) )
 		return;
 
 	if( folder_item_parent(item) == NULL )
-		rssyl_update_recursively(item);
+		g_node_traverse(item->node, G_PRE_ORDER, G_TRAVERSE_ALL, -1,
+				rssyl_collect_feeds_func, ritems);
 }
 
 void rssyl_update_all_feeds(void)
 {
+	GSList *ritems = NULL;
+
 	if (prefs_common_get_prefs()->work_offline &&
 			!inc_offline_should_override(TRUE,
 				_("Claws Mail needs network access in order to update your feeds.")) ) {
 		return;
 	}
 
-	folder_func_to_all_folders((FolderItemFunc)rssyl_update_all_func, NULL);
+	folder_func_to_all_folders((FolderItemFunc)rssyl_update_all_func, &ritems);
+
+	ritems = g_slist_reverse(ritems);
+	rssyl_update_feed_list(ritems, 0);
+	g_slist_free(ritems);
 }
@@ -16,4 +16,6 @@ void rssyl_update_recursively(FolderItem *item);
 
 void rssyl_update_all_feeds(void);
 
+void rssyl_update_feeds_stop(void);
+
 #endif /* __RSSYL_UPDATE_FEED */
@@ -25,7 +25,6 @@
 #include "defs.h"
 
 #include <sys/types.h>
-#include <sys/wait.h>
 
 #include <glib.h>
 #include <glib/gi18n.h>
@@ -46,6 +45,7 @@
 
 #include "libspamc.h"
 #include "spamassassin.h"
+#include "spamassassin_batch.h"
 #include "inc.h"
 #include "log.h"
 #include "prefs_common.h"
@@ -77,12 +77,8 @@
 
 #define PLUGIN_NAME (_("SpamAssassin"))
 
-enum {
-    CHILD_RUNNING = 1 << 0,
-    TIMEOUT_RUNNING = 1 << 1,
-};
-
 static gulong hook_id = HOOK_NONE;
+static gulong list_hook_id = HOOK_NONE;
 static int flags = SPAMC_RAW_MODE | SPAMC_SAFE_FALLBACK | SPAMC_CHECK_ONLY;
 static MessageCallback message_callback;
 
@@ -123,22 +119,15 @@ static PrefParam param[] = {
 	{NULL, NULL, NULL, P_OTHER, NULL, NULL, NULL}
 };
 
-gboolean timeout_func(gpointer data)
-{
-	gint *running = (gint *) data;
+/* how many messages are checked by spamd at once */
+#define SPAMASSASSIN_MAX_CHILDREN 4
 
-	if (*running & CHILD_RUNNING)
-		return TRUE;
-
-	*running &= ~TIMEOUT_RUNNING;
-	return FALSE;
-}
+/* how many files are given to one learner run */
+#define SPAMASSASSIN_LEARN_BATCH 500
 
-typedef enum {
-	MSG_IS_HAM = 0,
-	MSG_IS_SPAM = 1,
-	MSG_FILTERING_ERROR = 2
-} MsgStatus;
+/* MsgStatus + 1 of the messages classified ahead of the filtering
+ * hook, by MsgInfo */
+static GHashTable *prescanned = NULL;
 
 static void update_flags(void)
 {
@@ -149,64 +138,108 @@ static void update_flags(void)
 		flags &= ~SPAMC_USE_ZLIB;
 }
 
-static MsgStatus msg_is_spam(FILE *fp)
+static void prescanned_free(gpointer data)
 {
-	struct transport trans;
-	struct message m;
-	gboolean is_spam = FALSE;
+	MsgInfo *msginfo = (MsgInfo *) data;
 
-	if (!config.enable)
-		return MSG_IS_HAM;
+	procmsg_msginfo_free(&msginfo);
+}
+
+static void prescanned_set(MsgInfo *msginfo, MsgStatus result)
+{
+	g_hash_table_replace(prescanned, procmsg_msginfo_new_ref(msginfo),
+			     GINT_TO_POINTER(result + 1));
+}
+
+static void prescanned_done(gpointer data, MsgStatus result,
+			    gpointer user_data)
+{
+	prescanned_set((MsgInfo *) data, result);
+}
 
+static SpamAssassinBatch *msg_check_new(void)
+{
 	update_flags();
-	transport_init(&trans);
-	switch (config.transport) {
-	case SPAMASSASSIN_TRANSPORT_LOCALHOST:
-		trans.type = TRANSPORT_LOCALHOST;
-		trans.port = config.port;
-		break;
-	case SPAMASSASSIN_TRANSPORT_TCP:
-		trans.type = TRANSPORT_TCP;
-		trans.hostname = config.hostname;
-		trans.port = config.port;
-		break;
-	case SPAMASSASSIN_TRANSPORT_UNIX:
-		trans.type = TRANSPORT_UNIX;
-		trans.socketpath = config.socket;
-		break;
-	default:
-		return MSG_IS_HAM;
-	}
+	return spamassassin_batch_new(&config, flags, prescanned_done, NULL);
+}
+
+static void whitelist_start(void)
+{
+	gchar *ab_folderpath;
 
-	if (transport_setup(&trans, flags) != EX_OK) {
-		log_error(LOG_PROTOCOL, _("SpamAssassin plugin couldn't connect to spamd.\n"));
-		debug_print("failed to setup transport\n");
-		return MSG_FILTERING_ERROR;
+	if (*config.whitelist_ab_folder == '\0' ||
+		strcasecmp(config.whitelist_ab_folder, "Any") == 0) {
+		/* match the whole addressbook */
+		ab_folderpath = NULL;
+	} else {
+		/* match the specific book/folder of the addressbook */
+		ab_folderpath = config.whitelist_ab_folder;
 	}
 
-	m.type = MESSAGE_NONE;
-	m.max_len = config.max_size * 1024;
-	m.timeout = config.timeout;
+	start_address_completion(ab_folderpath);
+}
+
+/* starts checking msginfo in a child process, unless it can be
+ * classified right away. The address completion must have been started
+ * if whitelisting is enabled. */
+static void msg_check_start(MsgInfo *msginfo, SpamAssassinBatch *batch)
+{
+	FILE *fp = NULL;
 
-	if (message_read(fileno(fp), flags, &m) != EX_OK) {
-		debug_print("failed to read message\n");
-		message_cleanup(&m);
-		return MSG_FILTERING_ERROR;
+	if (config.whitelist_ab && msginfo->from && 
+	    found_in_addressbook(msginfo->from)) {
+		debug_print("message %d is ham (whitelisted)\n", msginfo->msgnum);
+		prescanned_set(msginfo, MSG_IS_WHITELISTED);
+		return;
 	}
 
-	if (message_filter(&trans, config.username, flags, &m) != EX_OK) {
-		log_error(LOG_PROTOCOL, _("SpamAssassin plugin filtering failed.\n"));
-		debug_print("filtering the message failed\n");
-		message_cleanup(&m);
-		return MSG_FILTERING_ERROR;
+	if ((fp = procmsg_open_message(msginfo, FALSE)) == NULL) {
+		debug_print("failed to open message file\n");
+		return;
 	}
 
-	if (m.is_spam == EX_ISSPAM)
-		is_spam = TRUE;
+	spamassassin_batch_check(batch, fp, msginfo);
+	claws_fclose(fp);
+}
+
+static gboolean mail_listfiltering_hook(gpointer source, gpointer data)
+{
+	MailFilteringData *mail_filtering_data = (MailFilteringData *) source;
+	SpamAssassinBatch *batch;
+	GSList *cur;
+	gint total;
+
+	if (!config.enable || config.transport == SPAMASSASSIN_DISABLED ||
+	    mail_filtering_data->msglist == NULL)
+		return FALSE;
+
+	/* results left over by messages other plugins took care of */
+	g_hash_table_remove_all(prescanned);
+
+	total = g_slist_length(mail_filtering_data->msglist);
+	debug_print("Filtering %d messages\n", total);
+	if (message_callback != NULL)
+		message_callback(_("SpamAssassin: filtering messages..."));
 
-	message_cleanup(&m);
+	if (config.whitelist_ab)
+		whitelist_start();
 
-	return is_spam ? MSG_IS_SPAM:MSG_IS_HAM;
+	/* spamd works on up to SPAMASSASSIN_MAX_CHILDREN messages while
+	 * the next ones are opened and checked against the addressbook */
+	batch = msg_check_new();
+	for (cur = mail_filtering_data->msglist; cur; cur = cur->next) {
+		msg_check_start((MsgInfo *) cur->data, batch);
+		spamassassin_batch_wait(batch, SPAMASSASSIN_MAX_CHILDREN - 1);
+	}
+	spamassassin_batch_free(batch);
+
+	if (config.whitelist_ab)
+		end_address_completion();
+
+	debug_print("Filtered %d messages\n", total);
+
+	/* the results are acted upon message by message */
+	return FALSE;
 }
 
 static gboolean mail_filtering_hook(gpointer source, gpointer data)
@@ -215,85 +248,49 @@ static gboolean mail_filtering_hook(gpointer source, gpointer data)
 	MsgInfo *msginfo = mail_filtering_data->msginfo;
 	gboolean is_spam = FALSE, error = FALSE;
 	static gboolean warned_error = FALSE;
-	FILE *fp = NULL;
-	int pid = 0;
-	int status;
+	gpointer result = NULL;
 
 	/* SPAMASSASSIN_DISABLED : keep test for compatibility purpose */
 	if (!config.enable || config.transport == SPAMASSASSIN_DISABLED) {
 		log_warning(LOG_PROTOCOL, _("SpamAssassin plugin is disabled by its preferences.\n"));
 		return FALSE;
 	}
-	debug_print("Filtering message %d\n", msginfo->msgnum);
-	if (message_callback != NULL)
-		message_callback(_("SpamAssassin: filtering message..."));
 
-	if ((fp = procmsg_open_message(msginfo, FALSE)) == NULL) {
-		debug_print("failed to open message file\n");
-		return FALSE;
-	}
+	result = g_hash_table_lookup(prescanned, msginfo);
+	if (result == NULL) {
+		SpamAssassinBatch *batch;
 
-	if (config.whitelist_ab) {
-		gchar *ab_folderpath;
-		gboolean whitelisted = FALSE;
+		debug_print("Filtering message %d\n", msginfo->msgnum);
+		if (message_callback != NULL)
+			message_callback(_("SpamAssassin: filtering message..."));
 
-		if (*config.whitelist_ab_folder == '\0' ||
-			strcasecmp(config.whitelist_ab_folder, "Any") == 0) {
-			/* match the whole addressbook */
-			ab_folderpath = NULL;
-		} else {
-			/* match the specific book/folder of the addressbook */
-			ab_folderpath = config.whitelist_ab_folder;
-		}
+		if (config.whitelist_ab)
+			whitelist_start();
+		batch = msg_check_new();
+		msg_check_start(msginfo, batch);
+		if (config.whitelist_ab)
+			end_address_completion();
+		spamassassin_batch_free(batch);
 
-		start_address_completion(ab_folderpath);
-		if (msginfo->from && 
-		    found_in_addressbook(msginfo->from))
-				whitelisted = TRUE;
-		end_address_completion();
-		
-		if (whitelisted) {
-			debug_print("message is ham (whitelisted)\n");
-			claws_fclose(fp);
+		result = g_hash_table_lookup(prescanned, msginfo);
+		if (result == NULL)
 			return FALSE;
-		}
 	}
-	pid = fork();
-	if (pid == 0) {
-		_exit(msg_is_spam(fp));
-	} else {
-		gint running = 0;
-
-		running |= CHILD_RUNNING;
+	g_hash_table_remove(prescanned, msginfo);
 
-		g_timeout_add(50, timeout_func, &running);
-		running |= TIMEOUT_RUNNING;
-
-		while(running & CHILD_RUNNING) {
-			int ret;
-
-			ret = waitpid(pid, &status, WNOHANG);
-			if (ret == pid) {
-				if (WIFEXITED(status)) {
-					MsgStatus result = MSG_IS_HAM;
-					running &= ~CHILD_RUNNING;
-					result = WEXITSTATUS(status);
-    					is_spam = (result == MSG_IS_SPAM) ? TRUE : FALSE;
-					error = (result == MSG_FILTERING_ERROR);
-				}
-			} if (ret < 0) {
-				running &= ~CHILD_RUNNING;
-			} /* ret == 0 continue */
-	    
-			g_main_context_iteration(NULL, TRUE);
-    		}
-
-		while (running & TIMEOUT_RUNNING)
-			g_main_context_iteration(NULL, TRUE);
+	switch (GPOINTER_TO_INT(result) - 1) {
+	case MSG_IS_WHITELISTED:
+		return FALSE;
+	case MSG_IS_SPAM:
+		is_spam = TRUE;
+		break;
+	case MSG_FILTERING_ERROR:
+		error = TRUE;
+		break;
+	default:
+		break;
 	}
 
-	claws_fclose(fp);
-
 	if (is_spam) {
 		debug_print("message is spam\n");
 		procmsg_msginfo_set_flags(msginfo, MSG_SPAM, 0);
@@ -383,8 +380,11 @@ gchar* spamassassin_create_tmp_spamc_wrapper(gboolean spam)
 	gchar *fname = get_tmp_file();
 
 	if (fname != NULL) {
+		/* feeds every file given as argument to spamd */
 		contents = g_strdup_printf(
-						"spamc -d %s -p %u -u %s -t %u -s %u %s -L %s<\"$*\";exit $?",
+						"r=0;for f in \"$@\";do "
+						"spamc -d %s -p %u -u %s -t %u -s %u %s -L %s<\"$f\"||r=$?;"
+						"done;exit $r",
 						config.hostname, config.port, 
 						config.username, config.timeout,
 						config.max_size * 1024, config.compress?"-z":"",
@@ -399,12 +399,38 @@ gchar* spamassassin_create_tmp_spamc_wrapper(gboolean spam)
 	return fname;
 }
 
+/* runs the learner command in argv followed by the files, synchronously
+ * to prevent system lockdown */
+static void spamassassin_run_learner(GPtrArray *argv, guint nfiles)
+{
+	GError *error = NULL;
+	gint status = 0;
+	gchar *cmd;
+
+	g_ptr_array_add(argv, NULL);
+	cmd = g_strjoinv(" ", (gchar **) argv->pdata);
+	debug_print("%s\n", cmd);
+	if (!g_spawn_sync(NULL, (gchar **) argv->pdata, NULL, G_SPAWN_SEARCH_PATH,
+			  NULL, NULL, NULL, NULL, &status, &error)) {
+		log_error(LOG_PROTOCOL, _("Learning failed; `%s` returned with error:\n%s"),
+			  cmd, error ? error->message : _("Unknown error"));
+		if (error)
+			g_error_free(error);
+	} else if (status != 0) {
+		debug_print("learner returned status %d for %u messages\n",
+			    status, nfiles);
+	}
+	g_free(cmd);
+	g_ptr_array_remove_index(argv, argv->len - 1);
+}
+
 int spamassassin_learn(MsgInfo *msginfo, GSList *msglist, gboolean spam)
 {
-	gchar *cmd = NULL;
-	gchar *file = NULL;
 	const gchar *shell = g_getenv("SHELL");
 	gchar *spamc_wrapper = NULL;
+	GPtrArray *argv;
+	GSList *files = NULL, *cur;
+	guint nargs, nfiles = 0;
 
 	if (msginfo == NULL && msglist == NULL) {
 		return -1;
@@ -419,80 +445,63 @@ int spamassassin_learn(MsgInfo *msginfo, GSList *msglist, gboolean spam)
 	}
 
 	if (msginfo) {
-		file = procmsg_get_message_file(msginfo);
+		gchar *file = procmsg_get_message_file(msginfo);
+
 		if (file == NULL) {
 			return -1;
 		}
-		if (config.transport == SPAMASSASSIN_TRANSPORT_TCP) {
-			spamc_wrapper = spamassassin_create_tmp_spamc_wrapper(spam);
-			if (spamc_wrapper != NULL) {
-				cmd = g_strconcat(shell?shell:"sh", " ",
-								spamc_wrapper, " ", file, NULL);
-			}
-		} else {
-			cmd = g_strdup_printf("sa-learn -u %s%s %s %s",
-							config.username,
-							prefs_common_get_prefs()->work_offline?" -L":"",
-							spam?"--spam":"--ham", file);
-		}
+		files = g_slist_prepend(files, file);
 	}
-	if (msglist) {
-		GSList *cur = msglist;
-		MsgInfo *info;
-
-		if (config.transport == SPAMASSASSIN_TRANSPORT_TCP) {
-			/* execute n-times the spamc command */
-			for (; cur; cur = cur->next) {
-				info = (MsgInfo *)cur->data;
-				gchar *tmpcmd = NULL;
-				gchar *tmpfile = get_tmp_file();
-
-				if (spamc_wrapper == NULL) {
-					spamc_wrapper = spamassassin_create_tmp_spamc_wrapper(spam);
-				}
+	for (cur = msglist; cur; cur = cur->next) {
+		gchar *file = procmsg_get_message_file((MsgInfo *)cur->data);
 
-				if (spamc_wrapper && tmpfile &&
-			    	copy_file(procmsg_get_message_file(info), tmpfile, TRUE) == 0) {
-					tmpcmd = g_strconcat(shell?shell:"sh", " ", spamc_wrapper, " ",
-										tmpfile, NULL);
-					debug_print("%s\n", tmpcmd);
-					execute_command_line(tmpcmd, FALSE, NULL);
-					g_free(tmpcmd);
-				}
-				g_free(tmpfile);
-			}
-			g_free(spamc_wrapper);
-			return 0;
-		} else {
-			cmd = g_strdup_printf("sa-learn -u %s%s %s",
-					config.username,
-					prefs_common_get_prefs()->work_offline?" -L":"",
-					spam?"--spam":"--ham");
-
-			/* concatenate all message tmpfiles to the sa-learn command-line */
-			for (; cur; cur = cur->next) {
-				info = (MsgInfo *)cur->data;
-				gchar *tmpcmd = NULL;
-				gchar *tmpfile = get_tmp_file();
-
-				if (tmpfile &&
-			    	copy_file(procmsg_get_message_file(info), tmpfile, TRUE) == 0) {			
-					tmpcmd = g_strconcat(cmd, " ", tmpfile, NULL);
-					g_free(cmd);
-					cmd = tmpcmd;
-				}
-				g_free(tmpfile);
-			}
-		}
+		if (file != NULL)
+			files = g_slist_prepend(files, file);
 	}
-	if (cmd == NULL) {
+	if (files == NULL) {
 		return -1;
 	}
-	debug_print("%s\n", cmd);
-	/* only run sync calls to sa-learn/spamc to prevent system lockdown */
-	execute_command_line(cmd, FALSE, NULL);
-	g_free(cmd);
-	g_free(spamc_wrapper);
+	files = g_slist_reverse(files);
+
+	/* the message files are given to one learner run rather than
+	 * learning, or copying, them one by one */
+	argv = g_ptr_array_new();
+	if (config.transport == SPAMASSASSIN_TRANSPORT_TCP) {
+		spamc_wrapper = spamassassin_create_tmp_spamc_wrapper(spam);
+		if (spamc_wrapper == NULL) {
+			g_ptr_array_free(argv, TRUE);
+			slist_free_strings_full(files);
+			return -1;
+		}
+		g_ptr_array_add(argv, (gpointer) (shell?shell:"sh"));
+		g_ptr_array_add(argv, spamc_wrapper);
+	} else {
+		g_ptr_array_add(argv, "sa-learn");
+		g_ptr_array_add(argv, "-u");
+		g_ptr_array_add(argv, config.username);
+		if (prefs_common_get_prefs()->work_offline)
+			g_ptr_array_add(argv, "-L");
+		g_ptr_array_add(argv, spam?"--spam":"--ham");
+	}
+	nargs = argv->len;
+
+	for (cur = files; cur; cur = cur->next) {
+		g_ptr_array_add(argv, cur->data);
+		if (++nfiles == SPAMASSASSIN_LEARN_BATCH) {
+			spamassassin_run_learner(argv, nfiles);
+			g_ptr_array_set_size(argv, nargs);
+			nfiles = 0;
+		}
+	}
+	if (nfiles > 0)
+		spamassassin_run_learner(argv, nfiles);
+
+	g_ptr_array_free(argv, TRUE);
+	slist_free_strings_full(files);
+	if (spamc_wrapper != NULL) {
+		claws_unlink(spamc_wrapper);
+		g_free(spamc_wrapper);
+	}
 
 	return 0;
 }
@@ -548,6 +557,7 @@ gint plugin_init(gchar **error)
 	gchar *rcpath;
 
 	hook_id = HOOK_NONE;
+	list_hook_id = HOOK_NONE;
 
 	if (!check_plugin_version(MAKE_NUMERIC_VERSION(2,9,2,72),
 				VERSION_NUMERIC, PLUGIN_NAME, error))
@@ -648,12 +658,20 @@ struct PluginFeature *plugin_provides(void)
 
 void spamassassin_register_hook(void)
 {
+	if (prescanned == NULL)
+		prescanned = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+						   prescanned_free, NULL);
 	if (hook_id == HOOK_NONE)
 		hook_id = hooks_register_hook(MAIL_FILTERING_HOOKLIST, mail_filtering_hook, NULL);
 	if (hook_id == HOOK_NONE) {
 		g_warning("Failed to register mail filtering hook");
 		config.process_emails = FALSE;
+		return;
 	}
+	if (list_hook_id == HOOK_NONE)
+		list_hook_id = hooks_register_hook(MAIL_LISTFILTERING_HOOKLIST, mail_listfiltering_hook, NULL);
+	if (list_hook_id == HOOK_NONE)
+		g_warning("Failed to register mail listfiltering hook");
 }
 
 void spamassassin_unregister_hook(void)
@@ -662,6 +680,14 @@ void spamassassin_unregister_hook(void)
 		hooks_unregister_hook(MAIL_FILTERING_HOOKLIST, hook_id);
 	}
 	hook_id = HOOK_NONE;
+	if (list_hook_id != HOOK_NONE) {
+		hooks_unregister_hook(MAIL_LISTFILTERING_HOOKLIST, list_hook_id);
+	}
+	list_hook_id = HOOK_NONE;
+	if (prescanned != NULL) {
+		g_hash_table_destroy(prescanned);
+		prescanned = NULL;
+	}
 }
 
 FolderItem *spamassassin_get_spam_folder(MsgInfo *msginfo)
@@ -0,0 +1,232 @@
+/*
+ * Claws Mail -- a GTK+ based, lightweight, and fast e-mail client
+ * Copyright (C) 2026 the Claws Mail Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#include "claws-features.h"
+#endif
+
+#include "defs.h"
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <glib.h>
+#include <glib/gi18n.h>
+
+#include "common/utils.h"
+#include "log.h"
+
+#include "libspamc.h"
+#include "spamassassin_batch.h"
+
+#ifdef HAVE_SYSEXITS_H
+#include <sysexits.h>
+#endif
+
+enum {
+    CHILD_RUNNING = 1 << 0,
+    TIMEOUT_RUNNING = 1 << 1,
+};
+
+typedef struct _SpamAssassinChild {
+	pid_t pid;
+	gpointer data;
+} SpamAssassinChild;
+
+struct _SpamAssassinBatch {
+	SpamAssassinConfig *config;
+	int flags;
+	SpamAssassinBatchFunc func;
+	gpointer user_data;
+	GSList *children;
+};
+
+static gboolean timeout_func(gpointer data)
+{
+	gint *running = (gint *) data;
+
+	if (*running & CHILD_RUNNING)
+		return TRUE;
+
+	*running &= ~TIMEOUT_RUNNING;
+	return FALSE;
+}
+
+/* asks spamd about the message read from fd */
+MsgStatus spamassassin_check_fd(SpamAssassinConfig *config, int flags, int fd)
+{
+	struct transport trans;
+	struct message m;
+	gboolean is_spam = FALSE;
+
+	if (!config->enable)
+		return MSG_IS_HAM;
+
+	transport_init(&trans);
+	switch (config->transport) {
+	case SPAMASSASSIN_TRANSPORT_LOCALHOST:
+		trans.type = TRANSPORT_LOCALHOST;
+		trans.port = config->port;
+		break;
+	case SPAMASSASSIN_TRANSPORT_TCP:
+		trans.type = TRANSPORT_TCP;
+		trans.hostname = config->hostname;
+		trans.port = config->port;
+		break;
+	case SPAMASSASSIN_TRANSPORT_UNIX:
+		trans.type = TRANSPORT_UNIX;
+		trans.socketpath = config->socket;
+		break;
+	default:
+		return MSG_IS_HAM;
+	}
+
+	if (transport_setup(&trans, flags) != EX_OK) {
+		log_error(LOG_PROTOCOL, _("SpamAssassin plugin couldn't connect to spamd.\n"));
+		debug_print("failed to setup transport\n");
+		return MSG_FILTERING_ERROR;
+	}
+
+	m.type = MESSAGE_NONE;
+	m.max_len = config->max_size * 1024;
+	m.timeout = config->timeout;
+
+	if (message_read(fd, flags, &m) != EX_OK) {
+		debug_print("failed to read message\n");
+		message_cleanup(&m);
+		return MSG_FILTERING_ERROR;
+	}
+
+	if (message_filter(&trans, config->username, flags, &m) != EX_OK) {
+		log_error(LOG_PROTOCOL, _("SpamAssassin plugin filtering failed.\n"));
+		debug_print("filtering the message failed\n");
+		message_cleanup(&m);
+		return MSG_FILTERING_ERROR;
+	}
+
+	if (m.is_spam == EX_ISSPAM)
+		is_spam = TRUE;
+
+	message_cleanup(&m);
+
+	return is_spam ? MSG_IS_SPAM:MSG_IS_HAM;
+}
+
+SpamAssassinBatch *spamassassin_batch_new(SpamAssassinConfig *config,
+					  int flags,
+					  SpamAssassinBatchFunc func,
+					  gpointer user_data)
+{
+	SpamAssassinBatch *batch = g_new0(SpamAssassinBatch, 1);
+
+	batch->config = config;
+	batch->flags = flags;
+	batch->func = func;
+	batch->user_data = user_data;
+
+	return batch;
+}
+
+/* starts checking the message read from fp in a child process; fp can
+ * be closed right away */
+void spamassassin_batch_check(SpamAssassinBatch *batch, FILE *fp,
+			      gpointer data)
+{
+	SpamAssassinChild *child;
+	int pid;
+
+	pid = fork();
+	if (pid == 0) {
+		_exit(spamassassin_check_fd(batch->config, batch->flags,
+					    fileno(fp)));
+	}
+	if (pid < 0) {
+		debug_print("failed to fork: %s\n", g_strerror(errno));
+		batch->func(data, MSG_FILTERING_ERROR, batch->user_data);
+		return;
+	}
+
+	child = g_new0(SpamAssassinChild, 1);
+	child->pid = pid;
+	child->data = data;
+	batch->children = g_slist_prepend(batch->children, child);
+}
+
+/* collects the children which are done */
+static void spamassassin_batch_reap(SpamAssassinBatch *batch)
+{
+	GSList *cur, *next;
+
+	for (cur = batch->children; cur; cur = next) {
+		SpamAssassinChild *child = (SpamAssassinChild *) cur->data;
+		MsgStatus result = MSG_IS_HAM;
+		int status;
+		int ret;
+
+		next = cur->next;
+		ret = waitpid(child->pid, &status, WNOHANG);
+		if (ret == 0)
+			continue;
+		if (ret == child->pid && WIFEXITED(status))
+			result = WEXITSTATUS(status);
+
+		batch->children = g_slist_delete_link(batch->children, cur);
+		batch->func(child->data, result, batch->user_data);
+		g_free(child);
+	}
+}
+
+/* waits until at most max children are left, keeping the UI alive */
+void spamassassin_batch_wait(SpamAssassinBatch *batch, guint max)
+{
+	gint running = 0;
+
+	spamassassin_batch_reap(batch);
+	if (g_slist_length(batch->children) <= max)
+		return;
+
+	running |= CHILD_RUNNING;
+
+	g_timeout_add(50, timeout_func, &running);
+	running |= TIMEOUT_RUNNING;
+
+	while (running & CHILD_RUNNING) {
+		spamassassin_batch_reap(batch);
+		if (g_slist_length(batch->children) <= max)
+			running &= ~CHILD_RUNNING;
+
+		g_main_context_iteration(NULL, TRUE);
+	}
+
+	while (running & TIMEOUT_RUNNING)
+		g_main_context_iteration(NULL, TRUE);
+}
+
+/* waits for the messages still being checked */
+void spamassassin_batch_free(SpamAssassinBatch *batch)
+{
+	if (batch == NULL)
+		return;
+
+	spamassassin_batch_wait(batch, 0);
+	g_free(batch);
+}
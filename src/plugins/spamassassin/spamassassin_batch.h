@@ -0,0 +1,60 @@
+/*
+ * Claws Mail -- a GTK+ based, lightweight, and fast e-mail client
+ * Copyright (C) 2026 the Claws Mail Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SPAMASSASSIN_BATCH_H
+#define SPAMASSASSIN_BATCH_H 1
+
+#include <glib.h>
+#include <stdio.h>
+
+#include "spamassassin.h"
+
+typedef enum {
+	MSG_IS_HAM = 0,
+	MSG_IS_SPAM = 1,
+	MSG_FILTERING_ERROR = 2,
+	/* never returned by a child, the message wasn't checked */
+	MSG_IS_WHITELISTED = 3
+} MsgStatus;
+
+/* Messages checked by spamd at once, each in its own child process:
+ * libspamc uses global state, so it can't be used from threads. */
+typedef struct _SpamAssassinBatch SpamAssassinBatch;
+
+/* called from spamassassin_batch_wait() with the data given to
+ * spamassassin_batch_check() */
+typedef void (*SpamAssassinBatchFunc) (gpointer data, MsgStatus status,
+				       gpointer user_data);
+
+MsgStatus spamassassin_check_fd	(SpamAssassinConfig	*config,
+				 int			 flags,
+				 int			 fd);
+
+SpamAssassinBatch *spamassassin_batch_new	(SpamAssassinConfig	*config,
+						 int			 flags,
+						 SpamAssassinBatchFunc	 func,
+						 gpointer		 user_data);
+void spamassassin_batch_check			(SpamAssassinBatch	*batch,
+						 FILE			*fp,
+						 gpointer		 data);
+void spamassassin_batch_wait			(SpamAssassinBatch	*batch,
+						 guint			 max);
+void spamassassin_batch_free			(SpamAssassinBatch	*batch);
+
+#endif
@@ -0,0 +1,242 @@
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "spamassassin_batch.h"
+#include "libspamc.h"
+#include "log.h"
+#include "utils.h"
+
+#include "common/tests/mock_prefs_common_get_use_shred.h"
+#include "common/tests/mock_prefs_common_get_flush_metadata.h"
+
+#define N_MESSAGES 10
+
+static gchar *tmpdir = NULL;
+
+/* the children report spamd errors to the log window */
+void log_error(LogInstance instance, const gchar *format, ...)
+{
+}
+
+/* a spamd which answers CHECK requests one connection after the other,
+ * from the X-Verdict header of the messages */
+static void
+fake_spamd_serve(int listenfd)
+{
+	for (;;) {
+		GString *request = g_string_new(NULL);
+		const gchar *reply;
+		gchar buf[1024];
+		ssize_t len;
+		int fd;
+
+		fd = accept(listenfd, NULL, NULL);
+		if (fd < 0)
+			_exit(1);
+
+		/* the request ends when spamc shuts its side down */
+		while ((len = read(fd, buf, sizeof(buf))) > 0)
+			g_string_append_len(request, buf, len);
+
+		if (!g_str_has_prefix(request->str, "CHECK SPAMC/") ||
+		    strstr(request->str, "\r\nUser: tester\r\n") == NULL ||
+		    strstr(request->str, "X-Verdict: garbage") != NULL)
+			reply = "nonsense\r\n";
+		else if (strstr(request->str, "X-Verdict: spam") != NULL)
+			reply = "SPAMD/1.1 0 EX_OK\r\n"
+				"Spam: True ; 15.0 / 5.0\r\n\r\n";
+		else
+			reply = "SPAMD/1.1 0 EX_OK\r\n"
+				"Spam: False ; 0.1 / 5.0\r\n\r\n";
+
+		if (write(fd, reply, strlen(reply)) < 0)
+			_exit(1);
+		close(fd);
+		g_string_free(request, TRUE);
+	}
+}
+
+static pid_t
+fake_spamd_start(const gchar *path)
+{
+	struct sockaddr_un addr;
+	pid_t pid;
+	int fd;
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	g_assert_cmpint(fd, >=, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	g_assert_cmpuint(strlen(path), <, sizeof(addr.sun_path));
+	strcpy(addr.sun_path, path);
+	g_assert_cmpint(bind(fd, (struct sockaddr *)&addr, sizeof(addr)), ==, 0);
+	g_assert_cmpint(listen(fd, N_MESSAGES), ==, 0);
+
+	/* a process rather than a thread, as the batch forks */
+	pid = fork();
+	g_assert_cmpint(pid, >=, 0);
+	if (pid == 0)
+		fake_spamd_serve(fd);
+	close(fd);
+
+	return pid;
+}
+
+static void
+fake_spamd_stop(pid_t pid)
+{
+	int status;
+
+	kill(pid, SIGTERM);
+	g_assert_cmpint(waitpid(pid, &status, 0), ==, pid);
+	/* it didn't give up on its own */
+	g_assert_true(WIFSIGNALED(status));
+}
+
+static const gchar *
+message_verdict(gint i)
+{
+	if (i % 3 == 0)
+		return "spam";
+	if (i == 7)
+		return "garbage";
+	return "ham";
+}
+
+static MsgStatus
+expected_status(gint i)
+{
+	if (i % 3 == 0)
+		return MSG_IS_SPAM;
+	if (i == 7)
+		return MSG_FILTERING_ERROR;
+	return MSG_IS_HAM;
+}
+
+static FILE *
+open_message(gint i)
+{
+	gchar *name = g_strdup_printf("msg%d", i);
+	gchar *path = g_build_filename(tmpdir, name, NULL);
+	gchar *content;
+	FILE *fp;
+
+	content = g_strdup_printf("From: sender%d@example.org\n"
+				  "Subject: message %d\n"
+				  "X-Verdict: %s\n"
+				  "\n"
+				  "body of message %d\n",
+				  i, i, message_verdict(i), i);
+	g_assert_true(g_file_set_contents(path, content, -1, NULL));
+	fp = fopen(path, "rb");
+	g_assert_nonnull(fp);
+
+	g_free(content);
+	g_free(path);
+	g_free(name);
+
+	return fp;
+}
+
+static void
+init_config(SpamAssassinConfig *config, gchar *socket)
+{
+	memset(config, 0, sizeof(*config));
+	config->enable = TRUE;
+	config->transport = SPAMASSASSIN_TRANSPORT_UNIX;
+	config->socket = socket;
+	config->username = "tester";
+	config->max_size = 250;
+	config->timeout = 30;
+}
+
+static void
+batch_done(gpointer data, MsgStatus status, gpointer user_data)
+{
+	GHashTable *results = (GHashTable *) user_data;
+
+	/* each message is reported once */
+	g_assert_false(g_hash_table_lookup_extended(results, data, NULL, NULL));
+	g_hash_table_insert(results, data, GINT_TO_POINTER(status));
+}
+
+static void
+test_batch_verdicts(void)
+{
+	const int flags = SPAMC_RAW_MODE | SPAMC_SAFE_FALLBACK | SPAMC_CHECK_ONLY;
+	gchar *socket = g_build_filename(tmpdir, "spamd.sock", NULL);
+	SpamAssassinConfig config;
+	SpamAssassinBatch *batch;
+	GHashTable *results;
+	pid_t spamd;
+	FILE *fp;
+	gint i;
+
+	spamd = fake_spamd_start(socket);
+	init_config(&config, socket);
+	results = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+	/* all at once, with up to 4 messages in flight */
+	batch = spamassassin_batch_new(&config, flags, batch_done, results);
+	for (i = 0; i < N_MESSAGES; i++) {
+		fp = open_message(i);
+		spamassassin_batch_check(batch, fp, GINT_TO_POINTER(i + 1));
+		fclose(fp);
+		spamassassin_batch_wait(batch, 3);
+		g_assert_cmpint(i + 1 - g_hash_table_size(results), <=, 3);
+	}
+	spamassassin_batch_free(batch);
+
+	g_assert_cmpuint(g_hash_table_size(results), ==, N_MESSAGES);
+	for (i = 0; i < N_MESSAGES; i++) {
+		g_assert_cmpint(GPOINTER_TO_INT(g_hash_table_lookup(results,
+				GINT_TO_POINTER(i + 1))), ==, expected_status(i));
+	}
+
+	/* the same verdicts one by one, without a child */
+	for (i = 0; i < N_MESSAGES; i++) {
+		fp = open_message(i);
+		g_assert_cmpint(spamassassin_check_fd(&config, flags, fileno(fp)),
+				==, expected_status(i));
+		fclose(fp);
+	}
+
+	/* spamd isn't asked when the plugin is disabled */
+	config.enable = FALSE;
+	fp = open_message(0);
+	g_assert_cmpint(spamassassin_check_fd(&config, flags, fileno(fp)),
+			==, MSG_IS_HAM);
+	fclose(fp);
+
+	fake_spamd_stop(spamd);
+	g_hash_table_destroy(results);
+	g_free(socket);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int ret;
+
+	g_test_init(&argc, &argv, NULL);
+
+	tmpdir = g_dir_make_tmp("spamassassin_batch_test_XXXXXX", NULL);
+	g_assert_nonnull(tmpdir);
+
+	g_test_add_func("/plugins/spamassassin/batch/verdicts", test_batch_verdicts);
+
+	ret = g_test_run();
+
+	remove_dir_recursive(tmpdir);
+	g_free(tmpdir);
+
+	return ret;
+}
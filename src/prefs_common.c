@@ -1265,6 +1265,8 @@ static PrefParam param[] = {
 
 	{"flush_metadata", "TRUE", &prefs_common.flush_metadata, P_BOOL,
 	 NULL, NULL, NULL},
+	{"mh_scan_threads", "0", &prefs_common.mh_scan_threads, P_INT,
+	 NULL, NULL, NULL},
 
 	{"nav_history_length", "50", &prefs_common.nav_history_length, P_INT,
 	 NULL, NULL, NULL},
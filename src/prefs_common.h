@@ -567,6 +567,7 @@ struct _PrefsCommon
 	gboolean two_line_vert;
 	gboolean inherit_folder_props;
 	gboolean flush_metadata;
+	gint mh_scan_threads;
 
 	gint nav_history_length;
 
@@ -59,6 +59,7 @@ typedef struct _OtherPage
 	GtkWidget *checkbtn_askonclean;
 	GtkWidget *checkbtn_warnqueued;
 	GtkWidget *spinbtn_iotimeout;
+	GtkWidget *spinbtn_scanthreads;
 	GtkWidget *checkbtn_gtk_enable_accels;
 	GtkWidget *checkbtn_gtk_can_change_accels;
 	GtkWidget *checkbtn_askonfilter;
@@ -464,6 +465,10 @@ static void prefs_other_create_widget(PrefsPage *_page, GtkWindow *window,
 	GtkWidget *spinbtn_iotimeout;
 	GtkAdjustment *spinbtn_iotimeout_adj;
 
+	GtkWidget *label_scanthreads;
+	GtkWidget *spinbtn_scanthreads;
+	GtkAdjustment *spinbtn_scanthreads_adj;
+
 	GtkWidget *vbox2;
 	GtkWidget *checkbtn_transhdr;
 	GtkWidget *checkbtn_askonclean;
@@ -579,6 +584,26 @@ static void prefs_other_create_widget(PrefsPage *_page, GtkWindow *window,
 	gtk_widget_show (label_iotimeout);
 	gtk_box_pack_start (GTK_BOX (hbox1), label_iotimeout, FALSE, FALSE, 0);
 
+	hbox1 = gtk_hbox_new (FALSE, 8);
+	gtk_widget_show (hbox1);
+	gtk_box_pack_start (GTK_BOX (vbox1), hbox1, FALSE, FALSE, 0);
+
+	label_scanthreads = gtk_label_new (_("Threads used to rescan local folders"));
+	gtk_widget_show (label_scanthreads);
+	gtk_box_pack_start (GTK_BOX (hbox1), label_scanthreads, FALSE, FALSE, 0);
+
+	spinbtn_scanthreads_adj = GTK_ADJUSTMENT(gtk_adjustment_new (0, 0, 64, 1, 4, 0));
+	spinbtn_scanthreads = gtk_spin_button_new
+		(GTK_ADJUSTMENT (spinbtn_scanthreads_adj), 1, 0);
+	gtk_widget_show (spinbtn_scanthreads);
+	gtk_box_pack_start (GTK_BOX (hbox1), spinbtn_scanthreads,
+			    FALSE, FALSE, 0);
+	gtk_spin_button_set_numeric (GTK_SPIN_BUTTON (spinbtn_scanthreads), TRUE);
+	CLAWS_SET_TIP(spinbtn_scanthreads,
+			_("Number of messages parsed in parallel when the cache "
+			  "of an MH folder has to be rebuilt. 0 uses one thread "
+			  "per processor, 1 disables parallel scanning."));
+
 	vbox2 = gtk_vbox_new (FALSE, 8);
 	gtk_widget_show (vbox2);
 	gtk_box_pack_start (GTK_BOX (vbox1), vbox2, FALSE, FALSE, 0);
@@ -655,6 +680,8 @@ static void prefs_other_create_widget(PrefsPage *_page, GtkWindow *window,
 
 	gtk_spin_button_set_value(GTK_SPIN_BUTTON(spinbtn_iotimeout),
 		prefs_common.io_timeout_secs);
+	gtk_spin_button_set_value(GTK_SPIN_BUTTON(spinbtn_scanthreads),
+		prefs_common.mh_scan_threads);
 
 	gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(checkbtn_transhdr),
 		prefs_common.trans_hdr);
@@ -678,6 +705,7 @@ static void prefs_other_create_widget(PrefsPage *_page, GtkWindow *window,
 	prefs_other->checkbtn_askonclean = checkbtn_askonclean;
 	prefs_other->checkbtn_warnqueued = checkbtn_warnqueued;
 	prefs_other->spinbtn_iotimeout = spinbtn_iotimeout;
+	prefs_other->spinbtn_scanthreads = spinbtn_scanthreads;
 	prefs_other->checkbtn_transhdr = checkbtn_transhdr;
 	prefs_other->checkbtn_gtk_enable_accels = checkbtn_gtk_enable_accels;
 	prefs_other->checkbtn_gtk_can_change_accels = checkbtn_gtk_can_change_accels;
@@ -710,6 +738,8 @@ static void prefs_other_save(PrefsPage *_page)
 		GTK_TOGGLE_BUTTON(page->checkbtn_warnqueued)); 
 	prefs_common.io_timeout_secs = gtk_spin_button_get_value_as_int(
 		GTK_SPIN_BUTTON(page->spinbtn_iotimeout));
+	prefs_common.mh_scan_threads = gtk_spin_button_get_value_as_int(
+		GTK_SPIN_BUTTON(page->spinbtn_scanthreads));
 	prefs_common.flush_metadata = gtk_toggle_button_get_active(
 		GTK_TOGGLE_BUTTON(page->flush_metadata_safer_radiobtn));
 	sock_set_io_timeout(prefs_common.io_timeout_secs);
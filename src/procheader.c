@@ -64,7 +64,8 @@ static gint generic_get_one_field(gchar **bufptr, void *data,
 				  peekcharfunc peekchar,
 				  gboolean unfold);
 static MsgInfo *parse_stream(void *data, gboolean isstring, MsgFlags flags,
-			     gboolean full, gboolean decrypted);
+			     gboolean full, gboolean decrypted,
+			     GSList **avatar_headers);
 
 
 gint procheader_get_one_field(gchar **buf, FILE *fp,
@@ -421,6 +422,17 @@ void procheader_get_header_fields(FILE *fp, HeaderEntry hentry[])
 
 MsgInfo *procheader_parse_file(const gchar *file, MsgFlags flags,
 			       gboolean full, gboolean decrypted)
+{
+	return procheader_parse_file_full(file, flags, full, decrypted, NULL);
+}
+
+/* procheader_parse_file_full() - like procheader_parse_file(), but if
+ * avatar_headers is not NULL the avatar hooks are not run: the headers
+ * they need are returned there instead, for procheader_run_avatar_hooks()
+ * to be called later from the main thread. */
+MsgInfo *procheader_parse_file_full(const gchar *file, MsgFlags flags,
+				    gboolean full, gboolean decrypted,
+				    GSList **avatar_headers)
 {
 #ifdef G_OS_WIN32
 	GFile *f;
@@ -465,7 +477,8 @@ MsgInfo *procheader_parse_file(const gchar *file, MsgFlags flags,
 		return NULL;
 	}
 
-	msginfo = procheader_parse_stream(fp, flags, full, decrypted);
+	msginfo = parse_stream(fp, FALSE, flags, full, decrypted,
+			       avatar_headers);
 	claws_fclose(fp);
 
 	if (msginfo) {
@@ -490,7 +503,7 @@ MsgInfo *procheader_parse_file(const gchar *file, MsgFlags flags,
 MsgInfo *procheader_parse_str(const gchar *str, MsgFlags flags, gboolean full,
 			      gboolean decrypted)
 {
-	return parse_stream(&str, TRUE, flags, full, decrypted);
+	return parse_stream(&str, TRUE, flags, full, decrypted, NULL);
 }
 
 enum
@@ -584,7 +597,7 @@ static HeaderEntry* procheader_get_headernames(gboolean full)
 MsgInfo *procheader_parse_stream(FILE *fp, MsgFlags flags, gboolean full,
 				 gboolean decrypted)
 {
-	return parse_stream(fp, FALSE, flags, full, decrypted);
+	return parse_stream(fp, FALSE, flags, full, decrypted, NULL);
 }
 
 static gboolean avatar_from_some_face(gpointer source, gpointer userdata)
@@ -609,8 +622,52 @@ static gboolean avatar_from_some_face(gpointer source, gpointer userdata)
 
 static gulong avatar_hook_id = HOOK_NONE;
 
+static void procheader_update_avatar_hook(void)
+{
+	if (avatar_hook_id == HOOK_NONE && (prefs_common.enable_avatars & AVATARS_ENABLE_CAPTURE)) {
+		avatar_hook_id = hooks_register_hook(AVATAR_HEADER_UPDATE_HOOKLIST, avatar_from_some_face, NULL);
+	} else if (avatar_hook_id != HOOK_NONE && !(prefs_common.enable_avatars & AVATARS_ENABLE_CAPTURE)) {
+		hooks_unregister_hook(AVATAR_HEADER_UPDATE_HOOKLIST, avatar_hook_id);
+		avatar_hook_id = HOOK_NONE;
+	}
+}
+
+static void procheader_invoke_avatar_hook(MsgInfo *msginfo,
+					  const gchar *header,
+					  const gchar *content)
+{
+	AvatarCaptureData *acd = g_new0(AvatarCaptureData, 1);
+
+	/* no extra memory is wasted, hooks are expected to
+	   take care of copying members when needed */
+	acd->msginfo = msginfo;
+	acd->header  = header;
+	acd->content = content;
+	hooks_invoke(AVATAR_HEADER_UPDATE_HOOKLIST, (gpointer)acd);
+	g_free(acd);
+}
+
+/* procheader_run_avatar_hooks() - runs the avatar hooks on the headers
+ * got from procheader_parse_file_full(), and frees them */
+void procheader_run_avatar_hooks(MsgInfo *msginfo, GSList *avatar_headers)
+{
+	GSList *cur;
+
+	procheader_update_avatar_hook();
+	for (cur = avatar_headers; cur != NULL; cur = cur->next) {
+		Header *header = (Header *)cur->data;
+
+		if (msginfo != NULL)
+			procheader_invoke_avatar_hook(msginfo, header->name,
+						      header->body);
+		procheader_header_free(header);
+	}
+	g_slist_free(avatar_headers);
+}
+
 static MsgInfo *parse_stream(void *data, gboolean isstring, MsgFlags flags,
-			     gboolean full, gboolean decrypted)
+			     gboolean full, gboolean decrypted,
+			     GSList **avatar_headers)
 {
 	MsgInfo *msginfo;
 	gchar *buf = NULL;
@@ -663,12 +720,8 @@ static MsgInfo *parse_stream(void *data, gboolean isstring, MsgFlags flags,
 	
 	msginfo->inreplyto = NULL;
 
-	if (avatar_hook_id == HOOK_NONE && (prefs_common.enable_avatars & AVATARS_ENABLE_CAPTURE)) {
-		avatar_hook_id = hooks_register_hook(AVATAR_HEADER_UPDATE_HOOKLIST, avatar_from_some_face, NULL);
-	} else if (avatar_hook_id != HOOK_NONE && !(prefs_common.enable_avatars & AVATARS_ENABLE_CAPTURE)) {
-		hooks_unregister_hook(AVATAR_HEADER_UPDATE_HOOKLIST, avatar_hook_id);
-		avatar_hook_id = HOOK_NONE;
-	}
+	if (avatar_headers == NULL)
+		procheader_update_avatar_hook();
 
 	while ((hnum = get_one_field(&buf, data, hentry)) != -1) {
 		hp = buf + strlen(hentry[hnum].name);
@@ -863,14 +916,17 @@ static MsgInfo *parse_stream(void *data, gboolean isstring, MsgFlags flags,
 		/* to avoid performance penalty hooklist is invoked only for
 		   headers known to be able to generate avatars */
 		if (hnum == H_FROM || hnum == H_X_FACE || hnum == H_FACE) {
-			AvatarCaptureData *acd = g_new0(AvatarCaptureData, 1);
-			/* no extra memory is wasted, hooks are expected to
-			   take care of copying members when needed */
-			acd->msginfo = msginfo;
-			acd->header  = hentry_full[hnum].name;
-			acd->content = hp;
-			hooks_invoke(AVATAR_HEADER_UPDATE_HOOKLIST, (gpointer)acd);
-			g_free(acd);
+			if (avatar_headers != NULL) {
+				Header *header = g_new0(Header, 1);
+
+				header->name = g_strdup(hentry_full[hnum].name);
+				header->body = g_strdup(hp);
+				*avatar_headers = g_slist_prepend(*avatar_headers,
+								  header);
+			} else {
+				procheader_invoke_avatar_hook(msginfo,
+					hentry_full[hnum].name, hp);
+			}
 		}
 		g_free(buf);
 		buf = NULL;
@@ -880,6 +936,9 @@ static MsgInfo *parse_stream(void *data, gboolean isstring, MsgFlags flags,
 		msginfo->inreplyto =
 			g_strdup((gchar *)msginfo->references->data);
 
+	if (avatar_headers != NULL)
+		*avatar_headers = g_slist_reverse(*avatar_headers);
+
 	return msginfo;
 }
 
@@ -59,6 +59,13 @@ MsgInfo *procheader_parse_file		(const gchar	*file,
 					 MsgFlags	 flags,
 					 gboolean	 full,
 					 gboolean	 decrypted);
+MsgInfo *procheader_parse_file_full	(const gchar	*file,
+					 MsgFlags	 flags,
+					 gboolean	 full,
+					 gboolean	 decrypted,
+					 GSList		**avatar_headers);
+void procheader_run_avatar_hooks	(MsgInfo	*msginfo,
+					 GSList		*avatar_headers);
 MsgInfo *procheader_parse_str		(const gchar	*str,
 					 MsgFlags	 flags,
 					 gboolean	 full,
@@ -53,6 +53,7 @@
 #include "privacy.h"
 #include "account.h"
 #include "file-utils.h"
+#include "metrics.h"
 
 static GHashTable *procmime_get_mime_type_table	(void);
 static MimeInfo *procmime_scan_file_short(const gchar *filename);
@@ -279,7 +280,7 @@ const gchar *procmime_mimeinfo_get_parameter(MimeInfo *mimeinfo, const gchar *na
 	strcpy(lastline, buf);							\
 }
 
-gboolean procmime_decode_content(MimeInfo *mimeinfo)
+static gboolean procmime_decode_content_real(MimeInfo *mimeinfo)
 {
 	gchar buf[BUFFSIZE];
 	gint readend;
@@ -493,13 +494,86 @@ gboolean procmime_decode_content(MimeInfo *mimeinfo)
 	return TRUE;
 }
 
+gboolean procmime_decode_content(MimeInfo *mimeinfo)
+{
+	MetricsSpan span;
+	gboolean ret;
+
+	metrics_span_begin(&span, "procmime.decode");
+	ret = procmime_decode_content_real(mimeinfo);
+	metrics_span_end(&span);
+
+	return ret;
+}
+
 #define B64_LINE_SIZE		57
 #define B64_BUFFSIZE		77
 
+/* procmime_encode_stream() - writes the content of infp to outfp in the
+ * given encoding. Text is not canonicalized. Only works on its
+ * arguments, so it can be used from any thread. */
+gboolean procmime_encode_stream(FILE *infp, FILE *outfp, EncodingType encoding)
+{
+	gint len;
+	gboolean err = FALSE;
+
+	if (encoding == ENC_BASE64) {
+		gchar inbuf[B64_LINE_SIZE], *out;
+
+		while ((len = claws_fread(inbuf, sizeof(gchar),
+				    B64_LINE_SIZE, infp))
+		       == B64_LINE_SIZE) {
+			out = g_base64_encode(inbuf, B64_LINE_SIZE);
+			if (claws_fputs(out, outfp) == EOF)
+				err = TRUE;
+			g_free(out);
+			if (claws_fputc('\n', outfp) == EOF)
+				err = TRUE;
+		}
+		if (len > 0 && claws_feof(infp)) {
+			out = g_base64_encode(inbuf, len);
+			if (claws_fputs(out, outfp) == EOF)
+				err = TRUE;
+			g_free(out);
+			if (claws_fputc('\n', outfp) == EOF)
+				err = TRUE;
+		}
+	} else if (encoding == ENC_QUOTED_PRINTABLE) {
+		gchar inbuf[BUFFSIZE], outbuf[BUFFSIZE * 4];
+
+		while (claws_fgets(inbuf, sizeof(inbuf), infp) != NULL) {
+			qp_encode_line(outbuf, inbuf);
+
+			if (!strncmp("From ", outbuf, sizeof("From ")-1)) {
+				gchar *tmpbuf = outbuf;
+				
+				tmpbuf += sizeof("From ")-1;
+				
+				if (claws_fputs("=46rom ", outfp) == EOF)
+					err = TRUE;
+				if (claws_fputs(tmpbuf, outfp) == EOF)
+					err = TRUE;
+			} else {
+				if (claws_fputs(outbuf, outfp) == EOF)
+					err = TRUE;
+			}
+		}
+	} else {
+		gchar buf[BUFFSIZE];
+
+		while (claws_fgets(buf, sizeof(buf), infp) != NULL) {
+			strcrchomp(buf);
+			if (claws_fputs(buf, outfp) == EOF)
+				err = TRUE;
+		}
+	}
+
+	return !err;
+}
+
 gboolean procmime_encode_content(MimeInfo *mimeinfo, EncodingType encoding)
 {
 	FILE *infp = NULL, *outfp;
-	gint len;
 	gchar *tmpfilename;
 	GStatBuf statbuf;
 	gboolean err = FALSE;
@@ -539,7 +613,6 @@ gboolean procmime_encode_content(MimeInfo *mimeinfo, EncodingType encoding)
 	}
 
 	if (encoding == ENC_BASE64) {
-		gchar inbuf[B64_LINE_SIZE], *out;
 		FILE *tmp_fp = infp;
 		gchar *tmp_file = NULL;
 
@@ -574,59 +647,16 @@ gboolean procmime_encode_content(MimeInfo *mimeinfo, EncodingType encoding)
 			}
 		}
 
-		while ((len = claws_fread(inbuf, sizeof(gchar),
-				    B64_LINE_SIZE, tmp_fp))
-		       == B64_LINE_SIZE) {
-			out = g_base64_encode(inbuf, B64_LINE_SIZE);
-			if (claws_fputs(out, outfp) == EOF)
-				err = TRUE;
-			g_free(out);
-			if (claws_fputc('\n', outfp) == EOF)
-				err = TRUE;
-		}
-		if (len > 0 && claws_feof(tmp_fp)) {
-			out = g_base64_encode(inbuf, len);
-			if (claws_fputs(out, outfp) == EOF)
-				err = TRUE;
-			g_free(out);
-			if (claws_fputc('\n', outfp) == EOF)
-				err = TRUE;
-		}
+		if (!procmime_encode_stream(tmp_fp, outfp, ENC_BASE64))
+			err = TRUE;
 
 		if (tmp_file) {
 			claws_fclose(tmp_fp);
 			claws_unlink(tmp_file);
 			g_free(tmp_file);
 		}
-	} else if (encoding == ENC_QUOTED_PRINTABLE) {
-		gchar inbuf[BUFFSIZE], outbuf[BUFFSIZE * 4];
-
-		while (claws_fgets(inbuf, sizeof(inbuf), infp) != NULL) {
-			qp_encode_line(outbuf, inbuf);
-
-			if (!strncmp("From ", outbuf, sizeof("From ")-1)) {
-				gchar *tmpbuf = outbuf;
-				
-				tmpbuf += sizeof("From ")-1;
-				
-				if (claws_fputs("=46rom ", outfp) == EOF)
-					err = TRUE;
-				if (claws_fputs(tmpbuf, outfp) == EOF)
-					err = TRUE;
-			} else {
-				if (claws_fputs(outbuf, outfp) == EOF)
-					err = TRUE;
-			}
-		}
-	} else {
-		gchar buf[BUFFSIZE];
-
-		while (claws_fgets(buf, sizeof(buf), infp) != NULL) {
-			strcrchomp(buf);
-			if (claws_fputs(buf, outfp) == EOF)
-				err = TRUE;
-		}
-	}
+	} else if (!procmime_encode_stream(infp, outfp, encoding))
+		err = TRUE;
 
 	claws_fclose(outfp);
 	claws_fclose(infp);
@@ -725,6 +755,92 @@ gint procmime_get_part(const gchar *outfile, MimeInfo *mimeinfo)
 	return result;
 }
 
+gint procmime_get_part_to_callback(MimeInfo *mimeinfo,
+		gboolean (*data_callback)(const gchar *data, gsize len, gpointer cb_data),
+		gpointer cb_data)
+{
+	FILE *infp;
+	gchar buf[BUFFSIZE];
+	gchar outbuf[BUFFSIZE];
+	EncodingType encoding;
+	gint restlength, readlength, len;
+	gint state = 0;
+	guint save = 0;
+	gint result = 0;
+
+	cm_return_val_if_fail(mimeinfo != NULL, -EINVAL);
+	cm_return_val_if_fail(data_callback != NULL, -EINVAL);
+
+	if (mimeinfo->content == MIMECONTENT_MEM) {
+		if (!data_callback(mimeinfo->data.mem,
+				   strlen(mimeinfo->data.mem), cb_data))
+			return -ECANCELED;
+		return 0;
+	}
+
+	if (mimeinfo->data.filename == NULL)
+		return -EINVAL;
+
+	/* containers are passed on as they are, like
+	 * procmime_decode_content() does */
+	encoding = mimeinfo->encoding_type;
+	if (mimeinfo->type == MIMETYPE_MULTIPART ||
+	    mimeinfo->type == MIMETYPE_MESSAGE)
+		encoding = ENC_BINARY;
+
+	if ((infp = claws_fopen(mimeinfo->data.filename, "rb")) == NULL) {
+		result = -errno;
+		FILE_OP_ERROR(mimeinfo->data.filename, "claws_fopen");
+		return result;
+	}
+	if (fseek(infp, mimeinfo->offset, SEEK_SET) < 0) {
+		result = -errno;
+		FILE_OP_ERROR(mimeinfo->data.filename, "fseek");
+		claws_fclose(infp);
+		return result;
+	}
+
+	restlength = mimeinfo->length;
+
+	if (encoding == ENC_QUOTED_PRINTABLE) {
+		while (restlength > 0 &&
+		       claws_fgets(buf, MIN(sizeof(buf), restlength + 1), infp) != NULL) {
+			restlength -= strlen(buf);
+			len = qp_decode_line(buf);
+			if (len > 0 && !data_callback(buf, len, cb_data)) {
+				result = -ECANCELED;
+				break;
+			}
+		}
+	} else {
+		while (restlength > 0 &&
+		       (readlength = claws_fread(buf, 1, MIN(sizeof(buf), restlength), infp)) > 0) {
+			const gchar *chunk = buf;
+
+			restlength -= readlength;
+			len = readlength;
+			if (encoding == ENC_BASE64) {
+				len = g_base64_decode_step(buf, readlength,
+						(guchar *)outbuf, &state, &save);
+				chunk = outbuf;
+			}
+			if (len > 0 && !data_callback(chunk, len, cb_data)) {
+				result = -ECANCELED;
+				break;
+			}
+		}
+	}
+
+	if (result == 0 && restlength > 0 && claws_ferror(infp)) {
+		result = -EIO;
+		FILE_OP_ERROR(mimeinfo->data.filename, "claws_fread");
+	}
+
+	claws_fclose(infp);
+
+	return result;
+}
+
 gboolean procmime_scan_text_content(MimeInfo *mimeinfo,
 		gboolean (*scan_callback)(const gchar *str, gpointer cb_data),
 		gpointer cb_data) 
@@ -2121,6 +2237,7 @@ static MimeInfo *procmime_scan_file_with_offset(const gchar *filename, int offse
 {
 	MimeInfo *mimeinfo;
 	GStatBuf buf;
+	MetricsSpan span;
 
 	if (g_stat(filename, &buf) < 0) {
 		FILE_OP_ERROR(filename, "stat");
@@ -2136,7 +2253,9 @@ static MimeInfo *procmime_scan_file_with_offset(const gchar *filename, int offse
 	mimeinfo->offset = offset;
 	mimeinfo->length = buf.st_size - offset;
 
+	metrics_span_begin(&span, "procmime.scan");
 	procmime_parse_message_rfc822(mimeinfo, short_scan);
+	metrics_span_end(&span);
 	if (debug_get_mode())
 		output_mime_structure(mimeinfo, 0);
 
@@ -197,6 +197,9 @@ MimeInfo *procmime_scan_mime_header	(FILE		*fp);
 
 gboolean procmime_decode_content	(MimeInfo	*mimeinfo);
 gboolean procmime_encode_content	(MimeInfo	*mimeinfo, EncodingType encoding);
+gboolean procmime_encode_stream		(FILE		*infp,
+					 FILE		*outfp,
+					 EncodingType	 encoding);
 gint procmime_get_part			(const gchar	*outfile,
 					 MimeInfo	*mimeinfo);
 FILE *procmime_get_first_text_content	(MsgInfo	*msginfo);
@@ -242,6 +245,14 @@ FILE *procmime_get_binary_content(MimeInfo *mimeinfo);
 gboolean procmime_scan_text_content(MimeInfo *mimeinfo,
 		gboolean (*scan_callback)(const gchar *str, gpointer cb_data),
 		gpointer cb_data);
+/* feeds the part's content to data_callback() in chunks, undoing its
+ * transfer encoding on the fly without writing a temporary file.
+ * returns 0 on success, -ECANCELED if data_callback() returned FALSE
+ * and a negative errno value on error.
+ */
+gint procmime_get_part_to_callback(MimeInfo *mimeinfo,
+		gboolean (*data_callback)(const gchar *data, gsize len, gpointer cb_data),
+		gpointer cb_data);
 void *procmime_get_part_as_string(MimeInfo *mimeinfo,
 		gboolean null_terminate);
 GInputStream *procmime_get_part_as_inputstream(MimeInfo *mimeinfo);
@@ -1938,6 +1938,17 @@ static void update_folder_msg_counts(FolderItem *item, MsgInfo *msginfo, MsgPerm
 	}
 }
 
+/* flag changes are delivered synchronously: long operations unregister
+ * the summary view's hook around them and rely on that */
+static HooksList *msginfo_update_hooks(void)
+{
+	static HooksList *list = NULL;
+
+	if (list == NULL)
+		list = hooks_get_list(MSGINFO_UPDATE_HOOKLIST);
+	return list;
+}
+
 void procmsg_msginfo_set_flags(MsgInfo *msginfo, MsgPermFlags perm_flags, MsgTmpFlags tmp_flags)
 {
 	FolderItem *item;
@@ -1976,7 +1987,7 @@ void procmsg_msginfo_set_flags(MsgInfo *msginfo, MsgPermFlags perm_flags, MsgTmp
 	if ((perm_flags_old != perm_flags_new) || (tmp_flags_old != msginfo->flags.tmp_flags)) {
 		msginfo_update.msginfo = msginfo;
 		msginfo_update.flags = MSGINFO_UPDATE_FLAGS;
-		hooks_invoke(MSGINFO_UPDATE_HOOKLIST, &msginfo_update);
+		hooks_invoke_list(msginfo_update_hooks(), &msginfo_update);
 		folder_item_update(msginfo->folder, F_ITEM_UPDATE_MSGCNT);
 	}
 }
@@ -2012,7 +2023,7 @@ void procmsg_msginfo_unset_flags(MsgInfo *msginfo, MsgPermFlags perm_flags, MsgT
 	if ((perm_flags_old != perm_flags_new) || (tmp_flags_old != msginfo->flags.tmp_flags)) {
 		msginfo_update.msginfo = msginfo;
 		msginfo_update.flags = MSGINFO_UPDATE_FLAGS;
-		hooks_invoke(MSGINFO_UPDATE_HOOKLIST, &msginfo_update);
+		hooks_invoke_list(msginfo_update_hooks(), &msginfo_update);
 		folder_item_update(msginfo->folder, F_ITEM_UPDATE_MSGCNT);
 	}
 }
@@ -2058,11 +2069,107 @@ void procmsg_msginfo_change_flags(MsgInfo *msginfo,
 	if ((perm_flags_old != perm_flags_new) || (tmp_flags_old != msginfo->flags.tmp_flags)) {
 		msginfo_update.msginfo = msginfo;
 		msginfo_update.flags = MSGINFO_UPDATE_FLAGS;
-		hooks_invoke(MSGINFO_UPDATE_HOOKLIST, &msginfo_update);
+		hooks_invoke_list(msginfo_update_hooks(), &msginfo_update);
 		folder_item_update(msginfo->folder, F_ITEM_UPDATE_MSGCNT);
 	}
 }
 
+/*!
+ *\brief	Change the flags of many messages at once
+ *
+ *\param	msglist Messages, preferably grouped by folder
+ *
+ *		Does the same as procmsg_msginfo_change_flags() for each
+ *		message, but the folders are switched to batch mode while
+ *		doing it, so that IMAP sends the changes as a few UID range
+ *		STOREs, and the listeners are told once: by one
+ *		MSGINFO_LIST_UPDATE_HOOKLIST call with the messages whose
+ *		flags changed, and one folder update per folder.
+ *		MSGINFO_UPDATE_HOOKLIST is not invoked.
+ */
+void procmsg_msglist_change_flags(MsgInfoList *msglist,
+				  MsgPermFlags add_perm_flags, MsgTmpFlags add_tmp_flags,
+				  MsgPermFlags rem_perm_flags, MsgTmpFlags rem_tmp_flags)
+{
+	MsgInfoListUpdate list_update;
+	MsgInfoList *changed = NULL;
+	MsgInfoList *cur;
+	FolderItem *item = NULL;
+	MsgPermFlags perm_flags_new, perm_flags_old;
+	MsgTmpFlags tmp_flags_old;
+	gboolean perm_changed = FALSE;
+	gint count = 0;
+
+	if (msglist == NULL)
+		return;
+
+	START_TIMING("");
+	folder_item_update_freeze();
+
+	for (cur = msglist; cur != NULL; cur = cur->next) {
+		MsgInfo *msginfo = (MsgInfo *)cur->data;
+
+		if (msginfo == NULL || msginfo->folder == NULL)
+			continue;
+
+		if (msginfo->folder != item) {
+			if (item != NULL)
+				folder_item_set_batch(item, FALSE);
+			item = msginfo->folder;
+			folder_item_set_batch(item, TRUE);
+		}
+
+		/* Perm Flags handling, as in procmsg_msginfo_change_flags() */
+		perm_flags_old = msginfo->flags.perm_flags;
+		perm_flags_new = (msginfo->flags.perm_flags & ~rem_perm_flags) | add_perm_flags;
+		if ((add_perm_flags & MSG_IGNORE_THREAD) || (perm_flags_old & MSG_IGNORE_THREAD)) {
+			perm_flags_new &= ~(MSG_NEW | MSG_UNREAD);
+		}
+		if ((add_perm_flags & MSG_WATCH_THREAD) || (perm_flags_old & MSG_WATCH_THREAD)) {
+			perm_flags_new &= ~(MSG_IGNORE_THREAD);
+		}
+
+		if (perm_flags_old != perm_flags_new) {
+			folder_item_change_msg_flags(item, msginfo, perm_flags_new);
+			update_folder_msg_counts(item, msginfo, perm_flags_old);
+			perm_changed = TRUE;
+		}
+
+		/* Tmp flags handling */
+		tmp_flags_old = msginfo->flags.tmp_flags;
+		msginfo->flags.tmp_flags &= ~rem_tmp_flags;
+		msginfo->flags.tmp_flags |= add_tmp_flags;
+
+		if ((perm_flags_old != perm_flags_new) || (tmp_flags_old != msginfo->flags.tmp_flags)) {
+			changed = g_slist_prepend(changed, msginfo);
+			/* only flags the item while frozen */
+			folder_item_update(item, F_ITEM_UPDATE_MSGCNT);
+			count++;
+		}
+	}
+
+	/* sends the queued flag changes */
+	if (item != NULL)
+		folder_item_set_batch(item, FALSE);
+
+	debug_print("Changed flags of %d messages out of %d\n", count,
+		    g_slist_length(msglist));
+
+	if (perm_changed)
+		summary_update_unread(mainwindow_get_mainwindow()->summaryview, NULL);
+
+	/* update notification */
+	if (changed != NULL) {
+		list_update.msglist = g_slist_reverse(changed);
+		list_update.flags = MSGINFO_UPDATE_FLAGS;
+		hooks_invoke(MSGINFO_LIST_UPDATE_HOOKLIST, &list_update);
+		g_slist_free(list_update.msglist);
+	}
+
+	folder_item_update_thaw();
+	END_TIMING();
+}
+
 /*!
  *\brief	check for flags (e.g. mark) in prior msgs of current thread
  *
@@ -151,6 +151,7 @@
 #define MSG_IS_FULLY_CACHED(msg)	(((msg).perm_flags & MSG_FULLY_CACHED) != 0)
 
 #define MSGINFO_UPDATE_HOOKLIST "msginfo_update"
+#define MSGINFO_LIST_UPDATE_HOOKLIST "msginfo_list_update"
 #define MAIL_FILTERING_HOOKLIST "mail_filtering_hooklist"
 #define MAIL_LISTFILTERING_HOOKLIST "mail_listfiltering_hooklist"
 #define MAIL_POSTFILTERING_HOOKLIST "mail_postfiltering_hooklist"
@@ -275,6 +276,13 @@ struct _MsgInfoUpdate {
 	MsgInfoUpdateFlags flags;
 };
 
+/* sent once by procmsg_msglist_change_flags() instead of a
+ * MsgInfoUpdate per message */
+struct _MsgInfoListUpdate {
+	MsgInfoList *msglist;
+	MsgInfoUpdateFlags flags;
+};
+
 struct _MailFilteringData
 {
 	MsgInfo	*msginfo;
@@ -367,6 +375,11 @@ void procmsg_msginfo_change_flags	(MsgInfo *msginfo,
 					 MsgTmpFlags add_tmp_flags,
 					 MsgPermFlags rem_perm_flags, 
 					 MsgTmpFlags rem_tmp_flags);
+void procmsg_msglist_change_flags	(MsgInfoList *msglist,
+					 MsgPermFlags add_perm_flags,
+					 MsgTmpFlags add_tmp_flags,
+					 MsgPermFlags rem_perm_flags,
+					 MsgTmpFlags rem_tmp_flags);
 gint procmsg_remove_special_headers	(const gchar 	*in, 
 					 const gchar 	*out);
 
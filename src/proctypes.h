@@ -37,6 +37,9 @@ typedef struct _MsgFileInfo     	MsgFileInfo;
 struct _MsgInfoUpdate;
 typedef struct _MsgInfoUpdate 		MsgInfoUpdate;
 
+struct _MsgInfoListUpdate;
+typedef struct _MsgInfoListUpdate	MsgInfoListUpdate;
+
 struct _MailFilteringData;
 typedef struct _MailFilteringData	MailFilteringData;
 
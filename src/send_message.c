@@ -415,8 +415,12 @@ authenticated:
 	smtp_session->from = g_strdup(spec_from);
 	smtp_session->to_list = to_list;
 	smtp_session->cur_to = to_list;
-	smtp_session->send_data = (guchar *)get_outgoing_rfc2822_str(fp);
-	smtp_session->send_data_len = strlen((gchar *)smtp_session->send_data);
+	if (smtp_set_send_fp(smtp_session, fp) < 0) {
+		session_destroy(session);
+		send_progress_dialog_destroy(send_dialog);
+		ac_prefs->session = NULL;
+		return -1;
+	}
 
 	if (ac_prefs->use_proxy && ac_prefs->use_proxy_for_send) {
 		if (ac_prefs->use_default_proxy) {
@@ -499,6 +503,8 @@ authenticated:
 	} else {
 		g_free(smtp_session->from);
 		g_free(smtp_session->send_data);
+		smtp_session->send_data = NULL;
+		smtp_session->send_fp = NULL;
 		g_free(smtp_session->error_msg);
 	}
 	if (keep_session && ret == 0 && ac_prefs->session == NULL)
@@ -584,6 +590,10 @@ static gint send_send_data_progressive(Session *session, guint cur_len,
 	    SMTP_SESSION(session)->state != SMTP_EOM)
 		return 0;
 
+	/* the message is sent by chunks, cur_len is within the current one */
+	cur_len += SMTP_SESSION(session)->send_data_sent;
+	total_len = SMTP_SESSION(session)->send_data_len;
+
 	g_snprintf(buf, sizeof(buf), _("Sending message (%d / %d bytes)"),
 		   cur_len, total_len);
 	progress_dialog_set_label(dialog->dialog, buf);
@@ -608,7 +618,15 @@ static gint send_send_data_finished(Session *session, guint len, gpointer data)
 
 	cm_return_val_if_fail(dialog != NULL, -1);
 
-	send_send_data_progressive(session, len, len, dialog);
+	/* more chunks to come */
+	if (SMTP_SESSION(session)->state == SMTP_SEND_DATA)
+		return 0;
+
+	/* all of it */
+	send_send_data_progressive(session,
+			SMTP_SESSION(session)->send_data_len -
+			SMTP_SESSION(session)->send_data_sent,
+			SMTP_SESSION(session)->send_data_len, dialog);
 	if (mainwin) {
 		gtk_widget_hide(mainwin->progressbar);
 		gtk_progress_bar_set_fraction
@@ -88,6 +88,9 @@
 #define SUMMARY_COL_LOCKED_WIDTH	13
 #define SUMMARY_COL_MIME_WIDTH		11
 
+/* number of rows kept filled with their texts */
+#define SUMMARY_FILLED_ROWS_MAX		2048
+
 static int normal_row_height = -1;
 static GtkStyle *bold_style;
 static GtkStyle *bold_marked_style;
@@ -121,9 +124,6 @@ static GdkPixbuf *clipgpgsignedxpm;
 static void summary_free_msginfo_func	(GtkCMCTree		*ctree,
 					 GtkCMCTreeNode		*node,
 					 gpointer		 data);
-static void summary_set_marks_func	(GtkCMCTree		*ctree,
-					 GtkCMCTreeNode		*node,
-					 gpointer		 data);
 
 void  summary_set_menu_sensitive	(SummaryView		*summaryview);
 guint summary_get_msgnum		(SummaryView		*summaryview,
@@ -395,6 +395,10 @@ static gint summary_cmp_by_locked	(GtkCMCList 		*clist,
 static gint summary_cmp_by_tags		(GtkCMCList 		*clist,
 				         gconstpointer 		 ptr1, 
 					 gconstpointer 		 ptr2);
+static void summary_sort_key_func	(GtkSCTree		*sctree,
+					 GtkCMCTreeNode		*node,
+					 GtkSCTreeSortKey	*key,
+					 gpointer		 data);
 
 static void quicksearch_execute_cb	(QuickSearch    *quicksearch,
 					 gpointer	 data);
@@ -406,6 +410,7 @@ static void summary_find_answers	(SummaryView 	*summaryview,
 					 MsgInfo	*msg);
 
 static gboolean summary_update_msg	(gpointer source, gpointer data);
+static gboolean summary_update_msglist	(gpointer source, gpointer data);
 static gboolean summary_update_folder_item_hook(gpointer source, gpointer data);
 static gboolean summary_update_folder_hook(gpointer source, gpointer data);
 static void summary_set_colorlabel_color (GtkCMCTree		*ctree,
@@ -521,6 +526,8 @@ GtkWidget *summary_get_main_widget(SummaryView *summaryview)
 	inc_lock();						\
 	hooks_unregister_hook(MSGINFO_UPDATE_HOOKLIST,		\
 		      summaryview->msginfo_update_callback_id);	\
+	hooks_unregister_hook(MSGINFO_LIST_UPDATE_HOOKLIST,	\
+		      summaryview->msginfo_list_update_callback_id);\
 }
 #define END_LONG_OPERATION(summaryview) {			\
 	inc_unlock();						\
@@ -532,6 +539,9 @@ GtkWidget *summary_get_main_widget(SummaryView *summaryview)
 	summaryview->msginfo_update_callback_id =		\
 		hooks_register_hook(MSGINFO_UPDATE_HOOKLIST, 	\
 		summary_update_msg, (gpointer) summaryview);	\
+	summaryview->msginfo_list_update_callback_id =		\
+		hooks_register_hook(MSGINFO_LIST_UPDATE_HOOKLIST,\
+		summary_update_msglist, (gpointer) summaryview);\
 }
 
 static void popup_menu_selection_done(GtkMenuShell *shell, gpointer user_data)
@@ -826,6 +836,8 @@ SummaryView *summary_create(MainWindow *mainwin)
 	summaryview->lock_count = 0;
 	summaryview->msginfo_update_callback_id =
 		hooks_register_hook(MSGINFO_UPDATE_HOOKLIST, summary_update_msg, (gpointer) summaryview);
+	summaryview->msginfo_list_update_callback_id =
+		hooks_register_hook(MSGINFO_LIST_UPDATE_HOOKLIST, summary_update_msglist, (gpointer) summaryview);
 	summaryview->folder_item_update_callback_id =
 		hooks_register_hook(FOLDER_ITEM_UPDATE_HOOKLIST,
 				summary_update_folder_item_hook,
@@ -2593,24 +2605,6 @@ static void summary_free_msginfo_func(GtkCMCTree *ctree, GtkCMCTreeNode *node,
 		procmsg_msginfo_free(&msginfo);
 }
 
-static void summary_set_marks_func(GtkCMCTree *ctree, GtkCMCTreeNode *node,
-				   gpointer data)
-{
-	SummaryView *summaryview = data;
-	MsgInfo *msginfo;
-
-	msginfo = gtk_cmctree_node_get_row_data(ctree, node);
-
-	cm_return_if_fail(msginfo != NULL);
-
-	if (MSG_IS_DELETED(msginfo->flags))
-		summaryview->deleted++;
-
-	summaryview->total_size += msginfo->size;
-
-	summary_set_row_marks(summaryview, node);
-}
-
 static void summary_update_status(SummaryView *summaryview)
 {
 	GtkCMCTree *ctree = GTK_CMCTREE(summaryview->ctree);
@@ -3101,7 +3095,17 @@ void summary_sort(SummaryView *summaryview,
 		gtk_cmclist_set_compare_func(clist, cmp_func);
 
 		gtk_cmclist_set_sort_type(clist, (GtkSortType)sort_type);
-		gtk_sctree_sort_recursive(ctree, NULL);
+
+		/* the From column may show names from the address book */
+		if (sort_key == SORT_BY_FROM && prefs_common.use_addr_book)
+			start_address_completion(NULL);
+
+		gtk_sctree_sort_recursive_by_keys(ctree, NULL,
+						  summary_sort_key_func,
+						  summaryview);
+
+		if (sort_key == SORT_BY_FROM && prefs_common.use_addr_book)
+			end_address_completion();
 
 		gtk_cmctree_node_moveto(ctree, summaryview->selected, 0, 0.5, 0);
 
@@ -3195,24 +3199,21 @@ static gboolean summary_thread_is_selected(GNode *gnode, guint selected_msgnum)
 	return selected.is_selected;
 }
 
-static gboolean summary_insert_gnode_func(GtkCMCTree *ctree, guint depth, GNode *gnode,
-				   GtkCMCTreeNode *cnode, gpointer data)
+static void summary_set_row_text(SummaryView *summaryview,
+				 GtkCMCTreeNode *node, MsgInfo *msginfo)
 {
-	SummaryView *summaryview = (SummaryView *)data;
-	MsgInfo *msginfo = (MsgInfo *)gnode->data;
+	GtkCMCTree *ctree = GTK_CMCTREE(summaryview->ctree);
 	gchar *text[N_SUMMARY_COLS];
 	gint *col_pos = summaryview->col_pos;
-	const gchar *msgid = msginfo->msgid;
-	GHashTable *msgid_table = summaryview->msgid_table;
 	gboolean vert_layout = (prefs_common.layout_mode == VERTICAL_LAYOUT);
 	gboolean small_layout = (prefs_common.layout_mode == SMALL_LAYOUT);
 
 	summary_set_header(summaryview, text, msginfo);
 
-	gtk_cmctree_set_node_info(ctree, cnode, text[col_pos[S_COL_SUBJECT]], 2,
-				NULL, NULL, FALSE, summaryview->threaded && !summaryview->thread_collapsed);
+	gtk_cmctree_node_set_pixtext(ctree, node, col_pos[S_COL_SUBJECT],
+				     text[col_pos[S_COL_SUBJECT]], 2, NULL);
 #define SET_TEXT(col) {						\
-	gtk_cmctree_node_set_text(ctree, cnode, col_pos[col], 	\
+	gtk_cmctree_node_set_text(ctree, node, col_pos[col], 	\
 				text[col_pos[col]]);		\
 }
 
@@ -3235,9 +3236,81 @@ static gboolean summary_insert_gnode_func(GtkCMCTree *ctree, guint depth, GNode
 		g_free(text[summaryview->col_pos[S_COL_SUBJECT]]);
 
 #undef SET_TEXT
+}
+
+/*
+ * Rows are inserted without their texts and marks; the ctree asks for
+ * them when a row is drawn the first time, and empties the least
+ * recently drawn rows again to keep only SUMMARY_FILLED_ROWS_MAX of
+ * them filled.
+ */
+static void summary_fill_row_func(GtkCMCList *clist, GList *row_element,
+				  gboolean fill, gpointer data)
+{
+	SummaryView *summaryview = (SummaryView *)data;
+	GtkCMCTree *ctree = GTK_CMCTREE(clist);
+	GtkCMCTreeNode *node = GTK_CMCTREE_NODE(row_element);
+	gint *col_pos = summaryview->col_pos;
+	MsgInfo *msginfo;
+
+	msginfo = gtk_cmctree_node_get_row_data(ctree, node);
+	if (!msginfo)
+		return;
+
+	if (!fill) {
+		/* the marks are cheap, only drop the texts */
+		gtk_cmctree_node_set_pixtext(ctree, node, col_pos[S_COL_SUBJECT],
+					     "", 2, NULL);
+		gtk_cmctree_node_set_text(ctree, node, col_pos[S_COL_NUMBER], NULL);
+		gtk_cmctree_node_set_text(ctree, node, col_pos[S_COL_SCORE], NULL);
+		gtk_cmctree_node_set_text(ctree, node, col_pos[S_COL_SIZE], NULL);
+		gtk_cmctree_node_set_text(ctree, node, col_pos[S_COL_DATE], NULL);
+		gtk_cmctree_node_set_text(ctree, node, col_pos[S_COL_FROM], NULL);
+		gtk_cmctree_node_set_text(ctree, node, col_pos[S_COL_TO], NULL);
+		gtk_cmctree_node_set_text(ctree, node, col_pos[S_COL_TAGS], NULL);
+		return;
+	}
+
+	summary_set_row_text(summaryview, node, msginfo);
+	summary_set_row_marks(summaryview, node);
+}
+
+/* the From and To columns may show names from the address book */
+static void summary_fill_rows_batch_func(GtkCMCList *clist, gboolean begin,
+					 gpointer data)
+{
+	if (!prefs_common.use_addr_book)
+		return;
+
+	if (begin)
+		start_address_completion(NULL);
+	else
+		end_address_completion();
+}
+
+static void summary_count_msg(SummaryView *summaryview, MsgInfo *msginfo)
+{
+	if (MSG_IS_DELETED(msginfo->flags))
+		summaryview->deleted++;
+
+	summaryview->total_size += msginfo->size;
+}
+
+static gboolean summary_insert_gnode_func(GtkCMCTree *ctree, guint depth, GNode *gnode,
+				   GtkCMCTreeNode *cnode, gpointer data)
+{
+	SummaryView *summaryview = (SummaryView *)data;
+	MsgInfo *msginfo = (MsgInfo *)gnode->data;
+	const gchar *msgid = msginfo->msgid;
+	GHashTable *msgid_table = summaryview->msgid_table;
+
+	/* texts and marks are set when the row is drawn */
+	gtk_cmctree_set_node_info(ctree, cnode, "", 2,
+				NULL, NULL, FALSE, summaryview->threaded && !summaryview->thread_collapsed);
 
 	GTKUT_CTREE_NODE_SET_ROW_DATA(cnode, msginfo);
-	summary_set_marks_func(ctree, cnode, summaryview);
+	GTK_CMCTREE_ROW(cnode)->row.fill_pending = TRUE;
+	summary_count_msg(summaryview, msginfo);
 
 	if (msgid && msgid[0] != '\0')
 		g_hash_table_insert(msgid_table, (gchar *)msgid, cnode);
@@ -3254,8 +3327,6 @@ static void summary_set_ctree_from_list(SummaryView *summaryview,
 	GHashTable *msgid_table;
 	GHashTable *subject_table = NULL;
 	GSList * cur;
-	gboolean vert_layout = (prefs_common.layout_mode == VERTICAL_LAYOUT);
-	gboolean small_layout = (prefs_common.layout_mode == SMALL_LAYOUT);
 	START_TIMING("");
 	
 	if (!mlist) return;
@@ -3303,23 +3374,20 @@ static void summary_set_ctree_from_list(SummaryView *summaryview,
                 
 		END_TIMING();
 	} else {
-		gchar *text[N_SUMMARY_COLS];
 		START_TIMING("unthreaded");
 		cur = mlist;
 		for (; mlist != NULL; mlist = mlist->next) {
 			msginfo = (MsgInfo *)mlist->data;
 
-			summary_set_header(summaryview, text, msginfo);
-
+			/* texts and marks are set when the row is drawn */
 			node = gtk_sctree_insert_node
-				(ctree, NULL, node, text, 2,
+				(ctree, NULL, node, NULL, 2,
 				 NULL, NULL,
 				 FALSE, FALSE);
-			if ((vert_layout || small_layout) && prefs_common.two_line_vert)
-				g_free(text[summaryview->col_pos[S_COL_SUBJECT]]);
 
 			GTKUT_CTREE_NODE_SET_ROW_DATA(node, msginfo);
-			summary_set_marks_func(ctree, node, summaryview);
+			GTK_CMCTREE_ROW(node)->row.fill_pending = TRUE;
+			summary_count_msg(summaryview, msginfo);
 
 			if (msginfo->msgid && msginfo->msgid[0] != '\0')
 				g_hash_table_insert(msgid_table,
@@ -3338,6 +3406,8 @@ static void summary_set_ctree_from_list(SummaryView *summaryview,
 	    summaryview->col_pos[S_COL_SUBJECT] == N_SUMMARY_COLS - 1) {
 		gint optimal_width;
 
+		/* measuring needs the texts of all rows */
+		gtk_cmclist_fill_pending_rows(GTK_CMCLIST(ctree));
 		optimal_width = gtk_cmclist_optimal_column_width
 			(GTK_CMCLIST(ctree), summaryview->col_pos[S_COL_SUBJECT]);
 		gtk_cmclist_set_column_width(GTK_CMCLIST(ctree),
@@ -3404,73 +3474,15 @@ static gchar *summary_complete_address(const gchar *addr)
 	return res;
 }
 
-static inline void summary_set_header(SummaryView *summaryview, gchar *text[],
-			       MsgInfo *msginfo)
+/* The texts of the From and To columns, in static buffers */
+static void summary_get_from_to_text(SummaryView *summaryview, MsgInfo *msginfo,
+				     gchar **from, gchar **to)
 {
-	static gchar date_modified[80];
-	static gchar col_score[11];
 	static gchar from_buf[BUFFSIZE], to_buf[BUFFSIZE];
-	static gchar tmp1[BUFFSIZE], tmp2[BUFFSIZE+4], tmp3[BUFFSIZE];
-	gint *col_pos = summaryview->col_pos;
-	gchar *from_text = NULL, *to_text = NULL, *tags_text = NULL;
+	static gchar tmp2[BUFFSIZE+4];
+	gchar *from_text = NULL, *to_text = NULL;
 	gboolean should_swap = FALSE;
-	gboolean vert_layout = (prefs_common.layout_mode == VERTICAL_LAYOUT);
-	gboolean small_layout = (prefs_common.layout_mode == SMALL_LAYOUT);
-	static const gchar *color_dim_rgb = NULL;
-	if (!color_dim_rgb)
-		color_dim_rgb = gdk_color_to_string(&summaryview->color_dim);
-	text[col_pos[S_COL_FROM]]   = "";
-	text[col_pos[S_COL_TO]]     = "";
-	text[col_pos[S_COL_SUBJECT]]= "";
-	text[col_pos[S_COL_MARK]]   = "";
-	text[col_pos[S_COL_STATUS]] = "";
-	text[col_pos[S_COL_MIME]]   = "";
-	text[col_pos[S_COL_LOCKED]] = "";
-	text[col_pos[S_COL_DATE]]   = "";
-	text[col_pos[S_COL_TAGS]]   = "";
-	if (summaryview->col_state[summaryview->col_pos[S_COL_NUMBER]].visible)
-		text[col_pos[S_COL_NUMBER]] = itos(msginfo->msgnum);
-	else
-		text[col_pos[S_COL_NUMBER]] = "";
 
-	/* slow! */
-	if (summaryview->col_state[summaryview->col_pos[S_COL_SIZE]].visible)
-		text[col_pos[S_COL_SIZE]] = to_human_readable(msginfo->size);
-	else
-		text[col_pos[S_COL_SIZE]] = "";
-
-	if (summaryview->col_state[summaryview->col_pos[S_COL_SCORE]].visible)
-		text[col_pos[S_COL_SCORE]] = itos_buf(col_score, msginfo->score);
-	else
-		text[col_pos[S_COL_SCORE]] = "";
-
-	if (summaryview->col_state[summaryview->col_pos[S_COL_TAGS]].visible) {
-		tags_text = procmsg_msginfo_get_tags_str(msginfo);
-		if (!tags_text) {
-			text[col_pos[S_COL_TAGS]] = "-";
-		} else {
-			strncpy2(tmp1, tags_text, sizeof(tmp1));
-			tmp1[sizeof(tmp1)-1]='\0';
-			g_free(tags_text);
-			text[col_pos[S_COL_TAGS]] = tmp1;
-		}
-	} else
-		text[col_pos[S_COL_TAGS]] = "";
-
-	/* slow! */
-	if (summaryview->col_state[summaryview->col_pos[S_COL_DATE]].visible || 
-	    ((vert_layout || small_layout) && prefs_common.two_line_vert)) {
-		if (msginfo->date_t && msginfo->date_t > 0) {
-			procheader_date_get_localtime(date_modified,
-						      sizeof(date_modified),
-						      msginfo->date_t);
-			text[col_pos[S_COL_DATE]] = date_modified;
-		} else if (msginfo->date)
-			text[col_pos[S_COL_DATE]] = msginfo->date;
-		else
-			text[col_pos[S_COL_DATE]] = _("(No Date)");
-	}
-	
 	if (prefs_common.swap_from && msginfo->from && msginfo->to
 	&&  !summaryview->col_state[summaryview->col_pos[S_COL_TO]].visible) {
 		gchar *addr = NULL;
@@ -3540,10 +3552,7 @@ static inline void summary_set_header(SummaryView *summaryview, gchar *text[],
 			extract_address(to_text);
 	}
 
-	text[col_pos[S_COL_TO]] = to_text;
-	if (!should_swap) {
-		text[col_pos[S_COL_FROM]] = from_text;
-	} else {
+	if (should_swap) {
 		if (prefs_common.use_addr_book) {
 			gchar *tmp = summary_complete_address(to_text);
 			/* need to keep to_text pointing to stack, so heap-allocated
@@ -3558,9 +3567,82 @@ static inline void summary_set_header(SummaryView *summaryview, gchar *text[],
 		}
 		snprintf(tmp2, BUFFSIZE+4, "➜ %s", to_text);
 		tmp2[BUFFSIZE-1]='\0';
-		text[col_pos[S_COL_FROM]] = tmp2;
+		from_text = tmp2;
+	}
+
+	*from = from_text;
+	*to = to_text;
+}
+
+static inline void summary_set_header(SummaryView *summaryview, gchar *text[],
+			       MsgInfo *msginfo)
+{
+	static gchar date_modified[80];
+	static gchar col_score[11];
+	static gchar tmp1[BUFFSIZE], tmp3[BUFFSIZE];
+	gint *col_pos = summaryview->col_pos;
+	gchar *from_text = NULL, *to_text = NULL, *tags_text = NULL;
+	gboolean vert_layout = (prefs_common.layout_mode == VERTICAL_LAYOUT);
+	gboolean small_layout = (prefs_common.layout_mode == SMALL_LAYOUT);
+	static const gchar *color_dim_rgb = NULL;
+	if (!color_dim_rgb)
+		color_dim_rgb = gdk_color_to_string(&summaryview->color_dim);
+	text[col_pos[S_COL_FROM]]   = "";
+	text[col_pos[S_COL_TO]]     = "";
+	text[col_pos[S_COL_SUBJECT]]= "";
+	text[col_pos[S_COL_MARK]]   = "";
+	text[col_pos[S_COL_STATUS]] = "";
+	text[col_pos[S_COL_MIME]]   = "";
+	text[col_pos[S_COL_LOCKED]] = "";
+	text[col_pos[S_COL_DATE]]   = "";
+	text[col_pos[S_COL_TAGS]]   = "";
+	if (summaryview->col_state[summaryview->col_pos[S_COL_NUMBER]].visible)
+		text[col_pos[S_COL_NUMBER]] = itos(msginfo->msgnum);
+	else
+		text[col_pos[S_COL_NUMBER]] = "";
+
+	/* slow! */
+	if (summaryview->col_state[summaryview->col_pos[S_COL_SIZE]].visible)
+		text[col_pos[S_COL_SIZE]] = to_human_readable(msginfo->size);
+	else
+		text[col_pos[S_COL_SIZE]] = "";
+
+	if (summaryview->col_state[summaryview->col_pos[S_COL_SCORE]].visible)
+		text[col_pos[S_COL_SCORE]] = itos_buf(col_score, msginfo->score);
+	else
+		text[col_pos[S_COL_SCORE]] = "";
+
+	if (summaryview->col_state[summaryview->col_pos[S_COL_TAGS]].visible) {
+		tags_text = procmsg_msginfo_get_tags_str(msginfo);
+		if (!tags_text) {
+			text[col_pos[S_COL_TAGS]] = "-";
+		} else {
+			strncpy2(tmp1, tags_text, sizeof(tmp1));
+			tmp1[sizeof(tmp1)-1]='\0';
+			g_free(tags_text);
+			text[col_pos[S_COL_TAGS]] = tmp1;
+		}
+	} else
+		text[col_pos[S_COL_TAGS]] = "";
+
+	/* slow! */
+	if (summaryview->col_state[summaryview->col_pos[S_COL_DATE]].visible || 
+	    ((vert_layout || small_layout) && prefs_common.two_line_vert)) {
+		if (msginfo->date_t && msginfo->date_t > 0) {
+			procheader_date_get_localtime(date_modified,
+						      sizeof(date_modified),
+						      msginfo->date_t);
+			text[col_pos[S_COL_DATE]] = date_modified;
+		} else if (msginfo->date)
+			text[col_pos[S_COL_DATE]] = msginfo->date;
+		else
+			text[col_pos[S_COL_DATE]] = _("(No Date)");
 	}
 	
+	summary_get_from_to_text(summaryview, msginfo, &from_text, &to_text);
+	text[col_pos[S_COL_TO]] = to_text;
+	text[col_pos[S_COL_FROM]] = from_text;
+
 	if (summaryview->simplify_subject_preg != NULL)
 		text[col_pos[S_COL_SUBJECT]] = msginfo->subject ? 
 			string_remove_match(tmp3, BUFFSIZE, msginfo->subject, 
@@ -3953,6 +4035,9 @@ static void summary_set_row_marks(SummaryView *summaryview, GtkCMCTreeNode *row)
 	msginfo = gtk_cmctree_node_get_row_data(ctree, row);
 	if (!msginfo) return;
 
+	/* done when the row gets filled */
+	if (GTK_CMCTREE_ROW(row)->row.fill_pending) return;
+
 	flags = msginfo->flags;
 
 	gtk_cmctree_node_set_foreground(ctree, row, NULL);
@@ -4196,10 +4281,69 @@ static void summary_mark_row_as_unread(SummaryView *summaryview,
 		msginfo->msgnum);
 }
 
+/*
+ * Marks the messages of rows, or of all the rows if rows is NULL, as
+ * read or unread with one flag change for all of them, and refreshes
+ * the rows.
+ */
+static void summary_mark_rows_read(SummaryView *summaryview, GList *rows,
+				   gboolean read)
+{
+	GtkCMCTree *ctree = GTK_CMCTREE(summaryview->ctree);
+	GtkCMCTreeNode *node;
+	MsgInfoList *msglist = NULL, *cur;
+	GList *all_rows = NULL, *row;
+	MsgInfo *msginfo;
+
+	if (rows == NULL) {
+		for (node = GTK_CMCTREE_NODE(GTK_CMCLIST(ctree)->row_list);
+		     node != NULL; node = gtkut_ctree_node_next(ctree, node))
+			all_rows = g_list_prepend(all_rows, node);
+		rows = all_rows = g_list_reverse(all_rows);
+	}
+
+	for (row = rows; row != NULL && row->data != NULL; row = row->next) {
+		msginfo = gtk_cmctree_node_get_row_data(ctree,
+				GTK_CMCTREE_NODE(row->data));
+		if (!msginfo)
+			continue;
+		if ((MSG_IS_NEW(msginfo->flags) || MSG_IS_UNREAD(msginfo->flags)) == read)
+			msglist = g_slist_prepend(msglist, msginfo);
+	}
+	msglist = g_slist_reverse(msglist);
+
+	if (!summaryview->folder_item->processing_pending) {
+		if (read)
+			procmsg_msglist_change_flags(msglist, 0, 0,
+						     MSG_NEW | MSG_UNREAD, 0);
+		else
+			procmsg_msglist_change_flags(msglist, MSG_UNREAD, 0,
+						     0, 0);
+	} else {
+		/* the changes have to be deferred one by one */
+		for (cur = msglist; cur != NULL; cur = cur->next) {
+			if (read)
+				summary_msginfo_unset_flags(cur->data,
+						MSG_NEW | MSG_UNREAD, 0);
+			else
+				summary_msginfo_set_flags(cur->data,
+						MSG_UNREAD, 0);
+		}
+	}
+	debug_print("%d messages are marked as %s\n",
+		    g_slist_length(msglist), read ? "read" : "unread");
+	g_slist_free(msglist);
+
+	/* collapsed rows show the state of their thread too */
+	for (row = rows; row != NULL && row->data != NULL; row = row->next)
+		summary_set_row_marks(summaryview, GTK_CMCTREE_NODE(row->data));
+
+	g_list_free(all_rows);
+}
+
 void summary_mark_as_read(SummaryView *summaryview)
 {
 	GtkCMCTree *ctree = GTK_CMCTREE(summaryview->ctree);
-	GList *cur;
 	gboolean froze = FALSE;
 
 	if (summary_is_locked(summaryview))
@@ -4211,11 +4355,7 @@ void summary_mark_as_read(SummaryView *summaryview)
 		return;
 
 	START_LONG_OPERATION(summaryview, FALSE);
-	folder_item_set_batch(summaryview->folder_item, TRUE);
-	for (cur = GTK_CMCLIST(ctree)->selection; cur != NULL && cur->data != NULL; cur = cur->next)
-		summary_mark_row_as_read(summaryview,
-					 GTK_CMCTREE_NODE(cur->data));
-	folder_item_set_batch(summaryview->folder_item, FALSE);
+	summary_mark_rows_read(summaryview, GTK_CMCLIST(ctree)->selection, TRUE);
 	END_LONG_OPERATION(summaryview);
 	
 	summary_status_show(summaryview);
@@ -4224,7 +4364,6 @@ void summary_mark_as_read(SummaryView *summaryview)
 void summary_mark_as_unread(SummaryView *summaryview)
 {
 	GtkCMCTree *ctree = GTK_CMCTREE(summaryview->ctree);
-	GList *cur;
 	gboolean froze = FALSE;
 
 	if (summary_is_locked(summaryview))
@@ -4236,11 +4375,7 @@ void summary_mark_as_unread(SummaryView *summaryview)
 		return;
 
 	START_LONG_OPERATION(summaryview, FALSE);
-	folder_item_set_batch(summaryview->folder_item, TRUE);
-	for (cur = GTK_CMCLIST(ctree)->selection; cur != NULL && cur->data != NULL; cur = cur->next)
-		summary_mark_row_as_unread(summaryview,
-					 GTK_CMCTREE_NODE(cur->data));
-	folder_item_set_batch(summaryview->folder_item, FALSE);
+	summary_mark_rows_read(summaryview, GTK_CMCLIST(ctree)->selection, FALSE);
 	END_LONG_OPERATION(summaryview);
 	
 	summary_status_show(summaryview);
@@ -4300,8 +4435,6 @@ static gboolean summary_mark_all_read_confirm(gboolean ask_if_needed)
 
 void summary_mark_all_read(SummaryView *summaryview, gboolean ask_if_needed)
 {
-	GtkCMCTree *ctree = GTK_CMCTREE(summaryview->ctree);
-	GtkCMCTreeNode *node;
 	gboolean froze = FALSE;
 
 	if (summary_is_locked(summaryview))
@@ -4311,16 +4444,7 @@ void summary_mark_all_read(SummaryView *summaryview, gboolean ask_if_needed)
 		return;
 
 	START_LONG_OPERATION(summaryview, TRUE);
-	folder_item_set_batch(summaryview->folder_item, TRUE);
-	for (node = GTK_CMCTREE_NODE(GTK_CMCLIST(ctree)->row_list); node != NULL;
-		node = gtkut_ctree_node_next(ctree, node))
-		summary_mark_row_as_read(summaryview, node);
-	folder_item_set_batch(summaryview->folder_item, FALSE);
-	for (node = GTK_CMCTREE_NODE(GTK_CMCLIST(ctree)->row_list); node != NULL;
-		node = gtkut_ctree_node_next(ctree, node)) {
-		if (!GTK_CMCTREE_ROW(node)->expanded)
-			summary_set_row_marks(summaryview, node);
-	}
+	summary_mark_rows_read(summaryview, NULL, TRUE);
 	END_LONG_OPERATION(summaryview);
 
 	summary_status_show(summaryview);
@@ -4346,8 +4470,6 @@ static gboolean summary_mark_all_unread_confirm(gboolean ask_if_needed)
 
 void summary_mark_all_unread(SummaryView *summaryview, gboolean ask_if_needed)
 {
-	GtkCMCTree *ctree = GTK_CMCTREE(summaryview->ctree);
-	GtkCMCTreeNode *node;
 	gboolean froze = FALSE;
 
 	if (summary_is_locked(summaryview))
@@ -4357,16 +4479,7 @@ void summary_mark_all_unread(SummaryView *summaryview, gboolean ask_if_needed)
 		return;
 
 	START_LONG_OPERATION(summaryview, TRUE);
-	folder_item_set_batch(summaryview->folder_item, TRUE);
-	for (node = GTK_CMCTREE_NODE(GTK_CMCLIST(ctree)->row_list); node != NULL;
-		node = gtkut_ctree_node_next(ctree, node))
-		summary_mark_row_as_unread(summaryview, node);
-	folder_item_set_batch(summaryview->folder_item, FALSE);
-	for (node = GTK_CMCTREE_NODE(GTK_CMCLIST(ctree)->row_list); node != NULL;
-		node = gtkut_ctree_node_next(ctree, node)) {
-		if (!GTK_CMCTREE_ROW(node)->expanded)
-			summary_set_row_marks(summaryview, node);
-	}
+	summary_mark_rows_read(summaryview, NULL, FALSE);
 	END_LONG_OPERATION(summaryview);
 
 	summary_status_show(summaryview);
@@ -6765,6 +6878,10 @@ static GtkWidget *summary_ctree_create(SummaryView *summaryview)
 	gtk_cmctree_set_indent(GTK_CMCTREE(ctree), 12);
 	g_object_set_data(G_OBJECT(ctree), "summaryview", (gpointer)summaryview); 
 
+	gtk_cmclist_set_row_fill_func(GTK_CMCLIST(ctree), summary_fill_row_func,
+				      summary_fill_rows_batch_func,
+				      summaryview, SUMMARY_FILLED_ROWS_MAX);
+
 	for (pos = 0; pos < N_SUMMARY_COLS; pos++) {
 		gtk_widget_set_can_focus(GTK_CMCLIST(ctree)->column[pos].button,
 				       FALSE);
@@ -7923,6 +8040,104 @@ static gint summary_cmp_by_score(GtkCMCList *clist,
 		return summary_cmp_by_date(clist, ptr1, ptr2);
 }
 
+/*
+ * Computes the sort key of a row once, in the order defined by the
+ * summary_cmp_by_*() functions above, so that sorting does not derive
+ * the same strings O(n log n) times. The columns' texts are computed
+ * from the MsgInfo, as rows which were not drawn yet have none.
+ */
+static void summary_sort_key_func(GtkSCTree *sctree, GtkCMCTreeNode *node,
+				  GtkSCTreeSortKey *key, gpointer data)
+{
+	SummaryView *summaryview = (SummaryView *)data;
+	MsgInfo *msginfo;
+	gchar buf[BUFFSIZE];
+	gchar *from_text, *to_text;
+	gchar *str = NULL;
+
+	msginfo = gtk_cmctree_node_get_row_data(GTK_CMCTREE(sctree), node);
+	if (!msginfo)
+		return;
+
+	/* ties are broken by date, then number */
+	key->num[1] = msginfo->date_t;
+	key->num[2] = msginfo->msgnum;
+
+	switch (summaryview->sort_key) {
+	case SORT_BY_MARK:
+		key->num[0] = MSG_IS_MARKED(msginfo->flags);
+		break;
+	case SORT_BY_STATUS:
+		key->num[0] = -(MSG_IS_SPAM(msginfo->flags))
+			      + (MSG_IS_UNREAD(msginfo->flags) << 1)
+			      + (MSG_IS_NEW(msginfo->flags) << 2);
+		break;
+	case SORT_BY_MIME:
+		key->num[0] = MSG_IS_WITH_ATTACHMENT(msginfo->flags);
+		break;
+	case SORT_BY_LABEL:
+		key->num[0] = MSG_GET_COLORLABEL(msginfo->flags);
+		break;
+	case SORT_BY_LOCKED:
+		key->num[0] = MSG_IS_LOCKED(msginfo->flags);
+		break;
+	case SORT_BY_NUMBER:
+		key->num[0] = msginfo->msgnum;
+		break;
+	case SORT_BY_SIZE:
+		key->num[0] = msginfo->size;
+		break;
+	case SORT_BY_DATE:
+		key->num[0] = msginfo->date_t;
+		break;
+	case SORT_BY_THREAD_DATE:
+		key->num[0] = (msginfo->thread_date > 0) ?
+			msginfo->thread_date : msginfo->date_t;
+		break;
+	case SORT_BY_SCORE:
+		key->num[0] = msginfo->score;
+		break;
+	case SORT_BY_FROM:
+	case SORT_BY_TO:
+		if (summaryview->sort_key == SORT_BY_FROM &&
+		    !summaryview->col_state[summaryview->col_pos[S_COL_FROM]].visible) {
+			str = msginfo->from;
+		} else if (summaryview->sort_key == SORT_BY_TO &&
+		    !summaryview->col_state[summaryview->col_pos[S_COL_TO]].visible) {
+			str = msginfo->to;
+		} else {
+			summary_get_from_to_text(summaryview, msginfo,
+						 &from_text, &to_text);
+			str = (summaryview->sort_key == SORT_BY_FROM) ?
+				from_text : to_text;
+		}
+		if (str)
+			key->str = g_utf8_collate_key(str, -1);
+		break;
+	case SORT_BY_SUBJECT:
+		str = msginfo->subject;
+		if (summaryview->simplify_subject_preg &&
+		    summaryview->col_state[summaryview->col_pos[S_COL_SUBJECT]].visible)
+			str = msginfo->subject ?
+				string_remove_match(buf, BUFFSIZE, msginfo->subject,
+						    summaryview->simplify_subject_preg) :
+				_("(No Subject)");
+		key->str = subject_get_sort_key(str);
+		break;
+	case SORT_BY_TAGS:
+		str = procmsg_msginfo_get_tags_str(msginfo);
+		if (!str &&
+		    summaryview->col_state[summaryview->col_pos[S_COL_TAGS]].visible)
+			key->str = g_utf8_collate_key("-", -1);
+		else if (str)
+			key->str = g_utf8_collate_key(str, -1);
+		g_free(str);
+		break;
+	default:
+		break;
+	}
+}
+
 static void summary_ignore_thread_func_mark_unread(GtkCMCTree *ctree, GtkCMCTreeNode *row, gpointer data)
 {
 	MsgInfo *msginfo;
@@ -8367,6 +8582,44 @@ static gboolean summary_update_msg(gpointer source, gpointer data)
 	return FALSE;
 }
 
+static gboolean summary_update_msglist(gpointer source, gpointer data)
+{
+	MsgInfoListUpdate *list_update = (MsgInfoListUpdate *) source;
+	SummaryView *summaryview = (SummaryView *)data;
+	GtkCMCTree *ctree;
+	GtkCMCTreeNode *node;
+	GHashTable *changed;
+	MsgInfoList *cur;
+
+	cm_return_val_if_fail(list_update != NULL, TRUE);
+	cm_return_val_if_fail(summaryview != NULL, FALSE);
+
+	if (!(list_update->flags & MSGINFO_UPDATE_FLAGS))
+		return FALSE;
+
+	changed = g_hash_table_new(NULL, NULL);
+	for (cur = list_update->msglist; cur != NULL; cur = cur->next) {
+		MsgInfo *msginfo = (MsgInfo *)cur->data;
+
+		if (msginfo->folder == summaryview->folder_item)
+			g_hash_table_insert(changed, msginfo, msginfo);
+	}
+
+	/* one walk over the rows rather than one lookup per message */
+	if (g_hash_table_size(changed) > 0) {
+		ctree = GTK_CMCTREE(summaryview->ctree);
+		for (node = GTK_CMCTREE_NODE(GTK_CMCLIST(ctree)->row_list);
+		     node != NULL; node = gtkut_ctree_node_next(ctree, node)) {
+			if (g_hash_table_lookup(changed,
+					gtk_cmctree_node_get_row_data(ctree, node)))
+				summary_set_row_marks(summaryview, node);
+		}
+	}
+	g_hash_table_destroy(changed);
+
+	return FALSE;
+}
+
 void summary_update_unread(SummaryView *summaryview, FolderItem *removed_item)
 {
 	guint new, unread, unreadmarked, marked, total;
@@ -162,6 +162,7 @@ private:
 	/* list for moving/deleting messages */
 	GSList *mlist;
 	int msginfo_update_callback_id;
+	int msginfo_list_update_callback_id;
 
 	/* update folder label when renaming */
 	gint folder_item_update_callback_id;
@@ -0,0 +1,179 @@
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "attach_encoder.h"
+#include "defs.h"
+
+#include "common/tests/mock_prefs_common_get_use_shred.h"
+#include "common/tests/mock_prefs_common_get_flush_metadata.h"
+
+static gchar *tmpdir = NULL;
+static gint encode_calls = 0;
+
+/* stands for procmime's encoder: base64 of the whole file on one line,
+ * "QP:" and the content for quoted-printable */
+gboolean procmime_encode_stream(FILE *infp, FILE *outfp, EncodingType encoding)
+{
+	GString *content = g_string_new(NULL);
+	gchar buf[1024];
+	gsize len;
+	gchar *out;
+
+	g_atomic_int_inc(&encode_calls);
+	while ((len = fread(buf, 1, sizeof(buf), infp)) > 0)
+		g_string_append_len(content, buf, len);
+
+	if (encoding == ENC_BASE64) {
+		out = g_base64_encode((guchar *)content->str, content->len);
+		fprintf(outfp, "%s\n", out);
+		g_free(out);
+	} else {
+		fprintf(outfp, "QP:%s", content->str);
+	}
+	g_string_free(content, TRUE);
+
+	return TRUE;
+}
+
+static gchar *
+write_file(const gchar *name, const gchar *content)
+{
+	gchar *path = g_build_filename(tmpdir, name, NULL);
+
+	g_assert_true(g_file_set_contents(path, content, -1, NULL));
+	return path;
+}
+
+static void
+check_result(const gchar *result, goffset length, const gchar *expected)
+{
+	gchar *contents;
+	gsize len;
+
+	g_assert_nonnull(result);
+	g_assert_true(g_file_get_contents(result, &contents, &len, NULL));
+	g_assert_cmpstr(contents, ==, expected);
+	g_assert_cmpint(length, ==, strlen(expected));
+	g_free(contents);
+}
+
+static void
+test_attach_encoder_output(void)
+{
+	gchar *file = write_file("binary", "\x01\x02\x03hello");
+	gchar *text = write_file("text", "From me\n");
+	AttachEncoder *encoder, *qp;
+	const gchar *result;
+	gchar *encoded;
+	goffset length;
+
+	encoder = attach_encoder_new(file, ENC_BASE64);
+	g_assert_nonnull(encoder);
+	result = attach_encoder_get_result(encoder, file, ENC_BASE64, &length);
+	encoded = g_strdup_printf("%s\n", "AQIDaGVsbG8=");
+	check_result(result, length, encoded);
+	g_free(encoded);
+
+	/* the result is only for the file and encoding it was made for */
+	g_assert_null(attach_encoder_get_result(encoder, text, ENC_BASE64, &length));
+	g_assert_null(attach_encoder_get_result(encoder, file,
+			ENC_QUOTED_PRINTABLE, &length));
+
+	qp = attach_encoder_new(text, ENC_QUOTED_PRINTABLE);
+	result = attach_encoder_get_result(qp, text, ENC_QUOTED_PRINTABLE, &length);
+	check_result(result, length, "QP:From me\n");
+
+	/* the encoded files go with the encoders */
+	encoded = g_strdup(result);
+	attach_encoder_free(qp);
+	g_assert_false(g_file_test(encoded, G_FILE_TEST_EXISTS));
+	g_free(encoded);
+
+	/* nothing to gain for the other encodings */
+	g_assert_null(attach_encoder_new(text, ENC_7BIT));
+	g_assert_null(attach_encoder_new(text, ENC_8BIT));
+
+	attach_encoder_free(encoder);
+	g_unlink(file);
+	g_unlink(text);
+	g_free(file);
+	g_free(text);
+}
+
+static void
+test_attach_encoder_invalidation(void)
+{
+	gchar *file = write_file("changing", "first");
+	AttachEncoder *encoder;
+	const gchar *result;
+	goffset length;
+	gint calls;
+
+	encoder = attach_encoder_new(file, ENC_BASE64);
+	result = attach_encoder_get_result(encoder, file, ENC_BASE64, &length);
+	check_result(result, length, "Zmlyc3Q=\n");
+	calls = g_atomic_int_get(&encode_calls);
+
+	/* unchanged, the result is reused */
+	result = attach_encoder_get_result(encoder, file, ENC_BASE64, &length);
+	check_result(result, length, "Zmlyc3Q=\n");
+	g_assert_cmpint(g_atomic_int_get(&encode_calls), ==, calls);
+
+	/* changed, the caller encodes it itself this time and the file is
+	 * encoded again for the next one */
+	g_free(write_file("changing", "second one"));
+	g_assert_null(attach_encoder_get_result(encoder, file, ENC_BASE64, &length));
+	result = attach_encoder_get_result(encoder, file, ENC_BASE64, &length);
+	check_result(result, length, "c2Vjb25kIG9uZQ==\n");
+	g_assert_cmpint(g_atomic_int_get(&encode_calls), ==, calls + 1);
+
+	/* gone, there is nothing to use */
+	g_unlink(file);
+	g_assert_null(attach_encoder_get_result(encoder, file, ENC_BASE64, &length));
+
+	attach_encoder_free(encoder);
+	g_free(file);
+}
+
+static void
+test_attach_encoder_free_running(void)
+{
+	gchar *file = write_file("freed", "freed while running");
+	gint i;
+
+	/* the workers clean up after the encoders freed while running */
+	for (i = 0; i < 16; i++)
+		attach_encoder_free(attach_encoder_new(file, ENC_BASE64));
+
+	g_unlink(file);
+	g_free(file);
+}
+
+int
+main(int argc, char *argv[])
+{
+	gchar *mime_tmp_dir;
+	int ret;
+
+	g_test_init(&argc, &argv, NULL);
+
+	tmpdir = g_dir_make_tmp("attach_encoder_test_XXXXXX", NULL);
+	g_assert_nonnull(tmpdir);
+	set_rc_dir(tmpdir);
+	mime_tmp_dir = g_build_filename(tmpdir, MIME_TMP_DIR, NULL);
+	g_assert_cmpint(g_mkdir(mime_tmp_dir, 0700), ==, 0);
+
+	g_test_add_func("/core/attach_encoder/output", test_attach_encoder_output);
+	g_test_add_func("/core/attach_encoder/invalidation", test_attach_encoder_invalidation);
+	g_test_add_func("/core/attach_encoder/free_running", test_attach_encoder_free_running);
+
+	ret = g_test_run();
+
+	remove_dir_recursive(tmpdir);
+	g_free(mime_tmp_dir);
+	g_free(tmpdir);
+
+	return ret;
+}
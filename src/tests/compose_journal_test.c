@@ -0,0 +1,194 @@
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "compose_journal.h"
+
+#include "common/tests/mock_prefs_common_get_use_shred.h"
+#include "common/tests/mock_prefs_common_get_flush_metadata.h"
+
+#define INFO "X-Claws-Account-Id:1\nSubject:Hello\nHeader:To:\tuser@example.com\n"
+#define ATTACHMENTS "/tmp/big.iso\tapplication/octet-stream\tbig.iso\t\n"
+
+static gchar *tmpdir = NULL;
+
+static gchar *
+journal_path(const gchar *name)
+{
+	return g_build_filename(tmpdir, name, NULL);
+}
+
+static goffset
+file_size(const gchar *path)
+{
+	GStatBuf s;
+
+	if (g_stat(path, &s) < 0)
+		return -1;
+	return s.st_size;
+}
+
+static void
+check_journal(const gchar *path, const gchar *info, const gchar *attachments,
+	      const gchar *body)
+{
+	gchar *r_info, *r_attachments, *r_body;
+
+	g_assert_cmpint(compose_journal_read(path, &r_info, &r_attachments, &r_body), ==, 0);
+	g_assert_cmpstr(r_info, ==, info);
+	g_assert_cmpstr(r_attachments, ==, attachments);
+	g_assert_cmpstr(r_body, ==, body);
+
+	g_free(r_info);
+	g_free(r_attachments);
+	g_free(r_body);
+}
+
+static gchar *
+make_body(gsize size)
+{
+	GString *body = g_string_sized_new(size);
+
+	while (body->len < size)
+		g_string_append(body, "All work and no play makes Jack a dull boy.\n");
+
+	return g_string_free(body, FALSE);
+}
+
+static void
+test_compose_journal_snapshot(void)
+{
+	gchar *path = journal_path("snapshot");
+	ComposeJournal *journal = compose_journal_new(path);
+
+	g_assert_cmpint(compose_journal_save(journal, INFO, ATTACHMENTS, "Hi,\n"), ==, 0);
+	check_journal(path, INFO, ATTACHMENTS, "Hi,\n");
+
+	compose_journal_remove(journal);
+	g_assert_false(g_file_test(path, G_FILE_TEST_EXISTS));
+
+	compose_journal_free(journal);
+	g_free(path);
+}
+
+static void
+test_compose_journal_incremental(void)
+{
+	gchar *path = journal_path("incremental");
+	ComposeJournal *journal = compose_journal_new(path);
+	gchar *body = make_body(256 * 1024);
+	gchar *edited;
+	goffset size;
+
+	g_assert_cmpint(compose_journal_save(journal, INFO, ATTACHMENTS, body), ==, 0);
+	size = file_size(path);
+	g_assert_cmpint(size, >, 256 * 1024);
+
+	/* nothing changed, nothing written */
+	g_assert_cmpint(compose_journal_save(journal, INFO, ATTACHMENTS, body), ==, 0);
+	g_assert_cmpint(file_size(path), ==, size);
+
+	/* a word typed in the middle only adds a small record */
+	edited = g_strdup_printf("%.*sdull %s", 100000, body, body + 100000);
+	g_assert_cmpint(compose_journal_save(journal, INFO, ATTACHMENTS, edited), ==, 0);
+	g_assert_cmpint(file_size(path) - size, <, 64);
+	check_journal(path, INFO, ATTACHMENTS, edited);
+
+	/* so does a removal, and a new header */
+	size = file_size(path);
+	g_assert_cmpint(compose_journal_save(journal, INFO "Header:Cc:\tother@example.com\n",
+					     ATTACHMENTS, body + 10), ==, 0);
+	g_assert_cmpint(file_size(path) - size, <, 256);
+	check_journal(path, INFO "Header:Cc:\tother@example.com\n", ATTACHMENTS, body + 10);
+
+	compose_journal_remove(journal);
+	compose_journal_free(journal);
+	g_free(edited);
+	g_free(body);
+	g_free(path);
+}
+
+static void
+test_compose_journal_torn(void)
+{
+	gchar *path = journal_path("torn");
+	ComposeJournal *journal = compose_journal_new(path);
+	gchar *contents, *contents_magic;
+	gchar *info, *attachments, *body;
+	gsize len;
+
+	g_assert_cmpint(compose_journal_save(journal, INFO, ATTACHMENTS, "Hi,\n"), ==, 0);
+	g_assert_cmpint(compose_journal_save(journal, INFO, ATTACHMENTS, "Hi there,\n"), ==, 0);
+	g_assert_cmpint(compose_journal_save(journal, INFO, ATTACHMENTS, "Hi there,\nHow"), ==, 0);
+
+	/* cut in the middle of the last record, as by a crash */
+	g_assert_true(g_file_get_contents(path, &contents, &len, NULL));
+	g_assert_true(g_file_set_contents(path, contents, len - 2, NULL));
+	contents_magic = g_strndup(contents, strchr(contents, '\n') + 1 - contents);
+	g_free(contents);
+
+	check_journal(path, INFO, ATTACHMENTS, "Hi there,\n");
+
+	/* without a complete snapshot there is nothing to recover */
+	g_assert_true(g_file_set_contents(path, contents_magic, -1, NULL));
+	g_assert_cmpint(compose_journal_read(path, &info, &attachments, &body), ==, -1);
+
+	compose_journal_remove(journal);
+	compose_journal_free(journal);
+	g_free(contents_magic);
+	g_free(path);
+}
+
+static void
+test_compose_journal_compact(void)
+{
+	gchar *path = journal_path("compact");
+	ComposeJournal *journal = compose_journal_new(path);
+	gchar *body = make_body(4 * 1024);
+	gchar *edited = NULL;
+	gint i;
+
+	/* edits at both ends rewrite the whole body each time, and get the
+	 * journal compacted */
+	for (i = 0; i < 2000; i++) {
+		g_free(edited);
+		edited = g_strdup_printf("%d %s %d", i, body, i);
+		g_assert_cmpint(compose_journal_save(journal, INFO, ATTACHMENTS, edited), ==, 0);
+		g_assert_cmpint(file_size(path), <, 3 * 8 * 1024 + 64 * 1024);
+	}
+	check_journal(path, INFO, ATTACHMENTS, edited);
+
+	compose_journal_remove(journal);
+	compose_journal_free(journal);
+	g_free(edited);
+	g_free(body);
+	g_free(path);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int ret;
+
+	g_test_init(&argc, &argv, NULL);
+
+	tmpdir = g_dir_make_tmp("compose_journal_XXXXXX", NULL);
+	g_assert_nonnull(tmpdir);
+
+	g_test_add_func("/compose_journal/snapshot",
+			test_compose_journal_snapshot);
+	g_test_add_func("/compose_journal/incremental",
+			test_compose_journal_incremental);
+	g_test_add_func("/compose_journal/torn",
+			test_compose_journal_torn);
+	g_test_add_func("/compose_journal/compact",
+			test_compose_journal_compact);
+
+	ret = g_test_run();
+
+	g_rmdir(tmpdir);
+	g_free(tmpdir);
+
+	return ret;
+}
@@ -1,5 +1,6 @@
 #include <glib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "mock_debug_print.h"
 
@@ -90,15 +91,80 @@ test_entity_valid(void)
 
 }
 
+static void
+test_entity_symbols(void)
+{
+	gchar *result, buf[ENTITY_DECODED_MAX_LEN + 1];
+
+	result = entity_decode("&amp;");
+	g_assert_cmpstr(result, ==, "&");
+	g_free(result);
+	result = entity_decode("&euro;");
+	g_assert_cmpstr(result, ==, "€");
+	g_free(result);
+	result = entity_decode("&zwnj;");
+	g_assert_cmpstr(result, ==, "\xE2\x80\x8C");
+	g_free(result);
+
+	/* Names are case sensitive */
+	result = entity_decode("&AMP;");
+	g_assert_null(result);
+	result = entity_decode("&Amp;");
+	g_assert_null(result);
+	result = entity_decode("&ampx;");
+	g_assert_null(result);
+
+	/* Valid, but longer than ENTITY_MAX_LEN */
+	result = entity_decode("&thetasym;");
+	g_assert_null(result);
+
+	g_assert_true(entity_decode_to_buffer("&Aacute;", buf));
+	g_assert_cmpstr(buf, ==, "Á");
+	g_assert_true(entity_decode_to_buffer("&#1114111;", buf));
+	g_assert_cmpstr(buf, ==, "\xF4\x8F\xBF\xBF");
+	g_assert_false(entity_decode_to_buffer("&bogus;", buf));
+}
+
+static gpointer
+decode_symbols(gpointer data)
+{
+	gchar buf[ENTITY_DECODED_MAX_LEN + 1];
+	gint i;
+
+	for (i = 0; i < 1000; i++) {
+		if (!entity_decode_to_buffer("&eacute;", buf) ||
+		    strcmp(buf, "é") ||
+		    !entity_decode_to_buffer("&Omega;", buf) ||
+		    strcmp(buf, "Ω"))
+			return GINT_TO_POINTER(FALSE);
+	}
+	return GINT_TO_POINTER(TRUE);
+}
+
+/* run first, so that the threads race to build the symbol table */
+static void
+test_entity_threads(void)
+{
+	GThread *threads[8];
+	gint i;
+
+	for (i = 0; i < G_N_ELEMENTS(threads); i++)
+		threads[i] = g_thread_new("entity", decode_symbols, NULL);
+	for (i = 0; i < G_N_ELEMENTS(threads); i++)
+		g_assert_true(GPOINTER_TO_INT(g_thread_join(threads[i])));
+}
+
 int
 main(int argc, char *argv[])
 {
 	g_test_init(&argc, &argv, NULL);
 
+	g_test_add_func("/core/entity/threads", test_entity_threads);
 	g_test_add_func("/core/entity/invalid", test_entity_invalid);
 	g_test_add_func("/core/entity/toolong", test_entity_toolong);
 	g_test_add_func("/core/entity/unprintable", test_entity_unprintable);
 	g_test_add_func("/core/entity/valid", test_entity_valid);
+	g_test_add_func("/core/entity/symbols", test_entity_symbols);
 
 	return g_test_run();
 }
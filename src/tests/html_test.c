@@ -0,0 +1,692 @@
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "html.h"
+#include "codeconv.h"
+#include "entity.h"
+#include "utils.h"
+#include "file-utils.h"
+
+#include "common/tests/mock_prefs_common_get_use_shred.h"
+#include "common/tests/mock_prefs_common_get_flush_metadata.h"
+
+/* The converter as it was before tags were switched on and text copied
+ * by runs, kept here to compare against. */
+#define SC_HTMLBUFSIZE	8192
+#define HR_STR		"────────────────────────────────────────────────"
+#define LI_STR		"• "
+
+static SC_HTMLState ref_html_read_line	(SC_HTMLParser	*parser);
+static void ref_html_append_char			(SC_HTMLParser	*parser,
+					 gchar		 ch);
+static void ref_html_append_str			(SC_HTMLParser	*parser,
+					 const gchar	*str,
+					 gint		 len);
+static SC_HTMLState ref_html_parse_tag	(SC_HTMLParser	*parser);
+static void ref_html_parse_special		(SC_HTMLParser	*parser);
+static void ref_html_get_parenthesis		(SC_HTMLParser	*parser,
+					 gchar		*buf,
+					 gint		 len);
+
+
+static SC_HTMLParser *ref_html_parser_new(FILE *fp, CodeConverter *conv)
+{
+	SC_HTMLParser *parser;
+
+	cm_return_val_if_fail(fp != NULL, NULL);
+	cm_return_val_if_fail(conv != NULL, NULL);
+
+	parser = g_new0(SC_HTMLParser, 1);
+	parser->fp = fp;
+	parser->conv = conv;
+	parser->str = g_string_new(NULL);
+	parser->buf = g_string_new(NULL);
+	parser->bufp = parser->buf->str;
+	parser->state = SC_HTML_NORMAL;
+	parser->href = NULL;
+	parser->newline = TRUE;
+	parser->empty_line = TRUE;
+	parser->space = FALSE;
+	parser->pre = FALSE;
+	parser->indent = 0;
+
+	return parser;
+}
+
+static void ref_html_parser_destroy(SC_HTMLParser *parser)
+{
+	g_string_free(parser->str, TRUE);
+	g_string_free(parser->buf, TRUE);
+	g_free(parser->href);
+	g_free(parser);
+}
+
+static gchar *ref_html_parse(SC_HTMLParser *parser)
+{
+	parser->state = SC_HTML_NORMAL;
+	g_string_truncate(parser->str, 0);
+
+	if (*parser->bufp == '\0') {
+		g_string_truncate(parser->buf, 0);
+		parser->bufp = parser->buf->str;
+		if (ref_html_read_line(parser) == SC_HTML_EOF)
+			return NULL;
+	}
+
+	while (*parser->bufp != '\0') {
+		switch (*parser->bufp) {
+		case '<': {
+			SC_HTMLState st;
+			st = ref_html_parse_tag(parser);
+			/* when we see an href, we need to flush the str
+			 * buffer.  Then collect all the chars until we
+			 * see the end anchor tag
+			 */
+			if (SC_HTML_HREF_BEG == st || SC_HTML_HREF == st)
+				return parser->str->str;
+			} 
+			break;
+		case '&':
+			ref_html_parse_special(parser);
+			break;
+		case ' ':
+		case '\t':
+		case '\r':
+		case '\n':
+			if (parser->bufp[0] == '\r' && parser->bufp[1] == '\n')
+				parser->bufp++;
+
+			if (!parser->pre) {
+				if (!parser->newline)
+					parser->space = TRUE;
+
+				parser->bufp++;
+				break;
+			}
+			/* fallthrough */
+		default:
+			ref_html_append_char(parser, *parser->bufp++);
+		}
+	}
+
+	return parser->str->str;
+}
+
+static SC_HTMLState ref_html_read_line(SC_HTMLParser *parser)
+{
+	gchar buf[SC_HTMLBUFSIZE];
+	gchar buf2[SC_HTMLBUFSIZE*4];
+	gint index;
+	gint n;
+
+	if (parser->fp == NULL)
+		return SC_HTML_EOF;
+
+	n = claws_fread(buf, 1, sizeof(buf) - 1, parser->fp);
+	if (n == 0) {
+		parser->state = SC_HTML_EOF;
+		return SC_HTML_EOF;
+	} else
+		buf[n] = '\0';
+
+	if (conv_convert(parser->conv, buf2, sizeof(buf2), buf) < 0) {
+		index = parser->bufp - parser->buf->str;
+
+		conv_utf8todisp(buf2, sizeof(buf2), buf);
+		g_string_append(parser->buf, buf2);
+
+		parser->bufp = parser->buf->str + index;
+
+		return SC_HTML_CONV_FAILED;
+	}
+
+	index = parser->bufp - parser->buf->str;
+
+	g_string_append(parser->buf, buf2);
+
+	parser->bufp = parser->buf->str + index;
+
+	return SC_HTML_NORMAL;
+}
+
+static void ref_html_append_char(SC_HTMLParser *parser, gchar ch)
+{
+	GString *str = parser->str;
+
+	if (!parser->pre && parser->space) {
+		g_string_append_c(str, ' ');
+		parser->space = FALSE;
+	}
+
+	g_string_append_c(str, ch);
+
+	parser->empty_line = FALSE;
+	if (ch == '\n') {
+		parser->newline = TRUE;
+		if (str->len > 1 && str->str[str->len - 2] == '\n')
+			parser->empty_line = TRUE;
+		if (parser->indent > 0) {
+			gint i, n = parser->indent;
+			for (i = 0; i < n; i++)
+				g_string_append_c(str, '>');
+			g_string_append_c(str, ' ');
+		}
+	} else
+		parser->newline = FALSE;
+}
+
+static void ref_html_append_str(SC_HTMLParser *parser, const gchar *str, gint len)
+{
+	GString *string = parser->str;
+
+	if (!parser->pre && parser->space) {
+		g_string_append_c(string, ' ');
+		parser->space = FALSE;
+	}
+
+	if (len == 0) return;
+	if (len < 0)
+		g_string_append(string, str);
+	else {
+		gchar *s;
+		Xstrndup_a(s, str, len, return);
+		g_string_append(string, s);
+	}
+
+	parser->empty_line = FALSE;
+	if (string->len > 0 && string->str[string->len - 1] == '\n') {
+		parser->newline = TRUE;
+		if (string->len > 1 && string->str[string->len - 2] == '\n')
+			parser->empty_line = TRUE;
+	} else
+		parser->newline = FALSE;
+}
+
+static SC_HTMLTag *ref_html_get_tag(const gchar *str)
+{
+	SC_HTMLTag *tag;
+	gchar *tmp;
+	guchar *tmpp;
+
+	cm_return_val_if_fail(str != NULL, NULL);
+
+	if (*str == '\0' || *str == '!') return NULL;
+
+	Xstrdup_a(tmp, str, return NULL);
+
+	tag = g_new0(SC_HTMLTag, 1);
+
+	for (tmpp = tmp; *tmpp != '\0' && !g_ascii_isspace(*tmpp); tmpp++)
+		;
+
+	if (*tmpp == '\0') {
+		tag->name = g_utf8_strdown(tmp, -1);
+		return tag;
+	} else {
+		*tmpp++ = '\0';
+		tag->name = g_utf8_strdown(tmp, -1);
+	}
+
+	while (*tmpp != '\0') {
+		SC_HTMLAttr *attr;
+		gchar *attr_name;
+		gchar *attr_value;
+		gchar *p;
+		gchar quote;
+
+		while (g_ascii_isspace(*tmpp)) tmpp++;
+		attr_name = tmpp;
+
+		while (*tmpp != '\0' && !g_ascii_isspace(*tmpp) &&
+		       *tmpp != '=')
+			tmpp++;
+		if (*tmpp != '\0' && *tmpp != '=') {
+			*tmpp++ = '\0';
+			while (g_ascii_isspace(*tmpp)) tmpp++;
+		}
+
+		if (*tmpp == '=') {
+			*tmpp++ = '\0';
+			while (g_ascii_isspace(*tmpp)) tmpp++;
+
+			if (*tmpp == '"' || *tmpp == '\'') {
+				/* name="value" */
+				quote = *tmpp;
+				tmpp++;
+				attr_value = tmpp;
+				if ((p = strchr(attr_value, quote)) == NULL) {
+					if (debug_get_mode()) {
+						g_warning("ref_html_get_tag(): syntax error in tag: '%s'",
+								  str);
+					} else {
+						gchar *cut = g_strndup(str, 100);
+						g_warning("ref_html_get_tag(): syntax error in tag: '%s%s'",
+								  cut, strlen(str)>100?"...":".");
+						g_free(cut);
+					}
+					return tag;
+				}
+				tmpp = p;
+				*tmpp++ = '\0';
+				while (g_ascii_isspace(*tmpp)) tmpp++;
+			} else {
+				/* name=value */
+				attr_value = tmpp;
+				while (*tmpp != '\0' && !g_ascii_isspace(*tmpp)) tmpp++;
+				if (*tmpp != '\0')
+					*tmpp++ = '\0';
+			}
+		} else
+			attr_value = "";
+
+		g_strchomp(attr_name);
+		attr = g_new(SC_HTMLAttr, 1);
+		attr->name = g_utf8_strdown(attr_name, -1);
+		attr->value = g_strdup(attr_value);
+		tag->attr = g_list_append(tag->attr, attr);
+	}
+
+	return tag;
+}
+
+static void ref_html_free_tag(SC_HTMLTag *tag)
+{
+	if (!tag) return;
+
+	g_free(tag->name);
+	while (tag->attr != NULL) {
+		SC_HTMLAttr *attr = (SC_HTMLAttr *)tag->attr->data;
+		g_free(attr->name);
+		g_free(attr->value);
+		g_free(attr);
+		tag->attr = g_list_remove(tag->attr, tag->attr->data);
+	}
+	g_free(tag);
+}
+
+static void ref_decode_href(SC_HTMLParser *parser)
+{
+	gchar *tmp;
+	SC_HTMLParser *tparser = g_new0(SC_HTMLParser, 1);
+
+	tparser->str = g_string_new(NULL);
+	tparser->buf = g_string_new(parser->href);
+	tparser->bufp = tparser->buf->str;
+
+	tmp = ref_html_parse(tparser);
+	
+	g_free(parser->href);
+	parser->href = g_strdup(tmp);
+
+	ref_html_parser_destroy(tparser);
+}
+
+static SC_HTMLState ref_html_parse_tag(SC_HTMLParser *parser)
+{
+	gchar buf[SC_HTMLBUFSIZE];
+	SC_HTMLTag *tag;
+
+	ref_html_get_parenthesis(parser, buf, sizeof(buf));
+
+	tag = ref_html_get_tag(buf);
+
+	parser->state = SC_HTML_UNKNOWN;
+	if (!tag) return SC_HTML_UNKNOWN;
+
+	if (!strcmp(tag->name, "br") || !strcmp(tag->name, "br/")) {
+		parser->space = FALSE;
+		ref_html_append_char(parser, '\n');
+		parser->state = SC_HTML_BR;
+	} else if (!strcmp(tag->name, "a")) {
+		GList *cur;
+		if (parser->href != NULL) {
+			g_free(parser->href);
+			parser->href = NULL;
+		}
+		for (cur = tag->attr; cur != NULL; cur = cur->next) {
+			if (cur->data && !strcmp(((SC_HTMLAttr *)cur->data)->name, "href")) {
+				g_free(parser->href);
+				parser->href = g_strdup(((SC_HTMLAttr *)cur->data)->value);
+				ref_decode_href(parser);
+				parser->state = SC_HTML_HREF_BEG;
+				break;
+			}
+		}
+		if (parser->href == NULL)
+			parser->href = g_strdup("");
+		parser->state = SC_HTML_HREF_BEG;
+	} else if (!strcmp(tag->name, "/a")) {
+		parser->state = SC_HTML_HREF;
+	} else if (!strcmp(tag->name, "p")) {
+		parser->space = FALSE;
+		if (!parser->empty_line) {
+			parser->space = FALSE;
+			if (!parser->newline) ref_html_append_char(parser, '\n');
+			ref_html_append_char(parser, '\n');
+		}
+		parser->state = SC_HTML_PAR;
+	} else if (!strcmp(tag->name, "pre")) {
+		parser->pre = TRUE;
+		parser->state = SC_HTML_PRE;
+	} else if (!strcmp(tag->name, "/pre")) {
+		parser->pre = FALSE;
+		parser->state = SC_HTML_NORMAL;
+	} else if (!strcmp(tag->name, "hr")) {
+		if (!parser->newline) {
+			parser->space = FALSE;
+			ref_html_append_char(parser, '\n');
+		}
+		ref_html_append_str(parser, HR_STR, -1);
+		ref_html_append_char(parser, '\n');
+		parser->state = SC_HTML_HR;
+	} else if (!strcmp(tag->name, "div")    ||
+		   !strcmp(tag->name, "ul")     ||
+		   !strcmp(tag->name, "li")     ||
+		   !strcmp(tag->name, "table")  ||
+		   !strcmp(tag->name, "dd")     ||
+		   !strcmp(tag->name, "tr")) {
+		if (!parser->newline) {
+			parser->space = FALSE;
+			ref_html_append_char(parser, '\n');
+		}
+		if (!strcmp(tag->name, "li")) {
+			ref_html_append_str(parser, LI_STR, -1);
+		}
+		parser->state = SC_HTML_NORMAL;
+	} else if (tag->name[0] == 'h' && g_ascii_isdigit(tag->name[1])) {
+		if (!parser->newline) {
+			parser->space = FALSE;
+			ref_html_append_char(parser, '\n');
+		}
+		ref_html_append_char(parser, '\n');
+	} else if (!strcmp(tag->name, "blockquote")) {
+		parser->state = SC_HTML_NORMAL;
+		parser->indent++;
+	} else if (!strcmp(tag->name, "/blockquote")) {
+		parser->state = SC_HTML_NORMAL;
+		parser->indent--;
+	} else if (!strcmp(tag->name, "/table") ||
+		   (tag->name[0] == '/' &&
+		    tag->name[1] == 'h' &&
+		    g_ascii_isdigit(tag->name[2]))) {
+		if (!parser->empty_line) {
+			parser->space = FALSE;
+			if (!parser->newline) ref_html_append_char(parser, '\n');
+			ref_html_append_char(parser, '\n');
+		}
+		parser->state = SC_HTML_NORMAL;
+	} else if (!strcmp(tag->name, "/div")   ||
+		   !strcmp(tag->name, "/ul")    ||
+		   !strcmp(tag->name, "/li")) {
+		if (!parser->newline) {
+			parser->space = FALSE;
+			ref_html_append_char(parser, '\n');
+		}
+		parser->state = SC_HTML_NORMAL;
+			}
+
+	ref_html_free_tag(tag);
+
+	return parser->state;
+}
+
+static void ref_html_parse_special(SC_HTMLParser *parser)
+{
+	gchar *entity;
+
+	parser->state = SC_HTML_UNKNOWN;
+	cm_return_if_fail(*parser->bufp == '&');
+
+	entity = entity_decode(parser->bufp);
+	if (entity != NULL) {
+		ref_html_append_str(parser, entity, -1);
+		g_free(entity);
+		while (*parser->bufp++ != ';');
+	} else {
+		/* output literal `&' */
+		ref_html_append_char(parser, *parser->bufp++);
+	}
+	parser->state = SC_HTML_NORMAL;
+}
+
+static gchar *ref_html_find_tag(SC_HTMLParser *parser, const gchar *tag)
+{
+	gchar *cur = parser->bufp;
+	gint len = strlen(tag);
+
+	if (cur == NULL)
+		return NULL;
+
+	while ((cur = strstr(cur, "<")) != NULL) {
+		if (!g_ascii_strncasecmp(cur, tag, len))
+			return cur;
+		cur += 2;
+	}
+	return NULL;
+}
+
+static void ref_html_get_parenthesis(SC_HTMLParser *parser, gchar *buf, gint len)
+{
+	gchar *p;
+
+	buf[0] = '\0';
+	cm_return_if_fail(*parser->bufp == '<');
+
+	/* ignore comment / CSS / script stuff */
+	if (!strncmp(parser->bufp, "<!--", 4)) {
+		parser->bufp += 4;
+		while ((p = strstr(parser->bufp, "-->")) == NULL)
+			if (ref_html_read_line(parser) == SC_HTML_EOF) return;
+		parser->bufp = p + 3;
+		return;
+	}
+	if (!g_ascii_strncasecmp(parser->bufp, "<style", 6)) {
+		parser->bufp += 6;
+		while ((p = ref_html_find_tag(parser, "</style>")) == NULL)
+			if (ref_html_read_line(parser) == SC_HTML_EOF) return;
+		parser->bufp = p + 8;
+		return;
+	}
+	if (!g_ascii_strncasecmp(parser->bufp, "<script", 7)) {
+		parser->bufp += 7;
+		while ((p = ref_html_find_tag(parser, "</script>")) == NULL)
+			if (ref_html_read_line(parser) == SC_HTML_EOF) return;
+		parser->bufp = p + 9;
+		return;
+	}
+
+	parser->bufp++;
+	while ((p = strchr(parser->bufp, '>')) == NULL)
+		if (ref_html_read_line(parser) == SC_HTML_EOF) return;
+
+	strncpy2(buf, parser->bufp, MIN(p - parser->bufp + 1, len));
+	g_strstrip(buf);
+	parser->bufp = p + 1;
+}
+
+/* What the parser hands out: one entry per sc_html_parse() call */
+static GString *
+run_parser(FILE *fp, gboolean reference)
+{
+	CodeConverter *conv = conv_code_converter_new(CS_UTF_8);
+	SC_HTMLParser *parser;
+	GString *out = g_string_new(NULL);
+	gchar *str;
+
+	rewind(fp);
+	if (reference) {
+		parser = ref_html_parser_new(fp, conv);
+		while ((str = ref_html_parse(parser)) != NULL)
+			g_string_append_printf(out, "[%d|%s|%s]", parser->state,
+					parser->href ? parser->href : "(null)", str);
+		ref_html_parser_destroy(parser);
+	} else {
+		parser = sc_html_parser_new(fp, conv);
+		while ((str = sc_html_parse(parser)) != NULL)
+			g_string_append_printf(out, "[%d|%s|%s]", parser->state,
+					parser->href ? parser->href : "(null)", str);
+		sc_html_parser_destroy(parser);
+	}
+	conv_code_converter_destroy(conv);
+
+	return out;
+}
+
+static FILE *
+open_html(const gchar *html, gsize len)
+{
+	FILE *fp = tmpfile();
+
+	g_assert_nonnull(fp);
+	g_assert_cmpuint(fwrite(html, 1, len, fp), ==, len);
+
+	return fp;
+}
+
+static void
+check_html(const gchar *html, gsize len)
+{
+	FILE *fp = open_html(html, len);
+	GString *expected = run_parser(fp, TRUE);
+	GString *out = run_parser(fp, FALSE);
+
+	g_assert_cmpstr(out->str, ==, expected->str);
+
+	g_string_free(expected, TRUE);
+	g_string_free(out, TRUE);
+	fclose(fp);
+}
+
+static const gchar *td_html[] = {
+	"",
+	"plain text",
+	"  leading and   trailing  \r\n spaces \t",
+	"<p>A paragraph</p><P>Another<BR>line<br/>and<br />more</p>",
+	"<div>div</div><ul><li>one<li>two</ul><table><tr><td>a</td><td>b</td></tr></table>",
+	"<h1>Title</h1>text<H2 class=\"x\">Sub</H2><h7>odd</h7><h1x>not quite</h1x>",
+	"<hr><hr/>after<HR size=2>",
+	"<pre>  keep\n\tthe   spaces\r\n</pre>  but not   here",
+	"<blockquote>quoted\nline<blockquote>twice</blockquote>once</blockquote>done",
+	"<a href=\"http://example.com/\">link</a> and <A HREF='http://example.org/?a=1&amp;b=2'>another</A>",
+	"<a name=\"anchor\">no href</a><a>bare</a><a href=http://example.net/ title=x>unquoted</a>",
+	"<a href=\"http://example.com/&lt;x&gt;\">escaped href</a>",
+	"<a href=\"unterminated>broken</a> text",
+	"&amp; &lt; &gt; &quot; &apos; &nbsp; &copy; &Aacute; &zwnj; &euro;",
+	"&#65;&#x42;&#0;&#31;&#1114111;&#1114112;&#x; &#;&#12a; &#-5;",
+	"&unknown; &amp &; & alone &thetasym; &AMP; &Amp;",
+	"<!-- a comment <p> --> after <!--unterminated",
+	"<style>p { color: red; }</STYLE>styled<script>if (a < b) x();</script>scripted",
+	"<SCRIPT>never ended",
+	"<!DOCTYPE html><html><head><title>t</title></head><body>body</body></html>",
+	"<unknown attr>text</unknown><p\tclass=x>tabbed</p >",
+	"< p>space before name</p>",
+	"<BLOCKQUOTE><DIV>Nested</DIV></BLOCKQUOTE>",
+	"<bloc\xe2\x84\xaaquote>kelvin</bloc\xe2\x84\xaaquote>",
+	"<verylongtagnamethatkeepsgoing>x</verylongtagnamethatkeepsgoing><h1verylongheadingname>y",
+	"<dd>d</dd><tr>r</tr><li>l</li></li></div></ul></table></h3>",
+	"text with \xc3\xa9 accents and \xe6\xbc\xa2\xe5\xad\x97",
+	"unterminated tag <p",
+	"<p>one</p><p>two</p>\n\n<p>three</p>",
+};
+
+static void
+test_html_conformance(gconstpointer user_data)
+{
+	const gchar *html = (const gchar *)user_data;
+
+	check_html(html, strlen(html));
+}
+
+static const gchar *pieces[] = {
+	"<p>", "</p>", "<br>", "<BR/>", "<div>", "</div>", "<ul>", "<li>",
+	"</li>", "</ul>", "<table>", "<tr>", "<td>", "</td>", "</tr>",
+	"</table>", "<h2>", "</h2>", "<hr>", "<pre>", "</pre>",
+	"<blockquote>", "</blockquote>", "<a href=\"http://example.com/p?a=1&amp;b=2\">",
+	"<a href='mailto:user@example.com'>", "</a>", "<span style=\"x\">",
+	"</span>", "<b>", "</b>", "<font color=red>", "</font>",
+	"<!-- comment -->", "<style>.c{}</style>", "&amp;", "&nbsp;", "&eacute;",
+	"&#8364;", "&bogus;", "& ", " ", "  ", "\n", "\r\n", "\t",
+	"Lorem", "ipsum", "dolor", "sit", "amet,", "consectetur", "adipiscing",
+	"\xc3\xa9t\xc3\xa9", "\xe2\x82\xac"
+};
+
+/* A large document made of random pieces, crossing the parser's buffer
+ * boundaries in all sorts of places */
+static gchar *
+make_html(guint32 seed, gsize size)
+{
+	GRand *rand = g_rand_new_with_seed(seed);
+	GString *html = g_string_sized_new(size + 64);
+
+	while (html->len < size)
+		g_string_append(html, pieces[g_rand_int_range(rand, 0,
+					G_N_ELEMENTS(pieces))]);
+	g_rand_free(rand);
+
+	return g_string_free(html, FALSE);
+}
+
+static void
+test_html_conformance_random(void)
+{
+	guint32 seed;
+
+	for (seed = 1; seed <= 20; seed++) {
+		gchar *html = make_html(seed, 64 * 1024);
+
+		check_html(html, strlen(html));
+		g_free(html);
+	}
+}
+
+static void
+test_html_perf(void)
+{
+	gchar *html = make_html(42, 8 * 1024 * 1024);
+	FILE *fp = open_html(html, strlen(html));
+	GString *out;
+	gdouble ref_time, new_time;
+
+	g_test_timer_start();
+	out = run_parser(fp, TRUE);
+	ref_time = g_test_timer_elapsed();
+	g_string_free(out, TRUE);
+
+	g_test_timer_start();
+	out = run_parser(fp, FALSE);
+	new_time = g_test_timer_elapsed();
+	g_string_free(out, TRUE);
+
+	g_test_minimized_result(ref_time, "reference: %.1f MB/s",
+				strlen(html) / ref_time / (1024 * 1024));
+	g_test_minimized_result(new_time, "converter: %.1f MB/s",
+				strlen(html) / new_time / (1024 * 1024));
+
+	fclose(fp);
+	g_free(html);
+}
+
+int
+main(int argc, char *argv[])
+{
+	guint n;
+
+	g_test_init(&argc, &argv, NULL);
+	/* the corpus has syntax errors, which are warned about */
+	g_log_set_always_fatal(G_LOG_LEVEL_ERROR | G_LOG_LEVEL_CRITICAL);
+
+	for (n = 0; n < G_N_ELEMENTS(td_html); n++) {
+		gchar *path = g_strdup_printf("/core/html/conformance/%u", n);
+
+		g_test_add_data_func(path, td_html[n], test_html_conformance);
+		g_free(path);
+	}
+	g_test_add_func("/core/html/conformance/random",
+			test_html_conformance_random);
+	if (g_test_perf())
+		g_test_add_func("/core/html/perf", test_html_perf);
+
+	return g_test_run();
+}
@@ -0,0 +1,327 @@
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <sys/stat.h>
+#include <string.h>
+
+#include "maildir_store.h"
+#include "utils.h"
+
+#include "common/tests/mock_prefs_common_get_use_shred.h"
+#include "common/tests/mock_prefs_common_get_flush_metadata.h"
+
+static gchar *tmpdir = NULL;
+
+static gchar *
+cur_file(const gchar *uniq, const gchar *info)
+{
+	return g_strdup_printf("cur%c%s%c2,%s", G_DIR_SEPARATOR, uniq,
+			       MAILDIR_INFO_SEP, info);
+}
+
+static void
+check_relfile(const gchar *uniq, MsgPermFlags flags, const gchar *old_info,
+	      gboolean in_new, const gchar *expected)
+{
+	gchar *relfile = maildir_make_relfile(uniq, flags, old_info, in_new);
+
+	g_assert_cmpstr(relfile, ==, expected);
+	g_free(relfile);
+}
+
+static gchar *
+make_maildir(const gchar *name)
+{
+	gchar *path = g_build_filename(tmpdir, name, NULL);
+
+	g_assert_false(maildir_is_maildir(path));
+	g_assert_cmpint(maildir_make_maildir(path), ==, 0);
+	g_assert_true(maildir_is_maildir(path));
+
+	return path;
+}
+
+static gint
+count_files(const gchar *path, const gchar *subdir)
+{
+	gchar *dirpath = g_build_filename(path, subdir, NULL);
+	GDir *dp = g_dir_open(dirpath, 0, NULL);
+	gint n = 0;
+
+	g_assert_nonnull(dp);
+	while (g_dir_read_name(dp) != NULL)
+		n++;
+	g_dir_close(dp);
+	g_free(dirpath);
+
+	return n;
+}
+
+static void
+check_file(const gchar *path, const gchar *relfile, const gchar *expected)
+{
+	gchar *file = g_build_filename(path, relfile, NULL);
+	gchar *contents;
+
+	g_assert_true(g_file_get_contents(file, &contents, NULL, NULL));
+	g_assert_cmpstr(contents, ==, expected);
+	g_free(contents);
+	g_free(file);
+}
+
+static gchar *
+write_src(const gchar *name, const gchar *content)
+{
+	gchar *file = g_build_filename(tmpdir, name, NULL);
+
+	g_assert_true(g_file_set_contents(file, content, -1, NULL));
+	return file;
+}
+
+static void
+test_maildir_flags(void)
+{
+	const MsgPermFlags managed = MSG_MARKED | MSG_FORWARDED | MSG_REPLIED |
+				     MSG_UNREAD | MSG_DELETED;
+	MsgPermFlags flags;
+	gchar *relfile, *uniq;
+
+	/* new messages without flags stay in new/ */
+	relfile = g_strconcat("new", G_DIR_SEPARATOR_S, "u1", NULL);
+	check_relfile("u1", MSG_NEW | MSG_UNREAD, NULL, TRUE, relfile);
+	g_assert_cmpint(maildir_flags_from_file(relfile), ==, MSG_NEW | MSG_UNREAD);
+	g_assert_true(maildir_relfile_is_new(relfile));
+	g_assert_null(maildir_get_info(relfile));
+	g_free(relfile);
+
+	/* but go to cur/ once they were seen, or have flags */
+	relfile = cur_file("u1", "");
+	check_relfile("u1", MSG_NEW | MSG_UNREAD, NULL, FALSE, relfile);
+	check_relfile("u1", MSG_UNREAD, NULL, TRUE, relfile);
+	g_assert_cmpint(maildir_flags_from_file(relfile), ==, MSG_UNREAD);
+	g_free(relfile);
+
+	relfile = cur_file("u1", "F");
+	check_relfile("u1", MSG_NEW | MSG_UNREAD | MSG_MARKED, NULL, TRUE, relfile);
+	g_assert_cmpint(maildir_flags_from_file(relfile), ==, MSG_UNREAD | MSG_MARKED);
+	g_free(relfile);
+
+	/* letters in ASCII order */
+	relfile = cur_file("u1", "FPRST");
+	check_relfile("u1", MSG_DELETED | MSG_REPLIED | MSG_FORWARDED | MSG_MARKED,
+		      NULL, FALSE, relfile);
+	g_assert_cmpstr(maildir_get_info(relfile), ==, "FPRST");
+	uniq = maildir_get_uniq(relfile + 4);
+	g_assert_cmpstr(uniq, ==, "u1");
+	g_free(uniq);
+	g_free(relfile);
+
+	/* the letters of other MUAs are kept, ours follow the flags */
+	relfile = cur_file("u1", "DSa");
+	check_relfile("u1", 0, "DRa", FALSE, relfile);
+	g_assert_cmpint(maildir_flags_from_file(relfile), ==, 0);
+	g_free(relfile);
+
+	/* every combination of the flags survives the file name */
+	for (flags = 0; flags <= managed; flags++) {
+		if ((flags & ~managed) != 0)
+			continue;
+		relfile = maildir_make_relfile("u2", flags, NULL, FALSE);
+		g_assert_cmpint(maildir_flags_from_file(relfile), ==, flags);
+		g_free(relfile);
+	}
+}
+
+static void
+test_maildir_deliver(void)
+{
+	gchar *path = make_maildir("deliver");
+	gchar *src, *uniq, *uniq2, *relfile, *expected;
+	gboolean moved = TRUE;
+	GStatBuf s;
+
+	/* copies go through tmp/ into new/, the source stays */
+	src = write_src("msg1", "first\n");
+	g_assert_cmpint(maildir_deliver_file(path, src, MSG_NEW | MSG_UNREAD,
+			FALSE, 0, &moved, &uniq, &relfile), ==, 0);
+	g_assert_false(moved);
+	expected = g_strconcat("new", G_DIR_SEPARATOR_S, uniq, NULL);
+	g_assert_cmpstr(relfile, ==, expected);
+	check_file(path, relfile, "first\n");
+	g_assert_true(g_file_test(src, G_FILE_TEST_EXISTS));
+	g_assert_cmpint(count_files(path, "tmp"), ==, 0);
+	g_assert_cmpint(count_files(path, "new"), ==, 1);
+	g_free(expected);
+	g_free(relfile);
+
+	/* moved with flags, straight into cur/ */
+	g_assert_cmpint(maildir_deliver_file(path, src, MSG_MARKED, TRUE, 0,
+			&moved, &uniq2, &relfile), ==, 0);
+	g_assert_true(moved);
+	g_assert_cmpstr(uniq, !=, uniq2);
+	expected = cur_file(uniq2, "FS");
+	g_assert_cmpstr(relfile, ==, expected);
+	check_file(path, relfile, "first\n");
+	g_assert_false(g_file_test(src, G_FILE_TEST_EXISTS));
+	g_assert_cmpint(count_files(path, "tmp"), ==, 0);
+	g_assert_cmpint(count_files(path, "cur"), ==, 1);
+	g_free(expected);
+	g_free(relfile);
+	g_free(uniq2);
+	g_free(uniq);
+	g_free(src);
+
+	/* the folder's permissions apply to copies */
+	src = write_src("msg2", "second\n");
+	g_assert_cmpint(maildir_deliver_file(path, src, MSG_NEW | MSG_UNREAD,
+			FALSE, 0600, NULL, &uniq, &relfile), ==, 0);
+	expected = g_build_filename(path, relfile, NULL);
+	g_assert_cmpint(g_stat(expected, &s), ==, 0);
+#ifdef G_OS_UNIX
+	g_assert_cmpint(s.st_mode & 0777, ==, 0600);
+#endif
+	g_free(expected);
+	g_free(relfile);
+	g_free(uniq);
+	g_free(src);
+
+	/* nothing left behind when the source is missing */
+	src = g_build_filename(tmpdir, "missing", NULL);
+	g_test_expect_message("Claws-Mail", G_LOG_LEVEL_WARNING,
+			      "can't copy message*");
+	g_assert_cmpint(maildir_deliver_file(path, src, MSG_NEW | MSG_UNREAD,
+			TRUE, 0, &moved, &uniq, &relfile), <, 0);
+	g_test_assert_expected_messages();
+	g_assert_false(moved);
+	g_assert_null(uniq);
+	g_assert_null(relfile);
+	g_assert_cmpint(count_files(path, "tmp"), ==, 0);
+	g_free(src);
+
+	g_free(path);
+}
+
+static guint
+lookup_uid(MaildirUidMap *map, const gchar *uniq)
+{
+	return GPOINTER_TO_UINT(g_hash_table_lookup(map->uid_by_uniq, uniq));
+}
+
+static const gchar *
+lookup_file(MaildirUidMap *map, guint uid)
+{
+	return g_hash_table_lookup(map->file_by_uid, GUINT_TO_POINTER(uid));
+}
+
+static void
+test_maildir_uid_map(void)
+{
+	gchar *path = make_maildir("uidmap");
+	MaildirUidMap map = { NULL, NULL, 0 };
+	gchar *uniq[3], *relfile[3];
+	gchar *src, *from, *to, *renamed, *mapfile;
+	guint uid[3];
+	gint i;
+
+	/* no map yet: the numbers can not be trusted */
+	g_assert_false(maildir_uid_map_read(&map, path));
+	g_assert_false(maildir_uid_map_rescan(&map, path));
+
+	src = write_src("msg", "message\n");
+	for (i = 0; i < 3; i++) {
+		g_assert_cmpint(maildir_deliver_file(path, src, MSG_NEW | MSG_UNREAD,
+				FALSE, 0, NULL, &uniq[i], &relfile[i]), ==, 0);
+		uid[i] = maildir_uid_map_register(&map, path, uniq[i], relfile[i]);
+		g_assert_cmpuint(uid[i], ==, i + 1);
+	}
+	g_unlink(src);
+	g_free(src);
+
+	/* the numbers are kept on disk */
+	maildir_uid_map_clear(&map);
+	g_assert_true(maildir_uid_map_read(&map, path));
+	g_assert_cmpuint(map.next_uid, ==, 4);
+	g_assert_false(maildir_uid_map_rescan(&map, path));
+	for (i = 0; i < 3; i++) {
+		g_assert_cmpuint(lookup_uid(&map, uniq[i]), ==, uid[i]);
+		g_assert_cmpstr(lookup_file(&map, uid[i]), ==, relfile[i]);
+	}
+
+	/* another MUA marks the second one read: same number, new file */
+	renamed = cur_file(uniq[1], "S");
+	from = g_build_filename(path, relfile[1], NULL);
+	to = g_build_filename(path, renamed, NULL);
+	g_assert_cmpint(g_rename(from, to), ==, 0);
+	g_free(from);
+	g_free(to);
+	g_assert_false(maildir_uid_map_rescan(&map, path));
+	g_assert_cmpstr(lookup_file(&map, uid[1]), ==, renamed);
+	g_assert_cmpint(maildir_flags_from_file(lookup_file(&map, uid[1])), ==, 0);
+
+	/* an MDA delivers one, and the first one goes */
+	g_free(write_src("uidmap" G_DIR_SEPARATOR_S "new" G_DIR_SEPARATOR_S
+			 "external.1", "external\n"));
+	from = g_build_filename(path, relfile[0], NULL);
+	g_assert_cmpint(g_unlink(from), ==, 0);
+	g_free(from);
+	g_assert_true(maildir_uid_map_rescan(&map, path));
+	g_assert_cmpuint(lookup_uid(&map, "external.1"), ==, 4);
+	g_assert_cmpuint(lookup_uid(&map, uniq[0]), ==, 0);
+	g_assert_null(lookup_file(&map, uid[0]));
+	g_assert_cmpuint(g_hash_table_size(map.file_by_uid), ==, 3);
+
+	/* numbers are never reused, even when the last one goes */
+	from = g_build_filename(path, "new", "external.1", NULL);
+	g_assert_cmpint(g_unlink(from), ==, 0);
+	g_free(from);
+	g_assert_true(maildir_uid_map_rescan(&map, path));
+	maildir_uid_map_clear(&map);
+	g_assert_true(maildir_uid_map_read(&map, path));
+	g_assert_cmpuint(map.next_uid, ==, 5);
+	g_assert_false(maildir_uid_map_rescan(&map, path));
+	g_assert_cmpuint(lookup_uid(&map, uniq[1]), ==, uid[1]);
+	g_assert_cmpuint(lookup_uid(&map, uniq[2]), ==, uid[2]);
+
+	maildir_uid_map_forget(&map, uid[2]);
+	g_assert_cmpuint(lookup_uid(&map, uniq[2]), ==, 0);
+	g_assert_null(lookup_file(&map, uid[2]));
+
+	/* a map in an unknown format is rebuilt */
+	mapfile = g_build_filename(path, MAILDIR_UIDMAP_FILE, NULL);
+	g_assert_true(g_file_set_contents(mapfile, "9 1\n1 x\n", -1, NULL));
+	g_test_expect_message("Claws-Mail", G_LOG_LEVEL_WARNING,
+			      "invalid maildir uid map*");
+	g_assert_false(maildir_uid_map_read(&map, path));
+	g_test_assert_expected_messages();
+	g_assert_cmpuint(map.next_uid, ==, 1);
+	g_free(mapfile);
+
+	maildir_uid_map_clear(&map);
+	for (i = 0; i < 3; i++) {
+		g_free(uniq[i]);
+		g_free(relfile[i]);
+	}
+	g_free(renamed);
+	g_free(path);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int ret;
+
+	g_test_init(&argc, &argv, NULL);
+
+	tmpdir = g_dir_make_tmp("maildir_store_test_XXXXXX", NULL);
+	g_assert_nonnull(tmpdir);
+
+	g_test_add_func("/core/maildir/flags", test_maildir_flags);
+	g_test_add_func("/core/maildir/deliver", test_maildir_deliver);
+	g_test_add_func("/core/maildir/uid_map", test_maildir_uid_map);
+
+	ret = g_test_run();
+
+	remove_dir_recursive(tmpdir);
+	g_free(tmpdir);
+
+	return ret;
+}
@@ -154,6 +154,26 @@ static GdkCursor *watch_cursor= NULL;
 			  textview->messageview->statusbar_cid);	   \
 }
 
+/* Text parts larger than this are shown a screenful first, the rest
+ * being appended when idle */
+#define TEXTVIEW_PROGRESSIVE_SIZE	(256 * 1024)
+/* Lines written before such a part is shown */
+#define TEXTVIEW_PROGRESSIVE_LINES	200
+/* Time spent appending the rest, per idle call, in microseconds */
+#define TEXTVIEW_PROGRESSIVE_BUDGET	20000
+
+/* The part of a text body left to write */
+struct _TextViewWriter
+{
+	FILE *fp;
+	CodeConverter *conv;
+	long end;
+	gint length;
+	size_t wrote;
+	gboolean partial;
+	guint idle_id;
+};
+
 static void textview_show_ertf		(TextView	*textview,
 					 FILE		*fp,
 					 CodeConverter	*conv);
@@ -162,7 +182,9 @@ static void textview_add_part		(TextView	*textview,
 static void textview_add_parts		(TextView	*textview,
 					 MimeInfo	*mimeinfo);
 static void textview_write_body		(TextView	*textview,
-					 MimeInfo	*mimeinfo);
+					 MimeInfo	*mimeinfo,
+					 gboolean	 progressive);
+static void textview_writer_cancel	(TextView	*textview);
 static void textview_show_html		(TextView	*textview,
 					 FILE		*fp,
 					 CodeConverter	*conv);
@@ -621,7 +643,7 @@ void textview_show_part(TextView *textview, MimeInfo *mimeinfo, FILE *fp)
 		if (fseek(fp, mimeinfo->offset, SEEK_SET) < 0)
 			perror("fseek");
 
-		textview_write_body(textview, mimeinfo);
+		textview_write_body(textview, mimeinfo, TRUE);
 	}
 
 	textview->loading = FALSE;
@@ -778,7 +800,7 @@ static void textview_add_part(TextView *textview, MimeInfo *mimeinfo)
 			gtk_text_buffer_create_mark(buffer, "body_start", &iter, TRUE);
 		}
 
-		textview_write_body(textview, mimeinfo);
+		textview_write_body(textview, mimeinfo, FALSE);
 
 		if (!gtk_text_buffer_get_mark(buffer, "body_end")) {
 			gtk_text_buffer_get_end_iter(buffer, &iter);
@@ -999,7 +1021,118 @@ void textview_show_mime_part(TextView *textview, MimeInfo *partinfo)
 	textview_show_icon(textview, GTK_STOCK_DIALOG_INFO);
 }
 
-static void textview_write_body(TextView *textview, MimeInfo *mimeinfo)
+/* textview_write_lines() - writes the lines of a text part, until its
+ * end, max_lines lines (if > 0), or deadline (if > 0) is passed.
+ * Returns TRUE when there is nothing left to write. */
+static gboolean textview_write_lines(TextView *textview,
+				     TextViewWriter *writer,
+				     gint max_lines, gint64 deadline)
+{
+	gchar buf[BUFFSIZE];
+	long i;
+	gint lines = 0;
+
+	while ((i = ftell(writer->fp)) < writer->end &&
+	       claws_fgets(buf, sizeof(buf), writer->fp) != NULL) {
+		textview_write_line(textview, buf, writer->conv, TRUE);
+		if (textview->stop_loading)
+			return TRUE;
+		writer->wrote += ftell(writer->fp) - i;
+		if (writer->length > 1024*1024
+		&&  writer->wrote > 1024*1024
+		&& !textview->messageview->show_full_text) {
+			writer->partial = TRUE;
+			return TRUE;
+		}
+		lines++;
+		if (max_lines > 0 && lines >= max_lines)
+			return FALSE;
+		/* don't look at the clock for every line */
+		if (deadline > 0 && lines % 32 == 0 &&
+		    g_get_monotonic_time() >= deadline)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void textview_writer_free(TextViewWriter *writer)
+{
+	claws_fclose(writer->fp);
+	conv_code_converter_destroy(writer->conv);
+	g_free(writer);
+}
+
+/* textview_write_body_done() - finishes the display of a body once it
+ * has all been written */
+static void textview_write_body_done(TextView *textview, gboolean partial,
+				     gint length)
+{
+	GSList *cur;
+
+	textview->uri_list = g_slist_reverse(textview->uri_list);
+	for (cur = textview->uri_list; cur; cur = cur->next) {
+		ClickableText *uri = (ClickableText *)cur->data;
+		if (!uri->is_quote)
+			continue;
+		if (!prefs_common.hide_quotes ||
+		    uri->quote_level+1 < prefs_common.hide_quotes) {
+			textview_toggle_quote(textview, cur, uri, TRUE);
+			if (textview->stop_loading) {
+				return;
+			}
+		}
+	}
+	
+	if (partial) {
+		messageview_show_partial_display(
+			textview->messageview, 
+			textview->messageview->msginfo,
+			length);
+	}
+}
+
+static gboolean textview_write_idle(gpointer data)
+{
+	TextView *textview = (TextView *)data;
+	TextViewWriter *writer = textview->writer;
+	gboolean done;
+
+	account_sigsep_matchlist_create();
+	done = textview_write_lines(textview, writer, 0,
+			g_get_monotonic_time() + TEXTVIEW_PROGRESSIVE_BUDGET);
+	account_sigsep_matchlist_delete();
+
+	if (!done)
+		return TRUE;
+
+	debug_print("Done writing text part progressively\n");
+	textview->writer = NULL;
+	textview_write_body_done(textview, writer->partial, writer->length);
+	textview_writer_free(writer);
+
+	return FALSE;
+}
+
+/* textview_writer_cancel() - forgets the rest of a body being written
+ * in idle time */
+static void textview_writer_cancel(TextView *textview)
+{
+	if (textview->writer == NULL)
+		return;
+
+	debug_print("Cancelling progressive writing of text part\n");
+	g_source_remove(textview->writer->idle_id);
+	textview_writer_free(textview->writer);
+	textview->writer = NULL;
+}
+
+/* textview_write_body() - writes a text part. If progressive, large
+ * plain text parts are written a screenful first, the rest being
+ * appended in idle time; nothing else may be added to the text view
+ * after them. */
+static void textview_write_body(TextView *textview, MimeInfo *mimeinfo,
+				gboolean progressive)
 {
 	FILE *tmpfp;
 	gchar buf[BUFFSIZE];
@@ -1008,9 +1141,8 @@ static void textview_write_body(TextView *textview, MimeInfo *mimeinfo)
 #ifndef G_OS_WIN32
 	const gchar *p, *cmd;
 #endif
-	GSList *cur;
-	gboolean continue_write = TRUE;
-	size_t wrote = 0, i = 0;
+	TextViewWriter *writer;
+	gboolean partial = FALSE;
 
 	if (textview->messageview->forced_charset)
 		charset = textview->messageview->forced_charset;
@@ -1163,50 +1295,46 @@ textview_default:
 			return;
 		}
 		debug_print("Viewing text content of type: %s (length: %d)\n", mimeinfo->subtype, mimeinfo->length);
-		while (((i = ftell(tmpfp)) < mimeinfo->offset + mimeinfo->length) &&
-		       (claws_fgets(buf, sizeof(buf), tmpfp) != NULL)
-		       && continue_write) {
-			textview_write_line(textview, buf, conv, TRUE);
-			if (textview->stop_loading) {
-				claws_fclose(tmpfp);
-				account_sigsep_matchlist_delete();
-				return;
-			}
-			wrote += ftell(tmpfp)-i;
-			if (mimeinfo->length > 1024*1024 
-			&&  wrote > 1024*1024
-			&& !textview->messageview->show_full_text) {
-				continue_write = FALSE;
-			}
+
+		writer = g_new0(TextViewWriter, 1);
+		writer->fp = tmpfp;
+		writer->conv = conv;
+		writer->end = mimeinfo->offset + mimeinfo->length;
+		writer->length = mimeinfo->length;
+		conv = NULL;
+
+		if (progressive &&
+		    mimeinfo->length > TEXTVIEW_PROGRESSIVE_SIZE &&
+		    !textview_write_lines(textview, writer,
+					  TEXTVIEW_PROGRESSIVE_LINES, 0)) {
+			debug_print("Writing the rest of the text part progressively\n");
+			/* below redraws and input, to keep scrolling smooth */
+			writer->idle_id = g_idle_add_full(G_PRIORITY_LOW,
+					textview_write_idle, textview, NULL);
+			textview->writer = writer;
+			account_sigsep_matchlist_delete();
+			procmime_force_encoding(0);
+			return;
+		}
+
+		if (!textview->stop_loading)
+			textview_write_lines(textview, writer, 0, 0);
+		partial = writer->partial;
+		textview_writer_free(writer);
+		if (textview->stop_loading) {
+			account_sigsep_matchlist_delete();
+			procmime_force_encoding(0);
+			return;
 		}
-		claws_fclose(tmpfp);
 	}
 
 	account_sigsep_matchlist_delete();
 
-	conv_code_converter_destroy(conv);
+	if (conv)
+		conv_code_converter_destroy(conv);
 	procmime_force_encoding(0);
 
-	textview->uri_list = g_slist_reverse(textview->uri_list);
-	for (cur = textview->uri_list; cur; cur = cur->next) {
-		ClickableText *uri = (ClickableText *)cur->data;
-		if (!uri->is_quote)
-			continue;
-		if (!prefs_common.hide_quotes ||
-		    uri->quote_level+1 < prefs_common.hide_quotes) {
-			textview_toggle_quote(textview, cur, uri, TRUE);
-			if (textview->stop_loading) {
-				return;
-			}
-		}
-	}
-	
-	if (continue_write == FALSE) {
-		messageview_show_partial_display(
-			textview->messageview, 
-			textview->messageview->msginfo,
-			mimeinfo->length);
-	}
+	textview_write_body_done(textview, partial, mimeinfo->length);
 	GTK_EVENTS_FLUSH();
 }
 
@@ -1285,28 +1413,6 @@ static void textview_show_ertf(TextView *textview, FILE *fp,
 	ertf_parser_destroy(parser);
 }
 
-#define ADD_TXT_POS(bp_, ep_, pti_) \
-	if ((last->next = alloca(sizeof(struct txtpos))) != NULL) { \
-		last = last->next; \
-		last->bp = (bp_); last->ep = (ep_); last->pti = (pti_); \
-		last->next = NULL; \
-	} else { \
-		g_warning("alloc error scanning URIs"); \
-		gtk_text_buffer_insert_with_tags_by_name(buffer, &iter, \
-							 linebuf, -1, \
-							 fg_tag, NULL); \
-		return; \
-	}
-
-#define ADD_TXT_POS_LATER(bp_, ep_, pti_) \
-	if ((last->next = alloca(sizeof(struct txtpos))) != NULL) { \
-		last = last->next; \
-		last->bp = (bp_); last->ep = (ep_); last->pti = (pti_); \
-		last->next = NULL; \
-	} else { \
-		g_warning("alloc error scanning URIs"); \
-	}
-
 /* textview_make_clickable_parts() - colorizes clickable parts */
 static void textview_make_clickable_parts(TextView *textview,
 					  const gchar *fg_tag,
@@ -1318,45 +1424,9 @@ static void textview_make_clickable_parts(TextView *textview,
 	GtkTextBuffer *buffer = gtk_text_view_get_buffer(text);
 	GtkTextIter iter;
 	gchar *mybuf = g_strdup(linebuf);
-	
-	/* parse table - in order of priority */
-	struct table {
-		const gchar *needle; /* token */
-
-		/* token search function */
-		gchar    *(*search)	(const gchar *haystack,
-					 const gchar *needle);
-		/* part parsing function */
-		gboolean  (*parse)	(const gchar *start,
-					 const gchar *scanpos,
-					 const gchar **bp_,
-					 const gchar **ep_,
-					 gboolean hdr);
-		/* part to URI function */
-		gchar    *(*build_uri)	(const gchar *bp,
-					 const gchar *ep);
-	};
-
-	static struct table parser[] = {
-		{"http://",  strcasestr, get_uri_part,   make_uri_string},
-		{"https://", strcasestr, get_uri_part,   make_uri_string},
-		{"ftp://",   strcasestr, get_uri_part,   make_uri_string},
-		{"sftp://",  strcasestr, get_uri_part,   make_uri_string},
-		{"gopher://",strcasestr, get_uri_part,   make_uri_string},
-		{"www.",     strcasestr, get_uri_part,   make_http_string},
-		{"mailto:",  strcasestr, get_uri_part,   make_uri_string},
-		{"@",        strcasestr, get_email_part, make_email_string}
-	};
-	const gint PARSE_ELEMS = sizeof parser / sizeof parser[0];
-
-	gint  n;
-	const gchar *walk, *bp, *ep;
-
-	struct txtpos {
-		const gchar	*bp, *ep;	/* text position */
-		gint		 pti;		/* index in parse table */
-		struct txtpos	*next;		/* next */
-	} head = {NULL, NULL, 0,  NULL}, *last = &head;
+	const gchar *normal_text;
+	GArray *parts;
+	guint n;
 
 	if (!g_utf8_validate(linebuf, -1, NULL)) {
 		g_free(mybuf);
@@ -1366,71 +1436,40 @@ static void textview_make_clickable_parts(TextView *textview,
 
 	gtk_text_buffer_get_end_iter(buffer, &iter);
 
-	/* parse for clickable parts, and build a list of begin and end positions  */
-	for (walk = mybuf;;) {
-		gint last_index = PARSE_ELEMS;
-		gchar *scanpos = NULL;
-
-		/* FIXME: this looks phony. scanning for anything in the parse table */
-		for (n = 0; n < PARSE_ELEMS; n++) {
-			gchar *tmp;
-
-			tmp = parser[n].search(walk, parser[n].needle);
-			if (tmp) {
-				if (scanpos == NULL || tmp < scanpos) {
-					scanpos = tmp;
-					last_index = n;
-				}
-			}					
-		}
-
-		if (scanpos) {
-			/* check if URI can be parsed */
-			if (parser[last_index].parse(walk, scanpos, &bp, &ep, hdr)
-			    && (size_t) (ep - bp - 1) > strlen(parser[last_index].needle)) {
-					ADD_TXT_POS(bp, ep, last_index);
-					walk = ep;
-			} else
-				walk = scanpos +
-					strlen(parser[last_index].needle);
-		} else
-			break;
-	}
+	/* parse for clickable parts */
+	parts = scan_uri_parts(mybuf, URI_SCAN_GOPHER |
+			       (hdr ? URI_SCAN_HEADER : 0));
 
 	/* colorize this line */
-	if (head.next) {
-		const gchar *normal_text = mybuf;
+	normal_text = mybuf;
+	for (n = 0; n < parts->len; n++) {
+		URIPart *part = &g_array_index(parts, URIPart, n);
+		ClickableText *uri;
 
-		/* insert URIs */
-		for (last = head.next; last != NULL;
-		     normal_text = last->ep, last = last->next) {
-			ClickableText *uri;
-			uri = g_new0(ClickableText, 1);
-			if (last->bp - normal_text > 0)
-				gtk_text_buffer_insert_with_tags_by_name
-					(buffer, &iter,
-					 normal_text,
-					 last->bp - normal_text,
-					 fg_tag, NULL);
-			uri->uri = parser[last->pti].build_uri(last->bp,
-							       last->ep);
-			uri->start = gtk_text_iter_get_offset(&iter);
-			gtk_text_buffer_insert_with_tags_by_name
-				(buffer, &iter, last->bp, last->ep - last->bp,
-				 uri_tag, fg_tag, NULL);
-			uri->end = gtk_text_iter_get_offset(&iter);
-			uri->filename = NULL;
-			textview->uri_list =
-				g_slist_prepend(textview->uri_list, uri);
-		}
-
-		if (*normal_text)
+		uri = g_new0(ClickableText, 1);
+		if (part->bp - normal_text > 0)
 			gtk_text_buffer_insert_with_tags_by_name
-				(buffer, &iter, normal_text, -1, fg_tag, NULL);
-	} else {
+				(buffer, &iter,
+				 normal_text,
+				 part->bp - normal_text,
+				 fg_tag, NULL);
+		uri->uri = make_uri_part_string(part);
+		uri->start = gtk_text_iter_get_offset(&iter);
 		gtk_text_buffer_insert_with_tags_by_name
-			(buffer, &iter, mybuf, -1, fg_tag, NULL);
+			(buffer, &iter, part->bp, part->ep - part->bp,
+			 uri_tag, fg_tag, NULL);
+		uri->end = gtk_text_iter_get_offset(&iter);
+		uri->filename = NULL;
+		textview->uri_list =
+			g_slist_prepend(textview->uri_list, uri);
+		normal_text = part->ep;
 	}
+
+	if (*normal_text)
+		gtk_text_buffer_insert_with_tags_by_name
+			(buffer, &iter, normal_text, -1, fg_tag, NULL);
+
+	g_array_free(parts, TRUE);
 	g_free(mybuf);
 }
 
@@ -1443,122 +1482,54 @@ static void textview_make_clickable_parts_later(TextView *textview,
 	GtkTextIter start_iter, end_iter;
 	gchar *mybuf;
 	gint offset = 0;
-	/* parse table - in order of priority */
-	struct table {
-		const gchar *needle; /* token */
-
-		/* token search function */
-		gchar    *(*search)	(const gchar *haystack,
-					 const gchar *needle);
-		/* part parsing function */
-		gboolean  (*parse)	(const gchar *start,
-					 const gchar *scanpos,
-					 const gchar **bp_,
-					 const gchar **ep_,
-					 gboolean hdr);
-		/* part to URI function */
-		gchar    *(*build_uri)	(const gchar *bp,
-					 const gchar *ep);
-	};
-
-	static struct table parser[] = {
-		{"http://",  strcasestr, get_uri_part,   make_uri_string},
-		{"https://", strcasestr, get_uri_part,   make_uri_string},
-		{"ftp://",   strcasestr, get_uri_part,   make_uri_string},
-		{"sftp://",  strcasestr, get_uri_part,   make_uri_string},
-		{"www.",     strcasestr, get_uri_part,   make_http_string},
-		{"mailto:",  strcasestr, get_uri_part,   make_uri_string},
-		{"@",        strcasestr, get_email_part, make_email_string}
-	};
-	const gint PARSE_ELEMS = sizeof parser / sizeof parser[0];
-
-	gint  n;
-	const gchar *walk, *bp, *ep;
-
-	struct txtpos {
-		const gchar	*bp, *ep;	/* text position */
-		gint		 pti;		/* index in parse table */
-		struct txtpos	*next;		/* next */
-	} head = {NULL, NULL, 0,  NULL}, *last = &head;
+	const gchar *counted;
+	gint counted_offset = 0;
+	GArray *parts;
+	guint n;
 
 	gtk_text_buffer_get_iter_at_offset(buffer, &start_iter, start);
 	gtk_text_buffer_get_iter_at_offset(buffer, &end_iter, end);
 	mybuf = gtk_text_buffer_get_text(buffer, &start_iter, &end_iter, FALSE);
 	offset = gtk_text_iter_get_offset(&start_iter);
 
-	/* parse for clickable parts, and build a list of begin and end positions  */
-	for (walk = mybuf;;) {
-		gint last_index = PARSE_ELEMS;
-		gchar *scanpos = NULL;
+	/* parse for clickable parts */
+	parts = scan_uri_parts(mybuf, 0);
 
-		/* FIXME: this looks phony. scanning for anything in the parse table */
-		for (n = 0; n < PARSE_ELEMS; n++) {
-			gchar *tmp;
+	/* colorize them, counting characters from one part to the next
+	 * instead of from the start each time */
+	counted = mybuf;
+	for (n = 0; n < parts->len; n++) {
+		URIPart *part = &g_array_index(parts, URIPart, n);
+		ClickableText *uri;
+		gint start_offset, end_offset;
 
-			tmp = parser[n].search(walk, parser[n].needle);
-			if (tmp) {
-				if (scanpos == NULL || tmp < scanpos) {
-					scanpos = tmp;
-					last_index = n;
-				}
-			}					
-		}
+		uri = g_new0(ClickableText, 1);
+		uri->uri = make_uri_part_string(part);
 
-		if (scanpos) {
-			/* check if URI can be parsed */
-			if (parser[last_index].parse(walk, scanpos, &bp, &ep, FALSE)
-			    && (size_t) (ep - bp - 1) > strlen(parser[last_index].needle)) {
-					ADD_TXT_POS_LATER(bp, ep, last_index);
-					walk = ep;
-			} else
-				walk = scanpos +
-					strlen(parser[last_index].needle);
-		} else
-			break;
-	}
+		start_offset = counted_offset +
+			g_utf8_pointer_to_offset(counted, part->bp);
+		end_offset = start_offset +
+			g_utf8_pointer_to_offset(part->bp, part->ep);
+		counted = part->ep;
+		counted_offset = end_offset;
 
-	/* colorize this line */
-	if (head.next) {
-		/* insert URIs */
-		for (last = head.next; last != NULL; last = last->next) {
-			ClickableText *uri;
-			gint start_offset, end_offset;
-			gchar *tmp_str;
-			gchar old_char;
-			uri = g_new0(ClickableText, 1);
-			uri->uri = parser[last->pti].build_uri(last->bp,
-							       last->ep);
-			
-			tmp_str = mybuf;
-			old_char = tmp_str[last->ep - mybuf];
-			tmp_str[last->ep - mybuf] = '\0';				       
-			end_offset = g_utf8_strlen(tmp_str, -1);
-			tmp_str[last->ep - mybuf] = old_char;
-			
-			old_char = tmp_str[last->bp - mybuf];
-			tmp_str[last->bp - mybuf] = '\0';				       
-			start_offset = g_utf8_strlen(tmp_str, -1);
-			tmp_str[last->bp - mybuf] = old_char;
-			
-			gtk_text_buffer_get_iter_at_offset(buffer, &start_iter, start_offset + offset);
-			gtk_text_buffer_get_iter_at_offset(buffer, &end_iter, end_offset + offset);
-			
-			uri->start = gtk_text_iter_get_offset(&start_iter);
-			
-			gtk_text_buffer_apply_tag_by_name(buffer, "link", &start_iter, &end_iter);
+		gtk_text_buffer_get_iter_at_offset(buffer, &start_iter, start_offset + offset);
+		gtk_text_buffer_get_iter_at_offset(buffer, &end_iter, end_offset + offset);
 
-			uri->end = gtk_text_iter_get_offset(&end_iter);
-			uri->filename = NULL;
-			textview->uri_list =
-				g_slist_prepend(textview->uri_list, uri);
-		}
-	} 
+		uri->start = gtk_text_iter_get_offset(&start_iter);
+
+		gtk_text_buffer_apply_tag_by_name(buffer, "link", &start_iter, &end_iter);
 
+		uri->end = gtk_text_iter_get_offset(&end_iter);
+		uri->filename = NULL;
+		textview->uri_list =
+			g_slist_prepend(textview->uri_list, uri);
+	}
+
+	g_array_free(parts, TRUE);
 	g_free(mybuf);
 }
 
-#undef ADD_TXT_POS
-
 static void textview_write_line(TextView *textview, const gchar *str,
 				CodeConverter *conv, gboolean do_quote_folding)
 {
@@ -1764,6 +1735,8 @@ void textview_clear(TextView *textview)
 	GdkWindow *window = gtk_text_view_get_window(text,
 				GTK_TEXT_WINDOW_TEXT);
 
+	textview_writer_cancel(textview);
+
 	buffer = gtk_text_view_get_buffer(text);
 	gtk_text_buffer_set_text(buffer, "", -1);
 	if (gtk_text_buffer_get_mark(buffer, "body_start"))
@@ -1799,6 +1772,7 @@ void textview_destroy(TextView *textview)
 	clipboard = gtk_clipboard_get(GDK_SELECTION_PRIMARY);
 	gtk_text_buffer_remove_selection_clipboard(buffer, clipboard);
 
+	textview_writer_cancel(textview);
 	textview_uri_list_remove_all(textview->uri_list);
 	textview->uri_list = NULL;
 	textview->prev_quote_level = -1;
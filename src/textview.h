@@ -27,6 +27,7 @@
 #include <gtk/gtk.h>
 
 typedef struct _ClickableText	ClickableText;
+typedef struct _TextViewWriter	TextViewWriter;
 struct _ClickableText
 {
 	gchar *uri;
@@ -83,6 +84,9 @@ struct _TextView
 	gboolean loading;
 	gboolean stop_loading;
 	gint prev_quote_level;
+
+	/* rest of a large text part, written when idle */
+	TextViewWriter *writer;
 };
 
 TextView *textview_create		(void);